@@ -0,0 +1,206 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef AWS_IOT_DELTA_PATCH_H_
+#define AWS_IOT_DELTA_PATCH_H_
+
+/**
+ * @file aws_iot_delta_patch.h
+ * @brief Applies a binary delta patch as it is read, with a fixed amount of memory
+ *
+ * A patch rebuilds a target image from a source image, e.g. the new firmware from the running one. It starts with
+ * a DELTA_PATCH_HEADER_SIZE byte header:
+ *
+ *     offset  0  "DPAT"
+ *     offset  4  version, DELTA_PATCH_VERSION
+ *     offset  5  log2 of the window size of the compressed body
+ *     offset  6  two zero bytes
+ *     offset  8  source size, 32 bit little endian
+ *     offset 12  target size, 32 bit little endian
+ *     offset 16  SHA-256 of the source
+ *
+ * The body is a sequence of bsdiff style commands, compressed as a whole. Each command is three LEB128 numbers,
+ * a zigzag encoded seek of the source position, a diff length and an extra length, followed by the diff bytes,
+ * added to the source bytes from the source position on, and the extra bytes, copied as they are. At least one of
+ * the lengths is not zero. Code changes shift addresses all over an image, which leaves the diff bytes mostly zero
+ * and small, so they compress well.
+ *
+ * The compression is LZ77 over a window of at most 2^DELTA_PATCH_MAX_WINDOW_BITS bytes. Each sequence is a token
+ * byte, the literal count in the high nibble and the match length minus 3 in the low nibble, 0 for no match. A
+ * nibble of 15 is followed by bytes added to it up to and including the first byte that is not 255. The literals
+ * come next, then a 16 bit little endian match offset and the match length bytes.
+ *
+ * Source bytes are read through a read function in small ranges and the target is written in order through a
+ * write function, so neither image has to be in memory.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aws_iot_config.h"
+#include "aws_iot_error.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef DELTA_PATCH_MAX_WINDOW_BITS
+#define DELTA_PATCH_MAX_WINDOW_BITS 12 ///< Largest compression window accepted, sets the memory used by a patch
+#endif
+
+#ifndef DELTA_PATCH_SOURCE_BUFFER_SIZE
+#define DELTA_PATCH_SOURCE_BUFFER_SIZE 256 ///< Bytes of the source read at a time
+#endif
+
+#ifndef DELTA_PATCH_TARGET_BUFFER_SIZE
+#define DELTA_PATCH_TARGET_BUFFER_SIZE 1024 ///< Bytes of the target written at a time
+#endif
+
+#define DELTA_PATCH_MIN_WINDOW_BITS 8
+#define DELTA_PATCH_VERSION 1
+#define DELTA_PATCH_HASH_SIZE 32
+#define DELTA_PATCH_HEADER_SIZE (16 + DELTA_PATCH_HASH_SIZE)
+
+/**
+ * @brief Read bytes of the source image
+ *
+ * @param pContext pContext of the parameters
+ * @param offset Offset in the source image
+ * @param pBuffer Buffer to read into
+ * @param length Bytes to read, all within the source size of the header
+ * @return SUCCESS once the bytes are read. Other values stop the patch
+ */
+typedef IoT_Error_t (*DeltaPatchRead_t)(void *pContext, uint32_t offset, uint8_t *pBuffer, size_t length);
+
+/**
+ * @brief Write bytes of the target image
+ *
+ * Called with increasing offsets, each range starting where the last one ended.
+ *
+ * @param pContext pContext of the parameters
+ * @param offset Offset in the target image
+ * @param pData Target bytes, valid during the call
+ * @param length Bytes to write
+ * @return SUCCESS once the bytes are written. Other values stop the patch
+ */
+typedef IoT_Error_t (*DeltaPatchWrite_t)(void *pContext, uint32_t offset, const uint8_t *pData, size_t length);
+
+/**
+ * @brief Parameters of a patch
+ */
+typedef struct {
+	DeltaPatchRead_t readSource; ///< Reads the source image
+	DeltaPatchWrite_t writeTarget; ///< Writes the target image
+	void *pContext; ///< Passed to both functions
+	uint32_t maxSourceSize; ///< Bytes of source that can be read, e.g. the size of the running partition
+	uint32_t maxTargetSize; ///< Bytes of target that can be written
+} DeltaPatchParams_t;
+
+/**
+ * @brief Fields of the patch header
+ */
+typedef struct {
+	uint8_t windowBits; ///< log2 of the compression window
+	uint32_t sourceSize; ///< Bytes of the source the patch applies to
+	uint32_t targetSize; ///< Bytes of the target it produces
+	uint8_t sourceHash[DELTA_PATCH_HASH_SIZE]; ///< SHA-256 of the source, checked by the caller before applying
+} DeltaPatchHeader_t;
+
+/**
+ * @brief State of a patch being applied
+ *
+ * Allocated by the caller, about 2^DELTA_PATCH_MAX_WINDOW_BITS plus the buffer sizes bytes.
+ */
+typedef struct {
+	DeltaPatchParams_t params;
+	DeltaPatchHeader_t header;
+	uint8_t headerData[DELTA_PATCH_HEADER_SIZE]; ///< Header bytes read so far
+	uint8_t headerLength;
+	IoT_Error_t error; ///< First error, returned by every later call
+	/* Decompression */
+	uint8_t sequenceState;
+	uint8_t token;
+	uint32_t literalCount;
+	uint32_t matchLength;
+	uint16_t matchOffset;
+	uint32_t windowMask;
+	uint32_t windowPosition; ///< Bytes decompressed, the window position is windowPosition & windowMask
+	uint8_t window[1 << DELTA_PATCH_MAX_WINDOW_BITS];
+	/* Commands */
+	uint8_t commandState;
+	uint8_t numberShift;
+	uint32_t number;
+	uint32_t diffLength;
+	uint32_t extraLength;
+	int64_t sourcePosition; ///< Next source byte, may leave the source between diffs
+	uint16_t sourceStart; ///< First unused byte of sourceData, at sourcePosition
+	uint16_t sourceEnd;
+	uint8_t sourceData[DELTA_PATCH_SOURCE_BUFFER_SIZE];
+	uint32_t targetPosition; ///< Bytes of target produced, written or in targetData
+	uint16_t targetLength;
+	uint8_t targetData[DELTA_PATCH_TARGET_BUFFER_SIZE];
+} DeltaPatch_t;
+
+/**
+ * @brief Read the header at the start of a patch
+ *
+ * @param pData First bytes of the patch
+ * @param length Bytes at pData, at least DELTA_PATCH_HEADER_SIZE
+ * @param pHeader Filled with the header fields
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR, or FAILURE if the data is not a patch of a supported version
+ */
+IoT_Error_t aws_iot_delta_patch_read_header(const uint8_t *pData, size_t length, DeltaPatchHeader_t *pHeader);
+
+/**
+ * @brief Prepare to apply a patch
+ *
+ * @param pPatch Patch state
+ * @param pParams Read and write functions and the image size limits
+ *
+ * @return SUCCESS or NULL_VALUE_ERROR
+ */
+IoT_Error_t aws_iot_delta_patch_init(DeltaPatch_t *pPatch, const DeltaPatchParams_t *pParams);
+
+/**
+ * @brief Apply the next bytes of the patch, header included
+ *
+ * The patch can be fed in chunks of any size. The target is written as it is rebuilt, its last bytes once the
+ * chunk completing it is fed.
+ *
+ * @param pPatch Patch state
+ * @param pData Next bytes of the patch
+ * @param length Bytes at pData
+ *
+ * @return SUCCESS, MAX_SIZE_ERROR if an image of the header exceeds the size limits, FAILURE if the patch is
+ * corrupt or the error of a read or write function. After an error, the same error.
+ */
+IoT_Error_t aws_iot_delta_patch_feed(DeltaPatch_t *pPatch, const uint8_t *pData, size_t length);
+
+/**
+ * @brief Check that the whole patch was applied
+ *
+ * @param pPatch Patch state
+ *
+ * @return SUCCESS once the target was written, FAILURE if the patch is truncated, or the error of feeding
+ */
+IoT_Error_t aws_iot_delta_patch_finish(DeltaPatch_t *pPatch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_DELTA_PATCH_H_ */
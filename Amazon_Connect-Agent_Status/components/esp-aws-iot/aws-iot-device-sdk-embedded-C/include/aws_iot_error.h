@@ -38,6 +38,8 @@ extern "C" {
  * Values greater than 0 are specific non-error return codes
  */
 typedef enum {
+	/** Returned when a blocking wait on the network was interrupted by an application wake-up request */
+			NETWORK_WAKEUP_REQUESTED = 7,
 	/** Returned when the Network physical layer is connected */
 			NETWORK_PHYSICAL_LAYER_CONNECTED = 6,
 	/** Returned when the Network is manually disconnected */
@@ -156,7 +158,11 @@ typedef enum {
 	/** Some limit has been exceeded, e.g. the maximum number of subscriptions has been reached */
 			LIMIT_EXCEEDED_ERROR = -51,
 	/** Invalid input topic type */
-			INVALID_TOPIC_TYPE_ERROR = -52
+			INVALID_TOPIC_TYPE_ERROR = -52,
+	/** The requested key is not in the JSON document */
+			JSON_KEY_NOT_FOUND_ERROR = -53,
+	/** The server refused one or more topic filters of a subscribe request */
+			MQTT_SUBSCRIBE_REJECTED_ERROR = -54
 } IoT_Error_t;
 
 #ifdef __cplusplus
@@ -64,6 +64,11 @@ extern "C" {
 /** Greatest packet identifier, per MQTT spec */
 #define MAX_PACKET_ID 65535
 
+#ifndef AWS_IOT_MQTT_NUM_UNACKED_PUBLISHES
+/** Number of unacknowledged QoS1 publishes kept for redelivery in a persistent session, 0 to disable */
+#define AWS_IOT_MQTT_NUM_UNACKED_PUBLISHES 0
+#endif
+
 typedef struct _Client AWS_IoT_Client;
 
 /**
@@ -243,6 +248,22 @@ typedef struct _MessageHandlers {
 	void *pApplicationHandlerData; ///< Context to pass to application handler
 } MessageHandlers;   /* Message handlers are indexed by subscription topic */
 
+/**
+ * @brief Subscribe Topic Parameters
+ *
+ * Defines one entry of a batch subscription request.
+ * Used by aws_iot_mqtt_subscribe_batch
+ *
+ */
+typedef struct {
+	const char *pTopicName; ///< Topic filter to subscribe to, must stay valid for the lifetime of the subscription
+	uint16_t topicNameLen; ///< Length of the topic filter
+	QoS qos; ///< Requested QoS of the subscription
+	pApplicationHandler_t pApplicationHandler; ///< Application function to invoke
+	void *pApplicationHandlerData; ///< Context to pass to application handler
+	bool isRejected; ///< Set by aws_iot_mqtt_subscribe_batch when the SUBACK refused this topic filter
+} IoT_Subscribe_Topic_Params;
+
 /**
  * @brief MQTT Client Status
  *
@@ -254,8 +275,42 @@ typedef struct _ClientStatus {
 	ClientState clientState; ///< The current state of the client's state machine
 	bool isPingOutstanding; ///< Whether this client is waiting for a ping response
 	bool isAutoReconnectEnabled; ///< Whether auto-reconnect is enabled for this client
+	bool isSessionPresent; ///< Whether the server resumed a previous session on the last connect
 } ClientStatus;
 
+#if AWS_IOT_MQTT_NUM_UNACKED_PUBLISHES > 0
+/**
+ * @brief Unacknowledged QoS1 publish
+ *
+ * Copy of a serialized QoS1 PUBLISH packet that has not been acknowledged by a PUBACK yet.
+ * Used to redeliver the message when a persistent session is resumed.
+ *
+ */
+typedef struct _UnackedPublish {
+	uint16_t packetId; ///< Packet identifier of the PUBLISH
+	uint32_t packetLen; ///< Length of the serialized packet
+	unsigned char packet[AWS_IOT_MQTT_TX_BUF_LEN]; ///< Serialized PUBLISH packet
+} UnackedPublish;
+#endif
+
+/**
+ * @brief Connection metrics
+ *
+ * Where the time of the last connect and the last automatic reconnect went.
+ * Phases the network layer cannot measure are reported as 0.
+ *
+ */
+typedef struct {
+	uint32_t dnsLookupMs; ///< Host name resolution of the last successful connect
+	uint32_t tcpConnectMs; ///< TCP connection setup of the last successful connect
+	uint32_t tlsHandshakeMs; ///< TLS handshake of the last successful connect
+	uint32_t connackMs; ///< Time from sending CONNECT until the CONNACK was received
+	uint32_t resubscribeMs; ///< Time spent resubscribing after the last reconnect, 0 if the session was resumed
+	uint32_t lastOutageMs; ///< Time from detecting the last disconnect until reconnected and resubscribed
+	uint32_t lastOutageAttempts; ///< Reconnect attempts, including resubscribe retries, needed to recover from the last disconnect
+	uint32_t reconnectCount; ///< Successful automatic reconnects since the client was initialized
+} IoT_Connection_Metrics;
+
 /**
  * @brief MQTT Client Data
  *
@@ -271,7 +326,10 @@ typedef struct _ClientData {
 	uint32_t commandTimeoutMs; ///< Timeout for processing outgoing MQTT packets
 	uint16_t keepAliveInterval; ///< Maximum interval between control packets
 	uint32_t currentReconnectWaitInterval; ///< Current backoff period for reconnect
+	uint32_t reconnectAttemptCount; ///< Reconnect attempts made since the disconnect was detected
+	uint32_t backoffRandomState; ///< State of the random generator that jitters the reconnect backoff
 	uint32_t counterNetworkDisconnected; ///< How many times this client detected a disconnection
+	IoT_Connection_Metrics connectionMetrics; ///< Phase timing of the last connect and reconnect
 
 	/* The below values are initialized with the
 	 * lengths of the TX/RX buffers and never modified
@@ -294,6 +352,11 @@ typedef struct _ClientData {
 	MessageHandlers messageHandlers[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS]; ///< Callbacks for incoming messages
 	iot_disconnect_handler disconnectHandler; ///< Callback when a disconnection is detected
 	void *disconnectHandlerData; ///< Context for disconnect handler
+
+#if AWS_IOT_MQTT_NUM_UNACKED_PUBLISHES > 0
+	uint32_t unackedPublishCount; ///< Number of entries in use in unackedPublishes
+	UnackedPublish unackedPublishes[AWS_IOT_MQTT_NUM_UNACKED_PUBLISHES]; ///< QoS1 publishes awaiting a PUBACK, oldest first
+#endif
 } ClientData;
 
 /**
@@ -306,6 +369,8 @@ struct _Client {
 	Timer pingReqTimer;		///< Timer to keep track of when to send next PINGREQ
 	Timer pingRespTimer;	///< Timer to ensure that PINGRESP is received timely
 	Timer reconnectDelayTimer; ///< Timer for backoff on reconnect
+	Timer outageStopwatch; ///< Measures the time from disconnect detection until reconnected
+	Timer resubscribeStopwatch; ///< Measures the time spent resubscribing after a reconnect
 
 	ClientStatus clientStatus; ///< Client state information
 	ClientData clientData; ///< Client context
@@ -322,6 +387,9 @@ struct _Client {
  * @functionpage{aws_iot_mqtt_autoreconnect_set_status,mqtt,autoreconnect_set_status}
  * @functionpage{aws_iot_mqtt_get_network_disconnected_count,mqtt,get_network_disconnected_count}
  * @functionpage{aws_iot_mqtt_reset_network_disconnected_count,mqtt,reset_network_disconnected_count}
+ * @functionpage{aws_iot_mqtt_is_session_present,mqtt,is_session_present}
+ * @functionpage{aws_iot_mqtt_get_unacked_publish_count,mqtt,get_unacked_publish_count}
+ * @functionpage{aws_iot_mqtt_get_connection_metrics,mqtt,get_connection_metrics}
  */
 
 /**
@@ -484,6 +552,55 @@ uint32_t aws_iot_mqtt_get_network_disconnected_count(AWS_IoT_Client *pClient);
 void aws_iot_mqtt_reset_network_disconnected_count(AWS_IoT_Client *pClient);
 /* @[declare_mqtt_reset_network_disconnected_count] */
 
+/**
+ * @brief Determine if the server resumed a previous session on the last connect.
+ *
+ * Only a connection with `isCleanSession` set to false can resume a session. When the
+ * session was resumed, the server still holds the client's subscriptions, so they are
+ * not sent again after a reconnect, and unacknowledged QoS1 publishes are redelivered.
+ *
+ * @param[in] pClient MQTT client context
+ *
+ * @return true if the session present flag was set in the last CONNACK; false otherwise.
+ */
+/* @[declare_mqtt_is_session_present] */
+bool aws_iot_mqtt_is_session_present(AWS_IoT_Client *pClient);
+/* @[declare_mqtt_is_session_present] */
+
+/**
+ * @brief Get the number of QoS1 publishes waiting for a PUBACK.
+ *
+ * In a persistent session, a QoS1 publish is kept by the client until its PUBACK
+ * arrives and is redelivered when the session is resumed after a reconnect. At most
+ * `AWS_IOT_MQTT_NUM_UNACKED_PUBLISHES` publishes are kept; the oldest is dropped when
+ * the table is full.
+ *
+ * @param[in] pClient MQTT client context
+ *
+ * @return Number of publishes kept for redelivery. Always 0 for clean sessions and a NULL client.
+ */
+/* @[declare_mqtt_get_unacked_publish_count] */
+uint32_t aws_iot_mqtt_get_unacked_publish_count(AWS_IoT_Client *pClient);
+/* @[declare_mqtt_get_unacked_publish_count] */
+
+/**
+ * @brief Get the phase timing of the last connect and reconnect.
+ *
+ * Breaks the time of the last successful connect down into DNS lookup, TCP connect,
+ * TLS handshake and CONNACK, and reports how long the last automatic reconnect took
+ * in total, how many attempts it needed and how long resubscribing took.
+ *
+ * @param[in] pClient MQTT client context
+ * @param[out] pMetrics Receives a copy of the metrics
+ *
+ * @return `SUCCESS` or `NULL_VALUE_ERROR`
+ *
+ * @warning Do not call this function if @ref mqtt_function_yield is in progress.
+ */
+/* @[declare_mqtt_get_connection_metrics] */
+IoT_Error_t aws_iot_mqtt_get_connection_metrics(AWS_IoT_Client *pClient, IoT_Connection_Metrics *pMetrics);
+/* @[declare_mqtt_get_connection_metrics] */
+
 #ifdef __cplusplus
 }
 #endif
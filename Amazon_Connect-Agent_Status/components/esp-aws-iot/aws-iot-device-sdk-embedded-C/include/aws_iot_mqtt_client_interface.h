@@ -65,12 +65,15 @@ extern "C" {
  * - @functionname{mqtt_function_init}
  * - @functionname{mqtt_function_free}
  * - @functionname{mqtt_function_connect}
+ * - @functionname{mqtt_function_connect_with_backoff}
  * - @functionname{mqtt_function_publish}
  * - @functionname{mqtt_function_subscribe}
+ * - @functionname{mqtt_function_subscribe_batch}
  * - @functionname{mqtt_function_resubscribe}
  * - @functionname{mqtt_function_unsubscribe}
  * - @functionname{mqtt_function_disconnect}
  * - @functionname{mqtt_function_yield}
+ * - @functionname{mqtt_function_yield_wakeup}
  * - @functionname{mqtt_function_attempt_reconnect}
  * - @functionname{mqtt_function_get_next_packet_id}
  * - @functionname{mqtt_function_set_connect_params}
@@ -81,18 +84,24 @@ extern "C" {
  * - @functionname{mqtt_function_autoreconnect_set_status}
  * - @functionname{mqtt_function_get_network_disconnected_count}
  * - @functionname{mqtt_function_reset_network_disconnected_count}
+ * - @functionname{mqtt_function_is_session_present}
+ * - @functionname{mqtt_function_get_unacked_publish_count}
+ * - @functionname{mqtt_function_get_connection_metrics}
  */
 
 /**
  * @functionpage{aws_iot_mqtt_init,mqtt,init}
  * @functionpage{aws_iot_mqtt_free,mqtt,free}
  * @functionpage{aws_iot_mqtt_connect,mqtt,connect}
+ * @functionpage{aws_iot_mqtt_connect_with_backoff,mqtt,connect_with_backoff}
  * @functionpage{aws_iot_mqtt_publish,mqtt,publish}
  * @functionpage{aws_iot_mqtt_subscribe,mqtt,subscribe}
+ * @functionpage{aws_iot_mqtt_subscribe_batch,mqtt,subscribe_batch}
  * @functionpage{aws_iot_mqtt_resubscribe,mqtt,resubscribe}
  * @functionpage{aws_iot_mqtt_unsubscribe,mqtt,unsubscribe}
  * @functionpage{aws_iot_mqtt_disconnect,mqtt,disconnect}
  * @functionpage{aws_iot_mqtt_yield,mqtt,yield}
+ * @functionpage{aws_iot_mqtt_yield_wakeup,mqtt,yield_wakeup}
  * @functionpage{aws_iot_mqtt_attempt_reconnect,mqtt,attempt_reconnect}
  */
 
@@ -143,6 +152,27 @@ IoT_Error_t aws_iot_mqtt_free( AWS_IoT_Client *pClient );
 IoT_Error_t aws_iot_mqtt_connect(AWS_IoT_Client *pClient, const IoT_Client_Connect_Params *pConnectParams);
 /* @[declare_mqtt_connect] */
 
+/**
+ * @brief Establish a connection with an MQTT server, retrying until it succeeds.
+ *
+ * Calls @ref mqtt_function_connect and, while it fails, waits before the next attempt
+ * with the same jittered backoff that @ref mqtt_autoreconnect uses. Use this instead of
+ * a fixed-delay retry loop so that many devices coming back after a broker or network
+ * outage do not reconnect in lockstep.
+ *
+ * @param[in] pClient MQTT client context
+ * @param[in] pConnectParams MQTT connection parameters
+ * @param[in] maxAttempts Number of connect attempts before giving up, 0 to retry until connected
+ *
+ * @return `SUCCESS`, or the error of the last connect attempt
+ *
+ * @note This function blocks the calling task between attempts.
+ */
+/* @[declare_mqtt_connect_with_backoff] */
+IoT_Error_t aws_iot_mqtt_connect_with_backoff(AWS_IoT_Client *pClient, const IoT_Client_Connect_Params *pConnectParams,
+											  uint32_t maxAttempts);
+/* @[declare_mqtt_connect_with_backoff] */
+
 /**
  * @brief Publish an MQTT message to a topic.
  *
@@ -195,6 +225,33 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
 								   QoS qos, pApplicationHandler_t pApplicationHandler, void *pApplicationHandlerData);
 /* @[declare_mqtt_subscribe] */
 
+/**
+ * @brief Subscribe to several MQTT topics at once.
+ *
+ * This function registers the same subscriptions as calling @ref mqtt_function_subscribe
+ * once per entry of `pTopicList`, but packs the topic filters into as few MQTT SUBSCRIBE
+ * packets as the client TX buffer allows, so that only one SUBACK round trip is needed
+ * per packet instead of one per topic.
+ *
+ * @param[in] pClient MQTT client context
+ * @param[in] pTopicList Topics to subscribe to
+ * @param[in] topicCount Number of entries in `pTopicList`
+ *
+ * @return `IoT_Error_t`: See `aws_iot_error.h`. `MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR` is
+ * returned without sending anything if fewer than `topicCount` subscription slots are free.
+ * If a later packet fails, the subscriptions acknowledged by earlier packets are kept.
+ * `MQTT_SUBSCRIBE_REJECTED_ERROR` is returned if the server refused some topic filters;
+ * those entries have `isRejected` set and no handler, the other entries are subscribed.
+ *
+ * @attention The topic names in `pTopicList` are not copied. They must remain valid for the duration
+ * of the subscription (until @ref mqtt_function_unsubscribe) is called. The list itself
+ * may be freed after the call returns.
+ */
+/* @[declare_mqtt_subscribe_batch] */
+IoT_Error_t aws_iot_mqtt_subscribe_batch(AWS_IoT_Client *pClient, IoT_Subscribe_Topic_Params *pTopicList,
+										 uint32_t topicCount);
+/* @[declare_mqtt_subscribe_batch] */
+
 /**
  * @brief Resubscribe to topic filter subscriptions in a previous MQTT session.
  *
@@ -205,6 +262,9 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
  * @note This function does not need to be called after @ref mqtt_function_attempt_reconnect
  * or if auto-reconnect is enabled.
  *
+ * @note If the server resumed a persistent session (see @ref mqtt_function_is_session_present),
+ * the subscriptions still exist on the server and nothing is sent.
+ *
  * @param[in] pClient MQTT client context
  *
  * @return `IoT_Error_t`: See `aws_iot_error.h`
@@ -264,9 +324,14 @@ IoT_Error_t aws_iot_mqtt_disconnect(AWS_IoT_Client *pClient);
  * - @ref mqtt_autoreconnect (if enabled) <br>
  * If the client detects a disconnect, the reconnection will be performed in this function.
  *
+ * If the network stack provides `waitForReadable`, the client sleeps on the socket
+ * between events instead of polling it. It wakes up when data arrives, when the next
+ * keep-alive deadline is reached or when @ref mqtt_function_yield_wakeup is called.
+ *
  * @param[in] pClient MQTT client context
  * @param[in] timeout_ms Amount of time to yield. This function will return to the caller
- * after AT LEAST this amount of thime has passed.
+ * after AT LEAST this amount of thime has passed, unless woken up early by
+ * @ref mqtt_function_yield_wakeup.
  *
  * @return `IoT_Error_t`: See `aws_iot_error.h`
  * @return If this call results a negative value, assume the MQTT connection has dropped.
@@ -277,6 +342,22 @@ IoT_Error_t aws_iot_mqtt_disconnect(AWS_IoT_Client *pClient);
 IoT_Error_t aws_iot_mqtt_yield(AWS_IoT_Client *pClient, uint32_t timeout_ms);
 /* @[declare_mqtt_yield] */
 
+/**
+ * @brief Make a blocked yield return to its caller.
+ *
+ * Can be called from any task, e.g. after queueing work that the yielding task should
+ * act on. A yield currently sleeping on the socket returns SUCCESS right away. If no yield
+ * is in progress, the next one returns after servicing at most one event.
+ *
+ * @param[in] pClient MQTT client context
+ *
+ * @return `IoT_Error_t`: See `aws_iot_error.h`
+ * @return `FAILURE` if the network stack does not support waking up a yield.
+ */
+/* @[declare_mqtt_yield_wakeup] */
+IoT_Error_t aws_iot_mqtt_yield_wakeup(AWS_IoT_Client *pClient);
+/* @[declare_mqtt_yield_wakeup] */
+
 /**
  * @brief Attempt to reconnect with the MQTT server.
  *
@@ -291,8 +372,8 @@ IoT_Error_t aws_iot_mqtt_yield(AWS_IoT_Client *pClient, uint32_t timeout_ms);
  * @return `IoT_Error_t`: See `aws_iot_error.h`
  *
  * @note Generally, it is not necessary to call this function if @ref mqtt_autoreconnect
- * is enabled. This function may still be called to initiate a reconnect attempt when
- * auto-reconnect has exhausted all attempts.
+ * is enabled. This function may still be called to reconnect right away instead of
+ * waiting for the next auto-reconnect attempt.
  */
 /* @[declare_mqtt_attempt_reconnect] */
 IoT_Error_t aws_iot_mqtt_attempt_reconnect(AWS_IoT_Client *pClient);
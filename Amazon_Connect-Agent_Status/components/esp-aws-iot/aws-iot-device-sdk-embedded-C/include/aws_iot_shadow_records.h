@@ -48,6 +48,12 @@ void HandleExpiredResponseCallbacks(void);
 void initDeltaTokens(void);
 IoT_Error_t registerJsonTokenOnDelta(jsonStruct_t *pStruct);
 
+/* Delta key index without the delta topic subscription, and its single pass dispatcher
+ * over the document last parsed by isJsonValidAndParse(). A registered key either names
+ * a key at any depth, as before, or is a dotted path below the "state" object. */
+IoT_Error_t indexJsonTokenOnDelta(jsonStruct_t *pStruct);
+void dispatchDeltaTokens(const char *pJsonDocument, int32_t tokenCount);
+
 #ifdef __cplusplus
 }
 #endif
@@ -102,6 +102,8 @@ IoT_Error_t iot_tls_init(Network *pNetwork, char *pRootCALocation, char *pDevice
 	pNetwork->disconnect = iot_tls_disconnect;
 	pNetwork->isConnected = iot_tls_is_connected;
 	pNetwork->destroy = iot_tls_destroy;
+	pNetwork->waitForReadable = NULL;
+	pNetwork->wakeup = NULL;
 
 	pNetwork->tlsDataParams.flags = 0;
 
@@ -0,0 +1,867 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_jobs_executor.c
+ * @brief Pulls jobs, runs their steps and reports their progress and outcome
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aws_iot_jobs_executor.h"
+
+#include <string.h>
+#include <stdio.h>
+
+#include "aws_iot_log.h"
+
+#if JOBS_EXECUTOR_MAX_STEPS > 255
+#error "JOBS_EXECUTOR_MAX_STEPS must not be more than 255"
+#endif
+
+#define JOBS_EXECUTOR_FILTER_COUNT 3
+#define JOBS_EXECUTOR_FINAL_RETRIES 3 ///< Times the outcome of a job is sent before giving up on a response
+
+#define JOBS_STEPS_PATH "execution.jobDocument.steps"
+#define JOBS_STEP_TIMEOUT_KEY "timeoutSec"
+
+const JobsExecutorParams_t jobsExecutorParamsDefault = JobsExecutorParams_initializer;
+
+/* What a start-next response or notify-next message says about the next job */
+typedef struct {
+	JobsExecutor_t *pExecutor;
+	bool loadSteps; ///< Set the executor's steps up from the job document
+	bool hasExecution;
+	bool hasJobId;
+	char jobId[MAX_SIZE_OF_JOB_ID];
+	int64_t executionNumber;
+	char clientToken[sizeof(((JobsExecutor_t *) 0)->requestToken)];
+	bool isJobEnded; ///< Rejected because the job execution is terminal or no longer exists
+	uint16_t stepsDepth; ///< Depth of the steps array, 0 outside of it
+	bool isInGroup; ///< In an array of steps running in parallel
+	bool isGroupEmpty;
+	JobsStep_t *pStep; ///< Step whose object is being read
+	uint16_t stepDepth; ///< Depth of that step's object
+	uint32_t paramsPathLength; ///< Path length of the step's handler member
+	const char *pError; ///< Why the document cannot be run
+} JobsDocumentVisit_t;
+
+/* Steps are shared with worker tasks and with tasks completing them */
+static uint8_t loadStepState(const JobsStep_t *pStep) {
+	return __atomic_load_n(&pStep->state, __ATOMIC_ACQUIRE);
+}
+
+static void storeStepState(JobsStep_t *pStep, JobsStepState_t state) {
+	__atomic_store_n(&pStep->state, (uint8_t) state, __ATOMIC_RELEASE);
+}
+
+static bool changeStepState(JobsStep_t *pStep, JobsStepState_t from, JobsStepState_t to) {
+	uint8_t expected = (uint8_t) from;
+
+	return __atomic_compare_exchange_n(&pStep->state, &expected, (uint8_t) to, false, __ATOMIC_ACQ_REL,
+									   __ATOMIC_ACQUIRE);
+}
+
+static bool isStepInWorker(const JobsStep_t *pStep) {
+	return __atomic_load_n(&pStep->isInWorker, __ATOMIC_ACQUIRE);
+}
+
+static void markProgressDirty(JobsExecutor_t *pExecutor) {
+	__atomic_store_n(&pExecutor->isProgressDirty, true, __ATOMIC_RELEASE);
+}
+
+static bool parseUnsigned(const char *pText, uint32_t length, int64_t max, int64_t *pValue) {
+	int64_t value = 0;
+	uint32_t i;
+
+	if(0 == length) {
+		return false;
+	}
+	for(i = 0; i < length; i++) {
+		if(pText[i] < '0' || pText[i] > '9') {
+			return false;
+		}
+		value = value * 10 + (pText[i] - '0');
+		if(value > max) {
+			return false;
+		}
+	}
+	*pValue = value;
+	return true;
+}
+
+static bool isEventKey(const JsonStreamEvent_t *pEvent, const char *pKey) {
+	return NULL != pEvent->pKey && strlen(pKey) == pEvent->keyLength
+		   && 0 == strncmp(pEvent->pKey, pKey, pEvent->keyLength);
+}
+
+static bool isEventPath(const JsonStreamEvent_t *pEvent, const char *pPath) {
+	return NULL != pEvent->pPath && 0 == strcmp(pEvent->pPath, pPath);
+}
+
+/* Rejection codes of an update that mean the service ended the job, the others are transient or about the request */
+static bool isJobEndedCode(const char *pCode, uint32_t codeLength) {
+	static const char *const endedCodes[] = {"TerminalStateReached", "ResourceNotFound", "InvalidStateTransition"};
+	uint8_t i;
+
+	for(i = 0; i < sizeof(endedCodes) / sizeof(endedCodes[0]); i++) {
+		if(strlen(endedCodes[i]) == codeLength && 0 == strncmp(endedCodes[i], pCode, codeLength)) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static const JobsStepHandler_t *findHandler(JobsExecutor_t *pExecutor, const char *pName, uint32_t nameLength) {
+	uint8_t i;
+
+	for(i = 0; i < pExecutor->handlerCount; i++) {
+		if(strlen(pExecutor->pHandlers[i]->pName) == nameLength
+		   && 0 == strncmp(pExecutor->pHandlers[i]->pName, pName, nameLength)) {
+			return pExecutor->pHandlers[i];
+		}
+	}
+	return NULL;
+}
+
+static void startDocumentStep(JobsDocumentVisit_t *pVisit, uint16_t depth) {
+	JobsExecutor_t *pExecutor = pVisit->pExecutor;
+	JobsStep_t *pStep;
+
+	if(pExecutor->stepCount >= JOBS_EXECUTOR_MAX_STEPS) {
+		pVisit->pError = "too many steps";
+		return;
+	}
+
+	pStep = &pExecutor->steps[pExecutor->stepCount++];
+	pStep->pHandler = NULL;
+	pStep->pExecutor = pExecutor;
+	pStep->group = (uint8_t) (pExecutor->groupCount - 1);
+	storeStepState(pStep, JOBS_STEP_PENDING);
+	pStep->progress = 0;
+	pStep->isInWorker = false;
+	pStep->isTimedOut = false;
+	pStep->timeoutMs = pExecutor->params.defaultStepTimeoutMs;
+	init_timer(&pStep->timer);
+	pVisit->pStep = pStep;
+	pVisit->stepDepth = depth;
+}
+
+/* A member of a step's object: its handler with the parameters, or its timeout */
+static void visitStepMember(JobsDocumentVisit_t *pVisit, const JsonStreamEvent_t *pEvent) {
+	JobsStep_t *pStep = pVisit->pStep;
+	const JobsStepHandler_t *pHandler;
+	int64_t timeoutSec;
+
+	if(isEventKey(pEvent, JOBS_STEP_TIMEOUT_KEY)) {
+		if(JSON_STREAM_NUMBER != pEvent->type
+		   || !parseUnsigned(pEvent->pValue, pEvent->valueLength, UINT32_MAX / 1000, &timeoutSec)) {
+			pVisit->pError = "invalid timeout";
+			return;
+		}
+		pStep->timeoutMs = (uint32_t) timeoutSec * 1000;
+		return;
+	}
+
+	if(JSON_STREAM_OBJECT_END == pEvent->type || JSON_STREAM_ARRAY_END == pEvent->type) {
+		/* End of the handler's parameters */
+		if(NULL != pStep->pHandler->param && SUCCESS != pStep->pHandler->param(pStep, pEvent, "")) {
+			pVisit->pError = "invalid parameters";
+		}
+		return;
+	}
+
+	if(NULL != pStep->pHandler) {
+		pVisit->pError = "more than one handler in a step";
+		return;
+	}
+	if(NULL == pEvent->pKey) {
+		pVisit->pError = "path too long";
+		return;
+	}
+	pHandler = findHandler(pVisit->pExecutor, pEvent->pKey, pEvent->keyLength);
+	if(NULL == pHandler) {
+		pVisit->pError = "unknown handler";
+		return;
+	}
+
+	pStep->pHandler = pHandler;
+	memset(&pStep->data, 0, sizeof(pStep->data));
+	pVisit->paramsPathLength = pEvent->pathLength;
+	if(NULL != pHandler->param && SUCCESS != pHandler->param(pStep, pEvent, "")) {
+		pVisit->pError = "invalid parameters";
+	}
+}
+
+/* Events inside the steps array */
+static void visitSteps(JobsDocumentVisit_t *pVisit, const JsonStreamEvent_t *pEvent) {
+	JobsExecutor_t *pExecutor = pVisit->pExecutor;
+	uint16_t stepDepth = (uint16_t) (pVisit->stepsDepth + (pVisit->isInGroup ? 2 : 1));
+	const char *pParamPath;
+
+	if(NULL != pVisit->pStep && pEvent->depth > pVisit->stepDepth) {
+		if(pEvent->depth == pVisit->stepDepth + 1) {
+			visitStepMember(pVisit, pEvent);
+			return;
+		}
+		/* Below the handler's member, which set the handler or failed the document when it started */
+		if(NULL == pVisit->pStep->pHandler->param) {
+			return;
+		}
+		pParamPath = (NULL == pEvent->pPath) ? NULL : pEvent->pPath + pVisit->paramsPathLength + 1;
+		if(SUCCESS != pVisit->pStep->pHandler->param(pVisit->pStep, pEvent, pParamPath)) {
+			pVisit->pError = "invalid parameters";
+		}
+		return;
+	}
+
+	if(pEvent->depth == stepDepth && JSON_STREAM_OBJECT_START == pEvent->type) {
+		if(!pVisit->isInGroup) {
+			pExecutor->groupCount++;
+		}
+		pVisit->isGroupEmpty = false;
+		startDocumentStep(pVisit, pEvent->depth);
+	} else if(pEvent->depth == stepDepth && JSON_STREAM_OBJECT_END == pEvent->type) {
+		if(NULL == pVisit->pStep->pHandler) {
+			pVisit->pError = "step without handler";
+		}
+		pVisit->pStep = NULL;
+	} else if(!pVisit->isInGroup && pEvent->depth == stepDepth && JSON_STREAM_ARRAY_START == pEvent->type) {
+		pExecutor->groupCount++;
+		pVisit->isInGroup = true;
+		pVisit->isGroupEmpty = true;
+	} else if(pVisit->isInGroup && pEvent->depth == stepDepth - 1 && JSON_STREAM_ARRAY_END == pEvent->type) {
+		if(pVisit->isGroupEmpty) {
+			pVisit->pError = "empty group";
+		}
+		pVisit->isInGroup = false;
+	} else {
+		pVisit->pError = "step is not an object";
+	}
+}
+
+static void jobDocumentVisitor(const JsonStreamEvent_t *pEvent, void *pContext) {
+	JobsDocumentVisit_t *pVisit = (JobsDocumentVisit_t *) pContext;
+
+	if(NULL != pVisit->pError) {
+		return;
+	}
+
+	if(pVisit->stepsDepth > 0 && pEvent->depth > pVisit->stepsDepth) {
+		visitSteps(pVisit, pEvent);
+		return;
+	}
+
+	if(1 == pEvent->depth && JSON_STREAM_STRING == pEvent->type && isEventKey(pEvent, "clientToken")) {
+		if(pEvent->valueLength < sizeof(pVisit->clientToken)) {
+			memcpy(pVisit->clientToken, pEvent->pValue, pEvent->valueLength);
+			pVisit->clientToken[pEvent->valueLength] = '\0';
+		}
+	} else if(1 == pEvent->depth && JSON_STREAM_STRING == pEvent->type && isEventKey(pEvent, "code")) {
+		pVisit->isJobEnded = isJobEndedCode(pEvent->pValue, pEvent->valueLength);
+	} else if(1 == pEvent->depth && JSON_STREAM_OBJECT_START == pEvent->type && isEventKey(pEvent, "execution")) {
+		pVisit->hasExecution = true;
+	} else if(2 == pEvent->depth && JSON_STREAM_STRING == pEvent->type && isEventPath(pEvent, "execution.jobId")) {
+		if(pEvent->valueLength > 0 && pEvent->valueLength < MAX_SIZE_OF_JOB_ID) {
+			memcpy(pVisit->jobId, pEvent->pValue, pEvent->valueLength);
+			pVisit->jobId[pEvent->valueLength] = '\0';
+			pVisit->hasJobId = true;
+		}
+	} else if(2 == pEvent->depth && JSON_STREAM_NUMBER == pEvent->type
+			  && isEventPath(pEvent, "execution.executionNumber")) {
+		parseUnsigned(pEvent->pValue, pEvent->valueLength, UINT32_MAX, &pVisit->executionNumber);
+	} else if(pVisit->loadSteps && 3 == pEvent->depth && isEventPath(pEvent, JOBS_STEPS_PATH)) {
+		if(JSON_STREAM_ARRAY_START == pEvent->type) {
+			pVisit->stepsDepth = pEvent->depth;
+		} else if(JSON_STREAM_ARRAY_END == pEvent->type) {
+			pVisit->stepsDepth = 0;
+		} else {
+			pVisit->pError = "steps is not an array";
+		}
+	}
+}
+
+static IoT_Error_t visitJobDocument(JobsExecutor_t *pExecutor, const char *pPayload, size_t payloadLen,
+									bool loadSteps, JobsDocumentVisit_t *pVisit) {
+	JsonStreamParser_t parser;
+	IoT_Error_t rc;
+
+	memset(pVisit, 0, sizeof(JobsDocumentVisit_t));
+	pVisit->pExecutor = pExecutor;
+	pVisit->loadSteps = loadSteps;
+	if(loadSteps) {
+		pExecutor->stepCount = 0;
+		pExecutor->groupCount = 0;
+	}
+
+	/* A terminating null character, if the sender added one, ends the document */
+	aws_iot_json_stream_init(&parser, jobDocumentVisitor, pVisit);
+	rc = aws_iot_json_stream_feed(&parser, pPayload, strnlen(pPayload, payloadLen));
+	if(SUCCESS == rc) {
+		rc = aws_iot_json_stream_finish(&parser);
+	}
+	return rc;
+}
+
+static void nextRequestToken(JobsExecutor_t *pExecutor) {
+	pExecutor->tokenSequence++;
+	snprintf(pExecutor->requestToken, sizeof(pExecutor->requestToken), "%s-%lu", pExecutor->thingName,
+			 (unsigned long) pExecutor->tokenSequence);
+}
+
+static void expectResponse(JobsExecutor_t *pExecutor) {
+	pExecutor->isRequestInFlight = true;
+	countdown_ms(&pExecutor->responseTimer, pExecutor->params.responseTimeoutMs);
+}
+
+/* The response timer doubles as the delay before retrying start-next, which a response ends */
+static void responseReceived(JobsExecutor_t *pExecutor) {
+	pExecutor->isRequestInFlight = false;
+	init_timer(&pExecutor->responseTimer);
+}
+
+static IoT_Error_t sendStartNext(JobsExecutor_t *pExecutor) {
+	AwsIotStartNextPendingJobExecutionRequest request;
+	IoT_Error_t rc;
+
+	nextRequestToken(pExecutor);
+	request.statusDetails = NULL;
+	request.clientToken = pExecutor->requestToken;
+
+	rc = aws_iot_jobs_start_next(pExecutor->pClient, QOS0, pExecutor->thingName, &request, pExecutor->publishTopic,
+								 sizeof(pExecutor->publishTopic), pExecutor->message, sizeof(pExecutor->message));
+	if(SUCCESS == rc) {
+		expectResponse(pExecutor);
+	}
+	return rc;
+}
+
+/* Percent of the job done, running steps counting with the progress they reported */
+static uint8_t jobProgress(JobsExecutor_t *pExecutor) {
+	uint32_t total = 0;
+	uint8_t i;
+
+	if(0 == pExecutor->stepCount) {
+		return 0;
+	}
+	for(i = 0; i < pExecutor->stepCount; i++) {
+		uint8_t state = loadStepState(&pExecutor->steps[i]);
+
+		if(JOBS_STEP_SUCCEEDED == state) {
+			total += 100;
+		} else if(JOBS_STEP_RUNNING == state) {
+			total += __atomic_load_n(&pExecutor->steps[i].progress, __ATOMIC_RELAXED);
+		}
+	}
+	return (uint8_t) (total / pExecutor->stepCount);
+}
+
+static IoT_Error_t sendUpdate(JobsExecutor_t *pExecutor, JobExecutionStatus status) {
+	AwsIotJobExecutionUpdateRequest request;
+	IoT_Error_t rc;
+
+	/* statusDetails is a map of strings */
+	if(JOB_EXECUTION_IN_PROGRESS == status) {
+		snprintf(pExecutor->statusDetails, sizeof(pExecutor->statusDetails), "{\"group\":\"%u/%u\",\"progress\":\"%u\"}",
+				 (unsigned) pExecutor->currentGroup + 1, (unsigned) pExecutor->groupCount,
+				 (unsigned) jobProgress(pExecutor));
+	} else if(pExecutor->failedStep >= 0) {
+		snprintf(pExecutor->statusDetails, sizeof(pExecutor->statusDetails), "{\"failedStep\":\"%d\",\"reason\":\"%s\"}",
+				 pExecutor->failedStep, pExecutor->pFailureReason);
+	} else if(NULL != pExecutor->pFailureReason) {
+		snprintf(pExecutor->statusDetails, sizeof(pExecutor->statusDetails), "{\"reason\":\"%s\"}",
+				 pExecutor->pFailureReason);
+	} else {
+		snprintf(pExecutor->statusDetails, sizeof(pExecutor->statusDetails), "{\"steps\":\"%u\"}",
+				 (unsigned) pExecutor->stepCount);
+	}
+
+	nextRequestToken(pExecutor);
+	request.expectedVersion = 0;
+	request.executionNumber = pExecutor->executionNumber;
+	request.status = status;
+	request.statusDetails = pExecutor->statusDetails;
+	request.includeJobExecutionState = false;
+	request.includeJobDocument = false;
+	request.clientToken = pExecutor->requestToken;
+
+	rc = aws_iot_jobs_send_update(pExecutor->pClient, QOS0, pExecutor->thingName, pExecutor->jobId, &request,
+								  pExecutor->publishTopic, sizeof(pExecutor->publishTopic), pExecutor->message,
+								  sizeof(pExecutor->message));
+	if(SUCCESS == rc) {
+		expectResponse(pExecutor);
+	}
+	return rc;
+}
+
+static void completeStep(JobsStep_t *pStep, JobsStepState_t result) {
+	if(changeStepState(pStep, JOBS_STEP_RUNNING, result)) {
+		markProgressDirty(pStep->pExecutor);
+	}
+}
+
+static void runStepHandler(JobsStep_t *pStep) {
+	JobsStepState_t result = pStep->pHandler->run(pStep);
+
+	if(JOBS_STEP_SUCCEEDED == result || JOBS_STEP_FAILED == result) {
+		completeStep(pStep, result);
+	}
+}
+
+static void startStep(JobsExecutor_t *pExecutor, JobsStep_t *pStep) {
+	countdown_ms(&pStep->timer, pStep->timeoutMs);
+	markProgressDirty(pExecutor);
+
+	if(pStep->pHandler->runInWorker && NULL != pExecutor->params.dispatch) {
+		storeStepState(pStep, JOBS_STEP_QUEUED);
+		__atomic_store_n(&pStep->isInWorker, true, __ATOMIC_RELEASE);
+		if(SUCCESS != pExecutor->params.dispatch(pStep, pExecutor->params.pDispatchContext)) {
+			/* Started again on the next yield */
+			__atomic_store_n(&pStep->isInWorker, false, __ATOMIC_RELEASE);
+			storeStepState(pStep, JOBS_STEP_PENDING);
+		}
+		return;
+	}
+
+	storeStepState(pStep, JOBS_STEP_RUNNING);
+	runStepHandler(pStep);
+}
+
+/* Fail a step that is queued or running, true when it was */
+static bool stopStep(JobsStep_t *pStep) {
+	if(!changeStepState(pStep, JOBS_STEP_RUNNING, JOBS_STEP_FAILED)
+	   && !changeStepState(pStep, JOBS_STEP_QUEUED, JOBS_STEP_FAILED)) {
+		return false;
+	}
+	if(NULL != pStep->pHandler->cancel) {
+		pStep->pHandler->cancel(pStep);
+	}
+	return true;
+}
+
+static void stopAllSteps(JobsExecutor_t *pExecutor) {
+	uint8_t i;
+
+	for(i = 0; i < pExecutor->stepCount; i++) {
+		stopStep(&pExecutor->steps[i]);
+	}
+}
+
+static bool isAnyStepInWorker(JobsExecutor_t *pExecutor) {
+	uint8_t i;
+
+	for(i = 0; i < pExecutor->stepCount; i++) {
+		if(isStepInWorker(&pExecutor->steps[i])) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void finishJob(JobsExecutor_t *pExecutor, JobExecutionStatus status, const char *pReason, int16_t failedStep) {
+	stopAllSteps(pExecutor);
+	pExecutor->finalStatus = status;
+	pExecutor->pFailureReason = pReason;
+	pExecutor->failedStep = failedStep;
+	pExecutor->isFinalUpdateSent = false;
+	pExecutor->isFinalUpdateDone = false;
+	pExecutor->finalRetries = 0;
+	pExecutor->state = JOBS_EXECUTOR_FINISHING;
+	if(JOB_EXECUTION_SUCCEEDED == status) {
+		pExecutor->completedJobs++;
+		IOT_INFO("Job %s succeeded", pExecutor->jobId);
+	} else {
+		pExecutor->failedJobs++;
+		IOT_WARN("Job %s failed: %s", pExecutor->jobId, pReason);
+	}
+}
+
+static void handleStartNextResponse(JobsExecutor_t *pExecutor, bool isAccepted, const char *pPayload,
+									size_t payloadLen) {
+	JobsDocumentVisit_t visit;
+	IoT_Error_t rc;
+
+	if(JOBS_EXECUTOR_STARTING != pExecutor->state || !pExecutor->isRequestInFlight) {
+		return;
+	}
+
+	/* Steps are only in use once the executor runs a job, so they can be loaded before the token is known */
+	rc = visitJobDocument(pExecutor, pPayload, payloadLen, isAccepted, &visit);
+	if(0 != strcmp(visit.clientToken, pExecutor->requestToken)) {
+		return;
+	}
+	responseReceived(pExecutor);
+	pExecutor->isStartNextPending = false;
+
+	if(!isAccepted) {
+		IOT_WARN("start-next rejected");
+		/* Retried after the response timeout */
+		pExecutor->isStartNextPending = true;
+		countdown_ms(&pExecutor->responseTimer, pExecutor->params.responseTimeoutMs);
+		pExecutor->state = JOBS_EXECUTOR_IDLE;
+		return;
+	}
+
+	if(!visit.hasExecution || !visit.hasJobId) {
+		IOT_DEBUG("No pending job");
+		pExecutor->stepCount = 0;
+		pExecutor->state = JOBS_EXECUTOR_IDLE;
+		return;
+	}
+
+	snprintf(pExecutor->jobId, sizeof(pExecutor->jobId), "%s", visit.jobId);
+	pExecutor->executionNumber = visit.executionNumber;
+	pExecutor->currentGroup = 0;
+	pExecutor->isProgressDirty = false;
+	countdown_ms(&pExecutor->progressTimer, pExecutor->params.progressIntervalMs);
+	pExecutor->state = JOBS_EXECUTOR_RUNNING;
+	IOT_INFO("Job %s started with %u steps", pExecutor->jobId, (unsigned) pExecutor->stepCount);
+
+	if(SUCCESS != rc) {
+		visit.pError = "invalid document";
+	} else if(NULL == visit.pError && 0 == pExecutor->stepCount) {
+		visit.pError = "no steps";
+	}
+	if(NULL != visit.pError) {
+		pExecutor->stepCount = 0;
+		finishJob(pExecutor, JOB_EXECUTION_FAILED, visit.pError, -1);
+	}
+}
+
+static void handleUpdateResponse(JobsExecutor_t *pExecutor, bool isAccepted, const char *pPayload,
+								 size_t payloadLen) {
+	JobsDocumentVisit_t visit;
+
+	if(!pExecutor->isRequestInFlight) {
+		return;
+	}
+	visitJobDocument(pExecutor, pPayload, payloadLen, false, &visit);
+	if(0 != strcmp(visit.clientToken, pExecutor->requestToken)) {
+		return;
+	}
+	responseReceived(pExecutor);
+
+	if(JOBS_EXECUTOR_FINISHING == pExecutor->state && pExecutor->isFinalUpdateSent) {
+		if(!isAccepted) {
+			IOT_WARN("Outcome of job %s rejected", pExecutor->jobId);
+		}
+		pExecutor->isFinalUpdateDone = true;
+	} else if(JOBS_EXECUTOR_RUNNING == pExecutor->state && !isAccepted && visit.isJobEnded) {
+		/* The job was canceled, removed or timed out by the service */
+		IOT_WARN("Job %s ended by the service", pExecutor->jobId);
+		stopAllSteps(pExecutor);
+		pExecutor->failedJobs++;
+		pExecutor->state = JOBS_EXECUTOR_CANCELING;
+	} else if(JOBS_EXECUTOR_RUNNING == pExecutor->state && !isAccepted) {
+		/* Throttled or failed in the service, the progress is sent again with the next update */
+		IOT_WARN("Progress of job %s rejected", pExecutor->jobId);
+		markProgressDirty(pExecutor);
+	}
+}
+
+static bool hasTopicSuffix(const char *pTopic, uint16_t topicLen, const char *pSuffix) {
+	size_t suffixLen = strlen(pSuffix);
+
+	return topicLen >= suffixLen && 0 == strncmp(pTopic + topicLen - suffixLen, pSuffix, suffixLen);
+}
+
+static void jobsExecutorCallback(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+								 IoT_Publish_Message_Params *params, void *pData) {
+	JobsExecutor_t *pExecutor = (JobsExecutor_t *) pData;
+	size_t startNextPrefixLen;
+	bool isAccepted;
+
+	IOT_UNUSED(pClient);
+
+	if(NULL == pExecutor || NULL == params->payload) {
+		return;
+	}
+
+	if(strlen(pExecutor->notifyNextTopic) == topicNameLen
+	   && 0 == strncmp(pExecutor->notifyNextTopic, topicName, topicNameLen)) {
+		JobsDocumentVisit_t visit;
+
+		if(SUCCESS == visitJobDocument(pExecutor, params->payload, params->payloadLen, false, &visit)
+		   && visit.hasExecution) {
+			pExecutor->isStartNextPending = true;
+		}
+		return;
+	}
+
+	isAccepted = hasTopicSuffix(topicName, topicNameLen, "/accepted");
+	if(!isAccepted && !hasTopicSuffix(topicName, topicNameLen, "/rejected")) {
+		return;
+	}
+
+	/* The filter ends with the reply wildcard */
+	startNextPrefixLen = strlen(pExecutor->startNextTopic) - 1;
+	if(topicNameLen > startNextPrefixLen && 0 == strncmp(pExecutor->startNextTopic, topicName, startNextPrefixLen)) {
+		handleStartNextResponse(pExecutor, isAccepted, params->payload, params->payloadLen);
+	} else {
+		handleUpdateResponse(pExecutor, isAccepted, params->payload, params->payloadLen);
+	}
+}
+
+/* Start, time out and complete the steps of the running group, moving on to the next group when it is done */
+static void advanceJob(JobsExecutor_t *pExecutor) {
+	uint8_t i;
+
+	while(JOBS_EXECUTOR_RUNNING == pExecutor->state) {
+		bool isGroupDone = true;
+
+		for(i = 0; i < pExecutor->stepCount; i++) {
+			JobsStep_t *pStep = &pExecutor->steps[i];
+			uint8_t state;
+
+			if(pStep->group != pExecutor->currentGroup) {
+				continue;
+			}
+
+			if(JOBS_STEP_PENDING == loadStepState(pStep)) {
+				startStep(pExecutor, pStep);
+			}
+
+			state = loadStepState(pStep);
+			if((JOBS_STEP_QUEUED == state || JOBS_STEP_RUNNING == state) && has_timer_expired(&pStep->timer)
+			   && stopStep(pStep)) {
+				pStep->isTimedOut = true;
+				state = JOBS_STEP_FAILED;
+			}
+
+			if(JOBS_STEP_FAILED == state) {
+				finishJob(pExecutor, JOB_EXECUTION_FAILED, pStep->isTimedOut ? "timeout" : "failed", (int16_t) i);
+				return;
+			}
+			if(JOBS_STEP_SUCCEEDED != state) {
+				isGroupDone = false;
+			}
+		}
+
+		if(!isGroupDone) {
+			break;
+		}
+		pExecutor->currentGroup++;
+		if(pExecutor->currentGroup >= pExecutor->groupCount) {
+			finishJob(pExecutor, JOB_EXECUTION_SUCCEEDED, NULL, -1);
+			return;
+		}
+	}
+
+	/* Progress of all steps goes out in one update per interval */
+	if(__atomic_load_n(&pExecutor->isProgressDirty, __ATOMIC_ACQUIRE) && !pExecutor->isRequestInFlight
+	   && has_timer_expired(&pExecutor->progressTimer)) {
+		__atomic_store_n(&pExecutor->isProgressDirty, false, __ATOMIC_RELEASE);
+		if(SUCCESS != sendUpdate(pExecutor, JOB_EXECUTION_IN_PROGRESS)) {
+			IOT_WARN("Sending progress of job %s failed", pExecutor->jobId);
+		}
+		countdown_ms(&pExecutor->progressTimer, pExecutor->params.progressIntervalMs);
+	}
+}
+
+static void processJobs(JobsExecutor_t *pExecutor) {
+	if(pExecutor->isRequestInFlight && has_timer_expired(&pExecutor->responseTimer)) {
+		pExecutor->isRequestInFlight = false;
+		if(JOBS_EXECUTOR_STARTING == pExecutor->state) {
+			IOT_WARN("No response to start-next");
+			pExecutor->isStartNextPending = true;
+			pExecutor->state = JOBS_EXECUTOR_IDLE;
+		} else if(JOBS_EXECUTOR_FINISHING == pExecutor->state && pExecutor->isFinalUpdateSent) {
+			pExecutor->isFinalUpdateSent = false;
+			if(++pExecutor->finalRetries >= JOBS_EXECUTOR_FINAL_RETRIES) {
+				IOT_WARN("No response to the outcome of job %s", pExecutor->jobId);
+				pExecutor->isFinalUpdateDone = true;
+			}
+		}
+	}
+
+	/* Checked in the order of the states, so a job can move on more than one state in a pass */
+	if(JOBS_EXECUTOR_IDLE == pExecutor->state && pExecutor->isSubscribed && pExecutor->isStartNextPending
+	   && !pExecutor->isRequestInFlight && has_timer_expired(&pExecutor->responseTimer)) {
+		if(SUCCESS == sendStartNext(pExecutor)) {
+			pExecutor->state = JOBS_EXECUTOR_STARTING;
+		}
+	}
+
+	if(JOBS_EXECUTOR_RUNNING == pExecutor->state) {
+		advanceJob(pExecutor);
+	}
+
+	if(JOBS_EXECUTOR_FINISHING == pExecutor->state) {
+		if(!pExecutor->isFinalUpdateDone && !pExecutor->isFinalUpdateSent && !pExecutor->isRequestInFlight) {
+			if(SUCCESS == sendUpdate(pExecutor, pExecutor->finalStatus)) {
+				pExecutor->isFinalUpdateSent = true;
+			}
+		}
+		if(pExecutor->isFinalUpdateDone && !isAnyStepInWorker(pExecutor)) {
+			pExecutor->state = JOBS_EXECUTOR_IDLE;
+			pExecutor->isStartNextPending = true;
+		}
+	}
+
+	if(JOBS_EXECUTOR_CANCELING == pExecutor->state && !isAnyStepInWorker(pExecutor)) {
+		pExecutor->state = JOBS_EXECUTOR_IDLE;
+		pExecutor->isStartNextPending = true;
+	}
+}
+
+IoT_Error_t aws_iot_jobs_executor_init(JobsExecutor_t *pExecutor, AWS_IoT_Client *pClient,
+									   const JobsExecutorParams_t *pParams) {
+	FUNC_ENTRY;
+
+	if(NULL == pExecutor || NULL == pClient || NULL == pParams || NULL == pParams->pThingName) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+	if(strlen(pParams->pThingName) >= MAX_SIZE_OF_THING_NAME) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	memset(pExecutor, 0, sizeof(JobsExecutor_t));
+	pExecutor->pClient = pClient;
+	pExecutor->params = *pParams;
+	snprintf(pExecutor->thingName, sizeof(pExecutor->thingName), "%s", pParams->pThingName);
+	pExecutor->params.pThingName = pExecutor->thingName;
+	pExecutor->state = JOBS_EXECUTOR_IDLE;
+	pExecutor->failedStep = -1;
+	init_timer(&pExecutor->responseTimer);
+	init_timer(&pExecutor->progressTimer);
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_jobs_executor_register_handler(JobsExecutor_t *pExecutor, const JobsStepHandler_t *pHandler) {
+	FUNC_ENTRY;
+
+	if(NULL == pExecutor || NULL == pHandler || NULL == pHandler->pName || NULL == pHandler->run) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+	if(pExecutor->handlerCount >= JOBS_EXECUTOR_MAX_HANDLERS
+	   || NULL != findHandler(pExecutor, pHandler->pName, (uint32_t) strlen(pHandler->pName))) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	pExecutor->pHandlers[pExecutor->handlerCount++] = pHandler;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_jobs_executor_start(JobsExecutor_t *pExecutor) {
+	IoT_Subscribe_Topic_Params topics[JOBS_EXECUTOR_FILTER_COUNT];
+	IoT_Error_t rc;
+	uint8_t i;
+
+	FUNC_ENTRY;
+
+	if(NULL == pExecutor) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+	if(pExecutor->isSubscribed) {
+		FUNC_EXIT_RC(SUCCESS);
+	}
+
+	if(aws_iot_jobs_get_api_topic(pExecutor->notifyNextTopic, sizeof(pExecutor->notifyNextTopic),
+								  JOB_NOTIFY_NEXT_TOPIC, JOB_REQUEST_TYPE, pExecutor->thingName, NULL)
+	   >= (int) sizeof(pExecutor->notifyNextTopic)
+	   || aws_iot_jobs_get_api_topic(pExecutor->startNextTopic, sizeof(pExecutor->startNextTopic),
+									 JOB_START_NEXT_TOPIC, JOB_WILDCARD_REPLY_TYPE, pExecutor->thingName, NULL)
+		  >= (int) sizeof(pExecutor->startNextTopic)
+	   || aws_iot_jobs_get_api_topic(pExecutor->updateTopic, sizeof(pExecutor->updateTopic), JOB_UPDATE_TOPIC,
+									 JOB_WILDCARD_REPLY_TYPE, pExecutor->thingName, JOB_ID_WILDCARD)
+		  >= (int) sizeof(pExecutor->updateTopic)) {
+		FUNC_EXIT_RC(LIMIT_EXCEEDED_ERROR);
+	}
+
+	topics[0].pTopicName = pExecutor->notifyNextTopic;
+	topics[1].pTopicName = pExecutor->startNextTopic;
+	topics[2].pTopicName = pExecutor->updateTopic;
+	for(i = 0; i < JOBS_EXECUTOR_FILTER_COUNT; i++) {
+		topics[i].topicNameLen = (uint16_t) strlen(topics[i].pTopicName);
+		topics[i].qos = QOS0;
+		topics[i].pApplicationHandler = jobsExecutorCallback;
+		topics[i].pApplicationHandlerData = pExecutor;
+	}
+
+	rc = aws_iot_mqtt_subscribe_batch(pExecutor->pClient, topics, JOBS_EXECUTOR_FILTER_COUNT);
+	if(SUCCESS != rc) {
+		for(i = 0; i < JOBS_EXECUTOR_FILTER_COUNT; i++) {
+			aws_iot_mqtt_unsubscribe(pExecutor->pClient, topics[i].pTopicName, topics[i].topicNameLen);
+		}
+		FUNC_EXIT_RC(rc);
+	}
+
+	pExecutor->isSubscribed = true;
+	pExecutor->isStartNextPending = true;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+void aws_iot_jobs_executor_run_step(JobsStep_t *pStep) {
+	if(NULL == pStep || NULL == pStep->pHandler) {
+		return;
+	}
+
+	if(changeStepState(pStep, JOBS_STEP_QUEUED, JOBS_STEP_RUNNING)) {
+		runStepHandler(pStep);
+	}
+	__atomic_store_n(&pStep->isInWorker, false, __ATOMIC_RELEASE);
+	aws_iot_mqtt_yield_wakeup(pStep->pExecutor->pClient);
+}
+
+IoT_Error_t aws_iot_jobs_executor_step_complete(JobsStep_t *pStep, bool succeeded) {
+	FUNC_ENTRY;
+
+	if(NULL == pStep || NULL == pStep->pExecutor) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+	if(!changeStepState(pStep, JOBS_STEP_RUNNING, succeeded ? JOBS_STEP_SUCCEEDED : JOBS_STEP_FAILED)) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	markProgressDirty(pStep->pExecutor);
+	aws_iot_mqtt_yield_wakeup(pStep->pExecutor->pClient);
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+void aws_iot_jobs_executor_step_progress(JobsStep_t *pStep, uint8_t percent) {
+	if(NULL == pStep || NULL == pStep->pExecutor) {
+		return;
+	}
+
+	__atomic_store_n(&pStep->progress, percent > 100 ? 100 : percent, __ATOMIC_RELAXED);
+	markProgressDirty(pStep->pExecutor);
+}
+
+IoT_Error_t aws_iot_jobs_executor_yield(JobsExecutor_t *pExecutor, uint32_t timeout) {
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pExecutor) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	processJobs(pExecutor);
+	rc = aws_iot_mqtt_yield(pExecutor->pClient, timeout);
+	/* Act on the responses received during the yield without waiting for the next one */
+	processJobs(pExecutor);
+
+	FUNC_EXIT_RC(rc);
+}
+
+#ifdef __cplusplus
+}
+#endif
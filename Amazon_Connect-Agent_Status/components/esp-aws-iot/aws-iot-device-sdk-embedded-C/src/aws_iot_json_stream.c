@@ -0,0 +1,521 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_json_stream.c
+ * @brief Resumable JSON tokenizer that reports values with their path
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aws_iot_json_stream.h"
+
+#include <string.h>
+
+#include "aws_iot_log.h"
+
+#if JSON_STREAM_MAX_PATH_LENGTH >= 0xFFFF
+#error "JSON_STREAM_MAX_PATH_LENGTH must be less than 65535"
+#endif
+
+/* Path of a value below a path that did not fit */
+#define JSON_STREAM_PATH_INVALID 0xFFFF
+
+enum {
+	STREAM_VALUE, ///< A value is expected
+	STREAM_VALUE_OR_END, ///< After '[', a value or ']'
+	STREAM_KEY_OR_END, ///< After '{', a member name or '}'
+	STREAM_KEY, ///< After ',' in an object, a member name
+	STREAM_KEY_STRING, ///< Inside a member name
+	STREAM_KEY_ESCAPE, ///< After '\' in a member name
+	STREAM_COLON, ///< After a member name
+	STREAM_STRING, ///< Inside a string value
+	STREAM_STRING_ESCAPE, ///< After '\' in a string value
+	STREAM_PRIMITIVE, ///< Inside a number or literal
+	STREAM_AFTER_VALUE, ///< ',' or the end of the container
+	STREAM_DONE ///< Only whitespace may follow
+};
+
+static bool isWhitespace(char c) {
+	return ' ' == c || '\t' == c || '\n' == c || '\r' == c;
+}
+
+static bool isDigit(char c) {
+	return c >= '0' && c <= '9';
+}
+
+static bool isHexDigit(char c) {
+	return isDigit(c) || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+/* Characters of numbers and literals, anything else ends them */
+static bool isPrimitiveChar(char c) {
+	return isDigit(c) || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || '-' == c || '+' == c || '.' == c;
+}
+
+static bool isJsonNumber(const char *pText, uint32_t length) {
+	uint32_t i = 0;
+
+	if(i < length && '-' == pText[i]) {
+		i++;
+	}
+	if(i < length && '0' == pText[i]) {
+		i++;
+	} else if(i < length && isDigit(pText[i])) {
+		while(i < length && isDigit(pText[i])) {
+			i++;
+		}
+	} else {
+		return false;
+	}
+
+	if(i < length && '.' == pText[i]) {
+		i++;
+		if(i == length || !isDigit(pText[i])) {
+			return false;
+		}
+		while(i < length && isDigit(pText[i])) {
+			i++;
+		}
+	}
+
+	if(i < length && ('e' == pText[i] || 'E' == pText[i])) {
+		i++;
+		if(i < length && ('+' == pText[i] || '-' == pText[i])) {
+			i++;
+		}
+		if(i == length || !isDigit(pText[i])) {
+			return false;
+		}
+		while(i < length && isDigit(pText[i])) {
+			i++;
+		}
+	}
+
+	return i == length;
+}
+
+static bool isObjectAt(const JsonStreamParser_t *pParser, uint16_t depth) {
+	return (pParser->isObject[(depth - 1) / 8] & (1u << ((depth - 1) % 8))) != 0;
+}
+
+static void appendPath(JsonStreamParser_t *pParser, char c) {
+	if(JSON_STREAM_PATH_INVALID == pParser->pathLength) {
+		return;
+	}
+	if(pParser->pathLength >= JSON_STREAM_MAX_PATH_LENGTH) {
+		pParser->pathLength = JSON_STREAM_PATH_INVALID;
+		return;
+	}
+	pParser->path[pParser->pathLength++] = c;
+}
+
+/* Start the path of a member or element of the innermost container */
+static void startPathSegment(JsonStreamParser_t *pParser) {
+	uint16_t base = pParser->containerPathLength[pParser->depth];
+
+	pParser->pathLength = base;
+	if(JSON_STREAM_PATH_INVALID != base && base > 0) {
+		appendPath(pParser, '.');
+	}
+}
+
+static void startElementPath(JsonStreamParser_t *pParser) {
+	char digits[10];
+	uint32_t index = pParser->elementIndex[pParser->depth - 1];
+	uint8_t count = 0;
+
+	startPathSegment(pParser);
+	do {
+		digits[count++] = (char) ('0' + index % 10);
+		index /= 10;
+	} while(index > 0);
+	while(count > 0) {
+		appendPath(pParser, digits[--count]);
+	}
+}
+
+static void emitEvent(JsonStreamParser_t *pParser, JsonStreamEventType_t type, uint16_t depth, const char *pValue,
+					  uint32_t valueLength) {
+	JsonStreamEvent_t event;
+	uint16_t keyStart;
+
+	if(NULL == pParser->callback) {
+		return;
+	}
+
+	event.type = type;
+	event.depth = depth;
+	event.pKey = NULL;
+	event.keyLength = 0;
+	event.pPath = NULL;
+	event.pathLength = 0;
+	event.pValue = pValue;
+	event.valueLength = valueLength;
+
+	if(JSON_STREAM_PATH_INVALID != pParser->pathLength) {
+		pParser->path[pParser->pathLength] = '\0';
+		event.pPath = pParser->path;
+		event.pathLength = pParser->pathLength;
+
+		/* The member name is the last segment, right after the path of its object */
+		if(depth > 0 && isObjectAt(pParser, depth)) {
+			keyStart = pParser->containerPathLength[depth];
+			if(keyStart > 0) {
+				keyStart++;
+			}
+			event.pKey = pParser->path + keyStart;
+			event.keyLength = (uint32_t) (pParser->pathLength - keyStart);
+		}
+	}
+
+	pParser->callback(&event, pParser->pContext);
+}
+
+static void endOfValue(JsonStreamParser_t *pParser) {
+	pParser->state = (0 == pParser->depth) ? STREAM_DONE : STREAM_AFTER_VALUE;
+}
+
+static IoT_Error_t copyValue(JsonStreamParser_t *pParser, const char *pStart, const char *pEnd) {
+	size_t length = (size_t) (pEnd - pStart);
+
+	if(0 == length) {
+		return SUCCESS;
+	}
+	if(length > JSON_STREAM_MAX_VALUE_LENGTH - pParser->valueLength) {
+		IOT_WARN("JSON value longer than %d bytes split across chunks", JSON_STREAM_MAX_VALUE_LENGTH);
+		return MAX_SIZE_ERROR;
+	}
+	memcpy(pParser->value + pParser->valueLength, pStart, length);
+	pParser->valueLength += (uint32_t) length;
+	return SUCCESS;
+}
+
+/* Report the string or primitive from pStart, in this chunk, to pEnd */
+static IoT_Error_t finishValue(JsonStreamParser_t *pParser, const char *pStart, const char *pEnd) {
+	JsonStreamEventType_t type;
+	const char *pValue = pStart;
+	uint32_t length = (uint32_t) (pEnd - pStart);
+	IoT_Error_t rc;
+
+	if(pParser->isValueCopied) {
+		rc = copyValue(pParser, pStart, pEnd);
+		if(SUCCESS != rc) {
+			return rc;
+		}
+		pValue = pParser->value;
+		length = pParser->valueLength;
+	}
+
+	if(STREAM_STRING == pParser->state) {
+		type = JSON_STREAM_STRING;
+	} else if(4 == length && 0 == strncmp(pValue, "true", 4)) {
+		type = JSON_STREAM_BOOL;
+	} else if(5 == length && 0 == strncmp(pValue, "false", 5)) {
+		type = JSON_STREAM_BOOL;
+	} else if(4 == length && 0 == strncmp(pValue, "null", 4)) {
+		type = JSON_STREAM_NULL;
+	} else if(isJsonNumber(pValue, length)) {
+		type = JSON_STREAM_NUMBER;
+	} else {
+		return JSON_PARSE_ERROR;
+	}
+
+	emitEvent(pParser, type, pParser->depth, pValue, length);
+	endOfValue(pParser);
+	return SUCCESS;
+}
+
+static IoT_Error_t openContainer(JsonStreamParser_t *pParser, bool isObject) {
+	uint16_t depth = pParser->depth;
+
+	if(depth >= JSON_STREAM_MAX_DEPTH) {
+		IOT_WARN("JSON nested deeper than %d", JSON_STREAM_MAX_DEPTH);
+		return LIMIT_EXCEEDED_ERROR;
+	}
+
+	emitEvent(pParser, isObject ? JSON_STREAM_OBJECT_START : JSON_STREAM_ARRAY_START, depth, NULL, 0);
+
+	if(isObject) {
+		pParser->isObject[depth / 8] |= (uint8_t) (1u << (depth % 8));
+	} else {
+		pParser->isObject[depth / 8] &= (uint8_t) ~(1u << (depth % 8));
+	}
+	pParser->elementIndex[depth] = 0;
+	pParser->depth = (uint16_t) (depth + 1);
+	pParser->containerPathLength[depth + 1] = pParser->pathLength;
+	pParser->state = isObject ? STREAM_KEY_OR_END : STREAM_VALUE_OR_END;
+	return SUCCESS;
+}
+
+static IoT_Error_t closeContainer(JsonStreamParser_t *pParser, bool isObject) {
+	if(0 == pParser->depth || isObject != isObjectAt(pParser, pParser->depth)) {
+		return JSON_PARSE_ERROR;
+	}
+
+	pParser->pathLength = pParser->containerPathLength[pParser->depth];
+	pParser->depth--;
+	emitEvent(pParser, isObject ? JSON_STREAM_OBJECT_END : JSON_STREAM_ARRAY_END, pParser->depth, NULL, 0);
+	endOfValue(pParser);
+	return SUCCESS;
+}
+
+/* Escape sequences are checked and kept as received */
+static IoT_Error_t checkEscape(JsonStreamParser_t *pParser, char c, uint8_t stringState) {
+	if(pParser->escapeDigits > 0) {
+		if(!isHexDigit(c)) {
+			return JSON_PARSE_ERROR;
+		}
+		pParser->escapeDigits--;
+	} else if('u' == c) {
+		pParser->escapeDigits = 4;
+	} else if(NULL == strchr("\"\\/bfnrt", c) || '\0' == c) {
+		return JSON_PARSE_ERROR;
+	}
+
+	if(0 == pParser->escapeDigits) {
+		pParser->state = stringState;
+	}
+	return SUCCESS;
+}
+
+IoT_Error_t aws_iot_json_stream_init(JsonStreamParser_t *pParser, JsonStreamCallback_t callback, void *pContext) {
+	FUNC_ENTRY;
+
+	if(NULL == pParser) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	memset(pParser, 0, sizeof(JsonStreamParser_t));
+	pParser->callback = callback;
+	pParser->pContext = pContext;
+	pParser->error = SUCCESS;
+	pParser->state = STREAM_VALUE;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_json_stream_feed(JsonStreamParser_t *pParser, const char *pData, size_t length) {
+	const char *pEnd;
+	const char *pValueStart;
+	const char *p;
+	IoT_Error_t rc = SUCCESS;
+	char c;
+
+	if(NULL == pParser || (NULL == pData && length > 0)) {
+		return NULL_VALUE_ERROR;
+	}
+	if(SUCCESS != pParser->error) {
+		return pParser->error;
+	}
+
+	p = pData;
+	pEnd = pData + length;
+	/* A value carried over from the last chunk continues here */
+	pValueStart = pData;
+
+	while(p < pEnd && SUCCESS == rc) {
+		c = *p;
+
+		switch(pParser->state) {
+			case STREAM_VALUE_OR_END:
+				if(']' == c) {
+					rc = closeContainer(pParser, false);
+					p++;
+					break;
+				}
+				/* fall through */
+			case STREAM_VALUE:
+				if(isWhitespace(c)) {
+					p++;
+					break;
+				}
+				if(pParser->depth > 0 && !isObjectAt(pParser, pParser->depth)) {
+					startElementPath(pParser);
+				}
+				if('{' == c || '[' == c) {
+					rc = openContainer(pParser, '{' == c);
+					p++;
+				} else if('"' == c) {
+					pParser->state = STREAM_STRING;
+					pParser->isValueCopied = false;
+					pParser->valueLength = 0;
+					pValueStart = ++p;
+				} else if('-' == c || isDigit(c) || 't' == c || 'f' == c || 'n' == c) {
+					pParser->state = STREAM_PRIMITIVE;
+					pParser->isValueCopied = false;
+					pParser->valueLength = 0;
+					pValueStart = p++;
+				} else {
+					rc = JSON_PARSE_ERROR;
+				}
+				break;
+
+			case STREAM_KEY_OR_END:
+				if('}' == c) {
+					rc = closeContainer(pParser, true);
+					p++;
+					break;
+				}
+				/* fall through */
+			case STREAM_KEY:
+				if(isWhitespace(c)) {
+					p++;
+				} else if('"' == c) {
+					startPathSegment(pParser);
+					pParser->state = STREAM_KEY_STRING;
+					p++;
+				} else {
+					rc = JSON_PARSE_ERROR;
+				}
+				break;
+
+			case STREAM_KEY_STRING:
+				while(p < pEnd && '"' != *p && '\\' != *p && (unsigned char) *p >= 0x20) {
+					appendPath(pParser, *p++);
+				}
+				if(p == pEnd) {
+					break;
+				}
+				if('"' == *p) {
+					pParser->state = STREAM_COLON;
+				} else if('\\' == *p) {
+					appendPath(pParser, *p);
+					pParser->state = STREAM_KEY_ESCAPE;
+				} else {
+					rc = JSON_PARSE_ERROR;
+				}
+				p++;
+				break;
+
+			case STREAM_KEY_ESCAPE:
+				appendPath(pParser, c);
+				rc = checkEscape(pParser, c, STREAM_KEY_STRING);
+				p++;
+				break;
+
+			case STREAM_COLON:
+				if(isWhitespace(c)) {
+					p++;
+				} else if(':' == c) {
+					pParser->state = STREAM_VALUE;
+					p++;
+				} else {
+					rc = JSON_PARSE_ERROR;
+				}
+				break;
+
+			case STREAM_STRING:
+				while(p < pEnd && '"' != *p && '\\' != *p && (unsigned char) *p >= 0x20) {
+					p++;
+				}
+				if(p == pEnd) {
+					break;
+				}
+				if('"' == *p) {
+					rc = finishValue(pParser, pValueStart, p);
+				} else if('\\' == *p) {
+					pParser->state = STREAM_STRING_ESCAPE;
+				} else {
+					rc = JSON_PARSE_ERROR;
+				}
+				p++;
+				break;
+
+			case STREAM_STRING_ESCAPE:
+				rc = checkEscape(pParser, c, STREAM_STRING);
+				p++;
+				break;
+
+			case STREAM_PRIMITIVE:
+				while(p < pEnd && isPrimitiveChar(*p)) {
+					p++;
+				}
+				if(p < pEnd) {
+					/* The character after the value is handled in the next state */
+					rc = finishValue(pParser, pValueStart, p);
+				}
+				break;
+
+			case STREAM_AFTER_VALUE:
+				if(isWhitespace(c)) {
+					p++;
+				} else if(',' == c) {
+					if(isObjectAt(pParser, pParser->depth)) {
+						pParser->state = STREAM_KEY;
+					} else {
+						pParser->elementIndex[pParser->depth - 1]++;
+						pParser->state = STREAM_VALUE;
+					}
+					p++;
+				} else if('}' == c || ']' == c) {
+					rc = closeContainer(pParser, '}' == c);
+					p++;
+				} else {
+					rc = JSON_PARSE_ERROR;
+				}
+				break;
+
+			case STREAM_DONE:
+			default:
+				if(isWhitespace(c)) {
+					p++;
+				} else {
+					rc = JSON_PARSE_ERROR;
+				}
+				break;
+		}
+	}
+
+	/* Keep the part of a value that continues in the next chunk */
+	if(SUCCESS == rc && (STREAM_STRING == pParser->state || STREAM_STRING_ESCAPE == pParser->state
+						 || STREAM_PRIMITIVE == pParser->state)) {
+		rc = copyValue(pParser, pValueStart, pEnd);
+		pParser->isValueCopied = true;
+	}
+
+	if(SUCCESS != rc) {
+		IOT_DEBUG("JSON stream stopped at byte %d of the chunk: %d", (int) (p - pData), rc);
+		pParser->error = rc;
+	}
+	return rc;
+}
+
+IoT_Error_t aws_iot_json_stream_finish(JsonStreamParser_t *pParser) {
+	FUNC_ENTRY;
+
+	if(NULL == pParser) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+	if(SUCCESS != pParser->error) {
+		FUNC_EXIT_RC(pParser->error);
+	}
+
+	/* A top level number or literal has nothing after it */
+	if(STREAM_PRIMITIVE == pParser->state && 0 == pParser->depth) {
+		pParser->error = finishValue(pParser, pParser->value + pParser->valueLength,
+									 pParser->value + pParser->valueLength);
+	} else if(STREAM_DONE != pParser->state) {
+		pParser->error = JSON_PARSE_ERROR;
+	}
+
+	FUNC_EXIT_RC(pParser->error);
+}
+
+#ifdef __cplusplus
+}
+#endif
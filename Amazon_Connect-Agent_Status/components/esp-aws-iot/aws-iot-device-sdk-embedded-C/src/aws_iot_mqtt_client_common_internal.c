@@ -670,8 +670,20 @@ IoT_Error_t aws_iot_mqtt_internal_cycle_read(AWS_IoT_Client *pClient, Timer *pTi
 	}
 
 	switch(*pPacketType) {
+		case PUBACK: {
+			unsigned char ackType, ackDup;
+			uint16_t ackPacketId;
+
+			/* Also forwarded to the calling function, but a PUBACK can arrive in yield too,
+			 * e.g. for a publish redelivered after a session was resumed */
+			if(SUCCESS == aws_iot_mqtt_internal_deserialize_ack(&ackType, &ackDup, &ackPacketId,
+																pClient->clientData.readBuf,
+																pClient->clientData.readBufSize)) {
+				aws_iot_mqtt_internal_remove_unacked_publish(pClient, ackPacketId);
+			}
+			break;
+		}
 		case CONNACK:
-		case PUBACK:
 		case SUBACK:
 		case UNSUBACK:
 			/* SDK is blocking, these responses will be forwarded to calling function to process */
@@ -788,6 +800,112 @@ IoT_Error_t aws_iot_mqtt_internal_serialize_zero(unsigned char *pTxBuf, size_t t
 	FUNC_EXIT_RC(SUCCESS);
 }
 
+/**
+ * @brief Start measuring elapsed time with a timer
+ *
+ * The timer counts down from AWS_IOT_MQTT_STOPWATCH_RANGE_MS, see
+ * aws_iot_mqtt_internal_stopwatch_elapsed_ms.
+ *
+ * @param pTimer Timer to use as stopwatch
+ */
+void aws_iot_mqtt_internal_stopwatch_start(Timer *pTimer) {
+	init_timer(pTimer);
+	countdown_ms(pTimer, AWS_IOT_MQTT_STOPWATCH_RANGE_MS);
+}
+
+/**
+ * @brief Time elapsed since aws_iot_mqtt_internal_stopwatch_start
+ *
+ * @param pTimer Timer started with aws_iot_mqtt_internal_stopwatch_start
+ *
+ * @return Elapsed time in ms, saturates at AWS_IOT_MQTT_STOPWATCH_RANGE_MS
+ */
+uint32_t aws_iot_mqtt_internal_stopwatch_elapsed_ms(Timer *pTimer) {
+	uint32_t left = left_ms(pTimer);
+
+	if(AWS_IOT_MQTT_STOPWATCH_RANGE_MS < left) {
+		return 0;
+	}
+	return AWS_IOT_MQTT_STOPWATCH_RANGE_MS - left;
+}
+
+/**
+ * @brief Seed the random generator used to jitter the reconnect backoff
+ *
+ * Seeded from the client ID, which is unique per device, so that a fleet of
+ * devices disconnected at the same time spreads its reconnect attempts.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pSeed Seed bytes, may be NULL
+ * @param seedLen Number of seed bytes
+ */
+void aws_iot_mqtt_internal_seed_backoff(AWS_IoT_Client *pClient, const char *pSeed, uint16_t seedLen) {
+	/* FNV-1a */
+	uint32_t hash = 2166136261u;
+	uint16_t itr;
+
+	for(itr = 0; NULL != pSeed && itr < seedLen; itr++) {
+		hash ^= (uint8_t) pSeed[itr];
+		hash *= 16777619u;
+	}
+
+	/* xorshift must not start from 0 */
+	pClient->clientData.backoffRandomState = (0 != hash) ? hash : 0x9E3779B9u;
+}
+
+static uint32_t _aws_iot_mqtt_backoff_random(AWS_IoT_Client *pClient) {
+	/* xorshift32 */
+	uint32_t x = pClient->clientData.backoffRandomState;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	pClient->clientData.backoffRandomState = x;
+
+	return x;
+}
+
+/**
+ * @brief Compute the delay before the next reconnect attempt
+ *
+ * Decorrelated jitter: the first attempt after a disconnect waits a random time up to
+ * AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL, every following attempt a random time
+ * between AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL and three times the previous
+ * delay, capped at AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL. The result is stored
+ * in currentReconnectWaitInterval.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param isFirstAttempt true for the first attempt after a disconnect
+ *
+ * @return Delay in ms
+ */
+uint32_t aws_iot_mqtt_internal_next_backoff_ms(AWS_IoT_Client *pClient, bool isFirstAttempt) {
+	uint32_t previous = pClient->clientData.currentReconnectWaitInterval;
+	uint32_t lower = AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL;
+	uint32_t upper;
+	uint32_t next;
+
+	if(isFirstAttempt) {
+		lower = 0;
+		upper = AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL;
+	} else {
+		upper = (previous > AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL / 3) ?
+				AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL : previous * 3;
+		if(upper < lower) {
+			upper = lower;
+		}
+	}
+
+	next = lower + (_aws_iot_mqtt_backoff_random(pClient) % (upper - lower + 1));
+	if(AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL < next) {
+		next = AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL;
+	}
+
+	pClient->clientData.currentReconnectWaitInterval = next;
+
+	return next;
+}
+
 #ifdef __cplusplus
 }
 #endif
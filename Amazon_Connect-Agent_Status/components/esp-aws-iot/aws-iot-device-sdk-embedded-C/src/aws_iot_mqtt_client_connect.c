@@ -333,6 +333,8 @@ static bool _aws_iot_mqtt_is_client_state_valid_for_connect(ClientState clientSt
  */
 static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, const IoT_Client_Connect_Params *pConnectParams) {
 	Timer connect_timer;
+	Timer connack_stopwatch;
+	IoT_Connection_Metrics *pMetrics = &(pClient->clientData.connectionMetrics);
 	IoT_Error_t connack_rc = FAILURE;
 	char sessionPresent = 0;
 	size_t len = 0;
@@ -348,6 +350,7 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, const
 		}
 	}
 
+	memset(&(pClient->networkStack.connectTiming), 0, sizeof(NetworkConnectTiming));
 	rc = pClient->networkStack.connect(&(pClient->networkStack), NULL);
 	if(SUCCESS != rc) {
 		/* TLS Connect failed, return error */
@@ -365,6 +368,7 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, const
 	}
 
 	/* send the connect packet */
+	aws_iot_mqtt_internal_stopwatch_start(&connack_stopwatch);
 	rc = aws_iot_mqtt_internal_send_packet(pClient, len, &connect_timer);
 	if(SUCCESS != rc) {
 		FUNC_EXIT_RC(rc);
@@ -387,6 +391,23 @@ static IoT_Error_t _aws_iot_mqtt_internal_connect(AWS_IoT_Client *pClient, const
 		FUNC_EXIT_RC(connack_rc);
 	}
 
+	pMetrics->dnsLookupMs = pClient->networkStack.connectTiming.dnsLookupMs;
+	pMetrics->tcpConnectMs = pClient->networkStack.connectTiming.tcpConnectMs;
+	pMetrics->tlsHandshakeMs = pClient->networkStack.connectTiming.tlsHandshakeMs;
+	pMetrics->connackMs = aws_iot_mqtt_internal_stopwatch_elapsed_ms(&connack_stopwatch);
+
+	/* The server keeps subscriptions and in-flight QoS1 messages of a persistent session.
+	 * If it did not resume one, the client discards its copy of the session state too */
+	pClient->clientStatus.isSessionPresent = (0 != sessionPresent);
+	if(pClient->clientStatus.isSessionPresent) {
+		rc = aws_iot_mqtt_internal_resend_unacked_publishes(pClient);
+		if(SUCCESS != rc) {
+			FUNC_EXIT_RC(rc);
+		}
+	} else {
+		aws_iot_mqtt_internal_clear_unacked_publishes(pClient);
+	}
+
 	/* Ensure that a ping request is sent after keepAliveInterval. */
 	pClient->clientStatus.isPingOutstanding = false;
 	countdown_sec(&pClient->pingReqTimer, pClient->clientData.keepAliveInterval);
@@ -441,6 +462,55 @@ IoT_Error_t aws_iot_mqtt_connect(AWS_IoT_Client *pClient, const IoT_Client_Conne
 	FUNC_EXIT_RC(rc);
 }
 
+/**
+ * @brief MQTT Connection Function with backoff
+ *
+ * Calls aws_iot_mqtt_connect until it succeeds, waiting with the jittered reconnect
+ * backoff between attempts.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pConnectParams Pointer to MQTT connection parameters
+ * @param maxAttempts Number of attempts before giving up, 0 for no limit
+ *
+ * @return An IoT Error Type defining successful/failed connection
+ */
+IoT_Error_t aws_iot_mqtt_connect_with_backoff(AWS_IoT_Client *pClient, const IoT_Client_Connect_Params *pConnectParams,
+											  uint32_t maxAttempts) {
+	Timer backoffTimer;
+	uint32_t attempts = 0;
+	uint32_t backoffMs;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	for(;;) {
+		rc = aws_iot_mqtt_connect(pClient, pConnectParams);
+		attempts++;
+		if(SUCCESS == rc || NETWORK_ALREADY_CONNECTED_ERROR == rc) {
+			break;
+		}
+		if(0 != maxAttempts && attempts >= maxAttempts) {
+			break;
+		}
+
+		backoffMs = aws_iot_mqtt_internal_next_backoff_ms(pClient, (1 == attempts));
+		IOT_WARN("Connect attempt %u failed with %d, retrying in %u ms", (unsigned int) attempts, rc,
+				 (unsigned int) backoffMs);
+
+		init_timer(&backoffTimer);
+		countdown_ms(&backoffTimer, backoffMs);
+		while(0 != (backoffMs = left_ms(&backoffTimer))) {
+			delay(backoffMs);
+		}
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
 /**
  * @brief Disconnect an MQTT Connection
  *
@@ -538,6 +608,8 @@ IoT_Error_t aws_iot_mqtt_attempt_reconnect(AWS_IoT_Client *pClient) {
 			aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_DISCONNECTED_ERROR, CLIENT_STATE_PENDING_RECONNECT);
 			FUNC_EXIT_RC(NETWORK_ATTEMPTING_RECONNECT);
 		}
+
+		aws_iot_mqtt_internal_stopwatch_start(&(pClient->resubscribeStopwatch));
 	}
 	else {
 		/* If already connected and no subscribe operation pending, then return
@@ -552,6 +624,9 @@ IoT_Error_t aws_iot_mqtt_attempt_reconnect(AWS_IoT_Client *pClient) {
 		FUNC_EXIT_RC(NETWORK_ATTEMPTING_RECONNECT);
 	}
 
+	pClient->clientData.connectionMetrics.resubscribeMs = pClient->clientStatus.isSessionPresent ?
+			0 : aws_iot_mqtt_internal_stopwatch_elapsed_ms(&(pClient->resubscribeStopwatch));
+
 	FUNC_EXIT_RC(NETWORK_RECONNECTED);
 }
 
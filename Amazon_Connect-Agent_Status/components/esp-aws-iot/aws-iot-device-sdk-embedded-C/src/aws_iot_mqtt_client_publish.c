@@ -219,6 +219,12 @@ static IoT_Error_t _aws_iot_mqtt_internal_publish(AWS_IoT_Client *pClient, const
 		FUNC_EXIT_RC(rc);
 	}
 
+	/* In a persistent session keep a copy until the PUBACK arrives, so the message
+	 * can be redelivered if the connection drops first */
+	if(QOS1 == pParams->qos && false == pClient->clientData.options.isCleanSession) {
+		aws_iot_mqtt_internal_store_unacked_publish(pClient, pParams->id, len);
+	}
+
 	/* send the publish packet */
 	rc = aws_iot_mqtt_internal_send_packet(pClient, len, &timer);
 	if(SUCCESS != rc) {
@@ -242,6 +248,121 @@ static IoT_Error_t _aws_iot_mqtt_internal_publish(AWS_IoT_Client *pClient, const
 	FUNC_EXIT_RC(SUCCESS);
 }
 
+/**
+ * @brief Keep a copy of a QoS1 PUBLISH until it is acknowledged
+ *
+ * Copies the serialized packet from the client TX buffer into the unacked publish table.
+ * If the table is full the oldest entry is dropped.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param packetId Packet identifier of the PUBLISH
+ * @param packetLen Length of the serialized packet in the TX buffer
+ */
+void aws_iot_mqtt_internal_store_unacked_publish(AWS_IoT_Client *pClient, uint16_t packetId, uint32_t packetLen) {
+#if AWS_IOT_MQTT_NUM_UNACKED_PUBLISHES > 0
+	UnackedPublish *pEntry;
+
+	if(AWS_IOT_MQTT_NUM_UNACKED_PUBLISHES == pClient->clientData.unackedPublishCount) {
+		IOT_WARN("Unacked publish table full, dropping packet %u",
+				 (unsigned int) pClient->clientData.unackedPublishes[0].packetId);
+		memmove(&pClient->clientData.unackedPublishes[0], &pClient->clientData.unackedPublishes[1],
+				sizeof(UnackedPublish) * (AWS_IOT_MQTT_NUM_UNACKED_PUBLISHES - 1));
+		pClient->clientData.unackedPublishCount--;
+	}
+
+	pEntry = &pClient->clientData.unackedPublishes[pClient->clientData.unackedPublishCount];
+	pEntry->packetId = packetId;
+	pEntry->packetLen = packetLen;
+	memcpy(pEntry->packet, pClient->clientData.writeBuf, packetLen);
+	pClient->clientData.unackedPublishCount++;
+#else
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(packetId);
+	IOT_UNUSED(packetLen);
+#endif
+}
+
+/**
+ * @brief Forget a QoS1 PUBLISH once its PUBACK was received
+ *
+ * @param pClient Reference to the IoT Client
+ * @param packetId Packet identifier from the PUBACK
+ */
+void aws_iot_mqtt_internal_remove_unacked_publish(AWS_IoT_Client *pClient, uint16_t packetId) {
+#if AWS_IOT_MQTT_NUM_UNACKED_PUBLISHES > 0
+	uint32_t itr;
+
+	for(itr = 0; itr < pClient->clientData.unackedPublishCount; itr++) {
+		if(packetId == pClient->clientData.unackedPublishes[itr].packetId) {
+			/* Acks usually arrive in order, so this is normally the last or only entry */
+			memmove(&pClient->clientData.unackedPublishes[itr], &pClient->clientData.unackedPublishes[itr + 1],
+					sizeof(UnackedPublish) * (pClient->clientData.unackedPublishCount - itr - 1));
+			pClient->clientData.unackedPublishCount--;
+			break;
+		}
+	}
+#else
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(packetId);
+#endif
+}
+
+/**
+ * @brief Drop all unacknowledged QoS1 publishes
+ *
+ * Called when the server did not resume the session, as per MQTT 3.1.1 specification 3.2.2.2
+ * the client must then discard its session state.
+ *
+ * @param pClient Reference to the IoT Client
+ */
+void aws_iot_mqtt_internal_clear_unacked_publishes(AWS_IoT_Client *pClient) {
+#if AWS_IOT_MQTT_NUM_UNACKED_PUBLISHES > 0
+	pClient->clientData.unackedPublishCount = 0;
+#else
+	IOT_UNUSED(pClient);
+#endif
+}
+
+/**
+ * @brief Redeliver unacknowledged QoS1 publishes after a session was resumed
+ *
+ * Sends every stored PUBLISH again, oldest first, with the DUP flag set. The PUBACKs are
+ * handled by the next yield, which removes the acknowledged entries.
+ *
+ * @param pClient Reference to the IoT Client
+ *
+ * @return An IoT Error Type defining successful/failed send
+ */
+IoT_Error_t aws_iot_mqtt_internal_resend_unacked_publishes(AWS_IoT_Client *pClient) {
+#if AWS_IOT_MQTT_NUM_UNACKED_PUBLISHES > 0
+	Timer timer;
+	uint32_t itr;
+	UnackedPublish *pEntry;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	for(itr = 0; itr < pClient->clientData.unackedPublishCount; itr++) {
+		pEntry = &pClient->clientData.unackedPublishes[itr];
+		/* DUP flag, MQTT 3.1.1 specification 3.3.1.1 */
+		pEntry->packet[0] |= 0x08;
+		memcpy(pClient->clientData.writeBuf, pEntry->packet, pEntry->packetLen);
+
+		init_timer(&timer);
+		countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
+		rc = aws_iot_mqtt_internal_send_packet(pClient, pEntry->packetLen, &timer);
+		if(SUCCESS != rc) {
+			FUNC_EXIT_RC(rc);
+		}
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+#else
+	IOT_UNUSED(pClient);
+	return SUCCESS;
+#endif
+}
+
 IoT_Error_t aws_iot_mqtt_publish(AWS_IoT_Client *pClient, const char *pTopicName, uint16_t topicNameLen,
 								 IoT_Publish_Message_Params *pParams) {
 	IoT_Error_t rc, pubRc;
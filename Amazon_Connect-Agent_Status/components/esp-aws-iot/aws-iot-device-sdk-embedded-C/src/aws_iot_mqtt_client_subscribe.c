@@ -160,7 +160,7 @@ static IoT_Error_t _aws_iot_mqtt_deserialize_suback(uint16_t *pPacketId, uint32_
 
 	*pGrantedQoSCount = 0;
 	while(curData < endData) {
-		if(*pGrantedQoSCount > maxExpectedQoSCount) {
+		if(*pGrantedQoSCount >= maxExpectedQoSCount) {
 			FUNC_EXIT_RC(FAILURE);
 		}
 		pGrantedQoSs[(*pGrantedQoSCount)++] = (QoS) aws_iot_mqtt_internal_read_char(&curData);
@@ -309,6 +309,208 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
 	FUNC_EXIT_RC(subRc);
 }
 
+/**
+ * @brief Count how many topics fit in a single SUBSCRIBE packet
+ *
+ * Starting from the first entry of the list, returns the number of topics whose
+ * serialized SUBSCRIBE packet still fits in a buffer of txBufLen bytes.
+ *
+ * @param txBufLen Size of the TX buffer
+ * @param topicCount Number of entries in pTopicNameLenList
+ * @param pTopicNameLenList Length of each topic filter
+ *
+ * @return Number of topics that fit, 0 if not even the first one does
+ */
+static uint32_t _aws_iot_mqtt_get_subscribe_batch_count(size_t txBufLen, uint32_t topicCount,
+														const uint16_t *pTopicNameLenList) {
+	uint32_t itr, rem_len;
+
+	rem_len = 2; /* packetId */
+	for(itr = 0; itr < topicCount; ++itr) {
+		rem_len += (uint32_t) (pTopicNameLenList[itr] + 2 + 1); /* topic + length + req_qos */
+		if(aws_iot_mqtt_internal_get_final_packet_length_from_remaining_length(rem_len) > txBufLen) {
+			break;
+		}
+	}
+
+	return itr;
+}
+
+/**
+ * @brief Subscribe to several MQTT topics with one SUBSCRIBE packet.
+ *
+ * Sends a single SUBSCRIBE for all given topic filters and waits for its SUBACK.
+ * Not meant to be called directly as it doesn't do validations, client state
+ * changes or message handler bookkeeping.
+ * @note Call is blocking.  The call returns after the receipt of the SUBACK control packet.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param topicCount Number of topic filters, at most AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS
+ * @param pTopicNameList Topic filters
+ * @param pTopicNameLenList Length of each topic filter
+ * @param pRequestedQoSs Requested QoS of each topic filter
+ * @param pGrantedQoSs Return code of each topic filter, the granted QoS or 0x80 for a refused filter
+ *
+ * @return An IoT Error Type defining successful/failed subscription. The SUBACK must
+ * acknowledge every topic filter of the packet for the call to succeed.
+ */
+static IoT_Error_t _aws_iot_mqtt_internal_subscribe_batch(AWS_IoT_Client *pClient, uint32_t topicCount,
+														  const char **pTopicNameList, uint16_t *pTopicNameLenList,
+														  QoS *pRequestedQoSs, QoS *pGrantedQoSs) {
+	uint16_t rxPacketId;
+	uint32_t serializedLen, count;
+	IoT_Error_t rc;
+	Timer timer;
+
+	FUNC_ENTRY;
+	init_timer(&timer);
+	countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
+
+	serializedLen = 0;
+	count = 0;
+	rxPacketId = 0;
+
+	rc = _aws_iot_mqtt_serialize_subscribe(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
+										   aws_iot_mqtt_get_next_packet_id(pClient), topicCount, pTopicNameList,
+										   pTopicNameLenList, pRequestedQoSs, &serializedLen);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	/* send the subscribe packet */
+	rc = aws_iot_mqtt_internal_send_packet(pClient, serializedLen, &timer);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	/* wait for suback */
+	rc = aws_iot_mqtt_internal_wait_for_read(pClient, SUBACK, &timer);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	/* Granted QoS can be 0, 1 or 2 */
+	rc = _aws_iot_mqtt_deserialize_suback(&rxPacketId, topicCount, &count, pGrantedQoSs, pClient->clientData.readBuf,
+										  pClient->clientData.readBufSize);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	/* One return code per topic filter, in order. MQTT3.1.1 specification 3.9.3 */
+	if(count != topicCount) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_mqtt_subscribe_batch(AWS_IoT_Client *pClient, IoT_Subscribe_Topic_Params *pTopicList,
+										 uint32_t topicCount) {
+	ClientState clientState;
+	IoT_Error_t rc, subRc;
+	uint32_t itr, freeCount, sent, batchCount, handlerItr;
+	bool isAnyRejected;
+	const char *topicNames[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	uint16_t topicNameLens[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	QoS qosList[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	QoS grantedQoS[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient || NULL == pTopicList || 0 == topicCount) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	for(itr = 0; itr < topicCount; itr++) {
+		if(NULL == pTopicList[itr].pTopicName || 0 == pTopicList[itr].topicNameLen
+		   || NULL == pTopicList[itr].pApplicationHandler) {
+			FUNC_EXIT_RC(NULL_VALUE_ERROR);
+		}
+	}
+
+	if(!aws_iot_mqtt_is_client_connected(pClient)) {
+		FUNC_EXIT_RC(NETWORK_DISCONNECTED_ERROR);
+	}
+
+	freeCount = 0;
+	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; itr++) {
+		if(NULL == pClient->clientData.messageHandlers[itr].topicName) {
+			freeCount++;
+		}
+	}
+	if(topicCount > freeCount) {
+		FUNC_EXIT_RC(MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR);
+	}
+
+	clientState = aws_iot_mqtt_get_client_state(pClient);
+	if(CLIENT_STATE_CONNECTED_IDLE != clientState && CLIENT_STATE_CONNECTED_WAIT_FOR_CB_RETURN != clientState) {
+		FUNC_EXIT_RC(MQTT_CLIENT_NOT_IDLE_ERROR);
+	}
+
+	rc = aws_iot_mqtt_set_client_state(pClient, clientState, CLIENT_STATE_CONNECTED_SUBSCRIBE_IN_PROGRESS);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	for(itr = 0; itr < topicCount; itr++) {
+		topicNames[itr] = pTopicList[itr].pTopicName;
+		topicNameLens[itr] = pTopicList[itr].topicNameLen;
+		qosList[itr] = pTopicList[itr].qos;
+		pTopicList[itr].isRejected = false;
+	}
+
+	/* Pack as many topic filters into each SUBSCRIBE as the TX buffer allows. Handlers are
+	 * registered per acknowledged packet, so on failure the earlier packets stay subscribed.
+	 * A filter the server refused gets no handler and does not stop the later packets. */
+	subRc = SUCCESS;
+	isAnyRejected = false;
+	handlerItr = 0;
+	for(sent = 0; sent < topicCount; sent += batchCount) {
+		batchCount = _aws_iot_mqtt_get_subscribe_batch_count(pClient->clientData.writeBufSize, topicCount - sent,
+															 &topicNameLens[sent]);
+		if(0 == batchCount) {
+			subRc = MQTT_TX_BUFFER_TOO_SHORT_ERROR;
+			break;
+		}
+
+		subRc = _aws_iot_mqtt_internal_subscribe_batch(pClient, batchCount, &topicNames[sent], &topicNameLens[sent],
+													   &qosList[sent], &grantedQoS[sent]);
+		if(SUCCESS != subRc) {
+			break;
+		}
+
+		for(itr = sent; itr < sent + batchCount; itr++) {
+			/* Failure return code. MQTT3.1.1 specification 3.9.3 */
+			if(0x80 == (uint8_t) grantedQoS[itr]) {
+				IOT_WARN("Subscription to %.*s refused", (int) pTopicList[itr].topicNameLen, pTopicList[itr].pTopicName);
+				pTopicList[itr].isRejected = true;
+				isAnyRejected = true;
+				continue;
+			}
+			while(NULL != pClient->clientData.messageHandlers[handlerItr].topicName) {
+				handlerItr++;
+			}
+			pClient->clientData.messageHandlers[handlerItr].topicName = pTopicList[itr].pTopicName;
+			pClient->clientData.messageHandlers[handlerItr].topicNameLen = pTopicList[itr].topicNameLen;
+			pClient->clientData.messageHandlers[handlerItr].pApplicationHandler = pTopicList[itr].pApplicationHandler;
+			pClient->clientData.messageHandlers[handlerItr].pApplicationHandlerData =
+					pTopicList[itr].pApplicationHandlerData;
+			pClient->clientData.messageHandlers[handlerItr].qos = pTopicList[itr].qos;
+		}
+	}
+
+	if(SUCCESS == subRc && isAnyRejected) {
+		subRc = MQTT_SUBSCRIBE_REJECTED_ERROR;
+	}
+
+	rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_SUBSCRIBE_IN_PROGRESS, clientState);
+	if(SUCCESS == subRc && SUCCESS != rc) {
+		subRc = rc;
+	}
+
+	FUNC_EXIT_RC(subRc);
+}
+
 /**
  * @brief Subscribe to an MQTT topic.
  *
@@ -318,25 +520,37 @@ IoT_Error_t aws_iot_mqtt_subscribe(AWS_IoT_Client *pClient, const char *pTopicNa
  * Not meant to be called directly as it doesn't do validations or client state changes
  * @note Call is blocking.  The call returns after the receipt of the SUBACK control packet.
  *
+ * All pending topic filters are packed into as few SUBSCRIBE packets as the TX buffer
+ * allows, so a reconnect with many subscriptions costs one round trip per packet rather
+ * than one per topic. Nothing is sent if the server resumed a persistent session.
+ *
  * @param pClient Reference to the IoT Client
  *
  * @return An IoT Error Type defining successful/failed subscription
  */
 static IoT_Error_t _aws_iot_mqtt_internal_resubscribe(AWS_IoT_Client *pClient) {
-	uint16_t packetId;
-	uint32_t len, count, existingSubCount, itr;
+	uint32_t itr, pendingCount, sent, batchCount;
+	uint32_t pendingIndex[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	const char *topicNames[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	uint16_t topicNameLens[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	QoS qosList[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
+	QoS grantedQoS[AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS];
 	IoT_Error_t rc;
-	Timer timer;
-	QoS grantedQoS[3] = {QOS0, QOS0, QOS0};
 
 	FUNC_ENTRY;
 
-	packetId = 0;
-	len = 0;
-	count = 0;
-	existingSubCount = _aws_iot_mqtt_get_free_message_handler_index(pClient);
+	/* A resumed session still holds all subscriptions on the server side */
+	if(pClient->clientStatus.isSessionPresent) {
+		for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; itr++) {
+			if(pClient->clientData.messageHandlers[itr].topicName != NULL) {
+				pClient->clientData.messageHandlers[itr].resubscribed = 1;
+			}
+		}
+		FUNC_EXIT_RC(SUCCESS);
+	}
 
-	for(itr = 0; itr < existingSubCount; itr++) {
+	pendingCount = 0;
+	for(itr = 0; itr < AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS; itr++) {
 		if(pClient->clientData.messageHandlers[itr].topicName == NULL) {
 			continue;
 		}
@@ -347,40 +561,31 @@ static IoT_Error_t _aws_iot_mqtt_internal_resubscribe(AWS_IoT_Client *pClient) {
 			continue;
 		}
 
-		init_timer(&timer);
-		countdown_ms(&timer, pClient->clientData.commandTimeoutMs);
-
-		rc = _aws_iot_mqtt_serialize_subscribe(pClient->clientData.writeBuf, pClient->clientData.writeBufSize, 0,
-											   aws_iot_mqtt_get_next_packet_id(pClient), 1,
-											   &(pClient->clientData.messageHandlers[itr].topicName),
-											   &(pClient->clientData.messageHandlers[itr].topicNameLen),
-											   &(pClient->clientData.messageHandlers[itr].qos), &len);
-		if(SUCCESS != rc) {
-			FUNC_EXIT_RC(rc);
-		}
+		pendingIndex[pendingCount] = itr;
+		topicNames[pendingCount] = pClient->clientData.messageHandlers[itr].topicName;
+		topicNameLens[pendingCount] = pClient->clientData.messageHandlers[itr].topicNameLen;
+		qosList[pendingCount] = pClient->clientData.messageHandlers[itr].qos;
+		pendingCount++;
+	}
 
-		/* send the subscribe packet */
-		rc = aws_iot_mqtt_internal_send_packet(pClient, len, &timer);
-		if(SUCCESS != rc) {
-			FUNC_EXIT_RC(rc);
+	for(sent = 0; sent < pendingCount; sent += batchCount) {
+		batchCount = _aws_iot_mqtt_get_subscribe_batch_count(pClient->clientData.writeBufSize, pendingCount - sent,
+															 &topicNameLens[sent]);
+		if(0 == batchCount) {
+			FUNC_EXIT_RC(MQTT_TX_BUFFER_TOO_SHORT_ERROR);
 		}
 
-		/* wait for suback */
-		rc = aws_iot_mqtt_internal_wait_for_read(pClient, SUBACK, &timer);
+		rc = _aws_iot_mqtt_internal_subscribe_batch(pClient, batchCount, &topicNames[sent], &topicNameLens[sent],
+													&qosList[sent], &grantedQoS[sent]);
 		if(SUCCESS != rc) {
 			FUNC_EXIT_RC(rc);
 		}
 
-		/* Granted QoS can be 0, 1 or 2 */
-		rc = _aws_iot_mqtt_deserialize_suback(&packetId, 1, &count, grantedQoS, pClient->clientData.readBuf,
-											  pClient->clientData.readBufSize);
-		if(SUCCESS != rc) {
-			FUNC_EXIT_RC(rc);
+		/* Record that these topics have been subscribed to, so that we do not
+		 * attempt to subscribe again to the same topics. */
+		for(itr = sent; itr < sent + batchCount; itr++) {
+			pClient->clientData.messageHandlers[pendingIndex[itr]].resubscribed = 1;
 		}
-
-		/* Record that this topic has been subscribed to, so that we do not
-		 * attempt to subscribe again to the same topic. */
-		pClient->clientData.messageHandlers[itr].resubscribed = 1;
 	}
 
 	FUNC_EXIT_RC(SUCCESS);
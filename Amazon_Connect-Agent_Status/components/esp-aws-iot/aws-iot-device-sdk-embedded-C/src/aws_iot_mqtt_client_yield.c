@@ -76,6 +76,7 @@ static IoT_Error_t _aws_iot_mqtt_handle_disconnect(AWS_IoT_Client *pClient) {
 
 
 static IoT_Error_t _aws_iot_mqtt_handle_reconnect(AWS_IoT_Client *pClient) {
+	IoT_Connection_Metrics *pMetrics = &(pClient->clientData.connectionMetrics);
 	IoT_Error_t rc;
 
 	FUNC_ENTRY;
@@ -92,8 +93,13 @@ static IoT_Error_t _aws_iot_mqtt_handle_reconnect(AWS_IoT_Client *pClient) {
 	}
 
 	if(NETWORK_PHYSICAL_LAYER_CONNECTED == rc) {
+		pClient->clientData.reconnectAttemptCount++;
 		rc = aws_iot_mqtt_attempt_reconnect(pClient);
 		if(NETWORK_RECONNECTED == rc) {
+			pMetrics->lastOutageMs = aws_iot_mqtt_internal_stopwatch_elapsed_ms(&(pClient->outageStopwatch));
+			pMetrics->lastOutageAttempts = pClient->clientData.reconnectAttemptCount;
+			pMetrics->reconnectCount++;
+
 			rc = aws_iot_mqtt_set_client_state(pClient, CLIENT_STATE_CONNECTED_IDLE,
 											   CLIENT_STATE_CONNECTED_YIELD_IN_PROGRESS);
 			if(SUCCESS != rc) {
@@ -103,12 +109,8 @@ static IoT_Error_t _aws_iot_mqtt_handle_reconnect(AWS_IoT_Client *pClient) {
 		}
 	}
 
-	pClient->clientData.currentReconnectWaitInterval *= 2;
-
-	if(AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL < pClient->clientData.currentReconnectWaitInterval) {
-		FUNC_EXIT_RC(NETWORK_RECONNECT_TIMED_OUT_ERROR);
-	}
-	countdown_ms(&(pClient->reconnectDelayTimer), pClient->clientData.currentReconnectWaitInterval);
+	/* Retry until reconnected, the backoff is capped at AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL */
+	countdown_ms(&(pClient->reconnectDelayTimer), aws_iot_mqtt_internal_next_backoff_ms(pClient, false));
 	FUNC_EXIT_RC(rc);
 }
 
@@ -177,6 +179,37 @@ static IoT_Error_t _aws_iot_mqtt_keep_alive(AWS_IoT_Client *pClient) {
 	FUNC_EXIT_RC(SUCCESS);
 }
 
+/**
+ * @brief Block until the client has something to do
+ *
+ * Used when the network stack supports waiting on socket readability. Sleeps until
+ * data arrives, the next keep-alive deadline (PINGREQ due or PINGRESP overdue), the
+ * yield timer expires or the application calls aws_iot_mqtt_yield_wakeup.
+ *
+ * @param pClient Reference to the IoT Client
+ * @param pYieldTimer Timer tracking the remaining yield time
+ *
+ * @return SUCCESS if data is readable, NETWORK_SSL_NOTHING_TO_READ if a deadline was reached,
+ *         NETWORK_WAKEUP_REQUESTED if woken up by the application or a network error code
+ */
+static IoT_Error_t _aws_iot_mqtt_wait_for_event(AWS_IoT_Client *pClient, Timer *pYieldTimer) {
+	uint32_t waitMs, keepAliveMs;
+
+	waitMs = left_ms(pYieldTimer);
+	if(0 != pClient->clientData.keepAliveInterval) {
+		if(pClient->clientStatus.isPingOutstanding) {
+			keepAliveMs = left_ms(&(pClient->pingRespTimer));
+		} else {
+			keepAliveMs = left_ms(&(pClient->pingReqTimer));
+		}
+		if(keepAliveMs < waitMs) {
+			waitMs = keepAliveMs;
+		}
+	}
+
+	return pClient->networkStack.waitForReadable(&(pClient->networkStack), waitMs);
+}
+
 /**
  * @brief Yield to the MQTT client
  *
@@ -219,17 +252,29 @@ static IoT_Error_t _aws_iot_mqtt_internal_yield(AWS_IoT_Client *pClient, uint32_
 		 subsequent invocations only attempt remaining subscribes.  */
 		if((CLIENT_STATE_PENDING_RECONNECT == clientState) ||
 			(CLIENT_STATE_CONNECTED_RESUBSCRIBE_IN_PROGRESS == clientState)) {
-			if(AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL < pClient->clientData.currentReconnectWaitInterval) {
-				yieldRc = NETWORK_RECONNECT_TIMED_OUT_ERROR;
-				break;
-			}
 			yieldRc = _aws_iot_mqtt_handle_reconnect(pClient);
 			/* Network reconnect attempted, check if yield timer expired before
 			 * doing anything else */
 			continue;
 		}
 
-		yieldRc = aws_iot_mqtt_internal_cycle_read(pClient, &timer, &packet_type);
+		if(NULL != pClient->networkStack.waitForReadable) {
+			yieldRc = _aws_iot_mqtt_wait_for_event(pClient, &timer);
+			if(NETWORK_WAKEUP_REQUESTED == yieldRc) {
+				/* Application asked for control back, nothing to process */
+				yieldRc = SUCCESS;
+				break;
+			}
+			if(SUCCESS == yieldRc) {
+				yieldRc = aws_iot_mqtt_internal_cycle_read(pClient, &timer, &packet_type);
+			} else if(NETWORK_SSL_NOTHING_TO_READ == yieldRc) {
+				/* Deadline reached without data, only keep-alive needs servicing */
+				yieldRc = SUCCESS;
+			}
+		} else {
+			yieldRc = aws_iot_mqtt_internal_cycle_read(pClient, &timer, &packet_type);
+		}
+
 		if(SUCCESS == yieldRc) {
 			yieldRc = _aws_iot_mqtt_keep_alive(pClient);
 		} else {
@@ -253,8 +298,9 @@ static IoT_Error_t _aws_iot_mqtt_internal_yield(AWS_IoT_Client *pClient, uint32_
 					FUNC_EXIT_RC(yieldRc);
 				}
 
-				pClient->clientData.currentReconnectWaitInterval = AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL;
-				countdown_ms(&(pClient->reconnectDelayTimer), pClient->clientData.currentReconnectWaitInterval);
+				pClient->clientData.reconnectAttemptCount = 0;
+				aws_iot_mqtt_internal_stopwatch_start(&(pClient->outageStopwatch));
+				countdown_ms(&(pClient->reconnectDelayTimer), aws_iot_mqtt_internal_next_backoff_ms(pClient, true));
 
 				/* Depending on timer values, it is possible that yield timer has expired
 				 * Set to rc to attempting reconnect to inform client that autoreconnect
@@ -271,6 +317,23 @@ static IoT_Error_t _aws_iot_mqtt_internal_yield(AWS_IoT_Client *pClient, uint32_
 	FUNC_EXIT_RC(yieldRc);
 }
 
+IoT_Error_t aws_iot_mqtt_yield_wakeup(AWS_IoT_Client *pClient) {
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(NULL == pClient->networkStack.wakeup) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	rc = pClient->networkStack.wakeup(&(pClient->networkStack));
+	FUNC_EXIT_RC(rc);
+}
+
 IoT_Error_t aws_iot_mqtt_yield(AWS_IoT_Client *pClient, uint32_t timeout_ms) {
 	IoT_Error_t rc, yieldRc;
 	ClientState clientState;
@@ -24,9 +24,11 @@ extern "C" {
 
 #include "aws_iot_shadow_json.h"
 
+#include <math.h>
 #include <string.h>
 #include <stdbool.h>
 
+#include "aws_iot_json_stream.h"
 #include "aws_iot_json_utils.h"
 #include "aws_iot_log.h"
 #include "aws_iot_shadow_key.h"
@@ -36,15 +38,11 @@ extern char mqttClientID[MAX_SIZE_OF_UNIQUE_CLIENT_ID_BYTES];
 #define AWS_IOT_SHADOW_CLIENT_TOKEN_KEY "{\"clientToken\":\""
 static uint32_t clientTokenNum = 0;
 
-//helper functions
-static IoT_Error_t convertDataToString(char *pStringBuffer, size_t maxSizoStringBuffer, JsonPrimitiveType type,
-									   void *pData);
-
 void resetClientTokenSequenceNum(void) {
 	clientTokenNum = 0;
 }
 
-static IoT_Error_t emptyJsonWithClientToken(char *pBuffer, size_t bufferSize) {
+static IoT_Error_t emptyJsonWithClientToken(char *pBuffer, size_t bufferSize, uint32_t *pClientTokenNum) {
 
     IoT_Error_t rc = SUCCESS;
     size_t dataLenInBuffer = 0;
@@ -62,7 +60,7 @@ static IoT_Error_t emptyJsonWithClientToken(char *pBuffer, size_t bufferSize) {
 	{
 	    if ( dataLenInBuffer < bufferSize )
 	    {
-	        dataLenInBuffer += (size_t)snprintf(pBuffer + dataLenInBuffer, bufferSize - dataLenInBuffer, "%s-%d", mqttClientID, ( int )clientTokenNum++);
+	        dataLenInBuffer += (size_t)snprintf(pBuffer + dataLenInBuffer, bufferSize - dataLenInBuffer, "%s-%d", mqttClientID, ( int )(*pClientTokenNum)++);
 	    }
 	    else
 	    {
@@ -93,11 +91,15 @@ static IoT_Error_t emptyJsonWithClientToken(char *pBuffer, size_t bufferSize) {
 }
 
 IoT_Error_t aws_iot_shadow_internal_get_request_json(char *pBuffer, size_t bufferSize) {
-	return emptyJsonWithClientToken( pBuffer, bufferSize);
+	return emptyJsonWithClientToken( pBuffer, bufferSize, &clientTokenNum);
 }
 
 IoT_Error_t aws_iot_shadow_internal_delete_request_json(char *pBuffer, size_t bufferSize ) {
-	return emptyJsonWithClientToken( pBuffer, bufferSize);
+	return emptyJsonWithClientToken( pBuffer, bufferSize, &clientTokenNum);
+}
+
+IoT_Error_t aws_iot_shadow_internal_token_request_json(char *pBuffer, size_t bufferSize, uint32_t *pClientTokenNum) {
+	return emptyJsonWithClientToken( pBuffer, bufferSize, pClientTokenNum);
 }
 
 static inline IoT_Error_t checkReturnValueOfSnPrintf(int32_t snPrintfReturn, size_t maxSizeOfJsonDocument) {
@@ -109,161 +111,405 @@ static inline IoT_Error_t checkReturnValueOfSnPrintf(int32_t snPrintfReturn, siz
 	return SUCCESS;
 }
 
-IoT_Error_t aws_iot_shadow_init_json_document(char *pJsonDocument, size_t maxSizeOfJsonDocument) {
+#define SHADOW_JSON_STATE_OPEN "{\"state\":{"
+#define SHADOW_JSON_REPORTED_OPEN "\"reported\":{"
+#define SHADOW_JSON_DESIRED_OPEN "\"desired\":{"
+#define SHADOW_JSON_CLIENT_TOKEN_OPEN "}, \"" SHADOW_CLIENT_TOKEN_STRING "\":\""
 
-	IoT_Error_t ret_val = SUCCESS;
-	int32_t snPrintfReturn = 0;
+/* Magnitudes below this are scaled to millionths in a double without losing the rounding of "%f" */
+#define SHADOW_JSON_FAST_DOUBLE_LIMIT 1e9
 
-	if(pJsonDocument == NULL) {
-		return NULL_VALUE_ERROR;
+#define SHADOW_JSON_LITERAL(pBuilder, literal) builderAppend((pBuilder), (literal), sizeof(literal) - 1)
+
+/* Appends like snprintf would: what does not fit is cut off and the document stays null terminated */
+static IoT_Error_t builderAppend(ShadowJsonBuilder_t *pBuilder, const char *pData, size_t dataLen) {
+	size_t remaining = pBuilder->bufferSize - pBuilder->length;
+
+	if(remaining == 0) {
+		return SHADOW_JSON_BUFFER_TRUNCATED;
+	}
+	if(dataLen >= remaining) {
+		memcpy(pBuilder->pBuffer + pBuilder->length, pData, remaining - 1);
+		pBuilder->length = pBuilder->bufferSize - 1;
+		pBuilder->pBuffer[pBuilder->length] = '\0';
+		return SHADOW_JSON_BUFFER_TRUNCATED;
 	}
-	snPrintfReturn = snprintf(pJsonDocument, maxSizeOfJsonDocument, "{\"state\":{");
+	memcpy(pBuilder->pBuffer + pBuilder->length, pData, dataLen);
+	pBuilder->length += dataLen;
+	pBuilder->pBuffer[pBuilder->length] = '\0';
+	return SUCCESS;
+}
 
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, maxSizeOfJsonDocument);
+static IoT_Error_t builderCheckSpace(const ShadowJsonBuilder_t *pBuilder) {
+	if(pBuilder->bufferSize - pBuilder->length <= 1) {
+		return SHADOW_JSON_ERROR;
+	}
+	return SUCCESS;
+}
 
-	return ret_val;
+/* Writes the digits of value so that they end just before pEnd and returns the first one */
+static char *encodeUnsigned(char *pEnd, uint32_t value) {
+	do {
+		*--pEnd = (char) ('0' + (value % 10));
+		value /= 10;
+	} while(value != 0);
+	return pEnd;
+}
+
+static char *encodeSigned(char *pEnd, int32_t value) {
+	char *pStart;
 
+	if(value < 0) {
+		pStart = encodeUnsigned(pEnd, 0u - (uint32_t) value);
+		*--pStart = '-';
+		return pStart;
+	}
+	return encodeUnsigned(pEnd, (uint32_t) value);
 }
 
-IoT_Error_t aws_iot_shadow_add_desired(char *pJsonDocument, size_t maxSizeOfJsonDocument, uint8_t count, ...) {
-	IoT_Error_t ret_val = SUCCESS;
-	size_t tempSize = 0;
-	int8_t i;
-	size_t remSizeOfJsonBuffer = maxSizeOfJsonDocument;
-	int32_t snPrintfReturn = 0;
-	va_list pArgs;
-	jsonStruct_t *pTemporary = NULL;
-	va_start(pArgs, count);
+static IoT_Error_t builderAppendUnsigned(ShadowJsonBuilder_t *pBuilder, uint32_t value) {
+	char digits[12];
+	char *pEnd = digits + sizeof(digits);
+	char *pStart = encodeUnsigned(pEnd, value);
 
-	if(pJsonDocument == NULL) {
-		va_end(pArgs);
-		return NULL_VALUE_ERROR;
+	return builderAppend(pBuilder, pStart, (size_t) (pEnd - pStart));
+}
+
+static IoT_Error_t builderAppendSigned(ShadowJsonBuilder_t *pBuilder, int32_t value) {
+	char digits[12];
+	char *pEnd = digits + sizeof(digits);
+	char *pStart = encodeSigned(pEnd, value);
+
+	return builderAppend(pBuilder, pStart, (size_t) (pEnd - pStart));
+}
+
+/**
+ * Same text as "%f". The value is scaled to millionths and rounded to the nearest integer, which is what printf
+ * does with the exact binary value. Scaling can be off by up to 1/16 of a unit below the limit, so fractions
+ * too close to one half to be sure about, and values the fast path does not cover, go through snprintf.
+ */
+static IoT_Error_t builderAppendDouble(ShadowJsonBuilder_t *pBuilder, double value) {
+	char text[24];
+	char *pEnd = text + sizeof(text);
+	char *pStart;
+	double magnitude = signbit(value) ? -value : value;
+	double scaled;
+	double fraction;
+	uint64_t millionths;
+	uint32_t wholePart;
+	uint32_t fractionPart;
+	uint8_t i;
+	int printed;
+	size_t remaining;
+
+	if(magnitude < SHADOW_JSON_FAST_DOUBLE_LIMIT) {
+		scaled = magnitude * 1e6;
+		millionths = (uint64_t) scaled;
+		fraction = scaled - (double) millionths;
+		if(fraction <= 0.375 || fraction >= 0.625) {
+			if(fraction >= 0.625) {
+				millionths++;
+			}
+			wholePart = (uint32_t) (millionths / 1000000u);
+			fractionPart = (uint32_t) (millionths - (uint64_t) wholePart * 1000000u);
+			pStart = pEnd;
+			for(i = 0; i < 6; i++) {
+				*--pStart = (char) ('0' + (fractionPart % 10));
+				fractionPart /= 10;
+			}
+			*--pStart = '.';
+			pStart = encodeUnsigned(pStart, wholePart);
+			if(signbit(value)) {
+				*--pStart = '-';
+			}
+			return builderAppend(pBuilder, pStart, (size_t) (pEnd - pStart));
+		}
 	}
 
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
-		va_end(pArgs);
+	remaining = pBuilder->bufferSize - pBuilder->length;
+	printed = snprintf(pBuilder->pBuffer + pBuilder->length, remaining, "%f", value);
+	if(printed < 0) {
 		return SHADOW_JSON_ERROR;
 	}
-	remSizeOfJsonBuffer = tempSize;
-
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"desired\":{");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
-
-	if(ret_val != SUCCESS) {
-		va_end(pArgs);
-		return ret_val;
+	if((size_t) printed >= remaining) {
+		pBuilder->length = pBuilder->bufferSize - 1;
+		return SHADOW_JSON_BUFFER_TRUNCATED;
 	}
+	pBuilder->length += (size_t) printed;
+	return SUCCESS;
+}
 
-	for(i = 0; i < count; i++) {
-		tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-		if(tempSize <= 1) {
-			va_end(pArgs);
-			return SHADOW_JSON_ERROR;
-		}
-		remSizeOfJsonBuffer = tempSize;
-		pTemporary = va_arg (pArgs, jsonStruct_t *);
-		if(pTemporary != NULL) {
-			snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"%s\":",
-									  pTemporary->pKey);
-			ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
-			if(ret_val != SUCCESS) {
-				va_end(pArgs);
-				return ret_val;
-			}
-			if(pTemporary->pKey != NULL && pTemporary->pData != NULL) {
-				ret_val = convertDataToString(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer,
-											  pTemporary->type, pTemporary->pData);
+static IoT_Error_t builderAppendValue(ShadowJsonBuilder_t *pBuilder, JsonPrimitiveType type, const void *pData) {
+	IoT_Error_t rc = SUCCESS;
+
+	switch(type) {
+		case SHADOW_JSON_INT32:
+			rc = builderAppendSigned(pBuilder, *(const int32_t *) pData);
+			break;
+		case SHADOW_JSON_INT16:
+			rc = builderAppendSigned(pBuilder, *(const int16_t *) pData);
+			break;
+		case SHADOW_JSON_INT8:
+			rc = builderAppendSigned(pBuilder, *(const int8_t *) pData);
+			break;
+		case SHADOW_JSON_UINT32:
+			rc = builderAppendUnsigned(pBuilder, *(const uint32_t *) pData);
+			break;
+		case SHADOW_JSON_UINT16:
+			rc = builderAppendUnsigned(pBuilder, *(const uint16_t *) pData);
+			break;
+		case SHADOW_JSON_UINT8:
+			rc = builderAppendUnsigned(pBuilder, *(const uint8_t *) pData);
+			break;
+		case SHADOW_JSON_DOUBLE:
+			rc = builderAppendDouble(pBuilder, *(const double *) pData);
+			break;
+		case SHADOW_JSON_FLOAT:
+			rc = builderAppendDouble(pBuilder, *(const float *) pData);
+			break;
+		case SHADOW_JSON_BOOL:
+			if(*(const bool *) pData) {
+				rc = SHADOW_JSON_LITERAL(pBuilder, "true");
 			} else {
-				va_end(pArgs);
-				return NULL_VALUE_ERROR;
+				rc = SHADOW_JSON_LITERAL(pBuilder, "false");
 			}
-			if(ret_val != SUCCESS) {
-				va_end(pArgs);
-				return ret_val;
+			break;
+		case SHADOW_JSON_STRING:
+			rc = SHADOW_JSON_LITERAL(pBuilder, "\"");
+			if(rc == SUCCESS) {
+				rc = builderAppend(pBuilder, (const char *) pData, strlen((const char *) pData));
 			}
-		} else {
-			va_end(pArgs);
-			return NULL_VALUE_ERROR;
+			if(rc == SUCCESS) {
+				rc = SHADOW_JSON_LITERAL(pBuilder, "\"");
+			}
+			break;
+		case SHADOW_JSON_OBJECT:
+			rc = builderAppend(pBuilder, (const char *) pData, strlen((const char *) pData));
+			break;
+		default:
+			break;
+	}
+
+	return rc;
+}
+
+static IoT_Error_t builderAddMember(ShadowJsonBuilder_t *pBuilder, const jsonStruct_t *pStruct) {
+	IoT_Error_t rc;
+
+	rc = builderCheckSpace(pBuilder);
+	if(rc != SUCCESS) {
+		return rc;
+	}
+	if(pStruct == NULL || pStruct->pKey == NULL || pStruct->pData == NULL) {
+		return NULL_VALUE_ERROR;
+	}
+
+	rc = SHADOW_JSON_LITERAL(pBuilder, "\"");
+	if(rc == SUCCESS) {
+		rc = builderAppend(pBuilder, pStruct->pKey, strlen(pStruct->pKey));
+	}
+	if(rc == SUCCESS) {
+		rc = SHADOW_JSON_LITERAL(pBuilder, "\":");
+	}
+	if(rc == SUCCESS) {
+		rc = builderAppendValue(pBuilder, pStruct->type, pStruct->pData);
+	}
+	if(rc == SUCCESS) {
+		rc = SHADOW_JSON_LITERAL(pBuilder, ",");
+	}
+
+	return rc;
+}
+
+/* Members come either from pArgs or from ppStructs, whichever is not NULL */
+static IoT_Error_t builderAddSection(ShadowJsonBuilder_t *pBuilder, const char *pOpen, size_t openLen, uint8_t count,
+									 va_list *pArgs, jsonStruct_t *const *ppStructs) {
+	IoT_Error_t rc;
+	uint8_t i;
+	const jsonStruct_t *pStruct;
+
+	rc = builderCheckSpace(pBuilder);
+	if(rc != SUCCESS) {
+		return rc;
+	}
+	rc = builderAppend(pBuilder, pOpen, openLen);
+	if(rc != SUCCESS) {
+		return rc;
+	}
+
+	for(i = 0; i < count; i++) {
+		pStruct = (pArgs != NULL) ? va_arg(*pArgs, jsonStruct_t *) : ppStructs[i];
+		rc = builderAddMember(pBuilder, pStruct);
+		if(rc != SUCCESS) {
+			return rc;
 		}
 	}
 
-	va_end(pArgs);
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument) - 1, remSizeOfJsonBuffer, "},");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
-	return ret_val;
+	// Replace the comma after the last member, if there is one
+	if(pBuilder->length > 0 && pBuilder->pBuffer[pBuilder->length - 1] == ',') {
+		pBuilder->length--;
+	}
+	return SHADOW_JSON_LITERAL(pBuilder, "},");
 }
 
-IoT_Error_t aws_iot_shadow_add_reported(char *pJsonDocument, size_t maxSizeOfJsonDocument, uint8_t count, ...) {
-	IoT_Error_t ret_val = SUCCESS;
+static IoT_Error_t builderFinalize(ShadowJsonBuilder_t *pBuilder, uint32_t *pClientTokenNum) {
+	IoT_Error_t rc;
+	char digits[12];
+	char *pEnd = digits + sizeof(digits);
+	char *pStart;
 
-	int8_t i;
-	size_t remSizeOfJsonBuffer = maxSizeOfJsonDocument;
-	int32_t snPrintfReturn = 0;
-	size_t tempSize = 0;
-	jsonStruct_t *pTemporary;
-	va_list pArgs;
-	va_start(pArgs, count);
+	rc = builderCheckSpace(pBuilder);
+	if(rc != SUCCESS) {
+		return rc;
+	}
 
+	// Drop the comma that follows the last section
+	if(pBuilder->length > 0 && pBuilder->pBuffer[pBuilder->length - 1] == ',') {
+		pBuilder->length--;
+	}
+	rc = SHADOW_JSON_LITERAL(pBuilder, SHADOW_JSON_CLIENT_TOKEN_OPEN);
+	if(rc != SUCCESS) {
+		return rc;
+	}
+
+	rc = builderCheckSpace(pBuilder);
+	if(rc != SUCCESS) {
+		return rc;
+	}
+	pStart = encodeSigned(pEnd, (int32_t) (*pClientTokenNum)++);
+	*--pStart = '-';
+	rc = builderAppend(pBuilder, mqttClientID, strlen(mqttClientID));
+	if(rc == SUCCESS) {
+		rc = builderAppend(pBuilder, pStart, (size_t) (pEnd - pStart));
+	}
+	if(rc != SUCCESS) {
+		return rc;
+	}
+
+	rc = builderCheckSpace(pBuilder);
+	if(rc != SUCCESS) {
+		return rc;
+	}
+	return SHADOW_JSON_LITERAL(pBuilder, "\"}");
+}
+
+/* Picks up a document started by aws_iot_shadow_init_json_document, this is the one strlen per call */
+static IoT_Error_t builderResume(ShadowJsonBuilder_t *pBuilder, char *pJsonDocument, size_t maxSizeOfJsonDocument) {
 	if(pJsonDocument == NULL) {
-		va_end(pArgs);
 		return NULL_VALUE_ERROR;
 	}
+	pBuilder->pBuffer = pJsonDocument;
+	pBuilder->bufferSize = maxSizeOfJsonDocument;
+	pBuilder->length = strlen(pJsonDocument);
+	if(pBuilder->length >= maxSizeOfJsonDocument) {
+		return SHADOW_JSON_ERROR;
+	}
+	return SUCCESS;
+}
 
+IoT_Error_t aws_iot_shadow_json_builder_init(ShadowJsonBuilder_t *pBuilder, char *pJsonDocument,
+											 size_t maxSizeOfJsonDocument) {
+	if(pBuilder == NULL || pJsonDocument == NULL) {
+		return NULL_VALUE_ERROR;
+	}
+	pBuilder->pBuffer = pJsonDocument;
+	pBuilder->bufferSize = maxSizeOfJsonDocument;
+	pBuilder->length = 0;
+	if(maxSizeOfJsonDocument > 0) {
+		pJsonDocument[0] = '\0';
+	}
+	return SHADOW_JSON_LITERAL(pBuilder, SHADOW_JSON_STATE_OPEN);
+}
 
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
-		va_end(pArgs);
-		return SHADOW_JSON_ERROR;
+IoT_Error_t aws_iot_shadow_json_builder_add_reported(ShadowJsonBuilder_t *pBuilder, uint8_t count, ...) {
+	IoT_Error_t rc;
+	va_list pArgs;
+
+	if(pBuilder == NULL || pBuilder->pBuffer == NULL) {
+		return NULL_VALUE_ERROR;
 	}
-	remSizeOfJsonBuffer = tempSize;
+	va_start(pArgs, count);
+	rc = builderAddSection(pBuilder, SHADOW_JSON_REPORTED_OPEN, sizeof(SHADOW_JSON_REPORTED_OPEN) - 1, count, &pArgs,
+						   NULL);
+	va_end(pArgs);
+	return rc;
+}
 
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"reported\":{");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+IoT_Error_t aws_iot_shadow_json_builder_add_desired(ShadowJsonBuilder_t *pBuilder, uint8_t count, ...) {
+	IoT_Error_t rc;
+	va_list pArgs;
 
-	if(ret_val != SUCCESS) {
-		va_end(pArgs);
-		return ret_val;
+	if(pBuilder == NULL || pBuilder->pBuffer == NULL) {
+		return NULL_VALUE_ERROR;
 	}
+	va_start(pArgs, count);
+	rc = builderAddSection(pBuilder, SHADOW_JSON_DESIRED_OPEN, sizeof(SHADOW_JSON_DESIRED_OPEN) - 1, count, &pArgs,
+						   NULL);
+	va_end(pArgs);
+	return rc;
+}
 
-	for(i = 0; i < count; i++) {
-		tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-		if(tempSize <= 1) {
-			va_end(pArgs);
-			return SHADOW_JSON_ERROR;
-		}
-		remSizeOfJsonBuffer = tempSize;
-
-		pTemporary = va_arg (pArgs, jsonStruct_t *);
-		if(pTemporary != NULL) {
-			snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"%s\":",
-									  pTemporary->pKey);
-			ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
-			if(ret_val != SUCCESS) {
-				va_end(pArgs);
-				return ret_val;
-			}
-			if(pTemporary->pKey != NULL && pTemporary->pData != NULL) {
-				ret_val = convertDataToString(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer,
-											  pTemporary->type, pTemporary->pData);
-			} else {
-				va_end(pArgs);
-				return NULL_VALUE_ERROR;
-			}
-			if(ret_val != SUCCESS) {
-				va_end(pArgs);
-				return ret_val;
-			}
-		} else {
-			va_end(pArgs);
-			return NULL_VALUE_ERROR;
-		}
+IoT_Error_t aws_iot_shadow_json_builder_add_reported_array(ShadowJsonBuilder_t *pBuilder, uint8_t count,
+														   jsonStruct_t *const *ppStructs) {
+	if(pBuilder == NULL || pBuilder->pBuffer == NULL || (count > 0 && ppStructs == NULL)) {
+		return NULL_VALUE_ERROR;
+	}
+	return builderAddSection(pBuilder, SHADOW_JSON_REPORTED_OPEN, sizeof(SHADOW_JSON_REPORTED_OPEN) - 1, count, NULL,
+							 ppStructs);
+}
+
+IoT_Error_t aws_iot_shadow_json_builder_add_desired_array(ShadowJsonBuilder_t *pBuilder, uint8_t count,
+														  jsonStruct_t *const *ppStructs) {
+	if(pBuilder == NULL || pBuilder->pBuffer == NULL || (count > 0 && ppStructs == NULL)) {
+		return NULL_VALUE_ERROR;
+	}
+	return builderAddSection(pBuilder, SHADOW_JSON_DESIRED_OPEN, sizeof(SHADOW_JSON_DESIRED_OPEN) - 1, count, NULL,
+							 ppStructs);
+}
+
+IoT_Error_t aws_iot_shadow_json_builder_finalize(ShadowJsonBuilder_t *pBuilder) {
+	if(pBuilder == NULL || pBuilder->pBuffer == NULL) {
+		return NULL_VALUE_ERROR;
+	}
+	return builderFinalize(pBuilder, &clientTokenNum);
+}
+
+IoT_Error_t aws_iot_shadow_init_json_document(char *pJsonDocument, size_t maxSizeOfJsonDocument) {
+	ShadowJsonBuilder_t builder;
+
+	return aws_iot_shadow_json_builder_init(&builder, pJsonDocument, maxSizeOfJsonDocument);
+}
+
+IoT_Error_t aws_iot_shadow_add_desired(char *pJsonDocument, size_t maxSizeOfJsonDocument, uint8_t count, ...) {
+	IoT_Error_t rc;
+	ShadowJsonBuilder_t builder;
+	va_list pArgs;
+
+	rc = builderResume(&builder, pJsonDocument, maxSizeOfJsonDocument);
+	if(rc != SUCCESS) {
+		return rc;
 	}
+	va_start(pArgs, count);
+	rc = builderAddSection(&builder, SHADOW_JSON_DESIRED_OPEN, sizeof(SHADOW_JSON_DESIRED_OPEN) - 1, count, &pArgs,
+						   NULL);
+	va_end(pArgs);
+	return rc;
+}
 
+IoT_Error_t aws_iot_shadow_add_reported(char *pJsonDocument, size_t maxSizeOfJsonDocument, uint8_t count, ...) {
+	IoT_Error_t rc;
+	ShadowJsonBuilder_t builder;
+	va_list pArgs;
+
+	rc = builderResume(&builder, pJsonDocument, maxSizeOfJsonDocument);
+	if(rc != SUCCESS) {
+		return rc;
+	}
+	va_start(pArgs, count);
+	rc = builderAddSection(&builder, SHADOW_JSON_REPORTED_OPEN, sizeof(SHADOW_JSON_REPORTED_OPEN) - 1, count, &pArgs,
+						   NULL);
 	va_end(pArgs);
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument) - 1, remSizeOfJsonBuffer, "},");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
-	return ret_val;
+	return rc;
 }
 
 
@@ -284,107 +530,80 @@ IoT_Error_t aws_iot_fill_with_client_token(char *pBufferToBeUpdatedWithClientTok
 }
 
 IoT_Error_t aws_iot_finalize_json_document(char *pJsonDocument, size_t maxSizeOfJsonDocument) {
-	size_t remSizeOfJsonBuffer = maxSizeOfJsonDocument;
-	int32_t snPrintfReturn = 0;
-	size_t tempSize = 0;
-	IoT_Error_t ret_val = SUCCESS;
+	IoT_Error_t rc;
+	ShadowJsonBuilder_t builder;
 
-	if(pJsonDocument == NULL) {
-		return NULL_VALUE_ERROR;
+	rc = builderResume(&builder, pJsonDocument, maxSizeOfJsonDocument);
+	if(rc != SUCCESS) {
+		return rc;
 	}
+	return builderFinalize(&builder, &clientTokenNum);
+}
 
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
-		return SHADOW_JSON_ERROR;
+IoT_Error_t aws_iot_shadow_internal_finalize_json_document(char *pJsonDocument, size_t maxSizeOfJsonDocument,
+														   uint32_t *pClientTokenNum) {
+	IoT_Error_t rc;
+	ShadowJsonBuilder_t builder;
+
+	rc = builderResume(&builder, pJsonDocument, maxSizeOfJsonDocument);
+	if(rc != SUCCESS) {
+		return rc;
 	}
-	remSizeOfJsonBuffer = tempSize;
+	return builderFinalize(&builder, pClientTokenNum);
+}
 
-	// strlen(ShadowTxBuffer) - 1 is to ensure we remove the last ,(comma) that was added
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument) - 1, remSizeOfJsonBuffer, "}, \"%s\":\"",
-							  SHADOW_CLIENT_TOKEN_STRING);
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+/* Tokens of the Thing Shadow client, used when no pJsonHandler is given */
+static ShadowJsonTokens_t sharedJsonTokens;
 
-	if(ret_val != SUCCESS) {
-		return ret_val;
-	}
-	// refactor this XXX repeated code
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
-		return SHADOW_JSON_ERROR;
-	}
-	remSizeOfJsonBuffer = tempSize;
+/* Tokens new views are made from */
+static ShadowJsonTokens_t *pViewJsonTokens = &sharedJsonTokens;
+
+/* Counts parses of all token sets, so a view can tell its tokens were replaced */
+static uint32_t parsedJsonGeneration = 0;
 
+static ShadowJsonTokens_t *getJsonTokens(void *pJsonHandler) {
+	return (NULL != pJsonHandler) ? (ShadowJsonTokens_t *) pJsonHandler : &sharedJsonTokens;
+}
 
-	snPrintfReturn = FillWithClientTokenSize(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer);
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+static int32_t parseJsonDocument(ShadowJsonTokens_t *pTokens, const char *pJsonDocument, size_t jsonSize) {
+	jsmn_parser parser;
+	int32_t tokenCount;
 
-	if(ret_val != SUCCESS) {
-		return ret_val;
-	}
-	tempSize = maxSizeOfJsonDocument - strlen(pJsonDocument);
-	if(tempSize <= 1) {
-		return SHADOW_JSON_ERROR;
-	}
-	remSizeOfJsonBuffer = tempSize;
+	jsmn_init(&parser);
 
+	tokenCount = jsmn_parse(&parser, pJsonDocument, jsonSize, pTokens->tokens,
+							sizeof(pTokens->tokens) / sizeof(pTokens->tokens[0]));
 
-	snPrintfReturn = snprintf(pJsonDocument + strlen(pJsonDocument), remSizeOfJsonBuffer, "\"}");
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, remSizeOfJsonBuffer);
+	/* Views of the previous document are stale from here on */
+	pTokens->generation = ++parsedJsonGeneration;
+	pTokens->pJsonDocument = (tokenCount > 0) ? pJsonDocument : NULL;
+	pTokens->tokenCount = (tokenCount > 0) ? tokenCount : 0;
 
-	return ret_val;
+	return tokenCount;
 }
 
-static IoT_Error_t convertDataToString(char *pStringBuffer, size_t maxSizoStringBuffer, JsonPrimitiveType type,
-									   void *pData) {
-	int32_t snPrintfReturn = 0;
-	IoT_Error_t ret_val = SUCCESS;
+void invalidateParsedJson(const char *pJsonDocument, void *pJsonHandler) {
+	ShadowJsonTokens_t *pTokens = getJsonTokens(pJsonHandler);
 
-	if(maxSizoStringBuffer == 0) {
-		return SHADOW_JSON_ERROR;
+	if(pJsonDocument == pTokens->pJsonDocument) {
+		pTokens->generation = ++parsedJsonGeneration;
+		pTokens->pJsonDocument = NULL;
+		pTokens->tokenCount = 0;
 	}
+}
 
-	if(type == SHADOW_JSON_INT32) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%i,", *(int32_t *) (pData));
-	} else if(type == SHADOW_JSON_INT16) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hi,", *(int16_t *) (pData));
-	} else if(type == SHADOW_JSON_INT8) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hhi,", *(int8_t *) (pData));
-	} else if(type == SHADOW_JSON_UINT32) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%u,", *(uint32_t *) (pData));
-	} else if(type == SHADOW_JSON_UINT16) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hu,", *(uint16_t *) (pData));
-	} else if(type == SHADOW_JSON_UINT8) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%hhu,", *(uint8_t *) (pData));
-	} else if(type == SHADOW_JSON_DOUBLE) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%f,", *(double *) (pData));
-	} else if(type == SHADOW_JSON_FLOAT) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%f,", *(float *) (pData));
-	} else if(type == SHADOW_JSON_BOOL) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%s,", *(bool *) (pData) ? "true" : "false");
-	} else if(type == SHADOW_JSON_STRING) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "\"%s\",", (char *) (pData));
-	} else if(type == SHADOW_JSON_OBJECT) {
-		snPrintfReturn = snprintf(pStringBuffer, maxSizoStringBuffer, "%s,", (char *) (pData));
-	}
-
-
-	ret_val = checkReturnValueOfSnPrintf(snPrintfReturn, maxSizoStringBuffer);
+ShadowJsonTokens_t *selectViewJsonTokens(ShadowJsonTokens_t *pTokens) {
+	ShadowJsonTokens_t *pPrevious = pViewJsonTokens;
 
-	return ret_val;
+	pViewJsonTokens = (NULL != pTokens) ? pTokens : &sharedJsonTokens;
+	return pPrevious;
 }
 
-static jsmn_parser shadowJsonParser;
-static jsmntok_t jsonTokenStruct[MAX_JSON_TOKEN_EXPECTED];
-
 bool isJsonValidAndParse(const char *pJsonDocument, size_t jsonSize, void *pJsonHandler, int32_t *pTokenCount) {
+	ShadowJsonTokens_t *pTokens = getJsonTokens(pJsonHandler);
 	int32_t tokenCount;
 
-	IOT_UNUSED(pJsonHandler);
-
-	jsmn_init(&shadowJsonParser);
-
-	tokenCount = jsmn_parse(&shadowJsonParser, pJsonDocument, jsonSize, jsonTokenStruct,
-							sizeof(jsonTokenStruct) / sizeof(jsonTokenStruct[0]));
+	tokenCount = parseJsonDocument(pTokens, pJsonDocument, jsonSize);
 
 	if(tokenCount < 0) {
 		IOT_WARN("Failed to parse JSON: %d\n", tokenCount);
@@ -392,7 +611,7 @@ bool isJsonValidAndParse(const char *pJsonDocument, size_t jsonSize, void *pJson
 	}
 
 	/* Assume the top-level element is an object */
-	if(tokenCount < 1 || jsonTokenStruct[0].type != JSMN_OBJECT) {
+	if(tokenCount < 1 || pTokens->tokens[0].type != JSMN_OBJECT) {
 		IOT_WARN("Top Level is not an object\n");
 		return false;
 	}
@@ -431,21 +650,20 @@ static IoT_Error_t UpdateValueIfNoObject(const char *pJsonString, jsonStruct_t *
 
 bool isJsonKeyMatchingAndUpdateValue(const char *pJsonDocument, void *pJsonHandler, int32_t tokenCount,
 									 jsonStruct_t *pDataStruct, uint32_t *pDataLength, int32_t *pDataPosition) {
+	jsmntok_t *tokens = getJsonTokens(pJsonHandler)->tokens;
 	int32_t i, metadataEnd;
 	uint32_t dataLength;
 	jsmntok_t dataToken;
 
-	IOT_UNUSED(pJsonHandler);
-
 	for(i = 1; i < tokenCount; ) {
-		if(jsoneq(pJsonDocument, &(jsonTokenStruct[i]), pDataStruct->pKey) == 0) {
-			dataToken = jsonTokenStruct[i + 1];
+		if(jsoneq(pJsonDocument, &(tokens[i]), pDataStruct->pKey) == 0) {
+			dataToken = tokens[i + 1];
 			dataLength = (uint32_t) (dataToken.end - dataToken.start);
 			UpdateValueIfNoObject(pJsonDocument, pDataStruct, dataToken);
 			*pDataPosition = dataToken.start;
 			*pDataLength = dataLength;
 			return true;
-		} else if(jsoneq(pJsonDocument, &(jsonTokenStruct[i]), "metadata") == 0) {
+		} else if(jsoneq(pJsonDocument, &(tokens[i]), "metadata") == 0) {
 			/* Sanity check: must not be at the last key in the json object. */
 			if(i >= tokenCount-2)
 			{
@@ -453,7 +671,7 @@ bool isJsonKeyMatchingAndUpdateValue(const char *pJsonDocument, void *pJsonHandl
 			}
 
 			/* Record where the metadata object ends. */
-			metadataEnd = jsonTokenStruct[i+1].end;
+			metadataEnd = tokens[i+1].end;
 
 			/* Skip past the "metadata" key and jsmn object element. */
 			i+= 2;
@@ -461,7 +679,7 @@ bool isJsonKeyMatchingAndUpdateValue(const char *pJsonDocument, void *pJsonHandl
 			/* Skip past every key inside "metadata". Keys inside "metadata" have
 			 * have an end character before the end of the metadata object.
 			 */
-			while(jsonTokenStruct[i].end < metadataEnd)
+			while(tokens[i].end < metadataEnd)
 			{
 				i++;
 			}
@@ -477,74 +695,232 @@ bool isJsonKeyMatchingAndUpdateValue(const char *pJsonDocument, void *pJsonHandl
 	return false;
 }
 
-bool isReceivedJsonValid(const char *pJsonDocument, size_t jsonSize ) {
-	int32_t tokenCount;
+IoT_Error_t updateJsonStructFromToken(const char *pJsonDocument, jsonStruct_t *pDataStruct, jsmntok_t *pToken) {
+	return UpdateValueIfNoObject(pJsonDocument, pDataStruct, *pToken);
+}
 
-	jsmn_init(&shadowJsonParser);
+/* Deepest nesting walkJsonKeys() descends into; keys below are not visited */
+#ifndef SHADOW_JSON_MAX_WALK_DEPTH
+#define SHADOW_JSON_MAX_WALK_DEPTH 16
+#endif
 
-	tokenCount = jsmn_parse(&shadowJsonParser, pJsonDocument, jsonSize, jsonTokenStruct,
-							sizeof(jsonTokenStruct) / sizeof(jsonTokenStruct[0]));
+/* Longest dotted key path walkJsonKeys() builds, including the terminating null */
+#ifndef SHADOW_JSON_MAX_KEY_PATH_LEN
+#define SHADOW_JSON_MAX_KEY_PATH_LEN 64
+#endif
 
-	if(tokenCount < 0) {
-		IOT_WARN("Failed to parse JSON: %d\n", tokenCount);
-		return false;
+#define SHADOW_JSON_PATH_INVALID UINT16_MAX
+
+typedef struct {
+	int end;
+	uint16_t pathLen;
+	bool isObject;
+} JsonWalkFrame_t;
+
+static int32_t skipJsonSubtree(const jsmntok_t *tokens, int32_t index, int32_t tokenCount) {
+	int end = tokens[index].end;
+
+	for(index++; index < tokenCount && tokens[index].start < end; index++);
+
+	return index;
+}
+
+void walkJsonKeys(const char *pJsonDocument, void *pJsonHandler, int32_t tokenCount, bool withPaths,
+				  jsonKeyVisitor_t visitor, void *pContext) {
+	jsmntok_t *tokens = getJsonTokens(pJsonHandler)->tokens;
+	JsonWalkFrame_t stack[SHADOW_JSON_MAX_WALK_DEPTH];
+	char path[SHADOW_JSON_MAX_KEY_PATH_LEN];
+	uint32_t depth = 1;
+	int32_t i = 1;
+
+	if(NULL == pJsonDocument || NULL == visitor || tokenCount < 1 || tokens[0].type != JSMN_OBJECT) {
+		return;
 	}
 
-	/* Assume the top-level element is an object */
-	if(tokenCount < 1 || jsonTokenStruct[0].type != JSMN_OBJECT) {
-		return false;
+	stack[0].end = tokens[0].end;
+	stack[0].pathLen = 0;
+	stack[0].isObject = true;
+
+	while(i < tokenCount) {
+		jsmntok_t *pToken = &tokens[i];
+		JsonWalkFrame_t *pFrame;
+		uint16_t childPathLen;
+
+		/* Leave the containers this token is no longer part of */
+		while(depth > 0 && pToken->start >= stack[depth - 1].end) {
+			depth--;
+		}
+		if(0 == depth) {
+			break;
+		}
+		pFrame = &stack[depth - 1];
+		childPathLen = pFrame->pathLen;
+
+		/* Tokens directly inside an object are keys, each followed by its value */
+		if(pFrame->isObject) {
+			const char *pKey = pJsonDocument + pToken->start;
+			uint32_t keyLen = (uint32_t) (pToken->end - pToken->start);
+			const char *pPath = NULL;
+			uint32_t pathLen = 0;
+
+			if(i + 1 >= tokenCount) {
+				break;
+			}
+
+			if(jsoneq(pJsonDocument, pToken, "metadata") == 0) {
+				i = skipJsonSubtree(tokens, i + 1, tokenCount);
+				continue;
+			}
+
+			if(withPaths && SHADOW_JSON_PATH_INVALID != pFrame->pathLen) {
+				uint32_t offset = pFrame->pathLen;
+
+				if(offset > 0) {
+					path[offset++] = '.';
+				}
+				if(offset + keyLen < sizeof(path)) {
+					memcpy(path + offset, pKey, keyLen);
+					pathLen = offset + keyLen;
+					path[pathLen] = '\0';
+					pPath = path;
+					childPathLen = (uint16_t) pathLen;
+				} else {
+					childPathLen = SHADOW_JSON_PATH_INVALID;
+				}
+
+				/* Paths are relative to the state object of the document */
+				if(1 == depth && jsoneq(pJsonDocument, pToken, "state") == 0) {
+					childPathLen = 0;
+				}
+			}
+
+			visitor(pJsonDocument, pKey, keyLen, pPath, pathLen, &tokens[i + 1], pContext);
+
+			i++;
+			pToken = &tokens[i];
+		}
+
+		if(pToken->type == JSMN_OBJECT || pToken->type == JSMN_ARRAY) {
+			if(depth < SHADOW_JSON_MAX_WALK_DEPTH) {
+				stack[depth].end = pToken->end;
+				stack[depth].pathLen = childPathLen;
+				stack[depth].isObject = (pToken->type == JSMN_OBJECT);
+				depth++;
+				i++;
+			} else {
+				i = skipJsonSubtree(tokens, i, tokenCount);
+			}
+		} else {
+			i++;
+		}
 	}
+}
+
+/* Digits only, as the service sends versions */
+static bool parseStreamUnsigned32(const char *pText, uint32_t length, uint32_t *pValue) {
+	uint32_t value = 0;
+	uint32_t i;
 
+	if(0 == length) {
+		return false;
+	}
+	for(i = 0; i < length; i++) {
+		if(pText[i] < '0' || pText[i] > '9' || value > (UINT32_MAX - (uint32_t) (pText[i] - '0')) / 10) {
+			return false;
+		}
+		value = value * 10 + (uint32_t) (pText[i] - '0');
+	}
+	*pValue = value;
 	return true;
 }
 
-bool extractClientToken(const char *pJsonDocument, size_t jsonSize, char *pExtractedClientToken, size_t clientTokenSize) {
-	int32_t tokenCount, i;
-	size_t length;
-	jsmntok_t ClientJsonToken;
-	jsmn_init(&shadowJsonParser);
+static bool isStreamKey(const JsonStreamEvent_t *pEvent, const char *pKey) {
+	return NULL != pEvent->pKey && strlen(pKey) == pEvent->keyLength
+		   && 0 == strncmp(pEvent->pKey, pKey, pEvent->keyLength);
+}
 
-	tokenCount = jsmn_parse(&shadowJsonParser, pJsonDocument, jsonSize, jsonTokenStruct,
-							sizeof(jsonTokenStruct) / sizeof(jsonTokenStruct[0]));
+static void shadowResponseVisitor(const JsonStreamEvent_t *pEvent, void *pContext) {
+	ShadowResponseFields_t *pFields = (ShadowResponseFields_t *) pContext;
 
-	if(tokenCount < 0) {
-		IOT_WARN("Failed to parse JSON: %d\n", tokenCount);
+	if(0 == pEvent->depth) {
+		if(JSON_STREAM_OBJECT_START == pEvent->type) {
+			pFields->isObject = true;
+		}
+		return;
+	}
+
+	/* Top level members only, a clientToken or version key inside the state is not the response's */
+	if(1 != pEvent->depth) {
+		return;
+	}
+
+	if(JSON_STREAM_STRING == pEvent->type && isStreamKey(pEvent, SHADOW_CLIENT_TOKEN_STRING)) {
+		if(pEvent->valueLength < sizeof(pFields->clientToken)) {
+			memcpy(pFields->clientToken, pEvent->pValue, pEvent->valueLength);
+			pFields->clientToken[pEvent->valueLength] = '\0';
+			pFields->isClientTokenPresent = true;
+		} else {
+			IOT_WARN("Client token of %u bytes is too long", (unsigned) pEvent->valueLength);
+		}
+	} else if(JSON_STREAM_NUMBER == pEvent->type && isStreamKey(pEvent, SHADOW_VERSION_STRING)) {
+		pFields->isVersionPresent = parseStreamUnsigned32(pEvent->pValue, pEvent->valueLength, &pFields->version);
+	}
+}
+
+bool extractShadowResponseFields(const char *pJsonDocument, size_t jsonSize, ShadowResponseFields_t *pFields) {
+	JsonStreamParser_t parser;
+	IoT_Error_t rc;
+
+	memset(pFields, 0, sizeof(ShadowResponseFields_t));
+
+	/* Buffers may be larger than the document in them, as for jsmn_parse */
+	aws_iot_json_stream_init(&parser, shadowResponseVisitor, pFields);
+	rc = aws_iot_json_stream_feed(&parser, pJsonDocument, strnlen(pJsonDocument, jsonSize));
+	if(SUCCESS == rc) {
+		rc = aws_iot_json_stream_finish(&parser);
+	}
+
+	if(SUCCESS != rc) {
+		IOT_WARN("Failed to parse JSON: %d\n", rc);
 		return false;
 	}
 
 	/* Assume the top-level element is an object */
-	if(tokenCount < 1 || jsonTokenStruct[0].type != JSMN_OBJECT) {
+	return pFields->isObject;
+}
+
+bool isReceivedJsonValid(const char *pJsonDocument, size_t jsonSize ) {
+	ShadowResponseFields_t fields;
+
+	return extractShadowResponseFields(pJsonDocument, jsonSize, &fields);
+}
+
+bool extractClientToken(const char *pJsonDocument, size_t jsonSize, char *pExtractedClientToken, size_t clientTokenSize) {
+	ShadowResponseFields_t fields;
+	size_t length;
+
+	if(!extractShadowResponseFields(pJsonDocument, jsonSize, &fields) || !fields.isClientTokenPresent) {
 		return false;
 	}
 
-	for(i = 1; i < tokenCount; i++) {
-		if(jsoneq(pJsonDocument, &jsonTokenStruct[i], SHADOW_CLIENT_TOKEN_STRING) == 0) {
-			ClientJsonToken = jsonTokenStruct[i + 1];
-			length = (size_t) (ClientJsonToken.end - ClientJsonToken.start);
-            if (clientTokenSize >= length + 1)
-            {
-                strncpy( pExtractedClientToken, pJsonDocument + ClientJsonToken.start, length);
-                pExtractedClientToken[length] = '\0';
-                return true;
-            }else{
-                IOT_WARN( "Token size %zu too small for string %zu \n", clientTokenSize, length);
-                return false; 
-            }
-		}
+	length = strlen(fields.clientToken);
+	if(clientTokenSize < length + 1) {
+		IOT_WARN( "Token size %zu too small for string %zu \n", clientTokenSize, length);
+		return false;
 	}
 
-	return false;
+	memcpy(pExtractedClientToken, fields.clientToken, length + 1);
+	return true;
 }
 
 bool extractVersionNumber(const char *pJsonDocument, void *pJsonHandler, int32_t tokenCount, uint32_t *pVersionNumber) {
+	jsmntok_t *tokens = getJsonTokens(pJsonHandler)->tokens;
 	int32_t i;
 	IoT_Error_t ret_val = SUCCESS;
 
-	IOT_UNUSED(pJsonHandler);
-
 	for(i = 1; i < tokenCount; i++) {
-		if(jsoneq(pJsonDocument, &(jsonTokenStruct[i]), SHADOW_VERSION_STRING) == 0) {
-			ret_val = parseUnsignedInteger32Value(pVersionNumber, pJsonDocument, &jsonTokenStruct[i + 1]);
+		if(jsoneq(pJsonDocument, &(tokens[i]), SHADOW_VERSION_STRING) == 0) {
+			ret_val = parseUnsignedInteger32Value(pVersionNumber, pJsonDocument, &tokens[i + 1]);
 			if(ret_val == SUCCESS) {
 				return true;
 			}
@@ -553,6 +929,297 @@ bool extractVersionNumber(const char *pJsonDocument, void *pJsonHandler, int32_t
 	return false;
 }
 
+static IoT_Error_t checkJsonView(const ShadowJsonView_t *pView) {
+	if(NULL == pView) {
+		return NULL_VALUE_ERROR;
+	}
+	if(NULL == pView->pTokens || pView->generation != pView->pTokens->generation
+	   || pView->pJsonDocument != pView->pTokens->pJsonDocument) {
+		IOT_WARN("Shadow JSON view used after another document was parsed");
+		return JSON_PARSE_ERROR;
+	}
+	return SUCCESS;
+}
+
+/* Index of the value token at the dotted path below the view root, -1 when there is none */
+static int32_t findJsonPath(const ShadowJsonView_t *pView, const char *pPath) {
+	const jsmntok_t *tokens = pView->pTokens->tokens;
+	int32_t tokenCount = pView->pTokens->tokenCount;
+	int32_t index = pView->rootIndex;
+	int32_t member, i;
+	uint32_t arrayIndex;
+	size_t segmentLen, j;
+
+	while('\0' != *pPath) {
+		const jsmntok_t *pToken = &tokens[index];
+
+		segmentLen = strcspn(pPath, ".");
+		i = index + 1;
+
+		if(JSMN_OBJECT == pToken->type) {
+			/* Members are key tokens, each followed by its value subtree */
+			for(member = 0; member < pToken->size; member++) {
+				if(i + 1 >= tokenCount) {
+					return -1;
+				}
+				if((size_t) (tokens[i].end - tokens[i].start) == segmentLen
+				   && 0 == strncmp(pView->pJsonDocument + tokens[i].start, pPath, segmentLen)) {
+					break;
+				}
+				i = skipJsonSubtree(tokens, i + 1, tokenCount);
+			}
+			if(member == pToken->size) {
+				return -1;
+			}
+			index = i + 1;
+		} else if(JSMN_ARRAY == pToken->type) {
+			if(0 == segmentLen) {
+				return -1;
+			}
+			arrayIndex = 0;
+			for(j = 0; j < segmentLen; j++) {
+				if(pPath[j] < '0' || pPath[j] > '9' || arrayIndex >= (uint32_t) pToken->size) {
+					return -1;
+				}
+				arrayIndex = arrayIndex * 10 + (uint32_t) (pPath[j] - '0');
+			}
+			if(arrayIndex >= (uint32_t) pToken->size) {
+				return -1;
+			}
+			for(; arrayIndex > 0; arrayIndex--) {
+				i = skipJsonSubtree(tokens, i, tokenCount);
+			}
+			if(i >= tokenCount) {
+				return -1;
+			}
+			index = i;
+		} else {
+			return -1;
+		}
+
+		pPath += segmentLen;
+		if('.' == *pPath) {
+			pPath++;
+		}
+	}
+
+	return index;
+}
+
+static IoT_Error_t findJsonViewToken(const ShadowJsonView_t *pView, const char *pPath, jsmntok_t **ppToken) {
+	IoT_Error_t rc;
+	int32_t index;
+
+	rc = checkJsonView(pView);
+	if(SUCCESS != rc) {
+		return rc;
+	}
+	if(NULL == pPath) {
+		return NULL_VALUE_ERROR;
+	}
+
+	index = findJsonPath(pView, pPath);
+	if(index < 0) {
+		IOT_DEBUG("Key %s not in the shadow document", pPath);
+		return JSON_KEY_NOT_FOUND_ERROR;
+	}
+
+	*ppToken = &pView->pTokens->tokens[index];
+	return SUCCESS;
+}
+
+IoT_Error_t aws_iot_shadow_json_view_init(const char *pJson, ShadowJsonView_t *pView) {
+	ShadowJsonTokens_t *pTokens = pViewJsonTokens;
+	int32_t offset, i, tokenCount;
+
+	FUNC_ENTRY;
+
+	if(NULL == pJson || NULL == pView) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+	if(NULL == pTokens->pJsonDocument || pJson < pTokens->pJsonDocument
+	   || pJson - pTokens->pJsonDocument >= pTokens->tokens[0].end) {
+		/* Responses are only validated when received, and tokenized here when a view asks for them */
+		tokenCount = parseJsonDocument(pTokens, pJson, strlen(pJson));
+		if(tokenCount < 1 || (pTokens->tokens[0].type != JSMN_OBJECT && pTokens->tokens[0].type != JSMN_ARRAY)) {
+			IOT_WARN("Not a JSON document: %d", (int) tokenCount);
+			FUNC_EXIT_RC(JSON_PARSE_ERROR);
+		}
+	}
+
+	/* The document itself, or a value handed to a delta callback */
+	offset = (int32_t) (pJson - pTokens->pJsonDocument);
+	for(i = 0; 0 != offset && i < pTokens->tokenCount && pTokens->tokens[i].start != offset; i++);
+	if(i == pTokens->tokenCount) {
+		IOT_WARN("No value starts at offset %d of the shadow document", (int) offset);
+		FUNC_EXIT_RC(JSON_PARSE_ERROR);
+	}
+
+	pView->pJsonDocument = pTokens->pJsonDocument;
+	pView->pTokens = pTokens;
+	pView->rootIndex = i;
+	pView->generation = pTokens->generation;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_shadow_json_view_get_raw(const ShadowJsonView_t *pView, const char *pPath,
+											 const char **ppValue, uint32_t *pValueLength) {
+	jsmntok_t *pToken = NULL;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == ppValue || NULL == pValueLength) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = findJsonViewToken(pView, pPath, &pToken);
+	if(SUCCESS == rc) {
+		*ppValue = pView->pJsonDocument + pToken->start;
+		*pValueLength = (uint32_t) (pToken->end - pToken->start);
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_shadow_json_view_get_view(const ShadowJsonView_t *pView, const char *pPath,
+											  ShadowJsonView_t *pSubView) {
+	jsmntok_t *pToken = NULL;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pSubView) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = findJsonViewToken(pView, pPath, &pToken);
+	if(SUCCESS == rc && JSMN_OBJECT != pToken->type && JSMN_ARRAY != pToken->type) {
+		IOT_WARN("Key %s is not an object or array", pPath);
+		rc = JSON_PARSE_ERROR;
+	}
+	if(SUCCESS == rc) {
+		pSubView->pJsonDocument = pView->pJsonDocument;
+		pSubView->pTokens = pView->pTokens;
+		pSubView->rootIndex = (int32_t) (pToken - pView->pTokens->tokens);
+		pSubView->generation = pView->generation;
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_shadow_json_view_get_string(const ShadowJsonView_t *pView, const char *pPath,
+												char *pBuffer, size_t bufferLength) {
+	jsmntok_t *pToken = NULL;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pBuffer) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = findJsonViewToken(pView, pPath, &pToken);
+	if(SUCCESS == rc) {
+		rc = parseStringValue(pBuffer, bufferLength, pView->pJsonDocument, pToken);
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_shadow_json_view_get_int32(const ShadowJsonView_t *pView, const char *pPath, int32_t *pValue) {
+	jsmntok_t *pToken = NULL;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pValue) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = findJsonViewToken(pView, pPath, &pToken);
+	if(SUCCESS == rc) {
+		rc = parseInteger32Value(pValue, pView->pJsonDocument, pToken);
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_shadow_json_view_get_uint32(const ShadowJsonView_t *pView, const char *pPath,
+												uint32_t *pValue) {
+	jsmntok_t *pToken = NULL;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pValue) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = findJsonViewToken(pView, pPath, &pToken);
+	if(SUCCESS == rc) {
+		rc = parseUnsignedInteger32Value(pValue, pView->pJsonDocument, pToken);
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_shadow_json_view_get_double(const ShadowJsonView_t *pView, const char *pPath, double *pValue) {
+	jsmntok_t *pToken = NULL;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pValue) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = findJsonViewToken(pView, pPath, &pToken);
+	if(SUCCESS == rc) {
+		rc = parseDoubleValue(pValue, pView->pJsonDocument, pToken);
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_shadow_json_view_get_bool(const ShadowJsonView_t *pView, const char *pPath, bool *pValue) {
+	jsmntok_t *pToken = NULL;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pValue) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = findJsonViewToken(pView, pPath, &pToken);
+	if(SUCCESS == rc) {
+		rc = parseBooleanValue(pValue, pView->pJsonDocument, pToken);
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_shadow_json_view_get_struct(const ShadowJsonView_t *pView, const char *pPath,
+												jsonStruct_t *pStruct) {
+	jsmntok_t *pToken = NULL;
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pStruct || NULL == pStruct->pData) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = findJsonViewToken(pView, pPath, &pToken);
+	if(SUCCESS == rc) {
+		rc = updateJsonStructFromToken(pView->pJsonDocument, pStruct, pToken);
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,42 @@
+/*
+* Copyright 2015-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_common.h
+ * @brief Host benchmarks - common helpers
+ */
+
+#ifndef AWS_IOT_BENCHMARK_COMMON_H_
+#define AWS_IOT_BENCHMARK_COMMON_H_
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+static inline uint64_t aws_iot_benchmark_now_ns(void) {
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+/* Each benchmark prints its results and returns 0, or non zero when the implementations disagree */
+int aws_iot_benchmark_delta_patch(void);
+int aws_iot_benchmark_json_stream(void);
+int aws_iot_benchmark_json_view(void);
+int aws_iot_benchmark_shadow_delta(void);
+int aws_iot_benchmark_shadow_json(void);
+
+#endif /* AWS_IOT_BENCHMARK_COMMON_H_ */
@@ -0,0 +1,304 @@
+/*
+* Copyright 2015-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_delta_patch.c
+ * @brief Delta patch size and apply time for typical changes of an application image
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "aws_iot_benchmark_common.h"
+#include "aws_iot_delta_patch.h"
+#include "aws_iot_delta_patch_encoder.h"
+
+#define PATCH_BENCH_FUNCTIONS 2600
+#define PATCH_BENCH_MAX_FUNCTIONS (PATCH_BENCH_FUNCTIONS + 64)
+#define PATCH_BENCH_RODATA_SIZE (96 * 1024)
+#define PATCH_BENCH_IMAGE_SIZE (2 * 1024 * 1024)
+#define PATCH_BENCH_TEXT_ADDRESS 0x400D0020u
+#define PATCH_BENCH_RODATA_ADDRESS 0x3F400020u
+#define PATCH_BENCH_CHUNK_SIZE 1024 ///< Bytes of patch fed at a time, a stream block
+#define PATCH_BENCH_ITERATIONS 5
+
+/* A function of the synthetic image. Bodies come from the seed, calls and literals name other functions by id so
+ * that they follow them when the layout moves */
+typedef struct {
+	uint32_t id;
+	uint32_t seed;
+	uint32_t length;
+} BenchFunction_t;
+
+typedef struct {
+	BenchFunction_t functions[PATCH_BENCH_MAX_FUNCTIONS];
+	uint32_t count;
+	uint8_t rodata[PATCH_BENCH_RODATA_SIZE];
+} BenchProgram_t;
+
+typedef struct {
+	const uint8_t *pSource;
+	uint8_t *pTarget;
+} BenchImages_t;
+
+static BenchProgram_t baseProgram;
+static BenchProgram_t changedProgram;
+static uint8_t sourceImage[PATCH_BENCH_IMAGE_SIZE];
+static uint8_t targetImage[PATCH_BENCH_IMAGE_SIZE];
+static uint8_t appliedImage[PATCH_BENCH_IMAGE_SIZE];
+static uint32_t functionAddresses[PATCH_BENCH_MAX_FUNCTIONS * 2];
+static DeltaPatch_t patch;
+
+static uint32_t nextRandom(uint32_t *pState) {
+	*pState ^= *pState << 13;
+	*pState ^= *pState >> 17;
+	*pState ^= *pState << 5;
+	return *pState;
+}
+
+/* Instruction-like bytes: a small set of opcodes with varying register fields, as compiled code has */
+static void writeBody(uint8_t *pOut, uint32_t address, const BenchFunction_t *pFunction) {
+	static const uint8_t opcodes[16][3] = {
+		{0x36, 0x41, 0x00}, {0x0c, 0x02, 0x00}, {0x1d, 0xf0, 0x00}, {0x22, 0xa0, 0x00}, {0x91, 0x00, 0x00},
+		{0x88, 0x02, 0x00}, {0x29, 0x02, 0x00}, {0xc0, 0x20, 0x00}, {0x0b, 0x33, 0x00}, {0x56, 0x00, 0x00},
+		{0xa2, 0xc1, 0x00}, {0x82, 0x21, 0x00}, {0x42, 0xa0, 0x00}, {0x1b, 0x22, 0x00}, {0x20, 0x20, 0xf0},
+		{0x0d, 0xf0, 0x00}};
+	uint32_t state = pFunction->seed | 1;
+	uint32_t offset = 0;
+	uint32_t poolStart = pFunction->length - 16;
+	uint32_t value;
+	uint32_t callee;
+	uint32_t i;
+
+	while(offset + 3 <= poolStart) {
+		value = nextRandom(&state);
+		if(0 == (value & 7) && offset > 0) {
+			/* call8 with a pc relative offset to another function */
+			callee = (value >> 8) % PATCH_BENCH_FUNCTIONS;
+			value = ((functionAddresses[callee] - ((address + offset) & ~3u) - 4) >> 2) & 0x3FFFF;
+			pOut[offset] = (uint8_t) (0x25 | (value << 6));
+			pOut[offset + 1] = (uint8_t) (value >> 2);
+			pOut[offset + 2] = (uint8_t) (value >> 10);
+		} else {
+			memcpy(pOut + offset, opcodes[value & 15], 3);
+			pOut[offset + 1] ^= (uint8_t) ((value >> 4) & 0x0F);
+			pOut[offset + 2] ^= (uint8_t) (value >> 24 & 0x03);
+		}
+		offset += 3;
+	}
+	memset(pOut + offset, 0, poolStart - offset);
+
+	/* Literal pool: absolute addresses of other functions and of constants */
+	for(i = 0; i < 4; i++) {
+		value = nextRandom(&state);
+		value = (i < 3) ? functionAddresses[value % PATCH_BENCH_FUNCTIONS]
+						: PATCH_BENCH_RODATA_ADDRESS + (value % (PATCH_BENCH_RODATA_SIZE / 4)) * 4;
+		memcpy(pOut + poolStart + 4 * i, &value, 4);
+	}
+}
+
+static size_t buildImage(const BenchProgram_t *pProgram, uint8_t *pImage) {
+	uint32_t address = PATCH_BENCH_TEXT_ADDRESS;
+	size_t length = 0;
+	uint32_t i;
+
+	for(i = 0; i < pProgram->count; i++) {
+		functionAddresses[pProgram->functions[i].id] = address;
+		address += pProgram->functions[i].length;
+	}
+
+	memcpy(pImage, pProgram->rodata, PATCH_BENCH_RODATA_SIZE);
+	length += PATCH_BENCH_RODATA_SIZE;
+	address = PATCH_BENCH_TEXT_ADDRESS;
+	for(i = 0; i < pProgram->count; i++) {
+		writeBody(pImage + length, address, &pProgram->functions[i]);
+		length += pProgram->functions[i].length;
+		address += pProgram->functions[i].length;
+	}
+	return length;
+}
+
+static void buildBaseProgram(void) {
+	static const char *words[] = {"sensor", "error", "timeout", "shadow", "update", "failed", "connect", "%d",
+								  "mqtt", "wifi", "state", "ready", "agent", "status", "ota", "%s\n"};
+	uint32_t state = 0x12345678;
+	size_t length = 0;
+	const char *pWord;
+	uint32_t i;
+
+	baseProgram.count = PATCH_BENCH_FUNCTIONS;
+	for(i = 0; i < PATCH_BENCH_FUNCTIONS; i++) {
+		baseProgram.functions[i].id = i;
+		baseProgram.functions[i].seed = nextRandom(&state);
+		baseProgram.functions[i].length = 64 + 4 * (nextRandom(&state) % 160);
+	}
+
+	/* Log strings and constant tables */
+	while(length < PATCH_BENCH_RODATA_SIZE) {
+		if(nextRandom(&state) & 1) {
+			pWord = words[nextRandom(&state) & 15];
+			while(*pWord && length < PATCH_BENCH_RODATA_SIZE) {
+				baseProgram.rodata[length++] = (uint8_t) *pWord++;
+			}
+			if(length < PATCH_BENCH_RODATA_SIZE) {
+				baseProgram.rodata[length++] = (nextRandom(&state) & 3) ? ' ' : '\0';
+			}
+		} else {
+			baseProgram.rodata[length++] = (uint8_t) nextRandom(&state);
+		}
+	}
+}
+
+static void insertFunctions(BenchProgram_t *pProgram, uint32_t at, uint32_t count, uint32_t length) {
+	uint32_t i;
+
+	memmove(&pProgram->functions[at + count], &pProgram->functions[at],
+			sizeof(BenchFunction_t) * (pProgram->count - at));
+	for(i = 0; i < count; i++) {
+		pProgram->functions[at + i].id = PATCH_BENCH_MAX_FUNCTIONS + i;
+		pProgram->functions[at + i].seed = 0xC0FFEE00 + i;
+		pProgram->functions[at + i].length = length;
+	}
+	pProgram->count += count;
+}
+
+/* Each change starts from the base program */
+static void changeProgram(int change) {
+	uint32_t i;
+
+	changedProgram = baseProgram;
+	switch(change) {
+		case 0:
+			/* A log message is reworded */
+			memcpy(changedProgram.rodata + 40000, "sensor read timed out", 21);
+			break;
+		case 1:
+			/* A bug fix makes one function 12 bytes longer, the code after it moves */
+			changedProgram.functions[1300].seed ^= 0x5A5A;
+			changedProgram.functions[1300].length += 12;
+			break;
+		case 2:
+			/* A feature adds 40 functions, about 16 KB of code, and calls into them from a few places */
+			insertFunctions(&changedProgram, 1800, 40, 400);
+			for(i = 0; i < 8; i++) {
+				changedProgram.functions[200 + 150 * i].seed ^= 0x1111;
+			}
+			break;
+		default:
+			/* A library update rewrites one function in ten of a third of the image */
+			for(i = 900; i < 1800; i += 10) {
+				changedProgram.functions[i].seed ^= 0xBEEF;
+				changedProgram.functions[i].length += 4 * (i % 3);
+			}
+			break;
+	}
+}
+
+static IoT_Error_t readSource(void *pContext, uint32_t offset, uint8_t *pBuffer, size_t length) {
+	memcpy(pBuffer, ((BenchImages_t *) pContext)->pSource + offset, length);
+	return SUCCESS;
+}
+
+static IoT_Error_t writeTarget(void *pContext, uint32_t offset, const uint8_t *pData, size_t length) {
+	memcpy(((BenchImages_t *) pContext)->pTarget + offset, pData, length);
+	return SUCCESS;
+}
+
+static IoT_Error_t applyPatch(const uint8_t *pPatch, size_t patchSize, size_t sourceSize) {
+	DeltaPatchParams_t params;
+	BenchImages_t images;
+	IoT_Error_t rc;
+	size_t offset;
+	size_t length;
+
+	images.pSource = sourceImage;
+	images.pTarget = appliedImage;
+	params.readSource = readSource;
+	params.writeTarget = writeTarget;
+	params.pContext = &images;
+	params.maxSourceSize = (uint32_t) sourceSize;
+	params.maxTargetSize = PATCH_BENCH_IMAGE_SIZE;
+
+	rc = aws_iot_delta_patch_init(&patch, &params);
+	for(offset = 0; offset < patchSize && SUCCESS == rc; offset += length) {
+		length = patchSize - offset < PATCH_BENCH_CHUNK_SIZE ? patchSize - offset : PATCH_BENCH_CHUNK_SIZE;
+		rc = aws_iot_delta_patch_feed(&patch, pPatch + offset, length);
+	}
+	return SUCCESS == rc ? aws_iot_delta_patch_finish(&patch) : rc;
+}
+
+int aws_iot_benchmark_delta_patch(void) {
+	static const char *changeNames[] = {"log string", "bug fix", "feature", "library"};
+	static const uint8_t sourceHash[DELTA_PATCH_HASH_SIZE] = {0};
+	uint8_t *pPatch;
+	uint8_t *pFullPatch;
+	size_t sourceSize;
+	size_t targetSize;
+	size_t patchSize;
+	size_t fullPatchSize;
+	uint64_t start, encodeNs, applyNs;
+	uint32_t iter;
+	int change;
+
+	buildBaseProgram();
+	sourceSize = buildImage(&baseProgram, sourceImage);
+
+	printf("applier state %u bytes, window %u bytes\n", (unsigned) sizeof(DeltaPatch_t),
+		   1u << DELTA_PATCH_MAX_WINDOW_BITS);
+	printf("%-11s %9s %9s %9s %7s %10s %9s %9s\n", "change", "image", "full lz", "patch", "patch%", "encode ms",
+		   "apply ms", "apply MB/s");
+	for(change = 0; change < 4; change++) {
+		changeProgram(change);
+		targetSize = buildImage(&changedProgram, targetImage);
+
+		start = aws_iot_benchmark_now_ns();
+		if(0 != aws_iot_delta_patch_encode(sourceImage, sourceSize, targetImage, targetSize,
+										   DELTA_PATCH_MAX_WINDOW_BITS, sourceHash, &pPatch, &patchSize)) {
+			printf("encoding failed\n");
+			return 1;
+		}
+		encodeNs = aws_iot_benchmark_now_ns() - start;
+
+		/* The whole image compressed the same way, what a full update would send at best */
+		if(0 != aws_iot_delta_patch_encode(sourceImage, 1, targetImage, targetSize, DELTA_PATCH_MAX_WINDOW_BITS,
+										   sourceHash, &pFullPatch, &fullPatchSize)) {
+			free(pPatch);
+			printf("encoding failed\n");
+			return 1;
+		}
+		free(pFullPatch);
+
+		memset(appliedImage, 0, targetSize);
+		if(SUCCESS != applyPatch(pPatch, patchSize, sourceSize) || 0 != memcmp(appliedImage, targetImage, targetSize)) {
+			free(pPatch);
+			printf("the patch does not rebuild the %s image\n", changeNames[change]);
+			return 1;
+		}
+
+		start = aws_iot_benchmark_now_ns();
+		for(iter = 0; iter < PATCH_BENCH_ITERATIONS; iter++) {
+			applyPatch(pPatch, patchSize, sourceSize);
+		}
+		applyNs = (aws_iot_benchmark_now_ns() - start) / PATCH_BENCH_ITERATIONS;
+
+		printf("%-11s %9u %9u %9u %6.2f%% %10.1f %9.2f %10.1f\n", changeNames[change], (unsigned) targetSize,
+			   (unsigned) fullPatchSize, (unsigned) patchSize, 100.0 * (double) patchSize / (double) targetSize,
+			   (double) encodeNs / 1e6, (double) applyNs / 1e6,
+			   applyNs ? (double) targetSize * 1e3 / (double) applyNs : 0.0);
+		free(pPatch);
+	}
+
+	return 0;
+}
@@ -0,0 +1,173 @@
+/*
+* Copyright 2015-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_json_stream.c
+ * @brief Shadow responses: jsmn parses per extraction against one streaming pass
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "aws_iot_benchmark_common.h"
+#include "aws_iot_config.h"
+#include "aws_iot_json_stream.h"
+#include "aws_iot_shadow_json.h"
+#include "jsmn.h"
+
+#define STREAM_BENCH_ITERATIONS 2000
+#define STREAM_BENCH_CHUNK_SIZE 64
+
+static char responseDocument[SHADOW_MAX_SIZE_OF_RX_BUFFER];
+static jsmn_parser referenceParser;
+static jsmntok_t referenceTokens[MAX_JSON_TOKEN_EXPECTED];
+
+/* A get/accepted response as the service sends it: state, a timestamp per key in metadata, then version and token */
+static size_t buildResponseDocument(uint32_t keyCount) {
+	size_t len = 0;
+	uint32_t i;
+
+	len += (size_t) snprintf(responseDocument + len, sizeof(responseDocument) - len, "{\"state\":{\"reported\":{");
+	for(i = 0; i < keyCount; i++) {
+		len += (size_t) snprintf(responseDocument + len, sizeof(responseDocument) - len, "%s\"key%03u\":\"value %u\"",
+								 i ? "," : "", i, i * 7919u);
+	}
+	len += (size_t) snprintf(responseDocument + len, sizeof(responseDocument) - len, "}},\"metadata\":{\"reported\":{");
+	for(i = 0; i < keyCount; i++) {
+		len += (size_t) snprintf(responseDocument + len, sizeof(responseDocument) - len,
+								 "%s\"key%03u\":{\"timestamp\":1600000000}", i ? "," : "", i);
+	}
+	len += (size_t) snprintf(responseDocument + len, sizeof(responseDocument) - len,
+							 "}},\"version\":%u,\"timestamp\":1600000001,\"clientToken\":\"%s-%u\"}", 4000000000u,
+							 AWS_IOT_MQTT_CLIENT_ID, keyCount);
+	return len;
+}
+
+static bool referenceKeyEquals(const char *pJson, const jsmntok_t *pToken, const char *pKey) {
+	return pToken->type == JSMN_STRING && (int) strlen(pKey) == pToken->end - pToken->start
+		   && 0 == strncmp(pJson + pToken->start, pKey, (size_t) (pToken->end - pToken->start));
+}
+
+static int32_t referenceParse(const char *pJson, size_t length) {
+	jsmn_init(&referenceParser);
+	return jsmn_parse(&referenceParser, pJson, length, referenceTokens, MAX_JSON_TOKEN_EXPECTED);
+}
+
+/* The former response handling: isJsonValidAndParse and extractVersionNumber, then extractClientToken parsing again */
+static bool referenceExtract(const char *pJson, size_t length, ShadowResponseFields_t *pFields) {
+	int32_t tokenCount, i;
+
+	memset(pFields, 0, sizeof(ShadowResponseFields_t));
+
+	tokenCount = referenceParse(pJson, length);
+	if(tokenCount < 1 || referenceTokens[0].type != JSMN_OBJECT) {
+		return false;
+	}
+	pFields->isObject = true;
+	for(i = 1; i < tokenCount; i++) {
+		if(referenceKeyEquals(pJson, &referenceTokens[i], "version")) {
+			pFields->version = (uint32_t) strtoul(pJson + referenceTokens[i + 1].start, NULL, 10);
+			pFields->isVersionPresent = true;
+			break;
+		}
+	}
+
+	tokenCount = referenceParse(pJson, length);
+	if(tokenCount < 1 || referenceTokens[0].type != JSMN_OBJECT) {
+		return false;
+	}
+	for(i = 1; i < tokenCount; i++) {
+		if(referenceKeyEquals(pJson, &referenceTokens[i], "clientToken")) {
+			int tokenLength = referenceTokens[i + 1].end - referenceTokens[i + 1].start;
+
+			if(tokenLength < (int) sizeof(pFields->clientToken)) {
+				memcpy(pFields->clientToken, pJson + referenceTokens[i + 1].start, (size_t) tokenLength);
+				pFields->clientToken[tokenLength] = '\0';
+				pFields->isClientTokenPresent = true;
+			}
+			break;
+		}
+	}
+
+	return true;
+}
+
+static void countingCallback(const JsonStreamEvent_t *pEvent, void *pContext) {
+	(void) pEvent;
+	(*(uint32_t *) pContext)++;
+}
+
+/* The tokenizer alone, fed as a network read would deliver the payload */
+static IoT_Error_t streamInChunks(const char *pJson, size_t length, uint32_t *pEventCount) {
+	JsonStreamParser_t parser;
+	IoT_Error_t rc;
+	size_t offset;
+
+	aws_iot_json_stream_init(&parser, countingCallback, pEventCount);
+	for(offset = 0, rc = SUCCESS; offset < length && SUCCESS == rc; offset += STREAM_BENCH_CHUNK_SIZE) {
+		size_t chunk = length - offset < STREAM_BENCH_CHUNK_SIZE ? length - offset : STREAM_BENCH_CHUNK_SIZE;
+
+		rc = aws_iot_json_stream_feed(&parser, pJson + offset, chunk);
+	}
+	return SUCCESS == rc ? aws_iot_json_stream_finish(&parser) : rc;
+}
+
+int aws_iot_benchmark_json_stream(void) {
+	static const uint32_t keyCounts[] = {4, 32, 128};
+	size_t k;
+
+	printf("%8s %8s %14s %14s %8s %12s\n", "keys", "bytes", "jsmn x2 ns", "stream ns", "speedup", "chunked MB/s");
+	for(k = 0; k < sizeof(keyCounts) / sizeof(keyCounts[0]); k++) {
+		ShadowResponseFields_t reference, streamed;
+		uint64_t start, referenceNs, streamNs, chunkedNs;
+		uint32_t iter, eventCount = 0;
+		size_t length;
+
+		length = buildResponseDocument(keyCounts[k]);
+		if(!referenceExtract(responseDocument, length, &reference)
+		   || !extractShadowResponseFields(responseDocument, length, &streamed)
+		   || reference.version != streamed.version || !streamed.isVersionPresent
+		   || 0 != strcmp(reference.clientToken, streamed.clientToken) || !streamed.isClientTokenPresent
+		   || SUCCESS != streamInChunks(responseDocument, length, &eventCount)) {
+			printf("extractions differ for\n%s\n", responseDocument);
+			return 1;
+		}
+
+		start = aws_iot_benchmark_now_ns();
+		for(iter = 0; iter < STREAM_BENCH_ITERATIONS; iter++) {
+			referenceExtract(responseDocument, length, &reference);
+		}
+		referenceNs = (aws_iot_benchmark_now_ns() - start) / STREAM_BENCH_ITERATIONS;
+
+		start = aws_iot_benchmark_now_ns();
+		for(iter = 0; iter < STREAM_BENCH_ITERATIONS; iter++) {
+			extractShadowResponseFields(responseDocument, length, &streamed);
+		}
+		streamNs = (aws_iot_benchmark_now_ns() - start) / STREAM_BENCH_ITERATIONS;
+
+		start = aws_iot_benchmark_now_ns();
+		for(iter = 0; iter < STREAM_BENCH_ITERATIONS; iter++) {
+			streamInChunks(responseDocument, length, &eventCount);
+		}
+		chunkedNs = (aws_iot_benchmark_now_ns() - start) / STREAM_BENCH_ITERATIONS;
+
+		printf("%8u %8u %14llu %14llu %7.1fx %12.1f\n", keyCounts[k], (unsigned) length,
+			   (unsigned long long) referenceNs, (unsigned long long) streamNs,
+			   streamNs ? (double) referenceNs / (double) streamNs : 0.0,
+			   chunkedNs ? (double) length * 1000.0 / (double) chunkedNs : 0.0);
+	}
+
+	return 0;
+}
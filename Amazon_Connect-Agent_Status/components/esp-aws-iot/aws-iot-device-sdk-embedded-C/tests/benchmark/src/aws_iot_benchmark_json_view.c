@@ -0,0 +1,110 @@
+/*
+* Copyright 2015-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_json_view.c
+ * @brief Shadow responses: the streaming check on receipt against the jsmn parse of a view
+ */
+
+#include <string.h>
+
+#include "aws_iot_benchmark_common.h"
+#include "aws_iot_config.h"
+#include "aws_iot_shadow_json.h"
+#include "aws_iot_shadow_json_data.h"
+
+#define VIEW_BENCH_ITERATIONS 2000
+
+static char responseDocument[SHADOW_MAX_SIZE_OF_RX_BUFFER];
+
+/* A get/accepted response as the service sends it: state, a timestamp per key in metadata, then version and token */
+static size_t buildResponseDocument(uint32_t keyCount) {
+	size_t len = 0;
+	uint32_t i;
+
+	len += (size_t) snprintf(responseDocument + len, sizeof(responseDocument) - len, "{\"state\":{\"reported\":{");
+	for(i = 0; i < keyCount; i++) {
+		len += (size_t) snprintf(responseDocument + len, sizeof(responseDocument) - len, "%s\"key%03u\":%u",
+								 i ? "," : "", i, i * 7919u);
+	}
+	len += (size_t) snprintf(responseDocument + len, sizeof(responseDocument) - len, "}},\"metadata\":{\"reported\":{");
+	for(i = 0; i < keyCount; i++) {
+		len += (size_t) snprintf(responseDocument + len, sizeof(responseDocument) - len,
+								 "%s\"key%03u\":{\"timestamp\":1600000000}", i ? "," : "", i);
+	}
+	len += (size_t) snprintf(responseDocument + len, sizeof(responseDocument) - len,
+							 "}},\"version\":%u,\"timestamp\":1600000001,\"clientToken\":\"%s-%u\"}", 4000000000u,
+							 AWS_IOT_MQTT_CLIENT_ID, keyCount);
+	return len;
+}
+
+/* The next response lands in the same buffer, as it does in the Thing Shadow client */
+static bool parseView(ShadowJsonView_t *pView) {
+	invalidateParsedJson(responseDocument, NULL);
+	return SUCCESS == aws_iot_shadow_json_view_init(responseDocument, pView);
+}
+
+/* What an action callback does with a view: the version and the last reported key */
+static bool readView(const ShadowJsonView_t *pView, const char *pPath, uint32_t *pVersion, uint32_t *pLastValue) {
+	return SUCCESS == aws_iot_shadow_json_view_get_uint32(pView, "version", pVersion)
+		   && SUCCESS == aws_iot_shadow_json_view_get_uint32(pView, pPath, pLastValue);
+}
+
+int aws_iot_benchmark_json_view(void) {
+	static const uint32_t keyCounts[] = {4, 32, 128};
+	size_t k;
+
+	printf("%6s %8s %14s %14s %14s\n", "keys", "bytes", "receive ns", "view init ns", "2 lookups ns");
+	for(k = 0; k < sizeof(keyCounts) / sizeof(keyCounts[0]); k++) {
+		ShadowResponseFields_t fields;
+		ShadowJsonView_t view;
+		uint64_t start, receiveNs, initNs, lookupNs;
+		uint32_t iter, version = 0, lastValue = 0;
+		char path[32];
+		size_t length;
+
+		length = buildResponseDocument(keyCounts[k]);
+		snprintf(path, sizeof(path), "state.reported.key%03u", keyCounts[k] - 1);
+		if(!extractShadowResponseFields(responseDocument, length, &fields) || !parseView(&view)
+		   || !readView(&view, path, &version, &lastValue)
+		   || version != fields.version || lastValue != (keyCounts[k] - 1) * 7919u) {
+			printf("view and streaming check differ for\n%s\n", responseDocument);
+			return 1;
+		}
+
+		start = aws_iot_benchmark_now_ns();
+		for(iter = 0; iter < VIEW_BENCH_ITERATIONS; iter++) {
+			extractShadowResponseFields(responseDocument, length, &fields);
+		}
+		receiveNs = (aws_iot_benchmark_now_ns() - start) / VIEW_BENCH_ITERATIONS;
+
+		start = aws_iot_benchmark_now_ns();
+		for(iter = 0; iter < VIEW_BENCH_ITERATIONS; iter++) {
+			parseView(&view);
+		}
+		initNs = (aws_iot_benchmark_now_ns() - start) / VIEW_BENCH_ITERATIONS;
+
+		start = aws_iot_benchmark_now_ns();
+		for(iter = 0; iter < VIEW_BENCH_ITERATIONS; iter++) {
+			readView(&view, path, &version, &lastValue);
+		}
+		lookupNs = (aws_iot_benchmark_now_ns() - start) / VIEW_BENCH_ITERATIONS;
+
+		printf("%6u %8u %14llu %14llu %14llu\n", keyCounts[k], (unsigned) length, (unsigned long long) receiveNs,
+			   (unsigned long long) initNs, (unsigned long long) lookupNs);
+	}
+
+	return 0;
+}
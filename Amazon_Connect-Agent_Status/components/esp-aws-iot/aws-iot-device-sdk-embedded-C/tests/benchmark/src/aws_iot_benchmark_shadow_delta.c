@@ -0,0 +1,159 @@
+/*
+* Copyright 2015-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_shadow_delta.c
+ * @brief Shadow delta dispatch: a key scan per registered key against the single pass dispatcher
+ */
+
+#include <string.h>
+
+#include "aws_iot_benchmark_common.h"
+#include "aws_iot_config.h"
+#include "aws_iot_shadow_json.h"
+#include "aws_iot_shadow_records.h"
+
+#define DELTA_BENCH_MAX_KEYS 128
+#define DELTA_BENCH_ITERATIONS 2000
+
+static char deltaDocument[SHADOW_MAX_SIZE_OF_RX_BUFFER];
+static char keyNames[DELTA_BENCH_MAX_KEYS][8];
+static int32_t keyValues[DELTA_BENCH_MAX_KEYS];
+static jsonStruct_t keyStructs[DELTA_BENCH_MAX_KEYS];
+static uint32_t callbackCount;
+
+static void countingCallback(const char *pJsonValueBuffer, uint32_t valueLength, jsonStruct_t *pJsonStruct_t) {
+	(void) pJsonValueBuffer;
+	(void) valueLength;
+	(void) pJsonStruct_t;
+	callbackCount++;
+}
+
+/* A delta as the service sends it: every key in state, a timestamp per key in metadata */
+static size_t buildDeltaDocument(uint32_t keyCount) {
+	size_t len = 0;
+	uint32_t i;
+
+	len += (size_t) snprintf(deltaDocument + len, sizeof(deltaDocument) - len, "{\"version\":7,\"timestamp\":1600000000,\"state\":{");
+	for(i = 0; i < keyCount; i++) {
+		len += (size_t) snprintf(deltaDocument + len, sizeof(deltaDocument) - len, "%s\"%s\":%u", i ? "," : "",
+								 keyNames[i], i + 1);
+	}
+	len += (size_t) snprintf(deltaDocument + len, sizeof(deltaDocument) - len, "},\"metadata\":{");
+	for(i = 0; i < keyCount; i++) {
+		len += (size_t) snprintf(deltaDocument + len, sizeof(deltaDocument) - len, "%s\"%s\":{\"timestamp\":1600000000}",
+								 i ? "," : "", keyNames[i]);
+	}
+	len += (size_t) snprintf(deltaDocument + len, sizeof(deltaDocument) - len, "}}");
+	return len;
+}
+
+static bool checkValues(uint32_t keyCount) {
+	uint32_t i;
+
+	for(i = 0; i < keyCount; i++) {
+		if(keyValues[i] != (int32_t) (i + 1)) {
+			return false;
+		}
+		keyValues[i] = 0;
+	}
+	return true;
+}
+
+/* What shadow_delta_callback did before: one scan of the tokens per registered key */
+static void dispatchPerKey(size_t docLen, uint32_t keyCount) {
+	int32_t tokenCount;
+	uint32_t dataLength;
+	int32_t dataPosition;
+	uint32_t i;
+
+	if(!isJsonValidAndParse(deltaDocument, docLen, NULL, &tokenCount)) {
+		return;
+	}
+	for(i = 0; i < keyCount; i++) {
+		if(isJsonKeyMatchingAndUpdateValue(deltaDocument, NULL, tokenCount, &keyStructs[i], &dataLength, &dataPosition)) {
+			keyStructs[i].cb(deltaDocument + dataPosition, dataLength, &keyStructs[i]);
+		}
+	}
+}
+
+static void dispatchSinglePass(size_t docLen) {
+	int32_t tokenCount;
+
+	if(!isJsonValidAndParse(deltaDocument, docLen, NULL, &tokenCount)) {
+		return;
+	}
+	dispatchDeltaTokens(deltaDocument, tokenCount);
+}
+
+int aws_iot_benchmark_shadow_delta(void) {
+	static const uint32_t keyCounts[] = {4, 32, 128};
+	size_t k;
+	uint32_t i;
+
+	for(i = 0; i < DELTA_BENCH_MAX_KEYS; i++) {
+		snprintf(keyNames[i], sizeof(keyNames[i]), "key%03u", i);
+		keyStructs[i].pKey = keyNames[i];
+		keyStructs[i].pData = &keyValues[i];
+		keyStructs[i].dataLength = sizeof(int32_t);
+		keyStructs[i].type = SHADOW_JSON_INT32;
+		keyStructs[i].cb = countingCallback;
+	}
+
+	printf("%6s %8s %14s %14s %8s\n", "keys", "bytes", "per-key ns", "one-pass ns", "speedup");
+	for(k = 0; k < sizeof(keyCounts) / sizeof(keyCounts[0]); k++) {
+		uint32_t keyCount = keyCounts[k];
+		size_t docLen = buildDeltaDocument(keyCount);
+		uint64_t start, perKeyNs, onePassNs;
+		uint32_t iter;
+
+		initDeltaTokens();
+		for(i = 0; i < keyCount; i++) {
+			if(SUCCESS != indexJsonTokenOnDelta(&keyStructs[i])) {
+				return 1;
+			}
+		}
+
+		callbackCount = 0;
+		dispatchPerKey(docLen, keyCount);
+		if(callbackCount != keyCount || !checkValues(keyCount)) {
+			printf("per-key dispatch missed keys (%u of %u)\n", callbackCount, keyCount);
+			return 1;
+		}
+		callbackCount = 0;
+		dispatchSinglePass(docLen);
+		if(callbackCount != keyCount || !checkValues(keyCount)) {
+			printf("single pass dispatch missed keys (%u of %u)\n", callbackCount, keyCount);
+			return 1;
+		}
+
+		start = aws_iot_benchmark_now_ns();
+		for(iter = 0; iter < DELTA_BENCH_ITERATIONS; iter++) {
+			dispatchPerKey(docLen, keyCount);
+		}
+		perKeyNs = (aws_iot_benchmark_now_ns() - start) / DELTA_BENCH_ITERATIONS;
+
+		start = aws_iot_benchmark_now_ns();
+		for(iter = 0; iter < DELTA_BENCH_ITERATIONS; iter++) {
+			dispatchSinglePass(docLen);
+		}
+		onePassNs = (aws_iot_benchmark_now_ns() - start) / DELTA_BENCH_ITERATIONS;
+
+		printf("%6u %8u %14llu %14llu %7.1fx\n", keyCount, (unsigned) docLen, (unsigned long long) perKeyNs,
+			   (unsigned long long) onePassNs, onePassNs ? (double) perKeyNs / (double) onePassNs : 0.0);
+	}
+
+	return 0;
+}
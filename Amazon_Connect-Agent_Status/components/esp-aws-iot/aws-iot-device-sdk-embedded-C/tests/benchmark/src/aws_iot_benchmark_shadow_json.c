@@ -0,0 +1,154 @@
+/*
+* Copyright 2015-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_shadow_json.c
+ * @brief Shadow update documents: strlen and snprintf per append against the JSON builder
+ */
+
+#include <string.h>
+
+#include "aws_iot_benchmark_common.h"
+#include "aws_iot_config.h"
+#include "aws_iot_shadow_interface.h"
+#include "aws_iot_shadow_json.h"
+#include "aws_iot_shadow_key.h"
+
+#define JSON_BENCH_MAX_MEMBERS 128
+#define JSON_BENCH_ITERATIONS 2000
+#define JSON_BENCH_BUFFER_SIZE 8192
+
+extern char mqttClientID[MAX_SIZE_OF_UNIQUE_CLIENT_ID_BYTES];
+
+static char referenceDocument[JSON_BENCH_BUFFER_SIZE];
+static char builderDocument[JSON_BENCH_BUFFER_SIZE];
+static char memberNames[JSON_BENCH_MAX_MEMBERS][12];
+static int32_t intValues[JSON_BENCH_MAX_MEMBERS];
+static float floatValues[JSON_BENCH_MAX_MEMBERS];
+static bool boolValues[JSON_BENCH_MAX_MEMBERS];
+static jsonStruct_t memberStructs[JSON_BENCH_MAX_MEMBERS];
+static jsonStruct_t *memberPointers[JSON_BENCH_MAX_MEMBERS];
+static uint32_t referenceTokenNum;
+
+/* The former convertDataToString */
+static void referenceValue(char *pBuffer, size_t size, const jsonStruct_t *pStruct) {
+	if(pStruct->type == SHADOW_JSON_INT32) {
+		snprintf(pBuffer, size, "%i,", *(int32_t *) pStruct->pData);
+	} else if(pStruct->type == SHADOW_JSON_FLOAT) {
+		snprintf(pBuffer, size, "%f,", *(float *) pStruct->pData);
+	} else if(pStruct->type == SHADOW_JSON_BOOL) {
+		snprintf(pBuffer, size, "%s,", *(bool *) pStruct->pData ? "true" : "false");
+	}
+}
+
+/* The former init / add_reported / finalize sequence, taking an array instead of variadic arguments */
+static void buildReference(uint32_t memberCount) {
+	uint32_t i;
+
+	snprintf(referenceDocument, sizeof(referenceDocument), "{\"state\":{");
+	snprintf(referenceDocument + strlen(referenceDocument), sizeof(referenceDocument) - strlen(referenceDocument),
+			 "\"reported\":{");
+	for(i = 0; i < memberCount; i++) {
+		snprintf(referenceDocument + strlen(referenceDocument), sizeof(referenceDocument) - strlen(referenceDocument),
+				 "\"%s\":", memberPointers[i]->pKey);
+		referenceValue(referenceDocument + strlen(referenceDocument),
+					   sizeof(referenceDocument) - strlen(referenceDocument), memberPointers[i]);
+	}
+	snprintf(referenceDocument + strlen(referenceDocument) - 1,
+			 sizeof(referenceDocument) - strlen(referenceDocument) + 1, "},");
+	snprintf(referenceDocument + strlen(referenceDocument) - 1,
+			 sizeof(referenceDocument) - strlen(referenceDocument) + 1, "}, \"%s\":\"", SHADOW_CLIENT_TOKEN_STRING);
+	snprintf(referenceDocument + strlen(referenceDocument), sizeof(referenceDocument) - strlen(referenceDocument),
+			 "%s-%d", mqttClientID, (int) referenceTokenNum++);
+	snprintf(referenceDocument + strlen(referenceDocument), sizeof(referenceDocument) - strlen(referenceDocument),
+			 "\"}");
+}
+
+static IoT_Error_t buildWithBuilder(uint32_t memberCount) {
+	ShadowJsonBuilder_t builder;
+	IoT_Error_t rc;
+
+	rc = aws_iot_shadow_json_builder_init(&builder, builderDocument, sizeof(builderDocument));
+	if(rc == SUCCESS) {
+		rc = aws_iot_shadow_json_builder_add_reported_array(&builder, (uint8_t) memberCount, memberPointers);
+	}
+	if(rc == SUCCESS) {
+		rc = aws_iot_shadow_json_builder_finalize(&builder);
+	}
+	return rc;
+}
+
+int aws_iot_benchmark_shadow_json(void) {
+	static const uint32_t memberCounts[] = {4, 32, 128};
+	size_t k;
+	uint32_t i;
+
+	snprintf(mqttClientID, sizeof(mqttClientID), "%s", AWS_IOT_MQTT_CLIENT_ID);
+	for(i = 0; i < JSON_BENCH_MAX_MEMBERS; i++) {
+		snprintf(memberNames[i], sizeof(memberNames[i]), "member%03u", i);
+		intValues[i] = (int32_t) (i * 7919u) - 500000;
+		floatValues[i] = (float) i * 0.37f - 12.5f;
+		boolValues[i] = (i & 1u) != 0;
+		memberStructs[i].pKey = memberNames[i];
+		memberStructs[i].cb = NULL;
+		if(i % 3 == 0) {
+			memberStructs[i].pData = &intValues[i];
+			memberStructs[i].dataLength = sizeof(int32_t);
+			memberStructs[i].type = SHADOW_JSON_INT32;
+		} else if(i % 3 == 1) {
+			memberStructs[i].pData = &floatValues[i];
+			memberStructs[i].dataLength = sizeof(float);
+			memberStructs[i].type = SHADOW_JSON_FLOAT;
+		} else {
+			memberStructs[i].pData = &boolValues[i];
+			memberStructs[i].dataLength = sizeof(bool);
+			memberStructs[i].type = SHADOW_JSON_BOOL;
+		}
+		memberPointers[i] = &memberStructs[i];
+	}
+
+	printf("%8s %8s %14s %14s %8s\n", "members", "bytes", "snprintf ns", "builder ns", "speedup");
+	for(k = 0; k < sizeof(memberCounts) / sizeof(memberCounts[0]); k++) {
+		uint32_t memberCount = memberCounts[k];
+		uint64_t start, referenceNs, builderNs;
+		uint32_t iter;
+
+		referenceTokenNum = 0;
+		resetClientTokenSequenceNum();
+		buildReference(memberCount);
+		if(SUCCESS != buildWithBuilder(memberCount) || 0 != strcmp(referenceDocument, builderDocument)) {
+			printf("documents differ\n%s\n%s\n", referenceDocument, builderDocument);
+			return 1;
+		}
+
+		start = aws_iot_benchmark_now_ns();
+		for(iter = 0; iter < JSON_BENCH_ITERATIONS; iter++) {
+			buildReference(memberCount);
+		}
+		referenceNs = (aws_iot_benchmark_now_ns() - start) / JSON_BENCH_ITERATIONS;
+
+		start = aws_iot_benchmark_now_ns();
+		for(iter = 0; iter < JSON_BENCH_ITERATIONS; iter++) {
+			buildWithBuilder(memberCount);
+		}
+		builderNs = (aws_iot_benchmark_now_ns() - start) / JSON_BENCH_ITERATIONS;
+
+		printf("%8u %8u %14llu %14llu %7.1fx\n", memberCount, (unsigned) strlen(builderDocument),
+			   (unsigned long long) referenceNs, (unsigned long long) builderNs,
+			   builderNs ? (double) referenceNs / (double) builderNs : 0.0);
+	}
+
+	return 0;
+}
@@ -61,11 +61,17 @@ void setTLSRxBufferForDoubleSuback(char *topicName, size_t topicNameLen, QoS qos
 
 void setTLSRxBufferForSubFail(void);
 
+void setTLSRxBufferForMultiSuback(const uint32_t *pQoSCountList, uint32_t subackCount, QoS qos);
+
 void setTLSRxBufferWithMsgOnSubscribedTopic(char *topicName, size_t topicNameLen, QoS qos,
 											IoT_Publish_Message_Params params, char *pMsg);
 
 void setTLSRxBufferForUnsuback(void);
 
+void setTLSRxBufferForMultiUnsuback(uint32_t unsubackCount);
+
+void appendTLSRxBufferForUnsuback(uint32_t unsubackCount);
+
 void setTLSRxBufferForPingresp(void);
 
 void setTLSRxBufferForError(IoT_Error_t error);
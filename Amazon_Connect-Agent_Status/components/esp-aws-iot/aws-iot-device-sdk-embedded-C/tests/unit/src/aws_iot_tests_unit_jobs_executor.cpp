@@ -0,0 +1,38 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_jobs_executor.cpp
+ * @brief IoT Client Unit Testing - Jobs Executor Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(JobsExecutorTest){
+	TEST_GROUP_C_SETUP_WRAPPER(JobsExecutorTest)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(JobsExecutorTest)
+};
+
+TEST_GROUP_C_WRAPPER(JobsExecutorTest, RegisterHandlerChecks)
+TEST_GROUP_C_WRAPPER(JobsExecutorTest, StartPullsNextJob)
+TEST_GROUP_C_WRAPPER(JobsExecutorTest, NoPendingJobWaitsForNotifyNext)
+TEST_GROUP_C_WRAPPER(JobsExecutorTest, ParametersStreamedToHandler)
+TEST_GROUP_C_WRAPPER(JobsExecutorTest, GroupsRunInOrderAndInParallel)
+TEST_GROUP_C_WRAPPER(JobsExecutorTest, InvalidDocumentFailsJob)
+TEST_GROUP_C_WRAPPER(JobsExecutorTest, StepTimeoutFailsJob)
+TEST_GROUP_C_WRAPPER(JobsExecutorTest, ProgressUpdatesBatched)
+TEST_GROUP_C_WRAPPER(JobsExecutorTest, RejectedProgressCancelsJob)
+TEST_GROUP_C_WRAPPER(JobsExecutorTest, TransientRejectionKeepsJob)
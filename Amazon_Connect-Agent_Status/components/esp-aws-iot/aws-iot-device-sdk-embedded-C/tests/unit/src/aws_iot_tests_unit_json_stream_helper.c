@@ -0,0 +1,319 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_json_stream_helper.c
+ * @brief IoT Client Unit Testing - JSON Stream Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_json_stream.h"
+#include "aws_iot_log.h"
+
+#define STREAM_TEST_DOCUMENT \
+	"{\"state\":{\"reported\":{\"list\":[1,{\"a\":true},\"x\"],\"n\":null,\"e\":[]}}, " \
+	"\"version\":-1.5e+3,\"s\":\"a\\\"b\\u00e9\",\"o\":{}}"
+
+#define STREAM_TEST_LOG_SIZE 4096
+#define STREAM_TEST_FUZZ_ROUNDS 3000
+
+typedef struct {
+	char text[STREAM_TEST_LOG_SIZE];
+	size_t length;
+} EventLog_t;
+
+static EventLog_t wholeLog;
+static EventLog_t chunkedLog;
+
+static void logEvent(const JsonStreamEvent_t *pEvent, void *pContext) {
+	static const char types[] = "{}[]snbz";
+	EventLog_t *pLog = (EventLog_t *) pContext;
+	int written;
+
+	written = snprintf(pLog->text + pLog->length, sizeof(pLog->text) - pLog->length, "%c%u %s[%.*s]=%.*s\n",
+					   types[pEvent->type], (unsigned) pEvent->depth, pEvent->pPath ? pEvent->pPath : "-",
+					   (int) pEvent->keyLength, pEvent->pKey ? pEvent->pKey : "",
+					   (int) pEvent->valueLength, pEvent->pValue ? pEvent->pValue : "");
+	if(written > 0) {
+		pLog->length += (size_t) written;
+		if(pLog->length >= sizeof(pLog->text)) {
+			pLog->length = sizeof(pLog->text) - 1;
+		}
+	}
+}
+
+static IoT_Error_t parseInChunks(const char *pJson, size_t length, const size_t *pSplits, size_t splitCount,
+								 EventLog_t *pLog) {
+	JsonStreamParser_t parser;
+	IoT_Error_t rc;
+	size_t offset = 0;
+	size_t i;
+
+	memset(pLog, 0, sizeof(EventLog_t));
+	aws_iot_json_stream_init(&parser, logEvent, pLog);
+	for(i = 0; i <= splitCount; i++) {
+		size_t end = (i < splitCount) ? pSplits[i] : length;
+
+		rc = aws_iot_json_stream_feed(&parser, pJson + offset, end - offset);
+		if(SUCCESS != rc) {
+			return rc;
+		}
+		offset = end;
+	}
+	return aws_iot_json_stream_finish(&parser);
+}
+
+static IoT_Error_t parseWhole(const char *pJson, EventLog_t *pLog) {
+	return parseInChunks(pJson, strlen(pJson), NULL, 0, pLog);
+}
+
+/* Deterministic, so a failing round can be reproduced */
+static uint32_t fuzzState;
+
+static uint32_t fuzzRandom(void) {
+	fuzzState ^= fuzzState << 13;
+	fuzzState ^= fuzzState >> 17;
+	fuzzState ^= fuzzState << 5;
+	return fuzzState;
+}
+
+TEST_GROUP_C_SETUP(JsonStreamTests) {
+	memset(&wholeLog, 0, sizeof(wholeLog));
+	memset(&chunkedLog, 0, sizeof(chunkedLog));
+}
+
+TEST_GROUP_C_TEARDOWN(JsonStreamTests) { }
+
+TEST_C(JsonStreamTests, EventsWithPaths) {
+	IOT_DEBUG("-->Running JSON Stream Tests - Events with paths \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, parseWhole(STREAM_TEST_DOCUMENT, &wholeLog));
+	CHECK_EQUAL_C_STRING("{0 []=\n"
+						 "{1 state[state]=\n"
+						 "{2 state.reported[reported]=\n"
+						 "[3 state.reported.list[list]=\n"
+						 "n4 state.reported.list.0[]=1\n"
+						 "{4 state.reported.list.1[]=\n"
+						 "b5 state.reported.list.1.a[a]=true\n"
+						 "}4 state.reported.list.1[]=\n"
+						 "s4 state.reported.list.2[]=x\n"
+						 "]3 state.reported.list[list]=\n"
+						 "z3 state.reported.n[n]=null\n"
+						 "[3 state.reported.e[e]=\n"
+						 "]3 state.reported.e[e]=\n"
+						 "}2 state.reported[reported]=\n"
+						 "}1 state[state]=\n"
+						 "n1 version[version]=-1.5e+3\n"
+						 "s1 s[s]=a\\\"b\\u00e9\n"
+						 "{1 o[o]=\n"
+						 "}1 o[o]=\n"
+						 "}0 []=\n", wholeLog.text);
+
+	/* Any top level value */
+	CHECK_EQUAL_C_INT(SUCCESS, parseWhole(" 42 ", &wholeLog));
+	CHECK_EQUAL_C_STRING("n0 []=42\n", wholeLog.text);
+	CHECK_EQUAL_C_INT(SUCCESS, parseWhole("false", &wholeLog));
+	CHECK_EQUAL_C_STRING("b0 []=false\n", wholeLog.text);
+
+	IOT_DEBUG("-->Success - Events with paths \n");
+}
+
+TEST_C(JsonStreamTests, EverySplitMatchesWholeDocument) {
+	const char *pJson = STREAM_TEST_DOCUMENT;
+	size_t length = strlen(pJson);
+	size_t splits[2];
+	size_t i, j;
+
+	IOT_DEBUG("-->Running JSON Stream Tests - Every split matches whole document \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, parseWhole(pJson, &wholeLog));
+
+	for(i = 0; i <= length; i++) {
+		for(j = i; j <= length; j++) {
+			splits[0] = i;
+			splits[1] = j;
+			CHECK_EQUAL_C_INT(SUCCESS, parseInChunks(pJson, length, splits, 2, &chunkedLog));
+			CHECK_EQUAL_C_STRING(wholeLog.text, chunkedLog.text);
+		}
+	}
+
+	/* One byte at a time */
+	{
+		size_t bytes[sizeof(STREAM_TEST_DOCUMENT)];
+
+		for(i = 0; i < length; i++) {
+			bytes[i] = i;
+		}
+		CHECK_EQUAL_C_INT(SUCCESS, parseInChunks(pJson, length, bytes, length, &chunkedLog));
+		CHECK_EQUAL_C_STRING(wholeLog.text, chunkedLog.text);
+	}
+
+	IOT_DEBUG("-->Success - Every split matches whole document \n");
+}
+
+TEST_C(JsonStreamTests, InvalidDocuments) {
+	static const char *const invalid[] = {
+		"", " ", "{", "}", "{\"a\"}", "{\"a\":}", "{\"a\":1,}", "[1,]", "[1 2]", "{\"a\":1}}", "{\"a\":1} x",
+		"[}", "{]", "{\"a\" 1}", "{a:1}", "01", "1.", "-", "1e", ".5", "+1", "tru", "truex", "nul", "\"ab",
+		"\"\\x\"", "\"\\u12G4\"", "\"a\tb\"", "{\"a\":[1,{\"b\":2]}", "[\"a\"\"b\"]"
+	};
+	static const char *const valid[] = {
+		"{}", "[]", "\"\"", "0", "-0.5e+3", " true ", "{\"a\":[[]]}", "\"\\\\\\/\\b\\f\\n\\r\\t\\uABcd\"",
+		"[1,2E-2,\"x\",null,{}]"
+	};
+	JsonStreamParser_t parser;
+	size_t i;
+
+	IOT_DEBUG("-->Running JSON Stream Tests - Invalid documents \n");
+
+	for(i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+		IOT_DEBUG("%s\n", invalid[i]);
+		CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, parseWhole(invalid[i], &wholeLog));
+	}
+	for(i = 0; i < sizeof(valid) / sizeof(valid[0]); i++) {
+		IOT_DEBUG("%s\n", valid[i]);
+		CHECK_EQUAL_C_INT(SUCCESS, parseWhole(valid[i], &wholeLog));
+	}
+
+	/* The first error sticks */
+	aws_iot_json_stream_init(&parser, NULL, NULL);
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, aws_iot_json_stream_feed(&parser, "{\"a\":x", 6));
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, aws_iot_json_stream_feed(&parser, "1}", 2));
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, aws_iot_json_stream_finish(&parser));
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_json_stream_init(NULL, NULL, NULL));
+	aws_iot_json_stream_init(&parser, NULL, NULL);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_json_stream_feed(&parser, NULL, 1));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_json_stream_feed(&parser, NULL, 0));
+
+	IOT_DEBUG("-->Success - Invalid documents \n");
+}
+
+TEST_C(JsonStreamTests, Limits) {
+	char json[JSON_STREAM_MAX_PATH_LENGTH * 2 + 32];
+	size_t splits[1];
+	size_t i, length;
+
+	IOT_DEBUG("-->Running JSON Stream Tests - Limits \n");
+
+	/* Nesting */
+	for(i = 0; i < JSON_STREAM_MAX_DEPTH; i++) {
+		json[i] = '[';
+		json[2 * JSON_STREAM_MAX_DEPTH - 1 - i] = ']';
+	}
+	json[2 * JSON_STREAM_MAX_DEPTH] = '\0';
+	CHECK_EQUAL_C_INT(SUCCESS, parseWhole(json, &wholeLog));
+	for(i = 0; i <= JSON_STREAM_MAX_DEPTH; i++) {
+		json[i] = '[';
+		json[2 * JSON_STREAM_MAX_DEPTH + 1 - i] = ']';
+	}
+	json[2 * JSON_STREAM_MAX_DEPTH + 2] = '\0';
+	CHECK_EQUAL_C_INT(LIMIT_EXCEEDED_ERROR, parseWhole(json, &wholeLog));
+
+	/* A path that does not fit, and everything below it, has no path or key */
+	length = (size_t) snprintf(json, sizeof(json), "{\"%0*d\":{\"b\":1},\"c\":2}", JSON_STREAM_MAX_PATH_LENGTH + 1, 0);
+	CHECK_EQUAL_C_INT(SUCCESS, parseWhole(json, &wholeLog));
+	CHECK_C(NULL != strstr(wholeLog.text, "{1 -[]=\nn2 -[]=1\n}1 -[]=\nn1 c[c]=2\n"));
+
+	/* A long value only needs the parser's buffer when it is split */
+	length = (size_t) snprintf(json, sizeof(json), "[\"%0*d\"]", JSON_STREAM_MAX_VALUE_LENGTH + 1, 0);
+	CHECK_EQUAL_C_INT(SUCCESS, parseWhole(json, &wholeLog));
+	splits[0] = 4;
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, parseInChunks(json, length, splits, 1, &chunkedLog));
+	length = (size_t) snprintf(json, sizeof(json), "[\"%0*d\"]", JSON_STREAM_MAX_VALUE_LENGTH, 0);
+	CHECK_EQUAL_C_INT(SUCCESS, parseInChunks(json, length, splits, 1, &chunkedLog));
+
+	IOT_DEBUG("-->Success - Limits \n");
+}
+
+TEST_C(JsonStreamTests, FuzzedDocuments) {
+	static const char *const seeds[] = {
+		STREAM_TEST_DOCUMENT,
+		"{\"state\":{\"desired\":{\"Name\":\"AVAILABLE\"}},\"metadata\":{\"desired\":{\"Name\":{\"timestamp\":1}}},"
+		"\"version\":42,\"timestamp\":1600000001,\"clientToken\":\"client-1\"}",
+		"[0,-0,1e5,true,false,null,\"\\u0041\",[[{}]],{\"\":\"\"}]"
+	};
+	static const char structural[] = "{}[]\":,\\ -0e.tfn";
+	char json[256];
+	size_t splits[4];
+	uint32_t round, validCount = 0;
+
+	IOT_DEBUG("-->Running JSON Stream Tests - Fuzzed documents \n");
+
+	fuzzState = 0x2545F491u;
+	for(round = 0; round < STREAM_TEST_FUZZ_ROUNDS; round++) {
+		size_t length, k, mutations;
+		IoT_Error_t wholeRc, chunkedRc;
+
+		length = (size_t) snprintf(json, sizeof(json), "%s", seeds[fuzzRandom() % (sizeof(seeds) / sizeof(seeds[0]))]);
+		mutations = 1 + fuzzRandom() % 3;
+		for(k = 0; k < mutations && length > 0; k++) {
+			size_t at = fuzzRandom() % length;
+
+			switch(fuzzRandom() % 4) {
+				case 0: /* Replace with a structural character */
+					json[at] = structural[fuzzRandom() % (sizeof(structural) - 1)];
+					break;
+				case 1: /* Replace with any byte */
+					json[at] = (char) (1 + fuzzRandom() % 255);
+					break;
+				case 2: /* Delete */
+					memmove(json + at, json + at + 1, length - at);
+					length--;
+					break;
+				default: /* Truncate */
+					length = at;
+					json[length] = '\0';
+					break;
+			}
+		}
+
+		for(k = 0; k < sizeof(splits) / sizeof(splits[0]); k++) {
+			splits[k] = length ? fuzzRandom() % (length + 1) : 0;
+		}
+		/* Ascending */
+		for(k = 1; k < sizeof(splits) / sizeof(splits[0]); k++) {
+			size_t m;
+
+			for(m = k; m > 0 && splits[m - 1] > splits[m]; m--) {
+				size_t swap = splits[m];
+
+				splits[m] = splits[m - 1];
+				splits[m - 1] = swap;
+			}
+		}
+
+		wholeRc = parseInChunks(json, length, NULL, 0, &wholeLog);
+		chunkedRc = parseInChunks(json, length, splits, sizeof(splits) / sizeof(splits[0]), &chunkedLog);
+
+		/* A mutation can turn the rest of the document into one string, too long to carry across chunks */
+		if(MAX_SIZE_ERROR == chunkedRc) {
+			continue;
+		}
+		CHECK_EQUAL_C_INT(wholeRc, chunkedRc);
+		CHECK_EQUAL_C_STRING(wholeLog.text, chunkedLog.text);
+		if(SUCCESS == wholeRc) {
+			validCount++;
+		}
+	}
+
+	/* Some mutations keep the document valid, e.g. a digit for a digit */
+	CHECK_C(validCount > 0);
+
+	IOT_DEBUG("-->Success - Fuzzed documents \n");
+}
@@ -762,6 +762,245 @@ TEST_C(ShadowActionTests, ACKWaitingMoreThanAllowed) {
 	IOT_DEBUG("-->Success - Ack waiting more than allowed wait time \n");
 }
 
+static uint8_t acksRx[MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME];
+static Shadow_Ack_Status_t acksStatusRx[MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME];
+
+static void countingActionCallback(const char *pThingName, ShadowActions_t action, Shadow_Ack_Status_t status,
+								   const char *pReceivedJsonDocument, void *pContextData) {
+	uint8_t request = *(uint8_t *) pContextData;
+
+	IOT_UNUSED(pThingName);
+	IOT_UNUSED(action);
+	IOT_UNUSED(pReceivedJsonDocument);
+	acksRx[request]++;
+	acksStatusRx[request] = status;
+}
+
+/* unsubackCount is the number of unsubscribes the response leads to */
+static void respondToGet(uint8_t request, char *pTopic, uint32_t unsubackCount) {
+	IoT_Publish_Message_Params params;
+	char response[100];
+	IoT_Error_t ret_val;
+
+	snprintf(response, sizeof(response), "{\"version\":3,\"clientToken\":\"%s-%u\"}", AWS_IOT_MQTT_CLIENT_ID,
+			 (unsigned) request);
+	params.qos = QOS0;
+	params.payloadLen = strlen(response);
+	params.payload = response;
+	ResetTLSBuffer();
+	setTLSRxBufferWithMsgOnSubscribedTopic(pTopic, strlen(pTopic), QOS0, params, params.payload);
+	appendTLSRxBufferForUnsuback(unsubackCount);
+	ret_val = aws_iot_shadow_yield(&client, 200);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+}
+
+TEST_C(ShadowActionTests, ManyAcksAnsweredOutOfOrder) {
+	IoT_Error_t ret_val = SUCCESS;
+	char getRequestJson[TEST_JSON_SIZE];
+	uint8_t requests[MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME];
+	uint8_t i;
+
+	IOT_DEBUG("-->Running Shadow Action Tests - Many acks answered out of order \n");
+
+	memset(acksRx, 0, sizeof(acksRx));
+	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
+		requests[i] = i;
+		aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
+		ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE,
+												 countingActionCallback, &requests[i], 100, false);
+		CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	}
+
+	// Answer from the last request back, every other one rejected
+	for(i = MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i > 0; i--) {
+		respondToGet(i - 1, (i % 2) ? GET_ACCEPTED_TOPIC : GET_REJECTED_TOPIC, 0);
+		CHECK_EQUAL_C_INT(1, acksRx[i - 1]);
+		CHECK_EQUAL_C_INT((i % 2) ? SHADOW_ACK_ACCEPTED : SHADOW_ACK_REJECTED, acksStatusRx[i - 1]);
+	}
+
+	// A second response to the same token is not matched
+	respondToGet(0, GET_ACCEPTED_TOPIC, 0);
+	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
+		CHECK_EQUAL_C_INT(1, acksRx[i]);
+	}
+
+	// All records were freed
+	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
+		aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
+		ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE,
+												 countingActionCallback, &requests[i], 100, false);
+		CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	}
+
+	IOT_DEBUG("-->Success - Many acks answered out of order \n");
+}
+
+TEST_C(ShadowActionTests, OnlyDueAcksTimeOut) {
+	IoT_Error_t ret_val = SUCCESS;
+	char getRequestJson[TEST_JSON_SIZE];
+	uint8_t requests[3] = {0, 1, 2};
+	uint32_t timeouts[3] = {1, 100, 2};
+	uint8_t i;
+
+	IOT_DEBUG("-->Running Shadow Action Tests - Only due acks time out \n");
+
+	memset(acksRx, 0, sizeof(acksRx));
+	for(i = 0; i < 3; i++) {
+		aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
+		ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE,
+												 countingActionCallback, &requests[i], timeouts[i], false);
+		CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	}
+
+	// Never before the timeout
+	ret_val = aws_iot_shadow_yield(&client, 200);
+	CHECK_EQUAL_C_INT(0, acksRx[0]);
+
+	advance_timer_clock_ms((2 + 1) * 1000);
+	ret_val = aws_iot_shadow_yield(&client, 200);
+	CHECK_EQUAL_C_INT(1, acksRx[0]);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_TIMEOUT, acksStatusRx[0]);
+	CHECK_EQUAL_C_INT(0, acksRx[1]);
+	CHECK_EQUAL_C_INT(1, acksRx[2]);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_TIMEOUT, acksStatusRx[2]);
+
+	// The remaining request is still matched, and the accepted and rejected topics unsubscribed
+	respondToGet(1, GET_ACCEPTED_TOPIC, 2);
+	CHECK_EQUAL_C_INT(1, acksRx[1]);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_ACCEPTED, acksStatusRx[1]);
+	CHECK_EQUAL_C_INT(1, acksRx[0]);
+	CHECK_EQUAL_C_INT(1, acksRx[2]);
+
+	IOT_DEBUG("-->Success - Only due acks time out \n");
+}
+
+static void requestGet(uint8_t *pRequest, uint32_t timeoutSeconds) {
+	char getRequestJson[TEST_JSON_SIZE];
+	IoT_Error_t ret_val;
+
+	// Sticky, so that timing out does not wait for an unsuback
+	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE,
+											 countingActionCallback, pRequest, timeoutSeconds, true);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+}
+
+TEST_C(ShadowActionTests, AcksTimeOutAfterGapLongerThanWheelClock) {
+	uint8_t requests[3] = {0, 1, 2};
+
+	IOT_DEBUG("-->Running Shadow Action Tests - Acks time out after a gap longer than the wheel clock \n");
+
+	memset(acksRx, 0, sizeof(acksRx));
+	requestGet(&requests[0], 2);
+	requestGet(&requests[1], 200);
+
+	// No yield for more than the hour the wheel clock counts down, every request is due
+	advance_timer_clock_ms(3600 * 1000 + 1000);
+	aws_iot_shadow_yield(&client, 200);
+	CHECK_EQUAL_C_INT(1, acksRx[0]);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_TIMEOUT, acksStatusRx[0]);
+	CHECK_EQUAL_C_INT(1, acksRx[1]);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_TIMEOUT, acksStatusRx[1]);
+
+	// The restarted clock times out new requests when they are due
+	requestGet(&requests[2], 2);
+	advance_timer_clock_ms(1000);
+	aws_iot_shadow_yield(&client, 200);
+	CHECK_EQUAL_C_INT(0, acksRx[2]);
+	advance_timer_clock_ms(2000);
+	aws_iot_shadow_yield(&client, 200);
+	CHECK_EQUAL_C_INT(1, acksRx[2]);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_TIMEOUT, acksStatusRx[2]);
+
+	IOT_DEBUG("-->Success - Acks time out after a gap longer than the wheel clock \n");
+}
+
+TEST_C(ShadowActionTests, AcksTimeOutAfterSeveralWheelTurns) {
+	uint8_t requests[4] = {0, 1, 2, 3};
+	uint32_t timeouts[4] = {20, 40, 60, 200};
+	uint8_t i;
+
+	IOT_DEBUG("-->Running Shadow Action Tests - Acks time out after several wheel turns \n");
+
+	// Due after more than one turn of the wheel, so on their slot with turns still to wait
+	memset(acksRx, 0, sizeof(acksRx));
+	for(i = 0; i < 4; i++) {
+		requestGet(&requests[i], timeouts[i]);
+	}
+
+	advance_timer_clock_ms(10 * 1000);
+	aws_iot_shadow_yield(&client, 200);
+	for(i = 0; i < 4; i++) {
+		CHECK_EQUAL_C_INT(0, acksRx[i]);
+	}
+
+	// One gap of more than two turns takes the first two
+	advance_timer_clock_ms(35 * 1000);
+	aws_iot_shadow_yield(&client, 200);
+	CHECK_EQUAL_C_INT(1, acksRx[0]);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_TIMEOUT, acksStatusRx[0]);
+	CHECK_EQUAL_C_INT(1, acksRx[1]);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_TIMEOUT, acksStatusRx[1]);
+	CHECK_EQUAL_C_INT(0, acksRx[2]);
+
+	advance_timer_clock_ms(20 * 1000);
+	aws_iot_shadow_yield(&client, 200);
+	CHECK_EQUAL_C_INT(1, acksRx[0]);
+	CHECK_EQUAL_C_INT(1, acksRx[1]);
+	CHECK_EQUAL_C_INT(1, acksRx[2]);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_TIMEOUT, acksStatusRx[2]);
+
+	// The last one is still waiting and matched
+	CHECK_EQUAL_C_INT(0, acksRx[3]);
+	respondToGet(3, GET_ACCEPTED_TOPIC, 0);
+	CHECK_EQUAL_C_INT(1, acksRx[3]);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_ACCEPTED, acksStatusRx[3]);
+
+	IOT_DEBUG("-->Success - Acks time out after several wheel turns \n");
+}
+
+static uint8_t retryRequest = 1;
+
+static void retryingActionCallback(const char *pThingName, ShadowActions_t action, Shadow_Ack_Status_t status,
+								   const char *pReceivedJsonDocument, void *pContextData) {
+	countingActionCallback(pThingName, action, status, pReceivedJsonDocument, pContextData);
+	if(SHADOW_ACK_TIMEOUT == status) {
+		requestGet(&retryRequest, 2);
+	}
+}
+
+TEST_C(ShadowActionTests, TimeoutCallbackSendsNewRequest) {
+	IoT_Error_t ret_val = SUCCESS;
+	char getRequestJson[TEST_JSON_SIZE];
+	uint8_t request = 0;
+
+	IOT_DEBUG("-->Running Shadow Action Tests - Timeout callback sends a new request \n");
+
+	memset(acksRx, 0, sizeof(acksRx));
+	aws_iot_shadow_internal_get_request_json(getRequestJson, TEST_JSON_SIZE);
+	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE,
+											 retryingActionCallback, &request, 1, true);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+
+	advance_timer_clock_ms(3 * 1000);
+	aws_iot_shadow_yield(&client, 200);
+	CHECK_EQUAL_C_INT(1, acksRx[0]);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_TIMEOUT, acksStatusRx[0]);
+
+	// The request sent from the callback waits for its own timeout
+	CHECK_EQUAL_C_INT(0, acksRx[1]);
+	advance_timer_clock_ms(1000);
+	aws_iot_shadow_yield(&client, 200);
+	CHECK_EQUAL_C_INT(0, acksRx[1]);
+	advance_timer_clock_ms(3 * 1000);
+	aws_iot_shadow_yield(&client, 200);
+	CHECK_EQUAL_C_INT(1, acksRx[1]);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_TIMEOUT, acksStatusRx[1]);
+	CHECK_EQUAL_C_INT(1, acksRx[0]);
+
+	IOT_DEBUG("-->Success - Timeout callback sends a new request \n");
+}
+
 TEST_C(ShadowActionTests, InboundDataTooBigForBuffer) {
 	uint32_t i = 0;
 	IoT_Error_t ret_val = SUCCESS;
@@ -921,6 +1160,7 @@ TEST_C(ShadowActionTests, NoCallbackForShadowAction) {
 	ret_val = aws_iot_shadow_internal_action(AWS_IOT_MY_THING_NAME, SHADOW_GET, getRequestJson, TEST_JSON_SIZE, NULL, NULL, 4, false);
 	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
 
+	params.qos = QOS0;
 	params.payloadLen = strlen(TEST_JSON_RESPONSE_FULL_DOCUMENT);
 	params.payload = TEST_JSON_RESPONSE_FULL_DOCUMENT;
 	setTLSRxBufferWithMsgOnSubscribedTopic(GET_ACCEPTED_TOPIC, strlen(GET_ACCEPTED_TOPIC), QOS0, params,
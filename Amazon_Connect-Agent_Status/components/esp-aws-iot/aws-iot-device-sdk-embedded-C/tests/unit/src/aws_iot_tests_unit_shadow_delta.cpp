@@ -31,3 +31,5 @@ TEST_GROUP_C_WRAPPER(ShadowDeltaTest, registerDeltaInt)
 TEST_GROUP_C_WRAPPER(ShadowDeltaTest, registerDeltaIntNoCallback)
 TEST_GROUP_C_WRAPPER(ShadowDeltaTest, DeltaNestedObject)
 TEST_GROUP_C_WRAPPER(ShadowDeltaTest, DeltaVersionIgnoreOldVersion)
+TEST_GROUP_C_WRAPPER(ShadowDeltaTest, DeltaManyKeysOnePass)
+TEST_GROUP_C_WRAPPER(ShadowDeltaTest, DeltaNestedPathKey)
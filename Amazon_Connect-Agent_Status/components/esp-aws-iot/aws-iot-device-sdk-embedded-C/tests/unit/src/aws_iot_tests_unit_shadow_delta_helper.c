@@ -322,3 +322,79 @@ TEST_C(ShadowDeltaTest, DeltaVersionIgnoreOldVersion) {
 	aws_iot_shadow_yield(&client, 100);
 	CHECK_EQUAL_C_STRING(sentNestedObjectData, receivedNestedObject);
 }
+
+TEST_C(ShadowDeltaTest, DeltaManyKeysOnePass) {
+	jsonStruct_t handlers[3];
+	int32_t values[3] = {0, 0, 0};
+	const char *keys[3] = {"first", "second", "third"};
+	char deltaJSONString[] = "{\"state\":{\"third\":3,\"first\":1,\"second\":2},"
+			"\"metadata\":{\"first\":7},\"version\":1}";
+	IoT_Publish_Message_Params params;
+	uint8_t i;
+
+	IOT_DEBUG("\n-->Running Shadow Delta Tests - several keys dispatched from one delta \n");
+
+	params.payloadLen = strlen(deltaJSONString);
+	params.payload = deltaJSONString;
+	params.qos = QOS0;
+
+	ResetTLSBuffer();
+	setTLSRxBufferForSuback(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params);
+
+	for(i = 0; i < 3; i++) {
+		handlers[i].cb = genericCallback;
+		handlers[i].pKey = keys[i];
+		handlers[i].type = SHADOW_JSON_INT32;
+		handlers[i].pData = &values[i];
+		handlers[i].dataLength = sizeof(int32_t);
+		CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_register_delta(&client, &handlers[i]));
+	}
+
+	ResetTLSBuffer();
+	setTLSRxBufferWithMsgOnSubscribedTopic(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params, params.payload);
+
+	aws_iot_shadow_yield(&client, 100);
+	CHECK_EQUAL_C_INT(1, values[0]);
+	CHECK_EQUAL_C_INT(2, values[1]);
+	CHECK_EQUAL_C_INT(3, values[2]);
+}
+
+TEST_C(ShadowDeltaTest, DeltaNestedPathKey) {
+	jsonStruct_t colorHandler;
+	jsonStruct_t levelHandler;
+	int32_t color = 0;
+	int32_t level = 0;
+	char deltaJSONString[] = "{\"state\":{\"light\":{\"color\":5,\"dim\":{\"level\":40}}},\"version\":1}";
+	IoT_Publish_Message_Params params;
+
+	IOT_DEBUG("\n-->Running Shadow Delta Tests - delta key registered as a path \n");
+
+	colorHandler.cb = NULL;
+	colorHandler.pKey = "light.color";
+	colorHandler.type = SHADOW_JSON_INT32;
+	colorHandler.pData = &color;
+	colorHandler.dataLength = sizeof(int32_t);
+
+	levelHandler.cb = NULL;
+	levelHandler.pKey = "light.dim.level";
+	levelHandler.type = SHADOW_JSON_INT32;
+	levelHandler.pData = &level;
+	levelHandler.dataLength = sizeof(int32_t);
+
+	params.payloadLen = strlen(deltaJSONString);
+	params.payload = deltaJSONString;
+	params.qos = QOS0;
+
+	ResetTLSBuffer();
+	setTLSRxBufferForSuback(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_register_delta(&client, &colorHandler));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_register_delta(&client, &levelHandler));
+
+	ResetTLSBuffer();
+	setTLSRxBufferWithMsgOnSubscribedTopic(shadowDeltaTopic, strlen(shadowDeltaTopic), QOS0, params, params.payload);
+
+	aws_iot_shadow_yield(&client, 100);
+	CHECK_EQUAL_C_INT(5, color);
+	CHECK_EQUAL_C_INT(40, level);
+}
@@ -0,0 +1,37 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_shadow_manager.cpp
+ * @brief IoT Client Unit Testing - Shadow Manager Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(ShadowManagerTest){
+	TEST_GROUP_C_SETUP_WRAPPER(ShadowManagerTest)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(ShadowManagerTest)
+};
+
+TEST_GROUP_C_WRAPPER(ShadowManagerTest, ContextInitNameChecks)
+TEST_GROUP_C_WRAPPER(ShadowManagerTest, AddSubscribesOncePerKind)
+TEST_GROUP_C_WRAPPER(ShadowManagerTest, DeltaRoutedToItsThing)
+TEST_GROUP_C_WRAPPER(ShadowManagerTest, DeltaVersionPerShadow)
+TEST_GROUP_C_WRAPPER(ShadowManagerTest, NamedShadowUpdateAccepted)
+TEST_GROUP_C_WRAPPER(ShadowManagerTest, GetTimeout)
+TEST_GROUP_C_WRAPPER(ShadowManagerTest, RemoveStopsRouting)
+TEST_GROUP_C_WRAPPER(ShadowManagerTest, RemoveLastShadowUnsubscribes)
+TEST_GROUP_C_WRAPPER(ShadowManagerTest, OwnTokensAndClientTokens)
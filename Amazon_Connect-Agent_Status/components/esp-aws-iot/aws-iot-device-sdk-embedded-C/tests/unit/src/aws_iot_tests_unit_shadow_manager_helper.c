@@ -0,0 +1,331 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_shadow_manager_helper.c
+ * @brief IoT Client Unit Testing - Shadow Manager Tests Helper
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_shadow_manager.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_log.h"
+
+#define THING_A "ThingA"
+#define THING_B "ThingB"
+
+static AWS_IoT_Client client;
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static IoT_Publish_Message_Params msgParams;
+static ShadowManager_t manager;
+static ShadowContext_t shadowA;
+static ShadowContext_t shadowB;
+static jsonStruct_t tempA;
+static jsonStruct_t tempB;
+static int32_t tempDataA;
+static int32_t tempDataB;
+
+static char ackThingName[MAX_SIZE_OF_THING_NAME];
+static ShadowActions_t ackAction;
+static Shadow_Ack_Status_t ackStatus;
+static uint8_t ackCount;
+
+static void actionCallback(const char *pThingName, ShadowActions_t action, Shadow_Ack_Status_t status,
+						   const char *pReceivedJsonDocument, void *pContextData) {
+	IOT_UNUSED(pReceivedJsonDocument);
+	IOT_UNUSED(pContextData);
+
+	snprintf(ackThingName, sizeof(ackThingName), "%s", pThingName);
+	ackAction = action;
+	ackStatus = status;
+	ackCount++;
+}
+
+static void deliver(const char *pTopic, char *pPayload) {
+	ResetTLSBuffer();
+	msgParams.qos = QOS0;
+	msgParams.payload = pPayload;
+	msgParams.payloadLen = strlen(pPayload);
+	setTLSRxBufferWithMsgOnSubscribedTopic((char *) pTopic, strlen(pTopic), QOS0, msgParams, pPayload);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_manager_yield(&manager, 100));
+}
+
+static void addShadow(ShadowContext_t *pShadow, const char *pThingName, const char *pShadowName, bool subscribes) {
+	uint32_t subackQoSCount = 3;
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_context_init(pShadow, pThingName, pShadowName));
+	ResetTLSBuffer();
+	if(subscribes) {
+		setTLSRxBufferForMultiSuback(&subackQoSCount, 1, QOS0);
+	}
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_manager_add(&manager, pShadow));
+}
+
+static void setupTempKey(jsonStruct_t *pStruct, int32_t *pData) {
+	*pData = 0;
+	pStruct->cb = NULL;
+	pStruct->pKey = "temp";
+	pStruct->type = SHADOW_JSON_INT32;
+	pStruct->pData = pData;
+	pStruct->dataLength = sizeof(int32_t);
+}
+
+TEST_GROUP_C_SETUP(ShadowManagerTest) {
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	initParams.mqttCommandTimeout_ms = 2000;
+	rc = aws_iot_mqtt_init(&client, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&client, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	rc = aws_iot_shadow_manager_init(&manager, &client);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	setupTempKey(&tempA, &tempDataA);
+	setupTempKey(&tempB, &tempDataB);
+	ackThingName[0] = '\0';
+	ackCount = 0;
+	ResetTLSBuffer();
+}
+
+TEST_GROUP_C_TEARDOWN(ShadowManagerTest) {
+
+}
+
+TEST_C(ShadowManagerTest, ContextInitNameChecks) {
+	char longName[MAX_SIZE_OF_SHADOW_NAME + 1];
+
+	IOT_DEBUG("\n-->Running Shadow Manager Tests - Context init name checks \n");
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_shadow_context_init(&shadowA, NULL, NULL));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_shadow_context_init(&shadowA, "", NULL));
+
+	memset(longName, 'x', sizeof(longName) - 1);
+	longName[sizeof(longName) - 1] = '\0';
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_shadow_context_init(&shadowA, THING_A, longName));
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_context_init(&shadowA, THING_A, NULL));
+	CHECK_EQUAL_C_STRING(THING_A, shadowA.thingName);
+	CHECK_EQUAL_C_STRING("", shadowA.shadowName);
+	CHECK_EQUAL_C_INT(true, shadowA.discardOldDelta);
+}
+
+TEST_C(ShadowManagerTest, AddSubscribesOncePerKind) {
+	ShadowContext_t duplicate;
+
+	IOT_DEBUG("\n-->Running Shadow Manager Tests - Topic filters subscribed once per kind of shadow \n");
+
+	addShadow(&shadowA, THING_A, NULL, true);
+	CHECK_EQUAL_C_INT(true, manager.classicSubscribed);
+	CHECK_EQUAL_C_INT(false, manager.namedSubscribed);
+
+	/* No SUBACK staged, a second subscribe would fail */
+	addShadow(&shadowB, THING_B, NULL, false);
+	CHECK_EQUAL_C_INT(2, manager.shadowCount);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_context_init(&duplicate, THING_A, NULL));
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_shadow_manager_add(&manager, &duplicate));
+	CHECK_EQUAL_C_INT(2, manager.shadowCount);
+}
+
+TEST_C(ShadowManagerTest, DeltaRoutedToItsThing) {
+	char deltaB[] = "{\"state\":{\"temp\":23},\"version\":1}";
+	char deltaOther[] = "{\"state\":{\"temp\":99},\"version\":2}";
+
+	IOT_DEBUG("\n-->Running Shadow Manager Tests - Delta routed to the shadow of its thing \n");
+
+	addShadow(&shadowA, THING_A, NULL, true);
+	addShadow(&shadowB, THING_B, NULL, false);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_context_register_delta(&shadowA, &tempA));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_context_register_delta(&shadowB, &tempB));
+
+	deliver("$aws/things/" THING_B "/shadow/update/delta", deltaB);
+	CHECK_EQUAL_C_INT(0, tempDataA);
+	CHECK_EQUAL_C_INT(23, tempDataB);
+
+	deliver("$aws/things/ThingC/shadow/update/delta", deltaOther);
+	CHECK_EQUAL_C_INT(0, tempDataA);
+	CHECK_EQUAL_C_INT(23, tempDataB);
+}
+
+TEST_C(ShadowManagerTest, DeltaVersionPerShadow) {
+	char deltaA5[] = "{\"state\":{\"temp\":5},\"version\":5}";
+	char deltaB3[] = "{\"state\":{\"temp\":3},\"version\":3}";
+	char deltaA4[] = "{\"state\":{\"temp\":4},\"version\":4}";
+
+	IOT_DEBUG("\n-->Running Shadow Manager Tests - Old deltas discarded per shadow \n");
+
+	addShadow(&shadowA, THING_A, NULL, true);
+	addShadow(&shadowB, THING_B, NULL, false);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_context_register_delta(&shadowA, &tempA));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_context_register_delta(&shadowB, &tempB));
+
+	deliver("$aws/things/" THING_A "/shadow/update/delta", deltaA5);
+	deliver("$aws/things/" THING_B "/shadow/update/delta", deltaB3);
+	CHECK_EQUAL_C_INT(5, tempDataA);
+	CHECK_EQUAL_C_INT(3, tempDataB);
+
+	deliver("$aws/things/" THING_A "/shadow/update/delta", deltaA4);
+	CHECK_EQUAL_C_INT(5, tempDataA);
+	CHECK_EQUAL_C_INT(5, (int) shadowA.version);
+	CHECK_EQUAL_C_INT(3, (int) shadowB.version);
+}
+
+TEST_C(ShadowManagerTest, NamedShadowUpdateAccepted) {
+	char updateDocument[] = "{\"state\":{\"reported\":{\"temp\":1}}, \"clientToken\":\"mgr-7\"}";
+	char otherToken[] = "{\"clientToken\":\"mgr-8\"}";
+	char thisToken[] = "{\"state\":{\"reported\":{\"temp\":1}},\"clientToken\":\"mgr-7\",\"version\":2}";
+
+	IOT_DEBUG("\n-->Running Shadow Manager Tests - Named shadow update accepted \n");
+
+	addShadow(&shadowA, THING_A, "lamp", true);
+	CHECK_EQUAL_C_INT(true, manager.namedSubscribed);
+	CHECK_EQUAL_C_INT(false, manager.classicSubscribed);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_manager_update(&manager, &shadowA, updateDocument, actionCallback,
+															 NULL, 4));
+	CHECK_EQUAL_C_INT(strlen("$aws/things/" THING_A "/shadow/name/lamp/update"), lastPublishMessageTopicLen);
+	CHECK_EQUAL_C_INT(0, strncmp("$aws/things/" THING_A "/shadow/name/lamp/update", LastPublishMessageTopic,
+								 lastPublishMessageTopicLen));
+
+	deliver("$aws/things/" THING_A "/shadow/name/lamp/update/rejected", otherToken);
+	CHECK_EQUAL_C_INT(0, ackCount);
+
+	deliver("$aws/things/" THING_A "/shadow/name/lamp/update/accepted", thisToken);
+	CHECK_EQUAL_C_INT(1, ackCount);
+	CHECK_EQUAL_C_STRING(THING_A, ackThingName);
+	CHECK_EQUAL_C_INT(SHADOW_UPDATE, ackAction);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_ACCEPTED, ackStatus);
+
+	/* Answered once only */
+	deliver("$aws/things/" THING_A "/shadow/name/lamp/update/accepted", thisToken);
+	CHECK_EQUAL_C_INT(1, ackCount);
+}
+
+TEST_C(ShadowManagerTest, GetTimeout) {
+	IOT_DEBUG("\n-->Running Shadow Manager Tests - Get timeout \n");
+
+	addShadow(&shadowB, THING_B, NULL, true);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_manager_get(&manager, &shadowB, actionCallback, NULL, 0));
+	CHECK_EQUAL_C_INT(strlen("$aws/things/" THING_B "/shadow/get"), lastPublishMessageTopicLen);
+	CHECK_EQUAL_C_INT(0, strncmp("$aws/things/" THING_B "/shadow/get", LastPublishMessageTopic,
+								 lastPublishMessageTopicLen));
+
+	ResetTLSBuffer();
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_manager_yield(&manager, 100));
+	CHECK_EQUAL_C_INT(1, ackCount);
+	CHECK_EQUAL_C_STRING(THING_B, ackThingName);
+	CHECK_EQUAL_C_INT(SHADOW_GET, ackAction);
+	CHECK_EQUAL_C_INT(SHADOW_ACK_TIMEOUT, ackStatus);
+}
+
+TEST_C(ShadowManagerTest, RemoveStopsRouting) {
+	char delta[] = "{\"state\":{\"temp\":23},\"version\":1}";
+
+	IOT_DEBUG("\n-->Running Shadow Manager Tests - Removed shadow no longer updated \n");
+
+	addShadow(&shadowA, THING_A, NULL, true);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_context_register_delta(&shadowA, &tempA));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_manager_get(&manager, &shadowA, actionCallback, NULL, 0));
+
+	/* The last shadow takes the topic filters with it */
+	setTLSRxBufferForMultiUnsuback(3);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_manager_remove(&manager, &shadowA));
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_shadow_manager_remove(&manager, &shadowA));
+	CHECK_EQUAL_C_INT(0, manager.shadowCount);
+
+	/* The pending get was dropped with the shadow */
+	deliver("$aws/things/" THING_A "/shadow/update/delta", delta);
+	CHECK_EQUAL_C_INT(0, tempDataA);
+	CHECK_EQUAL_C_INT(0, ackCount);
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_shadow_manager_update(&manager, &shadowA, delta, NULL, NULL, 4));
+}
+
+TEST_C(ShadowManagerTest, RemoveLastShadowUnsubscribes) {
+	uint32_t subackQoSCount = 3;
+
+	IOT_DEBUG("\n-->Running Shadow Manager Tests - Topic filters unsubscribed with the last shadow \n");
+
+	addShadow(&shadowA, THING_A, NULL, true);
+	addShadow(&shadowB, THING_B, NULL, false);
+
+	/* No UNSUBACK staged, an unsubscribe would fail */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_manager_remove(&manager, &shadowA));
+	CHECK_EQUAL_C_INT(true, manager.classicSubscribed);
+
+	setTLSRxBufferForMultiUnsuback(3);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_manager_remove(&manager, &shadowB));
+	CHECK_EQUAL_C_INT(false, manager.classicSubscribed);
+	CHECK_EQUAL_C_INT(0xA2, TxBuffer.pBuffer[0]);
+	CHECK_C(NULL == client.clientData.messageHandlers[0].topicName);
+	CHECK_C(NULL == client.clientData.messageHandlers[2].topicName);
+
+	/* The next shadow subscribes again */
+	ResetTLSBuffer();
+	setTLSRxBufferForMultiSuback(&subackQoSCount, 1, QOS0);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_manager_add(&manager, &shadowA));
+	CHECK_EQUAL_C_INT(true, manager.classicSubscribed);
+	CHECK_EQUAL_C_STRING("$aws/things/+/shadow/update/delta", LastSubscribeMessage);
+}
+
+TEST_C(ShadowManagerTest, OwnTokensAndClientTokens) {
+	char document[] = "{\"state\":{\"reported\":{\"temp\":7}}}";
+	char delta[] = "{\"state\":{\"temp\":23},\"version\":1}";
+	char updateDocument[64];
+	char requestBuf[MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE];
+	ShadowJsonView_t view;
+	int32_t tokenCount, number;
+	size_t payloadLen;
+
+	IOT_DEBUG("\n-->Running Shadow Manager Tests - Own JSON tokens and client token sequence \n");
+
+	addShadow(&shadowA, THING_A, NULL, true);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_context_register_delta(&shadowA, &tempA));
+
+	/* A delta parsed by the manager leaves the tokens of the Thing Shadow client alone */
+	CHECK_C(isJsonValidAndParse(document, strlen(document), NULL, &tokenCount));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_init(document, &view));
+	deliver("$aws/things/" THING_A "/shadow/update/delta", delta);
+	CHECK_EQUAL_C_INT(23, tempDataA);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_int32(&view, "state.reported.temp", &number));
+	CHECK_EQUAL_C_INT(7, number);
+
+	/* Client tokens of the manager count from 0, whatever the Thing Shadow client sent */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_internal_get_request_json(requestBuf, sizeof(requestBuf)));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_internal_get_request_json(requestBuf, sizeof(requestBuf)));
+	ResetTLSBuffer();
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_manager_get(&manager, &shadowA, NULL, NULL, 4));
+	payloadLen = strlen(LastPublishMessagePayload);
+	CHECK_C(payloadLen > 4);
+	CHECK_EQUAL_C_STRING("-0\"}", LastPublishMessagePayload + payloadLen - 4);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_init_json_document(updateDocument, sizeof(updateDocument)));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_manager_finalize_json_document(&manager, updateDocument,
+																			 sizeof(updateDocument)));
+	payloadLen = strlen(updateDocument);
+	CHECK_EQUAL_C_STRING("-1\"}", updateDocument + payloadLen - 4);
+}
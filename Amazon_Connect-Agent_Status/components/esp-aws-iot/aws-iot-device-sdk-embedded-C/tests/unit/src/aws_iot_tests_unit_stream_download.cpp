@@ -0,0 +1,36 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_stream_download.cpp
+ * @brief IoT Client Unit Testing - Stream Download Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(StreamDownloadTest){
+	TEST_GROUP_C_SETUP_WRAPPER(StreamDownloadTest)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(StreamDownloadTest)
+};
+
+TEST_GROUP_C_WRAPPER(StreamDownloadTest, InitChecks)
+TEST_GROUP_C_WRAPPER(StreamDownloadTest, WindowOfRequestsInFlight)
+TEST_GROUP_C_WRAPPER(StreamDownloadTest, OutOfOrderBlocksComplete)
+TEST_GROUP_C_WRAPPER(StreamDownloadTest, InvalidBlocksIgnored)
+TEST_GROUP_C_WRAPPER(StreamDownloadTest, LateRequestAsksForMissingBlocks)
+TEST_GROUP_C_WRAPPER(StreamDownloadTest, ResumeFromBitmap)
+TEST_GROUP_C_WRAPPER(StreamDownloadTest, RejectedRequestFailsDownload)
+TEST_GROUP_C_WRAPPER(StreamDownloadTest, WriteErrorFailsDownload)
@@ -77,3 +77,14 @@ TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeTopicHashkeyMustBeTheLastFail)
 TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeTopicWithPluskeySuccess)
 /* C:22 - Subscribe with '+' as last character in topic name, Success */
 TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeTopicPluskeyComesLastSuccess)
+
+/* C:23 - Batch subscribe with Null/empty parameters */
+TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeBatchNullParams)
+/* C:24 - Batch subscribe, one suback for all topics, messages on each topic */
+TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeBatchSingleSubackSuccess)
+/* C:25 - Batch subscribe, topics split over several packets by the TX buffer size */
+TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeBatchSplitByTxBufferSuccess)
+/* C:26 - Batch subscribe, not enough free subscriptions */
+TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeBatchMaxSubscriptionsReached)
+/* C:27 - Batch subscribe, one topic filter refused by the server */
+TEST_GROUP_C_WRAPPER(SubscribeTests, subscribeBatchTopicRejected)
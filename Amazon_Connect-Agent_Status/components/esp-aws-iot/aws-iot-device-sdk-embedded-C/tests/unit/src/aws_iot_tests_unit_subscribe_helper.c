@@ -23,6 +23,7 @@
 #include <CppUTest/TestHarness_c.h>
 
 #include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
 #include "aws_iot_log.h"
 
 static IoT_Client_Init_Params initParams;
@@ -604,3 +605,159 @@ TEST_C(SubscribeTests, subscribeTopicPluskeyComesLastSuccess) {
 
 	IOT_DEBUG("-->Success - C:22 - Subscribe with '+' as last character in topic name, Success \n");
 }
+
+/* C:23 - Batch subscribe with Null/empty parameters */
+TEST_C(SubscribeTests, subscribeBatchNullParams) {
+	IoT_Error_t rc;
+	IoT_Subscribe_Topic_Params topicList[1] = {{"sdk/Test1", 9, QOS1, iot_subscribe_callback_handler1, NULL}};
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:23 - Batch subscribe with Null/empty parameters \n");
+
+	rc = aws_iot_mqtt_subscribe_batch(NULL, topicList, 1);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+	rc = aws_iot_mqtt_subscribe_batch(&iotClient, NULL, 1);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+	rc = aws_iot_mqtt_subscribe_batch(&iotClient, topicList, 0);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+	topicList[0].topicNameLen = 0;
+	rc = aws_iot_mqtt_subscribe_batch(&iotClient, topicList, 1);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+	topicList[0].topicNameLen = 9;
+	topicList[0].pApplicationHandler = NULL;
+	rc = aws_iot_mqtt_subscribe_batch(&iotClient, topicList, 1);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	IOT_DEBUG("-->Success - C:23 - Batch subscribe with Null/empty parameters \n");
+}
+
+/* C:24 - Batch subscribe, one suback for all topics, messages on each topic */
+TEST_C(SubscribeTests, subscribeBatchSingleSubackSuccess) {
+	IoT_Error_t rc;
+	uint32_t subackQoSCount = 3;
+	char expectedCallbackString[] = "batch sdk/Test1";
+	char expectedCallbackString3[] = "batch sdk/Test3";
+	IoT_Subscribe_Topic_Params topicList[3] = {
+		{"sdk/Test1", 9, QOS1, iot_subscribe_callback_handler1, NULL},
+		{"sdk/Test2", 9, QOS1, iot_subscribe_callback_handler2, NULL},
+		{"sdk/Test3", 9, QOS0, iot_subscribe_callback_handler3, NULL}
+	};
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:24 - Batch subscribe, one suback for all topics \n");
+
+	setTLSRxBufferForMultiSuback(&subackQoSCount, 1, QOS1);
+	rc = aws_iot_mqtt_subscribe_batch(&iotClient, topicList, 3);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING("sdk/Test1", LastSubscribeMessage);
+	CHECK_EQUAL_C_INT(QOS0, iotClient.clientData.messageHandlers[2].qos);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
+
+	setTLSRxBufferWithMsgOnSubscribedTopic("sdk/Test1", 9, QOS1, testPubMsgParams, expectedCallbackString);
+	rc = aws_iot_mqtt_yield(&iotClient, 1000);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING(expectedCallbackString, CallbackMsgString1);
+
+	setTLSRxBufferWithMsgOnSubscribedTopic("sdk/Test3", 9, QOS1, testPubMsgParams, expectedCallbackString3);
+	rc = aws_iot_mqtt_yield(&iotClient, 1000);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING(expectedCallbackString3, CallbackMsgString3);
+
+	IOT_DEBUG("-->Success - C:24 - Batch subscribe, one suback for all topics \n");
+}
+
+/* C:25 - Batch subscribe, topics split over several packets by the TX buffer size */
+TEST_C(SubscribeTests, subscribeBatchSplitByTxBufferSuccess) {
+	IoT_Error_t rc;
+	uint32_t subackQoSCount[2] = {2, 1};
+	IoT_Subscribe_Topic_Params topicList[3] = {
+		{"sdk/Test1", 9, QOS1, iot_subscribe_callback_handler1, NULL},
+		{"sdk/Test2", 9, QOS1, iot_subscribe_callback_handler2, NULL},
+		{"sdk/Test3", 9, QOS1, iot_subscribe_callback_handler3, NULL}
+	};
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:25 - Batch subscribe, topics split over several packets \n");
+
+	/* Two 9 byte topic filters make a 28 byte SUBSCRIBE packet, three make 40 bytes */
+	iotClient.clientData.writeBufSize = 30;
+
+	setTLSRxBufferForMultiSuback(subackQoSCount, 2, QOS1);
+	rc = aws_iot_mqtt_subscribe_batch(&iotClient, topicList, 3);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING("sdk/Test1", SecondLastSubscribeMessage);
+	CHECK_EQUAL_C_STRING("sdk/Test3", LastSubscribeMessage);
+	CHECK_EQUAL_C_STRING("sdk/Test3", iotClient.clientData.messageHandlers[2].topicName);
+
+	/* A single topic filter that does not fit is rejected without being sent */
+	iotClient.clientData.writeBufSize = 10;
+	topicList[0].pTopicName = "sdk/Test4";
+	rc = aws_iot_mqtt_subscribe_batch(&iotClient, topicList, 1);
+	CHECK_EQUAL_C_INT(MQTT_TX_BUFFER_TOO_SHORT_ERROR, rc);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
+
+	IOT_DEBUG("-->Success - C:25 - Batch subscribe, topics split over several packets \n");
+}
+
+/* C:26 - Batch subscribe, not enough free subscriptions */
+TEST_C(SubscribeTests, subscribeBatchMaxSubscriptionsReached) {
+	IoT_Error_t rc;
+	uint32_t subackQoSCount = 4;
+	IoT_Subscribe_Topic_Params topicList[4] = {
+		{"sdk/Test1", 9, QOS1, iot_subscribe_callback_handler1, NULL},
+		{"sdk/Test2", 9, QOS1, iot_subscribe_callback_handler2, NULL},
+		{"sdk/Test3", 9, QOS1, iot_subscribe_callback_handler3, NULL},
+		{"sdk/Test4", 9, QOS1, iot_subscribe_callback_handler4, NULL}
+	};
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:26 - Batch subscribe, not enough free subscriptions \n");
+
+	setTLSRxBufferForMultiSuback(&subackQoSCount, 1, QOS1);
+	rc = aws_iot_mqtt_subscribe_batch(&iotClient, topicList, 4);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	topicList[0].pTopicName = "sdk/Test5";
+	topicList[1].pTopicName = "sdk/Test6";
+	subackQoSCount = 2;
+	setTLSRxBufferForMultiSuback(&subackQoSCount, 1, QOS1);
+	rc = aws_iot_mqtt_subscribe_batch(&iotClient, topicList, 2);
+	CHECK_EQUAL_C_INT(MQTT_MAX_SUBSCRIPTIONS_REACHED_ERROR, rc);
+	CHECK_EQUAL_C_STRING("sdk/Test1", LastSubscribeMessage);
+
+	IOT_DEBUG("-->Success - C:26 - Batch subscribe, not enough free subscriptions \n");
+}
+
+/* C:27 - Batch subscribe, one topic filter refused by the server */
+TEST_C(SubscribeTests, subscribeBatchTopicRejected) {
+	IoT_Error_t rc;
+	uint32_t subackQoSCount = 3;
+	char expectedCallbackString[] = "batch sdk/Test3";
+	IoT_Subscribe_Topic_Params topicList[3] = {
+		{"sdk/Test1", 9, QOS1, iot_subscribe_callback_handler1, NULL},
+		{"sdk/Test2", 9, QOS1, iot_subscribe_callback_handler2, NULL},
+		{"sdk/Test3", 9, QOS1, iot_subscribe_callback_handler3, NULL}
+	};
+
+	IOT_DEBUG("-->Running Subscribe Tests - C:27 - Batch subscribe, one topic filter refused \n");
+
+	/* Return code 0x80 for the second filter */
+	setTLSRxBufferForMultiSuback(&subackQoSCount, 1, QOS1);
+	RxBuffer.pBuffer[5] = (unsigned char) 0x80;
+	rc = aws_iot_mqtt_subscribe_batch(&iotClient, topicList, 3);
+	CHECK_EQUAL_C_INT(MQTT_SUBSCRIBE_REJECTED_ERROR, rc);
+	CHECK_EQUAL_C_INT(0, topicList[0].isRejected);
+	CHECK_EQUAL_C_INT(1, topicList[1].isRejected);
+	CHECK_EQUAL_C_INT(0, topicList[2].isRejected);
+	CHECK_EQUAL_C_STRING("sdk/Test1", iotClient.clientData.messageHandlers[0].topicName);
+	CHECK_EQUAL_C_STRING("sdk/Test3", iotClient.clientData.messageHandlers[1].topicName);
+	CHECK_C(NULL == iotClient.clientData.messageHandlers[2].topicName);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
+
+	/* The refused filter has no handler to unsubscribe */
+	rc = aws_iot_mqtt_unsubscribe(&iotClient, "sdk/Test2", 9);
+	CHECK_EQUAL_C_INT(FAILURE, rc);
+
+	setTLSRxBufferWithMsgOnSubscribedTopic("sdk/Test3", 9, QOS1, testPubMsgParams, expectedCallbackString);
+	rc = aws_iot_mqtt_yield(&iotClient, 1000);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING(expectedCallbackString, CallbackMsgString3);
+
+	IOT_DEBUG("-->Success - C:27 - Batch subscribe, one topic filter refused \n");
+}
@@ -491,3 +491,88 @@ TEST_C(YieldTests, delayedPingResponse)
 
 	IOT_DEBUG("-->Success - G:13 - Delayed Ping response. \n");
 }
+
+/* G:14 - Yield wakeup, network stack without wakeup support */
+TEST_C(YieldTests, yieldWakeupNotSupported) {
+	IoT_Error_t rc = aws_iot_mqtt_yield_wakeup(NULL);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	rc = aws_iot_mqtt_yield_wakeup(&iotClient);
+	CHECK_EQUAL_C_INT(FAILURE, rc);
+}
+
+/* G:15 - Event-driven yield, message received on subscribed topic */
+TEST_C(YieldTests, eventDrivenYieldReceivesMessage) {
+	IoT_Error_t rc = SUCCESS;
+	char expectedCallbackString[] = "0xA5A5A5";
+
+	IOT_DEBUG("-->Running Yield Tests - G:15 - Event-driven yield, message received on subscribed topic \n");
+
+	iotClient.networkStack.waitForReadable = iot_tls_wait_for_readable;
+	iotClient.networkStack.wakeup = iot_tls_wakeup;
+	testPubMsgParams.qos = QOS1;
+
+	setTLSRxBufferForSuback(subTopic, subTopicLen, QOS1, testPubMsgParams);
+	rc = aws_iot_mqtt_subscribe(&iotClient, subTopic, subTopicLen, QOS1,
+								iot_tests_unit_acr_subscribe_callback_handler, NULL);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	setTLSRxBufferWithMsgOnSubscribedTopic(subTopic, subTopicLen, QOS1, testPubMsgParams, expectedCallbackString);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_STRING(expectedCallbackString, CallbackMsgString);
+	CHECK_EQUAL_C_INT(1, isLastTLSTxMessagePuback());
+
+	IOT_DEBUG("-->Success - G:15 - Event-driven yield, message received on subscribed topic \n");
+}
+
+/* G:16 - Event-driven yield, application wakeup returns before the timeout */
+TEST_C(YieldTests, eventDrivenYieldWakeup) {
+	IoT_Error_t rc = FAILURE;
+	struct timeval start, end, elapsed;
+
+	IOT_DEBUG("-->Running Yield Tests - G:16 - Event-driven yield, application wakeup returns before the timeout \n");
+
+	iotClient.networkStack.waitForReadable = iot_tls_wait_for_readable;
+	iotClient.networkStack.wakeup = iot_tls_wakeup;
+	ResetTLSBuffer();
+
+	rc = aws_iot_mqtt_yield_wakeup(&iotClient);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	gettimeofday(&start, NULL);
+	rc = aws_iot_mqtt_yield(&iotClient, 3000);
+	gettimeofday(&end, NULL);
+	timersub(&end, &start, &elapsed);
+
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
+	CHECK_C(elapsed.tv_sec < 1);
+
+	IOT_DEBUG("-->Success - G:16 - Event-driven yield, application wakeup returns before the timeout \n");
+}
+
+/* G:17 - Event-driven yield, ping request sent at keep-alive deadline */
+TEST_C(YieldTests, eventDrivenYieldPingRequest) {
+	IoT_Error_t rc = FAILURE;
+
+	IOT_DEBUG("-->Running Yield Tests - G:17 - Event-driven yield, ping request sent at keep-alive deadline \n");
+
+	iotClient.networkStack.waitForReadable = iot_tls_wait_for_readable;
+	iotClient.networkStack.wakeup = iot_tls_wakeup;
+	ResetTLSBuffer();
+
+	/* Sleep for keep alive interval to allow the first ping to be sent out */
+	sleep(iotClient.clientData.keepAliveInterval);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(true, isLastTLSTxMessagePingreq());
+
+	ResetTLSBuffer();
+	setTLSRxBufferForPingresp();
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(false, iotClient.clientStatus.isPingOutstanding);
+
+	IOT_DEBUG("-->Success - G:17 - Event-driven yield, ping request sent at keep-alive deadline \n");
+}
@@ -30,6 +30,9 @@ IoT_Error_t iot_tls_init(Network *pNetwork, char *pRootCALocation, char *pDevice
 	pNetwork->disconnect = iot_tls_disconnect;
 	pNetwork->isConnected = iot_tls_is_connected;
 	pNetwork->destroy = iot_tls_destroy;
+	/* Tests opt in to the event-driven yield path by setting these after init */
+	pNetwork->waitForReadable = NULL;
+	pNetwork->wakeup = NULL;
 
 	return SUCCESS;
 }
@@ -212,6 +215,33 @@ IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Tim
 	return status;
 }
 
+IoT_Error_t iot_tls_wait_for_readable(Network *pNetwork, uint32_t timeout_ms) {
+	IOT_UNUSED(pNetwork);
+	IOT_UNUSED(timeout_ms);
+
+	/* Let the read report the mocked error */
+	if(RxBuffer.mockedError != SUCCESS) {
+		return SUCCESS;
+	}
+
+	if(mockWakeupPending) {
+		mockWakeupPending = false;
+		return NETWORK_WAKEUP_REQUESTED;
+	}
+
+	if(RxBuffer.len <= RxIndex || !isTimerExpired(RxBuffer.expiry_time)) {
+		return NETWORK_SSL_NOTHING_TO_READ;
+	}
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_wakeup(Network *pNetwork) {
+	IOT_UNUSED(pNetwork);
+	mockWakeupPending = true;
+	return SUCCESS;
+}
+
 IoT_Error_t iot_tls_disconnect(Network *pNetwork) {
 	IOT_UNUSED(pNetwork);
 	return SUCCESS;
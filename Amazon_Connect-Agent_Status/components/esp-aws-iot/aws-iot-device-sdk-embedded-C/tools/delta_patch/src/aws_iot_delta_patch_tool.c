@@ -0,0 +1,181 @@
+/*
+* Copyright 2015-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_delta_patch_tool.c
+ * @brief Creates a delta patch between two application images and checks it by applying it
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aws_iot_delta_patch.h"
+#include "aws_iot_delta_patch_encoder.h"
+#include "crypto/hashes/sha2_routines.h"
+
+#define TOOL_DEFAULT_WINDOW_BITS 12 ///< The default DELTA_PATCH_MAX_WINDOW_BITS of the devices
+
+typedef struct {
+	const uint8_t *pSource;
+	uint8_t *pTarget;
+	size_t targetSize;
+} ToolImages_t;
+
+static uint8_t *readFile(const char *pPath, size_t *pSize) {
+	FILE *pFile = fopen(pPath, "rb");
+	uint8_t *pData = NULL;
+	long size;
+
+	if(NULL == pFile) {
+		fprintf(stderr, "Cannot open %s\n", pPath);
+		return NULL;
+	}
+	if(0 == fseek(pFile, 0, SEEK_END) && (size = ftell(pFile)) > 0 && 0 == fseek(pFile, 0, SEEK_SET)) {
+		pData = malloc((size_t) size);
+		if(NULL != pData && 1 != fread(pData, (size_t) size, 1, pFile)) {
+			free(pData);
+			pData = NULL;
+		}
+		*pSize = (size_t) size;
+	}
+	fclose(pFile);
+
+	if(NULL == pData) {
+		fprintf(stderr, "Cannot read %s, or it is empty\n", pPath);
+	}
+	return pData;
+}
+
+static IoT_Error_t readSource(void *pContext, uint32_t offset, uint8_t *pBuffer, size_t length) {
+	ToolImages_t *pImages = (ToolImages_t *) pContext;
+
+	memcpy(pBuffer, pImages->pSource + offset, length);
+	return SUCCESS;
+}
+
+static IoT_Error_t writeTarget(void *pContext, uint32_t offset, const uint8_t *pData, size_t length) {
+	ToolImages_t *pImages = (ToolImages_t *) pContext;
+
+	memcpy(pImages->pTarget + offset, pData, length);
+	return SUCCESS;
+}
+
+/* Applies the patch the way the device does, in 1 KB chunks, and compares the result with the target */
+static int checkPatch(const uint8_t *pSource, size_t sourceSize, const uint8_t *pTarget, size_t targetSize,
+					  const uint8_t *pPatch, size_t patchSize) {
+	static DeltaPatch_t patch;
+	DeltaPatchParams_t params;
+	ToolImages_t images;
+	IoT_Error_t rc = SUCCESS;
+	size_t offset;
+	size_t length;
+	int isSame;
+
+	images.pSource = pSource;
+	images.pTarget = calloc(1, targetSize);
+	images.targetSize = targetSize;
+	if(NULL == images.pTarget) {
+		return -1;
+	}
+
+	params.readSource = readSource;
+	params.writeTarget = writeTarget;
+	params.pContext = &images;
+	params.maxSourceSize = (uint32_t) sourceSize;
+	params.maxTargetSize = (uint32_t) targetSize;
+	aws_iot_delta_patch_init(&patch, &params);
+	for(offset = 0; offset < patchSize && SUCCESS == rc; offset += length) {
+		length = patchSize - offset < 1024 ? patchSize - offset : 1024;
+		rc = aws_iot_delta_patch_feed(&patch, pPatch + offset, length);
+	}
+	if(SUCCESS == rc) {
+		rc = aws_iot_delta_patch_finish(&patch);
+	}
+
+	isSame = SUCCESS == rc && 0 == memcmp(images.pTarget, pTarget, targetSize);
+	free(images.pTarget);
+	if(!isSame) {
+		fprintf(stderr, "The patch does not rebuild the target: %d\n", rc);
+		return -1;
+	}
+	return 0;
+}
+
+static void printUsage(const char *pName) {
+	fprintf(stderr, "Usage: %s [-w window_bits] <source.bin> <target.bin> <patch.bin>\n", pName);
+	fprintf(stderr, "  -w  log2 of the compression window, %d to %d, default %d\n", DELTA_PATCH_MIN_WINDOW_BITS,
+			DELTA_PATCH_MAX_WINDOW_BITS, TOOL_DEFAULT_WINDOW_BITS);
+	fprintf(stderr, "  Devices reject patches whose window is larger than their DELTA_PATCH_MAX_WINDOW_BITS\n");
+}
+
+int main(int argc, char **argv) {
+	uint8_t sourceHash[SHA256_DIGEST_SIZE];
+	uint8_t windowBits = TOOL_DEFAULT_WINDOW_BITS;
+	uint8_t *pSource;
+	uint8_t *pTarget;
+	uint8_t *pPatch = NULL;
+	size_t sourceSize = 0;
+	size_t targetSize = 0;
+	size_t patchSize = 0;
+	FILE *pFile;
+	int argument = 1;
+	int rc = 1;
+
+	if(argc == 6 && 0 == strcmp("-w", argv[1])) {
+		windowBits = (uint8_t) atoi(argv[2]);
+		argument = 3;
+	}
+	if(argc - argument != 3 || windowBits < DELTA_PATCH_MIN_WINDOW_BITS || windowBits > DELTA_PATCH_MAX_WINDOW_BITS) {
+		printUsage(argv[0]);
+		return 1;
+	}
+
+	pSource = readFile(argv[argument], &sourceSize);
+	pTarget = readFile(argv[argument + 1], &targetSize);
+	if(NULL == pSource || NULL == pTarget) {
+		goto exit;
+	}
+
+	sw_sha256(pSource, (unsigned int) sourceSize, sourceHash);
+	if(0 != aws_iot_delta_patch_encode(pSource, sourceSize, pTarget, targetSize, windowBits, sourceHash, &pPatch,
+									   &patchSize)) {
+		fprintf(stderr, "Cannot create the patch\n");
+		goto exit;
+	}
+	if(0 != checkPatch(pSource, sourceSize, pTarget, targetSize, pPatch, patchSize)) {
+		goto exit;
+	}
+
+	pFile = fopen(argv[argument + 2], "wb");
+	if(NULL == pFile || 1 != fwrite(pPatch, patchSize, 1, pFile)) {
+		fprintf(stderr, "Cannot write %s\n", argv[argument + 2]);
+		if(NULL != pFile) {
+			fclose(pFile);
+		}
+		goto exit;
+	}
+	fclose(pFile);
+
+	printf("source %zu bytes, target %zu bytes, patch %zu bytes (%.1f%% of the target), window %u bytes\n",
+		   sourceSize, targetSize, patchSize, 100.0 * (double) patchSize / (double) targetSize, 1u << windowBits);
+	rc = 0;
+
+exit:
+	free(pSource);
+	free(pTarget);
+	free(pPatch);
+	return rc;
+}
@@ -0,0 +1,134 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * Additions Copyright 2016 Espressif Systems (Shanghai) PTE LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_jobs_worker.c
+ * @brief Worker tasks running the long steps of a jobs executor
+ *
+ * The tasks share one FreeRTOS queue of step pointers. A job never has more steps in flight
+ * than JOBS_EXECUTOR_MAX_STEPS, so a queue of that length only fills up when several
+ * executors share the worker, in which case the executor retries on its next yield.
+ */
+
+#include "esp_log.h"
+
+#include "aws_iot_jobs_worker.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static const char *TAG = "aws_iot_jobs";
+
+const AWS_IoT_Jobs_Worker_Params jobsWorkerParamsDefault = jobsWorkerParamsDefault_initializer;
+
+static void _aws_iot_jobs_worker_task(void *pvParameters) {
+	AWS_IoT_Jobs_Worker *pWorker = (AWS_IoT_Jobs_Worker *) pvParameters;
+	JobsStep_t *pStep;
+
+	for(;;) {
+		if(pdTRUE != xQueueReceive(pWorker->queue, &pStep, portMAX_DELAY)) {
+			continue;
+		}
+		if(NULL == pStep) {
+			break;
+		}
+		aws_iot_jobs_executor_run_step(pStep);
+	}
+
+	xTaskNotifyGive(pWorker->stopRequester);
+	vTaskDelete(NULL);
+}
+
+IoT_Error_t aws_iot_jobs_worker_start(AWS_IoT_Jobs_Worker *pWorker, const AWS_IoT_Jobs_Worker_Params *pParams) {
+	BaseType_t ret;
+	uint8_t i;
+
+	if(NULL == pWorker) {
+		return NULL_VALUE_ERROR;
+	}
+
+	pWorker->params = (NULL != pParams) ? *pParams : jobsWorkerParamsDefault;
+	if(0 == pWorker->params.taskCount || pWorker->params.taskCount > AWS_IOT_JOBS_WORKER_TASKS) {
+		pWorker->params.taskCount = AWS_IOT_JOBS_WORKER_TASKS;
+	}
+	pWorker->stopRequester = NULL;
+
+	pWorker->queue = xQueueCreate(JOBS_EXECUTOR_MAX_STEPS, sizeof(JobsStep_t *));
+	if(NULL == pWorker->queue) {
+		ESP_LOGE(TAG, "Failed to create jobs worker queue");
+		return FAILURE;
+	}
+
+	for(i = 0; i < pWorker->params.taskCount; i++) {
+		ret = xTaskCreatePinnedToCore(_aws_iot_jobs_worker_task, "aws_iot_jobs", pWorker->params.stackSize, pWorker,
+									  pWorker->params.priority, &(pWorker->tasks[i]), pWorker->params.coreId);
+		if(pdPASS != ret) {
+			ESP_LOGE(TAG, "Failed to create jobs worker task %u", i);
+			pWorker->params.taskCount = i;
+			aws_iot_jobs_worker_stop(pWorker);
+			return FAILURE;
+		}
+	}
+
+	return SUCCESS;
+}
+
+IoT_Error_t aws_iot_jobs_worker_stop(AWS_IoT_Jobs_Worker *pWorker) {
+	JobsStep_t *pExit = NULL;
+	uint8_t i;
+
+	if(NULL == pWorker) {
+		return NULL_VALUE_ERROR;
+	}
+
+	if(NULL == pWorker->queue) {
+		return SUCCESS;
+	}
+
+	/* Queued behind any steps still waiting, one exit marker per task */
+	pWorker->stopRequester = xTaskGetCurrentTaskHandle();
+	for(i = 0; i < pWorker->params.taskCount; i++) {
+		xQueueSend(pWorker->queue, &pExit, portMAX_DELAY);
+	}
+	for(i = 0; i < pWorker->params.taskCount; i++) {
+		ulTaskNotifyTake(pdFALSE, portMAX_DELAY);
+		pWorker->tasks[i] = NULL;
+	}
+
+	vQueueDelete(pWorker->queue);
+	pWorker->queue = NULL;
+
+	return SUCCESS;
+}
+
+IoT_Error_t aws_iot_jobs_worker_dispatch(JobsStep_t *pStep, void *pContext) {
+	AWS_IoT_Jobs_Worker *pWorker = (AWS_IoT_Jobs_Worker *) pContext;
+
+	if(NULL == pStep || NULL == pWorker || NULL == pWorker->queue) {
+		return NULL_VALUE_ERROR;
+	}
+
+	if(pdTRUE != xQueueSend(pWorker->queue, &pStep, 0)) {
+		return LIMIT_EXCEEDED_ERROR;
+	}
+
+	return SUCCESS;
+}
+
+#ifdef __cplusplus
+}
+#endif
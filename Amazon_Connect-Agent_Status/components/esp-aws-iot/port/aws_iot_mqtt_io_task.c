@@ -0,0 +1,301 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * Additions Copyright 2016 Espressif Systems (Shanghai) PTE LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_mqtt_io_task.c
+ * @brief Dedicated MQTT I/O task
+ *
+ * The request queue is a bounded ring buffer in which every slot carries a sequence
+ * number. Producers claim a position with a compare-and-swap on enqueuePos, fill the slot
+ * and publish it by advancing the slot's sequence. The single consumer reads slots in
+ * order and hands them back by advancing the sequence by one lap. No locks are taken, so
+ * submitting from a high priority task never waits for the I/O task.
+ */
+
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "aws_iot_mqtt_io_task.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+static const char *TAG = "aws_iot_io";
+
+#define MQTT_IO_QUEUE_MASK (AWS_IOT_MQTT_IO_QUEUE_LEN - 1)
+
+const AWS_IoT_MQTT_IO_Task_Params mqttIoTaskParamsDefault = mqttIoTaskParamsDefault_initializer;
+
+static void _aws_iot_mqtt_io_queue_init(AWS_IoT_MQTT_IO_Task *pIoTask) {
+	uint32_t i;
+
+	for(i = 0; i < AWS_IOT_MQTT_IO_QUEUE_LEN; i++) {
+		atomic_init(&(pIoTask->slots[i].sequence), i);
+	}
+	atomic_init(&(pIoTask->enqueuePos), 0);
+	pIoTask->dequeuePos = 0;
+}
+
+static bool _aws_iot_mqtt_io_queue_push(AWS_IoT_MQTT_IO_Task *pIoTask, const MqttIoRequest *pRequest) {
+	MqttIoQueueSlot *pSlot;
+	uint_fast32_t pos, seq;
+	int32_t diff;
+
+	pos = atomic_load_explicit(&(pIoTask->enqueuePos), memory_order_relaxed);
+	for(;;) {
+		pSlot = &(pIoTask->slots[pos & MQTT_IO_QUEUE_MASK]);
+		seq = atomic_load_explicit(&(pSlot->sequence), memory_order_acquire);
+		diff = (int32_t) ((uint32_t) seq - (uint32_t) pos);
+		if(0 == diff) {
+			/* Slot is free for this lap, try to claim the position */
+			if(atomic_compare_exchange_weak_explicit(&(pIoTask->enqueuePos), &pos, pos + 1,
+													 memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+		} else if(diff < 0) {
+			/* Consumer has not released this slot from the previous lap: queue full */
+			return false;
+		} else {
+			pos = atomic_load_explicit(&(pIoTask->enqueuePos), memory_order_relaxed);
+		}
+	}
+
+	pSlot->request = *pRequest;
+	atomic_store_explicit(&(pSlot->sequence), pos + 1, memory_order_release);
+	return true;
+}
+
+static bool _aws_iot_mqtt_io_queue_pop(AWS_IoT_MQTT_IO_Task *pIoTask, MqttIoRequest *pRequest) {
+	MqttIoQueueSlot *pSlot = &(pIoTask->slots[pIoTask->dequeuePos & MQTT_IO_QUEUE_MASK]);
+	uint_fast32_t seq = atomic_load_explicit(&(pSlot->sequence), memory_order_acquire);
+
+	if((int32_t) ((uint32_t) seq - (uint32_t) (pIoTask->dequeuePos + 1)) < 0) {
+		/* Slot not yet published by its producer */
+		return false;
+	}
+
+	*pRequest = pSlot->request;
+	atomic_store_explicit(&(pSlot->sequence), pIoTask->dequeuePos + AWS_IOT_MQTT_IO_QUEUE_LEN, memory_order_release);
+	pIoTask->dequeuePos++;
+	return true;
+}
+
+static IoT_Error_t _aws_iot_mqtt_io_submit(AWS_IoT_MQTT_IO_Task *pIoTask, const MqttIoRequest *pRequest) {
+	IoT_Error_t rc = SUCCESS;
+
+	/* Counted before isRunning is checked, so a stopping task waits for this push before its last drain */
+	atomic_fetch_add(&(pIoTask->submitters), 1);
+	if(!atomic_load(&(pIoTask->isRunning))) {
+		rc = FAILURE;
+	} else if(!_aws_iot_mqtt_io_queue_push(pIoTask, pRequest)) {
+		rc = LIMIT_EXCEEDED_ERROR;
+	} else {
+		/* Interrupt a yield blocked on the socket. If the network stack can't be woken up,
+		 * the request is picked up after at most yieldTimeoutMs. */
+		aws_iot_mqtt_yield_wakeup(pIoTask->pClient);
+	}
+	atomic_fetch_sub(&(pIoTask->submitters), 1);
+
+	return rc;
+}
+
+static IoT_Error_t _aws_iot_mqtt_io_process(AWS_IoT_Client *pClient, MqttIoRequest *pRequest) {
+	switch(pRequest->type) {
+		case MQTT_IO_REQUEST_PUBLISH:
+			return aws_iot_mqtt_publish(pClient, pRequest->pTopicName, pRequest->topicNameLen,
+										&(pRequest->publishParams));
+		case MQTT_IO_REQUEST_SUBSCRIBE:
+			return aws_iot_mqtt_subscribe(pClient, pRequest->pTopicName, pRequest->topicNameLen, pRequest->qos,
+										  pRequest->pApplicationHandler, pRequest->pApplicationHandlerData);
+		case MQTT_IO_REQUEST_UNSUBSCRIBE:
+			return aws_iot_mqtt_unsubscribe(pClient, pRequest->pTopicName, pRequest->topicNameLen);
+		default:
+			return FAILURE;
+	}
+}
+
+static void _aws_iot_mqtt_io_drain(AWS_IoT_MQTT_IO_Task *pIoTask, bool process) {
+	MqttIoRequest request;
+	IoT_Error_t rc;
+
+	while(_aws_iot_mqtt_io_queue_pop(pIoTask, &request)) {
+		rc = process ? _aws_iot_mqtt_io_process(pIoTask->pClient, &request) : FAILURE;
+		if(SUCCESS != rc) {
+			ESP_LOGD(TAG, "Request type %d on topic %.*s completed with %d", request.type,
+					 request.topicNameLen, request.pTopicName, rc);
+		}
+		if(NULL != request.pCompletionHandler) {
+			request.pCompletionHandler(pIoTask->pClient, rc, request.pCompletionHandlerData);
+		}
+	}
+}
+
+static void _aws_iot_mqtt_io_log_reconnect(AWS_IoT_Client *pClient) {
+	IoT_Connection_Metrics metrics;
+
+	if(SUCCESS != aws_iot_mqtt_get_connection_metrics(pClient, &metrics)) {
+		return;
+	}
+	ESP_LOGI(TAG, "Reconnected after %u ms, %u attempts (DNS %u, TCP %u, TLS %u, CONNACK %u, resubscribe %u ms)",
+			 metrics.lastOutageMs, metrics.lastOutageAttempts, metrics.dnsLookupMs, metrics.tcpConnectMs,
+			 metrics.tlsHandshakeMs, metrics.connackMs, metrics.resubscribeMs);
+}
+
+static void _aws_iot_mqtt_io_task(void *pvParameters) {
+	AWS_IoT_MQTT_IO_Task *pIoTask = (AWS_IoT_MQTT_IO_Task *) pvParameters;
+	IoT_Error_t rc;
+
+	while(atomic_load(&(pIoTask->isRunning))) {
+		_aws_iot_mqtt_io_drain(pIoTask, true);
+
+		rc = aws_iot_mqtt_yield(pIoTask->pClient, pIoTask->params.yieldTimeoutMs);
+		if(NETWORK_RECONNECTED == rc) {
+			_aws_iot_mqtt_io_log_reconnect(pIoTask->pClient);
+		}
+		if(NETWORK_ATTEMPTING_RECONNECT == rc || NETWORK_RECONNECTED == rc) {
+			/* Auto-reconnect runs inside yield, keep going */
+			continue;
+		}
+		if(SUCCESS != rc && MQTT_CLIENT_NOT_IDLE_ERROR != rc) {
+			/* Disconnected without auto-reconnect: yield returns immediately, don't spin */
+			ESP_LOGW(TAG, "Yield returned %d", rc);
+			vTaskDelay(pdMS_TO_TICKS(pIoTask->params.yieldTimeoutMs));
+		}
+	}
+
+	/* Fail whatever was queued after the last pass, including the pushes of submitters that saw the task running */
+	while(0 != atomic_load(&(pIoTask->submitters))) {
+		vTaskDelay(1);
+	}
+	_aws_iot_mqtt_io_drain(pIoTask, false);
+
+	xTaskNotifyGive(pIoTask->stopRequester);
+	vTaskDelete(NULL);
+}
+
+IoT_Error_t aws_iot_mqtt_io_task_start(AWS_IoT_MQTT_IO_Task *pIoTask, AWS_IoT_Client *pClient,
+									   const AWS_IoT_MQTT_IO_Task_Params *pParams) {
+	BaseType_t ret;
+
+	if(NULL == pIoTask || NULL == pClient) {
+		return NULL_VALUE_ERROR;
+	}
+
+	pIoTask->pClient = pClient;
+	pIoTask->params = (NULL != pParams) ? *pParams : mqttIoTaskParamsDefault;
+	if(0 == pIoTask->params.yieldTimeoutMs) {
+		pIoTask->params.yieldTimeoutMs = mqttIoTaskParamsDefault.yieldTimeoutMs;
+	}
+	pIoTask->stopRequester = NULL;
+	_aws_iot_mqtt_io_queue_init(pIoTask);
+	atomic_init(&(pIoTask->submitters), 0);
+	atomic_init(&(pIoTask->isRunning), true);
+
+	ret = xTaskCreatePinnedToCore(_aws_iot_mqtt_io_task, "aws_iot_io", pIoTask->params.stackSize, pIoTask,
+								  pIoTask->params.priority, &(pIoTask->taskHandle), pIoTask->params.coreId);
+	if(pdPASS != ret) {
+		ESP_LOGE(TAG, "Failed to create MQTT I/O task");
+		atomic_store(&(pIoTask->isRunning), false);
+		return FAILURE;
+	}
+
+	return SUCCESS;
+}
+
+IoT_Error_t aws_iot_mqtt_io_task_stop(AWS_IoT_MQTT_IO_Task *pIoTask) {
+	if(NULL == pIoTask) {
+		return NULL_VALUE_ERROR;
+	}
+
+	if(!atomic_load(&(pIoTask->isRunning))) {
+		return SUCCESS;
+	}
+
+	pIoTask->stopRequester = xTaskGetCurrentTaskHandle();
+	atomic_store(&(pIoTask->isRunning), false);
+	aws_iot_mqtt_yield_wakeup(pIoTask->pClient);
+
+	ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+	pIoTask->taskHandle = NULL;
+
+	return SUCCESS;
+}
+
+IoT_Error_t aws_iot_mqtt_io_publish(AWS_IoT_MQTT_IO_Task *pIoTask, const char *pTopicName, uint16_t topicNameLen,
+									IoT_Publish_Message_Params *pParams,
+									pMqttIoCompletionHandler pCompletionHandler, void *pCompletionHandlerData) {
+	MqttIoRequest request;
+
+	if(NULL == pIoTask || NULL == pTopicName || 0 == topicNameLen || NULL == pParams) {
+		return NULL_VALUE_ERROR;
+	}
+
+	memset(&request, 0, sizeof(request));
+	request.type = MQTT_IO_REQUEST_PUBLISH;
+	request.pTopicName = pTopicName;
+	request.topicNameLen = topicNameLen;
+	request.publishParams = *pParams;
+	request.pCompletionHandler = pCompletionHandler;
+	request.pCompletionHandlerData = pCompletionHandlerData;
+
+	return _aws_iot_mqtt_io_submit(pIoTask, &request);
+}
+
+IoT_Error_t aws_iot_mqtt_io_subscribe(AWS_IoT_MQTT_IO_Task *pIoTask, const char *pTopicName, uint16_t topicNameLen,
+									  QoS qos, pApplicationHandler_t pApplicationHandler, void *pApplicationHandlerData,
+									  pMqttIoCompletionHandler pCompletionHandler, void *pCompletionHandlerData) {
+	MqttIoRequest request;
+
+	if(NULL == pIoTask || NULL == pTopicName || 0 == topicNameLen || NULL == pApplicationHandler) {
+		return NULL_VALUE_ERROR;
+	}
+
+	memset(&request, 0, sizeof(request));
+	request.type = MQTT_IO_REQUEST_SUBSCRIBE;
+	request.pTopicName = pTopicName;
+	request.topicNameLen = topicNameLen;
+	request.qos = qos;
+	request.pApplicationHandler = pApplicationHandler;
+	request.pApplicationHandlerData = pApplicationHandlerData;
+	request.pCompletionHandler = pCompletionHandler;
+	request.pCompletionHandlerData = pCompletionHandlerData;
+
+	return _aws_iot_mqtt_io_submit(pIoTask, &request);
+}
+
+IoT_Error_t aws_iot_mqtt_io_unsubscribe(AWS_IoT_MQTT_IO_Task *pIoTask, const char *pTopicName, uint16_t topicNameLen,
+										pMqttIoCompletionHandler pCompletionHandler, void *pCompletionHandlerData) {
+	MqttIoRequest request;
+
+	if(NULL == pIoTask || NULL == pTopicName || 0 == topicNameLen) {
+		return NULL_VALUE_ERROR;
+	}
+
+	memset(&request, 0, sizeof(request));
+	request.type = MQTT_IO_REQUEST_UNSUBSCRIBE;
+	request.pTopicName = pTopicName;
+	request.topicNameLen = topicNameLen;
+	request.pCompletionHandler = pCompletionHandler;
+	request.pCompletionHandlerData = pCompletionHandlerData;
+
+	return _aws_iot_mqtt_io_submit(pIoTask, &request);
+}
+
+#ifdef __cplusplus
+}
+#endif
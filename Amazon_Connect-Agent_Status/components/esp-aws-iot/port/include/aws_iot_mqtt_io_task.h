@@ -0,0 +1,221 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * Additions Copyright 2016 Espressif Systems (Shanghai) PTE LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_mqtt_io_task.h
+ * @brief Dedicated MQTT I/O task
+ *
+ * In this mode a single FreeRTOS task owns the MQTT client: it is the only task that
+ * calls yield, publish, subscribe and unsubscribe on it. Other tasks submit requests
+ * through a lock-free multi-producer/single-consumer queue and are told the result
+ * through a completion callback that runs in the I/O task.
+ *
+ * Submitting a request wakes up the I/O task (see aws_iot_mqtt_yield_wakeup), so requests
+ * are sent right away even while the I/O task is blocked in yield.
+ */
+
+#ifndef AWS_IOT_MQTT_IO_TASK_H_
+#define AWS_IOT_MQTT_IO_TASK_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "aws_iot_config.h"
+#include "aws_iot_mqtt_client_interface.h"
+
+#ifndef AWS_IOT_MQTT_IO_QUEUE_LEN
+#define AWS_IOT_MQTT_IO_QUEUE_LEN 16
+#endif
+
+#if (AWS_IOT_MQTT_IO_QUEUE_LEN < 2) || (AWS_IOT_MQTT_IO_QUEUE_LEN & (AWS_IOT_MQTT_IO_QUEUE_LEN - 1))
+#error "AWS_IOT_MQTT_IO_QUEUE_LEN must be a power of two"
+#endif
+
+/**
+ * @brief Completion callback for a queued request
+ *
+ * Called from the I/O task once the request was processed.
+ *
+ * @param pClient The MQTT client
+ * @param rc Result of the underlying aws_iot_mqtt_* call, or FAILURE if the I/O task was
+ *           stopped before the request was processed
+ * @param pData Pointer passed when the request was submitted
+ */
+typedef void (*pMqttIoCompletionHandler)(AWS_IoT_Client *pClient, IoT_Error_t rc, void *pData);
+
+/**
+ * @brief Request types handled by the I/O task
+ */
+typedef enum {
+	MQTT_IO_REQUEST_PUBLISH = 0,
+	MQTT_IO_REQUEST_SUBSCRIBE = 1,
+	MQTT_IO_REQUEST_UNSUBSCRIBE = 2
+} MqttIoRequestType;
+
+/**
+ * @brief A request queued for the I/O task
+ *
+ * Only pointers are stored. Topic and payload buffers must stay valid until the completion
+ * callback has been called. For subscriptions the topic must stay valid for as long as the
+ * subscription exists, as for aws_iot_mqtt_subscribe.
+ */
+typedef struct {
+	MqttIoRequestType type;
+	const char *pTopicName;
+	uint16_t topicNameLen;
+	IoT_Publish_Message_Params publishParams;
+	QoS qos;
+	pApplicationHandler_t pApplicationHandler;
+	void *pApplicationHandlerData;
+	pMqttIoCompletionHandler pCompletionHandler;
+	void *pCompletionHandlerData;
+} MqttIoRequest;
+
+/**
+ * @brief One slot of the request ring buffer
+ */
+typedef struct {
+	atomic_uint_fast32_t sequence; ///< Slot state, compared against the enqueue/dequeue position
+	MqttIoRequest request;
+} MqttIoQueueSlot;
+
+/**
+ * @brief I/O task start parameters
+ */
+typedef struct {
+	uint32_t yieldTimeoutMs;    ///< Upper bound of a single yield call. Bounds request latency if the network stack cannot be woken up
+	uint32_t stackSize;         ///< Stack size of the I/O task in bytes. Completion and subscribe callbacks run on this stack
+	UBaseType_t priority;       ///< Priority of the I/O task
+	BaseType_t coreId;          ///< Core to pin the task to, or tskNO_AFFINITY
+} AWS_IoT_MQTT_IO_Task_Params;
+
+extern const AWS_IoT_MQTT_IO_Task_Params mqttIoTaskParamsDefault;
+
+#define mqttIoTaskParamsDefault_initializer {1000, 6144, 5, tskNO_AFFINITY}
+
+/**
+ * @brief I/O task context
+ *
+ * Allocated by the application, one per MQTT client. Must not be moved or freed while the
+ * task is running.
+ */
+typedef struct {
+	AWS_IoT_Client *pClient;
+	AWS_IoT_MQTT_IO_Task_Params params;
+	MqttIoQueueSlot slots[AWS_IOT_MQTT_IO_QUEUE_LEN];
+	atomic_uint_fast32_t enqueuePos;  ///< Claimed by producers with compare-and-swap
+	uint32_t dequeuePos;              ///< Only touched by the I/O task
+	atomic_bool isRunning;
+	atomic_uint_fast32_t submitters;  ///< Requests being pushed, waited for before the last drain on stop
+	TaskHandle_t taskHandle;
+	TaskHandle_t stopRequester;
+} AWS_IoT_MQTT_IO_Task;
+
+/**
+ * @brief Start the I/O task for a connected client
+ *
+ * After this call the application must not call aws_iot_mqtt_yield, publish, subscribe or
+ * unsubscribe on the client directly, only through the aws_iot_mqtt_io_* functions.
+ * Auto-reconnect should be enabled so the I/O task keeps the connection alive.
+ *
+ * @param pIoTask I/O task context
+ * @param pClient Initialized and connected MQTT client
+ * @param pParams Task parameters, NULL for defaults
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR or FAILURE if the task could not be created
+ */
+IoT_Error_t aws_iot_mqtt_io_task_start(AWS_IoT_MQTT_IO_Task *pIoTask, AWS_IoT_Client *pClient,
+									   const AWS_IoT_MQTT_IO_Task_Params *pParams);
+
+/**
+ * @brief Stop the I/O task
+ *
+ * Blocks until the I/O task has exited. Requests still queued complete with FAILURE.
+ * Other tasks should stop submitting requests before this is called.
+ * Must not be called from the I/O task itself, i.e. from a completion or subscribe callback.
+ *
+ * @param pIoTask I/O task context
+ *
+ * @return SUCCESS or NULL_VALUE_ERROR
+ */
+IoT_Error_t aws_iot_mqtt_io_task_stop(AWS_IoT_MQTT_IO_Task *pIoTask);
+
+/**
+ * @brief Queue a publish from any task
+ *
+ * @param pIoTask I/O task context
+ * @param pTopicName Topic to publish to
+ * @param topicNameLen Length of the topic name
+ * @param pParams Publish parameters, copied into the request. The payload is not copied
+ * @param pCompletionHandler Called with the result of aws_iot_mqtt_publish, may be NULL
+ * @param pCompletionHandlerData Passed to the completion handler
+ *
+ * @return SUCCESS if queued, NULL_VALUE_ERROR, FAILURE if the task is not running or
+ *         LIMIT_EXCEEDED_ERROR if the queue is full
+ */
+IoT_Error_t aws_iot_mqtt_io_publish(AWS_IoT_MQTT_IO_Task *pIoTask, const char *pTopicName, uint16_t topicNameLen,
+									IoT_Publish_Message_Params *pParams,
+									pMqttIoCompletionHandler pCompletionHandler, void *pCompletionHandlerData);
+
+/**
+ * @brief Queue a subscribe from any task
+ *
+ * The message handler runs in the I/O task.
+ *
+ * @param pIoTask I/O task context
+ * @param pTopicName Topic filter to subscribe to
+ * @param topicNameLen Length of the topic filter
+ * @param qos Requested QoS
+ * @param pApplicationHandler Message handler for the subscription
+ * @param pApplicationHandlerData Passed to the message handler
+ * @param pCompletionHandler Called with the result of aws_iot_mqtt_subscribe, may be NULL
+ * @param pCompletionHandlerData Passed to the completion handler
+ *
+ * @return SUCCESS if queued, NULL_VALUE_ERROR, FAILURE if the task is not running or
+ *         LIMIT_EXCEEDED_ERROR if the queue is full
+ */
+IoT_Error_t aws_iot_mqtt_io_subscribe(AWS_IoT_MQTT_IO_Task *pIoTask, const char *pTopicName, uint16_t topicNameLen,
+									  QoS qos, pApplicationHandler_t pApplicationHandler, void *pApplicationHandlerData,
+									  pMqttIoCompletionHandler pCompletionHandler, void *pCompletionHandlerData);
+
+/**
+ * @brief Queue an unsubscribe from any task
+ *
+ * @param pIoTask I/O task context
+ * @param pTopicName Topic filter to unsubscribe from
+ * @param topicNameLen Length of the topic filter
+ * @param pCompletionHandler Called with the result of aws_iot_mqtt_unsubscribe, may be NULL
+ * @param pCompletionHandlerData Passed to the completion handler
+ *
+ * @return SUCCESS if queued, NULL_VALUE_ERROR, FAILURE if the task is not running or
+ *         LIMIT_EXCEEDED_ERROR if the queue is full
+ */
+IoT_Error_t aws_iot_mqtt_io_unsubscribe(AWS_IoT_MQTT_IO_Task *pIoTask, const char *pTopicName, uint16_t topicNameLen,
+										pMqttIoCompletionHandler pCompletionHandler, void *pCompletionHandlerData);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_MQTT_IO_TASK_H_ */
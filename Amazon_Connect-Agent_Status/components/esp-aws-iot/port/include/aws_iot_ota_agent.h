@@ -0,0 +1,148 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * Additions Copyright 2016 Espressif Systems (Shanghai) PTE LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_ota_agent.h
+ * @brief Firmware updates run as a step of a job
+ *
+ * The agent registers the "ota" step handler on a jobs executor. A job document step such as
+ *
+ *     {"ota":{"stream":"fw-1.4.0","fileId":0,"size":1459200,"signature":"MEUCIQ..."},"timeoutSec":3600}
+ *
+ * downloads file 0 of the AWS IoT stream "fw-1.4.0" into the OTA partition that is not running, checks the
+ * base64 ECDSA P-256 signature (DER or raw r|s) of the image's SHA-256 with the ATECC608 and makes the
+ * partition the boot partition. Once the job is reported, the device restarts into the new image.
+ *
+ * The step runs in a jobs worker task, which erases the partition and verifies the image. The blocks are
+ * requested by aws_iot_ota_agent_process, called in the task yielding the client, and written to flash as they
+ * arrive. The stream, the signature and the bitmap of written blocks are kept in NVS: when the same step runs
+ * again after a reboot, only the missing blocks are downloaded.
+ *
+ * With "delta":true the file is a patch made by tools/delta_patch against the running image, and `size` is the size of the patch.
+ * The patch is downloaded to the end of the partition, then the worker checks that it was made for the running
+ * image and applies it into the start of the partition, see aws_iot_delta_patch.h. The signature is the one of
+ * the new image, as for a full download.
+ */
+
+#ifndef AWS_IOT_OTA_AGENT_H_
+#define AWS_IOT_OTA_AGENT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_partition.h"
+
+#include "aws_iot_config.h"
+#include "aws_iot_delta_patch.h"
+#include "aws_iot_jobs_executor.h"
+#include "aws_iot_stream_download.h"
+
+#define AWS_IOT_OTA_SIGNATURE_SIZE 64 ///< Raw ECDSA P-256 signature, r then s
+#define AWS_IOT_OTA_BITMAP_SIZE STREAM_DOWNLOAD_BITMAP_SIZE(AWS_IOT_OTA_MAX_IMAGE_SIZE, AWS_IOT_OTA_BLOCK_SIZE)
+
+/**
+ * @brief Agent parameters
+ */
+typedef struct {
+	const uint8_t *pSignerPublicKey; ///< Code signing public key, X then Y, or NULL to use the key in signerKeySlot
+	uint16_t signerKeySlot; ///< ATECC608 slot of the code signing public key
+	uint32_t requestTimeoutMs; ///< Time without blocks before the missing blocks of a request are asked again
+	bool restartWhenDone; ///< Restart into the new image once the job is reported
+} AWS_IoT_OTA_Agent_Params;
+
+extern const AWS_IoT_OTA_Agent_Params otaAgentParamsDefault;
+
+#define otaAgentParamsDefault_initializer {NULL, AWS_IOT_OTA_SIGNER_KEY_SLOT, 5000, true}
+
+/**
+ * @brief Image being downloaded, saved in NVS with the bitmap of written blocks
+ */
+typedef struct {
+	char streamName[MAX_SIZE_OF_STREAM_NAME]; ///< Stream ID
+	uint32_t fileId; ///< File of the stream
+	uint32_t size; ///< Bytes in the file
+	uint32_t partitionAddress; ///< Flash address of the partition the image is written to
+	uint8_t signature[AWS_IOT_OTA_SIGNATURE_SIZE]; ///< Signature of the image's SHA-256
+	bool isDelta; ///< The file is a delta patch against the running image
+	uint32_t fileOffset; ///< Offset of the file in the partition, after the image for a patch
+} AWS_IoT_OTA_Image;
+
+/**
+ * @brief Agent context
+ *
+ * Allocated by the application. Must not be moved or freed while the executor is used.
+ */
+typedef struct {
+	AWS_IoT_OTA_Agent_Params params;
+	JobsExecutor_t *pExecutor; ///< Executor the handler is registered on
+	JobsStepHandler_t handler; ///< The "ota" step handler
+	AWS_IoT_OTA_Image pending; ///< Parameters read from the job document
+	uint8_t pendingFields; ///< Parameters found, one bit each
+	AWS_IoT_OTA_Image image; ///< Image of the running step
+	uint8_t bitmap[AWS_IOT_OTA_BITMAP_SIZE]; ///< Blocks of the image written to the partition
+	const esp_partition_t *pPartition; ///< Partition being written
+	const esp_partition_t *pRunningPartition; ///< Source of a delta patch
+	JobsStep_t *pStep; ///< Running step
+	StreamDownload_t download; ///< Download of the image
+	SemaphoreHandle_t downloadEnded; ///< Given by the task yielding the client when the download stops
+	uint8_t phase; ///< What the agent is doing, accessed atomically
+	bool isCanceled; ///< The step timed out or its job ended, accessed atomically
+	bool isDownloadComplete; ///< Every block was written
+	uint32_t savedBlocks; ///< Blocks written when the bitmap was last saved
+	uint8_t progress; ///< Percent last reported
+	DeltaPatch_t patch; ///< Patch being applied by the worker
+} AWS_IoT_OTA_Agent;
+
+/**
+ * @brief Register the "ota" step handler
+ *
+ * The executor must dispatch worker steps to a jobs worker, see aws_iot_jobs_worker.h. NVS must be initialized.
+ *
+ * @param pAgent Agent context
+ * @param pExecutor Initialized jobs executor
+ * @param pParams Parameters, NULL for defaults
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR or FAILURE if the handler could not be registered
+ */
+IoT_Error_t aws_iot_ota_agent_init(AWS_IoT_OTA_Agent *pAgent, JobsExecutor_t *pExecutor,
+								   const AWS_IoT_OTA_Agent_Params *pParams);
+
+/**
+ * @brief Request blocks, save the download state and restart once an image was accepted
+ *
+ * Call it after every yield of the executor, in the same task.
+ *
+ * @param pAgent Agent context
+ */
+void aws_iot_ota_agent_process(AWS_IoT_OTA_Agent *pAgent);
+
+/**
+ * @brief Whether an image is being downloaded, e.g. to yield more often
+ *
+ * @param pAgent Agent context
+ *
+ * @return true while blocks are requested
+ */
+bool aws_iot_ota_agent_is_downloading(AWS_IoT_OTA_Agent *pAgent);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_OTA_AGENT_H_ */
@@ -22,6 +22,10 @@
 #include MBEDTLS_CONFIG_FILE
 #endif
 
+#include <stdbool.h>
+
+#include "sdkconfig.h"
+#include "aws_iot_error.h"
 #include "mbedtls/platform.h"
 #include "mbedtls/net_sockets.h"
 #include "mbedtls/ssl.h"
@@ -37,24 +41,106 @@
 extern "C" {
 #endif
 
+/**
+ * @brief TLS Handshake Phases
+ *
+ * Time spent in each part of the last TLS handshake. Each phase includes the
+ * socket waits for the messages it processes.
+ */
+typedef struct {
+    uint32_t helloMs; ///< ClientHello up to ServerHelloDone, apart from the phases below
+    uint32_t serverCertificateMs; ///< Receiving and verifying the server certificate chain
+    uint32_t keyExchangeMs; ///< Checking the ServerKeyExchange signature and computing the ECDHE secret
+    uint32_t clientAuthMs; ///< Sending the client certificate and signing CertificateVerify (secure element)
+    uint32_t finishedMs; ///< ChangeCipherSpec, Finished and session ticket
+} TLSHandshakePhases;
+
+/**
+ * @brief TLS Connection Metrics
+ *
+ * Counters of a Network, accumulated over all its connections until
+ * iot_tls_reset_metrics is called. Counters wrap around at 2^32.
+ */
+typedef struct {
+    TLSHandshakePhases lastHandshake; ///< Phase timing of the last successful handshake
+    uint32_t handshakes; ///< Successful handshakes
+    uint32_t resumedHandshakes; ///< Successful handshakes that resumed a cached session
+    uint32_t bytesIn; ///< Application bytes returned by mbedtls_ssl_read
+    uint32_t bytesOut; ///< Application bytes accepted by mbedtls_ssl_write
+    uint32_t recordsIn; ///< Application data records decrypted
+    uint32_t recordsOut; ///< Application data records encrypted
+    uint32_t socketBytesIn; ///< Bytes received from the socket, TLS overhead and handshakes included
+    uint32_t socketBytesOut; ///< Bytes sent to the socket, TLS overhead and handshakes included
+    uint32_t readCalls; ///< Socket reads issued by mbedTLS
+    uint32_t writeCalls; ///< Socket writes issued by mbedTLS
+    uint32_t readRetries; ///< Reads retried on WANT_READ/WANT_WRITE/TIMEOUT within IOT_SSL_READ_RETRY_TIMEOUT_MS
+    uint32_t writeRetries; ///< Writes retried on WANT_READ/WANT_WRITE within IOT_SSL_WRITE_RETRY_TIMEOUT_MS
+    uint32_t readTimeouts; ///< Reads that ran out of retry time with part of the data received
+    uint32_t writeTimeouts; ///< Writes that ran out of retry time
+    uint32_t handshakeHeapPeak; ///< Largest drop in free mbedTLS heap during the last handshake, in bytes
+    uint32_t connectionHeap; ///< Free mbedTLS heap taken by the connection once the handshake completed, in bytes
+} TLSMetrics;
+
 /**
  * @brief TLS Connection Parameters
  *
  * Defines a type containing TLS specific parameters to be passed down to the
  * TLS networking layer to create a TLS secured socket.
+ *
+ * Only per-connection state lives here. The parsed certificates, private key
+ * and mbedtls_ssl_config are built once and shared by all connections that
+ * use the same credentials.
  */
 typedef struct _TLSDataParams {
-    mbedtls_entropy_context entropy;
-    mbedtls_ctr_drbg_context ctr_drbg;
     mbedtls_ssl_context ssl;
-    mbedtls_ssl_config conf;
     uint32_t flags;
-    mbedtls_x509_crt cacert;
-    mbedtls_x509_crt clicert;
-    mbedtls_pk_context pkey;
+    struct _iot_tls_credentials *credentials; ///< Shared parsed certificates, key and SSL config, NULL until connect
+    uint32_t read_timeout_ms; ///< Timeout of the next socket read, per connection since the SSL config is shared
     mbedtls_net_context server_fd;
+    int wakeup_fd; ///< Loopback socket used to interrupt iot_tls_wait_for_readable, open while connected, else -1. Changed and sent to under the wake-up lock
+    TLSMetrics metrics; ///< Counters read with iot_tls_get_metrics
+#ifdef CONFIG_AWS_IOT_TLS_SESSION_RESUMPTION
+    mbedtls_ssl_session saved_session; ///< Session of the last successful handshake, offered on the next connect
+    bool has_saved_session; ///< saved_session holds a session
+    bool is_session_resumed; ///< The last handshake resumed saved_session
+#endif
 }TLSDataParams;
 
+struct Network;
+
+/**
+ * @brief Get the TLS metrics of a network connection
+ *
+ * Safe to call from any task. Counters updated concurrently by the task that
+ * owns the connection may be one event apart from each other.
+ *
+ * @param pNetwork - Pointer to the Network struct of the connection
+ * @param pMetrics - Filled in with a copy of the metrics
+ * @return IoT_Error_t - SUCCESS or NULL_VALUE_ERROR
+ */
+IoT_Error_t iot_tls_get_metrics(struct Network *pNetwork, TLSMetrics *pMetrics);
+
+/**
+ * @brief Reset the TLS metrics of a network connection to zero
+ *
+ * @param pNetwork - Pointer to the Network struct of the connection
+ * @return IoT_Error_t - SUCCESS or NULL_VALUE_ERROR
+ */
+IoT_Error_t iot_tls_reset_metrics(struct Network *pNetwork);
+
+/**
+ * @brief Format TLS metrics as a JSON object
+ *
+ * Meant for publishing the metrics over MQTT. The output is always NUL terminated.
+ *
+ * @param pMetrics - Metrics to format
+ * @param pBuf - Output buffer
+ * @param bufLen - Size of the output buffer
+ * @return int - Length of the JSON string, or the length it would have had if
+ *               it is not smaller than bufLen, as returned by snprintf
+ */
+int iot_tls_metrics_to_json(const TLSMetrics *pMetrics, char *pBuf, size_t bufLen);
+
 #define IOTSDKC_NETWORK_MBEDTLS_PLATFORM_H_H
 
 #ifdef __cplusplus
@@ -33,6 +33,13 @@ struct Timer {
     uint32_t last_polled_ticks;
 };
 
+/**
+ * @brief Delay (sleep) for the specified number of milliseconds.
+ *
+ * @param milliseconds The number of milliseconds to sleep.
+ */
+void delay(unsigned milliseconds);
+
 #ifdef __cplusplus
 }
 #endif
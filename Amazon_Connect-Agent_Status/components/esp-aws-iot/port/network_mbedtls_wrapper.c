@@ -14,7 +14,9 @@
  * permissions and limitations under the License.
  */
 #include <sys/param.h>
+#include <unistd.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <string.h>
 #include "aws_iot_config.h"
 
@@ -32,13 +34,43 @@
 #include "mbedtls/atca_mbedtls_wrap.h"
 #include "tng_atca.h"
 #include "tng_atcacert_client.h"
+#include "atca_identity_cache.h"
 #endif
 
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_vfs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "lwip/netdb.h"
+#include "lwip/sockets.h"
+
+#ifdef CONFIG_AWS_IOT_MQTT_EVENT_DRIVEN_YIELD
+#include <errno.h>
+#include <fcntl.h>
+#endif
+
+#ifdef CONFIG_AWS_IOT_TLS_SESSION_IN_RTC_MEMORY
+#include "mbedtls/version.h"
+#if MBEDTLS_VERSION_NUMBER < 0x02130000
+#error "AWS_IOT_TLS_SESSION_IN_RTC_MEMORY needs mbedtls_ssl_session_save(), available from mbed TLS 2.19"
+#endif
+#endif
 
 static const char *TAG = "aws_iot";
 
+/* Heap that mbedTLS allocates from, watched for the TLS heap metrics */
+#if defined(CONFIG_MBEDTLS_INTERNAL_MEM_ALLOC)
+#define IOT_TLS_HEAP_CAPS (MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT)
+#elif defined(CONFIG_MBEDTLS_EXTERNAL_MEM_ALLOC)
+#define IOT_TLS_HEAP_CAPS (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#else
+#define IOT_TLS_HEAP_CAPS MALLOC_CAP_8BIT
+#endif
+
 /* This is the value used for ssl read timeout */
 #ifndef IOT_SSL_READ_TIMEOUT_MS
 	#define IOT_SSL_READ_TIMEOUT_MS 3
@@ -94,81 +126,208 @@ static void _iot_tls_set_connect_params(Network *pNetwork, const char *pRootCALo
     pNetwork->tlsConnectParams.ServerVerificationFlag = ServerVerificationFlag;
 }
 
-IoT_Error_t iot_tls_init(Network *pNetwork, const char *pRootCALocation, const char *pDeviceCertLocation,
-                         const char *pDevicePrivateKeyLocation, const char *pDestinationURL,
-                         uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
-    _iot_tls_set_connect_params(pNetwork, pRootCALocation, pDeviceCertLocation, pDevicePrivateKeyLocation,
-                                pDestinationURL, destinationPort, timeout_ms, ServerVerificationFlag);
+static uint32_t _iot_tls_elapsed_ms(int64_t start_us) {
+    return (uint32_t) ((esp_timer_get_time() - start_us) / 1000);
+}
 
-    pNetwork->connect = iot_tls_connect;
-    pNetwork->read = iot_tls_read;
-    pNetwork->write = iot_tls_write;
-    pNetwork->disconnect = iot_tls_disconnect;
-    pNetwork->isConnected = iot_tls_is_connected;
-    pNetwork->destroy = iot_tls_destroy;
+/*
+ * Same as mbedtls_net_connect, but resolves the host name and opens the TCP
+ * connection as separate steps so that both can be timed.
+ */
+static int _iot_tls_net_connect(Network *pNetwork, const char *port) {
+    struct addrinfo hints;
+    struct addrinfo *addr_list;
+    struct addrinfo *cur;
+    int64_t start_us;
+    int ret;
+    int fd;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+
+    start_us = esp_timer_get_time();
+    if(getaddrinfo(pNetwork->tlsConnectParams.pDestinationURL, port, &hints, &addr_list) != 0) {
+        return MBEDTLS_ERR_NET_UNKNOWN_HOST;
+    }
+    pNetwork->connectTiming.dnsLookupMs = _iot_tls_elapsed_ms(start_us);
+
+    start_us = esp_timer_get_time();
+    ret = MBEDTLS_ERR_NET_UNKNOWN_HOST;
+    for(cur = addr_list; cur != NULL; cur = cur->ai_next) {
+        fd = socket(cur->ai_family, cur->ai_socktype, cur->ai_protocol);
+        if(fd < 0) {
+            ret = MBEDTLS_ERR_NET_SOCKET_FAILED;
+            continue;
+        }
 
-    pNetwork->tlsDataParams.flags = 0;
+        if(connect(fd, cur->ai_addr, cur->ai_addrlen) == 0) {
+            pNetwork->tlsDataParams.server_fd.fd = fd;
+            ret = 0;
+            break;
+        }
 
-    return SUCCESS;
-}
+        close(fd);
+        ret = MBEDTLS_ERR_NET_CONNECT_FAILED;
+    }
+    freeaddrinfo(addr_list);
+    pNetwork->connectTiming.tcpConnectMs = _iot_tls_elapsed_ms(start_us);
 
-IoT_Error_t iot_tls_is_connected(Network *pNetwork) {
-    /* Use this to add implementation which can check for physical layer disconnect */
-    return NETWORK_PHYSICAL_LAYER_CONNECTED;
+    return ret;
 }
 
-IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
-    int ret = SUCCESS;
-    TLSDataParams *tlsDataParams = NULL;
-    char portBuffer[6];
-    char info_buf[256];
+/*
+ * Parsed certificates, private key and SSL configuration for one set of
+ * credentials. Built on first use and shared by every connection that uses
+ * the same credentials, so a reconnect only sets up the SSL context.
+ */
+struct _iot_tls_credentials {
+    const char *pRootCALocation;
+    const char *pDeviceCertLocation;
+    const char *pDevicePrivateKeyLocation;
+    bool ServerVerificationFlag;
+    bool useAlpn;
+    bool isValid;
+    uint32_t refCount; ///< Connections using this entry, it can only be evicted at 0
+    mbedtls_x509_crt cacert;
+    mbedtls_x509_crt clicert;
+    mbedtls_pk_context pkey;
+    mbedtls_ssl_config conf;
+};
+
+typedef struct _iot_tls_credentials iot_tls_credentials_t;
+
+static iot_tls_credentials_t s_credentials[CONFIG_AWS_IOT_TLS_CREDENTIAL_CACHE_SIZE];
+static SemaphoreHandle_t s_credentials_lock = NULL;
+static portMUX_TYPE s_lock_init_mux = portMUX_INITIALIZER_UNLOCKED;
+
+/* Random generator shared by all connections, seeded on first connect */
+static mbedtls_entropy_context s_entropy;
+static mbedtls_ctr_drbg_context s_ctr_drbg;
+static bool s_ctr_drbg_seeded = false;
+static SemaphoreHandle_t s_ctr_drbg_lock = NULL;
+
+/* Held to change a wake-up socket and to send to it, so that a wake-up from
+ * another task never goes to a closed or reused descriptor */
+static SemaphoreHandle_t s_wakeup_lock = NULL;
 
-    if(NULL == pNetwork) {
-        return NULL_VALUE_ERROR;
+#ifdef CONFIG_MBEDTLS_SSL_ALPN
+/* Must outlive the cached SSL config, mbedTLS keeps the pointer */
+static const char *s_alpn_protocols[] = { "x-amzn-mqtt-ca", NULL };
+#endif
+
+static bool _iot_tls_create_locks(void) {
+    SemaphoreHandle_t credentials_lock;
+    SemaphoreHandle_t ctr_drbg_lock;
+    SemaphoreHandle_t wakeup_lock;
+
+    if(s_credentials_lock != NULL) {
+        return true;
     }
 
-    if(NULL != params) {
-        _iot_tls_set_connect_params(pNetwork, params->pRootCALocation, params->pDeviceCertLocation,
-                                    params->pDevicePrivateKeyLocation, params->pDestinationURL,
-                                    params->DestinationPort, params->timeout_ms, params->ServerVerificationFlag);
+    credentials_lock = xSemaphoreCreateMutex();
+    ctr_drbg_lock = xSemaphoreCreateMutex();
+    wakeup_lock = xSemaphoreCreateMutex();
+    if(credentials_lock != NULL && ctr_drbg_lock != NULL && wakeup_lock != NULL) {
+        /* Another task may have won the race while these were created */
+        portENTER_CRITICAL(&s_lock_init_mux);
+        if(s_credentials_lock == NULL) {
+            s_ctr_drbg_lock = ctr_drbg_lock;
+            s_wakeup_lock = wakeup_lock;
+            s_credentials_lock = credentials_lock;
+            credentials_lock = NULL;
+            ctr_drbg_lock = NULL;
+            wakeup_lock = NULL;
+        }
+        portEXIT_CRITICAL(&s_lock_init_mux);
     }
 
-    tlsDataParams = &(pNetwork->tlsDataParams);
+    if(credentials_lock != NULL) {
+        vSemaphoreDelete(credentials_lock);
+    }
+    if(ctr_drbg_lock != NULL) {
+        vSemaphoreDelete(ctr_drbg_lock);
+    }
+    if(wakeup_lock != NULL) {
+        vSemaphoreDelete(wakeup_lock);
+    }
 
-    mbedtls_net_init(&(tlsDataParams->server_fd));
-    mbedtls_ssl_init(&(tlsDataParams->ssl));
-    mbedtls_ssl_config_init(&(tlsDataParams->conf));
+    return s_credentials_lock != NULL;
+}
 
-#ifdef CONFIG_MBEDTLS_DEBUG
-    mbedtls_esp_enable_debug_log(&(tlsDataParams->conf), 4);
-#endif
+static int _iot_tls_random(void *p_rng, unsigned char *output, size_t output_len) {
+    int ret;
+
+    ((void) p_rng);
 
-    mbedtls_ctr_drbg_init(&(tlsDataParams->ctr_drbg));
-    mbedtls_x509_crt_init(&(tlsDataParams->cacert));
-    mbedtls_x509_crt_init(&(tlsDataParams->clicert));
-    mbedtls_pk_init(&(tlsDataParams->pkey));
+    xSemaphoreTake(s_ctr_drbg_lock, portMAX_DELAY);
+    ret = mbedtls_ctr_drbg_random(&s_ctr_drbg, output, output_len);
+    xSemaphoreGive(s_ctr_drbg_lock);
 
-    ESP_LOGD(TAG, "Seeding the random number generator...");
-    mbedtls_entropy_init(&(tlsDataParams->entropy));
-    if((ret = mbedtls_ctr_drbg_seed(&(tlsDataParams->ctr_drbg), mbedtls_entropy_func, &(tlsDataParams->entropy),
-                                    (const unsigned char *) TAG, strlen(TAG))) != 0) {
-        ESP_LOGE(TAG, "failed! mbedtls_ctr_drbg_seed returned -0x%x", -ret);
-        return NETWORK_MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED;
+    return ret;
+}
+
+/*
+ * The BIO context is the connection rather than its socket, so that reads use
+ * the connection's own timeout instead of the one in the shared SSL config.
+ */
+static int _iot_tls_net_send(void *ctx, const unsigned char *buf, size_t len) {
+    TLSDataParams *tlsDataParams = (TLSDataParams *) ctx;
+    int ret;
+
+    ret = mbedtls_net_send(&(tlsDataParams->server_fd), buf, len);
+    tlsDataParams->metrics.writeCalls++;
+    if(ret > 0) {
+        tlsDataParams->metrics.socketBytesOut += ret;
     }
 
+    return ret;
+}
+
+static int _iot_tls_net_recv_timeout(void *ctx, unsigned char *buf, size_t len, uint32_t timeout) {
+    TLSDataParams *tlsDataParams = (TLSDataParams *) ctx;
+    int ret;
+
+    ((void) timeout);
+
+    ret = mbedtls_net_recv_timeout(&(tlsDataParams->server_fd), buf, len, tlsDataParams->read_timeout_ms);
+    tlsDataParams->metrics.readCalls++;
+    if(ret > 0) {
+        tlsDataParams->metrics.socketBytesIn += ret;
+    }
+
+    return ret;
+}
+
+static bool _iot_tls_same_location(const char *a, const char *b) {
+    return a == b || (a != NULL && b != NULL && strcmp(a, b) == 0);
+}
+
+static void _iot_tls_free_credentials(iot_tls_credentials_t *c) {
+    mbedtls_x509_crt_free(&(c->clicert));
+    mbedtls_x509_crt_free(&(c->cacert));
+    mbedtls_pk_free(&(c->pkey));
+    mbedtls_ssl_config_free(&(c->conf));
+    c->isValid = false;
+}
+
+static IoT_Error_t _iot_tls_parse_credentials(iot_tls_credentials_t *c, TLSConnectParams *params) {
+    int ret;
+
    /*  Load root CA...
 
        Certs/keys can be paths or they can be raw data. These use a
        very basic heuristic: if the cert starts with '/' then it's a
        path, if it's longer than this then it's raw cert data (PEM or DER,
        neither of which can start with a slash. */
-    if (pNetwork->tlsConnectParams.pRootCALocation[0] == '/') {
+    if (params->pRootCALocation[0] == '/') {
         ESP_LOGD(TAG, "Loading CA root certificate from file ...");
-        ret = mbedtls_x509_crt_parse_file(&(tlsDataParams->cacert), pNetwork->tlsConnectParams.pRootCALocation);
+        ret = mbedtls_x509_crt_parse_file(&(c->cacert), params->pRootCALocation);
     } else {
         ESP_LOGD(TAG, "Loading embedded CA root certificate ...");
-        ret = mbedtls_x509_crt_parse(&(tlsDataParams->cacert), (const unsigned char *)pNetwork->tlsConnectParams.pRootCALocation,
-                                 strlen(pNetwork->tlsConnectParams.pRootCALocation)+1);
+        ret = mbedtls_x509_crt_parse(&(c->cacert), (const unsigned char *)params->pRootCALocation,
+                                 strlen(params->pRootCALocation)+1);
     }
 
     if(ret < 0) {
@@ -179,27 +338,36 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 
     /* Load client certificate... */
 #ifdef CONFIG_AWS_IOT_USE_HARDWARE_SECURE_ELEMENT
-    if (pNetwork->tlsConnectParams.pDeviceCertLocation[0] == '#') {
-        const atcacert_def_t* cert_def = NULL;
+    if (params->pDeviceCertLocation[0] == '#') {
+        const uint8_t *der = NULL;
+        size_t der_len = 0;
         ESP_LOGD(TAG, "Using certificate stored in ATECC608");
-        ret = tng_get_device_cert_def(&cert_def);
+        ret = atca_identity_get_device_cert(&der, &der_len);
         if (ret == 0) {
             ESP_LOGI(TAG, "Attempting to use device certificate from ATECC608");
-            ret = atca_mbedtls_cert_add(&(tlsDataParams->clicert), cert_def);
+            ret = mbedtls_x509_crt_parse_der(&(c->clicert), der, der_len);
+#ifdef CONFIG_AWS_IOT_SEND_SIGNER_CERTIFICATE
+            if (ret == 0) {
+                ret = atca_identity_get_signer_cert(&der, &der_len);
+                if (ret == 0) {
+                    ret = mbedtls_x509_crt_parse_der(&(c->clicert), der, der_len);
+                }
+            }
+#endif
         } else {
-            ESP_LOGE(TAG, "failed! could not load cert from ATECC608, tng_get_device_cert_def returned %02x", ret);
+            ESP_LOGE(TAG, "failed! could not load cert from ATECC608, atca_identity_get_device_cert returned %02x", ret);
         }
     } else
 #endif
-    if (pNetwork->tlsConnectParams.pDeviceCertLocation[0] == '/') {
+    if (params->pDeviceCertLocation[0] == '/') {
         ESP_LOGD(TAG, "Loading client cert from file...");
-        ret = mbedtls_x509_crt_parse_file(&(tlsDataParams->clicert),
-                                          pNetwork->tlsConnectParams.pDeviceCertLocation);
+        ret = mbedtls_x509_crt_parse_file(&(c->clicert),
+                                          params->pDeviceCertLocation);
     } else {
         ESP_LOGD(TAG, "Loading embedded client certificate...");
-        ret = mbedtls_x509_crt_parse(&(tlsDataParams->clicert),
-                                     (const unsigned char *)pNetwork->tlsConnectParams.pDeviceCertLocation,
-                                     strlen(pNetwork->tlsConnectParams.pDeviceCertLocation)+1);
+        ret = mbedtls_x509_crt_parse(&(c->clicert),
+                                     (const unsigned char *)params->pDeviceCertLocation,
+                                     strlen(params->pDeviceCertLocation)+1);
     }
     if(ret != 0) {
         ESP_LOGE(TAG, "failed!  mbedtls_x509_crt_parse returned -0x%x while parsing device cert", -ret);
@@ -208,30 +376,30 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
 
     /* Parse client private key... */
 #ifdef CONFIG_AWS_IOT_USE_HARDWARE_SECURE_ELEMENT
-    if (pNetwork->tlsConnectParams.pDevicePrivateKeyLocation[0] == '#') {
-        int8_t slot_id = pNetwork->tlsConnectParams.pDevicePrivateKeyLocation[1] - '0';
+    if (params->pDevicePrivateKeyLocation[0] == '#') {
+        int8_t slot_id = params->pDevicePrivateKeyLocation[1] - '0';
         if (slot_id < 0 || slot_id > 9) {
             ESP_LOGE(TAG, "Invalid ATECC608 slot ID.");
             ret = NETWORK_PK_PRIVATE_KEY_PARSE_ERROR;
         } else {
             ESP_LOGD(TAG, "Using ATECC608 private key from slot %d", slot_id);
-            ret = atca_mbedtls_pk_init(&(tlsDataParams->pkey), slot_id);
+            ret = atca_mbedtls_pk_init(&(c->pkey), slot_id);
             if (ret != 0) {
                 ESP_LOGE(TAG, "failed !  atca_mbedtls_pk_init returned %02x", ret);
             }
         }
     } else
 #endif
-    if (pNetwork->tlsConnectParams.pDevicePrivateKeyLocation[0] == '/') {
+    if (params->pDevicePrivateKeyLocation[0] == '/') {
         ESP_LOGD(TAG, "Loading client private key from file...");
-        ret = mbedtls_pk_parse_keyfile(&(tlsDataParams->pkey),
-                                       pNetwork->tlsConnectParams.pDevicePrivateKeyLocation,
+        ret = mbedtls_pk_parse_keyfile(&(c->pkey),
+                                       params->pDevicePrivateKeyLocation,
                                        "");
     } else {
         ESP_LOGD(TAG, "Loading embedded client private key...");
-        ret = mbedtls_pk_parse_key(&(tlsDataParams->pkey),
-                                   (const unsigned char *)pNetwork->tlsConnectParams.pDevicePrivateKeyLocation,
-                                   strlen(pNetwork->tlsConnectParams.pDevicePrivateKeyLocation)+1,
+        ret = mbedtls_pk_parse_key(&(c->pkey),
+                                   (const unsigned char *)params->pDevicePrivateKeyLocation,
+                                   strlen(params->pDevicePrivateKeyLocation)+1,
                                    (const unsigned char *)"", 0);
     }
     if(ret != 0) {
@@ -239,67 +407,524 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
         return NETWORK_PK_PRIVATE_KEY_PARSE_ERROR;
     }
 
-    /* Done parsing certs */
     ESP_LOGD(TAG, "ok");
-    snprintf(portBuffer, 6, "%d", pNetwork->tlsConnectParams.DestinationPort);
-    ESP_LOGD(TAG, "Connecting to %s/%s...", pNetwork->tlsConnectParams.pDestinationURL, portBuffer);
-    if((ret = mbedtls_net_connect(&(tlsDataParams->server_fd), pNetwork->tlsConnectParams.pDestinationURL,
-                                  portBuffer, MBEDTLS_NET_PROTO_TCP)) != 0) {
-        ESP_LOGE(TAG, "failed! mbedtls_net_connect returned -0x%x", -ret);
-        switch(ret) {
-            case MBEDTLS_ERR_NET_SOCKET_FAILED:
-                return NETWORK_ERR_NET_SOCKET_FAILED;
-            case MBEDTLS_ERR_NET_UNKNOWN_HOST:
-                return NETWORK_ERR_NET_UNKNOWN_HOST;
-            case MBEDTLS_ERR_NET_CONNECT_FAILED:
-            default:
-                return NETWORK_ERR_NET_CONNECT_FAILED;
-        };
-    }
+    return SUCCESS;
+}
 
-    ret = mbedtls_net_set_block(&(tlsDataParams->server_fd));
-    if(ret != 0) {
-        ESP_LOGE(TAG, "failed! net_set_(non)block() returned -0x%x", -ret);
-        return SSL_CONNECTION_ERROR;
-    } ESP_LOGD(TAG, "ok");
+static IoT_Error_t _iot_tls_setup_config(iot_tls_credentials_t *c, bool useAlpn) {
+    int ret;
 
-    ESP_LOGD(TAG, "Setting up the SSL/TLS structure...");
-    if((ret = mbedtls_ssl_config_defaults(&(tlsDataParams->conf), MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+    if((ret = mbedtls_ssl_config_defaults(&(c->conf), MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
                                           MBEDTLS_SSL_PRESET_DEFAULT)) != 0) {
         ESP_LOGE(TAG, "failed! mbedtls_ssl_config_defaults returned -0x%x", -ret);
         return SSL_CONNECTION_ERROR;
     }
 
-    mbedtls_ssl_conf_verify(&(tlsDataParams->conf), _iot_tls_verify_cert, NULL);
+#ifdef CONFIG_MBEDTLS_DEBUG
+    mbedtls_esp_enable_debug_log(&(c->conf), 4);
+#endif
 
-    if(pNetwork->tlsConnectParams.ServerVerificationFlag == true) {
-        mbedtls_ssl_conf_authmode(&(tlsDataParams->conf), MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_verify(&(c->conf), _iot_tls_verify_cert, NULL);
+
+    if(c->ServerVerificationFlag == true) {
+        mbedtls_ssl_conf_authmode(&(c->conf), MBEDTLS_SSL_VERIFY_REQUIRED);
     } else {
-        mbedtls_ssl_conf_authmode(&(tlsDataParams->conf), MBEDTLS_SSL_VERIFY_OPTIONAL);
+        mbedtls_ssl_conf_authmode(&(c->conf), MBEDTLS_SSL_VERIFY_OPTIONAL);
     }
-    mbedtls_ssl_conf_rng(&(tlsDataParams->conf), mbedtls_ctr_drbg_random, &(tlsDataParams->ctr_drbg));
+    mbedtls_ssl_conf_rng(&(c->conf), _iot_tls_random, NULL);
 
-    mbedtls_ssl_conf_ca_chain(&(tlsDataParams->conf), &(tlsDataParams->cacert), NULL);
-    ret = mbedtls_ssl_conf_own_cert(&(tlsDataParams->conf), &(tlsDataParams->clicert), &(tlsDataParams->pkey));
+    mbedtls_ssl_conf_ca_chain(&(c->conf), &(c->cacert), NULL);
+    ret = mbedtls_ssl_conf_own_cert(&(c->conf), &(c->clicert), &(c->pkey));
     if(ret != 0) {
         ESP_LOGE(TAG, "failed! mbedtls_ssl_conf_own_cert returned %d", ret);
         return SSL_CONNECTION_ERROR;
     }
 
-    mbedtls_ssl_conf_read_timeout(&(tlsDataParams->conf), pNetwork->tlsConnectParams.timeout_ms);
+#if defined(CONFIG_AWS_IOT_TLS_SESSION_RESUMPTION) && defined(MBEDTLS_SSL_SESSION_TICKETS)
+    mbedtls_ssl_conf_session_tickets(&(c->conf), MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#endif
 
 #ifdef CONFIG_MBEDTLS_SSL_ALPN
     /* Use the AWS IoT ALPN extension for MQTT, if port 443 is requested */
-    if (pNetwork->tlsConnectParams.DestinationPort == 443) {
-        const char *alpnProtocols[] = { "x-amzn-mqtt-ca", NULL };
-        if ((ret = mbedtls_ssl_conf_alpn_protocols(&(tlsDataParams->conf), alpnProtocols)) != 0) {
+    if(useAlpn) {
+        if((ret = mbedtls_ssl_conf_alpn_protocols(&(c->conf), s_alpn_protocols)) != 0) {
             ESP_LOGE(TAG, "failed! mbedtls_ssl_conf_alpn_protocols returned -0x%x", -ret);
             return SSL_CONNECTION_ERROR;
         }
     }
+#else
+    ((void) useAlpn);
+#endif
+
+    return SUCCESS;
+}
+
+static IoT_Error_t _iot_tls_build_credentials(iot_tls_credentials_t *c, TLSConnectParams *params, bool useAlpn) {
+    IoT_Error_t rc;
+
+    mbedtls_x509_crt_init(&(c->cacert));
+    mbedtls_x509_crt_init(&(c->clicert));
+    mbedtls_pk_init(&(c->pkey));
+    mbedtls_ssl_config_init(&(c->conf));
+
+    c->pRootCALocation = params->pRootCALocation;
+    c->pDeviceCertLocation = params->pDeviceCertLocation;
+    c->pDevicePrivateKeyLocation = params->pDevicePrivateKeyLocation;
+    c->ServerVerificationFlag = params->ServerVerificationFlag;
+    c->useAlpn = useAlpn;
+    c->refCount = 0;
+
+#ifdef CONFIG_AWS_IOT_USE_HARDWARE_SECURE_ELEMENT
+    /* Certificate and public key reads from the ATECC608 share one wake-up */
+    atcab_session_begin();
+#endif
+    rc = _iot_tls_parse_credentials(c, params);
+#ifdef CONFIG_AWS_IOT_USE_HARDWARE_SECURE_ELEMENT
+    atcab_session_end();
+#endif
+    if(rc == SUCCESS) {
+        rc = _iot_tls_setup_config(c, useAlpn);
+    }
+
+    if(rc != SUCCESS) {
+        _iot_tls_free_credentials(c);
+        return rc;
+    }
+
+    c->isValid = true;
+    return SUCCESS;
+}
+
+/* Must be called with s_credentials_lock held */
+static void _iot_tls_release_credentials_locked(TLSDataParams *tlsDataParams) {
+    if(tlsDataParams->credentials != NULL) {
+        tlsDataParams->credentials->refCount--;
+        tlsDataParams->credentials = NULL;
+    }
+}
+
+static void _iot_tls_release_credentials(TLSDataParams *tlsDataParams) {
+    if(tlsDataParams->credentials == NULL) {
+        return;
+    }
+
+    xSemaphoreTake(s_credentials_lock, portMAX_DELAY);
+    _iot_tls_release_credentials_locked(tlsDataParams);
+    xSemaphoreGive(s_credentials_lock);
+}
+
+/*
+ * Point the connection at the cached credentials for its connect parameters,
+ * parsing them and building the SSL config only if no entry matches yet.
+ */
+static IoT_Error_t _iot_tls_acquire_credentials(Network *pNetwork) {
+    TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+    TLSConnectParams *params = &(pNetwork->tlsConnectParams);
+    bool useAlpn = (params->DestinationPort == 443);
+    iot_tls_credentials_t *entry = NULL;
+    iot_tls_credentials_t *unused = NULL;
+    iot_tls_credentials_t *c;
+    IoT_Error_t rc = SUCCESS;
+    int ret;
+    size_t i;
+
+    xSemaphoreTake(s_credentials_lock, portMAX_DELAY);
+
+    /* A failed connect isn't always followed by destroy */
+    _iot_tls_release_credentials_locked(tlsDataParams);
+
+    if(!s_ctr_drbg_seeded) {
+        ESP_LOGD(TAG, "Seeding the random number generator...");
+        mbedtls_entropy_init(&s_entropy);
+        mbedtls_ctr_drbg_init(&s_ctr_drbg);
+        if((ret = mbedtls_ctr_drbg_seed(&s_ctr_drbg, mbedtls_entropy_func, &s_entropy,
+                                        (const unsigned char *) TAG, strlen(TAG))) != 0) {
+            ESP_LOGE(TAG, "failed! mbedtls_ctr_drbg_seed returned -0x%x", -ret);
+            mbedtls_ctr_drbg_free(&s_ctr_drbg);
+            mbedtls_entropy_free(&s_entropy);
+            xSemaphoreGive(s_credentials_lock);
+            return NETWORK_MBEDTLS_ERR_CTR_DRBG_ENTROPY_SOURCE_FAILED;
+        }
+        s_ctr_drbg_seeded = true;
+    }
+
+    for(i = 0; i < CONFIG_AWS_IOT_TLS_CREDENTIAL_CACHE_SIZE; i++) {
+        c = &s_credentials[i];
+        if(c->isValid && c->ServerVerificationFlag == params->ServerVerificationFlag && c->useAlpn == useAlpn &&
+           _iot_tls_same_location(c->pRootCALocation, params->pRootCALocation) &&
+           _iot_tls_same_location(c->pDeviceCertLocation, params->pDeviceCertLocation) &&
+           _iot_tls_same_location(c->pDevicePrivateKeyLocation, params->pDevicePrivateKeyLocation)) {
+            entry = c;
+            break;
+        }
+        /* Prefer an empty slot over evicting a cached entry */
+        if(c->refCount == 0 && (unused == NULL || !c->isValid)) {
+            unused = c;
+        }
+    }
+
+    if(entry != NULL) {
+        ESP_LOGD(TAG, "Using cached certificates and SSL config");
+    } else if(unused == NULL) {
+        ESP_LOGE(TAG, "All %d TLS credential cache slots are in use, raise AWS_IOT_TLS_CREDENTIAL_CACHE_SIZE",
+                 CONFIG_AWS_IOT_TLS_CREDENTIAL_CACHE_SIZE);
+        rc = SSL_CONNECTION_ERROR;
+    } else {
+        if(unused->isValid) {
+            _iot_tls_free_credentials(unused);
+        }
+        rc = _iot_tls_build_credentials(unused, params, useAlpn);
+        if(rc == SUCCESS) {
+            entry = unused;
+        }
+    }
+
+    if(entry != NULL) {
+        entry->refCount++;
+        tlsDataParams->credentials = entry;
+    }
+
+    xSemaphoreGive(s_credentials_lock);
+    return rc;
+}
+
+#ifdef CONFIG_AWS_IOT_TLS_SESSION_RESUMPTION
+#ifdef CONFIG_AWS_IOT_TLS_SESSION_IN_RTC_MEMORY
+#define IOT_TLS_RTC_SESSION_MAGIC 0x544c5353u
+
+/* Serialized session that survives deep sleep. RTC_NOINIT memory holds garbage
+ * after a power-on reset, so it's only trusted when magic and checksum match. */
+typedef struct {
+    uint32_t magic;
+    uint32_t key; ///< Hash of the host name and port the session belongs to
+    uint32_t len;
+    uint32_t checksum;
+    unsigned char data[CONFIG_AWS_IOT_TLS_SESSION_RTC_SIZE];
+} iot_tls_rtc_session_t;
+
+static RTC_NOINIT_ATTR iot_tls_rtc_session_t s_rtc_session;
+
+static uint32_t _iot_tls_fnv1a(uint32_t hash, const unsigned char *data, size_t len) {
+    size_t i;
+
+    for(i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t _iot_tls_rtc_session_key(Network *pNetwork) {
+    const char *host = pNetwork->tlsConnectParams.pDestinationURL;
+    uint16_t port = pNetwork->tlsConnectParams.DestinationPort;
+    uint32_t hash = 2166136261u;
+
+    if(host != NULL) {
+        hash = _iot_tls_fnv1a(hash, (const unsigned char *) host, strlen(host));
+    }
+    return _iot_tls_fnv1a(hash, (const unsigned char *) &port, sizeof(port));
+}
+
+static void _iot_tls_rtc_session_store(Network *pNetwork) {
+    size_t len = 0;
+
+    s_rtc_session.magic = 0;
+    if(mbedtls_ssl_session_save(&(pNetwork->tlsDataParams.saved_session), s_rtc_session.data,
+                                sizeof(s_rtc_session.data), &len) != 0) {
+        ESP_LOGW(TAG, "TLS session doesn't fit in %d bytes of RTC memory", CONFIG_AWS_IOT_TLS_SESSION_RTC_SIZE);
+        return;
+    }
+
+    s_rtc_session.key = _iot_tls_rtc_session_key(pNetwork);
+    s_rtc_session.len = (uint32_t) len;
+    s_rtc_session.checksum = _iot_tls_fnv1a(s_rtc_session.key, s_rtc_session.data, len);
+    s_rtc_session.magic = IOT_TLS_RTC_SESSION_MAGIC;
+}
+
+static void _iot_tls_rtc_session_load(Network *pNetwork) {
+    TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+
+    if(s_rtc_session.magic != IOT_TLS_RTC_SESSION_MAGIC ||
+       s_rtc_session.key != _iot_tls_rtc_session_key(pNetwork) ||
+       s_rtc_session.len > sizeof(s_rtc_session.data) ||
+       s_rtc_session.checksum != _iot_tls_fnv1a(s_rtc_session.key, s_rtc_session.data, s_rtc_session.len)) {
+        return;
+    }
+
+    if(mbedtls_ssl_session_load(&(tlsDataParams->saved_session), s_rtc_session.data, s_rtc_session.len) == 0) {
+        tlsDataParams->has_saved_session = true;
+        ESP_LOGD(TAG, "Restored TLS session from RTC memory");
+    } else {
+        mbedtls_ssl_session_free(&(tlsDataParams->saved_session));
+        mbedtls_ssl_session_init(&(tlsDataParams->saved_session));
+        s_rtc_session.magic = 0;
+    }
+}
 #endif
 
-    if((ret = mbedtls_ssl_setup(&(tlsDataParams->ssl), &(tlsDataParams->conf))) != 0) {
+static void _iot_tls_forget_session(Network *pNetwork) {
+    TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+
+    mbedtls_ssl_session_free(&(tlsDataParams->saved_session));
+    mbedtls_ssl_session_init(&(tlsDataParams->saved_session));
+    tlsDataParams->has_saved_session = false;
+#ifdef CONFIG_AWS_IOT_TLS_SESSION_IN_RTC_MEMORY
+    s_rtc_session.magic = 0;
+#endif
+}
+
+/*
+ * Keep a copy of the negotiated session for the next connect. It is refreshed
+ * after resumed handshakes too, since the server may have issued a new ticket.
+ */
+static void _iot_tls_save_session(Network *pNetwork) {
+    TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+    int ret;
+
+    _iot_tls_forget_session(pNetwork);
+    if((ret = mbedtls_ssl_get_session(&(tlsDataParams->ssl), &(tlsDataParams->saved_session))) != 0) {
+        ESP_LOGW(TAG, "mbedtls_ssl_get_session returned -0x%x, next connect does a full handshake", -ret);
+        _iot_tls_forget_session(pNetwork);
+        return;
+    }
+    tlsDataParams->has_saved_session = true;
+#ifdef CONFIG_AWS_IOT_TLS_SESSION_IN_RTC_MEMORY
+    _iot_tls_rtc_session_store(pNetwork);
+#endif
+}
+#endif
+
+static uint32_t *_iot_tls_handshake_phase(TLSHandshakePhases *phases, int state) {
+    switch(state) {
+        case MBEDTLS_SSL_SERVER_CERTIFICATE:
+            return &(phases->serverCertificateMs);
+        case MBEDTLS_SSL_SERVER_KEY_EXCHANGE:
+        case MBEDTLS_SSL_CLIENT_KEY_EXCHANGE:
+            return &(phases->keyExchangeMs);
+        case MBEDTLS_SSL_CLIENT_CERTIFICATE:
+        case MBEDTLS_SSL_CERTIFICATE_VERIFY:
+            return &(phases->clientAuthMs);
+        case MBEDTLS_SSL_HELLO_REQUEST:
+        case MBEDTLS_SSL_CLIENT_HELLO:
+        case MBEDTLS_SSL_SERVER_HELLO:
+        case MBEDTLS_SSL_CERTIFICATE_REQUEST:
+        case MBEDTLS_SSL_SERVER_HELLO_DONE:
+            return &(phases->helloMs);
+        default:
+            return &(phases->finishedMs);
+    }
+}
+
+/*
+ * Same as mbedtls_ssl_handshake, but steps through the handshake states so
+ * that each phase can be timed and a full handshake told from a resumed one:
+ * the server only sends its certificate when it did not accept the offered
+ * session. The free heap is sampled between steps for the heap peak.
+ */
+static int _iot_tls_handshake(TLSDataParams *tlsDataParams, TLSHandshakePhases *phases, size_t *min_free_heap) {
+    int64_t step_start_us;
+    size_t free_heap;
+    int state;
+    int ret = 0;
+
+    while(tlsDataParams->ssl.state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+        state = tlsDataParams->ssl.state;
+        step_start_us = esp_timer_get_time();
+        ret = mbedtls_ssl_handshake_step(&(tlsDataParams->ssl));
+        *_iot_tls_handshake_phase(phases, state) += _iot_tls_elapsed_ms(step_start_us);
+
+        free_heap = heap_caps_get_free_size(IOT_TLS_HEAP_CAPS);
+        if(free_heap < *min_free_heap) {
+            *min_free_heap = free_heap;
+        }
+#ifdef CONFIG_AWS_IOT_TLS_SESSION_RESUMPTION
+        if(tlsDataParams->ssl.state == MBEDTLS_SSL_SERVER_CERTIFICATE) {
+            tlsDataParams->is_session_resumed = false;
+        }
+#endif
+        if(ret != 0) {
+            break;
+        }
+    }
+
+    return ret;
+}
+
+#ifdef CONFIG_AWS_IOT_MQTT_EVENT_DRIVEN_YIELD
+/*
+ * Create a UDP socket bound and connected to itself on the loopback interface.
+ * Sending a byte to it makes it readable, which interrupts a select() that
+ * waits on it alongside the TLS socket.
+ */
+static int _iot_tls_create_wakeup_socket(void) {
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int fd;
+
+    fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if(fd < 0) {
+        return -1;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+
+    if(bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+       getsockname(fd, (struct sockaddr *) &addr, &addr_len) != 0 ||
+       connect(fd, (struct sockaddr *) &addr, addr_len) != 0) {
+        close(fd);
+        return -1;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
+}
+#endif
+
+/*
+ * The wake-up socket lives as long as the connection: iot_tls_connect opens it
+ * and iot_tls_destroy, called by the MQTT client after every connection,
+ * closes it. iot_tls_init does not open it, so initializing a client again
+ * does not leak a socket. Both hold s_wakeup_lock, as iot_tls_wakeup does.
+ */
+static void _iot_tls_open_wakeup_socket(TLSDataParams *tlsDataParams) {
+#ifdef CONFIG_AWS_IOT_MQTT_EVENT_DRIVEN_YIELD
+    xSemaphoreTake(s_wakeup_lock, portMAX_DELAY);
+    if(tlsDataParams->wakeup_fd < 0) {
+        tlsDataParams->wakeup_fd = _iot_tls_create_wakeup_socket();
+        if(tlsDataParams->wakeup_fd < 0) {
+            ESP_LOGW(TAG, "Failed to create wake-up socket, MQTT yield only wakes up on its timeout");
+        }
+    }
+    xSemaphoreGive(s_wakeup_lock);
+#else
+    (void) tlsDataParams;
+#endif
+}
+
+static void _iot_tls_close_wakeup_socket(TLSDataParams *tlsDataParams) {
+#ifdef CONFIG_AWS_IOT_MQTT_EVENT_DRIVEN_YIELD
+    /* Closed under the lock: once it is released the descriptor number may be
+     * reused by lwIP, and a wake-up already reads -1 */
+    xSemaphoreTake(s_wakeup_lock, portMAX_DELAY);
+    if(tlsDataParams->wakeup_fd >= 0) {
+        close(tlsDataParams->wakeup_fd);
+        tlsDataParams->wakeup_fd = -1;
+    }
+    xSemaphoreGive(s_wakeup_lock);
+#else
+    (void) tlsDataParams;
+#endif
+}
+
+IoT_Error_t iot_tls_init(Network *pNetwork, const char *pRootCALocation, const char *pDeviceCertLocation,
+                         const char *pDevicePrivateKeyLocation, const char *pDestinationURL,
+                         uint16_t destinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
+    _iot_tls_set_connect_params(pNetwork, pRootCALocation, pDeviceCertLocation, pDevicePrivateKeyLocation,
+                                pDestinationURL, destinationPort, timeout_ms, ServerVerificationFlag);
+
+    pNetwork->connect = iot_tls_connect;
+    pNetwork->read = iot_tls_read;
+    pNetwork->write = iot_tls_write;
+    pNetwork->disconnect = iot_tls_disconnect;
+    pNetwork->isConnected = iot_tls_is_connected;
+    pNetwork->destroy = iot_tls_destroy;
+    /* Opened by iot_tls_connect */
+    pNetwork->tlsDataParams.wakeup_fd = -1;
+#ifdef CONFIG_AWS_IOT_MQTT_EVENT_DRIVEN_YIELD
+    pNetwork->waitForReadable = iot_tls_wait_for_readable;
+    pNetwork->wakeup = iot_tls_wakeup;
+#else
+    pNetwork->waitForReadable = NULL;
+    pNetwork->wakeup = NULL;
+#endif
+
+    pNetwork->tlsDataParams.flags = 0;
+    pNetwork->tlsDataParams.credentials = NULL;
+    pNetwork->tlsDataParams.read_timeout_ms = timeout_ms;
+    memset(&(pNetwork->tlsDataParams.metrics), 0, sizeof(TLSMetrics));
+
+    if(!_iot_tls_create_locks()) {
+        ESP_LOGE(TAG, "Failed to create TLS credential cache locks");
+        return NETWORK_SSL_INIT_ERROR;
+    }
+
+#ifdef CONFIG_AWS_IOT_TLS_SESSION_RESUMPTION
+    mbedtls_ssl_session_init(&(pNetwork->tlsDataParams.saved_session));
+    pNetwork->tlsDataParams.has_saved_session = false;
+    pNetwork->tlsDataParams.is_session_resumed = false;
+#ifdef CONFIG_AWS_IOT_TLS_SESSION_IN_RTC_MEMORY
+    _iot_tls_rtc_session_load(pNetwork);
+#endif
+#endif
+
+    return SUCCESS;
+}
+
+IoT_Error_t iot_tls_is_connected(Network *pNetwork) {
+    /* Use this to add implementation which can check for physical layer disconnect */
+    return NETWORK_PHYSICAL_LAYER_CONNECTED;
+}
+
+IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
+    int ret = SUCCESS;
+    TLSDataParams *tlsDataParams = NULL;
+    char portBuffer[6];
+    char info_buf[256];
+    int64_t handshake_start_us;
+    TLSHandshakePhases phases;
+    size_t heap_baseline;
+    size_t heap_low;
+    size_t free_heap_after;
+
+    if(NULL == pNetwork) {
+        return NULL_VALUE_ERROR;
+    }
+
+    if(NULL != params) {
+        _iot_tls_set_connect_params(pNetwork, params->pRootCALocation, params->pDeviceCertLocation,
+                                    params->pDevicePrivateKeyLocation, params->pDestinationURL,
+                                    params->DestinationPort, params->timeout_ms, params->ServerVerificationFlag);
+    }
+
+    tlsDataParams = &(pNetwork->tlsDataParams);
+
+    _iot_tls_open_wakeup_socket(tlsDataParams);
+    mbedtls_net_init(&(tlsDataParams->server_fd));
+    mbedtls_ssl_init(&(tlsDataParams->ssl));
+    tlsDataParams->read_timeout_ms = pNetwork->tlsConnectParams.timeout_ms;
+
+    if((ret = _iot_tls_acquire_credentials(pNetwork)) != SUCCESS) {
+        return (IoT_Error_t) ret;
+    }
+
+    snprintf(portBuffer, 6, "%d", pNetwork->tlsConnectParams.DestinationPort);
+    ESP_LOGD(TAG, "Connecting to %s/%s...", pNetwork->tlsConnectParams.pDestinationURL, portBuffer);
+    if((ret = _iot_tls_net_connect(pNetwork, portBuffer)) != 0) {
+        ESP_LOGE(TAG, "failed! connect returned -0x%x", -ret);
+        switch(ret) {
+            case MBEDTLS_ERR_NET_SOCKET_FAILED:
+                return NETWORK_ERR_NET_SOCKET_FAILED;
+            case MBEDTLS_ERR_NET_UNKNOWN_HOST:
+                return NETWORK_ERR_NET_UNKNOWN_HOST;
+            case MBEDTLS_ERR_NET_CONNECT_FAILED:
+            default:
+                return NETWORK_ERR_NET_CONNECT_FAILED;
+        };
+    }
+
+    ret = mbedtls_net_set_block(&(tlsDataParams->server_fd));
+    if(ret != 0) {
+        ESP_LOGE(TAG, "failed! net_set_(non)block() returned -0x%x", -ret);
+        return SSL_CONNECTION_ERROR;
+    } ESP_LOGD(TAG, "ok");
+
+    ESP_LOGD(TAG, "Setting up the SSL/TLS structure...");
+    heap_baseline = heap_caps_get_free_size(IOT_TLS_HEAP_CAPS);
+    heap_low = heap_baseline;
+    if((ret = mbedtls_ssl_setup(&(tlsDataParams->ssl), &(tlsDataParams->credentials->conf))) != 0) {
         ESP_LOGE(TAG, "failed! mbedtls_ssl_setup returned -0x%x", -ret);
         return SSL_CONNECTION_ERROR;
     }
@@ -307,22 +932,55 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
         ESP_LOGE(TAG, "failed! mbedtls_ssl_set_hostname returned %d", ret);
         return SSL_CONNECTION_ERROR;
     }
+
+#ifdef CONFIG_AWS_IOT_TLS_SESSION_RESUMPTION
+    tlsDataParams->is_session_resumed = false;
+    if(tlsDataParams->has_saved_session) {
+        if((ret = mbedtls_ssl_set_session(&(tlsDataParams->ssl), &(tlsDataParams->saved_session))) == 0) {
+            ESP_LOGD(TAG, "Offering cached TLS session");
+            tlsDataParams->is_session_resumed = true;
+        } else {
+            ESP_LOGW(TAG, "mbedtls_ssl_set_session returned -0x%x, dropping cached session", -ret);
+            _iot_tls_forget_session(pNetwork);
+        }
+    }
+#endif
     ESP_LOGD(TAG, "SSL state connect : %d ", tlsDataParams->ssl.state);
-    mbedtls_ssl_set_bio(&(tlsDataParams->ssl), &(tlsDataParams->server_fd), mbedtls_net_send, NULL,
-                        mbedtls_net_recv_timeout);
+    mbedtls_ssl_set_bio(&(tlsDataParams->ssl), tlsDataParams, _iot_tls_net_send, NULL, _iot_tls_net_recv_timeout);
     ESP_LOGD(TAG, "ok");
 
     ESP_LOGD(TAG, "SSL state connect : %d ", tlsDataParams->ssl.state);
     ESP_LOGD(TAG, "Performing the SSL/TLS handshake...");
-    while((ret = mbedtls_ssl_handshake(&(tlsDataParams->ssl))) != 0) {
+    memset(&phases, 0, sizeof(phases));
+    handshake_start_us = esp_timer_get_time();
+    while((ret = _iot_tls_handshake(tlsDataParams, &phases, &heap_low)) != 0) {
         if(ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
             ESP_LOGE(TAG, "failed! mbedtls_ssl_handshake returned -0x%x", -ret);
             if(ret == MBEDTLS_ERR_X509_CERT_VERIFY_FAILED) {
                 ESP_LOGE(TAG, "    Unable to verify the server's certificate. ");
             }
+#ifdef CONFIG_AWS_IOT_TLS_SESSION_RESUMPTION
+            /* Don't offer a session the server may have choked on again */
+            _iot_tls_forget_session(pNetwork);
+#endif
             return SSL_CONNECTION_ERROR;
         }
     }
+    pNetwork->connectTiming.tlsHandshakeMs = _iot_tls_elapsed_ms(handshake_start_us);
+
+    tlsDataParams->metrics.lastHandshake = phases;
+    tlsDataParams->metrics.handshakes++;
+    tlsDataParams->metrics.handshakeHeapPeak = (uint32_t) (heap_baseline - heap_low);
+    free_heap_after = heap_caps_get_free_size(IOT_TLS_HEAP_CAPS);
+    tlsDataParams->metrics.connectionHeap = (uint32_t) (heap_baseline > free_heap_after ? heap_baseline - free_heap_after : 0);
+#ifdef CONFIG_AWS_IOT_TLS_SESSION_RESUMPTION
+    if(tlsDataParams->is_session_resumed) {
+        tlsDataParams->metrics.resumedHandshakes++;
+    }
+#endif
+    ESP_LOGD(TAG, "Handshake phases: hello %u ms, server cert %u ms, key exchange %u ms, client auth %u ms, finished %u ms",
+             (unsigned) phases.helloMs, (unsigned) phases.serverCertificateMs, (unsigned) phases.keyExchangeMs,
+             (unsigned) phases.clientAuthMs, (unsigned) phases.finishedMs);
 
     ESP_LOGD(TAG, "ok    [ Protocol is %s ]    [ Ciphersuite is %s ]", mbedtls_ssl_get_version(&(tlsDataParams->ssl)),
           mbedtls_ssl_get_ciphersuite(&(tlsDataParams->ssl)));
@@ -349,6 +1007,14 @@ IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
         ret = SUCCESS;
     }
 
+#ifdef CONFIG_AWS_IOT_TLS_SESSION_RESUMPTION
+    if(ret == SUCCESS) {
+        ESP_LOGI(TAG, "TLS handshake %s in %u ms", tlsDataParams->is_session_resumed ? "resumed session" : "done",
+                 (unsigned) pNetwork->connectTiming.tlsHandshakeMs);
+        _iot_tls_save_session(pNetwork);
+    }
+#endif
+
     if(LOG_LOCAL_LEVEL >= ESP_LOG_DEBUG) {
         if (mbedtls_ssl_get_peer_cert(&(tlsDataParams->ssl)) != NULL) {
             ESP_LOGD(TAG, "Peer certificate information:");
@@ -393,15 +1059,21 @@ IoT_Error_t iot_tls_write(Network *pNetwork, unsigned char *pMsg, size_t len, Ti
 			init_timer(&writeTimer);
 			countdown_ms(&writeTimer, IOT_SSL_WRITE_RETRY_TIMEOUT_MS);
 
+			/* mbedtls_ssl_write sends at most one record per call */
+			pNetwork->tlsDataParams.metrics.recordsOut++;
+			pNetwork->tlsDataParams.metrics.bytesOut += ret;
+
 			txLen += ret;
 			pMsg += ret;
 			len -= ret;
 		} else if(ret == MBEDTLS_ERR_SSL_WANT_READ ||
 				ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
 			if(has_timer_expired(&writeTimer)) {
+				pNetwork->tlsDataParams.metrics.writeTimeouts++;
 				*written_len = txLen;
 				return NETWORK_SSL_WRITE_TIMEOUT_ERROR;
 			}
+			pNetwork->tlsDataParams.metrics.writeRetries++;
 		} else {
 			ESP_LOGE(TAG, " failed\n  ! mbedtls_ssl_write returned -0x%x", (unsigned int) -ret);
 			/* All other negative return values indicate connection needs to be reset.
@@ -414,16 +1086,101 @@ IoT_Error_t iot_tls_write(Network *pNetwork, unsigned char *pMsg, size_t len, Ti
 	return SUCCESS;
 }
 
+IoT_Error_t iot_tls_wait_for_readable(Network *pNetwork, uint32_t timeout_ms) {
+#ifdef CONFIG_AWS_IOT_MQTT_EVENT_DRIVEN_YIELD
+    TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
+    int sock_fd = tlsDataParams->server_fd.fd;
+    int wakeup_fd = tlsDataParams->wakeup_fd;
+    struct timeval tv;
+    fd_set read_fds;
+    char drain[8];
+    int ret;
+
+    /* Records already decrypted by mbedTLS won't show up on the socket */
+    if(mbedtls_ssl_get_bytes_avail(&(tlsDataParams->ssl)) > 0) {
+        return SUCCESS;
+    }
+
+    if(sock_fd < 0) {
+        return NETWORK_SSL_READ_ERROR;
+    }
+
+    FD_ZERO(&read_fds);
+    FD_SET(sock_fd, &read_fds);
+    if(wakeup_fd >= 0) {
+        FD_SET(wakeup_fd, &read_fds);
+    }
+
+    tv.tv_sec = timeout_ms / 1000;
+    tv.tv_usec = (timeout_ms % 1000) * 1000;
+
+    ret = select(MAX(sock_fd, wakeup_fd) + 1, &read_fds, NULL, NULL, &tv);
+    if(ret < 0) {
+        if(errno == EINTR) {
+            return NETWORK_SSL_NOTHING_TO_READ;
+        }
+        ESP_LOGE(TAG, "select() on TLS socket failed, errno %d", errno);
+        return NETWORK_SSL_READ_ERROR;
+    }
+
+    if(ret == 0) {
+        return NETWORK_SSL_NOTHING_TO_READ;
+    }
+
+    if(wakeup_fd >= 0 && FD_ISSET(wakeup_fd, &read_fds)) {
+        /* Consume every pending request so the next wait blocks again */
+        while(recv(wakeup_fd, drain, sizeof(drain), 0) > 0) {
+        }
+        if(!FD_ISSET(sock_fd, &read_fds)) {
+            return NETWORK_WAKEUP_REQUESTED;
+        }
+    }
+
+    return SUCCESS;
+#else
+    (void) pNetwork;
+    (void) timeout_ms;
+    return SUCCESS;
+#endif
+}
+
+IoT_Error_t iot_tls_wakeup(Network *pNetwork) {
+#ifdef CONFIG_AWS_IOT_MQTT_EVENT_DRIVEN_YIELD
+    const char signal = 1;
+    IoT_Error_t rc = SUCCESS;
+
+    if(NULL == pNetwork || NULL == s_wakeup_lock) {
+        return NULL_VALUE_ERROR;
+    }
+
+    /* The socket is not closed while the lock is held, see _iot_tls_close_wakeup_socket */
+    xSemaphoreTake(s_wakeup_lock, portMAX_DELAY);
+    if(pNetwork->tlsDataParams.wakeup_fd < 0) {
+        rc = FAILURE;
+    } else if(send(pNetwork->tlsDataParams.wakeup_fd, &signal, sizeof(signal), 0) < 0 &&
+              errno != EWOULDBLOCK && errno != EAGAIN && errno != ENOMEM) {
+        /* A full socket buffer means a wake-up is already pending */
+        rc = FAILURE;
+    }
+    xSemaphoreGive(s_wakeup_lock);
+
+    return rc;
+#else
+    (void) pNetwork;
+    return FAILURE;
+#endif
+}
+
 IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *timer, size_t *read_len) {
     TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
 	mbedtls_ssl_context *pSsl = &(pNetwork->tlsDataParams.ssl);
-    mbedtls_ssl_config *ssl_conf = &(tlsDataParams->conf);
     uint32_t read_timeout;
+    size_t buffered;
 
 	size_t rxLen = 0U;
 	int ret;
 
-    read_timeout = ssl_conf->read_timeout;
+    read_timeout = tlsDataParams->read_timeout_ms;
 
 	/* This timer checks for a timeout whenever MBEDTLS_ERR_SSL_WANT_READ,
 	 * MBEDTLS_ERR_SSL_WANT_WRITE, or MBEDTLS_ERR_SSL_TIMEOUT are returned by
@@ -440,11 +1197,13 @@ IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Tim
 	while(len > 0U) {
         /* Make sure we never block on read for longer than timer has left,
          but also that we don't block indefinitely (ie read_timeout > 0) */
-        mbedtls_ssl_conf_read_timeout(ssl_conf, MAX(1, MIN(read_timeout, left_ms(timer))));
+        tlsDataParams->read_timeout_ms = MAX(1, MIN(read_timeout, left_ms(timer)));
+        /* Nothing buffered means a successful read decrypts a new record */
+        buffered = mbedtls_ssl_get_bytes_avail(pSsl);
 		/* This read will timeout after IOT_SSL_READ_TIMEOUT_MS if there's no data to be read */
 		ret = mbedtls_ssl_read(pSsl, pMsg, len);
         /* Restore the old timeout */
-        mbedtls_ssl_conf_read_timeout(ssl_conf, read_timeout);
+        tlsDataParams->read_timeout_ms = read_timeout;
 
 		if(ret > 0) {
 			if((size_t) ret > len) {
@@ -456,6 +1215,11 @@ IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Tim
 			init_timer(&readTimer);
 			countdown_ms(&readTimer, IOT_SSL_READ_RETRY_TIMEOUT_MS);
 
+			if(buffered == 0U) {
+				tlsDataParams->metrics.recordsIn++;
+			}
+			tlsDataParams->metrics.bytesIn += ret;
+
 			rxLen += ret;
 			pMsg += ret;
 			len -= ret;
@@ -467,9 +1231,11 @@ IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Tim
 				if(rxLen == 0U) {
 					return NETWORK_SSL_NOTHING_TO_READ;
 				} else {
+					tlsDataParams->metrics.readTimeouts++;
 					return NETWORK_SSL_READ_TIMEOUT_ERROR;
 				}
 			}
+			tlsDataParams->metrics.readRetries++;
 		} else {
 			IOT_ERROR("Failed\n  ! mbedtls_ssl_read returned -0x%x\n\n", (unsigned int) -ret);
 			return NETWORK_SSL_READ_ERROR;
@@ -496,15 +1262,56 @@ IoT_Error_t iot_tls_disconnect(Network *pNetwork) {
 IoT_Error_t iot_tls_destroy(Network *pNetwork) {
     TLSDataParams *tlsDataParams = &(pNetwork->tlsDataParams);
 
-    mbedtls_net_free(&(tlsDataParams->server_fd));
+    /* The saved session is kept, the MQTT client destroys the connection on
+     * every disconnect and the next connect should be able to resume it */
 
-    mbedtls_x509_crt_free(&(tlsDataParams->clicert));
-    mbedtls_x509_crt_free(&(tlsDataParams->cacert));
-    mbedtls_pk_free(&(tlsDataParams->pkey));
+    mbedtls_net_free(&(tlsDataParams->server_fd));
     mbedtls_ssl_free(&(tlsDataParams->ssl));
-    mbedtls_ssl_config_free(&(tlsDataParams->conf));
-    mbedtls_ctr_drbg_free(&(tlsDataParams->ctr_drbg));
-    mbedtls_entropy_free(&(tlsDataParams->entropy));
+    _iot_tls_close_wakeup_socket(tlsDataParams);
+
+    /* The parsed credentials stay cached for the next connect */
+    _iot_tls_release_credentials(tlsDataParams);
+
+    return SUCCESS;
+}
+
+IoT_Error_t iot_tls_get_metrics(Network *pNetwork, TLSMetrics *pMetrics) {
+    if(NULL == pNetwork || NULL == pMetrics) {
+        return NULL_VALUE_ERROR;
+    }
 
+    *pMetrics = pNetwork->tlsDataParams.metrics;
     return SUCCESS;
 }
+
+IoT_Error_t iot_tls_reset_metrics(Network *pNetwork) {
+    if(NULL == pNetwork) {
+        return NULL_VALUE_ERROR;
+    }
+
+    memset(&(pNetwork->tlsDataParams.metrics), 0, sizeof(TLSMetrics));
+    return SUCCESS;
+}
+
+int iot_tls_metrics_to_json(const TLSMetrics *pMetrics, char *pBuf, size_t bufLen) {
+    const TLSHandshakePhases *phases = &(pMetrics->lastHandshake);
+
+    return snprintf(pBuf, bufLen,
+                    "{\"handshake\":{\"helloMs\":%u,\"serverCertificateMs\":%u,\"keyExchangeMs\":%u,"
+                    "\"clientAuthMs\":%u,\"finishedMs\":%u},"
+                    "\"handshakes\":%u,\"resumedHandshakes\":%u,"
+                    "\"bytesIn\":%u,\"bytesOut\":%u,\"recordsIn\":%u,\"recordsOut\":%u,"
+                    "\"socketBytesIn\":%u,\"socketBytesOut\":%u,\"readCalls\":%u,\"writeCalls\":%u,"
+                    "\"readRetries\":%u,\"writeRetries\":%u,\"readTimeouts\":%u,\"writeTimeouts\":%u,"
+                    "\"handshakeHeapPeak\":%u,\"connectionHeap\":%u}",
+                    (unsigned) phases->helloMs, (unsigned) phases->serverCertificateMs,
+                    (unsigned) phases->keyExchangeMs, (unsigned) phases->clientAuthMs, (unsigned) phases->finishedMs,
+                    (unsigned) pMetrics->handshakes, (unsigned) pMetrics->resumedHandshakes,
+                    (unsigned) pMetrics->bytesIn, (unsigned) pMetrics->bytesOut,
+                    (unsigned) pMetrics->recordsIn, (unsigned) pMetrics->recordsOut,
+                    (unsigned) pMetrics->socketBytesIn, (unsigned) pMetrics->socketBytesOut,
+                    (unsigned) pMetrics->readCalls, (unsigned) pMetrics->writeCalls,
+                    (unsigned) pMetrics->readRetries, (unsigned) pMetrics->writeRetries,
+                    (unsigned) pMetrics->readTimeouts, (unsigned) pMetrics->writeTimeouts,
+                    (unsigned) pMetrics->handshakeHeapPeak, (unsigned) pMetrics->connectionHeap);
+}
@@ -189,6 +189,71 @@ ATCA_STATUS calib_sleep(ATCADevice device)
     return status;
 }
 
+/** \brief Hold the device for the commands that follow, until the matching
+ *         calib_session_end(). Sessions nest.
+ *
+ * The calling task holds the device for the whole session, so commands of
+ * other tasks cannot interleave with a multi-command sequence such as
+ * nonce and sign.
+ *
+ * With ATCA_COMMAND_PIPELINING the device is also kept awake, saving the
+ * wake-up and idle around each command of a batch such as reading the
+ * certificates and signing during a TLS handshake.
+ *
+ *  \param[in] device     Device context pointer
+ *  \return ATCA_SUCCESS on success, otherwise an error code.
+ */
+ATCA_STATUS calib_session_begin(ATCADevice device)
+{
+    if (NULL == device)
+    {
+        return ATCA_TRACE(ATCA_BAD_PARAM, "NULL pointer encountered");
+    }
+    ATCA_STATUS status;
+
+    if ((status = hal_iface_lock(&device->mIface)) != ATCA_SUCCESS)
+    {
+        return status;
+    }
+#ifdef ATCA_COMMAND_PIPELINING
+    if (UINT8_MAX == device->awake_count)
+    {
+        hal_iface_unlock(&device->mIface);
+        return ATCA_TRACE(ATCA_INVALID_SIZE, "Too many nested sessions");
+    }
+    device->awake_count++;
+#endif
+    return ATCA_SUCCESS;
+}
+
+/** \brief End a session started with calib_session_begin(), idling the device
+ *         once the outermost session ends.
+ *  \param[in] device     Device context pointer
+ *  \return ATCA_SUCCESS on success, otherwise an error code.
+ */
+ATCA_STATUS calib_session_end(ATCADevice device)
+{
+    ATCA_STATUS status = ATCA_SUCCESS;
+
+    if (NULL == device)
+    {
+        return ATCA_TRACE(ATCA_BAD_PARAM, "NULL pointer encountered");
+    }
+#ifdef ATCA_COMMAND_PIPELINING
+    if (0u == device->awake_count)
+    {
+        return ATCA_TRACE(ATCA_GEN_FAIL, "No session to end");
+    }
+    if ((0u == --device->awake_count) && (ATCA_DEVICE_STATE_ACTIVE == device->device_state))
+    {
+        status = calib_idle(device);
+        device->device_state = ATCA_DEVICE_STATE_IDLE;
+    }
+#endif
+    hal_iface_unlock(&device->mIface);
+    return status;
+}
+
 /** \brief common cleanup code which idles the device after any operation
  *  \param[in] device     Device context pointer
  *  \return ATCA_SUCCESS on success, otherwise an error code.
@@ -72,6 +72,10 @@ ATCA_STATUS calib_execute_receive(ATCADevice device, uint8_t device_address, uin
 
 ATCA_STATUS calib_execute_command(ATCAPacket* packet, ATCADevice device);
 
+#ifdef ATCA_COMMAND_PIPELINING
+ATCA_STATUS calib_get_command_latency(ATCADevice device, uint8_t opcode, uint32_t* latency_us);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
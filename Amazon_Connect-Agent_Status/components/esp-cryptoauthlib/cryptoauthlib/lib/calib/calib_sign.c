@@ -114,6 +114,12 @@ ATCA_STATUS calib_sign(ATCADevice device, uint16_t key_id, const uint8_t *msg, u
     uint8_t nonce_target = NONCE_MODE_TARGET_TEMPKEY;
     uint8_t sign_source = SIGN_MODE_SOURCE_TEMPKEY;
 
+    // One wake-up for the random, nonce and sign commands
+    if ((status = calib_session_begin(device)) != ATCA_SUCCESS)
+    {
+        return status;
+    }
+
     do
     {
         // Make sure RNG has updated its seed
@@ -145,6 +151,8 @@ ATCA_STATUS calib_sign(ATCADevice device, uint16_t key_id, const uint8_t *msg, u
     }
     while (0);
 
+    (void)calib_session_end(device);
+
     return status;
 }
 
@@ -0,0 +1,278 @@
+/**
+ * \file
+ * \brief Software SHA-1 and SHA-256 routed through a table of backends.
+ */
+
+#include "cryptoauthlib.h"
+#include "atca_crypto_sw_backend.h"
+#include "atca_crypto_sw_sha1.h"
+#include "atca_crypto_sw_sha2.h"
+
+#ifdef ATCA_CRYPTO_SW_BACKENDS
+
+#include "hashes/sha1_routines.h"
+#include "hashes/sha2_routines.h"
+
+#ifdef ATCA_MBEDTLS
+#include "mbedtls/sha1.h"
+#include "mbedtls/sha256.h"
+#endif
+
+/** \brief Backend used when none was selected */
+#ifndef ATCA_CRYPTO_SW_DEFAULT_BACKEND
+#ifdef ATCA_MBEDTLS
+#define ATCA_CRYPTO_SW_DEFAULT_BACKEND  atcac_sw_backend_mbedtls
+#else
+#define ATCA_CRYPTO_SW_DEFAULT_BACKEND  atcac_sw_backend_portable
+#endif
+#endif
+
+#define ATCAC_SW_STATE_SIZE     sizeof(((atcac_sw_hash_ctx*)0)->state)
+
+static const atcac_sw_backend_t* g_atcac_sw_backend = &ATCA_CRYPTO_SW_DEFAULT_BACKEND;
+
+static int atcac_sw_portable_sha1_init(void* state)
+{
+    if (sizeof(CL_HashContext) > ATCAC_SW_STATE_SIZE)
+    {
+        return ATCA_ASSERT_FAILURE;
+    }
+    CL_hashInit((CL_HashContext*)state);
+    return ATCA_SUCCESS;
+}
+
+static int atcac_sw_portable_sha1_update(void* state, const uint8_t* data, size_t data_size)
+{
+    CL_hashUpdate((CL_HashContext*)state, data, (int)data_size);
+    return ATCA_SUCCESS;
+}
+
+static int atcac_sw_portable_sha1_finish(void* state, uint8_t digest[ATCA_SHA1_DIGEST_SIZE])
+{
+    CL_hashFinal((CL_HashContext*)state, digest);
+    return ATCA_SUCCESS;
+}
+
+static int atcac_sw_portable_sha2_256_init(void* state)
+{
+    if (sizeof(sw_sha256_ctx) > ATCAC_SW_STATE_SIZE)
+    {
+        return ATCA_ASSERT_FAILURE;
+    }
+    sw_sha256_init((sw_sha256_ctx*)state);
+    return ATCA_SUCCESS;
+}
+
+static int atcac_sw_portable_sha2_256_update(void* state, const uint8_t* data, size_t data_size)
+{
+    sw_sha256_update((sw_sha256_ctx*)state, data, (uint32_t)data_size);
+    return ATCA_SUCCESS;
+}
+
+static int atcac_sw_portable_sha2_256_finish(void* state, uint8_t digest[ATCA_SHA2_256_DIGEST_SIZE])
+{
+    sw_sha256_final((sw_sha256_ctx*)state, digest);
+    return ATCA_SUCCESS;
+}
+
+/** \brief Portable C routines from crypto/hashes */
+const atcac_sw_backend_t atcac_sw_backend_portable =
+{
+    "portable",
+    atcac_sw_portable_sha1_init,
+    atcac_sw_portable_sha1_update,
+    atcac_sw_portable_sha1_finish,
+    atcac_sw_portable_sha2_256_init,
+    atcac_sw_portable_sha2_256_update,
+    atcac_sw_portable_sha2_256_finish
+};
+
+#ifdef ATCA_MBEDTLS
+/* The SHA modules are used directly rather than through mbedtls_md, which
+   allocates a context on every setup. */
+
+static int atcac_sw_mbedtls_sha1_init(void* state)
+{
+    if (sizeof(mbedtls_sha1_context) > ATCAC_SW_STATE_SIZE)
+    {
+        return ATCA_ASSERT_FAILURE;
+    }
+    mbedtls_sha1_init((mbedtls_sha1_context*)state);
+    if (mbedtls_sha1_starts_ret((mbedtls_sha1_context*)state))
+    {
+        mbedtls_sha1_free((mbedtls_sha1_context*)state);
+        return ATCA_FUNC_FAIL;
+    }
+    return ATCA_SUCCESS;
+}
+
+static int atcac_sw_mbedtls_sha1_update(void* state, const uint8_t* data, size_t data_size)
+{
+    return mbedtls_sha1_update_ret((mbedtls_sha1_context*)state, data, data_size) ? ATCA_FUNC_FAIL : ATCA_SUCCESS;
+}
+
+static int atcac_sw_mbedtls_sha1_finish(void* state, uint8_t digest[ATCA_SHA1_DIGEST_SIZE])
+{
+    int ret = mbedtls_sha1_finish_ret((mbedtls_sha1_context*)state, digest);
+
+    /* Also releases the hash accelerator when the context held it */
+    mbedtls_sha1_free((mbedtls_sha1_context*)state);
+    return ret ? ATCA_FUNC_FAIL : ATCA_SUCCESS;
+}
+
+static int atcac_sw_mbedtls_sha2_256_init(void* state)
+{
+    if (sizeof(mbedtls_sha256_context) > ATCAC_SW_STATE_SIZE)
+    {
+        return ATCA_ASSERT_FAILURE;
+    }
+    mbedtls_sha256_init((mbedtls_sha256_context*)state);
+    if (mbedtls_sha256_starts_ret((mbedtls_sha256_context*)state, 0))
+    {
+        mbedtls_sha256_free((mbedtls_sha256_context*)state);
+        return ATCA_FUNC_FAIL;
+    }
+    return ATCA_SUCCESS;
+}
+
+static int atcac_sw_mbedtls_sha2_256_update(void* state, const uint8_t* data, size_t data_size)
+{
+    return mbedtls_sha256_update_ret((mbedtls_sha256_context*)state, data, data_size) ? ATCA_FUNC_FAIL : ATCA_SUCCESS;
+}
+
+static int atcac_sw_mbedtls_sha2_256_finish(void* state, uint8_t digest[ATCA_SHA2_256_DIGEST_SIZE])
+{
+    int ret = mbedtls_sha256_finish_ret((mbedtls_sha256_context*)state, digest);
+
+    mbedtls_sha256_free((mbedtls_sha256_context*)state);
+    return ret ? ATCA_FUNC_FAIL : ATCA_SUCCESS;
+}
+
+/** \brief mbedTLS SHA modules, hardware accelerated when the port's mbedTLS is */
+const atcac_sw_backend_t atcac_sw_backend_mbedtls =
+{
+    "mbedtls",
+    atcac_sw_mbedtls_sha1_init,
+    atcac_sw_mbedtls_sha1_update,
+    atcac_sw_mbedtls_sha1_finish,
+    atcac_sw_mbedtls_sha2_256_init,
+    atcac_sw_mbedtls_sha2_256_update,
+    atcac_sw_mbedtls_sha2_256_finish
+};
+#endif /* ATCA_MBEDTLS */
+
+const atcac_sw_backend_t* const atcac_sw_backends[] =
+{
+#ifdef ATCA_MBEDTLS
+    &atcac_sw_backend_mbedtls,
+#endif
+    &atcac_sw_backend_portable,
+    NULL
+};
+
+ATCA_STATUS atcac_sw_backend_set(const atcac_sw_backend_t* backend)
+{
+    g_atcac_sw_backend = backend ? backend : &ATCA_CRYPTO_SW_DEFAULT_BACKEND;
+    return ATCA_SUCCESS;
+}
+
+const atcac_sw_backend_t* atcac_sw_backend_get(void)
+{
+    return g_atcac_sw_backend;
+}
+
+/** \brief Initialize context for performing SHA1 hash in software.
+ * \param[in] ctx  Hash context
+ * \return ATCA_SUCCESS on success, otherwise an error code.
+ */
+int atcac_sw_sha1_init(atcac_sha1_ctx* ctx)
+{
+    if (!ctx)
+    {
+        return ATCA_BAD_PARAM;
+    }
+    ctx->backend = g_atcac_sw_backend;
+    return ctx->backend->sha1_init(ctx->state);
+}
+
+/** \brief Add arbitrary data to a SHA1 hash.
+ * \param[in] ctx        Hash context
+ * \param[in] data       Data to be added to the hash
+ * \param[in] data_size  Data size in bytes
+ * \return ATCA_SUCCESS on success, otherwise an error code.
+ */
+int atcac_sw_sha1_update(atcac_sha1_ctx* ctx, const uint8_t* data, size_t data_size)
+{
+    if (!ctx || !ctx->backend)
+    {
+        return ATCA_BAD_PARAM;
+    }
+    return ctx->backend->sha1_update(ctx->state, data, data_size);
+}
+
+/** \brief Complete the SHA1 hash in software and return the digest.
+ * \param[in]  ctx     Hash context
+ * \param[out] digest  Digest is returned here (20 bytes)
+ * \return ATCA_SUCCESS on success, otherwise an error code.
+ */
+int atcac_sw_sha1_finish(atcac_sha1_ctx* ctx, uint8_t digest[ATCA_SHA1_DIGEST_SIZE])
+{
+    int ret;
+
+    if (!ctx || !ctx->backend)
+    {
+        return ATCA_BAD_PARAM;
+    }
+    ret = ctx->backend->sha1_finish(ctx->state, digest);
+    ctx->backend = NULL;
+    return ret;
+}
+
+/** \brief Initialize context for performing SHA256 hash in software.
+ * \param[in] ctx  Hash context
+ * \return ATCA_SUCCESS on success, otherwise an error code.
+ */
+int atcac_sw_sha2_256_init(atcac_sha2_256_ctx* ctx)
+{
+    if (!ctx)
+    {
+        return ATCA_BAD_PARAM;
+    }
+    ctx->backend = g_atcac_sw_backend;
+    return ctx->backend->sha2_256_init(ctx->state);
+}
+
+/** \brief Add data to a SHA256 hash.
+ * \param[in] ctx        Hash context
+ * \param[in] data       Data to be added to the hash
+ * \param[in] data_size  Data size in bytes
+ * \return ATCA_SUCCESS on success, otherwise an error code.
+ */
+int atcac_sw_sha2_256_update(atcac_sha2_256_ctx* ctx, const uint8_t* data, size_t data_size)
+{
+    if (!ctx || !ctx->backend)
+    {
+        return ATCA_BAD_PARAM;
+    }
+    return ctx->backend->sha2_256_update(ctx->state, data, data_size);
+}
+
+/** \brief Complete the SHA256 hash in software and return the digest.
+ * \param[in]  ctx     Hash context
+ * \param[out] digest  Digest is returned here (32 bytes)
+ * \return ATCA_SUCCESS on success, otherwise an error code.
+ */
+int atcac_sw_sha2_256_finish(atcac_sha2_256_ctx* ctx, uint8_t digest[ATCA_SHA2_256_DIGEST_SIZE])
+{
+    int ret;
+
+    if (!ctx || !ctx->backend)
+    {
+        return ATCA_BAD_PARAM;
+    }
+    ret = ctx->backend->sha2_256_finish(ctx->state, digest);
+    ctx->backend = NULL;
+    return ret;
+}
+
+#endif /* ATCA_CRYPTO_SW_BACKENDS */
@@ -42,9 +42,76 @@
 #include "cryptoauthlib.h"
 #include "atca_basic.h"
 #include "atca_mbedtls_wrap.h"
+#include <stddef.h>
 #include <string.h>
 
-#ifdef MBEDTLS_ECDH_GEN_PUBLIC_ALT
+#if defined(MBEDTLS_ECDH_GEN_PUBLIC_ALT) && defined(MBEDTLS_ECDH_COMPUTE_SHARED_ALT)
+
+/* A private key held by the device is passed around as its key id in d. A
+   software private key is never that short, which is how compute_shared tells
+   the two apart. Keys fall back to software when the curve is not P-256, the
+   device is disabled or cannot return the shared secret. */
+#define ATCA_MBEDTLS_ECDH_KEY_ID_BITS   16
+
+#define ATCA_MBEDTLS_ECDH_OUT_UNKNOWN   0
+#define ATCA_MBEDTLS_ECDH_OUT_CLEAR     1
+#define ATCA_MBEDTLS_ECDH_OUT_ENCRYPTED 2
+#define ATCA_MBEDTLS_ECDH_OUT_NONE      3
+
+static bool g_atca_mbedtls_ecdh_enabled = true;
+static int g_atca_mbedtls_ecdh_output = ATCA_MBEDTLS_ECDH_OUT_UNKNOWN;
+
+/* Every exchange uses the same slot, so it holds the key of one exchange from
+   gen_public to compute_shared. Others started meanwhile use software keys
+   instead of overwriting it. Set inside a device session. An exchange dropped
+   between the two calls leaves it set, and later exchanges use software. */
+static bool g_atca_mbedtls_ecdh_slot_busy = false;
+
+/** \brief Route ECDH through the device (default) or keep it in software,
+ *         e.g. to compare the two. Applies to keys generated afterwards.
+ */
+void atca_mbedtls_ecdh_enable(bool enable)
+{
+    g_atca_mbedtls_ecdh_enabled = enable;
+}
+
+/** \brief How the device may return an ECDH shared secret. The ATECC608
+ *         ChipOptions can require it to be encrypted with the IO protection
+ *         key or forbid returning it at all.
+ */
+static int atca_mbedtls_ecdh_output(void)
+{
+    if (ATCA_MBEDTLS_ECDH_OUT_UNKNOWN == g_atca_mbedtls_ecdh_output)
+    {
+        if (ATECC608 == atcab_get_device_type())
+        {
+            uint16_t chip_options;
+
+            if (ATCA_SUCCESS == atcab_read_bytes_zone(ATCA_ZONE_CONFIG, 0, offsetof(atecc608_config_t, ChipOptions),
+                                                      (uint8_t*)&chip_options, sizeof(chip_options)))
+            {
+                switch ((chip_options & ATCA_CHIP_OPT_ECDH_PROT_MASK) >> ATCA_CHIP_OPT_ECDH_PROT_SHIFT)
+                {
+                case 0:
+                    g_atca_mbedtls_ecdh_output = ATCA_MBEDTLS_ECDH_OUT_CLEAR;
+                    break;
+                case 1:
+                    g_atca_mbedtls_ecdh_output = ATCA_MBEDTLS_ECDH_OUT_ENCRYPTED;
+                    break;
+                default:
+                    g_atca_mbedtls_ecdh_output = ATCA_MBEDTLS_ECDH_OUT_NONE;
+                    break;
+                }
+            }
+        }
+        else
+        {
+            g_atca_mbedtls_ecdh_output = ATCA_MBEDTLS_ECDH_OUT_CLEAR;
+        }
+    }
+    return g_atca_mbedtls_ecdh_output;
+}
+
 /** Generate ECDH keypair */
 int mbedtls_ecdh_gen_public(mbedtls_ecp_group *grp, mbedtls_mpi *d, mbedtls_ecp_point *Q,
                             int (*f_rng)(void *, unsigned char *, size_t),
@@ -53,28 +120,46 @@ int mbedtls_ecdh_gen_public(mbedtls_ecp_group *grp, mbedtls_mpi *d, mbedtls_ecp_
     int ret = 0;
     uint8_t public_key[ATCA_PUB_KEY_SIZE];
     uint8_t temp = 1;
-    uint16_t slotid = atca_mbedtls_ecdh_slot_cb();
+    uint16_t slotid;
 
     if (!grp || !d || !Q)
     {
-        ret = MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+        return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
     }
 
-    if (grp->id != MBEDTLS_ECP_DP_SECP256R1)
+    if (grp->id != MBEDTLS_ECP_DP_SECP256R1 || !g_atca_mbedtls_ecdh_enabled ||
+        (ATCA_MBEDTLS_ECDH_OUT_CLEAR != atca_mbedtls_ecdh_output() &&
+         ATCA_MBEDTLS_ECDH_OUT_ENCRYPTED != atca_mbedtls_ecdh_output()))
     {
-        ret = MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE;
+        return mbedtls_ecp_gen_keypair(grp, d, Q, f_rng, p_rng);
     }
 
-    if (!ret)
+    slotid = (uint16_t)atca_mbedtls_ecdh_slot_cb();
+
+    ret = atcab_session_begin();
+    if (ATCA_SUCCESS == ret)
     {
-        ret = mbedtls_mpi_lset(d, slotid);
+        if (g_atca_mbedtls_ecdh_slot_busy)
+        {
+            ret = ATCA_FUNC_FAIL;
+        }
+        else
+        {
+            ret = atcab_genkey(slotid, public_key);
+            g_atca_mbedtls_ecdh_slot_busy = (ATCA_SUCCESS == ret);
+        }
+        (void)atcab_session_end();
     }
 
-    if (!ret)
+    if (ATCA_SUCCESS != ret)
     {
-        ret = atcab_genkey(slotid, public_key);
+        /* Slot in use by another exchange, device busy or gone - an ephemeral
+           key works just as well in software */
+        return mbedtls_ecp_gen_keypair(grp, d, Q, f_rng, p_rng);
     }
 
+    ret = mbedtls_mpi_lset(d, slotid);
+
     if (!ret)
     {
         ret = mbedtls_mpi_read_binary(&(Q->X), public_key, ATCA_PUB_KEY_SIZE / 2);
@@ -92,9 +177,42 @@ int mbedtls_ecdh_gen_public(mbedtls_ecp_group *grp, mbedtls_mpi *d, mbedtls_ecp_
 
     return ret;
 }
-#endif /* MBEDTLS_ECDH_GEN_PUBLIC_ALT */
 
-#ifdef MBEDTLS_ECDH_COMPUTE_SHARED_ALT
+/** \brief ECDH of the key in a slot, or in TempKey for ids above 15, with the
+ *         output encryption the device requires
+ */
+static int atca_mbedtls_ecdh_device(uint16_t slotid, const uint8_t *public_key, uint8_t *shared_key)
+{
+    int ret;
+    uint8_t secret[ATCA_KEY_SIZE];
+
+    if (ATCA_MBEDTLS_ECDH_OUT_ENCRYPTED == atca_mbedtls_ecdh_output())
+    {
+        ret = atca_mbedtls_ecdh_ioprot_cb(secret);
+        if (!ret)
+        {
+            if (slotid > 15)
+            {
+                ret = atcab_ecdh_tempkey_ioenc(public_key, shared_key, secret);
+            }
+            else
+            {
+                ret = atcab_ecdh_ioenc(slotid, public_key, shared_key, secret);
+            }
+        }
+        mbedtls_platform_zeroize(secret, ATCA_KEY_SIZE);
+    }
+    else if (slotid > 15)
+    {
+        ret = atcab_ecdh_tempkey(public_key, shared_key);
+    }
+    else
+    {
+        ret = atcab_ecdh(slotid, public_key, shared_key);
+    }
+    return ret;
+}
+
 /*
  * Compute shared secret (SEC1 3.3.1)
  */
@@ -108,51 +226,55 @@ int mbedtls_ecdh_compute_shared(mbedtls_ecp_group *grp, mbedtls_mpi *z,
     uint8_t public_key[ATCA_PUB_KEY_SIZE];
     uint8_t shared_key[ATCA_KEY_SIZE];
     uint16_t slotid;
-    uint8_t secret[ATCA_KEY_SIZE];
+    ATCA_STATUS status;
 
     if (!grp || !z || !Q || !d)
     {
-        ret = MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+        return MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
     }
 
-    if (grp->id != MBEDTLS_ECP_DP_SECP256R1)
+    if (grp->id != MBEDTLS_ECP_DP_SECP256R1 || mbedtls_mpi_bitlen(d) > ATCA_MBEDTLS_ECDH_KEY_ID_BITS)
     {
-        ret = MBEDTLS_ERR_ECP_FEATURE_UNAVAILABLE;
-    }
+        /* Software key */
+        mbedtls_ecp_point P;
 
-    if (!ret)
-    {
-        ret = mbedtls_mpi_write_binary(&(Q->X), public_key, ATCA_PUB_KEY_SIZE / 2);
+        mbedtls_ecp_point_init(&P);
+
+        ret = mbedtls_ecp_mul(grp, &P, d, Q, f_rng, p_rng);
+
+        if (!ret && mbedtls_ecp_is_zero(&P))
+        {
+            ret = MBEDTLS_ERR_ECP_BAD_INPUT_DATA;
+        }
+
+        if (!ret)
+        {
+            ret = mbedtls_mpi_copy(z, &P.X);
+        }
+
+        mbedtls_ecp_point_free(&P);
+        return ret;
     }
 
+    ret = mbedtls_mpi_write_binary(&(Q->X), public_key, ATCA_PUB_KEY_SIZE / 2);
+
     if (!ret)
     {
         ret = mbedtls_mpi_write_binary(&(Q->Y), &public_key[ATCA_PUB_KEY_SIZE / 2], ATCA_PUB_KEY_SIZE / 2);
     }
 
+    slotid = (uint16_t)(d->p[0]);
+    status = atcab_session_begin();
     if (!ret)
     {
-        slotid = *(uint16_t*)d->p;
-        if (ATECC608 == atcab_get_device_type())
-        {
-            ret = atca_mbedtls_ecdh_ioprot_cb(secret);
-            if (!ret)
-            {
-                if (slotid > 15)
-                {
-                    ret = atcab_ecdh_tempkey_ioenc(public_key, shared_key, secret);
-                }
-                else
-                {
-                    ret = atcab_ecdh_ioenc(slotid, public_key, shared_key, secret);
-                }
-            }
-            mbedtls_platform_zeroize(secret, ATCA_KEY_SIZE);
-        }
-        else
-        {
-            ret = atcab_ecdh(slotid, public_key, shared_key);
-        }
+        ret = (ATCA_SUCCESS == status) ? atca_mbedtls_ecdh_device(slotid, public_key, shared_key)
+              : (int)status;
+    }
+    /* Given back whatever the outcome, the key in the slot is not used again */
+    g_atca_mbedtls_ecdh_slot_busy = false;
+    if (ATCA_SUCCESS == status)
+    {
+        (void)atcab_session_end();
     }
 
     if (!ret)
@@ -160,8 +282,10 @@ int mbedtls_ecdh_compute_shared(mbedtls_ecp_group *grp, mbedtls_mpi *z,
         ret = mbedtls_mpi_read_binary(z, shared_key, ATCA_KEY_SIZE);
     }
 
+    mbedtls_platform_zeroize(shared_key, ATCA_KEY_SIZE);
+
     return ret;
 }
-#endif /* MBEDTLS_ECDH_COMPUTE_SHARED_ALT */
+#endif /* MBEDTLS_ECDH_GEN_PUBLIC_ALT && MBEDTLS_ECDH_COMPUTE_SHARED_ALT */
 
 #endif /* MBEDTLS_ECDH_C */
@@ -277,6 +277,7 @@ ATCA_STATUS atcac_aes_gcm_decrypt_finish(
     return status;
 }
 
+#ifndef ATCA_CRYPTO_SW_BACKENDS
 /** \brief MBedTLS Message Digest Abstraction - Init
  *
  *  \return ATCA_SUCCESS on success, otherwise an error code.
@@ -409,6 +410,7 @@ int atcac_sw_sha2_256_finish(
 {
     return _atca_mbedtls_md_finish(ctx, digest, NULL);
 }
+#endif /* ATCA_CRYPTO_SW_BACKENDS */
 
 /** \brief Initialize context for performing CMAC in software.
  *
@@ -1161,6 +1163,9 @@ int atca_mbedtls_cert_add(mbedtls_x509_crt * cert, const atcacert_def_t * cert_d
     size_t cert_len;
     uint8_t * cert_buf = NULL;
 
+    /* The public key and certificate reads share one wake-up */
+    (void)atcab_session_begin();
+
     if (cert_def->ca_cert_def)
     {
         const atcacert_device_loc_t * ca_key_cfg = &cert_def->ca_cert_def->public_key_dev_loc;
@@ -1186,6 +1191,8 @@ int atca_mbedtls_cert_add(mbedtls_x509_crt * cert, const atcacert_def_t * cert_d
         ret = atcacert_read_cert(cert_def, cert_def->ca_cert_def ? ca_key : NULL, cert_buf, &cert_len);
     }
 
+    (void)atcab_session_end();
+
     if (0 == ret)
     {
         ret = mbedtls_x509_crt_parse(cert, (const unsigned char*)cert_buf, cert_len);
@@ -39,77 +39,125 @@
  * \defgroup pkcs11 Find (pkcs11_find_)
    @{ */
 
-//#ifdef ATCA_NO_HEAP
-static CK_BYTE pkcs11_find_template_cache[PKCS11_SEARCH_CACHE_SIZE];
-//#endif
+#ifndef PKCS11_FIND_CACHE_ENTRIES
+#define PKCS11_FIND_CACHE_ENTRIES       4
+#endif
+
+#ifndef PKCS11_FIND_CACHE_KEY_SIZE
+#define PKCS11_FIND_CACHE_KEY_SIZE      64
+#endif
+
+/** Result of an earlier search. Applications look up the same few objects
+   (by class and label) over and over, and matching a template calls the
+   attribute functions of every object. */
+typedef struct _pkcs11_find_cache_entry
+{
+    CK_BBOOL         valid;
+    CK_ULONG         generation;
+    CK_ULONG         last_used;
+    CK_ULONG         key_len;
+    CK_BYTE          key[PKCS11_FIND_CACHE_KEY_SIZE];
+    CK_ULONG         count;
+    CK_OBJECT_HANDLE handles[PKCS11_MAX_OBJECTS_ALLOWED];
+} pkcs11_find_cache_entry;
+
+static pkcs11_find_cache_entry pkcs11_find_cache[PKCS11_FIND_CACHE_ENTRIES];
+static CK_ULONG pkcs11_find_cache_clock;
 
 /**
- * \brief Copy an array of CK_ATTRIBUTE structures
+ * \brief Build the cache key of a template. Only templates made of attributes
+ * that are fixed once an object is set up can be cached - anything that reads
+ * the device (key values, CKA_ID) is matched every time.
  */
-static CK_RV pkcs11_find_copy_template(CK_BYTE_PTR pBuffer, CK_ULONG ulBufSize, CK_ATTRIBUTE_PTR pTemplate, const CK_ULONG ulCount)
+static CK_BBOOL pkcs11_find_cache_key(CK_BYTE_PTR pKey, CK_ULONG_PTR pulKeyLen, const CK_ATTRIBUTE_PTR pTemplate, CK_ULONG ulCount)
 {
-    CK_ULONG bytes_required;
-    CK_ATTRIBUTE_PTR pCopy;
+    CK_ULONG len = 0;
     CK_ULONG i;
 
-    if (!pBuffer || !ulBufSize || !pTemplate || !ulCount)
+    for (i = 0; i < ulCount; i++)
     {
-        return CKR_ARGUMENTS_BAD;
-    }
+        CK_ULONG value_len = pTemplate[i].pValue ? pTemplate[i].ulValueLen : 0;
 
-    /* Start with the amount of memory required to hold the Array */
-    bytes_required = sizeof(CK_ATTRIBUTE) * ulCount;
+        switch (pTemplate[i].type)
+        {
+        case CKA_CLASS:
+        case CKA_LABEL:
+        case CKA_KEY_TYPE:
+        case CKA_CERTIFICATE_TYPE:
+            break;
+        default:
+            return FALSE;
+        }
 
-    /* Check the template pValue requirements */
-    for (i = 0; i < ulCount; i++)
-    {
-        if (pTemplate[i].pValue && pTemplate[i].ulValueLen)
+        if (value_len > PKCS11_FIND_CACHE_KEY_SIZE ||
+            len + sizeof(pTemplate[i].type) + sizeof(value_len) + value_len > PKCS11_FIND_CACHE_KEY_SIZE)
         {
-            bytes_required += pTemplate[i].ulValueLen;
+            return FALSE;
+        }
 
-            /* Check for overflow */
-            if (bytes_required < pTemplate[i].ulValueLen)
-            {
-                return CKR_HOST_MEMORY;
-            }
+        memcpy(&pKey[len], &pTemplate[i].type, sizeof(pTemplate[i].type));
+        len += sizeof(pTemplate[i].type);
+        memcpy(&pKey[len], &value_len, sizeof(value_len));
+        len += sizeof(value_len);
+        if (value_len)
+        {
+            memcpy(&pKey[len], pTemplate[i].pValue, value_len);
+            len += value_len;
         }
     }
 
-    if (ulBufSize < bytes_required)
-    {
-        return CKR_HOST_MEMORY;
-    }
+    *pulKeyLen = len;
+    return TRUE;
+}
 
-    /* Good to copy */
-    bytes_required = sizeof(CK_ATTRIBUTE) * ulCount;
+static pkcs11_find_cache_entry * pkcs11_find_cache_lookup(const CK_BYTE_PTR pKey, CK_ULONG ulKeyLen)
+{
+    CK_ULONG generation = pkcs11_object_get_generation();
+    CK_ULONG i;
+
+    for (i = 0; i < PKCS11_FIND_CACHE_ENTRIES; i++)
+    {
+        pkcs11_find_cache_entry * pEntry = &pkcs11_find_cache[i];
 
-    /* Set up the Copied Template */
-    pCopy = (CK_ATTRIBUTE_PTR)pBuffer;
+        if (pEntry->valid && pEntry->generation == generation && pEntry->key_len == ulKeyLen &&
+            !memcmp(pEntry->key, pKey, ulKeyLen))
+        {
+            pEntry->last_used = ++pkcs11_find_cache_clock;
+            return pEntry;
+        }
+    }
+    return NULL_PTR;
+}
 
-    /* Move to the data section */
-    pBuffer += bytes_required;
+static void pkcs11_find_cache_store(const CK_BYTE_PTR pKey, CK_ULONG ulKeyLen, CK_ULONG generation,
+                                    const CK_OBJECT_HANDLE_PTR phObjects, CK_ULONG ulCount)
+{
+    pkcs11_find_cache_entry * pVictim = &pkcs11_find_cache[0];
+    CK_ULONG i;
 
-    /* Copy the template */
-    for (i = 0; i < ulCount; i++)
+    /* Reuse an empty or outdated entry, otherwise the least recently used one */
+    for (i = 0; i < PKCS11_FIND_CACHE_ENTRIES; i++)
     {
-        pCopy[i].type = pTemplate[i].type;
+        pkcs11_find_cache_entry * pEntry = &pkcs11_find_cache[i];
 
-        /* Sanity check the input to see if we need to allocate any memory for this */
-        if (pTemplate[i].pValue && pTemplate[i].ulValueLen)
+        if (!pEntry->valid || pEntry->generation != generation)
         {
-            pCopy[i].pValue = pBuffer;
-            pCopy[i].ulValueLen = pTemplate[i].ulValueLen;
-            pBuffer += pTemplate[i].ulValueLen;
-            memcpy(pCopy[i].pValue, pTemplate[i].pValue, pTemplate[i].ulValueLen);
+            pVictim = pEntry;
+            break;
         }
-        else
+        if (pEntry->last_used < pVictim->last_used)
         {
-            pCopy[i].pValue = NULL_PTR;
-            pCopy[i].ulValueLen = 0;
+            pVictim = pEntry;
         }
     }
 
-    return CKR_OK;
+    pVictim->valid = TRUE;
+    pVictim->generation = generation;
+    pVictim->last_used = ++pkcs11_find_cache_clock;
+    pVictim->key_len = ulKeyLen;
+    memcpy(pVictim->key, pKey, ulKeyLen);
+    pVictim->count = ulCount;
+    memcpy(pVictim->handles, phObjects, ulCount * sizeof(CK_OBJECT_HANDLE));
 }
 
 static pkcs11_attrib_model_ptr pkcs11_find_attrib(const pkcs11_attrib_model_ptr pAttributeList, const CK_ULONG ulCount, const CK_ATTRIBUTE_PTR pTemplate)
@@ -248,11 +296,16 @@ static CK_OBJECT_HANDLE pkcs11_find_handle(const CK_ATTRIBUTE_PTR pTemplate, CK_
 
 CK_RV pkcs11_find_init(CK_SESSION_HANDLE hSession, CK_ATTRIBUTE_PTR pTemplate, CK_ULONG ulCount)
 {
+    pkcs11_lib_ctx_ptr pLibCtx;
     pkcs11_session_ctx_ptr pSession;
+    pkcs11_find_cache_entry * pEntry = NULL_PTR;
+    CK_BYTE key[PKCS11_FIND_CACHE_KEY_SIZE];
+    CK_ULONG key_len = 0;
+    CK_BBOOL cacheable;
     CK_ULONG index = 0;
     CK_RV rv;
 
-    rv = pkcs11_init_check(NULL, FALSE);
+    rv = pkcs11_init_check(&pLibCtx, FALSE);
     if (rv)
     {
         return rv;
@@ -275,31 +328,51 @@ CK_RV pkcs11_find_init(CK_SESSION_HANDLE hSession, CK_ATTRIBUTE_PTR pTemplate, C
         get private unless we're using a shared key system - and that will only be
         for secured data and not key info */
 
-    if (pkcs11_find_handle(pTemplate, ulCount, &index))
+    /* Matching may call into the device and the cache is shared by all sessions */
+    if (pLibCtx->lock_mutex)
     {
-        if (ulCount)
+        if (CKR_OK != (rv = pkcs11_lock_context(pLibCtx)))
         {
-            rv = pkcs11_find_copy_template(pkcs11_find_template_cache, PKCS11_SEARCH_CACHE_SIZE, pTemplate, ulCount);
-            if (rv)
-            {
-                return rv;
-            }
-            pSession->attrib_list = (CK_ATTRIBUTE_PTR)pkcs11_find_template_cache;
+            return rv;
         }
-        else
+    }
+
+    cacheable = pkcs11_find_cache_key(key, &key_len, pTemplate, ulCount);
+    if (cacheable)
+    {
+        pEntry = pkcs11_find_cache_lookup(key, key_len);
+    }
+
+    if (pEntry)
+    {
+        memcpy(pSession->find_handles, pEntry->handles, pEntry->count * sizeof(CK_OBJECT_HANDLE));
+        pSession->object_count = pEntry->count;
+    }
+    else
+    {
+        CK_ULONG generation = pkcs11_object_get_generation();
+        CK_OBJECT_HANDLE hObject;
+
+        /* Collect every match now so continuing the search does not have to
+           match the template again */
+        pSession->object_count = 0;
+        while (NULL_PTR != (hObject = pkcs11_find_handle(pTemplate, ulCount, &index)))
         {
-            pSession->attrib_list = NULL_PTR;
+            pSession->find_handles[pSession->object_count++] = hObject;
+            index++;
         }
-        pSession->attrib_count = ulCount;
-        pSession->object_index = index;
-        pSession->object_count = 1;
-        index++;
-        while (pkcs11_find_handle(pSession->attrib_list, ulCount, &index))
+
+        if (cacheable)
         {
-            pSession->object_count++;
-            index++;
+            pkcs11_find_cache_store(key, key_len, generation, pSession->find_handles, pSession->object_count);
         }
     }
+    pSession->object_index = 0;
+
+    if (pLibCtx->lock_mutex)
+    {
+        (void)pkcs11_unlock_context(pLibCtx);
+    }
 
     return CKR_OK;
 }
@@ -307,7 +380,7 @@ CK_RV pkcs11_find_init(CK_SESSION_HANDLE hSession, CK_ATTRIBUTE_PTR pTemplate, C
 CK_RV pkcs11_find_continue(CK_SESSION_HANDLE hSession, CK_OBJECT_HANDLE_PTR phObject, CK_ULONG ulMaxObjectCount, CK_ULONG_PTR pulObjectCount)
 {
     pkcs11_session_ctx_ptr pSession;
-    CK_ULONG i;
+    CK_ULONG count = 0;
     CK_RV rv;
 
     rv = pkcs11_init_check(NULL, FALSE);
@@ -327,26 +400,19 @@ CK_RV pkcs11_find_continue(CK_SESSION_HANDLE hSession, CK_OBJECT_HANDLE_PTR phOb
         return rv;
     }
 
-    *pulObjectCount = (pSession->object_count < ulMaxObjectCount) ? pSession->object_count : ulMaxObjectCount;
-
-    for (i = 0; i < *pulObjectCount; i++)
+    while (count < ulMaxObjectCount && pSession->object_index < pSession->object_count)
     {
-        phObject[i] = pkcs11_find_handle(pSession->attrib_list, pSession->attrib_count, &pSession->object_index);
-        if (!phObject[i])
-        {
-            pSession->object_count = 0;
-            *pulObjectCount = i;
-            break;
-        }
-
-        pSession->object_index++;
+        CK_OBJECT_HANDLE hObject = pSession->find_handles[pSession->object_index++];
 
-        if (pSession->object_count)
+        /* Skip objects destroyed since the search started */
+        if (CKR_OK == pkcs11_object_check(NULL_PTR, hObject))
         {
-            pSession->object_count--;
+            phObject[count++] = hObject;
         }
     }
 
+    *pulObjectCount = count;
+
     return CKR_OK;
 }
 
@@ -367,8 +433,7 @@ CK_RV pkcs11_find_finish(CK_SESSION_HANDLE hSession)
         return rv;
     }
 
-    pSession->attrib_list = NULL_PTR;
-    pSession->attrib_count = 0;
+    pSession->object_index = 0;
     pSession->object_count = 0;
 
     return CKR_OK;
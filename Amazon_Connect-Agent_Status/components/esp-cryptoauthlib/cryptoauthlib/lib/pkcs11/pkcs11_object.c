@@ -49,6 +49,26 @@ static pkcs11_object pkcs11_object_store[PKCS11_MAX_OBJECTS_ALLOWED];
 
 pkcs11_object_cache_t pkcs11_object_cache[PKCS11_MAX_OBJECTS_ALLOWED];
 
+/** Changes whenever an object is added, set up or removed - lets pkcs11_find
+   tell whether a cached search result is still current */
+static volatile CK_ULONG pkcs11_object_generation;
+
+/**
+ * \brief Record that the set of objects or their identifying attributes changed
+ */
+void pkcs11_object_touch(void)
+{
+    pkcs11_object_generation++;
+}
+
+/**
+ * \brief Current object generation, see pkcs11_object_touch
+ */
+CK_ULONG pkcs11_object_get_generation(void)
+{
+    return pkcs11_object_generation;
+}
+
 /** For object handle tracking */
 static CK_OBJECT_HANDLE pkcs11_object_alloc_handle(void)
 {
@@ -145,6 +165,7 @@ CK_RV pkcs11_object_alloc(pkcs11_object_ptr * ppObject)
                 memset(*ppObject, 0, sizeof(pkcs11_object));
                 pkcs11_object_cache[i].handle = pkcs11_object_alloc_handle();
                 pkcs11_object_cache[i].object = *ppObject;
+                pkcs11_object_touch();
             }
             else
             {
@@ -174,6 +195,7 @@ CK_RV pkcs11_object_free(pkcs11_object_ptr pObject)
             /* Delink it */
             pkcs11_object_cache[i].object = NULL_PTR;
             pkcs11_object_cache[i].handle = 0;
+            pkcs11_object_touch();
         }
     }
 
@@ -511,6 +533,7 @@ CK_RV pkcs11_object_create
         }
         if (CKR_OK == rv)
         {
+            pkcs11_object_touch();
             rv = pkcs11_object_get_handle(pObject, phObject);
         }
         else
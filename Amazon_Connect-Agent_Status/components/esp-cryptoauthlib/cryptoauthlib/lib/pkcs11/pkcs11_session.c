@@ -184,6 +184,7 @@ CK_RV pkcs11_session_open(
     pkcs11_lib_ctx_ptr lib_ctx = pkcs11_get_context();
     pkcs11_slot_ctx_ptr slot_ctx;
     pkcs11_session_ctx_ptr session_ctx;
+    CK_RV rv;
 
     ((void)notify);
     ((void)pApplication);
@@ -223,26 +224,40 @@ CK_RV pkcs11_session_open(
     //    return CKR_TOKEN_WRITE_PROTECTED;
     //}
 
+    /* Sessions may be opened from several threads at once - claim the
+       session context under the library lock */
+    if (lib_ctx->lock_mutex)
+    {
+        if (CKR_OK != (rv = pkcs11_lock_context(lib_ctx)))
+        {
+            return rv;
+        }
+    }
+
     /* Get a new session context */
     session_ctx = pkcs11_allocate_session_context();
 
-    /* Check that a session was created */
-    if (!session_ctx)
+    if (session_ctx)
     {
-        return CKR_HOST_MEMORY;
-    }
+        /* Initialize the session */
+        (void)pkcs11_util_memset(session_ctx, sizeof(pkcs11_session_ctx), 0, sizeof(pkcs11_session_ctx));
+        session_ctx->slot = slot_ctx;
+        session_ctx->initialized = TRUE;
+        session_ctx->active_mech = CKM_VENDOR_DEFINED;
 
-    /* Initialize the session */
-    session_ctx->slot = slot_ctx;
-    session_ctx->initialized = TRUE;
-    session_ctx->active_mech = CKM_VENDOR_DEFINED;
+        /* Assign the session handle */
+        session_ctx->handle = (CK_SESSION_HANDLE)session_ctx;
 
-    /* Assign the session handle */
-    session_ctx->handle = (CK_SESSION_HANDLE)session_ctx;
+        *phSession = session_ctx->handle;
+    }
 
-    *phSession = session_ctx->handle;
+    if (lib_ctx->lock_mutex)
+    {
+        (void)pkcs11_unlock_context(lib_ctx);
+    }
 
-    return CKR_OK;
+    /* Check that a session was created */
+    return session_ctx ? CKR_OK : CKR_HOST_MEMORY;
 }
 
 CK_RV pkcs11_session_close(CK_SESSION_HANDLE hSession)
@@ -280,8 +295,22 @@ CK_RV pkcs11_session_close(CK_SESSION_HANDLE hSession)
     }
 
     /* Free the session */
+    if (lib_ctx->lock_mutex)
+    {
+        CK_RV rv = pkcs11_lock_context(lib_ctx);
+        if (CKR_OK != rv)
+        {
+            return rv;
+        }
+    }
+
     (void)pkcs11_session_free_session_context(session_ctx);
 
+    if (lib_ctx->lock_mutex)
+    {
+        (void)pkcs11_unlock_context(lib_ctx);
+    }
+
     return CKR_OK;
 }
 
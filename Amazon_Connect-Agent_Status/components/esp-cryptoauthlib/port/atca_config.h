@@ -3,6 +3,8 @@
 #ifndef ATCA_CONFIG_H
 #define ATCA_CONFIG_H
 
+#include "sdkconfig.h"
+
 /* Include HALS */
 #define ATCA_HAL_I2C
 #define ATCA_USE_RTOS_TIMER 1
@@ -25,6 +27,22 @@
 #define ATCA_POST_DELAY_MSEC 25
 #endif
 
+/* \brief Keep the device awake between the commands of a session
+ *         (calib_session_begin/calib_session_end) and size the wait before
+ *         polling for a response from measured per-opcode latencies.
+ */
+#ifdef CONFIG_ATCA_COMMAND_PIPELINING
+#define ATCA_COMMAND_PIPELINING
+#endif
+
+/* \brief Route the software SHA-1/SHA-256 routines through the backend table
+ *         in crypto/atca_crypto_sw_backend.h.
+ */
+#define ATCA_CRYPTO_SW_BACKENDS
+#ifdef CONFIG_ATCA_SW_HASH_PORTABLE
+#define ATCA_CRYPTO_SW_DEFAULT_BACKEND atcac_sw_backend_portable
+#endif
+
 #define ATCA_PLATFORM_MALLOC malloc
 #define ATCA_PLATFORM_FREE free
 
@@ -0,0 +1,46 @@
+/**
+ * \file
+ * \brief Throughput of the software crypto backends of cryptoauthlib.
+ *
+ * Hashes a buffer with SHA-1 and SHA-256 on every backend in
+ * atcac_sw_backends[] and runs AES-128-CMAC, which always goes through
+ * mbedTLS, over the same buffer. Results are logged in MB/s, e.g. to compare
+ * the ESP32 SHA accelerator with the portable routines.
+ */
+
+#ifndef ATCA_CRYPTO_BENCHMARK_H
+#define ATCA_CRYPTO_BENCHMARK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "atca_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \brief One measurement of atca_crypto_benchmark_run() */
+typedef struct
+{
+    const char *backend;        /**< Backend name */
+    const char *algorithm;      /**< "SHA-1", "SHA-256" or "AES-128-CMAC" */
+    uint32_t    kib_per_s;      /**< Throughput in KiB/s */
+} atca_crypto_benchmark_result_t;
+
+/** \brief Measure each backend and log the results.
+ *  \param[in]  buffer_size  Bytes hashed per iteration, 0 for 4096
+ *  \param[in]  iterations   Iterations per measurement, 0 for 64
+ *  \param[out] results      Receives the measurements, may be NULL
+ *  \param[in,out] count     In: entries in results. Out: measurements taken.
+ *                           May be NULL when results is NULL.
+ *  \return ATCA_SUCCESS on success, otherwise an error code.
+ */
+ATCA_STATUS atca_crypto_benchmark_run(size_t buffer_size, uint32_t iterations,
+                                      atca_crypto_benchmark_result_t *results, size_t *count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ATCA_CRYPTO_BENCHMARK_H */
@@ -0,0 +1,450 @@
+/**
+ * \file
+ * \brief Cache of the identity read from the secure element, see
+ *        atca_identity_cache.h
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+#include "cryptoauthlib.h"
+#include "atca_basic.h"
+#include "tng_atcacert_client.h"
+#include "atca_identity_cache.h"
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "mbedtls/md.h"
+#include "mbedtls/platform_util.h"
+#include "nvs.h"
+
+static const char *TAG = "atca_identity";
+
+#define IDENTITY_NVS_NAMESPACE  "atca_identity"
+#define IDENTITY_NVS_KEY        "identity"
+#define IDENTITY_MAGIC          0x41494443u     /* "AIDC" */
+#define IDENTITY_VERSION        1u
+#define IDENTITY_MAC_SIZE       32u
+
+/** \brief Header of the cached identity, followed by the device certificate,
+ *         the signer certificate and, in NVS, the MAC over all of it.
+ */
+typedef struct
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t device_cert_size;
+    uint16_t signer_cert_size;
+    uint8_t  serial[ATCA_SERIAL_NUM_SIZE];
+    uint8_t  reserved;
+} atca_identity_header_t;
+
+/* Public key for the ECDH that derives the MAC key. Its x coordinate is
+ * SHA-256("atca identity cache point" || 0x00), so nobody knows its discrete
+ * logarithm and the shared secret cannot be computed from the public key of
+ * the slot. */
+static const uint8_t s_kdf_public_key[ATCA_ECCP256_PUBKEY_SIZE] = {
+    0xF2, 0x72, 0x06, 0xDD, 0x02, 0x34, 0xC3, 0x01,
+    0x86, 0xC7, 0xB6, 0x4D, 0x4D, 0x5D, 0xFF, 0xAD,
+    0x9C, 0x84, 0x6C, 0x47, 0x53, 0xCA, 0xAE, 0x6F,
+    0x27, 0x49, 0x24, 0xB4, 0x27, 0x3F, 0x8B, 0x43,
+    0xC5, 0x7D, 0xD4, 0xBE, 0xDC, 0xFD, 0xDF, 0x59,
+    0xBB, 0xD8, 0xA3, 0x02, 0x77, 0xF9, 0xB1, 0x10,
+    0x39, 0x4B, 0x54, 0x22, 0x3C, 0xE8, 0xA0, 0x43,
+    0x3E, 0xA9, 0x25, 0xAC, 0x93, 0x46, 0x9D, 0x73
+};
+
+static const char s_kdf_label[] = "atca identity cache v1";
+
+static portMUX_TYPE s_lock_init_mux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t s_lock = NULL;
+
+/* Header and certificates of the identity, NULL until first loaded */
+static uint8_t *s_identity = NULL;
+
+static bool identity_lock(void)
+{
+    if (s_lock == NULL)
+    {
+        SemaphoreHandle_t lock = xSemaphoreCreateMutex();
+
+        if (lock == NULL)
+        {
+            return false;
+        }
+        /* Another task may have won the race while this one was created */
+        portENTER_CRITICAL(&s_lock_init_mux);
+        if (s_lock == NULL)
+        {
+            s_lock = lock;
+            lock = NULL;
+        }
+        portEXIT_CRITICAL(&s_lock_init_mux);
+        if (lock != NULL)
+        {
+            vSemaphoreDelete(lock);
+        }
+    }
+    return xSemaphoreTake(s_lock, portMAX_DELAY) == pdTRUE;
+}
+
+static void identity_unlock(void)
+{
+    xSemaphoreGive(s_lock);
+}
+
+static size_t identity_size(const atca_identity_header_t *header)
+{
+    return sizeof(*header) + header->device_cert_size + header->signer_cert_size;
+}
+
+#ifdef CONFIG_ATCA_IDENTITY_CACHE
+/** \brief Derive the MAC key: HMAC-SHA256 keyed with the ECDH shared secret of
+ *         the configured slot and s_kdf_public_key.
+ */
+static ATCA_STATUS identity_derive_key(uint8_t *key)
+{
+    uint8_t pms[ATCA_KEY_SIZE];
+    ATCA_STATUS status;
+
+    status = atcab_ecdh(CONFIG_ATCA_IDENTITY_CACHE_KEY_SLOT, s_kdf_public_key, pms);
+    if (status != ATCA_SUCCESS)
+    {
+        ESP_LOGW(TAG, "ECDH with slot %d failed (%02x), identity not cached in NVS",
+                 CONFIG_ATCA_IDENTITY_CACHE_KEY_SLOT, status);
+        return status;
+    }
+
+    if (mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), pms, sizeof(pms),
+                        (const uint8_t *)s_kdf_label, sizeof(s_kdf_label) - 1, key) != 0)
+    {
+        status = ATCA_GEN_FAIL;
+    }
+    mbedtls_platform_zeroize(pms, sizeof(pms));
+    return status;
+}
+
+static ATCA_STATUS identity_mac(const uint8_t *key, const uint8_t *data, size_t size, uint8_t *mac)
+{
+    if (mbedtls_md_hmac(mbedtls_md_info_from_type(MBEDTLS_MD_SHA256), key, IDENTITY_MAC_SIZE,
+                        data, size, mac) != 0)
+    {
+        return ATCA_GEN_FAIL;
+    }
+    return ATCA_SUCCESS;
+}
+
+/** \brief Constant time comparison, the MAC must not leak through timing */
+static bool identity_mac_equal(const uint8_t *a, const uint8_t *b)
+{
+    uint8_t diff = 0;
+    size_t i;
+
+    for (i = 0; i < IDENTITY_MAC_SIZE; i++)
+    {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
+
+/** \brief Load and authenticate the NVS copy.
+ *  \return the identity, or NULL if there is no valid copy
+ */
+static uint8_t *identity_nvs_load(const uint8_t *key)
+{
+    nvs_handle_t handle;
+    size_t size = 0;
+    uint8_t *blob = NULL;
+    uint8_t mac[IDENTITY_MAC_SIZE];
+    const atca_identity_header_t *header;
+
+    if (nvs_open(IDENTITY_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK)
+    {
+        return NULL;
+    }
+
+    if (nvs_get_blob(handle, IDENTITY_NVS_KEY, NULL, &size) == ESP_OK &&
+        size > sizeof(atca_identity_header_t) + IDENTITY_MAC_SIZE &&
+        (blob = malloc(size)) != NULL &&
+        nvs_get_blob(handle, IDENTITY_NVS_KEY, blob, &size) == ESP_OK)
+    {
+        header = (const atca_identity_header_t *)blob;
+        if (header->magic != IDENTITY_MAGIC || header->version != IDENTITY_VERSION ||
+            identity_size(header) + IDENTITY_MAC_SIZE != size ||
+            identity_mac(key, blob, size - IDENTITY_MAC_SIZE, mac) != ATCA_SUCCESS ||
+            !identity_mac_equal(mac, blob + size - IDENTITY_MAC_SIZE))
+        {
+            ESP_LOGW(TAG, "Cached identity failed authentication, rebuilding it");
+            free(blob);
+            blob = NULL;
+        }
+    }
+    else
+    {
+        free(blob);
+        blob = NULL;
+    }
+
+    nvs_close(handle);
+    return blob;
+}
+
+static void identity_nvs_store(const uint8_t *key, const uint8_t *identity)
+{
+    size_t size = identity_size((const atca_identity_header_t *)identity);
+    uint8_t *blob;
+    nvs_handle_t handle;
+    esp_err_t err;
+
+    if ((blob = malloc(size + IDENTITY_MAC_SIZE)) == NULL)
+    {
+        return;
+    }
+    memcpy(blob, identity, size);
+
+    if (identity_mac(key, blob, size, blob + size) == ATCA_SUCCESS)
+    {
+        err = nvs_open(IDENTITY_NVS_NAMESPACE, NVS_READWRITE, &handle);
+        if (err == ESP_OK)
+        {
+            err = nvs_set_blob(handle, IDENTITY_NVS_KEY, blob, size + IDENTITY_MAC_SIZE);
+            if (err == ESP_OK)
+            {
+                err = nvs_commit(handle);
+            }
+            nvs_close(handle);
+        }
+        if (err != ESP_OK)
+        {
+            ESP_LOGW(TAG, "Failed to store the identity in NVS: %s", esp_err_to_name(err));
+        }
+    }
+    free(blob);
+}
+#endif /* CONFIG_ATCA_IDENTITY_CACHE */
+
+/** \brief Read the serial number and rebuild both certificates from the
+ *         secure element.
+ */
+static ATCA_STATUS identity_read(uint8_t **identity)
+{
+    atca_identity_header_t header = { 0 };
+    size_t max_signer_size = 0;
+    size_t max_device_size = 0;
+    size_t signer_size;
+    size_t device_size;
+    uint8_t *buf = NULL;
+    uint8_t *signer;
+    ATCA_STATUS status;
+
+    header.magic = IDENTITY_MAGIC;
+    header.version = IDENTITY_VERSION;
+
+    status = atcab_read_serial_number(header.serial);
+    if (status == ATCA_SUCCESS)
+    {
+        status = tng_atcacert_max_signer_cert_size(&max_signer_size);
+    }
+    if (status == ATCA_SUCCESS)
+    {
+        status = tng_atcacert_max_device_cert_size(&max_device_size);
+    }
+    if (status == ATCA_SUCCESS &&
+        (buf = malloc(sizeof(header) + max_device_size + max_signer_size)) == NULL)
+    {
+        status = ATCA_ALLOC_FAILURE;
+    }
+
+    /* The signer is read first as the device certificate is rebuilt from its
+       public key; it is moved behind the device certificate afterwards */
+    if (status == ATCA_SUCCESS)
+    {
+        signer = buf + sizeof(header) + max_device_size;
+        signer_size = max_signer_size;
+        status = tng_atcacert_read_signer_cert(signer, &signer_size);
+    }
+    if (status == ATCA_SUCCESS)
+    {
+        device_size = max_device_size;
+        status = tng_atcacert_read_device_cert(buf + sizeof(header), &device_size, signer);
+    }
+    if (status == ATCA_SUCCESS && (device_size > UINT16_MAX || signer_size > UINT16_MAX))
+    {
+        status = ATCA_INVALID_SIZE;
+    }
+
+    if (status != ATCA_SUCCESS)
+    {
+        free(buf);
+        return status;
+    }
+
+    memmove(buf + sizeof(header) + device_size, signer, signer_size);
+    header.device_cert_size = (uint16_t)device_size;
+    header.signer_cert_size = (uint16_t)signer_size;
+    memcpy(buf, &header, sizeof(header));
+    *identity = buf;
+    return ATCA_SUCCESS;
+}
+
+/** \brief Make s_identity available, from NVS when a valid copy exists,
+ *         otherwise from the secure element. Called with the lock held.
+ */
+static ATCA_STATUS identity_load(void)
+{
+    ATCA_STATUS status = ATCA_SUCCESS;
+    uint8_t *identity = NULL;
+#ifdef CONFIG_ATCA_IDENTITY_CACHE
+    uint8_t key[IDENTITY_MAC_SIZE];
+    bool have_key;
+#endif
+
+    if (s_identity != NULL)
+    {
+        return ATCA_SUCCESS;
+    }
+
+    /* The key derivation and any rebuild share one wake-up */
+    (void)atcab_session_begin();
+
+#ifdef CONFIG_ATCA_IDENTITY_CACHE
+    have_key = (identity_derive_key(key) == ATCA_SUCCESS);
+    if (have_key)
+    {
+        identity = identity_nvs_load(key);
+    }
+#endif
+
+    if (identity == NULL)
+    {
+        status = identity_read(&identity);
+#ifdef CONFIG_ATCA_IDENTITY_CACHE
+        if (status == ATCA_SUCCESS && have_key)
+        {
+            identity_nvs_store(key, identity);
+        }
+#endif
+    }
+    else
+    {
+        ESP_LOGD(TAG, "Using the cached identity");
+    }
+
+    (void)atcab_session_end();
+
+#ifdef CONFIG_ATCA_IDENTITY_CACHE
+    mbedtls_platform_zeroize(key, sizeof(key));
+#endif
+
+    if (status == ATCA_SUCCESS)
+    {
+        s_identity = identity;
+    }
+    return status;
+}
+
+ATCA_STATUS atca_identity_get_serial(uint8_t *serial)
+{
+    ATCA_STATUS status;
+
+    if (serial == NULL)
+    {
+        return ATCA_BAD_PARAM;
+    }
+    if (!identity_lock())
+    {
+        return ATCA_ALLOC_FAILURE;
+    }
+
+    status = identity_load();
+    if (status == ATCA_SUCCESS)
+    {
+        memcpy(serial, ((const atca_identity_header_t *)s_identity)->serial, ATCA_SERIAL_NUM_SIZE);
+    }
+
+    identity_unlock();
+    return status;
+}
+
+ATCA_STATUS atca_identity_get_device_cert(const uint8_t **cert, size_t *cert_size)
+{
+    ATCA_STATUS status;
+
+    if (cert == NULL || cert_size == NULL)
+    {
+        return ATCA_BAD_PARAM;
+    }
+    if (!identity_lock())
+    {
+        return ATCA_ALLOC_FAILURE;
+    }
+
+    status = identity_load();
+    if (status == ATCA_SUCCESS)
+    {
+        const atca_identity_header_t *header = (const atca_identity_header_t *)s_identity;
+
+        *cert = s_identity + sizeof(*header);
+        *cert_size = header->device_cert_size;
+    }
+
+    identity_unlock();
+    return status;
+}
+
+ATCA_STATUS atca_identity_get_signer_cert(const uint8_t **cert, size_t *cert_size)
+{
+    ATCA_STATUS status;
+
+    if (cert == NULL || cert_size == NULL)
+    {
+        return ATCA_BAD_PARAM;
+    }
+    if (!identity_lock())
+    {
+        return ATCA_ALLOC_FAILURE;
+    }
+
+    status = identity_load();
+    if (status == ATCA_SUCCESS)
+    {
+        const atca_identity_header_t *header = (const atca_identity_header_t *)s_identity;
+
+        *cert = s_identity + sizeof(*header) + header->device_cert_size;
+        *cert_size = header->signer_cert_size;
+    }
+
+    identity_unlock();
+    return status;
+}
+
+void atca_identity_cache_invalidate(void)
+{
+#ifdef CONFIG_ATCA_IDENTITY_CACHE
+    nvs_handle_t handle;
+#endif
+
+    if (!identity_lock())
+    {
+        return;
+    }
+
+    free(s_identity);
+    s_identity = NULL;
+
+#ifdef CONFIG_ATCA_IDENTITY_CACHE
+    if (nvs_open(IDENTITY_NVS_NAMESPACE, NVS_READWRITE, &handle) == ESP_OK)
+    {
+        if (nvs_erase_key(handle, IDENTITY_NVS_KEY) == ESP_OK)
+        {
+            (void)nvs_commit(handle);
+        }
+        nvs_close(handle);
+    }
+#endif
+
+    identity_unlock();
+}
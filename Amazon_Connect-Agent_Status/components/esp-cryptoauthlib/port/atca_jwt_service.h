@@ -0,0 +1,78 @@
+/**
+ * \file
+ * \brief ES256 JSON Web Tokens signed by the secure element, minted ahead of
+ *        time so callers never wait on a signature.
+ *
+ * The encoded header and the constant claims (iss, sub, aud and any extra
+ * members) are encoded and hashed once, when the service starts. Each token
+ * then only encodes and hashes its iat and exp claims before the signature.
+ * A background task mints the next token before the current one goes stale,
+ * so atca_jwt_service_get() returns a copy of a ready token. It only signs in
+ * the caller's context when no fresh token exists yet, e.g. right after
+ * start or after the clock jumped.
+ *
+ * The wall clock must be set (SNTP) before tokens can be minted.
+ */
+
+#ifndef ATCA_JWT_SERVICE_H
+#define ATCA_JWT_SERVICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "atca_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \brief Longest token the service builds, including the terminating null */
+#ifndef ATCA_JWT_SERVICE_MAX_TOKEN_LEN
+#define ATCA_JWT_SERVICE_MAX_TOKEN_LEN  512
+#endif
+
+#ifndef ATCA_JWT_SERVICE_TASK_STACK
+#define ATCA_JWT_SERVICE_TASK_STACK     3072
+#endif
+
+#ifndef ATCA_JWT_SERVICE_TASK_PRIORITY
+#define ATCA_JWT_SERVICE_TASK_PRIORITY  3
+#endif
+
+/** \brief Token service configuration. The strings are copied. */
+typedef struct
+{
+    uint16_t    key_id;             /**< Slot of the signing key */
+    const char *issuer;             /**< "iss" claim, NULL to omit */
+    const char *subject;            /**< "sub" claim, NULL to omit */
+    const char *audience;           /**< "aud" claim, NULL to omit */
+    const char *extra_claims;       /**< Further members as raw JSON, e.g. "\"scope\":\"upload\"", NULL to omit */
+    uint32_t    lifetime_s;         /**< Token lifetime, exp - iat */
+    uint32_t    refresh_margin_s;   /**< A token is no longer handed out this long before it expires,
+                                         and its successor is minted twice this long before */
+} atca_jwt_service_config_t;
+
+/** \brief Start the service and its minting task.
+ *  \return ATCA_SUCCESS on success, otherwise an error code.
+ */
+ATCA_STATUS atca_jwt_service_start(const atca_jwt_service_config_t *config);
+
+/** \brief Copy the current token.
+ *  \param[out] token       Receives the null terminated token
+ *  \param[in]  token_size  Size of the token buffer
+ *  \param[out] expires     exp claim of the token, may be NULL
+ *  \return ATCA_SUCCESS on success, ATCA_NOT_INITIALIZED when the service
+ *          is not running or the clock is not set yet, otherwise an error
+ *          code.
+ */
+ATCA_STATUS atca_jwt_service_get(char *token, size_t token_size, time_t *expires);
+
+/** \brief Stop the minting task and drop the tokens. */
+void atca_jwt_service_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ATCA_JWT_SERVICE_H */
@@ -0,0 +1,30 @@
+/**
+ * \file
+ * \brief Application callbacks of the mbedTLS ECDH ALT functions
+ *        (atca_mbedtls_ecdh.c) for this port.
+ */
+
+#include "sdkconfig.h"
+#include "cryptoauthlib.h"
+#include "mbedtls/bignum.h"
+#include "atca_mbedtls_wrap.h"
+
+#ifdef CONFIG_ATCA_MBEDTLS_ECDH
+
+/** \brief Slot that receives the ephemeral key of each exchange */
+int atca_mbedtls_ecdh_slot_cb(void)
+{
+    return CONFIG_ATCA_MBEDTLS_ECDH_SLOT;
+}
+
+/** \brief The IO protection key is provisioned per product, so there is no
+ *         default. An application whose devices require encrypted ECDH output
+ *         provides its own definition; without one those exchanges fail.
+ */
+__attribute__((weak)) int atca_mbedtls_ecdh_ioprot_cb(uint8_t secret[32])
+{
+    (void)secret;
+    return ATCA_FUNC_FAIL;
+}
+
+#endif /* CONFIG_ATCA_MBEDTLS_ECDH */
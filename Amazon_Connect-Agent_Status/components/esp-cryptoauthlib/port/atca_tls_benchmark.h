@@ -0,0 +1,61 @@
+/**
+ * \file
+ * \brief Cost of the public key steps of a TLS ECDHE-ECDSA client handshake
+ *        with and without the ATECC608.
+ *
+ * Each iteration generates the client ECDHE key, derives the shared secret
+ * with a P-256 peer, signs the CertificateVerify hash and verifies a server
+ * signature. Three modes are run where the build allows them: all in
+ * software (not with CONFIG_ATCA_MBEDTLS_ECDSA_SIGN, which routes every
+ * mbedTLS signature to the device), signing on the device, and signing plus
+ * ECDH on the device (CONFIG_ATCA_MBEDTLS_ECDH). Wall
+ * time is measured per step; CPU time of the calling task needs FreeRTOS run
+ * time stats (CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS) and shows how long the
+ * core stays free while the device works.
+ *
+ * Network round trips are not included; the TLS wrapper of esp-aws-iot
+ * records the phases of real handshakes.
+ */
+
+#ifndef ATCA_TLS_BENCHMARK_H
+#define ATCA_TLS_BENCHMARK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "atca_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \brief cpu_us when run time stats are not enabled */
+#define ATCA_TLS_BENCHMARK_CPU_UNKNOWN  UINT32_MAX
+
+/** \brief Averages per handshake of one mode */
+typedef struct
+{
+    const char *mode;           /**< "software", "hw-sign" or "hw-sign+ecdh" */
+    uint32_t    ecdhe_us;       /**< ECDHE key generation and shared secret */
+    uint32_t    sign_us;        /**< CertificateVerify signature */
+    uint32_t    verify_us;      /**< Server signature verification */
+    uint32_t    total_us;       /**< Sum of the steps */
+    uint32_t    cpu_us;         /**< CPU time of the task, ATCA_TLS_BENCHMARK_CPU_UNKNOWN if not measured */
+} atca_tls_benchmark_result_t;
+
+/** \brief Run every mode available in this build and log the results.
+ *  \param[in]  iterations  Handshakes per mode, 0 for 8
+ *  \param[in]  sign_slot   Slot of the device signing key, normally 0
+ *  \param[out] results     Receives one entry per mode, may be NULL
+ *  \param[in,out] count    In: entries in results. Out: modes run.
+ *                          May be NULL when results is NULL.
+ *  \return ATCA_SUCCESS on success, otherwise an error code.
+ */
+ATCA_STATUS atca_tls_benchmark_run(uint32_t iterations, uint16_t sign_slot,
+                                   atca_tls_benchmark_result_t *results, size_t *count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ATCA_TLS_BENCHMARK_H */
@@ -0,0 +1,115 @@
+/*
+ * AWS IoT Kit - Core2 for AWS IoT Kit
+ * Amazon Connect Agent Status
+ * shadow_reporter.h
+ *
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/*
+ * Reports the device's state to its shadow without flooding the service.
+ *
+ * The application changes the values behind its jsonStruct_t keys and calls
+ * shadow_reporter_notify(). The first notification opens a coalescing window,
+ * and when the window closes shadow_reporter_process() sends one update with
+ * only the keys whose value differs from the last reported state the service
+ * accepted. At most one update is in flight, and updates are at least the
+ * minimum interval apart. Rejected or timed out updates are retried the same
+ * way.
+ *
+ * All functions must be called from the task that yields the shadow client.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "aws_iot_shadow_interface.h"
+#include "timer_interface.h"
+
+#define SHADOW_REPORTER_MAX_KEYS 8
+#define SHADOW_REPORTER_MAX_VALUE_SIZE 32
+#define SHADOW_REPORTER_DOCUMENT_SIZE 512
+#define SHADOW_REPORTER_ACK_TIMEOUT_SEC 4
+
+typedef struct {
+    jsonStruct_t *pStruct;
+    uint8_t acked[SHADOW_REPORTER_MAX_VALUE_SIZE];   /* Value the service last accepted */
+    uint8_t sent[SHADOW_REPORTER_MAX_VALUE_SIZE];    /* Value of the update in flight */
+    bool isAcked;
+    bool isSent;
+} shadow_reporter_key_t;
+
+typedef struct {
+    AWS_IoT_Client *pClient;
+    const char *pThingName;
+    shadow_reporter_key_t keys[SHADOW_REPORTER_MAX_KEYS];
+    uint8_t keyCount;
+    uint32_t coalesceMs;
+    uint32_t minIntervalMs;
+    bool isDirty;
+    bool isInFlight;
+    Timer window;       /* Closes the coalescing window */
+    Timer interval;     /* Expires when the next update may be sent */
+    uint32_t notifyCount;
+    uint32_t updateCount;
+} shadow_reporter_t;
+
+/**
+ * @brief Set up a reporter for one thing's classic shadow.
+ *
+ * @param pReporter      Reporter to set up
+ * @param pClient        Client connected with aws_iot_shadow_connect
+ * @param pThingName     Thing to report to, must stay valid
+ * @param coalesceMs     Time from the first change to the update
+ * @param minIntervalMs  Minimum time between two updates
+ * @return NULL_VALUE_ERROR on missing arguments, SUCCESS otherwise
+ */
+IoT_Error_t shadow_reporter_init(shadow_reporter_t *pReporter, AWS_IoT_Client *pClient, const char *pThingName,
+                                 uint32_t coalesceMs, uint32_t minIntervalMs);
+
+/**
+ * @brief Add a key to the reported state.
+ *
+ * @param pReporter  Reporter
+ * @param pStruct    Key and value, must stay valid. The value may be at most
+ *                   SHADOW_REPORTER_MAX_VALUE_SIZE bytes.
+ * @return FAILURE when the reporter is full or the value too large, SUCCESS otherwise
+ */
+IoT_Error_t shadow_reporter_add_key(shadow_reporter_t *pReporter, jsonStruct_t *pStruct);
+
+/**
+ * @brief Tell the reporter that one or more values changed.
+ */
+void shadow_reporter_notify(shadow_reporter_t *pReporter);
+
+/**
+ * @brief Send the pending update when it is due. Call after every yield.
+ *
+ * @return SUCCESS when nothing was due or the update was published,
+ *         otherwise the error of building or publishing the update
+ */
+IoT_Error_t shadow_reporter_process(shadow_reporter_t *pReporter);
+
+/**
+ * @brief Whether a change waits to be reported or an update waits for its response.
+ */
+bool shadow_reporter_is_busy(const shadow_reporter_t *pReporter);
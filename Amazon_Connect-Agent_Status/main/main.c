@@ -9,7 +9,6 @@
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
 #include "esp_log.h"
-#include "cJSON.h"
 
 #include "aws_iot_config.h"
 #include "aws_iot_log.h"
@@ -21,6 +20,7 @@
 
 #include "wifi.h"
 #include "ui.h"
+#include "shadow_reporter.h"
 
 /* The time prefix used by the logger. */
 static const char *TAG = "MAIN";
@@ -29,7 +29,6 @@ static const char *TAG = "MAIN";
 #define OFFLINE "OFFLINE00"
 
 #define STARTING_STATUS OFFLINE
-#define MAX_LENGTH_OF_UPDATE_JSON_BUFFER 1024
 #define CLIENT_ID_LEN (ATCA_SERIAL_NUM_SIZE * 2)
 
 
@@ -39,7 +38,7 @@ extern const uint8_t aws_root_ca_pem_end[] asm("_binary_aws_root_ca_pem_end");
 
 /* Default MQTT HOST URL is pulled from the aws_iot_config.h */
 char HostAddress[255] = AWS_IOT_MQTT_HOST;
-char ledActuatorNameValue[9] = STARTING_STATUS; 
+char ledActuatorNameValue[sizeof(OFFLINE)] = STARTING_STATUS; 
 
 /* Default MQTT port is pulled from the aws_iot_config.h */
 uint32_t port = AWS_IOT_MQTT_PORT;
@@ -48,23 +47,7 @@ uint32_t port = AWS_IOT_MQTT_PORT;
 AWS_IoT_Client iotCoreClient;
 jsonStruct_t ledActuator;
 static char * client_id;
-static bool shadowUpdateInProgress;
-
-static void ShadowUpdateStatusCallback(const char *pThingName, 
-						ShadowActions_t action, Shadow_Ack_Status_t status, 
-						const char *pReceivedJsonDocument, void *pContextData) 
-{
-	
-    shadowUpdateInProgress = false;
-
-	if(SHADOW_ACK_TIMEOUT == status) {
-		ESP_LOGI(TAG,"Update Timeout");
-	} else if(SHADOW_ACK_REJECTED == status) {
-		ESP_LOGI(TAG,"Update Rejected");
-	} else if(SHADOW_ACK_ACCEPTED == status) {
-		ESP_LOGI(TAG,"Update Accepted");
-	}
-}
+static shadow_reporter_t reporter;
 
 static void ledActuatorClear()
 {	
@@ -109,57 +92,36 @@ static void ShadowGetStatusCallback(const char *pThingName,
 		
 		ESP_LOGI(TAG,"Update Accepted");
 
-		cJSON * root   = cJSON_Parse(pReceivedJsonDocument);
-		cJSON * state = cJSON_GetObjectItem(root,"state");
-		cJSON * desired = cJSON_GetObjectItem(state,"desired");
-		char * status = cJSON_GetObjectItem(desired,"Name")->valuestring;
-		
-		ledActuatorChangeColor(status);
-		memcpy(ledActuatorNameValue, status, 9);
+		/* Read the document the SDK already tokenized, without copying or parsing it again */
+		ShadowJsonView_t view;
+		char name[sizeof(ledActuatorNameValue)];
+		IoT_Error_t rc = aws_iot_shadow_json_view_init(pReceivedJsonDocument, &view);
+		if(SUCCESS == rc) {
+			rc = aws_iot_shadow_json_view_get_string(&view, "state.desired.Name", name, sizeof(name));
+		}
+		if(SUCCESS != rc) {
+			ESP_LOGW(TAG, "No desired Name in the shadow: %d", rc);
+			return;
+		}
+
+		ledActuatorChangeColor(name);
+		memcpy(ledActuatorNameValue, name, sizeof(name));
+		shadow_reporter_notify(&reporter);
 	}
 }
 
 static void ledActuator_Callback(const char *pJsonString, 
 						uint32_t JsonStringDataLen, jsonStruct_t *pContext) 
 {
-    shadowUpdateInProgress = true;
-	
 	char * status = (char *) (pContext->pData);
 	if(pContext != NULL) {
         ESP_LOGI(TAG, "Delta - led state changed to %s", status);
 	}
 	
 	ledActuatorChangeColor(status);
-	
-	char JsonDocumentBuffer[MAX_LENGTH_OF_UPDATE_JSON_BUFFER];
-	size_t sizeOfJsonDocumentBuffer = sizeof(JsonDocumentBuffer) / sizeof(JsonDocumentBuffer[0]);
 
-	IoT_Error_t rc = FAILURE;
-
-	rc = aws_iot_shadow_init_json_document(JsonDocumentBuffer, sizeOfJsonDocumentBuffer);
-	if(SUCCESS != rc) {
-		ESP_LOGI(TAG,"aws_iot_shadow_init_json_document Error");
-		abort();
-	}
-	rc = aws_iot_shadow_add_reported(JsonDocumentBuffer, sizeOfJsonDocumentBuffer, 1, &ledActuator);
-	if(SUCCESS != rc) {
-		ESP_LOGI(TAG,"aws_iot_shadow_add_reported Error");
-		abort();
-	}
-	rc = aws_iot_finalize_json_document(JsonDocumentBuffer, sizeOfJsonDocumentBuffer);
-	if(SUCCESS != rc) {
-		ESP_LOGI(TAG,"aws_iot_finalize_json_document Error");
-		abort();
-	}
-	
-	ESP_LOGI(TAG,"Update Shadow: %s", JsonDocumentBuffer);
-
-	rc = aws_iot_shadow_update(&iotCoreClient, client_id, JsonDocumentBuffer, ShadowUpdateStatusCallback, NULL, 4, true);
-	if(SUCCESS != rc) {
-		ESP_LOGI(TAG,"aws_iot_shadow_update Error");
-		abort();
-	}
-		
+	/* Reported from the task loop, together with changes that follow quickly */
+	shadow_reporter_notify(&reporter);
 }
 
 void iot_subscribe_callback_handler(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
@@ -205,7 +167,7 @@ void aws_iot_task(void *param) {
 
 	ledActuator.cb = ledActuator_Callback;
 	ledActuator.pData = &ledActuatorNameValue;
-    ledActuator.dataLength = strlen(ledActuatorNameValue)+1;
+    ledActuator.dataLength = sizeof(ledActuatorNameValue);
 	ledActuator.pKey = "Name";
 	ledActuator.type = SHADOW_JSON_STRING;
 
@@ -259,6 +221,16 @@ void aws_iot_task(void *param) {
         abort();
     }
 
+	rc = shadow_reporter_init(&reporter, &iotCoreClient, client_id,
+							  CONFIG_SHADOW_REPORTER_COALESCE_MS, CONFIG_SHADOW_REPORTER_MIN_INTERVAL_MS);
+	if(SUCCESS == rc) {
+		rc = shadow_reporter_add_key(&reporter, &ledActuator);
+	}
+	if(SUCCESS != rc) {
+		ESP_LOGE(TAG,"Shadow Reporter Init Error");
+		abort();
+	}
+
 	rc = aws_iot_shadow_register_delta(&iotCoreClient, &ledActuator);
 	if(SUCCESS != rc) {
 		ESP_LOGE(TAG,"Shadow Register Delta Error");
@@ -279,7 +251,11 @@ void aws_iot_task(void *param) {
         ESP_LOGI(TAG, "Stack remaining for task '%s' is %d bytes", pcTaskGetTaskName(NULL), uxTaskGetStackHighWaterMark(NULL));
 		
 		rc = aws_iot_shadow_yield(&iotCoreClient, 200);
-		if(NETWORK_ATTEMPTING_RECONNECT == rc || shadowUpdateInProgress) {
+		if(SUCCESS == rc) {
+			/* Errors are logged, the update is sent again later */
+			shadow_reporter_process(&reporter);
+		}
+		if(NETWORK_ATTEMPTING_RECONNECT == rc || shadow_reporter_is_busy(&reporter)) {
             rc = aws_iot_shadow_yield(&iotCoreClient, 100);
 			continue;
         }
@@ -0,0 +1,221 @@
+/*
+ * AWS IoT Kit - Core2 for AWS IoT Kit
+ * Amazon Connect Agent Status
+ * shadow_reporter.c
+ *
+ * Copyright (C) 2020 Amazon.com, Inc. or its affiliates.  All Rights Reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of
+ * this software and associated documentation files (the "Software"), to deal in
+ * the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of
+ * the Software, and to permit persons to whom the Software is furnished to do so,
+ * subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS
+ * FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR
+ * COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER
+ * IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "aws_iot_shadow_interface.h"
+#include "shadow_reporter.h"
+
+static const char *TAG = "REPORTER";
+
+/* Bytes of the value compared with the last reported one */
+static size_t shadow_reporter_value_size(const jsonStruct_t *pStruct) {
+    size_t len;
+
+    switch (pStruct->type) {
+        case SHADOW_JSON_INT32:
+        case SHADOW_JSON_UINT32:
+            return sizeof(int32_t);
+        case SHADOW_JSON_INT16:
+        case SHADOW_JSON_UINT16:
+            return sizeof(int16_t);
+        case SHADOW_JSON_INT8:
+        case SHADOW_JSON_UINT8:
+            return sizeof(int8_t);
+        case SHADOW_JSON_FLOAT:
+            return sizeof(float);
+        case SHADOW_JSON_DOUBLE:
+            return sizeof(double);
+        case SHADOW_JSON_BOOL:
+            return sizeof(bool);
+        case SHADOW_JSON_STRING:
+        case SHADOW_JSON_OBJECT:
+        default:
+            /* The terminating null makes a shorter string compare as different */
+            len = strnlen((const char *) pStruct->pData, pStruct->dataLength);
+            return len < pStruct->dataLength ? len + 1 : len;
+    }
+}
+
+static bool shadow_reporter_key_changed(const shadow_reporter_key_t *pKey) {
+    if (!pKey->isAcked) {
+        return true;
+    }
+    return memcmp(pKey->acked, pKey->pStruct->pData, shadow_reporter_value_size(pKey->pStruct)) != 0;
+}
+
+static void shadow_reporter_mark_dirty(shadow_reporter_t *pReporter) {
+    if (!pReporter->isDirty) {
+        /* Later changes within the window go out with this one */
+        pReporter->isDirty = true;
+        countdown_ms(&pReporter->window, pReporter->coalesceMs);
+    }
+}
+
+static void shadow_reporter_update_callback(const char *pThingName, ShadowActions_t action,
+                                            Shadow_Ack_Status_t status, const char *pReceivedJsonDocument,
+                                            void *pContextData) {
+    shadow_reporter_t *pReporter = (shadow_reporter_t *) pContextData;
+    uint8_t i;
+
+    pReporter->isInFlight = false;
+
+    for (i = 0; i < pReporter->keyCount; i++) {
+        shadow_reporter_key_t *pKey = &pReporter->keys[i];
+
+        if (pKey->isSent && SHADOW_ACK_ACCEPTED == status) {
+            memcpy(pKey->acked, pKey->sent, sizeof(pKey->acked));
+            pKey->isAcked = true;
+        }
+        pKey->isSent = false;
+    }
+
+    if (SHADOW_ACK_ACCEPTED == status) {
+        ESP_LOGI(TAG, "Update accepted");
+        return;
+    }
+
+    /* Report again, still no sooner than the minimum interval */
+    ESP_LOGW(TAG, "Update %s, retrying", SHADOW_ACK_TIMEOUT == status ? "timed out" : "rejected");
+    shadow_reporter_mark_dirty(pReporter);
+}
+
+IoT_Error_t shadow_reporter_init(shadow_reporter_t *pReporter, AWS_IoT_Client *pClient, const char *pThingName,
+                                 uint32_t coalesceMs, uint32_t minIntervalMs) {
+    if (NULL == pReporter || NULL == pClient || NULL == pThingName) {
+        return NULL_VALUE_ERROR;
+    }
+
+    memset(pReporter, 0, sizeof(shadow_reporter_t));
+    pReporter->pClient = pClient;
+    pReporter->pThingName = pThingName;
+    pReporter->coalesceMs = coalesceMs;
+    pReporter->minIntervalMs = minIntervalMs;
+    init_timer(&pReporter->window);
+    init_timer(&pReporter->interval);
+
+    return SUCCESS;
+}
+
+IoT_Error_t shadow_reporter_add_key(shadow_reporter_t *pReporter, jsonStruct_t *pStruct) {
+    if (NULL == pReporter || NULL == pStruct || NULL == pStruct->pKey || NULL == pStruct->pData) {
+        return NULL_VALUE_ERROR;
+    }
+    if (pReporter->keyCount >= SHADOW_REPORTER_MAX_KEYS) {
+        ESP_LOGE(TAG, "No room for key %s", pStruct->pKey);
+        return FAILURE;
+    }
+    if ((SHADOW_JSON_STRING == pStruct->type || SHADOW_JSON_OBJECT == pStruct->type)
+        && pStruct->dataLength > SHADOW_REPORTER_MAX_VALUE_SIZE) {
+        ESP_LOGE(TAG, "Value of key %s is larger than %d bytes", pStruct->pKey, SHADOW_REPORTER_MAX_VALUE_SIZE);
+        return FAILURE;
+    }
+
+    pReporter->keys[pReporter->keyCount].pStruct = pStruct;
+    pReporter->keys[pReporter->keyCount].isAcked = false;
+    pReporter->keys[pReporter->keyCount].isSent = false;
+    pReporter->keyCount++;
+
+    return SUCCESS;
+}
+
+void shadow_reporter_notify(shadow_reporter_t *pReporter) {
+    pReporter->notifyCount++;
+    shadow_reporter_mark_dirty(pReporter);
+}
+
+IoT_Error_t shadow_reporter_process(shadow_reporter_t *pReporter) {
+    jsonStruct_t *changed[SHADOW_REPORTER_MAX_KEYS];
+    char document[SHADOW_REPORTER_DOCUMENT_SIZE];
+    ShadowJsonBuilder_t builder;
+    uint8_t changedCount = 0;
+    uint8_t i;
+    IoT_Error_t rc;
+
+    if (!pReporter->isDirty || pReporter->isInFlight) {
+        return SUCCESS;
+    }
+    if (!has_timer_expired(&pReporter->window) || !has_timer_expired(&pReporter->interval)) {
+        return SUCCESS;
+    }
+
+    for (i = 0; i < pReporter->keyCount; i++) {
+        if (shadow_reporter_key_changed(&pReporter->keys[i])) {
+            changed[changedCount++] = pReporter->keys[i].pStruct;
+        }
+    }
+    if (0 == changedCount) {
+        /* Changed back to what was reported already */
+        pReporter->isDirty = false;
+        return SUCCESS;
+    }
+
+    /* Failures are retried at the same rate as updates */
+    countdown_ms(&pReporter->interval, pReporter->minIntervalMs);
+
+    rc = aws_iot_shadow_json_builder_init(&builder, document, sizeof(document));
+    if (SUCCESS == rc) {
+        rc = aws_iot_shadow_json_builder_add_reported_array(&builder, changedCount, changed);
+    }
+    if (SUCCESS == rc) {
+        rc = aws_iot_shadow_json_builder_finalize(&builder);
+    }
+    if (SUCCESS != rc) {
+        ESP_LOGE(TAG, "Could not build the update document: %d", rc);
+        return rc;
+    }
+
+    ESP_LOGI(TAG, "Update Shadow: %s", document);
+    rc = aws_iot_shadow_update(pReporter->pClient, pReporter->pThingName, document,
+                               shadow_reporter_update_callback, pReporter, SHADOW_REPORTER_ACK_TIMEOUT_SEC, true);
+    if (SUCCESS != rc) {
+        ESP_LOGE(TAG, "aws_iot_shadow_update error %d", rc);
+        return rc;
+    }
+
+    for (i = 0; i < pReporter->keyCount; i++) {
+        shadow_reporter_key_t *pKey = &pReporter->keys[i];
+
+        pKey->isSent = shadow_reporter_key_changed(pKey);
+        if (pKey->isSent) {
+            memcpy(pKey->sent, pKey->pStruct->pData, shadow_reporter_value_size(pKey->pStruct));
+        }
+    }
+    pReporter->isDirty = false;
+    pReporter->isInFlight = true;
+    pReporter->updateCount++;
+    ESP_LOGI(TAG, "%d of %d keys reported, %u changes in %u updates", changedCount, pReporter->keyCount,
+             pReporter->notifyCount, pReporter->updateCount);
+
+    return SUCCESS;
+}
+
+bool shadow_reporter_is_busy(const shadow_reporter_t *pReporter) {
+    return pReporter->isDirty || pReporter->isInFlight;
+}
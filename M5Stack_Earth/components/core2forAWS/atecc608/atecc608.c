@@ -3,6 +3,7 @@
 
 #include "cryptoauthlib.h"
 #include "mbedtls/atca_mbedtls_wrap.h"
+#include "atca_identity_cache.h"
 #include "esp_log.h"
 
 #include "i2c_device.h"
@@ -57,9 +58,9 @@ ATCA_STATUS Atecc608_GetSerialString(char * sn) {
     int ret;
     uint8_t serial[ATCA_SERIAL_NUM_SIZE];
     
-    ret = atcab_read_serial_number(serial);
+    ret = atca_identity_get_serial(serial);
     if (ret != ATCA_SUCCESS) {
-        ESP_LOGI(TAG, "*FAILED* atcab_read_serial_number returned %02x", ret);
+        ESP_LOGI(TAG, "*FAILED* atca_identity_get_serial returned %02x", ret);
         handleErr();
     }
 
@@ -32,8 +32,9 @@ ATCA_STATUS Atecc608_Init();
  * 
  * The serial number of the ATECC608 is stored as a uint8
  * with the length defined in the macro ATCA_SERIAL_NUM_SIZE.
- * It might take a little time to wake the secure element and
- * retrieve the serial number.
+ * The first call after boot wakes the secure element to read it;
+ * later calls, and later boots when CONFIG_ATCA_IDENTITY_CACHE is
+ * enabled, return the cached value.
  * 
  * **Example:**
  * 
@@ -44,6 +44,19 @@ typedef struct _i2c_device_t {
 static SemaphoreHandle_t i2c_mutex[I2C_NUM_MAX];
 static i2c_port_obj_t *i2c_port_used[2] = { NULL, NULL };
 
+static esp_err_t i2c_port_config(i2c_port_obj_t* port_obj) {
+    i2c_config_t conf = {
+        .mode = I2C_MODE_MASTER,
+        .sda_io_num = port_obj->sda,
+        .sda_pullup_en = GPIO_PULLUP_ENABLE,
+        .scl_io_num = port_obj->scl,
+        .scl_pullup_en = GPIO_PULLUP_ENABLE,
+        .master.clk_speed = port_obj->freq,
+    };
+
+    return i2c_param_config(port_obj->port, &conf);
+}
+
 I2CDevice_t i2c_malloc_device(i2c_port_t i2c_num, gpio_num_t sda, gpio_num_t scl, uint32_t freq, uint8_t device_addr) {
     if (i2c_num > I2C_NUM_MAX) {
         i2c_num = I2C_NUM_MAX;
@@ -119,8 +132,13 @@ esp_err_t i2c_apply_bus(I2CDevice_t i2c_device) {
 
     if ((used_port != NULL) && 
         (device->i2c_port->sda == used_port->sda) && 
-        (device->i2c_port->scl == used_port->scl) && 
-        ((device->i2c_port->freq == used_port->freq))) {
+        (device->i2c_port->scl == used_port->scl)) {
+            // Devices sharing the pins only differ in clock, which can be
+            // reprogrammed without reinstalling the driver
+            if (device->i2c_port->freq != used_port->freq) {
+                i2c_port_config(device->i2c_port);
+                log_i("I2C clock update, freq: %d HZ", device->i2c_port->freq);
+            }
             i2c_port_used[device->i2c_port->port] = device->i2c_port;
             return ESP_OK;    
     }
@@ -133,16 +151,7 @@ esp_err_t i2c_apply_bus(I2CDevice_t i2c_device) {
         }
     }
 
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = device->i2c_port->sda,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_io_num = device->i2c_port->scl,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = device->i2c_port->freq,
-    };
-
-    i2c_param_config(device->i2c_port->port, &conf);
+    i2c_port_config(device->i2c_port);
     i2c_driver_install(device->i2c_port->port, I2C_MODE_MASTER, 0, 0, 0);
 
     i2c_port_used[device->i2c_port->port] = device->i2c_port;
@@ -281,7 +290,7 @@ esp_err_t i2c_read_bits(I2CDevice_t i2c_device, uint32_t reg_addr, uint8_t *data
     return ESP_OK;
 }
 
-esp_err_t i2c_write_bytes(I2CDevice_t i2c_device, uint32_t reg_addr, uint8_t *data, uint16_t length) {
+static esp_err_t i2c_write_bytes_addr(I2CDevice_t i2c_device, uint8_t addr, uint32_t reg_addr, uint8_t *data, uint16_t length) {
     if (i2c_device == NULL || (length > 0 && data == NULL)) {
         return ESP_FAIL;
     }
@@ -290,7 +299,7 @@ esp_err_t i2c_write_bytes(I2CDevice_t i2c_device, uint32_t reg_addr, uint8_t *da
 
     i2c_cmd_handle_t write_cmd = i2c_cmd_link_create();
     i2c_master_start(write_cmd);
-    i2c_master_write_byte(write_cmd, (device->addr << 1) | I2C_MASTER_WRITE, 1);
+    i2c_master_write_byte(write_cmd, (addr << 1) | I2C_MASTER_WRITE, 1);
     if(!(reg_addr & I2C_NO_REG)){
         i2c_master_write_byte(write_cmd, reg_addr, 1);
     }
@@ -308,15 +317,26 @@ esp_err_t i2c_write_bytes(I2CDevice_t i2c_device, uint32_t reg_addr, uint8_t *da
     i2c_cmd_link_delete(write_cmd);
 
     if (err != ESP_OK) {
-        log_e("I2C Write Error, addr: 0x%02x, reg: 0x%02x, length: %d, Code: 0x%x", device->addr, reg_addr, length, err);
+        log_e("I2C Write Error, addr: 0x%02x, reg: 0x%02x, length: %d, Code: 0x%x", addr, reg_addr, length, err);
     } else {
-        log_i("I2C Write Success, addr: 0x%02x, reg: 0x%02x, length: %d", device->addr, reg_addr, length);
+        log_i("I2C Write Success, addr: 0x%02x, reg: 0x%02x, length: %d", addr, reg_addr, length);
         log_reg(data, length);
     }
 
     return err;
 }
 
+esp_err_t i2c_write_bytes(I2CDevice_t i2c_device, uint32_t reg_addr, uint8_t *data, uint16_t length) {
+    if (i2c_device == NULL) {
+        return ESP_FAIL;
+    }
+    return i2c_write_bytes_addr(i2c_device, ((i2c_device_t *)i2c_device)->addr, reg_addr, data, length);
+}
+
+esp_err_t i2c_write_bytes_to(I2CDevice_t i2c_device, uint8_t addr, uint8_t *data, uint16_t length) {
+    return i2c_write_bytes_addr(i2c_device, addr, I2C_NO_REG, data, length);
+}
+
 esp_err_t i2c_write_byte(I2CDevice_t i2c_device, uint32_t reg_addr, uint8_t data) {
     return i2c_write_bytes(i2c_device, reg_addr, &data, 1);
 }
@@ -365,8 +385,10 @@ esp_err_t i2c_device_change_freq(I2CDevice_t i2c_device, uint32_t freq) {
     }
 
     device->i2c_port->freq = freq;
+    // Takes effect right away if the bus is set up for this device, else on
+    // its next transfer
     if (i2c_port_used[device->i2c_port->port] == device->i2c_port) {
-        i2c_port_used[device->i2c_port->port] = NULL;
+        i2c_port_config(device->i2c_port);
     }
     xSemaphoreGiveRecursive(i2c_mutex[device->i2c_port->port]);
     return ESP_OK;
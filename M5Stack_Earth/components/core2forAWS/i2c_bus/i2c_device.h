@@ -70,6 +70,12 @@ esp_err_t i2c_write_bytes(I2CDevice_t i2c_device, uint32_t reg_addr, uint8_t *da
 
 esp_err_t i2c_read_bytes_no_stop(I2CDevice_t i2c_device, uint32_t reg_addr, uint8_t *data, uint16_t length);
 
+/*
+    Write to another address on the device's bus and clock, without a register
+    address. Used for the general call (address 0) that wakes the ATECC608.
+*/
+esp_err_t i2c_write_bytes_to(I2CDevice_t i2c_device, uint8_t addr, uint8_t *data, uint16_t length);
+
 esp_err_t i2c_write_byte(I2CDevice_t i2c_device, uint32_t reg_addr, uint8_t data);
 
 esp_err_t i2c_write_bit(I2CDevice_t i2c_device, uint32_t reg_addr, uint8_t data, uint8_t bit_pos);
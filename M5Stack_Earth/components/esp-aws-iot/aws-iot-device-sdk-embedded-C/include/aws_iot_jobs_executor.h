@@ -0,0 +1,322 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef AWS_IOT_JOBS_EXECUTOR_H_
+#define AWS_IOT_JOBS_EXECUTOR_H_
+
+#ifdef DISABLE_IOT_JOBS
+#error "Jobs API is disabled"
+#endif
+
+/**
+ * @file aws_iot_jobs_executor.h
+ * @brief Runs the jobs of a thing one after the other with registered step handlers
+ *
+ * The executor pulls the next pending job with start-next, runs its steps and reports the outcome, then pulls the
+ * next one. It is woken up by notify-next when a job is queued while it is idle. A job document lists its steps:
+ *
+ *     {"steps":[{"download":{"url":"https://..."},"timeoutSec":600},
+ *               [{"led":{"color":"blue"}},{"beep":{"count":2}}],
+ *               {"reboot":{}}]}
+ *
+ * Each step is an object with the name of a registered handler and its parameters, and optionally a timeout. An
+ * array of steps is a group that runs in parallel: all steps of a group are started together and the next group
+ * starts once all of them succeeded. The job fails with the first failed or timed out step.
+ *
+ * The start-next response is read from the MQTT receive buffer in one streaming pass (see aws_iot_json_stream.h).
+ * The document is never copied or tokenized: each handler is given the values of its own parameters and keeps what
+ * it needs in the storage of its step. Steps that take long, such as downloading an image, run in a worker task
+ * through the dispatch function given at init, so the task yielding the MQTT client is never blocked by them.
+ *
+ * Progress reported by steps is collected and sent as one IN_PROGRESS update at most every progress interval.
+ * aws_iot_jobs_executor_step_progress and aws_iot_jobs_executor_step_complete can be called from any task. All
+ * other functions must be called, and all handler callbacks other than a worker's run are called, in the task that
+ * yields the MQTT client.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "aws_iot_config.h"
+#include "aws_iot_jobs_interface.h"
+#include "aws_iot_json_stream.h"
+#include "timer_interface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MAX_SIZE_OF_JOB_ID
+#define MAX_SIZE_OF_JOB_ID 64 ///< Size of the buffer holding a job ID, including the null
+#endif
+
+#ifndef MAX_JOB_TOPIC_LENGTH_BYTES
+#define MAX_JOB_TOPIC_LENGTH_BYTES (40 + MAX_SIZE_OF_THING_NAME + MAX_SIZE_OF_JOB_ID + 2) ///< Size of a jobs topic buffer
+#endif
+
+#ifndef MAX_SIZE_OF_JOB_REQUEST
+#define MAX_SIZE_OF_JOB_REQUEST AWS_IOT_MQTT_TX_BUF_LEN ///< Size of the buffer the update requests are built in
+#endif
+
+#ifndef JOBS_EXECUTOR_MAX_STEPS
+#define JOBS_EXECUTOR_MAX_STEPS 8 ///< Steps a job document can have, in all groups together
+#endif
+
+#ifndef JOBS_EXECUTOR_MAX_HANDLERS
+#define JOBS_EXECUTOR_MAX_HANDLERS 8 ///< Step handlers that can be registered on one executor
+#endif
+
+#ifndef JOBS_EXECUTOR_STEP_DATA_SIZE
+#define JOBS_EXECUTOR_STEP_DATA_SIZE 96 ///< Bytes of storage each step has for the parameters read by its handler
+#endif
+
+typedef struct _JobsExecutor_t JobsExecutor_t;
+typedef struct _JobsStep_t JobsStep_t;
+
+/**
+ * @brief State of a step
+ */
+typedef enum {
+	JOBS_STEP_PENDING, ///< Its group has not started yet
+	JOBS_STEP_QUEUED, ///< Handed to the worker dispatch function, not running yet
+	JOBS_STEP_RUNNING, ///< Started and not complete
+	JOBS_STEP_SUCCEEDED, ///< Complete
+	JOBS_STEP_FAILED ///< Failed, timed out or canceled
+} JobsStepState_t;
+
+/**
+ * @brief What a step does, registered with aws_iot_jobs_executor_register_handler
+ */
+typedef struct {
+	const char *pName; ///< Member name selecting this handler in a step of the job document
+	bool runInWorker; ///< run is called through the worker dispatch function instead of the yielding task
+
+	/**
+	 * @brief Read one parameter of a step, may be NULL for handlers without parameters
+	 *
+	 * Called while the job document is parsed, for every value below the handler's member of the step, before the
+	 * step runs. The step's data is zeroed before the first call.
+	 *
+	 * @param pStep Step being set up
+	 * @param pEvent Value, or start or end of a container, in the parameters
+	 * @param pParamPath Path of the value relative to the parameters, e.g. "url" or "files.0", "" for the
+	 *        parameters themselves, NULL when the path is longer than JSON_STREAM_MAX_PATH_LENGTH
+	 * @return SUCCESS to accept the value, anything else fails the job as an invalid document
+	 */
+	IoT_Error_t (*param)(JobsStep_t *pStep, const JsonStreamEvent_t *pEvent, const char *pParamPath);
+
+	/**
+	 * @brief Start the step
+	 *
+	 * @param pStep Step to run
+	 * @return JOBS_STEP_SUCCEEDED or JOBS_STEP_FAILED when the step is complete, JOBS_STEP_RUNNING when it
+	 *         completes later through aws_iot_jobs_executor_step_complete
+	 */
+	JobsStepState_t (*run)(JobsStep_t *pStep);
+
+	/**
+	 * @brief Stop a running step that timed out or whose job failed or was canceled, may be NULL
+	 *
+	 * Called in the yielding task, possibly while run is still executing in a worker: cancel and run are not
+	 * serialized. Until aws_iot_jobs_executor_run_step returns, the step and its data belong to the worker, so
+	 * cancel must only signal run to stop, e.g. through an atomic flag run polls, and must not touch what run
+	 * uses. Completing the step after this has no effect, and the executor starts the next job only once the
+	 * worker returned from run.
+	 *
+	 * @param pStep Step to stop
+	 */
+	void (*cancel)(JobsStep_t *pStep);
+
+	void *pContext; ///< Application data for the callbacks
+} JobsStepHandler_t;
+
+/**
+ * @brief One step of the running job
+ */
+struct _JobsStep_t {
+	const JobsStepHandler_t *pHandler; ///< Handler running the step
+	JobsExecutor_t *pExecutor; ///< Executor the step belongs to
+	uint8_t group; ///< Index of the group the step runs in
+	uint8_t state; ///< JobsStepState_t, written by other tasks through aws_iot_jobs_executor_step_complete
+	uint8_t progress; ///< Percent done as reported with aws_iot_jobs_executor_step_progress
+	bool isInWorker; ///< The worker dispatch function owns the step until aws_iot_jobs_executor_run_step returns
+	bool isTimedOut; ///< Failed because the step timeout expired
+	uint32_t timeoutMs; ///< Time the step may take from being started
+	Timer timer; ///< Expires at the step timeout
+	union {
+		uint64_t alignment;
+		void *pAlignment;
+		uint8_t bytes[JOBS_EXECUTOR_STEP_DATA_SIZE];
+	} data; ///< Storage for the handler, filled by its param callback
+};
+
+/**
+ * @brief Hand a step to a worker task
+ *
+ * The worker calls aws_iot_jobs_executor_run_step with the step. Must not block.
+ *
+ * @param pStep Step to run
+ * @param pContext Dispatch context given in the executor parameters
+ * @return SUCCESS when the step was queued, anything else to try again on the next yield
+ */
+typedef IoT_Error_t (*JobsWorkerDispatch_t)(JobsStep_t *pStep, void *pContext);
+
+/**
+ * @brief Executor parameters
+ */
+typedef struct {
+	const char *pThingName; ///< Thing whose jobs are executed
+	JobsWorkerDispatch_t dispatch; ///< Runs steps of handlers with runInWorker set, NULL to run them in the yielding task
+	void *pDispatchContext; ///< Passed to dispatch
+	uint32_t progressIntervalMs; ///< Least time between two IN_PROGRESS updates
+	uint32_t responseTimeoutMs; ///< Time to wait for the response to a start-next or update request
+	uint32_t defaultStepTimeoutMs; ///< Timeout of steps that do not set "timeoutSec"
+} JobsExecutorParams_t;
+
+extern const JobsExecutorParams_t jobsExecutorParamsDefault;
+
+#define JobsExecutorParams_initializer {NULL, NULL, NULL, 5000, 10000, 60000}
+
+/**
+ * @brief State of the executor
+ */
+typedef enum {
+	JOBS_EXECUTOR_IDLE, ///< No job, waiting for notify-next
+	JOBS_EXECUTOR_STARTING, ///< start-next sent, waiting for the next job
+	JOBS_EXECUTOR_RUNNING, ///< Running the steps of a job
+	JOBS_EXECUTOR_FINISHING, ///< Reporting the outcome of a job and waiting for its workers
+	JOBS_EXECUTOR_CANCELING ///< Job canceled by the service, waiting for its workers
+} JobsExecutorState_t;
+
+/**
+ * @brief Jobs executor for one thing, allocated by the application
+ */
+struct _JobsExecutor_t {
+	AWS_IoT_Client *pClient; ///< MQTT client the jobs are received over
+	JobsExecutorParams_t params; ///< Parameters given at init
+	char thingName[MAX_SIZE_OF_THING_NAME]; ///< Copy of the thing name
+	const JobsStepHandler_t *pHandlers[JOBS_EXECUTOR_MAX_HANDLERS]; ///< Registered handlers
+	uint8_t handlerCount; ///< Entries used in pHandlers
+	char notifyNextTopic[MAX_JOB_TOPIC_LENGTH_BYTES]; ///< Subscribed notify-next topic
+	char startNextTopic[MAX_JOB_TOPIC_LENGTH_BYTES]; ///< Subscribed start-next reply topic filter
+	char updateTopic[MAX_JOB_TOPIC_LENGTH_BYTES]; ///< Subscribed update reply topic filter of all jobs
+	char publishTopic[MAX_JOB_TOPIC_LENGTH_BYTES]; ///< Topic of the request being sent
+	char message[MAX_SIZE_OF_JOB_REQUEST]; ///< Request being sent
+	char statusDetails[MAX_SIZE_OF_JOB_REQUEST / 2]; ///< statusDetails of the update being sent
+	char requestToken[MAX_SIZE_OF_THING_NAME + 12]; ///< Client token of the request waiting for a response
+	uint32_t tokenSequence; ///< Sequence number of the last client token
+	uint8_t state; ///< JobsExecutorState_t
+	bool isSubscribed; ///< Topics subscribed with aws_iot_jobs_executor_start
+	bool isStartNextPending; ///< Pull the next job once idle
+	bool isRequestInFlight; ///< A request waits for its response
+	bool isFinalUpdateSent; ///< The outcome of the job was sent
+	bool isFinalUpdateDone; ///< The outcome of the job was accepted, rejected or given up on
+	bool isProgressDirty; ///< A step started, completed or reported progress since the last update
+	uint8_t finalRetries; ///< Times the outcome was sent without a response
+	char jobId[MAX_SIZE_OF_JOB_ID]; ///< Job being run
+	int64_t executionNumber; ///< Execution number of the job being run
+	JobExecutionStatus finalStatus; ///< Outcome of the job
+	const char *pFailureReason; ///< Why the job failed, reported in statusDetails
+	int16_t failedStep; ///< Index of the step that failed, -1 when no step did
+	JobsStep_t steps[JOBS_EXECUTOR_MAX_STEPS]; ///< Steps of the job
+	uint8_t stepCount; ///< Entries used in steps
+	uint8_t groupCount; ///< Groups in the job
+	uint8_t currentGroup; ///< Group running
+	Timer responseTimer; ///< Expires when the response to the request in flight is late
+	Timer progressTimer; ///< Expires when the next IN_PROGRESS update may be sent
+	uint32_t completedJobs; ///< Jobs that succeeded since init
+	uint32_t failedJobs; ///< Jobs that failed or were canceled since init
+};
+
+/**
+ * @brief Initialize a jobs executor
+ *
+ * Does not talk to the broker. Handlers are registered next, then aws_iot_jobs_executor_start subscribes.
+ *
+ * @param pExecutor Executor to initialize
+ * @param pClient MQTT client, initialized with aws_iot_mqtt_init
+ * @param pParams Parameters, pThingName is required
+ * @return NULL_VALUE_ERROR on missing arguments, FAILURE when the thing name does not fit, SUCCESS otherwise
+ */
+IoT_Error_t aws_iot_jobs_executor_init(JobsExecutor_t *pExecutor, AWS_IoT_Client *pClient,
+									   const JobsExecutorParams_t *pParams);
+
+/**
+ * @brief Register a step handler
+ *
+ * @param pExecutor Jobs executor
+ * @param pHandler Handler with a name and a run function, must stay valid while the executor is used
+ * @return FAILURE when JOBS_EXECUTOR_MAX_HANDLERS are registered or the name is taken, SUCCESS otherwise
+ */
+IoT_Error_t aws_iot_jobs_executor_register_handler(JobsExecutor_t *pExecutor, const JobsStepHandler_t *pHandler);
+
+/**
+ * @brief Subscribe to the jobs topics of the thing and pull the first job on the next yield
+ *
+ * The device policy must allow subscribing to notify-next, start-next/+ and +/update/+ of the thing's jobs.
+ *
+ * @param pExecutor Jobs executor
+ * @return The result of subscribing
+ */
+IoT_Error_t aws_iot_jobs_executor_start(JobsExecutor_t *pExecutor);
+
+/**
+ * @brief Run a step in a worker task
+ *
+ * Called by the worker that received the step from the dispatch function. Does nothing when the step timed out or
+ * its job ended while it was queued.
+ *
+ * @param pStep Step passed to the dispatch function
+ */
+void aws_iot_jobs_executor_run_step(JobsStep_t *pStep);
+
+/**
+ * @brief Complete a step whose run function returned JOBS_STEP_RUNNING
+ *
+ * Can be called from any task.
+ *
+ * @param pStep Running step
+ * @param succeeded Whether the step succeeded
+ * @return FAILURE when the step is not running anymore, e.g. because it timed out, SUCCESS otherwise
+ */
+IoT_Error_t aws_iot_jobs_executor_step_complete(JobsStep_t *pStep, bool succeeded);
+
+/**
+ * @brief Report how far a running step is
+ *
+ * Can be called from any task and as often as needed, updates are batched.
+ *
+ * @param pStep Running step
+ * @param percent Percent done, 0 to 100
+ */
+void aws_iot_jobs_executor_step_progress(JobsStep_t *pStep, uint8_t percent);
+
+/**
+ * @brief Advance the running job, then yield the MQTT client
+ *
+ * Starts steps, times them out, sends requests and times out their responses. Call it instead of
+ * aws_iot_mqtt_yield.
+ *
+ * @param pExecutor Jobs executor
+ * @param timeout Time to yield in milliseconds
+ * @return An IoT Error Type defining successful/failed yield
+ */
+IoT_Error_t aws_iot_jobs_executor_yield(JobsExecutor_t *pExecutor, uint32_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_JOBS_EXECUTOR_H_ */
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_JSON_STREAM_H_
+#define AWS_IOT_SDK_SRC_JSON_STREAM_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file aws_iot_json_stream.h
+ * @brief Resumable JSON tokenizer that reports values with their path
+ *
+ * The parser keeps its whole state in a JsonStreamParser_t, so a document can be fed in chunks of any size, down
+ * to single bytes, as they arrive. It needs no token array: every value is reported to a callback as soon as it
+ * ends, together with its member name and its path from the top level. Paths use the syntax of the shadow JSON
+ * views, member names joined by dots and array elements by their index, e.g. "state.reported.list.2".
+ *
+ * Strings and numbers are reported as the text of the document, strings without their quotes and with escape
+ * sequences as received. A value that lies within one chunk points into that chunk, a value split across chunks is
+ * copied into the parser first. Pointers in an event are only valid during the callback.
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "aws_iot_error.h"
+
+#ifndef JSON_STREAM_MAX_DEPTH
+#define JSON_STREAM_MAX_DEPTH 16 ///< Objects and arrays that can be open at the same time
+#endif
+
+#ifndef JSON_STREAM_MAX_PATH_LENGTH
+#define JSON_STREAM_MAX_PATH_LENGTH 64 ///< Longest path reported, values below longer paths have no path
+#endif
+
+#ifndef JSON_STREAM_MAX_VALUE_LENGTH
+#define JSON_STREAM_MAX_VALUE_LENGTH 64 ///< Longest string or number that can be split across two chunks
+#endif
+
+/**
+ * @brief Kind of a JSON stream event
+ */
+typedef enum {
+	JSON_STREAM_OBJECT_START, ///< '{' of an object
+	JSON_STREAM_OBJECT_END, ///< '}' of an object
+	JSON_STREAM_ARRAY_START, ///< '[' of an array
+	JSON_STREAM_ARRAY_END, ///< ']' of an array
+	JSON_STREAM_STRING, ///< String value
+	JSON_STREAM_NUMBER, ///< Number value
+	JSON_STREAM_BOOL, ///< true or false
+	JSON_STREAM_NULL ///< null
+} JsonStreamEventType_t;
+
+/**
+ * @brief One value, or the start or end of a container, found in the document
+ */
+typedef struct {
+	JsonStreamEventType_t type; ///< What was found
+	uint16_t depth; ///< Containers around the value, 0 for the top level value and 1 for its members
+	const char *pKey; ///< Member name of the value, NULL for array elements, the top level and long paths
+	uint32_t keyLength; ///< Length of pKey
+	const char *pPath; ///< Null terminated path of the value, "" for the top level, NULL when longer than the maximum
+	uint32_t pathLength; ///< Length of pPath
+	const char *pValue; ///< Text of a string, number or literal, NULL for containers
+	uint32_t valueLength; ///< Length of pValue
+} JsonStreamEvent_t;
+
+/**
+ * @brief Called for every event in the order of the document
+ *
+ * @param pEvent The event, only valid during the call
+ * @param pContext Context given to aws_iot_json_stream_init
+ */
+typedef void (*JsonStreamCallback_t)(const JsonStreamEvent_t *pEvent, void *pContext);
+
+/**
+ * @brief State of one document being parsed, all fields are private
+ */
+typedef struct {
+	JsonStreamCallback_t callback;
+	void *pContext;
+	IoT_Error_t error; ///< First error, returned again by every later call
+	uint8_t state;
+	uint8_t escapeDigits; ///< Hex digits still expected in a \\u escape
+	uint16_t depth;
+	uint8_t isObject[(JSON_STREAM_MAX_DEPTH + 7) / 8]; ///< One bit per open container, set for objects
+	uint32_t elementIndex[JSON_STREAM_MAX_DEPTH]; ///< Next element of each open array
+	uint16_t containerPathLength[JSON_STREAM_MAX_DEPTH + 1]; ///< Path length of each open container
+	uint16_t pathLength;
+	char path[JSON_STREAM_MAX_PATH_LENGTH + 1];
+	uint32_t valueLength; ///< Bytes of the current value copied into value
+	bool isValueCopied; ///< The current value started in an earlier chunk
+	char value[JSON_STREAM_MAX_VALUE_LENGTH];
+} JsonStreamParser_t;
+
+/**
+ * @brief Start parsing a new document
+ *
+ * @param pParser Parser to set up
+ * @param callback Called for every event, may be NULL to only validate the document
+ * @param pContext Passed to the callback
+ * @return NULL_VALUE_ERROR on a NULL parser, SUCCESS otherwise
+ */
+IoT_Error_t aws_iot_json_stream_init(JsonStreamParser_t *pParser, JsonStreamCallback_t callback, void *pContext);
+
+/**
+ * @brief Parse the next chunk of the document
+ *
+ * Events of values that end in this chunk are reported before it returns. After an error the parser stops and
+ * every later call returns the same error.
+ *
+ * @param pParser Parser set up with aws_iot_json_stream_init
+ * @param pData Next bytes of the document
+ * @param length Number of bytes in pData, 0 is allowed
+ * @return JSON_PARSE_ERROR when the document is not valid JSON, LIMIT_EXCEEDED_ERROR when it nests deeper than
+ *         JSON_STREAM_MAX_DEPTH, MAX_SIZE_ERROR when a value split across chunks is longer than
+ *         JSON_STREAM_MAX_VALUE_LENGTH, SUCCESS otherwise
+ */
+IoT_Error_t aws_iot_json_stream_feed(JsonStreamParser_t *pParser, const char *pData, size_t length);
+
+/**
+ * @brief End the document
+ *
+ * Reports a top level number or literal, which only ends with the document.
+ *
+ * @param pParser Parser set up with aws_iot_json_stream_init
+ * @return JSON_PARSE_ERROR when the document is incomplete, the error of an earlier feed, SUCCESS otherwise
+ */
+IoT_Error_t aws_iot_json_stream_finish(JsonStreamParser_t *pParser);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //AWS_IOT_SDK_SRC_JSON_STREAM_H_
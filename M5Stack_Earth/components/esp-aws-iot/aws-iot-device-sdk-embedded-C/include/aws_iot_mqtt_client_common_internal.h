@@ -74,6 +74,10 @@ typedef enum msgTypes {
 #define MQTT_HEADER_FIELD_QOS(_byte)	((_byte & (3 << 1)) >> 1) /**< QoS */
 #define MQTT_HEADER_FIELD_RETAIN(_byte)	((_byte & (1 << 0)) >> 0) /**< Retain flag */
 
+/** Countdown used by stopwatch timers. A multiple of all common tick periods so that
+ * no time is lost to rounding when the countdown is started */
+#define AWS_IOT_MQTT_STOPWATCH_RANGE_MS 2000000000u
+
 /**
  * Bitfields for the MQTT header byte.
  */
@@ -118,6 +122,17 @@ IoT_Error_t aws_iot_mqtt_internal_deserialize_publish(uint8_t *dup, QoS *qos,
 IoT_Error_t aws_iot_mqtt_set_client_state(AWS_IoT_Client *pClient, ClientState expectedCurrentState,
 										  ClientState newState);
 
+void aws_iot_mqtt_internal_store_unacked_publish(AWS_IoT_Client *pClient, uint16_t packetId, uint32_t packetLen);
+void aws_iot_mqtt_internal_remove_unacked_publish(AWS_IoT_Client *pClient, uint16_t packetId);
+void aws_iot_mqtt_internal_clear_unacked_publishes(AWS_IoT_Client *pClient);
+IoT_Error_t aws_iot_mqtt_internal_resend_unacked_publishes(AWS_IoT_Client *pClient);
+
+void aws_iot_mqtt_internal_stopwatch_start(Timer *pTimer);
+uint32_t aws_iot_mqtt_internal_stopwatch_elapsed_ms(Timer *pTimer);
+
+void aws_iot_mqtt_internal_seed_backoff(AWS_IoT_Client *pClient, const char *pSeed, uint16_t seedLen);
+uint32_t aws_iot_mqtt_internal_next_backoff_ms(AWS_IoT_Client *pClient, bool isFirstAttempt);
+
 #ifdef _ENABLE_THREAD_SUPPORT_
 
 IoT_Error_t aws_iot_mqtt_client_lock_mutex(AWS_IoT_Client *pClient, IoT_Mutex_t *pMutex);
@@ -23,18 +23,70 @@ extern "C" {
 #include <stdbool.h>
 #include <stdarg.h>
 
+#include "aws_iot_config.h"
 #include "aws_iot_error.h"
 #include "aws_iot_shadow_json_data.h"
+#include "jsmn.h"
+
+/**
+ * @brief Tokens of one parsed document
+ *
+ * The functions below taking a pJsonHandler parse into, or read from, the ShadowJsonTokens_t it points to. With a
+ * NULL pJsonHandler they use the tokens of the Thing Shadow client.
+ */
+typedef struct _ShadowJsonTokens_t {
+	jsmntok_t tokens[MAX_JSON_TOKEN_EXPECTED];
+	const char *pJsonDocument; ///< Document the tokens describe, NULL when they are stale
+	int32_t tokenCount; ///< Entries used in tokens
+	uint32_t generation; ///< Parse the tokens come from, for ShadowJsonView_t
+} ShadowJsonTokens_t;
 
 bool isJsonValidAndParse(const char *pJsonDocument, size_t jsonSize, void *pJsonHandler, int32_t *pTokenCount);
 
 bool isJsonKeyMatchingAndUpdateValue(const char *pJsonDocument, void *pJsonHandler, int32_t tokenCount,
 									 jsonStruct_t *pDataStruct, uint32_t *pDataLength, int32_t *pDataPosition);
 
+/**
+ * @brief Called by walkJsonKeys() for each key
+ *
+ * @param pKey Key, not null terminated
+ * @param pPath Null terminated dotted path of the key below the "state" object of the document,
+ * e.g. "light.color", or NULL when paths were not requested or the path is too long
+ * @param pValueToken Token of the value, for updateJsonStructFromToken()
+ */
+typedef void (*jsonKeyVisitor_t)(const char *pJsonDocument, const char *pKey, uint32_t keyLen,
+								 const char *pPath, uint32_t pathLen, jsmntok_t *pValueToken, void *pContext);
+
+/**
+ * @brief Visit every key of the document last parsed into pJsonHandler by isJsonValidAndParse() in one pass
+ *
+ * Keys are visited in document order at every depth. Objects under a "metadata" key are skipped.
+ *
+ * @param withPaths Also build the dotted path of every key
+ */
+void walkJsonKeys(const char *pJsonDocument, void *pJsonHandler, int32_t tokenCount, bool withPaths,
+				  jsonKeyVisitor_t visitor, void *pContext);
+
+/**
+ * @brief Parse a value token into a registered structure, as isJsonKeyMatchingAndUpdateValue() does
+ */
+IoT_Error_t updateJsonStructFromToken(const char *pJsonDocument, jsonStruct_t *pDataStruct, jsmntok_t *pToken);
+
 IoT_Error_t aws_iot_shadow_internal_get_request_json(char *pBuffer, size_t bufferSize);
 
 IoT_Error_t aws_iot_shadow_internal_delete_request_json(char *pBuffer, size_t bufferSize);
 
+/**
+ * @brief Empty request document whose client token comes from the sequence at pClientTokenNum
+ */
+IoT_Error_t aws_iot_shadow_internal_token_request_json(char *pBuffer, size_t bufferSize, uint32_t *pClientTokenNum);
+
+/**
+ * @brief Same as aws_iot_finalize_json_document, with the client token from the sequence at pClientTokenNum
+ */
+IoT_Error_t aws_iot_shadow_internal_finalize_json_document(char *pJsonDocument, size_t maxSizeOfJsonDocument,
+														   uint32_t *pClientTokenNum);
+
 void resetClientTokenSequenceNum(void);
 
 
@@ -42,6 +94,37 @@ bool isReceivedJsonValid(const char *pJsonDocument, size_t jsonSize);
 
 bool extractClientToken(const char *pJsonDocument, size_t jsonSize, char *pExtractedClientToken, size_t clientTokenSize);
 
+/**
+ * @brief Top level fields of a shadow response
+ */
+typedef struct {
+	bool isObject; ///< The top level value is an object
+	bool isClientTokenPresent; ///< clientToken holds the response's client token
+	char clientToken[MAX_SIZE_CLIENT_ID_WITH_SEQUENCE]; ///< Null terminated client token
+	bool isVersionPresent; ///< version holds the response's version
+	uint32_t version; ///< Version of the shadow document
+} ShadowResponseFields_t;
+
+/**
+ * @brief Validate a response and read its client token and version in one pass, without the jsmn tokens
+ *
+ * @return true when the document is valid JSON with an object at the top level
+ */
+bool extractShadowResponseFields(const char *pJsonDocument, size_t jsonSize, ShadowResponseFields_t *pFields);
+
+/**
+ * @brief Make views of a document in pJsonHandler stale, call before its buffer is overwritten without parsing it
+ */
+void invalidateParsedJson(const char *pJsonDocument, void *pJsonHandler);
+
+/**
+ * @brief Make aws_iot_shadow_json_view_init use other tokens, e.g. around callbacks given a document parsed there
+ *
+ * @param pTokens Tokens for new views, NULL for the ones of the Thing Shadow client
+ * @return The tokens used until now, to select them again afterwards
+ */
+ShadowJsonTokens_t *selectViewJsonTokens(ShadowJsonTokens_t *pTokens);
+
 bool extractVersionNumber(const char *pJsonDocument, void *pJsonHandler, int32_t tokenCount, uint32_t *pVersionNumber);
 
 #ifdef __cplusplus
@@ -26,6 +26,8 @@ extern "C" {
  */
 
 #include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 /**
  * @brief This is a static JSON object that could be used in code
@@ -71,7 +73,7 @@ struct jsonStruct {
 /**
  * @brief Initialize the JSON document with Shadow expected name/value
  *
- * This Function will fill the JSON Buffer with a null terminated string. Internally it uses snprintf
+ * This Function will fill the JSON Buffer with a null terminated string.
  * This function should always be used First, followed by iot_shadow_add_reported and/or iot_shadow_add_desired.
  * Always finish the call sequence with iot_finalize_json_document
  *
@@ -130,6 +132,190 @@ IoT_Error_t aws_iot_shadow_add_desired(char *pJsonDocument, size_t maxSizeOfJson
  */
 IoT_Error_t aws_iot_finalize_json_document(char *pJsonDocument, size_t maxSizeOfJsonDocument);
 
+/**
+ * @brief Shadow JSON document under construction
+ *
+ * The builder remembers where the document ends, so adding to it never rescans what was written before. The
+ * aws_iot_shadow_add_reported / aws_iot_shadow_add_desired / aws_iot_finalize_json_document calls find the end of
+ * the document with strlen on every call; use the builder when a document is assembled from many calls or many
+ * members. Both produce the same text.
+ */
+typedef struct {
+	char *pBuffer; ///< The JSON document, always null terminated
+	size_t bufferSize; ///< Size of pBuffer
+	size_t length; ///< Length of the document so far, excluding the null
+} ShadowJsonBuilder_t;
+
+/**
+ * @brief Start a JSON document in the given buffer, same as aws_iot_shadow_init_json_document
+ *
+ * @param pBuilder Builder to set up
+ * @param pJsonDocument The JSON Document filled in this char buffer
+ * @param maxSizeOfJsonDocument maximum size of the pJsonDocument that can be used to fill the JSON document
+ * @return An IoT Error Type defining if the buffer was null or the entire string was not filled up
+ */
+IoT_Error_t aws_iot_shadow_json_builder_init(ShadowJsonBuilder_t *pBuilder, char *pJsonDocument,
+											 size_t maxSizeOfJsonDocument);
+
+/**
+ * @brief Add the reported section, same as aws_iot_shadow_add_reported
+ *
+ * @param pBuilder Builder set up with aws_iot_shadow_json_builder_init
+ * @param count total number of arguments(jsonStruct_t object) passed in the arguments
+ * @return An IoT Error Type defining if a value was null or the entire string was not filled up
+ */
+IoT_Error_t aws_iot_shadow_json_builder_add_reported(ShadowJsonBuilder_t *pBuilder, uint8_t count, ...);
+
+/**
+ * @brief Add the desired section, same as aws_iot_shadow_add_desired
+ *
+ * @param pBuilder Builder set up with aws_iot_shadow_json_builder_init
+ * @param count total number of arguments(jsonStruct_t object) passed in the arguments
+ * @return An IoT Error Type defining if a value was null or the entire string was not filled up
+ */
+IoT_Error_t aws_iot_shadow_json_builder_add_desired(ShadowJsonBuilder_t *pBuilder, uint8_t count, ...);
+
+/**
+ * @brief Add the reported section from an array of jsonStruct_t pointers
+ *
+ * @param pBuilder Builder set up with aws_iot_shadow_json_builder_init
+ * @param count number of entries in ppStructs
+ * @param ppStructs members of the section, in order
+ * @return An IoT Error Type defining if a value was null or the entire string was not filled up
+ */
+IoT_Error_t aws_iot_shadow_json_builder_add_reported_array(ShadowJsonBuilder_t *pBuilder, uint8_t count,
+														   jsonStruct_t *const *ppStructs);
+
+/**
+ * @brief Add the desired section from an array of jsonStruct_t pointers
+ *
+ * @param pBuilder Builder set up with aws_iot_shadow_json_builder_init
+ * @param count number of entries in ppStructs
+ * @param ppStructs members of the section, in order
+ * @return An IoT Error Type defining if a value was null or the entire string was not filled up
+ */
+IoT_Error_t aws_iot_shadow_json_builder_add_desired_array(ShadowJsonBuilder_t *pBuilder, uint8_t count,
+														  jsonStruct_t *const *ppStructs);
+
+/**
+ * @brief Finalize the document with the client token, same as aws_iot_finalize_json_document
+ *
+ * @param pBuilder Builder set up with aws_iot_shadow_json_builder_init
+ * @return An IoT Error Type defining if the buffer was null or the entire string was not filled up
+ */
+IoT_Error_t aws_iot_shadow_json_builder_finalize(ShadowJsonBuilder_t *pBuilder);
+
+/**
+ * @brief Read-only view of a received shadow document
+ *
+ * The SDK tokenizes every delta it receives before calling the delta callbacks. Responses to requests are only
+ * checked in one streaming pass, and tokenized when the action callback makes a view of them. A view reads the
+ * document through the tokens, so callbacks can look up values by path without copying or parsing it again.
+ * A view stays valid until the SDK tokenizes another document, which can happen on the next yield; accessors
+ * called after that return JSON_PARSE_ERROR. Get a view inside the callback and do not keep it.
+ */
+typedef struct {
+	const char *pJsonDocument; ///< Document the tokens index into
+	struct _ShadowJsonTokens_t *pTokens; ///< Tokens of the document
+	int32_t rootIndex; ///< Token the view starts at
+	uint32_t generation; ///< Parse the tokens came from
+} ShadowJsonView_t;
+
+/**
+ * @brief Get the view of a document passed to a shadow callback
+ *
+ * @param pJson the pReceivedJsonDocument of an action callback, or the pJsonValueBuffer of a delta callback
+ * @param pView view to fill
+ * @return NULL_VALUE_ERROR on missing arguments, JSON_PARSE_ERROR when pJson is inside the last tokenized document
+ *         but no value starts there, or is a document that does not parse
+ */
+IoT_Error_t aws_iot_shadow_json_view_init(const char *pJson, ShadowJsonView_t *pView);
+
+/**
+ * @brief Find a value by path without copying it
+ *
+ * A path is keys separated by dots, such as "state.desired.Name". Inside arrays a key is the decimal index,
+ * such as "state.reported.list.0". The empty path is the root of the view. String values are returned without
+ * their quotes and with escapes as received.
+ *
+ * @param pView view from aws_iot_shadow_json_view_init
+ * @param pPath path of the value
+ * @param ppValue set to the start of the value in the document
+ * @param pValueLength set to the length of the value
+ * @return JSON_KEY_NOT_FOUND_ERROR when the path is not in the document, JSON_PARSE_ERROR when the view is stale
+ */
+IoT_Error_t aws_iot_shadow_json_view_get_raw(const ShadowJsonView_t *pView, const char *pPath,
+											 const char **ppValue, uint32_t *pValueLength);
+
+/**
+ * @brief Get a view of the object or array at a path, to look up many values below it
+ *
+ * @param pView view from aws_iot_shadow_json_view_init
+ * @param pPath path of the value
+ * @param pSubView view to fill
+ * @return JSON_KEY_NOT_FOUND_ERROR when the path is not in the document, JSON_PARSE_ERROR when the view is stale
+ */
+IoT_Error_t aws_iot_shadow_json_view_get_view(const ShadowJsonView_t *pView, const char *pPath,
+											  ShadowJsonView_t *pSubView);
+
+/**
+ * @brief Copy a string value into a null terminated buffer
+ *
+ * @param pView view from aws_iot_shadow_json_view_init
+ * @param pPath path of the value
+ * @param pBuffer buffer to fill
+ * @param bufferLength size of pBuffer
+ * @return JSON_KEY_NOT_FOUND_ERROR when the path is not in the document, SHADOW_JSON_ERROR when the buffer is too
+ *         small, JSON_PARSE_ERROR when the value is not a string or the view is stale
+ */
+IoT_Error_t aws_iot_shadow_json_view_get_string(const ShadowJsonView_t *pView, const char *pPath,
+												char *pBuffer, size_t bufferLength);
+
+/**
+ * @brief Get a signed 32 bit integer value
+ *
+ * @return JSON_KEY_NOT_FOUND_ERROR when the path is not in the document, JSON_PARSE_ERROR when the value is
+ *         not an integer or the view is stale
+ */
+IoT_Error_t aws_iot_shadow_json_view_get_int32(const ShadowJsonView_t *pView, const char *pPath, int32_t *pValue);
+
+/**
+ * @brief Get an unsigned 32 bit integer value
+ *
+ * @return JSON_KEY_NOT_FOUND_ERROR when the path is not in the document, JSON_PARSE_ERROR when the value is
+ *         not an unsigned integer or the view is stale
+ */
+IoT_Error_t aws_iot_shadow_json_view_get_uint32(const ShadowJsonView_t *pView, const char *pPath,
+												uint32_t *pValue);
+
+/**
+ * @brief Get a number value
+ *
+ * @return JSON_KEY_NOT_FOUND_ERROR when the path is not in the document, JSON_PARSE_ERROR when the value is
+ *         not a number or the view is stale
+ */
+IoT_Error_t aws_iot_shadow_json_view_get_double(const ShadowJsonView_t *pView, const char *pPath, double *pValue);
+
+/**
+ * @brief Get a boolean value
+ *
+ * @return JSON_KEY_NOT_FOUND_ERROR when the path is not in the document, JSON_PARSE_ERROR when the value is
+ *         not a boolean or the view is stale
+ */
+IoT_Error_t aws_iot_shadow_json_view_get_bool(const ShadowJsonView_t *pView, const char *pPath, bool *pValue);
+
+/**
+ * @brief Update a jsonStruct_t from the value at a path, the same way a delta updates it
+ *
+ * @param pView view from aws_iot_shadow_json_view_init
+ * @param pPath path of the value
+ * @param pStruct value to update, its type selects how the value is parsed
+ * @return JSON_KEY_NOT_FOUND_ERROR when the path is not in the document, JSON_PARSE_ERROR or SHADOW_JSON_ERROR
+ *         when the value does not fit pStruct, JSON_PARSE_ERROR when the view is stale
+ */
+IoT_Error_t aws_iot_shadow_json_view_get_struct(const ShadowJsonView_t *pView, const char *pPath,
+												jsonStruct_t *pStruct);
+
 /**
  * @brief Fill the given buffer with client token for tracking the Repsonse.
  *
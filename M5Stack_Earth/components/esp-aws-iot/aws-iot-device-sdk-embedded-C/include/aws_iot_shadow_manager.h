@@ -0,0 +1,242 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef AWS_IOT_SDK_SRC_IOT_SHADOW_MANAGER_H_
+#define AWS_IOT_SDK_SRC_IOT_SHADOW_MANAGER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @file aws_iot_shadow_manager.h
+ * @brief Shadows of many things, classic or named, over one MQTT connection
+ *
+ * The Thing Shadow client in aws_iot_shadow_interface.h keeps its state in globals and serves the single thing
+ * given to aws_iot_shadow_connect. A shadow manager instead keeps all of its state in a ShadowManager_t and one
+ * ShadowContext_t per shadow, both allocated by the application, so a gateway can sync the shadows of the devices
+ * attached to it.
+ *
+ * The manager does not subscribe per thing. The first classic shadow added subscribes to three topic filters
+ * shared by every thing:
+ * - $aws/things/+/shadow/update/delta
+ * - $aws/things/+/shadow/+/accepted
+ * - $aws/things/+/shadow/+/rejected
+ *
+ * and the first named shadow to the same three under $aws/things/+/shadow/name/+/. Incoming messages are routed
+ * to their shadow context by the thing and shadow names in the topic. The number of MQTT subscriptions therefore
+ * does not depend on the number of shadows, and memory only grows with the contexts the application adds.
+ * The device policy must allow subscribing to these topic filters.
+ *
+ * Each manager numbers its own client tokens and parses received documents into its own tokens, so it shares no
+ * state with the Thing Shadow client. Update documents built with the Shadow JSON functions are finalized with
+ * aws_iot_shadow_manager_finalize_json_document before they are sent with aws_iot_shadow_manager_update. All
+ * functions and callbacks run in the context that yields the MQTT client, as for the Thing Shadow client.
+ */
+
+#include "aws_iot_shadow_interface.h"
+#include "aws_iot_shadow_json.h"
+#include "timer_interface.h"
+
+#ifndef MAX_SIZE_OF_SHADOW_NAME
+#define MAX_SIZE_OF_SHADOW_NAME 32 ///< Size of the buffer holding a named shadow's name, including the null
+#endif
+
+#ifndef MAX_SHADOW_CONTEXT_DELTA_KEYS
+#define MAX_SHADOW_CONTEXT_DELTA_KEYS 8 ///< Delta keys that can be registered on one shadow context, at most 32
+#endif
+
+#ifndef SHADOW_MANAGER_HASH_BUCKETS
+#define SHADOW_MANAGER_HASH_BUCKETS 16 ///< Buckets of the thing and shadow name lookup, a power of two
+#endif
+
+/**
+ * @brief State of one thing shadow
+ *
+ * Set up with aws_iot_shadow_context_init and handed to the manager with aws_iot_shadow_manager_add. The manager
+ * links contexts together and does not copy them, so a context must stay valid until it is removed.
+ */
+typedef struct _ShadowContext_t ShadowContext_t;
+
+struct _ShadowContext_t {
+	char thingName[MAX_SIZE_OF_THING_NAME]; ///< Thing the shadow belongs to
+	char shadowName[MAX_SIZE_OF_SHADOW_NAME]; ///< Name of a named shadow, empty for the classic shadow
+	jsonStruct_t *pDeltaKeys[MAX_SHADOW_CONTEXT_DELTA_KEYS]; ///< Keys updated from delta documents
+	uint8_t deltaKeyCount; ///< Entries used in pDeltaKeys
+	bool hasPathKeys; ///< One of the keys is a dotted path below "state"
+	bool discardOldDelta; ///< Ignore deltas whose version is not newer than version, true after init
+	uint32_t version; ///< Latest version seen on a delta or get/accepted message of this shadow
+	uint32_t nameHash; ///< Hash of the thing and shadow names, set by the manager
+	ShadowContext_t *pNext; ///< Next context in the same hash bucket, owned by the manager
+};
+
+/**
+ * @brief A request waiting for its accepted or rejected message
+ */
+typedef struct {
+	ShadowContext_t *pShadow; ///< Shadow the request was sent to
+	ShadowActions_t action; ///< Requested action
+	char clientToken[MAX_SIZE_CLIENT_ID_WITH_SEQUENCE]; ///< Client token of the request
+	fpActionCallback_t callback; ///< Called with the response or on timeout
+	void *pCallbackContext; ///< Passed to callback
+	Timer timer; ///< Expires when the response is late
+	bool isFree; ///< Entry unused
+} ShadowManagerAck_t;
+
+/**
+ * @brief Shadows synced over one MQTT client
+ */
+typedef struct {
+	AWS_IoT_Client *pClient; ///< MQTT client the shadows are synced over
+	ShadowContext_t *pBuckets[SHADOW_MANAGER_HASH_BUCKETS]; ///< Shadow contexts by thing and shadow name
+	uint16_t shadowCount; ///< Contexts added
+	bool classicSubscribed; ///< Topic filters of classic shadows subscribed
+	bool namedSubscribed; ///< Topic filters of named shadows subscribed
+	ShadowManagerAck_t acks[MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME]; ///< Requests waiting for a response
+	uint32_t clientTokenNum; ///< Sequence number of the next client token
+	ShadowJsonTokens_t jsonTokens; ///< Tokens of rxBuf
+	char rxBuf[SHADOW_MAX_SIZE_OF_RX_BUFFER]; ///< Received document, null terminated for the JSON parser
+} ShadowManager_t;
+
+/**
+ * @brief Initialize a shadow manager
+ *
+ * Does not talk to the broker. The client only needs to be connected once shadows are added.
+ *
+ * @param pManager Manager to initialize
+ * @param pClient MQTT client, initialized with aws_iot_mqtt_init or aws_iot_shadow_init
+ * @return An IoT Error Type defining successful/failed initialization
+ */
+IoT_Error_t aws_iot_shadow_manager_init(ShadowManager_t *pManager, AWS_IoT_Client *pClient);
+
+/**
+ * @brief Initialize a shadow context
+ *
+ * @param pShadow Context to initialize
+ * @param pThingName Thing the shadow belongs to
+ * @param pShadowName Name of a named shadow, NULL or empty for the classic shadow
+ * @return NULL_VALUE_ERROR without a thing name, FAILURE when a name does not fit, SUCCESS otherwise
+ */
+IoT_Error_t aws_iot_shadow_context_init(ShadowContext_t *pShadow, const char *pThingName, const char *pShadowName);
+
+/**
+ * @brief Register a key that is updated from this shadow's delta documents
+ *
+ * Same as aws_iot_shadow_register_delta for one shadow context. The key is either a key at any depth of the
+ * delta's state, or a dotted path below it (e.g. "light.color"). Keys can be registered before or after the
+ * context is added to a manager.
+ *
+ * @param pShadow Shadow context
+ * @param pStruct Key, value and callback, must stay valid while registered
+ * @return FAILURE when MAX_SHADOW_CONTEXT_DELTA_KEYS keys are registered already, SUCCESS otherwise
+ */
+IoT_Error_t aws_iot_shadow_context_register_delta(ShadowContext_t *pShadow, jsonStruct_t *pStruct);
+
+/**
+ * @brief Start syncing a shadow
+ *
+ * Subscribes to the shared topic filters for classic or named shadows when this is the first shadow of its kind.
+ *
+ * @param pManager Shadow manager
+ * @param pShadow Initialized shadow context
+ * @return FAILURE when a context for the same shadow was added already, otherwise the result of subscribing
+ */
+IoT_Error_t aws_iot_shadow_manager_add(ShadowManager_t *pManager, ShadowContext_t *pShadow);
+
+/**
+ * @brief Stop syncing a shadow
+ *
+ * Requests still waiting for a response from this shadow are dropped without calling their callback. Removing the
+ * last shadow unsubscribes from the shared topic filters. Filters that could not be unsubscribed stay registered
+ * with the MQTT client and serve the next shadow added.
+ *
+ * @param pManager Shadow manager
+ * @param pShadow Context added with aws_iot_shadow_manager_add
+ * @return FAILURE when the context was not added to this manager, the first failure to unsubscribe after the last
+ *         shadow was removed, SUCCESS otherwise
+ */
+IoT_Error_t aws_iot_shadow_manager_remove(ShadowManager_t *pManager, ShadowContext_t *pShadow);
+
+/**
+ * @brief Add the client token to a document, same as aws_iot_finalize_json_document for this manager
+ *
+ * @param pManager Shadow manager whose client token sequence is used
+ * @param pJsonDocument Document started with aws_iot_shadow_init_json_document
+ * @param maxSizeOfJsonDocument Size of the buffer holding the document
+ * @return An IoT Error Type defining if the buffer was null or the entire string was not filled up
+ */
+IoT_Error_t aws_iot_shadow_manager_finalize_json_document(ShadowManager_t *pManager, char *pJsonDocument,
+														  size_t maxSizeOfJsonDocument);
+
+/**
+ * @brief Publish an update document to a shadow
+ *
+ * The document is sent as is. When it carries a client token and a callback is given, the callback is called
+ * with the accepted or rejected response, or with SHADOW_ACK_TIMEOUT.
+ *
+ * @param pManager Shadow manager
+ * @param pShadow Context added with aws_iot_shadow_manager_add
+ * @param pJsonDocument Null terminated update document
+ * @param callback Response callback, may be NULL
+ * @param pContextData Passed to callback
+ * @param timeout_seconds Time to wait for the response
+ * @return An IoT Error Type defining successful/failed publish
+ */
+IoT_Error_t aws_iot_shadow_manager_update(ShadowManager_t *pManager, ShadowContext_t *pShadow,
+										  const char *pJsonDocument, fpActionCallback_t callback, void *pContextData,
+										  uint8_t timeout_seconds);
+
+/**
+ * @brief Request a shadow's document
+ *
+ * @param pManager Shadow manager
+ * @param pShadow Context added with aws_iot_shadow_manager_add
+ * @param callback Called with the document, the rejection or on timeout
+ * @param pContextData Passed to callback
+ * @param timeout_seconds Time to wait for the response
+ * @return An IoT Error Type defining successful/failed publish
+ */
+IoT_Error_t aws_iot_shadow_manager_get(ShadowManager_t *pManager, ShadowContext_t *pShadow,
+									   fpActionCallback_t callback, void *pContextData, uint8_t timeout_seconds);
+
+/**
+ * @brief Delete a shadow's document
+ *
+ * @param pManager Shadow manager
+ * @param pShadow Context added with aws_iot_shadow_manager_add
+ * @param callback Called with the response or on timeout, may be NULL
+ * @param pContextData Passed to callback
+ * @param timeout_seconds Time to wait for the response
+ * @return An IoT Error Type defining successful/failed publish
+ */
+IoT_Error_t aws_iot_shadow_manager_delete(ShadowManager_t *pManager, ShadowContext_t *pShadow,
+										  fpActionCallback_t callback, void *pContextData, uint8_t timeout_seconds);
+
+/**
+ * @brief Time out late responses, then yield the MQTT client
+ *
+ * Same as aws_iot_shadow_yield for the shadows of this manager.
+ *
+ * @param pManager Shadow manager
+ * @param timeout Time to yield in milliseconds
+ * @return An IoT Error Type defining successful/failed yield
+ */
+IoT_Error_t aws_iot_shadow_manager_yield(ShadowManager_t *pManager, uint32_t timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_SDK_SRC_IOT_SHADOW_MANAGER_H_ */
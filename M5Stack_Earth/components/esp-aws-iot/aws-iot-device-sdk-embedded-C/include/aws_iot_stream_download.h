@@ -0,0 +1,190 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+#ifndef AWS_IOT_STREAM_DOWNLOAD_H_
+#define AWS_IOT_STREAM_DOWNLOAD_H_
+
+/**
+ * @file aws_iot_stream_download.h
+ * @brief Downloads a file of an AWS IoT stream over MQTT with several block requests in flight
+ *
+ * A stream file is fetched in blocks: a GetStream request on $aws/things/<thing>/streams/<stream>/get/json asks for
+ * a range of blocks, and every block comes back as its own message on .../data/json. Waiting for each response
+ * before sending the next request leaves the link idle for a round trip per request, so the download keeps up to
+ * requestsInFlight requests of blocksPerRequest blocks out at a time and sends the next one as soon as a range is
+ * complete, like a sliding window over the file.
+ *
+ * Blocks may arrive in any order and more than once. The download tracks them in a bitmap owned by the application,
+ * one bit per block set once the block was written. Restoring a saved bitmap before aws_iot_stream_download_start
+ * resumes the download after a reboot: only the blocks with a clear bit are requested.
+ *
+ * Block payloads are base64 decoded in place in the MQTT receive buffer and handed to the write function there,
+ * so the receive buffer bounds the block size. All functions must be called in the task that yields the client.
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "aws_iot_config.h"
+#include "aws_iot_mqtt_client_interface.h"
+#include "timer_interface.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MAX_SIZE_OF_STREAM_NAME
+#define MAX_SIZE_OF_STREAM_NAME 64 ///< Size of the buffer holding a stream name, including the null
+#endif
+
+#ifndef STREAM_DOWNLOAD_MAX_REQUESTS
+#define STREAM_DOWNLOAD_MAX_REQUESTS 8 ///< Block requests a download can have in flight
+#endif
+
+#define STREAM_DOWNLOAD_TOPIC_LENGTH (32 + MAX_SIZE_OF_THING_NAME + MAX_SIZE_OF_STREAM_NAME) ///< Size of a topic buffer
+#define STREAM_DOWNLOAD_MIN_BLOCK_SIZE 256 ///< Smallest block size the service accepts
+
+/**
+ * @brief Bytes of bitmap needed for a file
+ */
+#define STREAM_DOWNLOAD_BITMAP_SIZE(fileSize, blockSize) (((fileSize) / (blockSize) + 8) / 8)
+
+/**
+ * @brief Store a received block
+ *
+ * @param pContext pWriteContext of the parameters
+ * @param blockIndex Index of the block, its offset in the file is blockIndex * blockSize
+ * @param pData Block data, valid during the call
+ * @param length Bytes of the block, blockSize except for the last block
+ * @return SUCCESS once the block is stored. Other values fail the download
+ */
+typedef IoT_Error_t (*StreamDownloadWrite_t)(void *pContext, uint32_t blockIndex, const uint8_t *pData,
+											 size_t length);
+
+/**
+ * @brief Parameters of a download
+ */
+typedef struct {
+	const char *pThingName; ///< Thing the stream is requested for
+	const char *pStreamName; ///< Stream ID
+	uint32_t fileId; ///< File of the stream
+	uint32_t fileSize; ///< Bytes in the file
+	uint32_t blockSize; ///< Bytes per block, at least STREAM_DOWNLOAD_MIN_BLOCK_SIZE
+	uint16_t blocksPerRequest; ///< Blocks asked for in one request
+	uint8_t requestsInFlight; ///< Requests sent before waiting, at most STREAM_DOWNLOAD_MAX_REQUESTS
+	uint8_t maxRetries; ///< Times a request with missing blocks is sent again before the download fails
+	uint32_t requestTimeoutMs; ///< Time without a new block of a request before its missing blocks are asked again
+	uint8_t *pBitmap; ///< STREAM_DOWNLOAD_BITMAP_SIZE bytes, bits set for the blocks already written
+	StreamDownloadWrite_t write; ///< Stores the received blocks
+	void *pWriteContext; ///< Passed to write
+} StreamDownloadParams_t;
+
+extern const StreamDownloadParams_t streamDownloadParamsDefault;
+
+#define StreamDownloadParams_initializer {NULL, NULL, 0, 0, 1024, 8, 4, 5, 5000, NULL, NULL, NULL}
+
+/**
+ * @brief State of a download
+ */
+typedef enum {
+	STREAM_DOWNLOAD_IDLE, ///< Initialized, not started
+	STREAM_DOWNLOAD_RUNNING, ///< Requesting blocks
+	STREAM_DOWNLOAD_COMPLETE, ///< Every block was written
+	STREAM_DOWNLOAD_FAILED ///< Rejected by the service, out of retries or a block could not be written
+} StreamDownloadState_t;
+
+/**
+ * @brief Range of blocks asked for in one request
+ */
+typedef struct {
+	bool isInUse; ///< The request was sent and has missing blocks
+	uint8_t retries; ///< Times the request was sent again
+	uint32_t firstBlock; ///< First block of the range
+	uint32_t blockCount; ///< Blocks in the range
+	Timer timer; ///< Expires when the request is late, restarted by each block of the range
+} StreamDownloadRequest_t;
+
+/**
+ * @brief Download of one stream file, allocated by the application
+ */
+typedef struct {
+	AWS_IoT_Client *pClient; ///< MQTT client the blocks are received over
+	StreamDownloadParams_t params; ///< Parameters given at init
+	char dataTopic[STREAM_DOWNLOAD_TOPIC_LENGTH]; ///< Subscribed topic of the blocks
+	char rejectedTopic[STREAM_DOWNLOAD_TOPIC_LENGTH]; ///< Subscribed topic of rejected requests
+	char getTopic[STREAM_DOWNLOAD_TOPIC_LENGTH]; ///< Topic the requests are sent to
+	char message[96]; ///< Request being sent
+	uint8_t state; ///< StreamDownloadState_t
+	bool isSubscribed; ///< Topics subscribed by aws_iot_stream_download_start
+	uint32_t blockCount; ///< Blocks in the file
+	uint32_t receivedCount; ///< Bits set in the bitmap
+	uint32_t nextBlock; ///< First block not asked for by a request yet
+	uint32_t requestSequence; ///< Client token of the last request
+	StreamDownloadRequest_t requests[STREAM_DOWNLOAD_MAX_REQUESTS]; ///< Requests in flight
+	uint32_t requestsSent; ///< Requests sent, retries included
+	uint32_t duplicateBlocks; ///< Blocks received after they were written
+	IoT_Error_t failure; ///< Why the download failed
+} StreamDownload_t;
+
+/**
+ * @brief Initialize a download
+ *
+ * Counts the blocks already set in the bitmap. Does not talk to the broker.
+ *
+ * @param pDownload Download to initialize
+ * @param pClient MQTT client, initialized with aws_iot_mqtt_init
+ * @param pParams Parameters, all pointers are required and must stay valid during the download
+ * @return NULL_VALUE_ERROR on missing arguments, FAILURE on a block size, window or name that does not fit,
+ *         SUCCESS otherwise
+ */
+IoT_Error_t aws_iot_stream_download_init(StreamDownload_t *pDownload, AWS_IoT_Client *pClient,
+										 const StreamDownloadParams_t *pParams);
+
+/**
+ * @brief Subscribe to the stream topics and request blocks on the next aws_iot_stream_download_process
+ *
+ * The device policy must allow subscribing to data/json and rejected/json of the stream, and publishing to
+ * get/json.
+ *
+ * @param pDownload Initialized download
+ * @return The result of subscribing
+ */
+IoT_Error_t aws_iot_stream_download_start(StreamDownload_t *pDownload);
+
+/**
+ * @brief Send requests for the free slots of the window and ask again for the missing blocks of late ones
+ *
+ * Call it after every yield of the client while the download is running.
+ *
+ * @param pDownload Started download
+ * @return The state of the download, a StreamDownloadState_t
+ */
+StreamDownloadState_t aws_iot_stream_download_process(StreamDownload_t *pDownload);
+
+/**
+ * @brief Unsubscribe from the stream topics
+ *
+ * The bitmap keeps the blocks written so far for a later download of the same file.
+ *
+ * @param pDownload Download
+ * @return The result of unsubscribing
+ */
+IoT_Error_t aws_iot_stream_download_stop(StreamDownload_t *pDownload);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_STREAM_DOWNLOAD_H_ */
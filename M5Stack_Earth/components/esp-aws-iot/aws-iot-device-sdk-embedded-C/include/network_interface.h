@@ -57,6 +57,18 @@ typedef struct {
 	bool ServerVerificationFlag;        ///< Boolean.  True = perform server certificate hostname validation.  False = skip validation \b NOT recommended.
 } TLSConnectParams;
 
+/**
+ * @brief Network Connect Timing
+ *
+ * Duration of the phases of the last connect. Filled in by the network layer,
+ * phases it cannot measure are left at 0.
+ */
+typedef struct {
+	uint32_t dnsLookupMs;        ///< Time spent resolving the host name
+	uint32_t tcpConnectMs;        ///< Time spent establishing the TCP connection
+	uint32_t tlsHandshakeMs;    ///< Time spent in the TLS handshake
+} NetworkConnectTiming;
+
 /**
  * @brief Network Structure
  *
@@ -70,9 +82,12 @@ struct Network {
 	IoT_Error_t (*disconnect)(Network *);    ///< Function pointer pointing to the network function to disconnect from the network
 	IoT_Error_t (*isConnected)(Network *);    ///< Function pointer pointing to the network function to check if TLS is connected
 	IoT_Error_t (*destroy)(Network *);        ///< Function pointer pointing to the network function to destroy the network object
+	IoT_Error_t (*waitForReadable)(Network *, uint32_t);    ///< Optional. Function pointer pointing to the network function that blocks until data is readable. NULL if the platform only supports polling
+	IoT_Error_t (*wakeup)(Network *);    ///< Optional. Function pointer pointing to the network function that interrupts a blocked waitForReadable. NULL if not supported
 
 	TLSConnectParams tlsConnectParams;        ///< TLSConnect params structure containing the common connection parameters
 	TLSDataParams tlsDataParams;            ///< TLSData params structure containing the connection data parameters that are specific to the library being used
+	NetworkConnectTiming connectTiming;        ///< Phase timing of the last connect, filled in by the connect function
 };
 
 /**
@@ -132,6 +147,30 @@ IoT_Error_t iot_tls_write(Network *, unsigned char *, size_t, Timer *, size_t *)
  */
 IoT_Error_t iot_tls_read(Network *, unsigned char *, size_t, Timer *, size_t *);
 
+/**
+ * @brief Block until the network socket has data to read
+ *
+ * Waits until the connection has readable data (including data already decrypted and
+ * buffered by the TLS layer), the timeout expires or iot_tls_wakeup is called from
+ * another task. Used by the MQTT yield to sleep instead of polling the socket.
+ *
+ * @param pNetwork - Pointer to a Network struct defining the network interface.
+ * @param timeout_ms - Maximum time to block in milliseconds. Zero polls without blocking.
+ * @return IoT_Error_t - SUCCESS if data is readable, NETWORK_SSL_NOTHING_TO_READ on timeout,
+ *                       NETWORK_WAKEUP_REQUESTED if woken up, or TLS error code
+ */
+IoT_Error_t iot_tls_wait_for_readable(Network *pNetwork, uint32_t timeout_ms);
+
+/**
+ * @brief Interrupt a blocked iot_tls_wait_for_readable
+ *
+ * Safe to call from any task. If no wait is in progress, the next wait returns immediately.
+ *
+ * @param pNetwork - Pointer to a Network struct defining the network interface.
+ * @return IoT_Error_t - successful wake-up request or TLS error code
+ */
+IoT_Error_t iot_tls_wakeup(Network *pNetwork);
+
 /**
  * @brief Disconnect from network socket
  *
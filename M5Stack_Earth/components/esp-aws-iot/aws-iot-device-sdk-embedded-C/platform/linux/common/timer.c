@@ -30,9 +30,18 @@ extern "C" {
 
 #include "timer_platform.h"
 
+/* Added to the time of day, so that host tests can run out timers without waiting */
+static struct timeval clockOffset = {0, 0};
+
+static void get_time_now(struct timeval *now) {
+	struct timeval timeOfDay;
+	gettimeofday(&timeOfDay, NULL);
+	timeradd(&timeOfDay, &clockOffset, now);
+}
+
 bool has_timer_expired(Timer *timer) {
 	struct timeval now, res;
-	gettimeofday(&now, NULL);
+	get_time_now(&now);
 	timersub(&timer->end_time, &now, &res);
 	return res.tv_sec < 0 || (res.tv_sec == 0 && res.tv_usec <= 0);
 }
@@ -44,14 +53,14 @@ void countdown_ms(Timer *timer, uint32_t timeout) {
 #else
 	struct timeval interval = {timeout / 1000, (int)((timeout % 1000) * 1000)};
 #endif
-	gettimeofday(&now, NULL);
+	get_time_now(&now);
 	timeradd(&now, &interval, &timer->end_time);
 }
 
 uint32_t left_ms(Timer *timer) {
 	struct timeval now, res;
 	uint32_t result_ms = 0;
-	gettimeofday(&now, NULL);
+	get_time_now(&now);
 	timersub(&timer->end_time, &now, &res);
 	if(res.tv_sec >= 0) {
 		result_ms = (uint32_t) (res.tv_sec * 1000 + res.tv_usec / 1000);
@@ -62,7 +71,7 @@ uint32_t left_ms(Timer *timer) {
 void countdown_sec(Timer *timer, uint32_t timeout) {
 	struct timeval now;
 	struct timeval interval = {timeout, 0};
-	gettimeofday(&now, NULL);
+	get_time_now(&now);
 	timeradd(&now, &interval, &timer->end_time);
 }
 
@@ -70,6 +79,11 @@ void init_timer(Timer *timer) {
 	timer->end_time = (struct timeval) {0, 0};
 }
 
+void advance_timer_clock_ms(uint32_t milliseconds) {
+	struct timeval interval = {milliseconds / 1000, (int)((milliseconds % 1000) * 1000)};
+	timeradd(&clockOffset, &interval, &clockOffset);
+}
+
 void delay(unsigned milliseconds)
 {
 	useconds_t sleepTime = (useconds_t)(milliseconds * 1000);
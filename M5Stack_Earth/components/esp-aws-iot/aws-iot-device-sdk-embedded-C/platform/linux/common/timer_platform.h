@@ -41,6 +41,15 @@ struct Timer {
  */
 void delay(unsigned milliseconds);
 
+/**
+ * @brief Move the clock of all timers forward without waiting.
+ *
+ * For host tests of timeouts. The time of day itself is not changed.
+ *
+ * @param milliseconds The number of milliseconds to add.
+ */
+void advance_timer_clock_ms(uint32_t milliseconds);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,503 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_delta_patch.c
+ * @brief Streaming decompression and application of binary delta patches
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aws_iot_delta_patch.h"
+
+#include <string.h>
+
+#include "aws_iot_log.h"
+
+#if DELTA_PATCH_MAX_WINDOW_BITS < DELTA_PATCH_MIN_WINDOW_BITS || DELTA_PATCH_MAX_WINDOW_BITS > 16
+#error "DELTA_PATCH_MAX_WINDOW_BITS must be 8 to 16"
+#endif
+
+#if DELTA_PATCH_SOURCE_BUFFER_SIZE > 0xFFFF || DELTA_PATCH_TARGET_BUFFER_SIZE > 0xFFFF
+#error "The delta patch buffers must be smaller than 64 KB"
+#endif
+
+#define DELTA_PATCH_NIBBLE_EXTENDED 15
+#define DELTA_PATCH_MIN_MATCH 3 ///< Added to the match nibble, whose 0 means no match
+
+static const uint8_t deltaPatchMagic[4] = {'D', 'P', 'A', 'T'};
+
+enum {
+	SEQUENCE_TOKEN,
+	SEQUENCE_LITERAL_COUNT, ///< Bytes extending a literal nibble of 15
+	SEQUENCE_LITERALS,
+	SEQUENCE_OFFSET_LOW,
+	SEQUENCE_OFFSET_HIGH,
+	SEQUENCE_MATCH_LENGTH ///< Bytes extending a match nibble of 15
+};
+
+enum {
+	COMMAND_SEEK,
+	COMMAND_DIFF_LENGTH,
+	COMMAND_EXTRA_LENGTH,
+	COMMAND_DIFF,
+	COMMAND_EXTRA,
+	COMMAND_DONE ///< The target is complete, nothing may follow
+};
+
+static uint32_t readLittleEndian32(const uint8_t *pData) {
+	return (uint32_t) pData[0] | ((uint32_t) pData[1] << 8) | ((uint32_t) pData[2] << 16) | ((uint32_t) pData[3] << 24);
+}
+
+static IoT_Error_t flushTarget(DeltaPatch_t *pPatch) {
+	IoT_Error_t rc;
+
+	if(0 == pPatch->targetLength) {
+		return SUCCESS;
+	}
+	rc = pPatch->params.writeTarget(pPatch->params.pContext, pPatch->targetPosition - pPatch->targetLength,
+									pPatch->targetData, pPatch->targetLength);
+	pPatch->targetLength = 0;
+	return rc;
+}
+
+/* The source buffer only ever holds bytes of the current diff, so it is empty when the source position seeks */
+static IoT_Error_t fillSource(DeltaPatch_t *pPatch) {
+	size_t length = pPatch->diffLength;
+	IoT_Error_t rc;
+
+	if(length > DELTA_PATCH_SOURCE_BUFFER_SIZE) {
+		length = DELTA_PATCH_SOURCE_BUFFER_SIZE;
+	}
+	rc = pPatch->params.readSource(pPatch->params.pContext, (uint32_t) pPatch->sourcePosition, pPatch->sourceData,
+								   length);
+	pPatch->sourceStart = 0;
+	pPatch->sourceEnd = (uint16_t) length;
+	return rc;
+}
+
+static IoT_Error_t startCommand(DeltaPatch_t *pPatch) {
+	uint32_t targetLeft = pPatch->header.targetSize - pPatch->targetPosition;
+
+	/* Every command makes progress, so a corrupt patch cannot expand into endless empty commands */
+	if(0 == pPatch->diffLength && 0 == pPatch->extraLength) {
+		IOT_ERROR("Empty delta patch command");
+		return FAILURE;
+	}
+	if(pPatch->diffLength > targetLeft || pPatch->extraLength > targetLeft - pPatch->diffLength) {
+		IOT_ERROR("Delta patch command writes past the end of the target");
+		return FAILURE;
+	}
+	if(pPatch->diffLength > 0 && (pPatch->sourcePosition < 0 || pPatch->sourcePosition + pPatch->diffLength
+																 > (int64_t) pPatch->header.sourceSize)) {
+		IOT_ERROR("Delta patch command reads outside of the source");
+		return FAILURE;
+	}
+
+	pPatch->commandState = pPatch->diffLength > 0 ? COMMAND_DIFF : COMMAND_EXTRA;
+	return SUCCESS;
+}
+
+static IoT_Error_t endCommand(DeltaPatch_t *pPatch) {
+	if(pPatch->targetPosition == pPatch->header.targetSize) {
+		pPatch->commandState = COMMAND_DONE;
+		return flushTarget(pPatch);
+	}
+	pPatch->commandState = COMMAND_SEEK;
+	return SUCCESS;
+}
+
+/* Takes the next LEB128 byte, *pIsComplete tells whether the number ended */
+static IoT_Error_t readNumber(DeltaPatch_t *pPatch, uint8_t byte, bool *pIsComplete) {
+	if(pPatch->numberShift > 28 || (28 == pPatch->numberShift && (byte & 0x70))) {
+		IOT_ERROR("Delta patch number does not fit 32 bits");
+		return FAILURE;
+	}
+	pPatch->number |= (uint32_t) (byte & 0x7F) << pPatch->numberShift;
+	pPatch->numberShift += 7;
+	*pIsComplete = 0 == (byte & 0x80);
+	return SUCCESS;
+}
+
+/* Runs the commands over decompressed bytes */
+static IoT_Error_t applyCommands(DeltaPatch_t *pPatch, const uint8_t *pData, size_t length) {
+	IoT_Error_t rc = SUCCESS;
+	bool isComplete;
+	size_t count;
+	size_t i;
+	uint8_t *pTarget;
+	const uint8_t *pSource;
+
+	while(length > 0 && SUCCESS == rc) {
+		switch(pPatch->commandState) {
+			case COMMAND_SEEK:
+			case COMMAND_DIFF_LENGTH:
+			case COMMAND_EXTRA_LENGTH:
+				rc = readNumber(pPatch, *pData, &isComplete);
+				pData++;
+				length--;
+				if(SUCCESS != rc || !isComplete) {
+					break;
+				}
+				if(COMMAND_SEEK == pPatch->commandState) {
+					/* Zigzag, 0 -1 1 -2 2 ... */
+					pPatch->sourcePosition += (pPatch->number & 1) ? -(int64_t) (pPatch->number >> 1) - 1
+																	: (int64_t) (pPatch->number >> 1);
+				} else if(COMMAND_DIFF_LENGTH == pPatch->commandState) {
+					pPatch->diffLength = pPatch->number;
+				} else {
+					pPatch->extraLength = pPatch->number;
+				}
+				pPatch->number = 0;
+				pPatch->numberShift = 0;
+				if(COMMAND_EXTRA_LENGTH != pPatch->commandState) {
+					pPatch->commandState++;
+					break;
+				}
+				rc = startCommand(pPatch);
+				break;
+			case COMMAND_DIFF:
+				if(pPatch->sourceStart == pPatch->sourceEnd) {
+					rc = fillSource(pPatch);
+					if(SUCCESS != rc) {
+						break;
+					}
+				}
+				count = length;
+				if(count > pPatch->diffLength) {
+					count = pPatch->diffLength;
+				}
+				if(count > (size_t) (pPatch->sourceEnd - pPatch->sourceStart)) {
+					count = pPatch->sourceEnd - pPatch->sourceStart;
+				}
+				if(count > (size_t) (DELTA_PATCH_TARGET_BUFFER_SIZE - pPatch->targetLength)) {
+					count = DELTA_PATCH_TARGET_BUFFER_SIZE - pPatch->targetLength;
+				}
+				pTarget = pPatch->targetData + pPatch->targetLength;
+				pSource = pPatch->sourceData + pPatch->sourceStart;
+				for(i = 0; i < count; i++) {
+					pTarget[i] = (uint8_t) (pSource[i] + pData[i]);
+				}
+				pData += count;
+				length -= count;
+				pPatch->sourceStart += count;
+				pPatch->sourcePosition += count;
+				pPatch->diffLength -= count;
+				pPatch->targetLength += count;
+				pPatch->targetPosition += count;
+				if(DELTA_PATCH_TARGET_BUFFER_SIZE == pPatch->targetLength) {
+					rc = flushTarget(pPatch);
+				}
+				if(SUCCESS == rc && 0 == pPatch->diffLength) {
+					if(pPatch->extraLength > 0) {
+						pPatch->commandState = COMMAND_EXTRA;
+					} else {
+						rc = endCommand(pPatch);
+					}
+				}
+				break;
+			case COMMAND_EXTRA:
+				count = length;
+				if(count > pPatch->extraLength) {
+					count = pPatch->extraLength;
+				}
+				if(count > (size_t) (DELTA_PATCH_TARGET_BUFFER_SIZE - pPatch->targetLength)) {
+					count = DELTA_PATCH_TARGET_BUFFER_SIZE - pPatch->targetLength;
+				}
+				memcpy(pPatch->targetData + pPatch->targetLength, pData, count);
+				pData += count;
+				length -= count;
+				pPatch->extraLength -= count;
+				pPatch->targetLength += count;
+				pPatch->targetPosition += count;
+				if(DELTA_PATCH_TARGET_BUFFER_SIZE == pPatch->targetLength) {
+					rc = flushTarget(pPatch);
+				}
+				if(SUCCESS == rc && 0 == pPatch->extraLength) {
+					rc = endCommand(pPatch);
+				}
+				break;
+			default:
+				IOT_ERROR("Delta patch continues after the end of the target");
+				rc = FAILURE;
+				break;
+		}
+	}
+
+	return rc;
+}
+
+static IoT_Error_t copyLiterals(DeltaPatch_t *pPatch, const uint8_t *pData, size_t length) {
+	uint32_t windowSize = pPatch->windowMask + 1;
+	const uint8_t *pKept = pData;
+	size_t kept = length;
+	uint32_t offset;
+	size_t count;
+
+	/* The last window size bytes are all a match can refer to */
+	if(kept > windowSize) {
+		pKept += kept - windowSize;
+		pPatch->windowPosition += (uint32_t) (kept - windowSize);
+		kept = windowSize;
+	}
+	offset = pPatch->windowPosition & pPatch->windowMask;
+	count = windowSize - offset;
+	if(count > kept) {
+		count = kept;
+	}
+	memcpy(pPatch->window + offset, pKept, count);
+	memcpy(pPatch->window, pKept + count, kept - count);
+	pPatch->windowPosition += (uint32_t) kept;
+
+	return applyCommands(pPatch, pData, length);
+}
+
+/* Each run copied in the window is contiguous there and is applied from it */
+static IoT_Error_t copyMatch(DeltaPatch_t *pPatch) {
+	uint32_t windowSize = pPatch->windowMask + 1;
+	uint32_t length = pPatch->matchLength;
+	uint32_t offset = pPatch->matchOffset;
+	uint32_t to;
+	uint32_t from;
+	uint32_t count;
+	IoT_Error_t rc = SUCCESS;
+
+	while(length > 0 && SUCCESS == rc) {
+		to = pPatch->windowPosition & pPatch->windowMask;
+		from = (pPatch->windowPosition - offset) & pPatch->windowMask;
+		count = windowSize - to;
+		if(count > length) {
+			count = length;
+		}
+		if(1 == offset) {
+			memset(pPatch->window + to, pPatch->window[from], count);
+		} else {
+			/* Copying at most offset bytes never reads a byte this copy writes */
+			if(count > windowSize - from) {
+				count = windowSize - from;
+			}
+			if(count > offset) {
+				count = offset;
+			}
+			memmove(pPatch->window + to, pPatch->window + from, count);
+		}
+		pPatch->windowPosition += count;
+		length -= count;
+		rc = applyCommands(pPatch, pPatch->window + to, count);
+	}
+
+	return rc;
+}
+
+static IoT_Error_t endLiterals(DeltaPatch_t *pPatch) {
+	pPatch->sequenceState = (pPatch->token & 0x0F) ? SEQUENCE_OFFSET_LOW : SEQUENCE_TOKEN;
+	return SUCCESS;
+}
+
+static IoT_Error_t startMatch(DeltaPatch_t *pPatch) {
+	if(0 == pPatch->matchOffset || pPatch->matchOffset > pPatch->windowMask + 1
+	   || pPatch->matchOffset > pPatch->windowPosition) {
+		IOT_ERROR("Delta patch match offset %u is outside of the window", (unsigned) pPatch->matchOffset);
+		return FAILURE;
+	}
+	pPatch->sequenceState = SEQUENCE_TOKEN;
+	return copyMatch(pPatch);
+}
+
+static IoT_Error_t startHeader(DeltaPatch_t *pPatch) {
+	IoT_Error_t rc;
+
+	rc = aws_iot_delta_patch_read_header(pPatch->headerData, DELTA_PATCH_HEADER_SIZE, &pPatch->header);
+	if(SUCCESS != rc) {
+		return rc;
+	}
+	if(pPatch->header.windowBits > DELTA_PATCH_MAX_WINDOW_BITS || pPatch->header.sourceSize > pPatch->params.maxSourceSize
+	   || 0 == pPatch->header.targetSize || pPatch->header.targetSize > pPatch->params.maxTargetSize) {
+		IOT_ERROR("Delta patch window or image sizes exceed the limits");
+		return MAX_SIZE_ERROR;
+	}
+
+	pPatch->windowMask = (1u << pPatch->header.windowBits) - 1;
+	return SUCCESS;
+}
+
+IoT_Error_t aws_iot_delta_patch_read_header(const uint8_t *pData, size_t length, DeltaPatchHeader_t *pHeader) {
+	FUNC_ENTRY;
+
+	if(NULL == pData || NULL == pHeader) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+	if(length < DELTA_PATCH_HEADER_SIZE || 0 != memcmp(pData, deltaPatchMagic, sizeof(deltaPatchMagic))
+	   || DELTA_PATCH_VERSION != pData[4] || pData[5] < DELTA_PATCH_MIN_WINDOW_BITS || pData[5] > 16) {
+		IOT_ERROR("Not a delta patch of version %d", DELTA_PATCH_VERSION);
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	pHeader->windowBits = pData[5];
+	pHeader->sourceSize = readLittleEndian32(pData + 8);
+	pHeader->targetSize = readLittleEndian32(pData + 12);
+	memcpy(pHeader->sourceHash, pData + 16, DELTA_PATCH_HASH_SIZE);
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_delta_patch_init(DeltaPatch_t *pPatch, const DeltaPatchParams_t *pParams) {
+	FUNC_ENTRY;
+
+	if(NULL == pPatch || NULL == pParams || NULL == pParams->readSource || NULL == pParams->writeTarget) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	memset(pPatch, 0, sizeof(DeltaPatch_t));
+	pPatch->params = *pParams;
+	pPatch->error = SUCCESS;
+	pPatch->sequenceState = SEQUENCE_TOKEN;
+	pPatch->commandState = COMMAND_SEEK;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_delta_patch_feed(DeltaPatch_t *pPatch, const uint8_t *pData, size_t length) {
+	const uint8_t *pEnd;
+	IoT_Error_t rc = SUCCESS;
+	size_t count;
+	uint8_t byte;
+
+	if(NULL == pPatch || (NULL == pData && length > 0)) {
+		return NULL_VALUE_ERROR;
+	}
+	if(SUCCESS != pPatch->error) {
+		return pPatch->error;
+	}
+
+	pEnd = pData + length;
+
+	if(pPatch->headerLength < DELTA_PATCH_HEADER_SIZE) {
+		count = DELTA_PATCH_HEADER_SIZE - pPatch->headerLength;
+		if(count > length) {
+			count = length;
+		}
+		memcpy(pPatch->headerData + pPatch->headerLength, pData, count);
+		pPatch->headerLength += count;
+		pData += count;
+		if(DELTA_PATCH_HEADER_SIZE == pPatch->headerLength) {
+			rc = startHeader(pPatch);
+		}
+	}
+
+	while(pData < pEnd && SUCCESS == rc) {
+		if(SEQUENCE_LITERALS == pPatch->sequenceState) {
+			count = pEnd - pData;
+			if(count > pPatch->literalCount) {
+				count = pPatch->literalCount;
+			}
+			rc = copyLiterals(pPatch, pData, count);
+			pData += count;
+			pPatch->literalCount -= count;
+			if(SUCCESS == rc && 0 == pPatch->literalCount) {
+				rc = endLiterals(pPatch);
+			}
+			continue;
+		}
+
+		byte = *pData++;
+		switch(pPatch->sequenceState) {
+			case SEQUENCE_TOKEN:
+				if(0 == byte) {
+					IOT_ERROR("Empty delta patch sequence");
+					rc = FAILURE;
+					break;
+				}
+				pPatch->token = byte;
+				pPatch->literalCount = byte >> 4;
+				pPatch->matchLength = (byte & 0x0F) + DELTA_PATCH_MIN_MATCH;
+				if(DELTA_PATCH_NIBBLE_EXTENDED == pPatch->literalCount) {
+					pPatch->sequenceState = SEQUENCE_LITERAL_COUNT;
+				} else if(pPatch->literalCount > 0) {
+					pPatch->sequenceState = SEQUENCE_LITERALS;
+				} else {
+					rc = endLiterals(pPatch);
+				}
+				break;
+			case SEQUENCE_LITERAL_COUNT:
+				/* No image comes close, this only keeps the count from wrapping */
+				if(pPatch->literalCount > 0x7FFFFFFF) {
+					rc = FAILURE;
+					break;
+				}
+				pPatch->literalCount += byte;
+				if(255 != byte) {
+					pPatch->sequenceState = SEQUENCE_LITERALS;
+				}
+				break;
+			case SEQUENCE_OFFSET_LOW:
+				pPatch->matchOffset = byte;
+				pPatch->sequenceState = SEQUENCE_OFFSET_HIGH;
+				break;
+			case SEQUENCE_OFFSET_HIGH:
+				pPatch->matchOffset |= (uint16_t) (byte << 8);
+				if(DELTA_PATCH_NIBBLE_EXTENDED + DELTA_PATCH_MIN_MATCH == pPatch->matchLength) {
+					pPatch->sequenceState = SEQUENCE_MATCH_LENGTH;
+				} else {
+					rc = startMatch(pPatch);
+				}
+				break;
+			case SEQUENCE_MATCH_LENGTH:
+				if(pPatch->matchLength > 0x7FFFFFFF) {
+					rc = FAILURE;
+					break;
+				}
+				pPatch->matchLength += byte;
+				if(255 != byte) {
+					rc = startMatch(pPatch);
+				}
+				break;
+			default:
+				rc = FAILURE;
+				break;
+		}
+	}
+
+	if(SUCCESS != rc) {
+		IOT_DEBUG("Delta patch stopped at target byte %u: %d", (unsigned) pPatch->targetPosition, rc);
+		pPatch->error = rc;
+	}
+	return rc;
+}
+
+IoT_Error_t aws_iot_delta_patch_finish(DeltaPatch_t *pPatch) {
+	FUNC_ENTRY;
+
+	if(NULL == pPatch) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+	if(SUCCESS != pPatch->error) {
+		FUNC_EXIT_RC(pPatch->error);
+	}
+
+	if(COMMAND_DONE != pPatch->commandState || SEQUENCE_TOKEN != pPatch->sequenceState) {
+		IOT_ERROR("Delta patch ended after %u of %u target bytes", (unsigned) pPatch->targetPosition,
+				  (unsigned) pPatch->header.targetSize);
+		pPatch->error = FAILURE;
+	}
+
+	FUNC_EXIT_RC(pPatch->error);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -174,6 +174,7 @@ IoT_Error_t aws_iot_mqtt_set_connect_params(AWS_IoT_Client *pClient, const IoT_C
 	pClient->clientData.options.MQTTVersion = pNewConnectParams->MQTTVersion;
 	pClient->clientData.options.pClientID = pNewConnectParams->pClientID;
 	pClient->clientData.options.clientIDLen = pNewConnectParams->clientIDLen;
+	aws_iot_mqtt_internal_seed_backoff(pClient, pNewConnectParams->pClientID, pNewConnectParams->clientIDLen);
 #if !DISABLE_METRICS
 	if (0 == strlen(pUsernameTemp)) {
 		snprintf(pUsernameTemp, SDK_METRICS_LEN, SDK_METRICS_TEMPLATE, VERSION_MAJOR, VERSION_MINOR, VERSION_PATCH);
@@ -256,6 +257,8 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, const IoT_Client_Init_Par
 	pClient->clientData.writeBufSize = AWS_IOT_MQTT_TX_BUF_LEN;
 	pClient->clientData.readBufSize = AWS_IOT_MQTT_RX_BUF_LEN;
 	pClient->clientData.counterNetworkDisconnected = 0;
+	pClient->clientData.reconnectAttemptCount = 0;
+	memset(&(pClient->clientData.connectionMetrics), 0, sizeof(IoT_Connection_Metrics));
 	pClient->clientData.disconnectHandler = pInitParams->disconnectHandler;
 	pClient->clientData.disconnectHandlerData = pInitParams->disconnectHandlerData;
 	pClient->clientData.nextPacketId = 1;
@@ -287,6 +290,10 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, const IoT_Client_Init_Par
 
 	pClient->clientStatus.isPingOutstanding = 0;
 	pClient->clientStatus.isAutoReconnectEnabled = pInitParams->enableAutoReconnect;
+	pClient->clientStatus.isSessionPresent = false;
+#if AWS_IOT_MQTT_NUM_UNACKED_PUBLISHES > 0
+	pClient->clientData.unackedPublishCount = 0;
+#endif
 
 	rc = iot_tls_init(&(pClient->networkStack), pInitParams->pRootCALocation, pInitParams->pDeviceCertLocation,
 					  pInitParams->pDevicePrivateKeyLocation, pInitParams->pHostURL, pInitParams->port,
@@ -305,6 +312,8 @@ IoT_Error_t aws_iot_mqtt_init(AWS_IoT_Client *pClient, const IoT_Client_Init_Par
 	init_timer(&(pClient->pingReqTimer));
 	init_timer(&(pClient->pingRespTimer));
 	init_timer(&(pClient->reconnectDelayTimer));
+	init_timer(&(pClient->outageStopwatch));
+	init_timer(&(pClient->resubscribeStopwatch));
 
 	pClient->clientStatus.clientState = CLIENT_STATE_INITIALIZED;
 
@@ -392,6 +401,40 @@ void aws_iot_mqtt_reset_network_disconnected_count(AWS_IoT_Client *pClient) {
 	pClient->clientData.counterNetworkDisconnected = 0;
 }
 
+bool aws_iot_mqtt_is_session_present(AWS_IoT_Client *pClient) {
+	FUNC_ENTRY;
+	if(NULL == pClient) {
+		IOT_WARN(" Client is null! ");
+		FUNC_EXIT_RC(false);
+	}
+
+	FUNC_EXIT_RC(pClient->clientStatus.isSessionPresent);
+}
+
+uint32_t aws_iot_mqtt_get_unacked_publish_count(AWS_IoT_Client *pClient) {
+#if AWS_IOT_MQTT_NUM_UNACKED_PUBLISHES > 0
+	if(NULL == pClient) {
+		IOT_WARN(" Client is null! ");
+		return 0;
+	}
+
+	return pClient->clientData.unackedPublishCount;
+#else
+	IOT_UNUSED(pClient);
+	return 0;
+#endif
+}
+
+IoT_Error_t aws_iot_mqtt_get_connection_metrics(AWS_IoT_Client *pClient, IoT_Connection_Metrics *pMetrics) {
+	FUNC_ENTRY;
+	if(NULL == pClient || NULL == pMetrics) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	*pMetrics = pClient->clientData.connectionMetrics;
+	FUNC_EXIT_RC(SUCCESS);
+}
+
 #ifdef __cplusplus
 }
 #endif
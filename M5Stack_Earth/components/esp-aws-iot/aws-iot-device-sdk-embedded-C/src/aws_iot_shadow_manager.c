@@ -0,0 +1,738 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_shadow_manager.c
+ * @brief Shadows of many things over one MQTT connection
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aws_iot_shadow_manager.h"
+
+#include <string.h>
+#include <stdio.h>
+
+#include "aws_iot_json_utils.h"
+#include "aws_iot_log.h"
+#include "aws_iot_shadow_json.h"
+#include "aws_iot_shadow_key.h"
+
+#if MAX_SHADOW_CONTEXT_DELTA_KEYS > 32
+#error "MAX_SHADOW_CONTEXT_DELTA_KEYS must not be more than 32"
+#endif
+
+#if (SHADOW_MANAGER_HASH_BUCKETS & (SHADOW_MANAGER_HASH_BUCKETS - 1)) != 0
+#error "SHADOW_MANAGER_HASH_BUCKETS must be a power of two"
+#endif
+
+/* $aws/things/{thing}/shadow/name/{shadow}/update/accepted */
+#define MAX_SHADOW_MANAGER_TOPIC_LENGTH_BYTES (MAX_SHADOW_TOPIC_LENGTH_BYTES + 6 + MAX_SIZE_OF_SHADOW_NAME)
+
+#define SHADOW_MANAGER_FILTER_COUNT 3
+
+/* The MQTT client keeps pointers to the topic filters, so they are not built at run time */
+static const char *const classicShadowFilters[SHADOW_MANAGER_FILTER_COUNT] = {
+	"$aws/things/+/shadow/update/delta",
+	"$aws/things/+/shadow/+/accepted",
+	"$aws/things/+/shadow/+/rejected"
+};
+
+static const char *const namedShadowFilters[SHADOW_MANAGER_FILTER_COUNT] = {
+	"$aws/things/+/shadow/name/+/update/delta",
+	"$aws/things/+/shadow/name/+/+/accepted",
+	"$aws/things/+/shadow/name/+/+/rejected"
+};
+
+typedef enum {
+	SHADOW_MANAGER_DELTA, SHADOW_MANAGER_ACCEPTED, SHADOW_MANAGER_REJECTED
+} ShadowManagerTopicType_t;
+
+/* Thing and shadow names of a received topic, pointing into the topic */
+typedef struct {
+	const char *pThingName;
+	uint16_t thingNameLen;
+	const char *pShadowName;
+	uint16_t shadowNameLen;
+	ShadowActions_t action;
+	ShadowManagerTopicType_t type;
+} ShadowManagerTopic_t;
+
+typedef struct {
+	ShadowContext_t *pShadow;
+	uint32_t dispatched;
+} ShadowManagerDeltaVisit_t;
+
+static uint32_t hashShadowNames(const char *pThingName, size_t thingNameLen, const char *pShadowName,
+								size_t shadowNameLen) {
+	uint32_t hash = 2166136261u;
+	size_t i;
+
+	/* FNV-1a of the thing name, a null and the shadow name */
+	for(i = 0; i < thingNameLen; i++) {
+		hash ^= (uint8_t) pThingName[i];
+		hash *= 16777619u;
+	}
+	hash *= 16777619u;
+	for(i = 0; i < shadowNameLen; i++) {
+		hash ^= (uint8_t) pShadowName[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+static bool isTopicLevel(const char *pLevel, uint16_t levelLen, const char *pExpected) {
+	size_t expectedLen = strlen(pExpected);
+	return levelLen == expectedLen && memcmp(pLevel, pExpected, expectedLen) == 0;
+}
+
+/* Next level of a topic that is not null terminated, false at the end of the topic */
+static bool nextTopicLevel(const char **ppCursor, const char *pEnd, const char **ppLevel, uint16_t *pLevelLen) {
+	const char *pSeparator;
+
+	if(*ppCursor > pEnd) {
+		return false;
+	}
+	pSeparator = memchr(*ppCursor, '/', (size_t) (pEnd - *ppCursor));
+	if(NULL == pSeparator) {
+		pSeparator = pEnd;
+	}
+	*ppLevel = *ppCursor;
+	*pLevelLen = (uint16_t) (pSeparator - *ppCursor);
+	*ppCursor = pSeparator + 1;
+	return true;
+}
+
+static bool parseShadowTopic(const char *pTopic, uint16_t topicLen, ShadowManagerTopic_t *pParsed) {
+	static const char prefix[] = "$aws/things/";
+	const char *pCursor, *pEnd = pTopic + topicLen;
+	const char *pLevel;
+	uint16_t levelLen;
+
+	if(topicLen <= sizeof(prefix) - 1 || memcmp(pTopic, prefix, sizeof(prefix) - 1) != 0) {
+		return false;
+	}
+	pCursor = pTopic + sizeof(prefix) - 1;
+
+	if(!nextTopicLevel(&pCursor, pEnd, &pParsed->pThingName, &pParsed->thingNameLen)
+	   || 0 == pParsed->thingNameLen) {
+		return false;
+	}
+	if(!nextTopicLevel(&pCursor, pEnd, &pLevel, &levelLen) || !isTopicLevel(pLevel, levelLen, "shadow")
+	   || !nextTopicLevel(&pCursor, pEnd, &pLevel, &levelLen)) {
+		return false;
+	}
+
+	pParsed->pShadowName = NULL;
+	pParsed->shadowNameLen = 0;
+	if(isTopicLevel(pLevel, levelLen, "name")) {
+		if(!nextTopicLevel(&pCursor, pEnd, &pParsed->pShadowName, &pParsed->shadowNameLen)
+		   || 0 == pParsed->shadowNameLen || !nextTopicLevel(&pCursor, pEnd, &pLevel, &levelLen)) {
+			return false;
+		}
+	}
+
+	if(isTopicLevel(pLevel, levelLen, "update")) {
+		pParsed->action = SHADOW_UPDATE;
+	} else if(isTopicLevel(pLevel, levelLen, "get")) {
+		pParsed->action = SHADOW_GET;
+	} else if(isTopicLevel(pLevel, levelLen, "delete")) {
+		pParsed->action = SHADOW_DELETE;
+	} else {
+		return false;
+	}
+
+	if(!nextTopicLevel(&pCursor, pEnd, &pLevel, &levelLen)) {
+		return false;
+	}
+	if(isTopicLevel(pLevel, levelLen, "accepted")) {
+		pParsed->type = SHADOW_MANAGER_ACCEPTED;
+	} else if(isTopicLevel(pLevel, levelLen, "rejected")) {
+		pParsed->type = SHADOW_MANAGER_REJECTED;
+	} else if(SHADOW_UPDATE == pParsed->action && isTopicLevel(pLevel, levelLen, "delta")) {
+		pParsed->type = SHADOW_MANAGER_DELTA;
+	} else {
+		return false;
+	}
+
+	/* Nothing may follow, e.g. update/documents is not ours */
+	return pCursor > pEnd;
+}
+
+static ShadowContext_t *findShadow(ShadowManager_t *pManager, const char *pThingName, size_t thingNameLen,
+								   const char *pShadowName, size_t shadowNameLen) {
+	uint32_t hash = hashShadowNames(pThingName, thingNameLen, pShadowName, shadowNameLen);
+	ShadowContext_t *pShadow;
+
+	for(pShadow = pManager->pBuckets[hash & (SHADOW_MANAGER_HASH_BUCKETS - 1)]; NULL != pShadow;
+		pShadow = pShadow->pNext) {
+		if(pShadow->nameHash == hash && strlen(pShadow->thingName) == thingNameLen
+		   && memcmp(pShadow->thingName, pThingName, thingNameLen) == 0
+		   && strlen(pShadow->shadowName) == shadowNameLen
+		   && memcmp(pShadow->shadowName, pShadowName, shadowNameLen) == 0) {
+			return pShadow;
+		}
+	}
+	return NULL;
+}
+
+static bool isShadowAdded(ShadowManager_t *pManager, ShadowContext_t *pShadow) {
+	ShadowContext_t *pEntry;
+
+	for(pEntry = pManager->pBuckets[pShadow->nameHash & (SHADOW_MANAGER_HASH_BUCKETS - 1)]; NULL != pEntry;
+		pEntry = pEntry->pNext) {
+		if(pEntry == pShadow) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static void dispatchShadowDeltaKey(const char *pJsonDocument, ShadowManagerDeltaVisit_t *pVisit, const char *pName,
+								   uint32_t nameLen, jsmntok_t *pValueToken) {
+	ShadowContext_t *pShadow = pVisit->pShadow;
+	uint8_t i;
+
+	for(i = 0; i < pShadow->deltaKeyCount; i++) {
+		jsonStruct_t *pStruct = pShadow->pDeltaKeys[i];
+
+		/* Only the first occurrence of a key updates the value, as for the Thing Shadow client */
+		if((pVisit->dispatched & (1u << i)) != 0 || strlen(pStruct->pKey) != nameLen
+		   || memcmp(pStruct->pKey, pName, nameLen) != 0) {
+			continue;
+		}
+		pVisit->dispatched |= 1u << i;
+
+		updateJsonStructFromToken(pJsonDocument, pStruct, pValueToken);
+		if(pStruct->cb != NULL) {
+			pStruct->cb(pJsonDocument + pValueToken->start, (uint32_t) (pValueToken->end - pValueToken->start),
+						pStruct);
+		}
+	}
+}
+
+static void shadowDeltaKeyVisitor(const char *pJsonDocument, const char *pKey, uint32_t keyLen,
+								  const char *pPath, uint32_t pathLen, jsmntok_t *pValueToken, void *pContext) {
+	ShadowManagerDeltaVisit_t *pVisit = (ShadowManagerDeltaVisit_t *) pContext;
+
+	dispatchShadowDeltaKey(pJsonDocument, pVisit, pKey, keyLen, pValueToken);
+	if(pPath != NULL && pathLen != keyLen) {
+		dispatchShadowDeltaKey(pJsonDocument, pVisit, pPath, pathLen, pValueToken);
+	}
+}
+
+static void handleShadowDelta(ShadowManager_t *pManager, ShadowContext_t *pShadow, int32_t tokenCount) {
+	ShadowManagerDeltaVisit_t visit;
+	ShadowJsonTokens_t *pPreviousTokens;
+	uint32_t version = 0;
+
+	if(pShadow->discardOldDelta
+	   && extractVersionNumber(pManager->rxBuf, &pManager->jsonTokens, tokenCount, &version)) {
+		if(version > pShadow->version) {
+			pShadow->version = version;
+		} else {
+			IOT_WARN("Old Delta Message received for %s - Ignoring rx: %u local: %u", pShadow->thingName,
+					 (unsigned) version, (unsigned) pShadow->version);
+			return;
+		}
+	}
+
+	visit.pShadow = pShadow;
+	visit.dispatched = 0;
+	pPreviousTokens = selectViewJsonTokens(&pManager->jsonTokens);
+	walkJsonKeys(pManager->rxBuf, &pManager->jsonTokens, tokenCount, pShadow->hasPathKeys, shadowDeltaKeyVisitor,
+				 &visit);
+	selectViewJsonTokens(pPreviousTokens);
+}
+
+static void handleShadowResponse(ShadowManager_t *pManager, ShadowContext_t *pShadow,
+								 const ShadowManagerTopic_t *pTopic, IoT_Publish_Message_Params *params) {
+	ShadowResponseFields_t fields;
+	ShadowJsonTokens_t *pPreviousTokens;
+	uint8_t i;
+
+	/* Validity, version and client token come from one pass over the payload */
+	if(!extractShadowResponseFields((const char *) params->payload, params->payloadLen, &fields)) {
+		IOT_WARN("Received JSON is not valid");
+		return;
+	}
+
+	if(SHADOW_GET == pTopic->action && SHADOW_MANAGER_ACCEPTED == pTopic->type
+	   && fields.isVersionPresent && fields.version > pShadow->version) {
+		pShadow->version = fields.version;
+	}
+
+	if(!fields.isClientTokenPresent) {
+		return;
+	}
+
+	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
+		ShadowManagerAck_t *pAck = &pManager->acks[i];
+
+		if(pAck->isFree || pAck->pShadow != pShadow || pAck->action != pTopic->action
+		   || strcmp(pAck->clientToken, fields.clientToken) != 0) {
+			continue;
+		}
+		/* Freed first, so the callback can send the next request */
+		pAck->isFree = true;
+		if(pAck->callback != NULL) {
+			/* Only copied for a callback, a view tokenizes it on demand */
+			invalidateParsedJson(pManager->rxBuf, &pManager->jsonTokens);
+			memcpy(pManager->rxBuf, params->payload, params->payloadLen);
+			pManager->rxBuf[params->payloadLen] = '\0';
+			pPreviousTokens = selectViewJsonTokens(&pManager->jsonTokens);
+			pAck->callback(pShadow->thingName, pTopic->action,
+						   SHADOW_MANAGER_ACCEPTED == pTopic->type ? SHADOW_ACK_ACCEPTED : SHADOW_ACK_REJECTED,
+						   pManager->rxBuf, pAck->pCallbackContext);
+			selectViewJsonTokens(pPreviousTokens);
+		}
+		break;
+	}
+}
+
+static void shadowManagerCallback(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+								  IoT_Publish_Message_Params *params, void *pData) {
+	ShadowManager_t *pManager = (ShadowManager_t *) pData;
+	ShadowManagerTopic_t topic;
+	ShadowContext_t *pShadow;
+	int32_t tokenCount;
+
+	IOT_UNUSED(pClient);
+
+	if(NULL == pManager || !parseShadowTopic(topicName, topicNameLen, &topic)) {
+		return;
+	}
+
+	/* Other clients' shadows match the filters too */
+	pShadow = findShadow(pManager, topic.pThingName, topic.thingNameLen, topic.pShadowName, topic.shadowNameLen);
+	if(NULL == pShadow) {
+		return;
+	}
+
+	if(params->payloadLen >= SHADOW_MAX_SIZE_OF_RX_BUFFER) {
+		IOT_WARN("Payload larger than RX Buffer");
+		return;
+	}
+
+	if(SHADOW_MANAGER_DELTA != topic.type) {
+		handleShadowResponse(pManager, pShadow, &topic, params);
+		return;
+	}
+
+	memcpy(pManager->rxBuf, params->payload, params->payloadLen);
+	pManager->rxBuf[params->payloadLen] = '\0';    // jsmn_parse relies on a string
+
+	/* Delta keys are updated from the tokens, after the version was checked */
+	if(!isJsonValidAndParse(pManager->rxBuf, params->payloadLen, &pManager->jsonTokens, &tokenCount)) {
+		IOT_WARN("Received JSON is not valid");
+		return;
+	}
+
+	handleShadowDelta(pManager, pShadow, tokenCount);
+}
+
+static IoT_Error_t subscribeShadowFilters(ShadowManager_t *pManager, const char *const *ppFilters) {
+	IoT_Subscribe_Topic_Params topics[SHADOW_MANAGER_FILTER_COUNT];
+	IoT_Error_t rc;
+	uint8_t i;
+
+	for(i = 0; i < SHADOW_MANAGER_FILTER_COUNT; i++) {
+		topics[i].pTopicName = ppFilters[i];
+		topics[i].topicNameLen = (uint16_t) strlen(ppFilters[i]);
+		topics[i].qos = QOS0;
+		topics[i].pApplicationHandler = shadowManagerCallback;
+		topics[i].pApplicationHandlerData = pManager;
+	}
+
+	rc = aws_iot_mqtt_subscribe_batch(pManager->pClient, topics, SHADOW_MANAGER_FILTER_COUNT);
+	if(SUCCESS != rc) {
+		/* Filters acknowledged before the failure would be delivered twice after the next attempt */
+		for(i = 0; i < SHADOW_MANAGER_FILTER_COUNT; i++) {
+			aws_iot_mqtt_unsubscribe(pManager->pClient, topics[i].pTopicName, topics[i].topicNameLen);
+		}
+	}
+	return rc;
+}
+
+static IoT_Error_t unsubscribeShadowFilters(ShadowManager_t *pManager, const char *const *ppFilters) {
+	IoT_Error_t rc, firstRc = SUCCESS;
+	uint8_t i;
+
+	for(i = 0; i < SHADOW_MANAGER_FILTER_COUNT; i++) {
+		rc = aws_iot_mqtt_unsubscribe(pManager->pClient, ppFilters[i], (uint16_t) strlen(ppFilters[i]));
+		if(SUCCESS != rc && SUCCESS == firstRc) {
+			IOT_WARN("Unsubscribe from %s failed: %d", ppFilters[i], rc);
+			firstRc = rc;
+		}
+	}
+	return firstRc;
+}
+
+/* Client token of an outgoing document, without the JSON tokens, which may be walking a delta */
+static bool extractRequestClientToken(const char *pJsonDocument, char *pClientToken, size_t clientTokenSize) {
+	static const char key[] = "\"" SHADOW_CLIENT_TOKEN_STRING "\"";
+	const char *pValue = strstr(pJsonDocument, key);
+	const char *pValueEnd;
+
+	if(NULL == pValue) {
+		return false;
+	}
+	pValue += sizeof(key) - 1;
+	while(' ' == *pValue || '\t' == *pValue || '\r' == *pValue || '\n' == *pValue) {
+		pValue++;
+	}
+	if(':' != *pValue++) {
+		return false;
+	}
+	while(' ' == *pValue || '\t' == *pValue || '\r' == *pValue || '\n' == *pValue) {
+		pValue++;
+	}
+	if('"' != *pValue++) {
+		return false;
+	}
+	pValueEnd = strchr(pValue, '"');
+	if(NULL == pValueEnd || (size_t) (pValueEnd - pValue) >= clientTokenSize) {
+		return false;
+	}
+	memcpy(pClientToken, pValue, (size_t) (pValueEnd - pValue));
+	pClientToken[pValueEnd - pValue] = '\0';
+	return true;
+}
+
+static const char *shadowActionName(ShadowActions_t action) {
+	switch(action) {
+		case SHADOW_GET:
+			return "get";
+		case SHADOW_DELETE:
+			return "delete";
+		case SHADOW_UPDATE:
+		default:
+			return "update";
+	}
+}
+
+static IoT_Error_t sendShadowRequest(ShadowManager_t *pManager, ShadowContext_t *pShadow, ShadowActions_t action,
+									 const char *pJsonDocument, fpActionCallback_t callback, void *pContextData,
+									 uint8_t timeout_seconds) {
+	char topic[MAX_SHADOW_MANAGER_TOPIC_LENGTH_BYTES];
+	char clientToken[MAX_SIZE_CLIENT_ID_WITH_SEQUENCE];
+	IoT_Publish_Message_Params msgParams;
+	ShadowManagerAck_t *pAck = NULL;
+	IoT_Error_t rc;
+	uint8_t i;
+
+	if(!isShadowAdded(pManager, pShadow)) {
+		IOT_ERROR("Shadow of %s was not added to the manager", pShadow->thingName);
+		return FAILURE;
+	}
+
+	if(!aws_iot_mqtt_is_client_connected(pManager->pClient)) {
+		return MQTT_CONNECTION_ERROR;
+	}
+
+	if(NULL != callback && extractRequestClientToken(pJsonDocument, clientToken, sizeof(clientToken))) {
+		for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
+			if(pManager->acks[i].isFree) {
+				pAck = &pManager->acks[i];
+				break;
+			}
+		}
+		if(NULL == pAck) {
+			IOT_ERROR("Max number of pending responses reached");
+			return FAILURE;
+		}
+	}
+
+	if('\0' != pShadow->shadowName[0]) {
+		snprintf(topic, sizeof(topic), "$aws/things/%s/shadow/name/%s/%s", pShadow->thingName, pShadow->shadowName,
+				 shadowActionName(action));
+	} else {
+		snprintf(topic, sizeof(topic), "$aws/things/%s/shadow/%s", pShadow->thingName, shadowActionName(action));
+	}
+
+	msgParams.qos = QOS0;
+	msgParams.isRetained = 0;
+	msgParams.payload = (char *) pJsonDocument;
+	msgParams.payloadLen = strlen(pJsonDocument);
+
+	rc = aws_iot_mqtt_publish(pManager->pClient, topic, (uint16_t) strlen(topic), &msgParams);
+	if(SUCCESS == rc && NULL != pAck) {
+		pAck->pShadow = pShadow;
+		pAck->action = action;
+		memcpy(pAck->clientToken, clientToken, sizeof(clientToken));
+		pAck->callback = callback;
+		pAck->pCallbackContext = pContextData;
+		init_timer(&pAck->timer);
+		countdown_sec(&pAck->timer, timeout_seconds);
+		pAck->isFree = false;
+	}
+	return rc;
+}
+
+IoT_Error_t aws_iot_shadow_manager_init(ShadowManager_t *pManager, AWS_IoT_Client *pClient) {
+	uint8_t i;
+
+	FUNC_ENTRY;
+
+	if(NULL == pManager || NULL == pClient) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	memset(pManager, 0, sizeof(ShadowManager_t));
+	pManager->pClient = pClient;
+	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
+		pManager->acks[i].isFree = true;
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_shadow_context_init(ShadowContext_t *pShadow, const char *pThingName, const char *pShadowName) {
+	FUNC_ENTRY;
+
+	if(NULL == pShadow || NULL == pThingName || '\0' == pThingName[0]) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+	if(NULL == pShadowName) {
+		pShadowName = "";
+	}
+	if(strlen(pThingName) >= MAX_SIZE_OF_THING_NAME || strlen(pShadowName) >= MAX_SIZE_OF_SHADOW_NAME) {
+		IOT_ERROR("Thing or shadow name too long");
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	memset(pShadow, 0, sizeof(ShadowContext_t));
+	strcpy(pShadow->thingName, pThingName);
+	strcpy(pShadow->shadowName, pShadowName);
+	pShadow->discardOldDelta = true;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_shadow_context_register_delta(ShadowContext_t *pShadow, jsonStruct_t *pStruct) {
+	FUNC_ENTRY;
+
+	if(NULL == pShadow || NULL == pStruct || NULL == pStruct->pKey) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+	if(pShadow->deltaKeyCount >= MAX_SHADOW_CONTEXT_DELTA_KEYS) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	pShadow->pDeltaKeys[pShadow->deltaKeyCount++] = pStruct;
+	if(strchr(pStruct->pKey, '.') != NULL) {
+		pShadow->hasPathKeys = true;
+	}
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_shadow_manager_add(ShadowManager_t *pManager, ShadowContext_t *pShadow) {
+	ShadowContext_t **ppBucket;
+	bool isNamed;
+	IoT_Error_t rc = SUCCESS;
+
+	FUNC_ENTRY;
+
+	if(NULL == pManager || NULL == pShadow) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(NULL != findShadow(pManager, pShadow->thingName, strlen(pShadow->thingName), pShadow->shadowName,
+						  strlen(pShadow->shadowName))) {
+		IOT_ERROR("Shadow of %s added already", pShadow->thingName);
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	isNamed = '\0' != pShadow->shadowName[0];
+	if(isNamed && !pManager->namedSubscribed) {
+		rc = subscribeShadowFilters(pManager, namedShadowFilters);
+		pManager->namedSubscribed = (SUCCESS == rc);
+	} else if(!isNamed && !pManager->classicSubscribed) {
+		rc = subscribeShadowFilters(pManager, classicShadowFilters);
+		pManager->classicSubscribed = (SUCCESS == rc);
+	}
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	pShadow->nameHash = hashShadowNames(pShadow->thingName, strlen(pShadow->thingName), pShadow->shadowName,
+										strlen(pShadow->shadowName));
+	ppBucket = &pManager->pBuckets[pShadow->nameHash & (SHADOW_MANAGER_HASH_BUCKETS - 1)];
+	pShadow->pNext = *ppBucket;
+	*ppBucket = pShadow;
+	pManager->shadowCount++;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_shadow_manager_remove(ShadowManager_t *pManager, ShadowContext_t *pShadow) {
+	ShadowContext_t **ppLink;
+	IoT_Error_t rc = SUCCESS;
+	uint8_t i;
+
+	FUNC_ENTRY;
+
+	if(NULL == pManager || NULL == pShadow) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	for(ppLink = &pManager->pBuckets[pShadow->nameHash & (SHADOW_MANAGER_HASH_BUCKETS - 1)];
+		NULL != *ppLink && *ppLink != pShadow; ppLink = &(*ppLink)->pNext) {
+	}
+	if(NULL == *ppLink) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+	*ppLink = pShadow->pNext;
+	pShadow->pNext = NULL;
+	pManager->shadowCount--;
+
+	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
+		if(pManager->acks[i].pShadow == pShadow) {
+			pManager->acks[i].isFree = true;
+			pManager->acks[i].pShadow = NULL;
+		}
+	}
+
+	/* The wildcard filters carry the messages of every thing, they go with the last shadow */
+	if(0 == pManager->shadowCount) {
+		if(pManager->classicSubscribed) {
+			rc = unsubscribeShadowFilters(pManager, classicShadowFilters);
+			pManager->classicSubscribed = (SUCCESS != rc);
+		}
+		if(pManager->namedSubscribed) {
+			IoT_Error_t namedRc = unsubscribeShadowFilters(pManager, namedShadowFilters);
+
+			pManager->namedSubscribed = (SUCCESS != namedRc);
+			if(SUCCESS == rc) {
+				rc = namedRc;
+			}
+		}
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_shadow_manager_finalize_json_document(ShadowManager_t *pManager, char *pJsonDocument,
+														  size_t maxSizeOfJsonDocument) {
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pManager || NULL == pJsonDocument) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = aws_iot_shadow_internal_finalize_json_document(pJsonDocument, maxSizeOfJsonDocument,
+														&pManager->clientTokenNum);
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_shadow_manager_update(ShadowManager_t *pManager, ShadowContext_t *pShadow,
+										  const char *pJsonDocument, fpActionCallback_t callback, void *pContextData,
+										  uint8_t timeout_seconds) {
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pManager || NULL == pShadow || NULL == pJsonDocument) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = sendShadowRequest(pManager, pShadow, SHADOW_UPDATE, pJsonDocument, callback, pContextData,
+						   timeout_seconds);
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_shadow_manager_get(ShadowManager_t *pManager, ShadowContext_t *pShadow,
+									   fpActionCallback_t callback, void *pContextData, uint8_t timeout_seconds) {
+	char getRequestJsonBuf[MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE];
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pManager || NULL == pShadow) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = aws_iot_shadow_internal_token_request_json(getRequestJsonBuf, MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE,
+													&pManager->clientTokenNum);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	rc = sendShadowRequest(pManager, pShadow, SHADOW_GET, getRequestJsonBuf, callback, pContextData,
+						   timeout_seconds);
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_shadow_manager_delete(ShadowManager_t *pManager, ShadowContext_t *pShadow,
+										  fpActionCallback_t callback, void *pContextData, uint8_t timeout_seconds) {
+	char deleteRequestJsonBuf[MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE];
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pManager || NULL == pShadow) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	rc = aws_iot_shadow_internal_token_request_json(deleteRequestJsonBuf, MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE,
+													&pManager->clientTokenNum);
+	if(SUCCESS != rc) {
+		FUNC_EXIT_RC(rc);
+	}
+
+	rc = sendShadowRequest(pManager, pShadow, SHADOW_DELETE, deleteRequestJsonBuf, callback, pContextData,
+						   timeout_seconds);
+
+	FUNC_EXIT_RC(rc);
+}
+
+IoT_Error_t aws_iot_shadow_manager_yield(ShadowManager_t *pManager, uint32_t timeout) {
+	IoT_Error_t rc;
+	uint8_t i;
+
+	FUNC_ENTRY;
+
+	if(NULL == pManager) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
+		ShadowManagerAck_t *pAck = &pManager->acks[i];
+
+		if(!pAck->isFree && has_timer_expired(&pAck->timer)) {
+			pAck->isFree = true;
+			if(pAck->callback != NULL) {
+				pAck->callback(pAck->pShadow->thingName, pAck->action, SHADOW_ACK_TIMEOUT, pManager->rxBuf,
+							   pAck->pCallbackContext);
+			}
+		}
+	}
+
+	rc = aws_iot_mqtt_yield(pManager->pClient, timeout);
+
+	FUNC_EXIT_RC(rc);
+}
+
+#ifdef __cplusplus
+}
+#endif
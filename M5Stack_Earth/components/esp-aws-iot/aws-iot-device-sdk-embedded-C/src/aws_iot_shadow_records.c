@@ -40,7 +40,12 @@ typedef struct {
 	fpActionCallback_t callback;
 	void *pCallbackContext;
 	bool isFree;
-	Timer timer;
+	uint32_t tokenHash;
+	int16_t next;
+	int16_t wheelPrev;
+	int16_t wheelNext;
+	uint16_t wheelSlot;
+	uint32_t wheelRounds;
 } ToBeReceivedAckRecord_t;
 
 typedef struct {
@@ -48,6 +53,10 @@ typedef struct {
 	void *pStruct;
 	jsonStructCallback_t callback;
 	bool isFree;
+	uint32_t keyHash;
+	uint32_t keyLen;
+	int16_t next;
+	uint32_t lastDispatch;
 } JsonTokenTable_t;
 
 typedef struct {
@@ -63,6 +72,29 @@ typedef enum {
 
 ToBeReceivedAckRecord_t AckWaitList[MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME];
 
+/* Records waiting for a response are indexed by client token, and free records are chained
+ * through the same next link. */
+#define SHADOW_ACK_HASH_BUCKETS MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME
+static int16_t ackHashBuckets[SHADOW_ACK_HASH_BUCKETS];
+static int16_t ackFreeHead = -1;
+
+/* Timer wheel for the response timeouts. Each slot holds the records due when the wheel
+ * reaches it, with the number of turns still to wait. */
+#ifndef SHADOW_ACK_WHEEL_SLOTS
+#define SHADOW_ACK_WHEEL_SLOTS 16
+#endif
+#ifndef SHADOW_ACK_WHEEL_TICK_MS
+#define SHADOW_ACK_WHEEL_TICK_MS 1000
+#endif
+/* The wheel runs from one long countdown, re-armed when half of it has elapsed. Acks still
+ * waiting when it runs out all time out. */
+#define SHADOW_ACK_WHEEL_CLOCK_MS 3600000
+static int16_t ackWheel[SHADOW_ACK_WHEEL_SLOTS];
+static uint32_t ackWheelTick = 0;
+static Timer ackWheelClock;
+static uint32_t ackWheelClockOffsetMs = 0;
+static uint32_t ackWheelConsumedMs = 0;
+
 AWS_IoT_Client *pMqttClient;
 
 char myThingName[MAX_SIZE_OF_THING_NAME];
@@ -78,6 +110,14 @@ char shadowRxBuf[SHADOW_MAX_SIZE_OF_RX_BUFFER];
 
 static JsonTokenTable_t tokenTable[MAX_JSON_TOKEN_EXPECTED];
 static uint32_t tokenTableIndex = 0;
+
+/* Registered delta keys hashed by key, chained through tokenTable[].next in registration order */
+#ifndef SHADOW_DELTA_KEY_HASH_BUCKETS
+#define SHADOW_DELTA_KEY_HASH_BUCKETS 64 ///< Power of two
+#endif
+static int16_t tokenHashBuckets[SHADOW_DELTA_KEY_HASH_BUCKETS];
+static bool tokenTableHasPaths = false;
+static uint32_t deltaDispatchCount = 0;
 static bool deltaTopicSubscribedFlag = false;
 uint32_t shadowJsonVersionNum = 0;
 bool shadowDiscardOldDeltaFlag = true;
@@ -96,15 +136,112 @@ static int16_t getNextFreeIndexOfSubscriptionList(void);
 
 static void unsubscribeFromAcceptedAndRejected(uint8_t index);
 
+static uint32_t hashString(const char *pKey, uint32_t keyLen) {
+	uint32_t hash = 2166136261u;    // FNV-1a
+	uint32_t i;
+
+	for(i = 0; i < keyLen; i++) {
+		hash ^= (uint8_t) pKey[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
 void initDeltaTokens(void) {
 	uint32_t i;
 	for(i = 0; i < MAX_JSON_TOKEN_EXPECTED; i++) {
 		tokenTable[i].isFree = true;
+		tokenTable[i].next = -1;
+		tokenTable[i].lastDispatch = 0;
+	}
+	for(i = 0; i < SHADOW_DELTA_KEY_HASH_BUCKETS; i++) {
+		tokenHashBuckets[i] = -1;
 	}
 	tokenTableIndex = 0;
+	tokenTableHasPaths = false;
 	deltaTopicSubscribedFlag = false;
 }
 
+IoT_Error_t indexJsonTokenOnDelta(jsonStruct_t *pStruct) {
+	int16_t *pLink;
+	JsonTokenTable_t *pEntry;
+
+	if(NULL == pStruct || NULL == pStruct->pKey) {
+		return NULL_VALUE_ERROR;
+	}
+
+	if(tokenTableIndex >= MAX_JSON_TOKEN_EXPECTED) {
+		return FAILURE;
+	}
+
+	pEntry = &tokenTable[tokenTableIndex];
+	pEntry->pKey = pStruct->pKey;
+	pEntry->callback = pStruct->cb;
+	pEntry->pStruct = pStruct;
+	pEntry->keyLen = (uint32_t) strlen(pStruct->pKey);
+	pEntry->keyHash = hashString(pStruct->pKey, pEntry->keyLen);
+	pEntry->next = -1;
+	pEntry->lastDispatch = 0;
+	pEntry->isFree = false;
+
+	/* Append, so entries with the same key fire in registration order */
+	pLink = &tokenHashBuckets[pEntry->keyHash & (SHADOW_DELTA_KEY_HASH_BUCKETS - 1)];
+	while(*pLink >= 0) {
+		pLink = &tokenTable[*pLink].next;
+	}
+	*pLink = (int16_t) tokenTableIndex;
+
+	if(strchr(pStruct->pKey, '.') != NULL) {
+		tokenTableHasPaths = true;
+	}
+	tokenTableIndex++;
+
+	return SUCCESS;
+}
+
+static void dispatchDeltaKey(const char *pJsonDocument, const char *pName, uint32_t nameLen, jsmntok_t *pValueToken) {
+	uint32_t hash = hashString(pName, nameLen);
+	int16_t i;
+
+	for(i = tokenHashBuckets[hash & (SHADOW_DELTA_KEY_HASH_BUCKETS - 1)]; i >= 0; i = tokenTable[i].next) {
+		JsonTokenTable_t *pEntry = &tokenTable[i];
+
+		if(pEntry->isFree || pEntry->keyHash != hash || pEntry->keyLen != nameLen
+		   || memcmp(pEntry->pKey, pName, nameLen) != 0) {
+			continue;
+		}
+		/* Only the first occurrence of a key updates the value, as before */
+		if(pEntry->lastDispatch == deltaDispatchCount) {
+			continue;
+		}
+		pEntry->lastDispatch = deltaDispatchCount;
+
+		updateJsonStructFromToken(pJsonDocument, (jsonStruct_t *) pEntry->pStruct, pValueToken);
+		if(pEntry->callback != NULL) {
+			pEntry->callback(pJsonDocument + pValueToken->start, (uint32_t) (pValueToken->end - pValueToken->start),
+							 (jsonStruct_t *) pEntry->pStruct);
+		}
+	}
+}
+
+static void dispatchDeltaKeyVisitor(const char *pJsonDocument, const char *pKey, uint32_t keyLen,
+									const char *pPath, uint32_t pathLen, jsmntok_t *pValueToken, void *pContext) {
+	IOT_UNUSED(pContext);
+
+	dispatchDeltaKey(pJsonDocument, pKey, keyLen, pValueToken);
+	if(pPath != NULL && pathLen != keyLen) {
+		dispatchDeltaKey(pJsonDocument, pPath, pathLen, pValueToken);
+	}
+}
+
+void dispatchDeltaTokens(const char *pJsonDocument, int32_t tokenCount) {
+	deltaDispatchCount++;
+	if(0 == deltaDispatchCount) {
+		deltaDispatchCount++;
+	}
+	walkJsonKeys(pJsonDocument, NULL, tokenCount, tokenTableHasPaths, dispatchDeltaKeyVisitor, NULL);
+}
+
 IoT_Error_t registerJsonTokenOnDelta(jsonStruct_t *pStruct) {
 
 	IoT_Error_t rc = SUCCESS;
@@ -116,16 +253,10 @@ IoT_Error_t registerJsonTokenOnDelta(jsonStruct_t *pStruct) {
 		deltaTopicSubscribedFlag = true;
 	}
 
-	if(tokenTableIndex >= MAX_JSON_TOKEN_EXPECTED) {
+	if(SUCCESS != indexJsonTokenOnDelta(pStruct)) {
 		return FAILURE;
 	}
 
-	tokenTable[tokenTableIndex].pKey = pStruct->pKey;
-	tokenTable[tokenTableIndex].callback = pStruct->cb;
-	tokenTable[tokenTableIndex].pStruct = pStruct;
-	tokenTable[tokenTableIndex].isFree = false;
-	tokenTableIndex++;
-
 	return rc;
 }
 
@@ -177,12 +308,90 @@ static bool isValidShadowVersionUpdate(const char *pTopicName) {
 	return false;
 }
 
+static int16_t findAckWaitListIndex(const char *pClientToken, uint32_t clientTokenLen) {
+	uint32_t hash;
+	int16_t i;
+
+	if(clientTokenLen >= MAX_SIZE_CLIENT_ID_WITH_SEQUENCE) {
+		return -1;
+	}
+
+	hash = hashString(pClientToken, clientTokenLen);
+	for(i = ackHashBuckets[hash % SHADOW_ACK_HASH_BUCKETS]; i >= 0; i = AckWaitList[i].next) {
+		if(AckWaitList[i].tokenHash == hash && strncmp(AckWaitList[i].clientTokenID, pClientToken, clientTokenLen) == 0
+		   && AckWaitList[i].clientTokenID[clientTokenLen] == '\0') {
+			return i;
+		}
+	}
+	return -1;
+}
+
+static void linkAckWheel(int16_t index, uint16_t slot) {
+	AckWaitList[index].wheelSlot = slot;
+	AckWaitList[index].wheelPrev = -1;
+	AckWaitList[index].wheelNext = ackWheel[slot];
+	if(ackWheel[slot] >= 0) {
+		AckWaitList[ackWheel[slot]].wheelPrev = index;
+	}
+	ackWheel[slot] = index;
+}
+
+/* Take a record off its token bucket and wheel slot, it is freed with freeAckWaitListIndex() */
+static void unlinkAckWaitListIndex(int16_t index) {
+	int16_t *pLink = &ackHashBuckets[AckWaitList[index].tokenHash % SHADOW_ACK_HASH_BUCKETS];
+
+	while(*pLink != index) {
+		pLink = &AckWaitList[*pLink].next;
+	}
+	*pLink = AckWaitList[index].next;
+
+	if(AckWaitList[index].wheelPrev >= 0) {
+		AckWaitList[AckWaitList[index].wheelPrev].wheelNext = AckWaitList[index].wheelNext;
+	} else {
+		ackWheel[AckWaitList[index].wheelSlot] = AckWaitList[index].wheelNext;
+	}
+	if(AckWaitList[index].wheelNext >= 0) {
+		AckWaitList[AckWaitList[index].wheelNext].wheelPrev = AckWaitList[index].wheelPrev;
+	}
+}
+
+static void freeAckWaitListIndex(int16_t index) {
+	AckWaitList[index].isFree = true;
+	AckWaitList[index].next = ackFreeHead;
+	ackFreeHead = index;
+}
+
+/* Time the wheel has not ticked over yet */
+static uint32_t ackWheelPendingMs(void) {
+	return ackWheelClockOffsetMs + (SHADOW_ACK_WHEEL_CLOCK_MS - left_ms(&ackWheelClock)) - ackWheelConsumedMs;
+}
+
+/* The countdown ran out, so the time since the wheel last moved is unknown. The acks waiting
+ * are all due: they are moved to the next tick, counted as already gone, and the clock starts
+ * again. */
+static void restartAckWheelClock(void) {
+	uint16_t slot = (uint16_t) ((ackWheelTick + 1) % SHADOW_ACK_WHEEL_SLOTS);
+	int16_t i;
+
+	for(i = 0; i < SHADOW_ACK_WHEEL_SLOTS; i++) {
+		ackWheel[i] = -1;
+	}
+	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
+		if(!AckWaitList[i].isFree) {
+			AckWaitList[i].wheelRounds = 0;
+			linkAckWheel(i, slot);
+		}
+	}
+	ackWheelClockOffsetMs = SHADOW_ACK_WHEEL_TICK_MS;
+	ackWheelConsumedMs = 0;
+	countdown_ms(&ackWheelClock, SHADOW_ACK_WHEEL_CLOCK_MS);
+}
+
 static void AckStatusCallback(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
 							  IoT_Publish_Message_Params *params, void *pData) {
-	int32_t tokenCount;
-	uint8_t i;
-	void *pJsonHandler = NULL;
-	char temporaryClientToken[MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE];
+	int16_t i;
+	ShadowResponseFields_t fields;
+	Shadow_Ack_Status_t status;
 
 	IOT_UNUSED(pClient);
 	IOT_UNUSED(topicNameLen);
@@ -193,46 +402,43 @@ static void AckStatusCallback(AWS_IoT_Client *pClient, char *topicName, uint16_t
 		return;
 	}
 
-	memcpy(shadowRxBuf, params->payload, params->payloadLen);
-	shadowRxBuf[params->payloadLen] = '\0';    // jsmn_parse relies on a string
-
-	if(!isJsonValidAndParse(shadowRxBuf, SHADOW_MAX_SIZE_OF_RX_BUFFER, pJsonHandler, &tokenCount)) {
+	/* Validity, version and client token come from one pass over the payload */
+	if(!extractShadowResponseFields((const char *) params->payload, params->payloadLen, &fields)) {
 		IOT_WARN("Received JSON is not valid");
 		return;
 	}
 
-	if(isValidShadowVersionUpdate(topicName)) {
-		uint32_t tempVersionNumber = 0;
-		if(extractVersionNumber(shadowRxBuf, pJsonHandler, tokenCount, &tempVersionNumber)) {
-			if(tempVersionNumber > shadowJsonVersionNum) {
-				shadowJsonVersionNum = tempVersionNumber;
-			}
+	if(fields.isVersionPresent && isValidShadowVersionUpdate(topicName)) {
+		if(fields.version > shadowJsonVersionNum) {
+			shadowJsonVersionNum = fields.version;
 		}
 	}
 
-	if(extractClientToken(shadowRxBuf, SHADOW_MAX_SIZE_OF_RX_BUFFER, temporaryClientToken, MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE)) {
-		for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
-			if(!AckWaitList[i].isFree) {
-				if(strcmp(AckWaitList[i].clientTokenID, temporaryClientToken) == 0) {
-					Shadow_Ack_Status_t status = SHADOW_ACK_REJECTED;
-					if(strstr(topicName, "accepted") != NULL) {
-						status = SHADOW_ACK_ACCEPTED;
-					} else if(strstr(topicName, "rejected") != NULL) {
-						status = SHADOW_ACK_REJECTED;
-					}
-					if(status == SHADOW_ACK_ACCEPTED || status == SHADOW_ACK_REJECTED) {
-						if(AckWaitList[i].callback != NULL) {
-							AckWaitList[i].callback(AckWaitList[i].thingName, AckWaitList[i].action, status,
-													shadowRxBuf, AckWaitList[i].pCallbackContext);
-						}
-						unsubscribeFromAcceptedAndRejected(i);
-						AckWaitList[i].isFree = true;
-						return;
-					}
-				}
-			}
-		}
+	if(!fields.isClientTokenPresent) {
+		return;
+	}
+	i = findAckWaitListIndex(fields.clientToken, (uint32_t) strlen(fields.clientToken));
+	if(i < 0) {
+		return;
+	}
+
+	/* Only responses to our requests are copied, a view tokenizes them on demand */
+	invalidateParsedJson(shadowRxBuf, NULL);
+	memcpy(shadowRxBuf, params->payload, params->payloadLen);
+	shadowRxBuf[params->payloadLen] = '\0';
+
+	status = SHADOW_ACK_REJECTED;
+	if(strstr(topicName, "accepted") != NULL) {
+		status = SHADOW_ACK_ACCEPTED;
+	}
+
+	unlinkAckWaitListIndex(i);
+	if(AckWaitList[i].callback != NULL) {
+		AckWaitList[i].callback(AckWaitList[i].thingName, AckWaitList[i].action, status,
+								shadowRxBuf, AckWaitList[i].pCallbackContext);
 	}
+	unsubscribeFromAcceptedAndRejected((uint8_t) i);
+	freeAckWaitListIndex(i);
 }
 
 static int16_t findIndexOfSubscriptionList(const char *pTopic) {
@@ -289,9 +495,21 @@ static void unsubscribeFromAcceptedAndRejected(uint8_t index) {
 
 void initializeRecords(AWS_IoT_Client *pClient) {
 	uint8_t i;
-	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
-		AckWaitList[i].isFree = true;
+	ackFreeHead = -1;
+	for(i = MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i > 0; i--) {
+		freeAckWaitListIndex((int16_t) (i - 1));
+	}
+	for(i = 0; i < SHADOW_ACK_HASH_BUCKETS; i++) {
+		ackHashBuckets[i] = -1;
 	}
+	for(i = 0; i < SHADOW_ACK_WHEEL_SLOTS; i++) {
+		ackWheel[i] = -1;
+	}
+	ackWheelTick = 0;
+	ackWheelClockOffsetMs = 0;
+	ackWheelConsumedMs = 0;
+	init_timer(&ackWheelClock);
+	countdown_ms(&ackWheelClock, SHADOW_ACK_WHEEL_CLOCK_MS);
 	for(i = 0; i < MAX_TOPICS_AT_ANY_GIVEN_TIME; i++) {
 		SubscriptionList[i].isFree = true;
 		SubscriptionList[i].count = 0;
@@ -423,60 +641,124 @@ IoT_Error_t publishToShadowAction(const char *pThingName, ShadowActions_t action
 }
 
 bool getNextFreeIndexOfAckWaitList(uint8_t *pIndex) {
-	uint8_t i;
-	bool rc = false;
-
-	if(NULL == pIndex) {
+	if(NULL == pIndex || ackFreeHead < 0) {
 		return false;
 	}
 
-	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
-		if(AckWaitList[i].isFree) {
-			*pIndex = i;
-			rc = true;
-			break;
-		}
-	}
-
-	return rc;
+	*pIndex = (uint8_t) ackFreeHead;
+	return true;
 }
 
 void addToAckWaitList(uint8_t indexAckWaitList, const char *pThingName, ShadowActions_t action,
 					  const char *pExtractedClientToken, fpActionCallback_t callback, void *pCallbackContext,
 					  uint32_t timeout_seconds) {
-	AckWaitList[indexAckWaitList].callback = callback;
-	memcpy(AckWaitList[indexAckWaitList].clientTokenID, pExtractedClientToken, MAX_SIZE_CLIENT_ID_WITH_SEQUENCE);
-	memcpy(AckWaitList[indexAckWaitList].thingName, pThingName, MAX_SIZE_OF_THING_NAME);
-	AckWaitList[indexAckWaitList].pCallbackContext = pCallbackContext;
-	AckWaitList[indexAckWaitList].action = action;
-	init_timer(&(AckWaitList[indexAckWaitList].timer));
-	countdown_sec(&(AckWaitList[indexAckWaitList].timer), timeout_seconds);
-	AckWaitList[indexAckWaitList].isFree = false;
+	int16_t index = (int16_t) indexAckWaitList;
+	int16_t *pLink = &ackFreeHead;
+	uint32_t bucket;
+	uint32_t ticks;
+
+	/* Usually the head, unless responses freed records while subscribing */
+	while(*pLink >= 0 && *pLink != index) {
+		pLink = &AckWaitList[*pLink].next;
+	}
+	if(*pLink != index) {
+		return;
+	}
+	*pLink = AckWaitList[index].next;
+
+	/* Before the record counts as waiting, it is linked on the wheel below */
+	if(0 == left_ms(&ackWheelClock)) {
+		restartAckWheelClock();
+	}
+
+	AckWaitList[index].callback = callback;
+	memcpy(AckWaitList[index].clientTokenID, pExtractedClientToken, MAX_SIZE_CLIENT_ID_WITH_SEQUENCE);
+	AckWaitList[index].clientTokenID[MAX_SIZE_CLIENT_ID_WITH_SEQUENCE - 1] = '\0';
+	memcpy(AckWaitList[index].thingName, pThingName, MAX_SIZE_OF_THING_NAME);
+	AckWaitList[index].pCallbackContext = pCallbackContext;
+	AckWaitList[index].action = action;
+	AckWaitList[index].isFree = false;
+
+	AckWaitList[index].tokenHash = hashString(AckWaitList[index].clientTokenID,
+											  (uint32_t) strlen(AckWaitList[index].clientTokenID));
+	bucket = AckWaitList[index].tokenHash % SHADOW_ACK_HASH_BUCKETS;
+	AckWaitList[index].next = ackHashBuckets[bucket];
+	ackHashBuckets[bucket] = index;
+
+	/* Counted from the last tick, plus one for the part of the current tick already gone,
+	 * so a response never times out early */
+	ticks = (uint32_t) (((uint64_t) timeout_seconds * 1000 + SHADOW_ACK_WHEEL_TICK_MS - 1) / SHADOW_ACK_WHEEL_TICK_MS);
+	ticks += ackWheelPendingMs() / SHADOW_ACK_WHEEL_TICK_MS + 1;
+	AckWaitList[index].wheelRounds = (ticks - 1) / SHADOW_ACK_WHEEL_SLOTS;
+	linkAckWheel(index, (uint16_t) ((ackWheelTick + ticks) % SHADOW_ACK_WHEEL_SLOTS));
+}
+
+/* While the wheel moves ticks forward the slot comes up (ticks - due) / SLOTS + 1 times,
+ * due being the number of ticks to its first visit. The records that time out are taken off
+ * and chained on *pExpired. */
+static void expireAckWheelSlot(uint16_t slot, uint32_t due, uint32_t ticks, int16_t *pExpired) {
+	uint32_t visits = (ticks - due) / SHADOW_ACK_WHEEL_SLOTS + 1;
+	int16_t i = ackWheel[slot];
+	int16_t next;
+
+	while(i >= 0) {
+		next = AckWaitList[i].wheelNext;
+		if(AckWaitList[i].wheelRounds >= visits) {
+			AckWaitList[i].wheelRounds -= visits;
+		} else {
+			unlinkAckWaitListIndex(i);
+			AckWaitList[i].next = *pExpired;
+			*pExpired = i;
+		}
+		i = next;
+	}
 }
 
 void HandleExpiredResponseCallbacks(void) {
-	uint8_t i;
-	for(i = 0; i < MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME; i++) {
-		if(!AckWaitList[i].isFree) {
-			if(has_timer_expired(&(AckWaitList[i].timer))) {
-				if(AckWaitList[i].callback != NULL) {
-					AckWaitList[i].callback(AckWaitList[i].thingName, AckWaitList[i].action, SHADOW_ACK_TIMEOUT,
-											shadowRxBuf, AckWaitList[i].pCallbackContext);
-				}
-				AckWaitList[i].isFree = true;
-				unsubscribeFromAcceptedAndRejected(i);
-			}
+	uint32_t pendingMs;
+	uint32_t ticks;
+	uint32_t due;
+	int16_t expired = -1;
+	int16_t i;
+
+	if(0 == left_ms(&ackWheelClock)) {
+		restartAckWheelClock();
+	}
+	pendingMs = ackWheelPendingMs();
+	ticks = pendingMs / SHADOW_ACK_WHEEL_TICK_MS;
+	pendingMs -= ticks * SHADOW_ACK_WHEEL_TICK_MS;
+
+	/* Only the slots of the ticks that went by are visited, once however many turns the
+	 * wheel made */
+	for(due = 1; due <= ticks && due <= SHADOW_ACK_WHEEL_SLOTS; due++) {
+		expireAckWheelSlot((uint16_t) ((ackWheelTick + due) % SHADOW_ACK_WHEEL_SLOTS), due, ticks, &expired);
+	}
+	ackWheelTick = (ackWheelTick + ticks) % SHADOW_ACK_WHEEL_SLOTS;
+
+	ackWheelConsumedMs += ticks * SHADOW_ACK_WHEEL_TICK_MS;
+	if(ackWheelConsumedMs >= SHADOW_ACK_WHEEL_CLOCK_MS / 2) {
+		ackWheelClockOffsetMs = pendingMs;
+		ackWheelConsumedMs = 0;
+		countdown_ms(&ackWheelClock, SHADOW_ACK_WHEEL_CLOCK_MS);
+	}
+
+	/* Called once the wheel is up to date, a callback may send another request */
+	while(expired >= 0) {
+		i = expired;
+		expired = AckWaitList[i].next;
+		if(AckWaitList[i].callback != NULL) {
+			AckWaitList[i].callback(AckWaitList[i].thingName, AckWaitList[i].action, SHADOW_ACK_TIMEOUT,
+									shadowRxBuf, AckWaitList[i].pCallbackContext);
 		}
+		unsubscribeFromAcceptedAndRejected((uint8_t) i);
+		freeAckWaitListIndex(i);
 	}
 }
 
 static void shadow_delta_callback(AWS_IoT_Client *pClient, char *topicName,
 								  uint16_t topicNameLen, IoT_Publish_Message_Params *params, void *pData) {
 	int32_t tokenCount;
-	uint32_t i = 0;
 	void *pJsonHandler = NULL;
-	int32_t DataPosition;
-	uint32_t dataLength;
 	uint32_t tempVersionNumber = 0;
 
 	FUNC_ENTRY;
@@ -494,7 +776,7 @@ static void shadow_delta_callback(AWS_IoT_Client *pClient, char *topicName,
 	memcpy(shadowRxBuf, params->payload, params->payloadLen);
 	shadowRxBuf[params->payloadLen] = '\0';    // jsmn_parse relies on a string
 
-	if(!isJsonValidAndParse(shadowRxBuf, SHADOW_MAX_SIZE_OF_RX_BUFFER, pJsonHandler, &tokenCount)) {
+	if(!isJsonValidAndParse(shadowRxBuf, params->payloadLen, pJsonHandler, &tokenCount)) {
 		IOT_WARN("Received JSON is not valid");
 		return;
 	}
@@ -511,17 +793,8 @@ static void shadow_delta_callback(AWS_IoT_Client *pClient, char *topicName,
 		}
 	}
 
-	for(i = 0; i < tokenTableIndex; i++) {
-		if(!tokenTable[i].isFree) {
-			if(isJsonKeyMatchingAndUpdateValue(shadowRxBuf, pJsonHandler, tokenCount,
-											   (jsonStruct_t *) tokenTable[i].pStruct, &dataLength, &DataPosition)) {
-				if(tokenTable[i].callback != NULL) {
-					tokenTable[i].callback(shadowRxBuf + DataPosition, dataLength,
-										   (jsonStruct_t *) tokenTable[i].pStruct);
-				}
-			}
-		}
-	}
+	/* One pass over the tokens, each key looked up among the registered ones */
+	dispatchDeltaTokens(shadowRxBuf, tokenCount);
 }
 
 #ifdef __cplusplus
@@ -0,0 +1,495 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_stream_download.c
+ * @brief Requests the blocks of a stream file and hands them to the application as they arrive
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "aws_iot_stream_download.h"
+
+#include <string.h>
+#include <stdio.h>
+
+#include "aws_iot_json_stream.h"
+#include "aws_iot_log.h"
+
+#define STREAM_DOWNLOAD_FILTER_COUNT 2
+#define STREAM_DOWNLOAD_DATA_OVERHEAD 80 ///< Data message without the block: the other keys and the MQTT header
+
+const StreamDownloadParams_t streamDownloadParamsDefault = StreamDownloadParams_initializer;
+
+/* Fields of a data message */
+typedef struct {
+	char *pPayload; ///< Start of the received payload, writable
+	int64_t fileId;
+	int64_t blockIndex;
+	int64_t blockLength;
+	uint32_t dataOffset; ///< Offset of the base64 block in pPayload
+	uint32_t dataLength;
+	bool hasFileId;
+	bool hasBlockIndex;
+	bool hasBlockLength;
+	bool hasData;
+} StreamDataVisit_t;
+
+static bool isBlockWritten(const StreamDownload_t *pDownload, uint32_t block) {
+	return 0 != (pDownload->params.pBitmap[block / 8] & (1u << (block % 8)));
+}
+
+static uint32_t blockLength(const StreamDownload_t *pDownload, uint32_t block) {
+	if(block + 1 == pDownload->blockCount) {
+		return pDownload->params.fileSize - block * pDownload->params.blockSize;
+	}
+	return pDownload->params.blockSize;
+}
+
+static bool parseUnsigned(const char *pText, uint32_t length, int64_t *pValue) {
+	int64_t value = 0;
+	uint32_t i;
+
+	if(0 == length) {
+		return false;
+	}
+	for(i = 0; i < length; i++) {
+		if(pText[i] < '0' || pText[i] > '9') {
+			return false;
+		}
+		value = value * 10 + (pText[i] - '0');
+		if(value > UINT32_MAX) {
+			return false;
+		}
+	}
+	*pValue = value;
+	return true;
+}
+
+static int8_t base64Value(char c) {
+	if(c >= 'A' && c <= 'Z') {
+		return (int8_t) (c - 'A');
+	}
+	if(c >= 'a' && c <= 'z') {
+		return (int8_t) (c - 'a' + 26);
+	}
+	if(c >= '0' && c <= '9') {
+		return (int8_t) (c - '0' + 52);
+	}
+	if('+' == c) {
+		return 62;
+	}
+	if('/' == c) {
+		return 63;
+	}
+	return -1;
+}
+
+/* Decodes in place, the output never catches up with the input */
+static bool decodeBase64(char *pText, uint32_t length, uint32_t *pDecodedLength) {
+	uint8_t *pOut = (uint8_t *) pText;
+	uint32_t accumulator = 0;
+	uint32_t bits = 0;
+	uint32_t outLength = 0;
+	uint32_t i;
+	int8_t value;
+
+	while(length > 0 && '=' == pText[length - 1]) {
+		length--;
+	}
+	for(i = 0; i < length; i++) {
+		value = base64Value(pText[i]);
+		if(value < 0) {
+			return false;
+		}
+		accumulator = (accumulator << 6) | (uint32_t) value;
+		bits += 6;
+		if(bits >= 8) {
+			bits -= 8;
+			pOut[outLength++] = (uint8_t) (accumulator >> bits);
+		}
+	}
+
+	*pDecodedLength = outLength;
+	return true;
+}
+
+static void streamDataVisitor(const JsonStreamEvent_t *pEvent, void *pContext) {
+	StreamDataVisit_t *pVisit = (StreamDataVisit_t *) pContext;
+
+	if(1 != pEvent->depth || NULL == pEvent->pKey || 1 != pEvent->keyLength) {
+		return;
+	}
+
+	if(JSON_STREAM_NUMBER == pEvent->type) {
+		switch(pEvent->pKey[0]) {
+			case 'f':
+				pVisit->hasFileId = parseUnsigned(pEvent->pValue, pEvent->valueLength, &pVisit->fileId);
+				break;
+			case 'i':
+				pVisit->hasBlockIndex = parseUnsigned(pEvent->pValue, pEvent->valueLength, &pVisit->blockIndex);
+				break;
+			case 'l':
+				pVisit->hasBlockLength = parseUnsigned(pEvent->pValue, pEvent->valueLength, &pVisit->blockLength);
+				break;
+			default:
+				break;
+		}
+	} else if(JSON_STREAM_STRING == pEvent->type && 'p' == pEvent->pKey[0]) {
+		/* The payload is fed in one chunk, so values point into it */
+		pVisit->dataOffset = (uint32_t) (pEvent->pValue - pVisit->pPayload);
+		pVisit->dataLength = pEvent->valueLength;
+		pVisit->hasData = true;
+	}
+}
+
+static StreamDownloadRequest_t *findRequest(StreamDownload_t *pDownload, uint32_t block) {
+	uint8_t i;
+
+	for(i = 0; i < pDownload->params.requestsInFlight; i++) {
+		StreamDownloadRequest_t *pRequest = &pDownload->requests[i];
+
+		if(pRequest->isInUse && block >= pRequest->firstBlock
+		   && block - pRequest->firstBlock < pRequest->blockCount) {
+			return pRequest;
+		}
+	}
+	return NULL;
+}
+
+static void failDownload(StreamDownload_t *pDownload, IoT_Error_t failure) {
+	pDownload->state = STREAM_DOWNLOAD_FAILED;
+	pDownload->failure = failure;
+}
+
+static void handleBlock(StreamDownload_t *pDownload, uint32_t block, const uint8_t *pData, size_t length) {
+	StreamDownloadRequest_t *pRequest;
+	IoT_Error_t rc;
+
+	if(isBlockWritten(pDownload, block)) {
+		pDownload->duplicateBlocks++;
+		return;
+	}
+
+	rc = pDownload->params.write(pDownload->params.pWriteContext, block, pData, length);
+	if(SUCCESS != rc) {
+		IOT_ERROR("Block %u could not be written: %d", (unsigned) block, rc);
+		failDownload(pDownload, rc);
+		return;
+	}
+
+	pDownload->params.pBitmap[block / 8] |= (uint8_t) (1u << (block % 8));
+	pDownload->receivedCount++;
+	if(pDownload->receivedCount == pDownload->blockCount) {
+		pDownload->state = STREAM_DOWNLOAD_COMPLETE;
+	}
+
+	/* A request is late when its blocks stop coming, not when the whole range takes long */
+	pRequest = findRequest(pDownload, block);
+	if(NULL != pRequest) {
+		countdown_ms(&pRequest->timer, pDownload->params.requestTimeoutMs);
+	}
+}
+
+static void streamDataCallback(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+							   IoT_Publish_Message_Params *params, void *pData) {
+	StreamDownload_t *pDownload = (StreamDownload_t *) pData;
+	JsonStreamParser_t parser;
+	StreamDataVisit_t visit;
+	uint32_t decodedLength;
+	IoT_Error_t rc;
+
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(topicName);
+	IOT_UNUSED(topicNameLen);
+
+	if(NULL == pDownload || NULL == params->payload || STREAM_DOWNLOAD_RUNNING != pDownload->state) {
+		return;
+	}
+
+	memset(&visit, 0, sizeof(visit));
+	visit.pPayload = (char *) params->payload;
+	aws_iot_json_stream_init(&parser, streamDataVisitor, &visit);
+	rc = aws_iot_json_stream_feed(&parser, visit.pPayload, strnlen(visit.pPayload, params->payloadLen));
+	if(SUCCESS == rc) {
+		rc = aws_iot_json_stream_finish(&parser);
+	}
+
+	if(SUCCESS != rc || !visit.hasFileId || !visit.hasBlockIndex || !visit.hasBlockLength || !visit.hasData) {
+		IOT_WARN("Invalid stream data message");
+		return;
+	}
+	if(visit.fileId != pDownload->params.fileId || visit.blockIndex >= pDownload->blockCount) {
+		IOT_WARN("Block %ld of file %ld is not part of the download", (long) visit.blockIndex, (long) visit.fileId);
+		return;
+	}
+	if(!decodeBase64(visit.pPayload + visit.dataOffset, visit.dataLength, &decodedLength)
+	   || decodedLength != visit.blockLength || decodedLength != blockLength(pDownload, (uint32_t) visit.blockIndex)) {
+		IOT_WARN("Block %ld has an invalid payload", (long) visit.blockIndex);
+		return;
+	}
+
+	handleBlock(pDownload, (uint32_t) visit.blockIndex, (const uint8_t *) (visit.pPayload + visit.dataOffset),
+				decodedLength);
+}
+
+static void streamRejectedCallback(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
+								   IoT_Publish_Message_Params *params, void *pData) {
+	StreamDownload_t *pDownload = (StreamDownload_t *) pData;
+
+	IOT_UNUSED(pClient);
+	IOT_UNUSED(topicName);
+	IOT_UNUSED(topicNameLen);
+
+	if(NULL == pDownload || STREAM_DOWNLOAD_RUNNING != pDownload->state) {
+		return;
+	}
+
+	IOT_ERROR("Stream request rejected: %.*s", (int) params->payloadLen, (const char *) params->payload);
+	failDownload(pDownload, FAILURE);
+}
+
+/* Narrow a range to its missing blocks, false when none is missing */
+static bool narrowToMissing(const StreamDownload_t *pDownload, uint32_t *pFirstBlock, uint32_t *pBlockCount) {
+	uint32_t first = *pFirstBlock;
+	uint32_t end = *pFirstBlock + *pBlockCount;
+
+	while(first < end && isBlockWritten(pDownload, first)) {
+		first++;
+	}
+	while(end > first && isBlockWritten(pDownload, end - 1)) {
+		end--;
+	}
+	*pFirstBlock = first;
+	*pBlockCount = end - first;
+	return end > first;
+}
+
+static IoT_Error_t sendRequest(StreamDownload_t *pDownload, StreamDownloadRequest_t *pRequest) {
+	IoT_Publish_Message_Params params;
+	int length;
+	IoT_Error_t rc;
+
+	pDownload->requestSequence++;
+	length = snprintf(pDownload->message, sizeof(pDownload->message),
+					  "{\"c\":\"%lu\",\"f\":%lu,\"l\":%lu,\"o\":%lu,\"n\":%lu}",
+					  (unsigned long) pDownload->requestSequence, (unsigned long) pDownload->params.fileId,
+					  (unsigned long) pDownload->params.blockSize, (unsigned long) pRequest->firstBlock,
+					  (unsigned long) pRequest->blockCount);
+
+	params.qos = QOS0;
+	params.isRetained = 0;
+	params.payload = pDownload->message;
+	params.payloadLen = (size_t) length;
+	rc = aws_iot_mqtt_publish(pDownload->pClient, pDownload->getTopic, (uint16_t) strlen(pDownload->getTopic),
+							  &params);
+
+	/* A request that could not be sent is late right away and goes out again on the next call */
+	pRequest->isInUse = true;
+	if(SUCCESS == rc) {
+		pDownload->requestsSent++;
+		countdown_ms(&pRequest->timer, pDownload->params.requestTimeoutMs);
+	} else {
+		init_timer(&pRequest->timer);
+	}
+	return rc;
+}
+
+static void retryRequest(StreamDownload_t *pDownload, StreamDownloadRequest_t *pRequest) {
+	if(pRequest->retries >= pDownload->params.maxRetries) {
+		IOT_ERROR("Blocks %u to %u not received", (unsigned) pRequest->firstBlock,
+				  (unsigned) (pRequest->firstBlock + pRequest->blockCount - 1));
+		failDownload(pDownload, MQTT_REQUEST_TIMEOUT_ERROR);
+		return;
+	}
+
+	pRequest->retries++;
+	if(SUCCESS != sendRequest(pDownload, pRequest)) {
+		pRequest->retries--;
+	}
+}
+
+/* Take the next range of missing blocks into a free request */
+static bool nextRequest(StreamDownload_t *pDownload, StreamDownloadRequest_t *pRequest) {
+	uint32_t blockCount;
+
+	while(pDownload->nextBlock < pDownload->blockCount && isBlockWritten(pDownload, pDownload->nextBlock)) {
+		pDownload->nextBlock++;
+	}
+	if(pDownload->nextBlock >= pDownload->blockCount) {
+		return false;
+	}
+
+	blockCount = pDownload->blockCount - pDownload->nextBlock;
+	if(blockCount > pDownload->params.blocksPerRequest) {
+		blockCount = pDownload->params.blocksPerRequest;
+	}
+
+	pRequest->firstBlock = pDownload->nextBlock;
+	pRequest->blockCount = blockCount;
+	pRequest->retries = 0;
+	pDownload->nextBlock += blockCount;
+	return narrowToMissing(pDownload, &pRequest->firstBlock, &pRequest->blockCount);
+}
+
+IoT_Error_t aws_iot_stream_download_init(StreamDownload_t *pDownload, AWS_IoT_Client *pClient,
+										 const StreamDownloadParams_t *pParams) {
+	uint32_t block;
+	size_t blockMessageLength;
+
+	FUNC_ENTRY;
+
+	if(NULL == pDownload || NULL == pClient || NULL == pParams || NULL == pParams->pThingName
+	   || NULL == pParams->pStreamName || NULL == pParams->pBitmap || NULL == pParams->write) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	memset(pDownload, 0, sizeof(StreamDownload_t));
+	if(0 == pParams->fileSize || pParams->blockSize < STREAM_DOWNLOAD_MIN_BLOCK_SIZE
+	   || 0 == pParams->blocksPerRequest || 0 == pParams->requestsInFlight
+	   || pParams->requestsInFlight > STREAM_DOWNLOAD_MAX_REQUESTS) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	if(snprintf(pDownload->dataTopic, sizeof(pDownload->dataTopic), "$aws/things/%s/streams/%s/data/json",
+				pParams->pThingName, pParams->pStreamName) >= (int) sizeof(pDownload->dataTopic)
+	   || snprintf(pDownload->rejectedTopic, sizeof(pDownload->rejectedTopic),
+				   "$aws/things/%s/streams/%s/rejected/json", pParams->pThingName, pParams->pStreamName)
+		  >= (int) sizeof(pDownload->rejectedTopic)
+	   || snprintf(pDownload->getTopic, sizeof(pDownload->getTopic), "$aws/things/%s/streams/%s/get/json",
+				   pParams->pThingName, pParams->pStreamName) >= (int) sizeof(pDownload->getTopic)) {
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	/* The whole data message, base64 block included, has to fit in the receive buffer */
+	blockMessageLength = 4 * ((pParams->blockSize + 2) / 3) + STREAM_DOWNLOAD_DATA_OVERHEAD
+						 + strlen(pDownload->dataTopic);
+	if(blockMessageLength > AWS_IOT_MQTT_RX_BUF_LEN) {
+		IOT_ERROR("Blocks of %u bytes do not fit in the MQTT receive buffer", (unsigned) pParams->blockSize);
+		FUNC_EXIT_RC(FAILURE);
+	}
+
+	pDownload->pClient = pClient;
+	pDownload->params = *pParams;
+	pDownload->blockCount = (pParams->fileSize + pParams->blockSize - 1) / pParams->blockSize;
+	for(block = 0; block < pDownload->blockCount; block++) {
+		if(isBlockWritten(pDownload, block)) {
+			pDownload->receivedCount++;
+		}
+	}
+	pDownload->state = STREAM_DOWNLOAD_IDLE;
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+IoT_Error_t aws_iot_stream_download_start(StreamDownload_t *pDownload) {
+	IoT_Subscribe_Topic_Params topics[STREAM_DOWNLOAD_FILTER_COUNT];
+	IoT_Error_t rc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pDownload) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(!pDownload->isSubscribed) {
+		topics[0].pTopicName = pDownload->dataTopic;
+		topics[0].pApplicationHandler = streamDataCallback;
+		topics[1].pTopicName = pDownload->rejectedTopic;
+		topics[1].pApplicationHandler = streamRejectedCallback;
+		topics[0].topicNameLen = (uint16_t) strlen(pDownload->dataTopic);
+		topics[1].topicNameLen = (uint16_t) strlen(pDownload->rejectedTopic);
+		topics[0].qos = topics[1].qos = QOS0;
+		topics[0].pApplicationHandlerData = topics[1].pApplicationHandlerData = pDownload;
+
+		rc = aws_iot_mqtt_subscribe_batch(pDownload->pClient, topics, STREAM_DOWNLOAD_FILTER_COUNT);
+		if(SUCCESS != rc) {
+			aws_iot_mqtt_unsubscribe(pDownload->pClient, topics[0].pTopicName, topics[0].topicNameLen);
+			aws_iot_mqtt_unsubscribe(pDownload->pClient, topics[1].pTopicName, topics[1].topicNameLen);
+			FUNC_EXIT_RC(rc);
+		}
+		pDownload->isSubscribed = true;
+	}
+
+	memset(pDownload->requests, 0, sizeof(pDownload->requests));
+	pDownload->nextBlock = 0;
+	pDownload->failure = SUCCESS;
+	pDownload->state = (pDownload->receivedCount == pDownload->blockCount) ? STREAM_DOWNLOAD_COMPLETE
+																			: STREAM_DOWNLOAD_RUNNING;
+	IOT_INFO("Downloading %u of %u blocks", (unsigned) (pDownload->blockCount - pDownload->receivedCount),
+			 (unsigned) pDownload->blockCount);
+
+	FUNC_EXIT_RC(SUCCESS);
+}
+
+StreamDownloadState_t aws_iot_stream_download_process(StreamDownload_t *pDownload) {
+	StreamDownloadRequest_t *pRequest;
+	uint8_t i;
+
+	if(NULL == pDownload) {
+		return STREAM_DOWNLOAD_FAILED;
+	}
+
+	for(i = 0; i < pDownload->params.requestsInFlight && STREAM_DOWNLOAD_RUNNING == pDownload->state; i++) {
+		pRequest = &pDownload->requests[i];
+
+		if(pRequest->isInUse && !narrowToMissing(pDownload, &pRequest->firstBlock, &pRequest->blockCount)) {
+			pRequest->isInUse = false;
+		}
+		if(pRequest->isInUse) {
+			if(has_timer_expired(&pRequest->timer)) {
+				retryRequest(pDownload, pRequest);
+			}
+		} else if(nextRequest(pDownload, pRequest) && SUCCESS != sendRequest(pDownload, pRequest)) {
+			/* The client is busy, the other slots wait for the next call too */
+			break;
+		}
+	}
+
+	return (StreamDownloadState_t) pDownload->state;
+}
+
+IoT_Error_t aws_iot_stream_download_stop(StreamDownload_t *pDownload) {
+	IoT_Error_t rc = SUCCESS;
+	IoT_Error_t unsubscribeRc;
+
+	FUNC_ENTRY;
+
+	if(NULL == pDownload) {
+		FUNC_EXIT_RC(NULL_VALUE_ERROR);
+	}
+
+	if(pDownload->isSubscribed) {
+		rc = aws_iot_mqtt_unsubscribe(pDownload->pClient, pDownload->dataTopic,
+									  (uint16_t) strlen(pDownload->dataTopic));
+		unsubscribeRc = aws_iot_mqtt_unsubscribe(pDownload->pClient, pDownload->rejectedTopic,
+												 (uint16_t) strlen(pDownload->rejectedTopic));
+		if(SUCCESS == rc) {
+			rc = unsubscribeRc;
+		}
+		pDownload->isSubscribed = false;
+	}
+	if(STREAM_DOWNLOAD_RUNNING == pDownload->state) {
+		pDownload->state = STREAM_DOWNLOAD_IDLE;
+	}
+
+	FUNC_EXIT_RC(rc);
+}
+
+#ifdef __cplusplus
+}
+#endif
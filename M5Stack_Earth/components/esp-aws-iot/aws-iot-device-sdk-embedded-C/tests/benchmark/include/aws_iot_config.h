@@ -0,0 +1,73 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_config.h
+ * @brief IoT Client Benchmarks - IoT Config
+ */
+
+#ifndef IOT_TESTS_BENCHMARK_CONFIG_H_
+#define IOT_TESTS_BENCHMARK_CONFIG_H_
+
+/* The fork's SDK sources expect the config header to bring in the log macros, as the ESP32 port's does */
+#include "aws_iot_log.h"
+
+// Get from console
+// =================================================
+#define AWS_IOT_MQTT_HOST              "localhost"
+#define AWS_IOT_MQTT_PORT              443
+#define AWS_IOT_MQTT_CLIENT_ID         "C-SDK_BenchmarkClient"
+#define AWS_IOT_MY_THING_NAME          "C-SDK_BenchmarkThing"
+#define AWS_IOT_ROOT_CA_FILENAME       "rootCA.crt"
+#define AWS_IOT_CERTIFICATE_FILENAME   "cert.crt"
+#define AWS_IOT_PRIVATE_KEY_FILENAME   "privkey.pem"
+// =================================================
+
+
+// MQTT PubSub
+#define AWS_IOT_MQTT_RX_BUF_LEN 8192 ///< Any message that comes into the device should be less than this buffer size. If a received message is bigger than this buffer size the message will be dropped.
+#define AWS_IOT_MQTT_TX_BUF_LEN 8192 ///< Any time a message is sent out through the MQTT layer. The message is copied into this buffer anytime a publish is done. This will also be used in the case of Thing Shadow
+#define AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS 5 ///< Maximum number of topic filters the MQTT client can handle at any given time. This should be increased appropriately when using Thing Shadow
+#define AWS_IOT_MQTT_NUM_UNACKED_PUBLISHES 2 ///< Number of unacknowledged QoS1 publishes kept for redelivery when a persistent session is resumed
+
+// Shadow and Job common configs
+#define MAX_SIZE_OF_UNIQUE_CLIENT_ID_BYTES 80  ///< Maximum size of the Unique Client Id. For More info on the Client Id refer \ref response "Acknowledgments"
+#define MAX_SIZE_CLIENT_ID_WITH_SEQUENCE MAX_SIZE_OF_UNIQUE_CLIENT_ID_BYTES + 10 ///< This is size of the extra sequence number that will be appended to the Unique client Id
+#define MAX_SIZE_CLIENT_TOKEN_CLIENT_SEQUENCE MAX_SIZE_CLIENT_ID_WITH_SEQUENCE + 20 ///< This is size of the the total clientToken key and value pair in the JSON
+#define MAX_SIZE_OF_THING_NAME 30 ///< The Thing Name should not be bigger than this value. Modify this if the Thing Name needs to be bigger
+
+// Thing Shadow specific configs
+#define SHADOW_MAX_SIZE_OF_RX_BUFFER (AWS_IOT_MQTT_RX_BUF_LEN + 1) ///< Maximum size of the SHADOW buffer to store the received Shadow message
+#define MAX_ACKS_TO_COMEIN_AT_ANY_GIVEN_TIME 10 ///< At Any given time we will wait for this many responses. This will correlate to the rate at which the shadow actions are requested
+#define MAX_THINGNAME_HANDLED_AT_ANY_GIVEN_TIME 10 ///< We could perform shadow action on any thing Name and this is maximum Thing Names we can act on at any given time
+#define MAX_JSON_TOKEN_EXPECTED 1024 ///< These are the max tokens that is expected to be in the Shadow JSON document. Include the metadata that gets published
+#define MAX_SHADOW_TOPIC_LENGTH_WITHOUT_THINGNAME 60 ///< All shadow actions have to be published or subscribed to a topic which is of the format $aws/things/{thingName}/shadow/update/accepted. This refers to the size of the topic without the Thing Name
+#define MAX_SHADOW_TOPIC_LENGTH_BYTES MAX_SHADOW_TOPIC_LENGTH_WITHOUT_THINGNAME + MAX_SIZE_OF_THING_NAME ///< This size includes the length of topic with Thing Name
+
+// Job specific configs
+#ifndef DISABLE_IOT_JOBS
+#define MAX_SIZE_OF_JOB_ID 64
+#define MAX_JOB_JSON_TOKEN_EXPECTED 120
+#define MAX_SIZE_OF_JOB_REQUEST AWS_IOT_MQTT_TX_BUF_LEN
+
+#define MAX_JOB_TOPIC_LENGTH_WITHOUT_JOB_ID_OR_THING_NAME 40
+#define MAX_JOB_TOPIC_LENGTH_BYTES MAX_JOB_TOPIC_LENGTH_WITHOUT_JOB_ID_OR_THING_NAME + MAX_SIZE_OF_THING_NAME + MAX_SIZE_OF_JOB_ID + 2
+#endif
+
+// Auto Reconnect specific config
+#define AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL 1000 ///< Base interval of the jittered reconnect back-off. The first reconnect attempt is made within this interval
+#define AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL 128000 ///< Maximum time between reconnect attempts
+
+#endif /* IOT_TESTS_BENCHMARK_CONFIG_H_ */
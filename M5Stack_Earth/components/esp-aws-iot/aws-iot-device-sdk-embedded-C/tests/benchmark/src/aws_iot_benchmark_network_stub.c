@@ -0,0 +1,89 @@
+/*
+* Copyright 2015-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_network_stub.c
+ * @brief Host benchmarks - network layer that never connects
+ *
+ * The benchmarks call SDK internals directly. The MQTT client still links against
+ * the network interface, which is satisfied here.
+ */
+
+#include <stddef.h>
+
+#include "aws_iot_error.h"
+#include "network_interface.h"
+
+IoT_Error_t iot_tls_init(Network *pNetwork, const char *pRootCALocation, const char *pDeviceCertLocation,
+						 const char *pDevicePrivateKeyLocation, const char *pDestinationURL,
+						 uint16_t DestinationPort, uint32_t timeout_ms, bool ServerVerificationFlag) {
+	IOT_UNUSED(pRootCALocation);
+	IOT_UNUSED(pDeviceCertLocation);
+	IOT_UNUSED(pDevicePrivateKeyLocation);
+	IOT_UNUSED(pDestinationURL);
+	IOT_UNUSED(DestinationPort);
+	IOT_UNUSED(timeout_ms);
+	IOT_UNUSED(ServerVerificationFlag);
+
+	pNetwork->connect = iot_tls_connect;
+	pNetwork->read = iot_tls_read;
+	pNetwork->write = iot_tls_write;
+	pNetwork->disconnect = iot_tls_disconnect;
+	pNetwork->isConnected = iot_tls_is_connected;
+	pNetwork->destroy = iot_tls_destroy;
+	pNetwork->waitForReadable = NULL;
+	pNetwork->wakeup = NULL;
+
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_connect(Network *pNetwork, TLSConnectParams *params) {
+	IOT_UNUSED(pNetwork);
+	IOT_UNUSED(params);
+	return NETWORK_ERR_NET_CONNECT_FAILED;
+}
+
+IoT_Error_t iot_tls_write(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *timer, size_t *written_len) {
+	IOT_UNUSED(pNetwork);
+	IOT_UNUSED(pMsg);
+	IOT_UNUSED(len);
+	IOT_UNUSED(timer);
+	*written_len = 0;
+	return NETWORK_SSL_WRITE_ERROR;
+}
+
+IoT_Error_t iot_tls_read(Network *pNetwork, unsigned char *pMsg, size_t len, Timer *timer, size_t *read_len) {
+	IOT_UNUSED(pNetwork);
+	IOT_UNUSED(pMsg);
+	IOT_UNUSED(len);
+	IOT_UNUSED(timer);
+	*read_len = 0;
+	return NETWORK_SSL_READ_ERROR;
+}
+
+IoT_Error_t iot_tls_disconnect(Network *pNetwork) {
+	IOT_UNUSED(pNetwork);
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_destroy(Network *pNetwork) {
+	IOT_UNUSED(pNetwork);
+	return SUCCESS;
+}
+
+IoT_Error_t iot_tls_is_connected(Network *pNetwork) {
+	IOT_UNUSED(pNetwork);
+	return NETWORK_PHYSICAL_LAYER_DISCONNECTED;
+}
@@ -0,0 +1,54 @@
+/*
+* Copyright 2015-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_benchmark_runner.c
+ * @brief Host benchmarks runner
+ */
+
+#include <string.h>
+
+#include "aws_iot_benchmark_common.h"
+
+typedef struct {
+	const char *pName;
+	int (*run)(void);
+} BenchmarkEntry_t;
+
+static const BenchmarkEntry_t benchmarks[] = {
+	{"delta_patch", aws_iot_benchmark_delta_patch},
+	{"json_stream", aws_iot_benchmark_json_stream},
+	{"json_view", aws_iot_benchmark_json_view},
+	{"shadow_delta", aws_iot_benchmark_shadow_delta},
+	{"shadow_json", aws_iot_benchmark_shadow_json},
+};
+
+int main(int argc, char **argv) {
+	size_t i;
+	int rc = 0;
+
+	for(i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+		if(argc > 1 && strcmp(argv[1], benchmarks[i].pName) != 0) {
+			continue;
+		}
+		printf("\n=== %s ===\n", benchmarks[i].pName);
+		if(0 != benchmarks[i].run()) {
+			printf("%s FAILED\n", benchmarks[i].pName);
+			rc = 1;
+		}
+	}
+
+	return rc;
+}
@@ -84,3 +84,13 @@ TEST_GROUP_C_WRAPPER(ConnectTests, cleanSessionInitSubscribers)
 TEST_GROUP_C_WRAPPER(ConnectTests, PowerCycleWithCleanSessionFalse)
 /* B:29 - Reconnect attempt succeeds, but resubscribes fail */
 TEST_GROUP_C_WRAPPER(ConnectTests, ReconnectAndResubscribe)
+/* B:30 - Reconnect resumes persistent session, resubscribe skipped */
+TEST_GROUP_C_WRAPPER(ConnectTests, ReconnectWithSessionPresentSkipsResubscribe)
+/* B:31 - Unacknowledged QoS1 publish redelivered when the session is resumed */
+TEST_GROUP_C_WRAPPER(ConnectTests, UnackedPublishRedeliveredOnSessionResume)
+/* B:32 - Connect with backoff, first attempt fails, retried */
+TEST_GROUP_C_WRAPPER(ConnectTests, ConnectWithBackoffRetriesAfterFailure)
+/* B:33 - Connect with backoff, gives up after max attempts */
+TEST_GROUP_C_WRAPPER(ConnectTests, ConnectWithBackoffGivesUp)
+/* B:34 - Reconnect backoff is jittered, decorrelated and capped */
+TEST_GROUP_C_WRAPPER(ConnectTests, ReconnectBackoffJitter)
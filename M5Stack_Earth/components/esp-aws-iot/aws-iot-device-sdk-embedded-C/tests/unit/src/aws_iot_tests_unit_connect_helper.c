@@ -21,6 +21,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/time.h>
 #include <CppUTest/TestHarness_c.h>
 #include <aws_iot_mqtt_client.h>
 
@@ -729,7 +730,8 @@ TEST_C(ConnectTests, ReconnectAndResubscribe) {
 	int itr = 0;
 	char subTestTopic[12] = { 0 };
 	uint16_t subTestTopicLen = 0;
-	IoT_Publish_Message_Params publish = { 0 };
+	uint32_t subackQoSCount = 3;
+	IoT_Connection_Metrics metrics;
 
 	IOT_DEBUG("-->Running Connect Tests - B:29 - Reconnect attempt succeeds, but resubscribes fail \n");
 
@@ -762,31 +764,276 @@ TEST_C(ConnectTests, ReconnectAndResubscribe) {
 	}
 
 	// 4. Trigger a reconnect by mocking NETWORK_SSL_READ_ERROR and calling yield.
-	// Place a CONNACK and SUBACK in the Rx buffer so that connect and 1 subscribe
-	// succeed. Note that the CONNACK and SUBACK placed in the Rx buffer are not
-	// effected by the mocked error as it does not change thr content of the Rx
-	// buffer.
+	// Place a CONNACK and a SUBACK with a single return code in the Rx buffer.
+	// All 3 topics are resubscribed with one SUBSCRIBE packet, so the SUBACK
+	// does not acknowledge it. Note that the CONNACK and SUBACK placed in the
+	// Rx buffer are not effected by the mocked error as it does not change
+	// thr content of the Rx buffer.
 	setTLSRxBufferForError(NETWORK_SSL_READ_ERROR);
 	setTLSRxBufferForConnackAndSuback(&connectParams, 0, "sdk/topic0", 10, QOS0);
 	rc = aws_iot_mqtt_yield(&iotClient, AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL * 2);
 
-	// 5. Check results of yield call. As only 1 SUBACK was present in the Rx
-	// buffer, 2 resubscribes must fail. Client should be in a pending
-	// resubscribe state and the auto reconnect interval should have doubled.
+	// 5. Check results of yield call. The resubscribe must fail for all 3 topics.
+	// Client should be in a pending resubscribe state and the jittered backoff
+	// should be at least the base interval and at most three times the first delay.
 	CHECK_EQUAL_C_INT(NETWORK_ATTEMPTING_RECONNECT, rc);
-	CHECK_EQUAL_C_INT(1, iotClient.clientData.messageHandlers[0].resubscribed);
+	CHECK_EQUAL_C_INT(0, iotClient.clientData.messageHandlers[0].resubscribed);
 	CHECK_EQUAL_C_INT(0, iotClient.clientData.messageHandlers[1].resubscribed);
 	CHECK_EQUAL_C_INT(0, iotClient.clientData.messageHandlers[2].resubscribed);
 	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_RESUBSCRIBE_IN_PROGRESS, aws_iot_mqtt_get_client_state(&iotClient));
-	CHECK_EQUAL_C_INT(2 * AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL, (int) iotClient.clientData.currentReconnectWaitInterval);
+	CHECK_C(AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL <= iotClient.clientData.currentReconnectWaitInterval);
+	CHECK_C(3 * AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL >= iotClient.clientData.currentReconnectWaitInterval);
 
-	// 6. Add 2 more SUBACKs to the Rx buffer to complete the resubscribe.
-	setTLSRxBufferForDoubleSuback("sdk/topic1", 10, QOS0, publish);
+	// 6. Add a SUBACK acknowledging all 3 topics to complete the resubscribe.
+	setTLSRxBufferForMultiSuback(&subackQoSCount, 1, QOS0);
 	rc = aws_iot_mqtt_yield(&iotClient, 2 * AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL * 2);
 	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
 	CHECK_EQUAL_C_INT(1, iotClient.clientData.messageHandlers[0].resubscribed);
 	CHECK_EQUAL_C_INT(1, iotClient.clientData.messageHandlers[1].resubscribed);
 	CHECK_EQUAL_C_INT(1, iotClient.clientData.messageHandlers[2].resubscribed);
 
+	// 7. The outage took the failed and the successful resubscribe attempt
+	rc = aws_iot_mqtt_get_connection_metrics(&iotClient, &metrics);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, metrics.reconnectCount);
+	CHECK_C(2 <= metrics.lastOutageAttempts);
+	CHECK_C(AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL <= metrics.lastOutageMs);
+
 	IOT_DEBUG("-->Success - B:29 - Reconnect attempt succeeds, but resubscribes fail \n");
 }
+
+/* B:30 - Reconnect resumes persistent session, resubscribe skipped */
+TEST_C(ConnectTests, ReconnectWithSessionPresentSkipsResubscribe) {
+	IoT_Error_t rc = SUCCESS;
+	int itr = 0;
+	char subTestTopic[12] = { 0 };
+	uint16_t subTestTopicLen = 0;
+	IoT_Connection_Metrics metrics;
+
+	IOT_DEBUG("-->Running Connect Tests - B:30 - Reconnect resumes persistent session, resubscribe skipped \n");
+
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, true, NULL);
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ResetTLSBuffer();
+
+	// 1. Connect with a persistent session, the server has no session yet
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	connectParams.isCleanSession = false;
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(false, aws_iot_mqtt_is_session_present(&iotClient));
+
+	// 2. Add 3 subscriptions
+	for(itr = 0; itr < 3; itr++) {
+		snprintf(subTestTopic, 12, "sdk/topic%d", itr + 1);
+		subTestTopicLen = (uint16_t) strlen(subTestTopic);
+		setTLSRxBufferForSuback(subTestTopic, subTestTopicLen, QOS0, testPubMsgParams);
+		rc = aws_iot_mqtt_subscribe(&iotClient, subTestTopic, subTestTopicLen, QOS0, iot_subscribe_callback_handler,
+									NULL);
+		CHECK_EQUAL_C_INT(SUCCESS, rc);
+	}
+
+	// 3. Trigger a reconnect. Only a CONNACK with session present is in the Rx buffer,
+	// so any SUBSCRIBE sent would time out waiting for its SUBACK.
+	snprintf(LastSubscribeMessage, 12, "NOT_SENT");
+	setTLSRxBufferForError(NETWORK_SSL_READ_ERROR);
+	setTLSRxBufferForConnack(&connectParams, 1, 0);
+	rc = aws_iot_mqtt_yield(&iotClient, AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL * 2);
+
+	// 4. The session was resumed, subscriptions are kept without resubscribing
+	CHECK_EQUAL_C_INT(true, aws_iot_mqtt_is_session_present(&iotClient));
+	CHECK_EQUAL_C_INT(CLIENT_STATE_CONNECTED_IDLE, aws_iot_mqtt_get_client_state(&iotClient));
+	CHECK_EQUAL_C_STRING("NOT_SENT", LastSubscribeMessage);
+	for(itr = 0; itr < 3; itr++) {
+		CHECK_EQUAL_C_INT(1, iotClient.clientData.messageHandlers[itr].resubscribed);
+	}
+
+	// 5. Recovered with a single attempt and no time spent resubscribing
+	rc = aws_iot_mqtt_get_connection_metrics(&iotClient, &metrics);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(1, metrics.reconnectCount);
+	CHECK_EQUAL_C_INT(1, metrics.lastOutageAttempts);
+	CHECK_EQUAL_C_INT(0, metrics.resubscribeMs);
+	CHECK_C(2 * AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL > metrics.lastOutageMs);
+
+	IOT_DEBUG("-->Success - B:30 - Reconnect resumes persistent session, resubscribe skipped \n");
+}
+
+/* B:31 - Unacknowledged QoS1 publish redelivered when the session is resumed */
+TEST_C(ConnectTests, UnackedPublishRedeliveredOnSessionResume) {
+	IoT_Error_t rc = SUCCESS;
+	char payload[] = "persistent";
+	IoT_Publish_Message_Params pubParams = { 0 };
+
+	IOT_DEBUG("-->Running Connect Tests - B:31 - Unacked QoS1 publish redelivered on session resume \n");
+
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	initParams.mqttCommandTimeout_ms = 200;
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ResetTLSBuffer();
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	connectParams.isCleanSession = false;
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	// 1. QoS1 publish without a PUBACK is kept for redelivery
+	ResetTLSBuffer();
+	pubParams.qos = QOS1;
+	pubParams.isRetained = 0;
+	pubParams.payload = payload;
+	pubParams.payloadLen = strlen(payload);
+	rc = aws_iot_mqtt_publish(&iotClient, subTopic1, (uint16_t) strlen(subTopic1), &pubParams);
+	CHECK_EQUAL_C_INT(MQTT_REQUEST_TIMEOUT_ERROR, rc);
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_get_unacked_publish_count(&iotClient));
+
+	// 2. Resume the session, the publish is sent again with the DUP flag
+	rc = aws_iot_mqtt_disconnect(&iotClient);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ResetTLSBuffer();
+	setTLSRxBufferForConnack(&connectParams, 1, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0x3A, TxBuffer.pBuffer[0]);
+	CHECK_EQUAL_C_STRING(subTopic1, LastPublishMessageTopic);
+	CHECK_EQUAL_C_STRING(payload, LastPublishMessagePayload);
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_get_unacked_publish_count(&iotClient));
+
+	// 3. The PUBACK arrives in yield and releases the entry
+	setTLSRxBufferForPuback();
+	RxBuffer.pBuffer[2] = (unsigned char) (pubParams.id >> 8);
+	RxBuffer.pBuffer[3] = (unsigned char) (pubParams.id & 0xFF);
+	rc = aws_iot_mqtt_yield(&iotClient, 100);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_get_unacked_publish_count(&iotClient));
+
+	// 4. A session that was not resumed drops unacknowledged publishes
+	ResetTLSBuffer();
+	rc = aws_iot_mqtt_publish(&iotClient, subTopic1, (uint16_t) strlen(subTopic1), &pubParams);
+	CHECK_EQUAL_C_INT(MQTT_REQUEST_TIMEOUT_ERROR, rc);
+	CHECK_EQUAL_C_INT(1, aws_iot_mqtt_get_unacked_publish_count(&iotClient));
+	rc = aws_iot_mqtt_disconnect(&iotClient);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	ResetTLSBuffer();
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&iotClient, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_get_unacked_publish_count(&iotClient));
+	CHECK_EQUAL_C_INT(0, aws_iot_mqtt_get_unacked_publish_count(NULL));
+
+	IOT_DEBUG("-->Success - B:31 - Unacked QoS1 publish redelivered on session resume \n");
+}
+
+/* B:32 - Connect with backoff, first attempt fails, retried */
+TEST_C(ConnectTests, ConnectWithBackoffRetriesAfterFailure) {
+	IoT_Error_t rc = SUCCESS;
+	IoT_Connection_Metrics metrics;
+	struct timeval start, end, elapsed;
+
+	IOT_DEBUG("-->Running Connect Tests - B:32 - Connect with backoff, first attempt fails, retried \n");
+
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	// The mocked read error fails the first attempt, the second one reads the CONNACK
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForError(NETWORK_SSL_READ_ERROR);
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+
+	gettimeofday(&start, NULL);
+	rc = aws_iot_mqtt_connect_with_backoff(&iotClient, &connectParams, 3);
+	gettimeofday(&end, NULL);
+	timersub(&end, &start, &elapsed);
+
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(true, aws_iot_mqtt_is_client_connected(&iotClient));
+	// The first retry waits at most the base interval
+	CHECK_C(AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL / 1000 + 1 > elapsed.tv_sec);
+
+	// The mocked network layer does not report connect phases
+	rc = aws_iot_mqtt_get_connection_metrics(&iotClient, &metrics);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	CHECK_EQUAL_C_INT(0, metrics.dnsLookupMs);
+	CHECK_EQUAL_C_INT(0, metrics.tcpConnectMs);
+	CHECK_EQUAL_C_INT(0, metrics.tlsHandshakeMs);
+	CHECK_EQUAL_C_INT(0, metrics.reconnectCount);
+
+	IOT_DEBUG("-->Success - B:32 - Connect with backoff, first attempt fails, retried \n");
+}
+
+/* B:33 - Connect with backoff, gives up after max attempts */
+TEST_C(ConnectTests, ConnectWithBackoffGivesUp) {
+	IoT_Error_t rc = SUCCESS;
+	char invalidEndPoint[20];
+	snprintf(invalidEndPoint, 20, "invalid");
+
+	IOT_DEBUG("-->Running Connect Tests - B:33 - Connect with backoff, gives up after max attempts \n");
+
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	invalidEndpointFilter = invalidEndPoint;
+	initParams.pHostURL = invalidEndpointFilter;
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	rc = aws_iot_mqtt_connect_with_backoff(&iotClient, &connectParams, 2);
+	CHECK_EQUAL_C_INT(NETWORK_ERR_NET_UNKNOWN_HOST, rc);
+	CHECK_EQUAL_C_INT(false, aws_iot_mqtt_is_client_connected(&iotClient));
+
+	rc = aws_iot_mqtt_connect_with_backoff(NULL, &connectParams, 2);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, rc);
+
+	IOT_DEBUG("-->Success - B:33 - Connect with backoff, gives up after max attempts \n");
+}
+
+/* B:34 - Reconnect backoff is jittered, decorrelated and capped */
+TEST_C(ConnectTests, ReconnectBackoffJitter) {
+	IoT_Error_t rc = SUCCESS;
+	static AWS_IoT_Client otherClient;
+	uint32_t delay, previous, upper;
+	int itr = 0;
+	bool isSpread = false;
+
+	IOT_DEBUG("-->Running Connect Tests - B:34 - Reconnect backoff is jittered, decorrelated and capped \n");
+
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	rc = aws_iot_mqtt_init(&iotClient, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+	aws_iot_mqtt_internal_seed_backoff(&iotClient, "device-1", 8);
+	aws_iot_mqtt_internal_seed_backoff(&otherClient, "device-2", 8);
+
+	// First delay after a disconnect is spread over the base interval,
+	// devices with different client IDs do not retry in lockstep
+	for(itr = 0; itr < 8; itr++) {
+		delay = aws_iot_mqtt_internal_next_backoff_ms(&iotClient, true);
+		CHECK_C(AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL >= delay);
+		if(delay != aws_iot_mqtt_internal_next_backoff_ms(&otherClient, true)) {
+			isSpread = true;
+		}
+	}
+	CHECK_C(isSpread);
+
+	// Following delays stay between the base interval and three times the previous delay
+	previous = aws_iot_mqtt_internal_next_backoff_ms(&iotClient, true);
+	for(itr = 0; itr < 200; itr++) {
+		delay = aws_iot_mqtt_internal_next_backoff_ms(&iotClient, false);
+		upper = 3 * previous;
+		if(AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL < upper) {
+			upper = AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL;
+		}
+		if(AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL > upper) {
+			upper = AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL;
+		}
+		CHECK_C(AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL <= delay);
+		CHECK_C(upper >= delay);
+		CHECK_EQUAL_C_INT(delay, iotClient.clientData.currentReconnectWaitInterval);
+		previous = delay;
+	}
+
+	IOT_DEBUG("-->Success - B:34 - Reconnect backoff is jittered, decorrelated and capped \n");
+}
@@ -0,0 +1,34 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_delta_patch.cpp
+ * @brief IoT Client Unit Testing - Delta Patch Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(DeltaPatchTest){
+	TEST_GROUP_C_SETUP_WRAPPER(DeltaPatchTest)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(DeltaPatchTest)
+};
+
+TEST_GROUP_C_WRAPPER(DeltaPatchTest, ReadHeaderChecks)
+TEST_GROUP_C_WRAPPER(DeltaPatchTest, DiffAndExtraRebuildTarget)
+TEST_GROUP_C_WRAPPER(DeltaPatchTest, MatchesCopyFromWindow)
+TEST_GROUP_C_WRAPPER(DeltaPatchTest, AnyChunkSizeGivesSameTarget)
+TEST_GROUP_C_WRAPPER(DeltaPatchTest, CorruptPatchesRejected)
+TEST_GROUP_C_WRAPPER(DeltaPatchTest, LimitsAndCallbackErrors)
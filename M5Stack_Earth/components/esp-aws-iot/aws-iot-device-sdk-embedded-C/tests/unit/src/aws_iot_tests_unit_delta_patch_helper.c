@@ -0,0 +1,419 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_delta_patch_helper.c
+ * @brief IoT Client Unit Testing - Delta Patch Tests Helper
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_delta_patch.h"
+#include "aws_iot_log.h"
+
+#define SOURCE_SIZE 600
+#define TARGET_MAX_SIZE 2048
+#define PATCH_MAX_SIZE 4096
+
+static DeltaPatch_t patch;
+static DeltaPatchParams_t params;
+static uint8_t source[SOURCE_SIZE];
+static uint8_t target[TARGET_MAX_SIZE];
+static uint32_t targetWritten;
+static uint32_t writeCount;
+static IoT_Error_t writeResult;
+
+/* Patch under construction */
+static uint8_t patchData[PATCH_MAX_SIZE];
+static size_t patchLength;
+
+static IoT_Error_t readSource(void *pContext, uint32_t offset, uint8_t *pBuffer, size_t length) {
+	IOT_UNUSED(pContext);
+
+	if(offset + length > SOURCE_SIZE) {
+		return FAILURE;
+	}
+	memcpy(pBuffer, source + offset, length);
+	return SUCCESS;
+}
+
+static IoT_Error_t writeTarget(void *pContext, uint32_t offset, const uint8_t *pData, size_t length) {
+	IOT_UNUSED(pContext);
+
+	/* The target is written in order */
+	if(offset != targetWritten || offset + length > TARGET_MAX_SIZE || length > DELTA_PATCH_TARGET_BUFFER_SIZE) {
+		return FAILURE;
+	}
+	memcpy(target + offset, pData, length);
+	targetWritten += (uint32_t) length;
+	writeCount++;
+	return writeResult;
+}
+
+static void putByte(uint8_t byte) {
+	patchData[patchLength++] = byte;
+}
+
+static void putHeader(uint8_t windowBits, uint32_t sourceSize, uint32_t targetSize) {
+	uint8_t i;
+
+	patchLength = 0;
+	putByte('D');
+	putByte('P');
+	putByte('A');
+	putByte('T');
+	putByte(DELTA_PATCH_VERSION);
+	putByte(windowBits);
+	putByte(0);
+	putByte(0);
+	for(i = 0; i < 4; i++) {
+		putByte((uint8_t) (sourceSize >> (8 * i)));
+	}
+	for(i = 0; i < 4; i++) {
+		putByte((uint8_t) (targetSize >> (8 * i)));
+	}
+	for(i = 0; i < DELTA_PATCH_HASH_SIZE; i++) {
+		putByte(i);
+	}
+}
+
+static void putExtendedLength(size_t length) {
+	while(length >= 255) {
+		putByte(255);
+		length -= 255;
+	}
+	putByte((uint8_t) length);
+}
+
+/* One compressed sequence: literals then an optional match */
+static void putSequence(const uint8_t *pLiterals, size_t literalCount, size_t matchLength, uint16_t matchOffset) {
+	size_t matchCode = matchLength ? matchLength - 3 : 0;
+
+	putByte((uint8_t) ((literalCount < 15 ? literalCount : 15) << 4 | (matchCode < 15 ? matchCode : 15)));
+	if(literalCount >= 15) {
+		putExtendedLength(literalCount - 15);
+	}
+	memcpy(patchData + patchLength, pLiterals, literalCount);
+	patchLength += literalCount;
+	if(matchLength) {
+		putByte((uint8_t) matchOffset);
+		putByte((uint8_t) (matchOffset >> 8));
+		if(matchCode >= 15) {
+			putExtendedLength(matchCode - 15);
+		}
+	}
+}
+
+/* Uncompressed command numbers, seek zigzag encoded, as literals */
+static void putCommand(int32_t seek, uint32_t diffLength, uint32_t extraLength) {
+	uint8_t numbers[15];
+	uint32_t values[3];
+	size_t length = 0;
+	uint8_t i;
+
+	values[0] = seek < 0 ? ((uint32_t) -(seek + 1) << 1) | 1 : (uint32_t) seek << 1;
+	values[1] = diffLength;
+	values[2] = extraLength;
+	for(i = 0; i < 3; i++) {
+		while(values[i] >= 0x80) {
+			numbers[length++] = (uint8_t) (values[i] | 0x80);
+			values[i] >>= 7;
+		}
+		numbers[length++] = (uint8_t) values[i];
+	}
+	putSequence(numbers, length, 0, 0);
+}
+
+static IoT_Error_t applyInChunks(size_t chunkSize) {
+	IoT_Error_t rc = SUCCESS;
+	size_t offset;
+	size_t length;
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_delta_patch_init(&patch, &params));
+	targetWritten = 0;
+	writeCount = 0;
+	memset(target, 0, sizeof(target));
+	for(offset = 0; offset < patchLength && SUCCESS == rc; offset += length) {
+		length = patchLength - offset < chunkSize ? patchLength - offset : chunkSize;
+		rc = aws_iot_delta_patch_feed(&patch, patchData + offset, length);
+	}
+	if(SUCCESS != rc) {
+		return rc;
+	}
+	return aws_iot_delta_patch_finish(&patch);
+}
+
+TEST_GROUP_C_SETUP(DeltaPatchTest) {
+	size_t i;
+
+	for(i = 0; i < SOURCE_SIZE; i++) {
+		source[i] = (uint8_t) (i * 7 + (i >> 3));
+	}
+	params.readSource = readSource;
+	params.writeTarget = writeTarget;
+	params.pContext = NULL;
+	params.maxSourceSize = SOURCE_SIZE;
+	params.maxTargetSize = TARGET_MAX_SIZE;
+	writeResult = SUCCESS;
+	patchLength = 0;
+}
+
+TEST_GROUP_C_TEARDOWN(DeltaPatchTest) {
+
+}
+
+TEST_C(DeltaPatchTest, ReadHeaderChecks) {
+	DeltaPatchHeader_t header;
+
+	IOT_DEBUG("\n-->Running Delta Patch Tests - Read header checks \n");
+
+	putHeader(10, SOURCE_SIZE, 1234);
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_delta_patch_read_header(NULL, patchLength, &header));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_delta_patch_read_header(patchData, patchLength, NULL));
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_delta_patch_read_header(patchData, DELTA_PATCH_HEADER_SIZE - 1, &header));
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_delta_patch_read_header(patchData, patchLength, &header));
+	CHECK_EQUAL_C_INT(10, header.windowBits);
+	CHECK_EQUAL_C_INT(SOURCE_SIZE, header.sourceSize);
+	CHECK_EQUAL_C_INT(1234, header.targetSize);
+	CHECK_EQUAL_C_INT(0, header.sourceHash[0]);
+	CHECK_EQUAL_C_INT(DELTA_PATCH_HASH_SIZE - 1, header.sourceHash[DELTA_PATCH_HASH_SIZE - 1]);
+
+	patchData[0] = 'X';
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_delta_patch_read_header(patchData, patchLength, &header));
+	patchData[0] = 'D';
+	patchData[4] = DELTA_PATCH_VERSION + 1;
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_delta_patch_read_header(patchData, patchLength, &header));
+	patchData[4] = DELTA_PATCH_VERSION;
+	patchData[5] = DELTA_PATCH_MIN_WINDOW_BITS - 1;
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_delta_patch_read_header(patchData, patchLength, &header));
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_delta_patch_init(NULL, &params));
+	params.writeTarget = NULL;
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_delta_patch_init(&patch, &params));
+
+	IOT_DEBUG("-->Success - Read header checks \n");
+}
+
+TEST_C(DeltaPatchTest, DiffAndExtraRebuildTarget) {
+	uint8_t diff[40];
+	uint8_t expected[100];
+	uint8_t extra[20];
+	size_t i;
+
+	IOT_DEBUG("\n-->Running Delta Patch Tests - Diff and extra bytes rebuild the target \n");
+
+	/* 40 bytes of source 100 with 1 added, 20 new bytes, then 40 bytes of source 20 unchanged */
+	for(i = 0; i < 40; i++) {
+		diff[i] = 1;
+		expected[i] = (uint8_t) (source[100 + i] + 1);
+		expected[60 + i] = source[20 + i];
+	}
+	for(i = 0; i < 20; i++) {
+		extra[i] = (uint8_t) (0xA0 + i);
+		expected[40 + i] = extra[i];
+	}
+
+	putHeader(DELTA_PATCH_MIN_WINDOW_BITS, SOURCE_SIZE, sizeof(expected));
+	putCommand(100, 40, 20);
+	putSequence(diff, sizeof(diff), 0, 0);
+	putSequence(extra, sizeof(extra), 0, 0);
+	/* Back from 140 to 20, the diff bytes are all zero, one literal and a match */
+	putCommand(-120, 40, 0);
+	putSequence((const uint8_t *) "\0", 1, 39, 1);
+
+	CHECK_EQUAL_C_INT(SUCCESS, applyInChunks(PATCH_MAX_SIZE));
+	CHECK_EQUAL_C_INT(sizeof(expected), targetWritten);
+	CHECK_EQUAL_C_INT(0, memcmp(expected, target, sizeof(expected)));
+
+	IOT_DEBUG("-->Success - Diff and extra bytes rebuild the target \n");
+}
+
+TEST_C(DeltaPatchTest, MatchesCopyFromWindow) {
+	uint8_t expected[TARGET_MAX_SIZE];
+	uint8_t pattern[5] = {1, 2, 3, 4, 5};
+	size_t length = 0;
+	size_t i;
+
+	IOT_DEBUG("\n-->Running Delta Patch Tests - Matches copy from the window \n");
+
+	/* One command of extra bytes: a repeated pattern, an overlapping match, then a copy of bytes from a window
+	 * back, which wraps around the 256 byte window */
+	putHeader(DELTA_PATCH_MIN_WINDOW_BITS, SOURCE_SIZE, 1500);
+	putCommand(0, 0, 1500);
+	putSequence(pattern, sizeof(pattern), 595, 5);
+	for(i = 0; i < 600; i++) {
+		expected[length++] = pattern[i % 5];
+	}
+	for(i = 0; i < 300; i++) {
+		expected[length] = (uint8_t) (i * 13);
+		length++;
+	}
+	putSequence(expected + 600, 300, 600, 256);
+	for(i = 0; i < 600; i++) {
+		expected[length] = expected[length - 256];
+		length++;
+	}
+
+	CHECK_EQUAL_C_INT(SUCCESS, applyInChunks(PATCH_MAX_SIZE));
+	CHECK_EQUAL_C_INT(1500, targetWritten);
+	CHECK_EQUAL_C_INT(0, memcmp(expected, target, 1500));
+	/* Written in buffer sized ranges */
+	CHECK_EQUAL_C_INT((1500 + DELTA_PATCH_TARGET_BUFFER_SIZE - 1) / DELTA_PATCH_TARGET_BUFFER_SIZE, writeCount);
+
+	IOT_DEBUG("-->Success - Matches copy from the window \n");
+}
+
+TEST_C(DeltaPatchTest, AnyChunkSizeGivesSameTarget) {
+	uint8_t commands[800];
+	uint8_t expected[800];
+	uint8_t literals[300];
+	size_t chunkSize;
+	size_t i;
+
+	IOT_DEBUG("\n-->Running Delta Patch Tests - Any chunk size gives the same target \n");
+
+	/* Long literal runs and match lengths need extension bytes */
+	for(i = 0; i < sizeof(literals); i++) {
+		literals[i] = (uint8_t) (i * 5 + 3);
+	}
+	putHeader(DELTA_PATCH_MIN_WINDOW_BITS, SOURCE_SIZE, 800);
+	putCommand(200, 300, 500);
+	putSequence(literals, 200, 100, 200);
+	putSequence(literals, 0, 300, 256);
+	putSequence(literals + 100, 200, 0, 0);
+
+	/* The decompressed diff and extra bytes */
+	for(i = 0; i < 300; i++) {
+		commands[i] = literals[i % 200];
+	}
+	for(i = 0; i < 300; i++) {
+		commands[300 + i] = commands[44 + i];
+	}
+	memcpy(commands + 600, literals + 100, 200);
+	for(i = 0; i < 300; i++) {
+		expected[i] = (uint8_t) (source[200 + i] + commands[i]);
+	}
+	memcpy(expected + 300, commands + 300, 500);
+
+	for(chunkSize = 1; chunkSize < 20; chunkSize += 3) {
+		CHECK_EQUAL_C_INT(SUCCESS, applyInChunks(chunkSize));
+		CHECK_EQUAL_C_INT(800, targetWritten);
+		CHECK_EQUAL_C_INT(0, memcmp(expected, target, 800));
+	}
+	CHECK_EQUAL_C_INT(SUCCESS, applyInChunks(PATCH_MAX_SIZE));
+	CHECK_EQUAL_C_INT(0, memcmp(expected, target, 800));
+
+	IOT_DEBUG("-->Success - Any chunk size gives the same target \n");
+}
+
+TEST_C(DeltaPatchTest, CorruptPatchesRejected) {
+	uint8_t extra[16];
+	size_t length;
+
+	IOT_DEBUG("\n-->Running Delta Patch Tests - Corrupt patches rejected \n");
+
+	memset(extra, 0x5A, sizeof(extra));
+
+	/* A command that moves the source position only */
+	putHeader(DELTA_PATCH_MIN_WINDOW_BITS, SOURCE_SIZE, 16);
+	putCommand(10, 0, 0);
+	CHECK_EQUAL_C_INT(FAILURE, applyInChunks(PATCH_MAX_SIZE));
+
+	/* Diff bytes past the end of the source */
+	putHeader(DELTA_PATCH_MIN_WINDOW_BITS, SOURCE_SIZE, 16);
+	putCommand(SOURCE_SIZE - 8, 16, 0);
+	CHECK_EQUAL_C_INT(FAILURE, applyInChunks(PATCH_MAX_SIZE));
+
+	/* Diff bytes before the start of the source */
+	putHeader(DELTA_PATCH_MIN_WINDOW_BITS, SOURCE_SIZE, 16);
+	putCommand(-1, 16, 0);
+	CHECK_EQUAL_C_INT(FAILURE, applyInChunks(PATCH_MAX_SIZE));
+
+	/* Extra bytes past the end of the target */
+	putHeader(DELTA_PATCH_MIN_WINDOW_BITS, SOURCE_SIZE, 16);
+	putCommand(0, 0, 17);
+	CHECK_EQUAL_C_INT(FAILURE, applyInChunks(PATCH_MAX_SIZE));
+
+	/* A match further back than the bytes decompressed */
+	putHeader(DELTA_PATCH_MIN_WINDOW_BITS, SOURCE_SIZE, 16);
+	putCommand(0, 0, 16);
+	putSequence(extra, 4, 12, 8);
+	CHECK_EQUAL_C_INT(FAILURE, applyInChunks(PATCH_MAX_SIZE));
+
+	/* An empty sequence */
+	putHeader(DELTA_PATCH_MIN_WINDOW_BITS, SOURCE_SIZE, 16);
+	putByte(0);
+	CHECK_EQUAL_C_INT(FAILURE, applyInChunks(PATCH_MAX_SIZE));
+
+	/* Bytes after the end of the target, and the error stays */
+	putHeader(DELTA_PATCH_MIN_WINDOW_BITS, SOURCE_SIZE, 16);
+	putCommand(0, 0, 16);
+	putSequence(extra, 16, 0, 0);
+	length = patchLength;
+	putCommand(0, 0, 1);
+	CHECK_EQUAL_C_INT(FAILURE, applyInChunks(PATCH_MAX_SIZE));
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_delta_patch_feed(&patch, extra, 1));
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_delta_patch_finish(&patch));
+
+	/* Truncated, the target is incomplete */
+	patchLength = length - 1;
+	CHECK_EQUAL_C_INT(FAILURE, applyInChunks(PATCH_MAX_SIZE));
+	patchLength = length;
+	CHECK_EQUAL_C_INT(SUCCESS, applyInChunks(PATCH_MAX_SIZE));
+	CHECK_EQUAL_C_INT(0, memcmp(extra, target, 16));
+
+	IOT_DEBUG("-->Success - Corrupt patches rejected \n");
+}
+
+TEST_C(DeltaPatchTest, LimitsAndCallbackErrors) {
+	uint8_t extra[16];
+
+	IOT_DEBUG("\n-->Running Delta Patch Tests - Size limits and callback errors \n");
+
+	memset(extra, 0x33, sizeof(extra));
+
+	putHeader(DELTA_PATCH_MIN_WINDOW_BITS, SOURCE_SIZE + 1, 16);
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, applyInChunks(PATCH_MAX_SIZE));
+	putHeader(DELTA_PATCH_MIN_WINDOW_BITS, SOURCE_SIZE, TARGET_MAX_SIZE + 1);
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, applyInChunks(PATCH_MAX_SIZE));
+	putHeader(DELTA_PATCH_MAX_WINDOW_BITS + 1, SOURCE_SIZE, 16);
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, applyInChunks(PATCH_MAX_SIZE));
+	putHeader(DELTA_PATCH_MIN_WINDOW_BITS, SOURCE_SIZE, 0);
+	CHECK_EQUAL_C_INT(MAX_SIZE_ERROR, applyInChunks(PATCH_MAX_SIZE));
+
+	/* The header alone is not a patch */
+	putHeader(DELTA_PATCH_MIN_WINDOW_BITS, SOURCE_SIZE, 16);
+	CHECK_EQUAL_C_INT(FAILURE, applyInChunks(PATCH_MAX_SIZE));
+
+	putCommand(0, 0, 16);
+	putSequence(extra, 16, 0, 0);
+	writeResult = NETWORK_SSL_WRITE_ERROR;
+	CHECK_EQUAL_C_INT(NETWORK_SSL_WRITE_ERROR, applyInChunks(PATCH_MAX_SIZE));
+	CHECK_EQUAL_C_INT(NETWORK_SSL_WRITE_ERROR, aws_iot_delta_patch_finish(&patch));
+	writeResult = SUCCESS;
+
+	/* The source read fails */
+	params.maxSourceSize = SOURCE_SIZE + 64;
+	putHeader(DELTA_PATCH_MIN_WINDOW_BITS, SOURCE_SIZE + 64, 16);
+	putCommand(SOURCE_SIZE, 16, 0);
+	putSequence(extra, 16, 0, 0);
+	CHECK_EQUAL_C_INT(FAILURE, applyInChunks(PATCH_MAX_SIZE));
+	CHECK_EQUAL_C_INT(0, targetWritten);
+
+	IOT_DEBUG("-->Success - Size limits and callback errors \n");
+}
@@ -209,6 +209,27 @@ void setTLSRxBufferForDoubleSuback(char *topicName, size_t topicNameLen, QoS qos
 	RxIndex = 0;
 }
 
+void setTLSRxBufferForMultiSuback(const uint32_t *pQoSCountList, uint32_t subackCount, QoS qos) {
+	uint32_t itr, qosItr;
+	size_t len = 0;
+
+	RxBuffer.NoMsgFlag = false;
+	for(itr = 0; itr < subackCount; itr++) {
+		RxBuffer.pBuffer[len++] = (unsigned char) (0x90);
+		RxBuffer.pBuffer[len++] = (unsigned char) (0x2 + pQoSCountList[itr]);
+		// Variable header - packet identifier
+		RxBuffer.pBuffer[len++] = (unsigned char) (2);
+		RxBuffer.pBuffer[len++] = (unsigned char) (0);
+		// payload, one return code per topic filter
+		for(qosItr = 0; qosItr < pQoSCountList[itr]; qosItr++) {
+			RxBuffer.pBuffer[len++] = (unsigned char) (qos);
+		}
+	}
+
+	RxBuffer.len = len;
+	RxIndex = 0;
+}
+
 void setTLSRxBufferForSuback(char *topicName, size_t topicNameLen, QoS qos, IoT_Publish_Message_Params params) {
 	IOT_UNUSED(topicName);
 	IOT_UNUSED(topicNameLen);
@@ -239,6 +260,40 @@ void setTLSRxBufferForUnsuback(void) {
 	RxIndex = 0;
 }
 
+void setTLSRxBufferForMultiUnsuback(uint32_t unsubackCount) {
+	uint32_t itr;
+	size_t len = 0;
+
+	RxBuffer.NoMsgFlag = false;
+	for(itr = 0; itr < unsubackCount; itr++) {
+		RxBuffer.pBuffer[len++] = (unsigned char) (0xB0);
+		RxBuffer.pBuffer[len++] = (unsigned char) (0x02);
+		// Variable header - packet identifier
+		RxBuffer.pBuffer[len++] = (unsigned char) (2);
+		RxBuffer.pBuffer[len++] = (unsigned char) (0);
+	}
+
+	RxBuffer.len = len;
+	RxIndex = 0;
+}
+
+/* Unsubacks read after the packets already set up */
+void appendTLSRxBufferForUnsuback(uint32_t unsubackCount) {
+	uint32_t itr;
+	size_t len = RxBuffer.len;
+
+	RxBuffer.NoMsgFlag = false;
+	for(itr = 0; itr < unsubackCount; itr++) {
+		RxBuffer.pBuffer[len++] = (unsigned char) (0xB0);
+		RxBuffer.pBuffer[len++] = (unsigned char) (0x02);
+		// Variable header - packet identifier
+		RxBuffer.pBuffer[len++] = (unsigned char) (2);
+		RxBuffer.pBuffer[len++] = (unsigned char) (0);
+	}
+
+	RxBuffer.len = len;
+}
+
 void setTLSRxBufferForPingresp(void) {
 	RxBuffer.NoMsgFlag = false;
 	RxBuffer.pBuffer[0] = (unsigned char) (0xD0);
@@ -265,6 +320,7 @@ void ResetTLSBuffer(void) {
 	}
 
 	RxIndex = 0;
+	mockWakeupPending = false;
 	RxBuffer.expiry_time.tv_sec = 0;
 	RxBuffer.expiry_time.tv_usec = 0;
 	TxBuffer.len = 0;
@@ -0,0 +1,511 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_jobs_executor_helper.c
+ * @brief IoT Client Unit Testing - Jobs Executor Tests Helper
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_jobs_executor.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_log.h"
+
+#define JOBS_THING "JobsThing"
+#define JOBS_TOPIC_PREFIX "$aws/things/" JOBS_THING "/jobs/"
+#define START_NEXT_TOPIC JOBS_TOPIC_PREFIX "start-next"
+#define START_NEXT_ACCEPTED_TOPIC JOBS_TOPIC_PREFIX "start-next/accepted"
+#define NOTIFY_NEXT_TOPIC JOBS_TOPIC_PREFIX "notify-next"
+#define JOB_ID "job1"
+#define UPDATE_TOPIC JOBS_TOPIC_PREFIX JOB_ID "/update"
+
+static AWS_IoT_Client client;
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static IoT_Publish_Message_Params msgParams;
+static JobsExecutor_t executor;
+static char payload[TLSMaxBufferSize / 2];
+
+static JobsStep_t *dispatched[JOBS_EXECUTOR_MAX_STEPS];
+static uint8_t dispatchCount;
+static char paramLog[256];
+static char runLog[64];
+static uint8_t cancelCount;
+
+static IoT_Error_t dispatchStub(JobsStep_t *pStep, void *pContext) {
+	IOT_UNUSED(pContext);
+
+	dispatched[dispatchCount++] = pStep;
+	return SUCCESS;
+}
+
+static char eventCode(JsonStreamEventType_t type) {
+	switch(type) {
+		case JSON_STREAM_OBJECT_START:
+			return 'O';
+		case JSON_STREAM_OBJECT_END:
+			return 'o';
+		case JSON_STREAM_ARRAY_START:
+			return 'A';
+		case JSON_STREAM_ARRAY_END:
+			return 'a';
+		case JSON_STREAM_STRING:
+			return 'S';
+		case JSON_STREAM_NUMBER:
+			return 'N';
+		default:
+			return 'L';
+	}
+}
+
+/* "set" reads a number and runs inline */
+static IoT_Error_t setParam(JobsStep_t *pStep, const JsonStreamEvent_t *pEvent, const char *pParamPath) {
+	if(JSON_STREAM_NUMBER == pEvent->type && 0 == strcmp("value", pParamPath)) {
+		pStep->data.bytes[0] = (uint8_t) (pEvent->pValue[0] - '0');
+	}
+	return SUCCESS;
+}
+
+static JobsStepState_t setRun(JobsStep_t *pStep) {
+	size_t length = strlen(runLog);
+
+	snprintf(runLog + length, sizeof(runLog) - length, "set%u;", pStep->data.bytes[0]);
+	return JOBS_STEP_SUCCEEDED;
+}
+
+/* "copy" logs every parameter, rejects one named "bad" and runs in the worker */
+static IoT_Error_t copyParam(JobsStep_t *pStep, const JsonStreamEvent_t *pEvent, const char *pParamPath) {
+	size_t length = strlen(paramLog);
+
+	if(JSON_STREAM_STRING == pEvent->type && 0 == strcmp("url", pParamPath)
+	   && pEvent->valueLength < sizeof(pStep->data.bytes)) {
+		memcpy(pStep->data.bytes, pEvent->pValue, pEvent->valueLength);
+	}
+	snprintf(paramLog + length, sizeof(paramLog) - length, "%s:%c;", pParamPath, eventCode(pEvent->type));
+	return 0 == strcmp("bad", pParamPath) ? JSON_PARSE_ERROR : SUCCESS;
+}
+
+static JobsStepState_t copyRun(JobsStep_t *pStep) {
+	size_t length = strlen(runLog);
+
+	IOT_UNUSED(pStep);
+
+	snprintf(runLog + length, sizeof(runLog) - length, "copy;");
+	return JOBS_STEP_SUCCEEDED;
+}
+
+/* "wait" runs until completed by the test */
+static JobsStepState_t waitRun(JobsStep_t *pStep) {
+	size_t length = strlen(runLog);
+
+	IOT_UNUSED(pStep);
+
+	snprintf(runLog + length, sizeof(runLog) - length, "wait;");
+	return JOBS_STEP_RUNNING;
+}
+
+static void cancelStep(JobsStep_t *pStep) {
+	IOT_UNUSED(pStep);
+
+	cancelCount++;
+}
+
+static const JobsStepHandler_t setHandler = {"set", false, setParam, setRun, NULL, NULL};
+static const JobsStepHandler_t copyHandler = {"copy", true, copyParam, copyRun, cancelStep, NULL};
+static const JobsStepHandler_t waitHandler = {"wait", false, NULL, waitRun, cancelStep, NULL};
+
+static void clearLastPublish(void) {
+	lastPublishMessageTopicLen = 0;
+	LastPublishMessageTopic[0] = '\0';
+	LastPublishMessagePayload[0] = '\0';
+}
+
+static bool isLastPublish(const char *pTopic, const char *pPayloadPart) {
+	return strlen(pTopic) == lastPublishMessageTopicLen
+		   && 0 == strncmp(pTopic, LastPublishMessageTopic, lastPublishMessageTopicLen)
+		   && NULL != strstr(LastPublishMessagePayload, pPayloadPart);
+}
+
+static void yieldExecutor(void) {
+	ResetTLSBuffer();
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_jobs_executor_yield(&executor, 50));
+}
+
+static void deliver(const char *pTopic) {
+	ResetTLSBuffer();
+	clearLastPublish();
+	msgParams.qos = QOS0;
+	msgParams.payload = payload;
+	msgParams.payloadLen = strlen(payload);
+	setTLSRxBufferWithMsgOnSubscribedTopic((char *) pTopic, strlen(pTopic), QOS0, msgParams, payload);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_jobs_executor_yield(&executor, 50));
+}
+
+static void deliverJob(const char *pDocument) {
+	snprintf(payload, sizeof(payload),
+			 "{\"clientToken\":\"%s\",\"timestamp\":1,\"execution\":{\"jobId\":\"" JOB_ID "\",\"status\":\"QUEUED\","
+			 "\"versionNumber\":1,\"executionNumber\":7,\"jobDocument\":%s}}", executor.requestToken, pDocument);
+	deliver(START_NEXT_ACCEPTED_TOPIC);
+}
+
+static void respondToUpdate(bool isAccepted) {
+	snprintf(payload, sizeof(payload), "{\"clientToken\":\"%s\",\"timestamp\":2}", executor.requestToken);
+	deliver(isAccepted ? UPDATE_TOPIC "/accepted" : UPDATE_TOPIC "/rejected");
+}
+
+static void rejectUpdate(const char *pCode) {
+	snprintf(payload, sizeof(payload), "{\"code\":\"%s\",\"message\":\"rejected\",\"clientToken\":\"%s\",\"timestamp\":2}",
+			 pCode, executor.requestToken);
+	deliver(UPDATE_TOPIC "/rejected");
+}
+
+static void startExecutor(uint32_t progressIntervalMs) {
+	JobsExecutorParams_t params = jobsExecutorParamsDefault;
+	uint32_t subackQoSCount = 3;
+
+	params.pThingName = JOBS_THING;
+	params.dispatch = dispatchStub;
+	params.progressIntervalMs = progressIntervalMs;
+	params.responseTimeoutMs = 60000;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_jobs_executor_init(&executor, &client, &params));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_jobs_executor_register_handler(&executor, &setHandler));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_jobs_executor_register_handler(&executor, &copyHandler));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_jobs_executor_register_handler(&executor, &waitHandler));
+
+	ResetTLSBuffer();
+	setTLSRxBufferForMultiSuback(&subackQoSCount, 1, QOS0);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_jobs_executor_start(&executor));
+
+	clearLastPublish();
+	yieldExecutor();
+	CHECK_EQUAL_C_INT(JOBS_EXECUTOR_STARTING, executor.state);
+	CHECK_EQUAL_C_INT(true, isLastPublish(START_NEXT_TOPIC, executor.requestToken));
+}
+
+TEST_GROUP_C_SETUP(JobsExecutorTest) {
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	initParams.mqttCommandTimeout_ms = 2000;
+	rc = aws_iot_mqtt_init(&client, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&client, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	dispatchCount = 0;
+	paramLog[0] = '\0';
+	runLog[0] = '\0';
+	cancelCount = 0;
+	ResetTLSBuffer();
+}
+
+TEST_GROUP_C_TEARDOWN(JobsExecutorTest) {
+
+}
+
+TEST_C(JobsExecutorTest, RegisterHandlerChecks) {
+	JobsExecutorParams_t params = jobsExecutorParamsDefault;
+	JobsStepHandler_t handlers[JOBS_EXECUTOR_MAX_HANDLERS];
+	char names[JOBS_EXECUTOR_MAX_HANDLERS][8];
+	JobsStepHandler_t noRun = {"norun", false, NULL, NULL, NULL, NULL};
+	char longName[MAX_SIZE_OF_THING_NAME + 1];
+	uint8_t i;
+
+	IOT_DEBUG("\n-->Running Jobs Executor Tests - Init and handler registration checks \n");
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_jobs_executor_init(&executor, &client, &params));
+	memset(longName, 'x', sizeof(longName) - 1);
+	longName[sizeof(longName) - 1] = '\0';
+	params.pThingName = longName;
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_jobs_executor_init(&executor, &client, &params));
+	params.pThingName = JOBS_THING;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_jobs_executor_init(&executor, &client, &params));
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_jobs_executor_register_handler(&executor, &noRun));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_jobs_executor_register_handler(&executor, &setHandler));
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_jobs_executor_register_handler(&executor, &setHandler));
+
+	for(i = 1; i < JOBS_EXECUTOR_MAX_HANDLERS; i++) {
+		snprintf(names[i], sizeof(names[i]), "h%u", i);
+		handlers[i] = copyHandler;
+		handlers[i].pName = names[i];
+		CHECK_EQUAL_C_INT(SUCCESS, aws_iot_jobs_executor_register_handler(&executor, &handlers[i]));
+	}
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_jobs_executor_register_handler(&executor, &waitHandler));
+}
+
+TEST_C(JobsExecutorTest, StartPullsNextJob) {
+	IOT_DEBUG("\n-->Running Jobs Executor Tests - Start subscribes and sends start-next \n");
+
+	startExecutor(60000);
+	CHECK_EQUAL_C_STRING(JOBS_THING "-1", executor.requestToken);
+	CHECK_EQUAL_C_INT(true, isLastPublish(START_NEXT_TOPIC, "{\"clientToken\":\"" JOBS_THING "-1\"}"));
+
+	/* No second request while the first one waits for its response */
+	clearLastPublish();
+	yieldExecutor();
+	CHECK_EQUAL_C_INT(0, lastPublishMessageTopicLen);
+}
+
+TEST_C(JobsExecutorTest, NoPendingJobWaitsForNotifyNext) {
+	IOT_DEBUG("\n-->Running Jobs Executor Tests - Idle until notify-next reports a job \n");
+
+	startExecutor(60000);
+
+	/* A response to another request is ignored */
+	snprintf(payload, sizeof(payload), "{\"clientToken\":\"other\",\"timestamp\":1}");
+	deliver(START_NEXT_ACCEPTED_TOPIC);
+	CHECK_EQUAL_C_INT(JOBS_EXECUTOR_STARTING, executor.state);
+
+	snprintf(payload, sizeof(payload), "{\"clientToken\":\"%s\",\"timestamp\":1}", executor.requestToken);
+	deliver(START_NEXT_ACCEPTED_TOPIC);
+	CHECK_EQUAL_C_INT(JOBS_EXECUTOR_IDLE, executor.state);
+	yieldExecutor();
+	CHECK_EQUAL_C_INT(0, lastPublishMessageTopicLen);
+
+	/* Sent when the last job ends, without a next one */
+	snprintf(payload, sizeof(payload), "{\"timestamp\":2}");
+	deliver(NOTIFY_NEXT_TOPIC);
+	CHECK_EQUAL_C_INT(JOBS_EXECUTOR_IDLE, executor.state);
+
+	snprintf(payload, sizeof(payload), "{\"timestamp\":3,\"execution\":{\"jobId\":\"job2\",\"status\":\"QUEUED\"}}");
+	deliver(NOTIFY_NEXT_TOPIC);
+	CHECK_EQUAL_C_INT(JOBS_EXECUTOR_STARTING, executor.state);
+	CHECK_EQUAL_C_INT(true, isLastPublish(START_NEXT_TOPIC, JOBS_THING "-2"));
+}
+
+TEST_C(JobsExecutorTest, ParametersStreamedToHandler) {
+	IOT_DEBUG("\n-->Running Jobs Executor Tests - Step parameters streamed to the handler \n");
+
+	startExecutor(60000);
+	deliverJob("{\"steps\":[{\"copy\":{\"url\":\"http://x/a\",\"files\":[\"a\",\"b\"],\"opts\":{\"mode\":3}},"
+			   "\"timeoutSec\":30}]}");
+
+	CHECK_EQUAL_C_STRING(":O;url:S;files:A;files.0:S;files.1:S;files:a;opts:O;opts.mode:N;opts:o;:o;", paramLog);
+	CHECK_EQUAL_C_INT(JOBS_EXECUTOR_RUNNING, executor.state);
+	CHECK_EQUAL_C_STRING(JOB_ID, executor.jobId);
+	CHECK_EQUAL_C_INT(7, executor.executionNumber);
+	CHECK_EQUAL_C_INT(1, executor.stepCount);
+	CHECK_EQUAL_C_INT(30000, executor.steps[0].timeoutMs);
+	CHECK_EQUAL_C_STRING("http://x/a", (const char *) executor.steps[0].data.bytes);
+
+	/* Handed to the worker, not run in the yielding task */
+	CHECK_EQUAL_C_INT(1, dispatchCount);
+	CHECK_EQUAL_C_INT(JOBS_STEP_QUEUED, executor.steps[0].state);
+	CHECK_EQUAL_C_STRING("", runLog);
+
+	aws_iot_jobs_executor_run_step(dispatched[0]);
+	CHECK_EQUAL_C_STRING("copy;", runLog);
+	CHECK_EQUAL_C_INT(false, executor.steps[0].isInWorker);
+
+	clearLastPublish();
+	yieldExecutor();
+	CHECK_EQUAL_C_INT(JOBS_EXECUTOR_FINISHING, executor.state);
+	CHECK_EQUAL_C_INT(true, isLastPublish(UPDATE_TOPIC, "\"status\":\"SUCCEEDED\""));
+	CHECK_EQUAL_C_INT(true, isLastPublish(UPDATE_TOPIC, "\"executionNumber\":7"));
+}
+
+TEST_C(JobsExecutorTest, GroupsRunInOrderAndInParallel) {
+	JobsStep_t *pWait;
+
+	IOT_DEBUG("\n-->Running Jobs Executor Tests - Groups run in order, their steps in parallel \n");
+
+	startExecutor(60000);
+	deliverJob("{\"steps\":[{\"set\":{\"value\":5}},[{\"wait\":{}},{\"copy\":{}}],{\"set\":{\"value\":6}}]}");
+
+	CHECK_EQUAL_C_INT(4, executor.stepCount);
+	CHECK_EQUAL_C_INT(3, executor.groupCount);
+	CHECK_EQUAL_C_INT(1, executor.currentGroup);
+	CHECK_EQUAL_C_STRING("set5;wait;", runLog);
+	CHECK_EQUAL_C_INT(1, dispatchCount);
+	pWait = &executor.steps[1];
+	CHECK_EQUAL_C_INT(JOBS_STEP_RUNNING, pWait->state);
+
+	/* The group waits for both of its steps */
+	aws_iot_jobs_executor_run_step(dispatched[0]);
+	yieldExecutor();
+	CHECK_EQUAL_C_INT(1, executor.currentGroup);
+	CHECK_EQUAL_C_STRING("set5;wait;copy;", runLog);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_jobs_executor_step_complete(pWait, true));
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_jobs_executor_step_complete(pWait, true));
+
+	clearLastPublish();
+	yieldExecutor();
+	CHECK_EQUAL_C_STRING("set5;wait;copy;set6;", runLog);
+	CHECK_EQUAL_C_INT(JOBS_EXECUTOR_FINISHING, executor.state);
+	CHECK_EQUAL_C_INT(true, isLastPublish(UPDATE_TOPIC, "\"statusDetails\":{\"steps\":\"4\"}"));
+	CHECK_EQUAL_C_INT(0, cancelCount);
+
+	/* Accepted outcome, then the next job is pulled */
+	respondToUpdate(true);
+	CHECK_EQUAL_C_INT(JOBS_EXECUTOR_IDLE, executor.state);
+	CHECK_EQUAL_C_INT(1, executor.completedJobs);
+	yieldExecutor();
+	CHECK_EQUAL_C_INT(JOBS_EXECUTOR_STARTING, executor.state);
+	CHECK_EQUAL_C_INT(true, isLastPublish(START_NEXT_TOPIC, executor.requestToken));
+}
+
+TEST_C(JobsExecutorTest, InvalidDocumentFailsJob) {
+	static const char *const documents[][2] = {
+		{"{\"steps\":[{\"format\":{}}]}", "unknown handler"},
+		{"{\"steps\":[{\"set\":{},\"copy\":{}}]}", "more than one handler in a step"},
+		{"{\"steps\":[{\"timeoutSec\":5}]}", "step without handler"},
+		{"{\"steps\":[{\"set\":{},\"timeoutSec\":\"5\"}]}", "invalid timeout"},
+		{"{\"steps\":[[]]}", "empty group"},
+		{"{\"steps\":[[[{\"set\":{}}]]]}", "step is not an object"},
+		{"{\"steps\":{\"set\":{}}}", "steps is not an array"},
+		{"{\"steps\":[{\"copy\":{\"bad\":1}}]}", "invalid parameters"},
+		{"{\"steps\":[]}", "no steps"},
+		{"{\"other\":1}", "no steps"},
+		{"{\"steps\":[{\"set\":{}},]}", "invalid document"}
+	};
+	char reason[64];
+	size_t i;
+
+	IOT_DEBUG("\n-->Running Jobs Executor Tests - Invalid job documents fail the job \n");
+
+	startExecutor(60000);
+	for(i = 0; i < sizeof(documents) / sizeof(documents[0]); i++) {
+		deliverJob(documents[i][0]);
+		snprintf(reason, sizeof(reason), "\"reason\":\"%s\"", documents[i][1]);
+		CHECK_EQUAL_C_INT(JOBS_EXECUTOR_FINISHING, executor.state);
+		CHECK_EQUAL_C_INT(true, isLastPublish(UPDATE_TOPIC, "\"status\":\"FAILED\""));
+		CHECK_EQUAL_C_INT(true, isLastPublish(UPDATE_TOPIC, reason));
+
+		respondToUpdate(false);
+		CHECK_EQUAL_C_INT(JOBS_EXECUTOR_IDLE, executor.state);
+		yieldExecutor();
+		CHECK_EQUAL_C_INT(JOBS_EXECUTOR_STARTING, executor.state);
+	}
+	CHECK_EQUAL_C_INT(sizeof(documents) / sizeof(documents[0]), executor.failedJobs);
+	CHECK_EQUAL_C_STRING("", runLog);
+}
+
+TEST_C(JobsExecutorTest, StepTimeoutFailsJob) {
+	IOT_DEBUG("\n-->Running Jobs Executor Tests - A step timing out fails the job \n");
+
+	startExecutor(60000);
+	deliverJob("{\"steps\":[{\"set\":{\"value\":1}},{\"wait\":{},\"timeoutSec\":1}]}");
+	CHECK_EQUAL_C_INT(JOBS_STEP_RUNNING, executor.steps[1].state);
+
+	yieldExecutor();
+	CHECK_EQUAL_C_INT(JOBS_EXECUTOR_RUNNING, executor.state);
+
+	usleep(1100000);
+	clearLastPublish();
+	yieldExecutor();
+	CHECK_EQUAL_C_INT(1, cancelCount);
+	CHECK_EQUAL_C_INT(true, executor.steps[1].isTimedOut);
+	CHECK_EQUAL_C_INT(true, isLastPublish(UPDATE_TOPIC, "{\"failedStep\":\"1\",\"reason\":\"timeout\"}"));
+
+	/* Completing it late changes nothing */
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_jobs_executor_step_complete(&executor.steps[1], true));
+	CHECK_EQUAL_C_INT(JOBS_STEP_FAILED, executor.steps[1].state);
+}
+
+TEST_C(JobsExecutorTest, ProgressUpdatesBatched) {
+	JobsStep_t *pWait;
+
+	IOT_DEBUG("\n-->Running Jobs Executor Tests - Progress sent at most once per interval \n");
+
+	startExecutor(300);
+	deliverJob("{\"steps\":[{\"wait\":{}},{\"set\":{\"value\":1}}]}");
+	pWait = &executor.steps[0];
+
+	aws_iot_jobs_executor_step_progress(pWait, 10);
+	aws_iot_jobs_executor_step_progress(pWait, 30);
+	yieldExecutor();
+	CHECK_EQUAL_C_INT(0, lastPublishMessageTopicLen);
+
+	usleep(350000);
+	yieldExecutor();
+	CHECK_EQUAL_C_INT(true, isLastPublish(UPDATE_TOPIC, "\"status\":\"IN_PROGRESS\""));
+	CHECK_EQUAL_C_INT(true, isLastPublish(UPDATE_TOPIC, "{\"group\":\"1/2\",\"progress\":\"15\"}"));
+	respondToUpdate(true);
+	CHECK_EQUAL_C_INT(JOBS_EXECUTOR_RUNNING, executor.state);
+
+	aws_iot_jobs_executor_step_progress(pWait, 50);
+	aws_iot_jobs_executor_step_progress(pWait, 80);
+	clearLastPublish();
+	yieldExecutor();
+	CHECK_EQUAL_C_INT(0, lastPublishMessageTopicLen);
+
+	usleep(350000);
+	yieldExecutor();
+	CHECK_EQUAL_C_INT(true, isLastPublish(UPDATE_TOPIC, "{\"group\":\"1/2\",\"progress\":\"40\"}"));
+
+	/* Nothing new, nothing sent */
+	respondToUpdate(true);
+	usleep(350000);
+	clearLastPublish();
+	yieldExecutor();
+	CHECK_EQUAL_C_INT(0, lastPublishMessageTopicLen);
+}
+
+TEST_C(JobsExecutorTest, RejectedProgressCancelsJob) {
+	IOT_DEBUG("\n-->Running Jobs Executor Tests - Job ended by the service is canceled \n");
+
+	startExecutor(0);
+	deliverJob("{\"steps\":[{\"copy\":{}}]}");
+	CHECK_EQUAL_C_INT(1, dispatchCount);
+	CHECK_EQUAL_C_INT(true, isLastPublish(UPDATE_TOPIC, "\"status\":\"IN_PROGRESS\""));
+
+	rejectUpdate("TerminalStateReached");
+	CHECK_EQUAL_C_INT(JOBS_EXECUTOR_CANCELING, executor.state);
+	CHECK_EQUAL_C_INT(1, cancelCount);
+	CHECK_EQUAL_C_INT(1, executor.failedJobs);
+
+	/* The next job waits until the worker gave the step back */
+	clearLastPublish();
+	yieldExecutor();
+	CHECK_EQUAL_C_INT(JOBS_EXECUTOR_CANCELING, executor.state);
+	CHECK_EQUAL_C_INT(0, lastPublishMessageTopicLen);
+
+	aws_iot_jobs_executor_run_step(dispatched[0]);
+	CHECK_EQUAL_C_STRING("", runLog);
+	yieldExecutor();
+	yieldExecutor();
+	CHECK_EQUAL_C_INT(JOBS_EXECUTOR_STARTING, executor.state);
+	CHECK_EQUAL_C_INT(true, isLastPublish(START_NEXT_TOPIC, executor.requestToken));
+}
+
+TEST_C(JobsExecutorTest, TransientRejectionKeepsJob) {
+	IOT_DEBUG("\n-->Running Jobs Executor Tests - Throttled progress update keeps the job running \n");
+
+	startExecutor(0);
+	deliverJob("{\"steps\":[{\"copy\":{}}]}");
+	CHECK_EQUAL_C_INT(1, dispatchCount);
+	CHECK_EQUAL_C_INT(true, isLastPublish(UPDATE_TOPIC, "\"status\":\"IN_PROGRESS\""));
+
+	rejectUpdate("RequestThrottled");
+	CHECK_EQUAL_C_INT(JOBS_EXECUTOR_RUNNING, executor.state);
+	CHECK_EQUAL_C_INT(0, cancelCount);
+	CHECK_EQUAL_C_INT(0, executor.failedJobs);
+	/* The progress was sent again by the same yield */
+	CHECK_EQUAL_C_INT(true, isLastPublish(UPDATE_TOPIC, "\"status\":\"IN_PROGRESS\""));
+
+	aws_iot_jobs_executor_run_step(dispatched[0]);
+	CHECK_EQUAL_C_STRING("copy;", runLog);
+}
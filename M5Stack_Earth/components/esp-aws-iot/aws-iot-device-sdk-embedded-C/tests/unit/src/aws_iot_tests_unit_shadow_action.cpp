@@ -43,6 +43,11 @@ TEST_GROUP_C_WRAPPER(ShadowActionTests, PublishFailsGetRequest)
 TEST_GROUP_C_WRAPPER(ShadowActionTests, GetVersionFromAckStatus)
 TEST_GROUP_C_WRAPPER(ShadowActionTests, StickyNonStickyNeverConflict)
 TEST_GROUP_C_WRAPPER(ShadowActionTests, ACKWaitingMoreThanAllowed)
+TEST_GROUP_C_WRAPPER(ShadowActionTests, ManyAcksAnsweredOutOfOrder)
+TEST_GROUP_C_WRAPPER(ShadowActionTests, OnlyDueAcksTimeOut)
+TEST_GROUP_C_WRAPPER(ShadowActionTests, AcksTimeOutAfterGapLongerThanWheelClock)
+TEST_GROUP_C_WRAPPER(ShadowActionTests, AcksTimeOutAfterSeveralWheelTurns)
+TEST_GROUP_C_WRAPPER(ShadowActionTests, TimeoutCallbackSendsNewRequest)
 TEST_GROUP_C_WRAPPER(ShadowActionTests, InboundDataTooBigForBuffer)
 TEST_GROUP_C_WRAPPER(ShadowActionTests, NoClientTokenForShadowAction)
 TEST_GROUP_C_WRAPPER(ShadowActionTests, NoCallbackForShadowAction)
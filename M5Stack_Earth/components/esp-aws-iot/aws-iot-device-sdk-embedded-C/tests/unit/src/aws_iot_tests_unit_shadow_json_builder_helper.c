@@ -18,11 +18,13 @@
  * @brief IoT Client Unit Testing - Shadow JSON Builder Tests Helper
  */
 
+#include <stdio.h>
 #include <string.h>
 #include <CppUTest/TestHarness_c.h>
 #include <aws_iot_shadow_interface.h>
 
 #include "aws_iot_shadow_actions.h"
+#include "aws_iot_shadow_json.h"
 #include "aws_iot_log.h"
 #include "aws_iot_tests_unit_helper_functions.h"
 
@@ -129,3 +131,99 @@ TEST_C(ShadowJsonBuilderTests, SmallBuffer) {
 	ret_val = aws_iot_finalize_json_document(updateRequestJson, jsonBufSize);
 	CHECK_EQUAL_C_INT(SHADOW_JSON_ERROR, ret_val);
 }
+
+#define SIZE_OF_MIXED_BUF 400
+
+TEST_C(ShadowJsonBuilderTests, BuilderMatchesDocumentApi) {
+	IoT_Error_t ret_val;
+	char documentApiJson[SIZE_OF_MIXED_BUF];
+	char builderJson[SIZE_OF_MIXED_BUF];
+	char expectedJson[SIZE_OF_MIXED_BUF];
+	ShadowJsonBuilder_t builder;
+	int32_t int32Data = -2147483647 - 1;
+	int16_t int16Data = -300;
+	int8_t int8Data = -7;
+	uint32_t uint32Data = 4294967295u;
+	uint16_t uint16Data = 65535;
+	uint8_t uint8Data = 200;
+	bool boolData = true;
+	char stringData[] = "on";
+	char objectData[] = "{\"r\":1}";
+	jsonStruct_t int32Handler = {"int32", &int32Data, sizeof(int32Data), SHADOW_JSON_INT32, NULL};
+	jsonStruct_t int16Handler = {"int16", &int16Data, sizeof(int16Data), SHADOW_JSON_INT16, NULL};
+	jsonStruct_t int8Handler = {"int8", &int8Data, sizeof(int8Data), SHADOW_JSON_INT8, NULL};
+	jsonStruct_t uint32Handler = {"uint32", &uint32Data, sizeof(uint32Data), SHADOW_JSON_UINT32, NULL};
+	jsonStruct_t uint16Handler = {"uint16", &uint16Data, sizeof(uint16Data), SHADOW_JSON_UINT16, NULL};
+	jsonStruct_t uint8Handler = {"uint8", &uint8Data, sizeof(uint8Data), SHADOW_JSON_UINT8, NULL};
+	jsonStruct_t boolHandler = {"bool", &boolData, sizeof(boolData), SHADOW_JSON_BOOL, NULL};
+	jsonStruct_t stringHandler = {"string", stringData, sizeof(stringData), SHADOW_JSON_STRING, NULL};
+	jsonStruct_t objectHandler = {"object", objectData, sizeof(objectData), SHADOW_JSON_OBJECT, NULL};
+	jsonStruct_t *reportedArray[] = {&int32Handler, &int16Handler, &int8Handler, &uint32Handler, &uint16Handler,
+									 &uint8Handler, &dataDoubleHandler};
+
+	IOT_DEBUG("\n-->Running Shadow Json Builder Tests - Builder matches the document API \n");
+
+	snprintf(expectedJson, SIZE_OF_MIXED_BUF, "{\"state\":{\"desired\":{\"bool\":true,\"string\":\"on\","
+			 "\"object\":{\"r\":1},\"floatData\":%f},\"reported\":{\"int32\":%i,\"int16\":%hi,\"int8\":%hhi,"
+			 "\"uint32\":%u,\"uint16\":%hu,\"uint8\":%hhu,\"doubleData\":%f}}, \"clientToken\":\"%s-0\"}",
+			 floatData, int32Data, int16Data, int8Data, uint32Data, uint16Data, uint8Data, doubleData,
+			 AWS_IOT_MQTT_CLIENT_ID);
+
+	resetClientTokenSequenceNum();
+	ret_val = aws_iot_shadow_init_json_document(documentApiJson, SIZE_OF_MIXED_BUF);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ret_val = aws_iot_shadow_add_desired(documentApiJson, SIZE_OF_MIXED_BUF, 4, &boolHandler, &stringHandler,
+										 &objectHandler, &dataFloatHandler);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ret_val = aws_iot_shadow_add_reported(documentApiJson, SIZE_OF_MIXED_BUF, 7, &int32Handler, &int16Handler,
+										  &int8Handler, &uint32Handler, &uint16Handler, &uint8Handler,
+										  &dataDoubleHandler);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ret_val = aws_iot_finalize_json_document(documentApiJson, SIZE_OF_MIXED_BUF);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_STRING(expectedJson, documentApiJson);
+
+	resetClientTokenSequenceNum();
+	ret_val = aws_iot_shadow_json_builder_init(&builder, builderJson, SIZE_OF_MIXED_BUF);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ret_val = aws_iot_shadow_json_builder_add_desired(&builder, 4, &boolHandler, &stringHandler, &objectHandler,
+													  &dataFloatHandler);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ret_val = aws_iot_shadow_json_builder_add_reported_array(&builder, 7, reportedArray);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	ret_val = aws_iot_shadow_json_builder_finalize(&builder);
+	CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+	CHECK_EQUAL_C_STRING(expectedJson, builderJson);
+	CHECK_EQUAL_C_INT(strlen(builderJson), builder.length);
+}
+
+TEST_C(ShadowJsonBuilderTests, BuilderNumbersMatchPrintf) {
+	IoT_Error_t ret_val;
+	char builderJson[SIZE_OF_MIXED_BUF];
+	char expectedValue[SIZE_OF_MIXED_BUF];
+	ShadowJsonBuilder_t builder;
+	double value;
+	jsonStruct_t valueHandler = {"v", &value, sizeof(value), SHADOW_JSON_DOUBLE, NULL};
+	const double values[] = {0.0, -0.0, 1.0, -1.0, 0.0000005, 0.0000015, -0.0000005, 0.1234565, 2.5e-7, 123456.7890125,
+							 999999999.9999995, 1e9, -1e9, 1e15, 1e300, 4.0908f, 3.445f, 21.55, -40.125};
+	uint32_t seed = 12345u;
+	uint32_t i;
+
+	IOT_DEBUG("\n-->Running Shadow Json Builder Tests - Builder numbers match printf \n");
+
+	for(i = 0; i < sizeof(values) / sizeof(values[0]) + 2000; i++) {
+		if(i < sizeof(values) / sizeof(values[0])) {
+			value = values[i];
+		} else {
+			seed = seed * 1103515245u + 12345u;
+			value = ((double) seed - 2147483648.0) / (double) (1u << (seed % 32));
+		}
+		snprintf(expectedValue, SIZE_OF_MIXED_BUF, "{\"state\":{\"reported\":{\"v\":%f},", value);
+
+		ret_val = aws_iot_shadow_json_builder_init(&builder, builderJson, SIZE_OF_MIXED_BUF);
+		CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+		ret_val = aws_iot_shadow_json_builder_add_reported(&builder, 1, &valueHandler);
+		CHECK_EQUAL_C_INT(SUCCESS, ret_val);
+		CHECK_EQUAL_C_STRING(expectedValue, builderJson);
+	}
+}
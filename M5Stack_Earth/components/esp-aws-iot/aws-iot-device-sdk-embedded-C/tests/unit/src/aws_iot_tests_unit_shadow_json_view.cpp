@@ -0,0 +1,36 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_shadow_json_view.cpp
+ * @brief IoT Client Unit Testing - Shadow JSON View Tests
+ */
+
+#include <CppUTest/CommandLineTestRunner.h>
+#include <CppUTest/TestHarness_c.h>
+
+TEST_GROUP_C(ShadowJsonViewTests){
+	TEST_GROUP_C_SETUP_WRAPPER(ShadowJsonViewTests)
+	TEST_GROUP_C_TEARDOWN_WRAPPER(ShadowJsonViewTests)
+};
+
+TEST_GROUP_C_WRAPPER(ShadowJsonViewTests, TypedValuesByPath)
+TEST_GROUP_C_WRAPPER(ShadowJsonViewTests, RawValueIsZeroCopy)
+TEST_GROUP_C_WRAPPER(ShadowJsonViewTests, ArrayIndexAndSubView)
+TEST_GROUP_C_WRAPPER(ShadowJsonViewTests, MissingKeyAndWrongType)
+TEST_GROUP_C_WRAPPER(ShadowJsonViewTests, ViewOfDeltaValue)
+TEST_GROUP_C_WRAPPER(ShadowJsonViewTests, StaleViewAfterReparse)
+TEST_GROUP_C_WRAPPER(ShadowJsonViewTests, ResponseParsedOnDemand)
+TEST_GROUP_C_WRAPPER(ShadowJsonViewTests, PassingNullValue)
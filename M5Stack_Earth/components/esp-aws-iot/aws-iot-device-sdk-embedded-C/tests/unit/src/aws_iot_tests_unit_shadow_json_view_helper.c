@@ -0,0 +1,278 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_shadow_json_view_helper.c
+ * @brief IoT Client Unit Testing - Shadow JSON View Tests Helper
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <CppUTest/TestHarness_c.h>
+#include <aws_iot_shadow_interface.h>
+
+#include "aws_iot_shadow_json.h"
+#include "aws_iot_log.h"
+
+#define SHADOW_GET_ACCEPTED_DOCUMENT \
+	"{\"state\":{\"desired\":{\"Name\":\"AVAILABLE\",\"brightness\":-12,\"on\":true}," \
+	"\"reported\":{\"Name\":\"OFFLINE\",\"temperature\":21.5,\"list\":[1,{\"a\":[2,3]},\"x\"]}}," \
+	"\"metadata\":{\"desired\":{\"Name\":{\"timestamp\":1600000000}}},\"version\":42,\"timestamp\":1600000001}"
+
+#define SHADOW_DELTA_DOCUMENT "{\"state\":{\"light\":{\"on\":false,\"level\":7}},\"version\":43}"
+
+static char jsonDocument[512];
+
+static void parseDocument(const char *pDocument) {
+	int32_t tokenCount = 0;
+
+	snprintf(jsonDocument, sizeof(jsonDocument), "%s", pDocument);
+	CHECK_C(isJsonValidAndParse(jsonDocument, strlen(jsonDocument), NULL, &tokenCount));
+}
+
+TEST_GROUP_C_SETUP(ShadowJsonViewTests) {
+	parseDocument(SHADOW_GET_ACCEPTED_DOCUMENT);
+}
+
+TEST_GROUP_C_TEARDOWN(ShadowJsonViewTests) { }
+
+TEST_C(ShadowJsonViewTests, TypedValuesByPath) {
+	ShadowJsonView_t view;
+	char name[16];
+	int32_t brightness = 0;
+	uint32_t version = 0;
+	double temperature = 0;
+	bool on = false;
+	uint8_t level = 0;
+	jsonStruct_t levelHandler = {"level", &level, sizeof(level), SHADOW_JSON_UINT8, NULL};
+
+	IOT_DEBUG("-->Running Shadow Json View Tests - Typed values by path \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_init(jsonDocument, &view));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_string(&view, "state.desired.Name", name, sizeof(name)));
+	CHECK_EQUAL_C_STRING("AVAILABLE", name);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_string(&view, "state.reported.Name", name, sizeof(name)));
+	CHECK_EQUAL_C_STRING("OFFLINE", name);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_int32(&view, "state.desired.brightness", &brightness));
+	CHECK_EQUAL_C_INT(-12, brightness);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_uint32(&view, "version", &version));
+	CHECK_EQUAL_C_INT(42, version);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_double(&view, "state.reported.temperature",
+																   &temperature));
+	CHECK_EQUAL_C_REAL(21.5, temperature, 0.0001);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_bool(&view, "state.desired.on", &on));
+	CHECK_EQUAL_C_INT(true, on);
+
+	/* Keys under metadata are only found by their full path */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_uint32(&view, "metadata.desired.Name.timestamp",
+																   &version));
+	CHECK_EQUAL_C_INT(1600000000, version);
+
+	parseDocument("{\"state\":{\"level\":200}}");
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_init(jsonDocument, &view));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_struct(&view, "state.level", &levelHandler));
+	CHECK_EQUAL_C_INT(200, level);
+
+	IOT_DEBUG("-->Success - Typed values by path \n");
+}
+
+TEST_C(ShadowJsonViewTests, RawValueIsZeroCopy) {
+	ShadowJsonView_t view;
+	const char *pValue = NULL;
+	uint32_t valueLength = 0;
+
+	IOT_DEBUG("-->Running Shadow Json View Tests - Raw value is zero copy \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_init(jsonDocument, &view));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_raw(&view, "state.desired.Name", &pValue, &valueLength));
+	CHECK_C(pValue == strstr(jsonDocument, "AVAILABLE"));
+	CHECK_EQUAL_C_INT(9, valueLength);
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_raw(&view, "state.reported.list", &pValue, &valueLength));
+	CHECK_EQUAL_C_INT(0, strncmp("[1,{\"a\":[2,3]},\"x\"]", pValue, valueLength));
+
+	/* The empty path is the whole document */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_raw(&view, "", &pValue, &valueLength));
+	CHECK_C(pValue == jsonDocument);
+	CHECK_EQUAL_C_INT(strlen(jsonDocument), valueLength);
+
+	IOT_DEBUG("-->Success - Raw value is zero copy \n");
+}
+
+TEST_C(ShadowJsonViewTests, ArrayIndexAndSubView) {
+	ShadowJsonView_t view;
+	ShadowJsonView_t reported;
+	char value[4];
+	int32_t number = 0;
+
+	IOT_DEBUG("-->Running Shadow Json View Tests - Array index and sub view \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_init(jsonDocument, &view));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_int32(&view, "state.reported.list.0", &number));
+	CHECK_EQUAL_C_INT(1, number);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_int32(&view, "state.reported.list.1.a.1", &number));
+	CHECK_EQUAL_C_INT(3, number);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_string(&view, "state.reported.list.2", value,
+																   sizeof(value)));
+	CHECK_EQUAL_C_STRING("x", value);
+	CHECK_EQUAL_C_INT(JSON_KEY_NOT_FOUND_ERROR, aws_iot_shadow_json_view_get_int32(&view, "state.reported.list.3",
+																				   &number));
+	CHECK_EQUAL_C_INT(JSON_KEY_NOT_FOUND_ERROR, aws_iot_shadow_json_view_get_int32(&view, "state.reported.list.x",
+																				   &number));
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_view(&view, "state.reported", &reported));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_int32(&reported, "list.1.a.0", &number));
+	CHECK_EQUAL_C_INT(2, number);
+	CHECK_EQUAL_C_INT(JSON_KEY_NOT_FOUND_ERROR, aws_iot_shadow_json_view_get_int32(&reported, "brightness", &number));
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, aws_iot_shadow_json_view_get_view(&reported, "temperature", &view));
+
+	IOT_DEBUG("-->Success - Array index and sub view \n");
+}
+
+TEST_C(ShadowJsonViewTests, MissingKeyAndWrongType) {
+	ShadowJsonView_t view;
+	char name[4];
+	int32_t number = 0;
+	bool on = false;
+
+	IOT_DEBUG("-->Running Shadow Json View Tests - Missing key and wrong type \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_init(jsonDocument, &view));
+	CHECK_EQUAL_C_INT(JSON_KEY_NOT_FOUND_ERROR, aws_iot_shadow_json_view_get_int32(&view, "state.desired.Nam",
+																				   &number));
+	CHECK_EQUAL_C_INT(JSON_KEY_NOT_FOUND_ERROR, aws_iot_shadow_json_view_get_int32(&view, "state.desired.Names",
+																				   &number));
+	CHECK_EQUAL_C_INT(JSON_KEY_NOT_FOUND_ERROR, aws_iot_shadow_json_view_get_int32(&view, "state.desired.Name.x",
+																				   &number));
+	CHECK_EQUAL_C_INT(JSON_KEY_NOT_FOUND_ERROR, aws_iot_shadow_json_view_get_int32(&view, "Name", &number));
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, aws_iot_shadow_json_view_get_int32(&view, "state.desired.Name", &number));
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, aws_iot_shadow_json_view_get_bool(&view, "state.desired.brightness", &on));
+	CHECK_EQUAL_C_INT(SHADOW_JSON_ERROR, aws_iot_shadow_json_view_get_string(&view, "state.desired.Name", name,
+																			 sizeof(name)));
+
+	IOT_DEBUG("-->Success - Missing key and wrong type \n");
+}
+
+TEST_C(ShadowJsonViewTests, ViewOfDeltaValue) {
+	ShadowJsonView_t view;
+	const char *pValue;
+	int32_t level = 0;
+	bool on = true;
+
+	IOT_DEBUG("-->Running Shadow Json View Tests - View of delta value \n");
+
+	/* A delta callback gets a pointer to its value inside the received document */
+	parseDocument(SHADOW_DELTA_DOCUMENT);
+	pValue = strstr(jsonDocument, "{\"on\"");
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_init(pValue, &view));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_bool(&view, "on", &on));
+	CHECK_EQUAL_C_INT(false, on);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_int32(&view, "level", &level));
+	CHECK_EQUAL_C_INT(7, level);
+	CHECK_EQUAL_C_INT(JSON_KEY_NOT_FOUND_ERROR, aws_iot_shadow_json_view_get_int32(&view, "version", &level));
+
+	/* Pointers that are not the start of a value are refused */
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, aws_iot_shadow_json_view_init(pValue + 1, &view));
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, aws_iot_shadow_json_view_init(jsonDocument + strlen(jsonDocument), &view));
+
+	IOT_DEBUG("-->Success - View of delta value \n");
+}
+
+TEST_C(ShadowJsonViewTests, StaleViewAfterReparse) {
+	ShadowJsonView_t view;
+	char otherDocument[64];
+	uint32_t version = 0;
+	int32_t tokenCount = 0;
+
+	IOT_DEBUG("-->Running Shadow Json View Tests - Stale view after reparse \n");
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_init(jsonDocument, &view));
+
+	/* Checking a response or an outgoing document leaves the tokens alone */
+	snprintf(otherDocument, sizeof(otherDocument), "{\"clientToken\":\"abc-1\",\"version\":7}");
+	CHECK_C(isReceivedJsonValid(otherDocument, strlen(otherDocument)));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_uint32(&view, "version", &version));
+	CHECK_EQUAL_C_INT(42, version);
+
+	/* Tokenizing another document makes it stale, and a new view parses this one again */
+	CHECK_C(isJsonValidAndParse(otherDocument, strlen(otherDocument), NULL, &tokenCount));
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, aws_iot_shadow_json_view_get_uint32(&view, "version", &version));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_init(jsonDocument, &view));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_uint32(&view, "version", &version));
+	CHECK_EQUAL_C_INT(42, version);
+
+	/* The buffer is about to be overwritten */
+	invalidateParsedJson(jsonDocument, NULL);
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, aws_iot_shadow_json_view_get_uint32(&view, "version", &version));
+
+	/* Parsing the same buffer again still makes the old view stale */
+	parseDocument(SHADOW_GET_ACCEPTED_DOCUMENT);
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, aws_iot_shadow_json_view_get_uint32(&view, "version", &version));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_init(jsonDocument, &view));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_uint32(&view, "version", &version));
+	CHECK_EQUAL_C_INT(42, version);
+
+	/* A document that failed to parse has no view */
+	snprintf(otherDocument, sizeof(otherDocument), "{\"version\":");
+	CHECK_C(!isReceivedJsonValid(otherDocument, strlen(otherDocument)));
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, aws_iot_shadow_json_view_init(otherDocument, &view));
+
+	IOT_DEBUG("-->Success - Stale view after reparse \n");
+}
+
+TEST_C(ShadowJsonViewTests, ResponseParsedOnDemand) {
+	ShadowJsonView_t view;
+	char response[64];
+	uint32_t version = 0;
+
+	IOT_DEBUG("-->Running Shadow Json View Tests - Response parsed on demand \n");
+
+	/* Ack callbacks get responses that were validated but not tokenized */
+	snprintf(response, sizeof(response), "{\"clientToken\":\"abc-1\",\"version\":7}");
+	CHECK_C(isReceivedJsonValid(response, strlen(response)));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_init(response, &view));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_uint32(&view, "version", &version));
+	CHECK_EQUAL_C_INT(7, version);
+
+	/* The document the view was made from is not parsed again */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_init(response, &view));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_get_uint32(&view, "version", &version));
+
+	snprintf(response, sizeof(response), "\"version\"");
+	invalidateParsedJson(response, NULL);
+	CHECK_EQUAL_C_INT(JSON_PARSE_ERROR, aws_iot_shadow_json_view_init(response, &view));
+
+	IOT_DEBUG("-->Success - Response parsed on demand \n");
+}
+
+TEST_C(ShadowJsonViewTests, PassingNullValue) {
+	ShadowJsonView_t view;
+	const char *pValue;
+	uint32_t valueLength;
+	int32_t number;
+
+	IOT_DEBUG("-->Running Shadow Json View Tests - Passing null value \n");
+
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_shadow_json_view_init(NULL, &view));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_shadow_json_view_init(jsonDocument, NULL));
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_shadow_json_view_init(jsonDocument, &view));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_shadow_json_view_get_raw(&view, NULL, &pValue, &valueLength));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_shadow_json_view_get_raw(&view, "version", NULL, &valueLength));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_shadow_json_view_get_int32(NULL, "version", &number));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_shadow_json_view_get_int32(&view, "version", NULL));
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_shadow_json_view_get_string(&view, "state.desired.Name", NULL, 4));
+
+	IOT_DEBUG("-->Success - Passing null value \n");
+}
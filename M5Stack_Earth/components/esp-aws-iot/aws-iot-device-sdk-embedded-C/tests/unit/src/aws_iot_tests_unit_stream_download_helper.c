@@ -0,0 +1,364 @@
+/*
+* Copyright 2015-2016 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_tests_unit_stream_download_helper.c
+ * @brief IoT Client Unit Testing - Stream Download Tests Helper
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <CppUTest/TestHarness_c.h>
+
+#include "aws_iot_stream_download.h"
+#include "aws_iot_tests_unit_helper_functions.h"
+#include "aws_iot_tests_unit_mock_tls_params.h"
+#include "aws_iot_log.h"
+
+#define STREAM_THING "StreamThing"
+#define STREAM_NAME "stream1"
+#define STREAM_TOPIC_PREFIX "$aws/things/" STREAM_THING "/streams/" STREAM_NAME
+#define DATA_TOPIC STREAM_TOPIC_PREFIX "/data/json"
+#define REJECTED_TOPIC STREAM_TOPIC_PREFIX "/rejected/json"
+#define GET_TOPIC STREAM_TOPIC_PREFIX "/get/json"
+#define BLOCK_SIZE STREAM_DOWNLOAD_MIN_BLOCK_SIZE
+#define FILE_SIZE (BLOCK_SIZE * 10 + 16)
+#define BLOCK_COUNT 11
+
+static AWS_IoT_Client client;
+static IoT_Client_Init_Params initParams;
+static IoT_Client_Connect_Params connectParams;
+static IoT_Publish_Message_Params msgParams;
+static StreamDownload_t download;
+static StreamDownloadParams_t params;
+static uint8_t bitmap[STREAM_DOWNLOAD_BITMAP_SIZE(FILE_SIZE, BLOCK_SIZE)];
+static char payload[TLSMaxBufferSize / 2];
+
+static char writeLog[128];
+static IoT_Error_t writeResult;
+
+static uint8_t blockByte(uint32_t block, size_t offset) {
+	return (uint8_t) (block * 31 + offset);
+}
+
+static IoT_Error_t writeBlock(void *pContext, uint32_t blockIndex, const uint8_t *pData, size_t length) {
+	size_t logLength = strlen(writeLog);
+	size_t i;
+
+	IOT_UNUSED(pContext);
+
+	for(i = 0; i < length; i++) {
+		if(blockByte(blockIndex, i) != pData[i]) {
+			return FAILURE;
+		}
+	}
+	snprintf(writeLog + logLength, sizeof(writeLog) - logLength, "%u:%u;", (unsigned) blockIndex, (unsigned) length);
+	return writeResult;
+}
+
+static void encodeBase64(const uint8_t *pData, size_t length, char *pOut) {
+	static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	size_t i;
+
+	for(i = 0; i < length; i += 3) {
+		uint32_t group = (uint32_t) pData[i] << 16;
+
+		if(i + 1 < length) {
+			group |= (uint32_t) pData[i + 1] << 8;
+		}
+		if(i + 2 < length) {
+			group |= pData[i + 2];
+		}
+		*pOut++ = alphabet[(group >> 18) & 0x3F];
+		*pOut++ = alphabet[(group >> 12) & 0x3F];
+		*pOut++ = (i + 1 < length) ? alphabet[(group >> 6) & 0x3F] : '=';
+		*pOut++ = (i + 2 < length) ? alphabet[group & 0x3F] : '=';
+	}
+	*pOut = '\0';
+}
+
+static void deliver(const char *pTopic) {
+	ResetTLSBuffer();
+	msgParams.qos = QOS0;
+	msgParams.payload = payload;
+	msgParams.payloadLen = strlen(payload);
+	setTLSRxBufferWithMsgOnSubscribedTopic((char *) pTopic, strlen(pTopic), QOS0, msgParams, payload);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_mqtt_yield(&client, 50));
+}
+
+static void deliverBlockAs(uint32_t fileId, uint32_t block, size_t length) {
+	uint8_t data[BLOCK_SIZE];
+	char encoded[(BLOCK_SIZE + 2) / 3 * 4 + 1];
+	size_t i;
+
+	for(i = 0; i < length; i++) {
+		data[i] = blockByte(block, i);
+	}
+	encodeBase64(data, length, encoded);
+	snprintf(payload, sizeof(payload), "{\"c\":\"1\",\"f\":%u,\"l\":%u,\"i\":%u,\"p\":\"%s\"}", (unsigned) fileId,
+			 (unsigned) length, (unsigned) block, encoded);
+	deliver(DATA_TOPIC);
+}
+
+static void deliverBlock(uint32_t block) {
+	deliverBlockAs(0, block, (BLOCK_COUNT - 1 == block) ? FILE_SIZE - BLOCK_SIZE * (BLOCK_COUNT - 1) : BLOCK_SIZE);
+}
+
+static bool isLastRequest(uint32_t firstBlock, uint32_t blockCount) {
+	char expected[64];
+
+	snprintf(expected, sizeof(expected), "\"l\":%u,\"o\":%u,\"n\":%u}", BLOCK_SIZE, (unsigned) firstBlock,
+			 (unsigned) blockCount);
+	return strlen(GET_TOPIC) == lastPublishMessageTopicLen
+		   && 0 == strncmp(GET_TOPIC, LastPublishMessageTopic, lastPublishMessageTopicLen)
+		   && NULL != strstr(LastPublishMessagePayload, expected);
+}
+
+static StreamDownloadState_t process(void) {
+	ResetTLSBuffer();
+	return aws_iot_stream_download_process(&download);
+}
+
+static void startDownload(uint16_t blocksPerRequest, uint8_t requestsInFlight, uint32_t requestTimeoutMs) {
+	uint32_t subackQoSCount = 2;
+
+	params.blocksPerRequest = blocksPerRequest;
+	params.requestsInFlight = requestsInFlight;
+	params.requestTimeoutMs = requestTimeoutMs;
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_stream_download_init(&download, &client, &params));
+
+	ResetTLSBuffer();
+	setTLSRxBufferForMultiSuback(&subackQoSCount, 1, QOS0);
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_stream_download_start(&download));
+	CHECK_EQUAL_C_INT(true, download.isSubscribed);
+}
+
+TEST_GROUP_C_SETUP(StreamDownloadTest) {
+	IoT_Error_t rc;
+
+	ResetTLSBuffer();
+	InitMQTTParamsSetup(&initParams, AWS_IOT_MQTT_HOST, AWS_IOT_MQTT_PORT, false, NULL);
+	initParams.mqttCommandTimeout_ms = 2000;
+	rc = aws_iot_mqtt_init(&client, &initParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	ConnectMQTTParamsSetup(&connectParams, AWS_IOT_MQTT_CLIENT_ID, (uint16_t) strlen(AWS_IOT_MQTT_CLIENT_ID));
+	setTLSRxBufferForConnack(&connectParams, 0, 0);
+	rc = aws_iot_mqtt_connect(&client, &connectParams);
+	CHECK_EQUAL_C_INT(SUCCESS, rc);
+
+	params = streamDownloadParamsDefault;
+	params.pThingName = STREAM_THING;
+	params.pStreamName = STREAM_NAME;
+	params.fileId = 0;
+	params.fileSize = FILE_SIZE;
+	params.blockSize = BLOCK_SIZE;
+	params.pBitmap = bitmap;
+	params.write = writeBlock;
+	memset(bitmap, 0, sizeof(bitmap));
+	writeLog[0] = '\0';
+	writeResult = SUCCESS;
+	ResetTLSBuffer();
+}
+
+TEST_GROUP_C_TEARDOWN(StreamDownloadTest) {
+
+}
+
+TEST_C(StreamDownloadTest, InitChecks) {
+	char longName[MAX_SIZE_OF_STREAM_NAME + 1];
+
+	IOT_DEBUG("\n-->Running Stream Download Tests - Init checks \n");
+
+	params.write = NULL;
+	CHECK_EQUAL_C_INT(NULL_VALUE_ERROR, aws_iot_stream_download_init(&download, &client, &params));
+	params.write = writeBlock;
+
+	params.blockSize = STREAM_DOWNLOAD_MIN_BLOCK_SIZE - 1;
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_stream_download_init(&download, &client, &params));
+
+	/* The base64 block would not fit in the receive buffer */
+	params.blockSize = AWS_IOT_MQTT_RX_BUF_LEN;
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_stream_download_init(&download, &client, &params));
+	params.blockSize = BLOCK_SIZE;
+
+	params.requestsInFlight = STREAM_DOWNLOAD_MAX_REQUESTS + 1;
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_stream_download_init(&download, &client, &params));
+	params.requestsInFlight = 1;
+
+	memset(longName, 'x', sizeof(longName) - 1);
+	longName[sizeof(longName) - 1] = '\0';
+	params.pStreamName = longName;
+	CHECK_EQUAL_C_INT(FAILURE, aws_iot_stream_download_init(&download, &client, &params));
+	params.pStreamName = STREAM_NAME;
+
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_stream_download_init(&download, &client, &params));
+	CHECK_EQUAL_C_INT(BLOCK_COUNT, download.blockCount);
+	CHECK_EQUAL_C_INT(STREAM_DOWNLOAD_IDLE, download.state);
+}
+
+TEST_C(StreamDownloadTest, WindowOfRequestsInFlight) {
+	IOT_DEBUG("\n-->Running Stream Download Tests - Several requests in flight \n");
+
+	startDownload(2, 3, 60000);
+	CHECK_EQUAL_C_INT(STREAM_DOWNLOAD_RUNNING, process());
+	CHECK_EQUAL_C_INT(3, download.requestsSent);
+	CHECK_EQUAL_C_INT(true, isLastRequest(4, 2));
+	CHECK_EQUAL_C_INT(0, download.requests[0].firstBlock);
+	CHECK_EQUAL_C_INT(2, download.requests[1].firstBlock);
+
+	/* Nothing more until a range is complete */
+	CHECK_EQUAL_C_INT(STREAM_DOWNLOAD_RUNNING, process());
+	CHECK_EQUAL_C_INT(3, download.requestsSent);
+
+	deliverBlock(3);
+	deliverBlock(0);
+	CHECK_EQUAL_C_INT(STREAM_DOWNLOAD_RUNNING, process());
+	CHECK_EQUAL_C_INT(3, download.requestsSent);
+
+	/* The first range is complete, its slot takes the next one */
+	deliverBlock(1);
+	CHECK_EQUAL_C_INT(STREAM_DOWNLOAD_RUNNING, process());
+	CHECK_EQUAL_C_INT(4, download.requestsSent);
+	CHECK_EQUAL_C_INT(true, isLastRequest(6, 2));
+	CHECK_EQUAL_C_STRING("3:256;0:256;1:256;", writeLog);
+	CHECK_EQUAL_C_INT(3, download.receivedCount);
+	CHECK_EQUAL_C_INT(0x0B, bitmap[0]);
+}
+
+TEST_C(StreamDownloadTest, OutOfOrderBlocksComplete) {
+	uint32_t order[BLOCK_COUNT] = {10, 4, 7, 0, 9, 1, 5, 8, 2, 6, 3};
+	uint8_t i;
+
+	IOT_DEBUG("\n-->Running Stream Download Tests - Blocks arriving out of order and twice \n");
+
+	startDownload(4, 3, 60000);
+	process();
+	CHECK_EQUAL_C_INT(true, isLastRequest(8, 3));
+
+	for(i = 0; i < BLOCK_COUNT; i++) {
+		deliverBlock(order[i]);
+		if(4 == order[i]) {
+			deliverBlock(4);
+		}
+	}
+	CHECK_EQUAL_C_INT(STREAM_DOWNLOAD_COMPLETE, download.state);
+	CHECK_EQUAL_C_INT(STREAM_DOWNLOAD_COMPLETE, process());
+	CHECK_EQUAL_C_INT(1, download.duplicateBlocks);
+	CHECK_EQUAL_C_INT(BLOCK_COUNT, download.receivedCount);
+	CHECK_EQUAL_C_INT(0xFF, bitmap[0]);
+	CHECK_EQUAL_C_INT(0x07, bitmap[1]);
+	CHECK_EQUAL_C_INT(0, strncmp("10:16;4:256;", writeLog, 12));
+}
+
+TEST_C(StreamDownloadTest, InvalidBlocksIgnored) {
+	IOT_DEBUG("\n-->Running Stream Download Tests - Blocks of other files or with a wrong length \n");
+
+	startDownload(2, 1, 60000);
+	process();
+
+	deliverBlockAs(1, 0, BLOCK_SIZE);
+	deliverBlockAs(0, 0, BLOCK_SIZE - 1);
+	deliverBlockAs(0, BLOCK_COUNT, BLOCK_SIZE);
+	snprintf(payload, sizeof(payload), "{\"c\":\"1\",\"f\":0,\"l\":3,\"i\":0,\"p\":\"A*BC\"}");
+	deliver(DATA_TOPIC);
+	CHECK_EQUAL_C_STRING("", writeLog);
+	CHECK_EQUAL_C_INT(0, download.receivedCount);
+	CHECK_EQUAL_C_INT(STREAM_DOWNLOAD_RUNNING, process());
+
+	deliverBlock(0);
+	CHECK_EQUAL_C_STRING("0:256;", writeLog);
+}
+
+TEST_C(StreamDownloadTest, LateRequestAsksForMissingBlocks) {
+	IOT_DEBUG("\n-->Running Stream Download Tests - Missing blocks of a late request asked again \n");
+
+	params.maxRetries = 1;
+	startDownload(4, 1, 100);
+	process();
+	CHECK_EQUAL_C_INT(true, isLastRequest(0, 4));
+
+	deliverBlock(0);
+	deliverBlock(2);
+	usleep(150 * 1000);
+	CHECK_EQUAL_C_INT(STREAM_DOWNLOAD_RUNNING, process());
+	CHECK_EQUAL_C_INT(2, download.requestsSent);
+	CHECK_EQUAL_C_INT(true, isLastRequest(1, 3));
+	CHECK_EQUAL_C_INT(1, download.requests[0].retries);
+
+	/* Out of retries */
+	usleep(150 * 1000);
+	CHECK_EQUAL_C_INT(STREAM_DOWNLOAD_FAILED, process());
+	CHECK_EQUAL_C_INT(MQTT_REQUEST_TIMEOUT_ERROR, download.failure);
+}
+
+TEST_C(StreamDownloadTest, ResumeFromBitmap) {
+	uint32_t block;
+
+	IOT_DEBUG("\n-->Running Stream Download Tests - Resume with the blocks of a saved bitmap \n");
+
+	/* Blocks 0 to 3 and 5 written before a reboot */
+	bitmap[0] = 0x2F;
+	startDownload(4, 2, 60000);
+	CHECK_EQUAL_C_INT(5, download.receivedCount);
+
+	process();
+	CHECK_EQUAL_C_INT(2, download.requestsSent);
+	CHECK_EQUAL_C_INT(4, download.requests[0].firstBlock);
+	CHECK_EQUAL_C_INT(4, download.requests[0].blockCount);
+	CHECK_EQUAL_C_INT(true, isLastRequest(8, 3));
+
+	for(block = 4; block < BLOCK_COUNT; block++) {
+		deliverBlock(block);
+	}
+	CHECK_EQUAL_C_STRING("4:256;6:256;7:256;8:256;9:256;10:16;", writeLog);
+	CHECK_EQUAL_C_INT(1, download.duplicateBlocks);
+	CHECK_EQUAL_C_INT(STREAM_DOWNLOAD_COMPLETE, process());
+
+	/* A complete bitmap needs no request */
+	CHECK_EQUAL_C_INT(SUCCESS, aws_iot_stream_download_init(&download, &client, &params));
+	CHECK_EQUAL_C_INT(BLOCK_COUNT, download.receivedCount);
+}
+
+TEST_C(StreamDownloadTest, RejectedRequestFailsDownload) {
+	IOT_DEBUG("\n-->Running Stream Download Tests - Rejected request \n");
+
+	startDownload(2, 2, 60000);
+	process();
+
+	snprintf(payload, sizeof(payload), "{\"o\":\"ResourceNotFound\",\"m\":\"No stream\",\"c\":\"1\"}");
+	deliver(REJECTED_TOPIC);
+	CHECK_EQUAL_C_INT(STREAM_DOWNLOAD_FAILED, process());
+	CHECK_EQUAL_C_INT(FAILURE, download.failure);
+}
+
+TEST_C(StreamDownloadTest, WriteErrorFailsDownload) {
+	IOT_DEBUG("\n-->Running Stream Download Tests - Block that cannot be written \n");
+
+	startDownload(2, 2, 60000);
+	process();
+
+	writeResult = FAILURE;
+	deliverBlock(1);
+	CHECK_EQUAL_C_INT(STREAM_DOWNLOAD_FAILED, download.state);
+	CHECK_EQUAL_C_INT(FAILURE, download.failure);
+	CHECK_EQUAL_C_INT(0, download.receivedCount);
+
+	/* Later blocks are not written */
+	writeResult = SUCCESS;
+	deliverBlock(0);
+	CHECK_EQUAL_C_STRING("1:256;", writeLog);
+}
@@ -55,3 +55,12 @@ TEST_GROUP_C_WRAPPER(YieldTests, resubscribeSuccessfulReconnect)
 
 /* G:13 - Delayed Ping response. */
 TEST_GROUP_C_WRAPPER(YieldTests, delayedPingResponse)
+
+/* G:14 - Yield wakeup, network stack without wakeup support */
+TEST_GROUP_C_WRAPPER(YieldTests, yieldWakeupNotSupported)
+/* G:15 - Event-driven yield, message received on subscribed topic */
+TEST_GROUP_C_WRAPPER(YieldTests, eventDrivenYieldReceivesMessage)
+/* G:16 - Event-driven yield, application wakeup returns before the timeout */
+TEST_GROUP_C_WRAPPER(YieldTests, eventDrivenYieldWakeup)
+/* G:17 - Event-driven yield, ping request sent at keep-alive deadline */
+TEST_GROUP_C_WRAPPER(YieldTests, eventDrivenYieldPingRequest)
@@ -62,6 +62,7 @@ extern size_t lastPublishMessagePayloadLen;
 extern char hostAddress[512];
 extern uint16_t port;
 extern uint32_t handshakeTimeout_ms;
+extern bool mockWakeupPending;
 
 extern char *invalidEndpointFilter;
 extern char *invalidRootCAPathFilter;
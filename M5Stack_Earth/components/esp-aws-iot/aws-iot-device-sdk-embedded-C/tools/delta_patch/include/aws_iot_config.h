@@ -0,0 +1,30 @@
+/*
+* Copyright 2015-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_config.h
+ * @brief Delta patch tool - IoT Config
+ */
+
+#ifndef IOT_DELTA_PATCH_TOOL_CONFIG_H_
+#define IOT_DELTA_PATCH_TOOL_CONFIG_H_
+
+/* The fork's SDK sources expect the config header to bring in the log macros, as the ESP32 port's does */
+#include "aws_iot_log.h"
+
+/* The tool checks the patches it creates with any window, the devices accept up to their own setting */
+#define DELTA_PATCH_MAX_WINDOW_BITS 16
+
+#endif /* IOT_DELTA_PATCH_TOOL_CONFIG_H_ */
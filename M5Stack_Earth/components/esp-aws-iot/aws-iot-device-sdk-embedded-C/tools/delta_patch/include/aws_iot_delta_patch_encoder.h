@@ -0,0 +1,48 @@
+/*
+* Copyright 2015-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_delta_patch_encoder.h
+ * @brief Host side generation of the delta patches applied by aws_iot_delta_patch.h
+ */
+
+#ifndef AWS_IOT_DELTA_PATCH_ENCODER_H_
+#define AWS_IOT_DELTA_PATCH_ENCODER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Build the patch turning a source image into a target image
+ *
+ * Matches are found with a suffix array of the source as in bsdiff, so the time grows as n log n of the source
+ * and the memory is 8 bytes per source byte.
+ *
+ * @param pSource Source image
+ * @param sourceSize Bytes of the source, at least 1
+ * @param pTarget Target image
+ * @param targetSize Bytes of the target, at least 1
+ * @param windowBits log2 of the compression window, DELTA_PATCH_MIN_WINDOW_BITS to the device's
+ * DELTA_PATCH_MAX_WINDOW_BITS
+ * @param pSourceHash SHA-256 of the source, stored in the header
+ * @param ppPatch Set to the patch, header included, to be released with free
+ * @param pPatchSize Set to the bytes of the patch
+ *
+ * @return 0, or -1 for invalid arguments or when memory runs out
+ */
+int aws_iot_delta_patch_encode(const uint8_t *pSource, size_t sourceSize, const uint8_t *pTarget, size_t targetSize,
+							   uint8_t windowBits, const uint8_t *pSourceHash, uint8_t **ppPatch, size_t *pPatchSize);
+
+#endif /* AWS_IOT_DELTA_PATCH_ENCODER_H_ */
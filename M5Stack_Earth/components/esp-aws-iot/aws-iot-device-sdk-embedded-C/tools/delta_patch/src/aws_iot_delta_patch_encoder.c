@@ -0,0 +1,530 @@
+/*
+* Copyright 2015-2018 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+*
+* Licensed under the Apache License, Version 2.0 (the "License").
+* You may not use this file except in compliance with the License.
+* A copy of the License is located at
+*
+* http://aws.amazon.com/apache2.0
+*
+* or in the "license" file accompanying this file. This file is distributed
+* on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+* express or implied. See the License for the specific language governing
+* permissions and limitations under the License.
+*/
+
+/**
+ * @file aws_iot_delta_patch_encoder.c
+ * @brief bsdiff style differencing followed by LZ77 compression of the commands
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "aws_iot_delta_patch.h"
+#include "aws_iot_delta_patch_encoder.h"
+
+#define ENCODER_MIN_MATCH 4 ///< Shortest match worth a sequence, a match nibble of 1
+#define ENCODER_MAX_MATCH 65536 ///< Longest match looked for, longer runs take several sequences
+#define ENCODER_HASH_BITS 16
+#define ENCODER_MAX_CHAIN 64 ///< Candidates tried at each position
+
+typedef struct {
+	uint8_t *pData;
+	size_t length;
+	size_t size;
+	int isOutOfMemory;
+} Buffer_t;
+
+static void reserve(Buffer_t *pBuffer, size_t length) {
+	uint8_t *pData;
+	size_t size;
+
+	if(pBuffer->isOutOfMemory || pBuffer->length + length <= pBuffer->size) {
+		return;
+	}
+	size = pBuffer->size ? pBuffer->size : 4096;
+	while(size < pBuffer->length + length) {
+		size *= 2;
+	}
+	pData = realloc(pBuffer->pData, size);
+	if(NULL == pData) {
+		pBuffer->isOutOfMemory = 1;
+		return;
+	}
+	pBuffer->pData = pData;
+	pBuffer->size = size;
+}
+
+static void append(Buffer_t *pBuffer, const uint8_t *pData, size_t length) {
+	reserve(pBuffer, length);
+	if(!pBuffer->isOutOfMemory) {
+		memcpy(pBuffer->pData + pBuffer->length, pData, length);
+		pBuffer->length += length;
+	}
+}
+
+static void appendByte(Buffer_t *pBuffer, uint8_t byte) {
+	append(pBuffer, &byte, 1);
+}
+
+static void appendNumber(Buffer_t *pBuffer, uint32_t number) {
+	while(number >= 0x80) {
+		appendByte(pBuffer, (uint8_t) (number | 0x80));
+		number >>= 7;
+	}
+	appendByte(pBuffer, (uint8_t) number);
+}
+
+static void appendLittleEndian32(Buffer_t *pBuffer, uint32_t value) {
+	appendByte(pBuffer, (uint8_t) value);
+	appendByte(pBuffer, (uint8_t) (value >> 8));
+	appendByte(pBuffer, (uint8_t) (value >> 16));
+	appendByte(pBuffer, (uint8_t) (value >> 24));
+}
+
+/* Suffix sorting by prefix doubling, Larsson and Sadakane. V holds the group of each suffix, I the sorted
+ * suffixes, with -length marking runs of suffixes already in their final place */
+static void splitGroup(int32_t *I, int32_t *V, int32_t start, int32_t length, int32_t h) {
+	int32_t i, j, k, x, tmp, jj, kk;
+
+	if(length < 16) {
+		for(k = start; k < start + length; k += j) {
+			j = 1;
+			x = V[I[k] + h];
+			for(i = 1; k + i < start + length; i++) {
+				if(V[I[k + i] + h] < x) {
+					x = V[I[k + i] + h];
+					j = 0;
+				}
+				if(V[I[k + i] + h] == x) {
+					tmp = I[k + j];
+					I[k + j] = I[k + i];
+					I[k + i] = tmp;
+					j++;
+				}
+			}
+			for(i = 0; i < j; i++) {
+				V[I[k + i]] = k + j - 1;
+			}
+			if(1 == j) {
+				I[k] = -1;
+			}
+		}
+		return;
+	}
+
+	x = V[I[start + length / 2] + h];
+	jj = 0;
+	kk = 0;
+	for(i = start; i < start + length; i++) {
+		if(V[I[i] + h] < x) {
+			jj++;
+		}
+		if(V[I[i] + h] == x) {
+			kk++;
+		}
+	}
+	jj += start;
+	kk += jj;
+
+	i = start;
+	j = 0;
+	k = 0;
+	while(i < jj) {
+		if(V[I[i] + h] < x) {
+			i++;
+		} else if(V[I[i] + h] == x) {
+			tmp = I[i];
+			I[i] = I[jj + j];
+			I[jj + j] = tmp;
+			j++;
+		} else {
+			tmp = I[i];
+			I[i] = I[kk + k];
+			I[kk + k] = tmp;
+			k++;
+		}
+	}
+	while(jj + j < kk) {
+		if(V[I[jj + j] + h] == x) {
+			j++;
+		} else {
+			tmp = I[jj + j];
+			I[jj + j] = I[kk + k];
+			I[kk + k] = tmp;
+			k++;
+		}
+	}
+
+	if(jj > start) {
+		splitGroup(I, V, start, jj - start, h);
+	}
+	for(i = 0; i < kk - jj; i++) {
+		V[I[jj + i]] = kk - 1;
+	}
+	if(jj == kk - 1) {
+		I[jj] = -1;
+	}
+	if(start + length > kk) {
+		splitGroup(I, V, kk, start + length - kk, h);
+	}
+}
+
+static void sortSuffixes(int32_t *I, int32_t *V, const uint8_t *pSource, int32_t size) {
+	int32_t buckets[256];
+	int32_t i, h, length;
+
+	memset(buckets, 0, sizeof(buckets));
+	for(i = 0; i < size; i++) {
+		buckets[pSource[i]]++;
+	}
+	for(i = 1; i < 256; i++) {
+		buckets[i] += buckets[i - 1];
+	}
+	for(i = 255; i > 0; i--) {
+		buckets[i] = buckets[i - 1];
+	}
+	buckets[0] = 0;
+
+	for(i = 0; i < size; i++) {
+		I[++buckets[pSource[i]]] = i;
+	}
+	I[0] = size;
+	for(i = 0; i < size; i++) {
+		V[i] = buckets[pSource[i]];
+	}
+	V[size] = 0;
+	for(i = 1; i < 256; i++) {
+		if(buckets[i] == buckets[i - 1] + 1) {
+			I[buckets[i]] = -1;
+		}
+	}
+	I[0] = -1;
+
+	for(h = 1; I[0] != -(size + 1); h += h) {
+		length = 0;
+		for(i = 0; i < size + 1;) {
+			if(I[i] < 0) {
+				length -= I[i];
+				i -= I[i];
+			} else {
+				if(length) {
+					I[i - length] = -length;
+				}
+				length = V[I[i]] + 1 - i;
+				splitGroup(I, V, i, length, h);
+				i += length;
+				length = 0;
+			}
+		}
+		if(length) {
+			I[i - length] = -length;
+		}
+	}
+
+	for(i = 0; i < size + 1; i++) {
+		I[V[i]] = i;
+	}
+}
+
+static int32_t matchLength(const uint8_t *pA, int32_t aSize, const uint8_t *pB, int32_t bSize) {
+	int32_t i;
+
+	for(i = 0; i < aSize && i < bSize; i++) {
+		if(pA[i] != pB[i]) {
+			break;
+		}
+	}
+	return i;
+}
+
+/* Binary search of the sorted suffixes for the longest match of pTarget */
+static int32_t searchSource(const int32_t *I, const uint8_t *pSource, int32_t sourceSize, const uint8_t *pTarget,
+							int32_t targetSize, int32_t start, int32_t end, int32_t *pPosition) {
+	int32_t x, y, middle;
+
+	while(end - start >= 2) {
+		middle = start + (end - start) / 2;
+		x = sourceSize - I[middle];
+		if(memcmp(pSource + I[middle], pTarget, x < targetSize ? x : targetSize) < 0) {
+			start = middle;
+		} else {
+			end = middle;
+		}
+	}
+
+	x = matchLength(pSource + I[start], sourceSize - I[start], pTarget, targetSize);
+	y = matchLength(pSource + I[end], sourceSize - I[end], pTarget, targetSize);
+	if(x > y) {
+		*pPosition = I[start];
+		return x;
+	}
+	*pPosition = I[end];
+	return y;
+}
+
+/* *pSourceCursor is where the previous command left the source position of the applier */
+static void appendCommand(Buffer_t *pCommands, const uint8_t *pSource, int32_t sourcePosition, const uint8_t *pTarget,
+						  int32_t targetPosition, int32_t diffLength, int32_t extraLength, int32_t *pSourceCursor) {
+	int32_t seek = sourcePosition - *pSourceCursor;
+	int32_t i;
+
+	/* bsdiff may only move the source position, which the next command's seek does as well */
+	if(0 == diffLength && 0 == extraLength) {
+		return;
+	}
+	*pSourceCursor = sourcePosition + diffLength;
+
+	appendNumber(pCommands, seek < 0 ? ((uint32_t) -(seek + 1) << 1) | 1 : (uint32_t) seek << 1);
+	appendNumber(pCommands, (uint32_t) diffLength);
+	appendNumber(pCommands, (uint32_t) extraLength);
+	reserve(pCommands, (size_t) diffLength);
+	if(pCommands->isOutOfMemory) {
+		return;
+	}
+	for(i = 0; i < diffLength; i++) {
+		pCommands->pData[pCommands->length++] = (uint8_t) (pTarget[targetPosition + i] - pSource[sourcePosition + i]);
+	}
+	append(pCommands, pTarget + targetPosition + diffLength, (size_t) extraLength);
+}
+
+/* bsdiff: extend approximate matches forwards and backwards, the rest of the target becomes extra bytes */
+static void buildCommands(const uint8_t *pSource, int32_t sourceSize, const uint8_t *pTarget, int32_t targetSize,
+						  const int32_t *I, Buffer_t *pCommands) {
+	int32_t scan = 0, length = 0, position = 0;
+	int32_t lastScan = 0, lastPosition = 0, lastOffset = 0;
+	int32_t sourceCursor = 0;
+	int32_t oldScore, scoreScan;
+	int32_t s, forwardScore, forwardLength, backwardScore, backwardLength;
+	int32_t overlap, splitScore, splitLength;
+	int32_t i;
+
+	while(scan < targetSize) {
+		oldScore = 0;
+		for(scoreScan = scan += length; scan < targetSize; scan++) {
+			length = searchSource(I, pSource, sourceSize, pTarget + scan, targetSize - scan, 0, sourceSize,
+								  &position);
+			for(; scoreScan < scan + length; scoreScan++) {
+				if(scoreScan + lastOffset < sourceSize && pSource[scoreScan + lastOffset] == pTarget[scoreScan]) {
+					oldScore++;
+				}
+			}
+			if((length == oldScore && 0 != length) || length > oldScore + 8) {
+				break;
+			}
+			if(scan + lastOffset < sourceSize && pSource[scan + lastOffset] == pTarget[scan]) {
+				oldScore--;
+			}
+		}
+
+		if(length == oldScore && scan != targetSize) {
+			continue;
+		}
+
+		s = 0;
+		forwardScore = 0;
+		forwardLength = 0;
+		for(i = 0; lastScan + i < scan && lastPosition + i < sourceSize;) {
+			if(pSource[lastPosition + i] == pTarget[lastScan + i]) {
+				s++;
+			}
+			i++;
+			if(s * 2 - i > forwardScore * 2 - forwardLength) {
+				forwardScore = s;
+				forwardLength = i;
+			}
+		}
+
+		backwardLength = 0;
+		if(scan < targetSize) {
+			s = 0;
+			backwardScore = 0;
+			for(i = 1; scan >= lastScan + i && position >= i; i++) {
+				if(pSource[position - i] == pTarget[scan - i]) {
+					s++;
+				}
+				if(s * 2 - i > backwardScore * 2 - backwardLength) {
+					backwardScore = s;
+					backwardLength = i;
+				}
+			}
+		}
+
+		if(lastScan + forwardLength > scan - backwardLength) {
+			overlap = (lastScan + forwardLength) - (scan - backwardLength);
+			s = 0;
+			splitScore = 0;
+			splitLength = 0;
+			for(i = 0; i < overlap; i++) {
+				if(pTarget[lastScan + forwardLength - overlap + i] == pSource[lastPosition + forwardLength - overlap + i]) {
+					s++;
+				}
+				if(pTarget[scan - backwardLength + i] == pSource[position - backwardLength + i]) {
+					s--;
+				}
+				if(s > splitScore) {
+					splitScore = s;
+					splitLength = i + 1;
+				}
+			}
+			forwardLength += splitLength - overlap;
+			backwardLength -= splitLength;
+		}
+
+		appendCommand(pCommands, pSource, lastPosition, pTarget, lastScan, forwardLength,
+					  (scan - backwardLength) - (lastScan + forwardLength), &sourceCursor);
+
+		lastScan = scan - backwardLength;
+		lastPosition = position - backwardLength;
+		lastOffset = position - scan;
+	}
+}
+
+static void appendExtendedLength(Buffer_t *pOutput, size_t length) {
+	while(length >= 255) {
+		appendByte(pOutput, 255);
+		length -= 255;
+	}
+	appendByte(pOutput, (uint8_t) length);
+}
+
+static void appendSequence(Buffer_t *pOutput, const uint8_t *pLiterals, size_t literalCount, size_t matchLength,
+						   size_t matchOffset) {
+	size_t matchCode = matchLength ? matchLength - 3 : 0;
+
+	appendByte(pOutput, (uint8_t) ((literalCount < 15 ? literalCount : 15) << 4 | (matchCode < 15 ? matchCode : 15)));
+	if(literalCount >= 15) {
+		appendExtendedLength(pOutput, literalCount - 15);
+	}
+	append(pOutput, pLiterals, literalCount);
+	if(matchLength) {
+		appendByte(pOutput, (uint8_t) matchOffset);
+		appendByte(pOutput, (uint8_t) (matchOffset >> 8));
+		if(matchCode >= 15) {
+			appendExtendedLength(pOutput, matchCode - 15);
+		}
+	}
+}
+
+static uint32_t hash4(const uint8_t *pData) {
+	uint32_t value = (uint32_t) pData[0] | ((uint32_t) pData[1] << 8) | ((uint32_t) pData[2] << 16)
+					 | ((uint32_t) pData[3] << 24);
+
+	return (value * 2654435761u) >> (32 - ENCODER_HASH_BITS);
+}
+
+/* Greedy LZ77 with hash chains, matches at most windowSize bytes back */
+static int compress(const uint8_t *pData, size_t length, size_t windowSize, Buffer_t *pOutput) {
+	int32_t *pHead = malloc(sizeof(int32_t) << ENCODER_HASH_BITS);
+	int32_t *pChain = malloc(sizeof(int32_t) * (length + 1));
+	size_t position = 0;
+	size_t literalStart = 0;
+	size_t best, bestOffset, candidateLength, limit, end;
+	int32_t candidate;
+	uint32_t chain;
+
+	if(NULL == pHead || NULL == pChain) {
+		free(pHead);
+		free(pChain);
+		return -1;
+	}
+	memset(pHead, 0xFF, sizeof(int32_t) << ENCODER_HASH_BITS);
+
+	while(position < length) {
+		best = 0;
+		bestOffset = 0;
+		if(position + ENCODER_MIN_MATCH <= length) {
+			limit = length - position;
+			if(limit > ENCODER_MAX_MATCH) {
+				limit = ENCODER_MAX_MATCH;
+			}
+			candidate = pHead[hash4(pData + position)];
+			for(chain = 0; candidate >= 0 && position - (size_t) candidate <= windowSize && chain < ENCODER_MAX_CHAIN;
+				chain++) {
+				candidateLength = 0;
+				while(candidateLength < limit && pData[candidate + candidateLength] == pData[position + candidateLength]) {
+					candidateLength++;
+				}
+				if(candidateLength > best) {
+					best = candidateLength;
+					bestOffset = position - (size_t) candidate;
+					if(best == limit) {
+						break;
+					}
+				}
+				candidate = pChain[candidate];
+			}
+		}
+
+		end = best >= ENCODER_MIN_MATCH ? position + best : position + 1;
+		for(; position < end; position++) {
+			if(position + ENCODER_MIN_MATCH <= length) {
+				uint32_t h = hash4(pData + position);
+
+				pChain[position] = pHead[h];
+				pHead[h] = (int32_t) position;
+			}
+		}
+		if(best >= ENCODER_MIN_MATCH) {
+			appendSequence(pOutput, pData + literalStart, end - best - literalStart, best, bestOffset);
+			literalStart = end;
+		}
+	}
+	if(literalStart < length) {
+		appendSequence(pOutput, pData + literalStart, length - literalStart, 0, 0);
+	}
+
+	free(pHead);
+	free(pChain);
+	return pOutput->isOutOfMemory ? -1 : 0;
+}
+
+int aws_iot_delta_patch_encode(const uint8_t *pSource, size_t sourceSize, const uint8_t *pTarget, size_t targetSize,
+							   uint8_t windowBits, const uint8_t *pSourceHash, uint8_t **ppPatch, size_t *pPatchSize) {
+	Buffer_t commands = {NULL, 0, 0, 0};
+	Buffer_t patch = {NULL, 0, 0, 0};
+	int32_t *I;
+	int32_t *V;
+	int rc;
+
+	if(NULL == pSource || NULL == pTarget || NULL == pSourceHash || NULL == ppPatch || NULL == pPatchSize
+	   || 0 == sourceSize || 0 == targetSize || sourceSize > INT32_MAX - 1 || targetSize > UINT32_MAX
+	   || windowBits < DELTA_PATCH_MIN_WINDOW_BITS || windowBits > 16) {
+		return -1;
+	}
+
+	I = malloc(sizeof(int32_t) * (sourceSize + 1));
+	V = malloc(sizeof(int32_t) * (sourceSize + 1));
+	if(NULL == I || NULL == V) {
+		free(I);
+		free(V);
+		return -1;
+	}
+	sortSuffixes(I, V, pSource, (int32_t) sourceSize);
+	free(V);
+	buildCommands(pSource, (int32_t) sourceSize, pTarget, (int32_t) targetSize, I, &commands);
+	free(I);
+
+	append(&patch, (const uint8_t *) "DPAT", 4);
+	appendByte(&patch, DELTA_PATCH_VERSION);
+	appendByte(&patch, windowBits);
+	appendByte(&patch, 0);
+	appendByte(&patch, 0);
+	appendLittleEndian32(&patch, (uint32_t) sourceSize);
+	appendLittleEndian32(&patch, (uint32_t) targetSize);
+	append(&patch, pSourceHash, DELTA_PATCH_HASH_SIZE);
+
+	/* Offsets are 16 bits, a 64 KB window loses its last byte */
+	rc = commands.isOutOfMemory ? -1 : compress(commands.pData, commands.length,
+												 16 == windowBits ? 0xFFFF : (size_t) 1 << windowBits, &patch);
+	free(commands.pData);
+	if(0 != rc || patch.isOutOfMemory) {
+		free(patch.pData);
+		return -1;
+	}
+
+	*ppPatch = patch.pData;
+	*pPatchSize = patch.length;
+	return 0;
+}
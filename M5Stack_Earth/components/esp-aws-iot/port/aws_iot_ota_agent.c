@@ -0,0 +1,635 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * Additions Copyright 2016 Espressif Systems (Shanghai) PTE LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_ota_agent.c
+ * @brief Downloads, verifies and boots application images as job steps
+ *
+ * Blocks are written with esp_partition_write at their offset rather than through esp_ota_write, which only
+ * appends, so they can be stored in the order they arrive. The range of the image is erased once when a download
+ * starts, not when it resumes.
+ *
+ * A delta patch is downloaded the same way to the last sectors of the partition. Once it is complete the worker
+ * erases the start of the partition and applies the patch there, reading the running partition as the source.
+ * A reboot while applying leaves the patch in place, running the step again applies it again.
+ */
+
+#include "sdkconfig.h"
+
+#ifdef CONFIG_AWS_IOT_OTA_AGENT
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_spi_flash.h"
+#include "esp_system.h"
+#include "mbedtls/sha256.h"
+#include "nvs.h"
+
+#include "cryptoauthlib.h"
+#include "atca_basic.h"
+#include "atca_helpers.h"
+
+#include "aws_iot_ota_agent.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define OTA_NVS_NAMESPACE "aws_iot_ota"
+#define OTA_NVS_IMAGE_KEY "image"
+#define OTA_NVS_BITMAP_KEY "bitmap"
+
+#define OTA_READ_CHUNK_SIZE 1024
+#define OTA_MAX_DER_SIGNATURE_SIZE 72
+
+#define OTA_FIELD_STREAM 0x01
+#define OTA_FIELD_FILE_ID 0x02
+#define OTA_FIELD_SIZE 0x04
+#define OTA_FIELD_SIGNATURE 0x08
+#define OTA_FIELDS_ALL 0x0F
+
+static const char *TAG = "aws_iot_ota";
+
+const AWS_IoT_OTA_Agent_Params otaAgentParamsDefault = otaAgentParamsDefault_initializer;
+
+typedef enum {
+	OTA_AGENT_IDLE,
+	OTA_AGENT_PREPARING, ///< The worker erases the partition or restores the bitmap
+	OTA_AGENT_DOWNLOAD_PENDING, ///< Ready for the task yielding the client to start the download
+	OTA_AGENT_DOWNLOADING,
+	OTA_AGENT_VERIFYING, ///< The download ended, the worker checks the image
+	OTA_AGENT_RESTART_PENDING ///< The image is the boot partition, waiting for the job to be reported
+} OTA_Agent_Phase;
+
+static uint8_t loadPhase(AWS_IoT_OTA_Agent *pAgent) {
+	return __atomic_load_n(&pAgent->phase, __ATOMIC_ACQUIRE);
+}
+
+static void storePhase(AWS_IoT_OTA_Agent *pAgent, OTA_Agent_Phase phase) {
+	__atomic_store_n(&pAgent->phase, (uint8_t) phase, __ATOMIC_RELEASE);
+}
+
+static bool isCanceled(AWS_IoT_OTA_Agent *pAgent) {
+	return __atomic_load_n(&pAgent->isCanceled, __ATOMIC_ACQUIRE);
+}
+
+static size_t bitmapSize(const AWS_IoT_OTA_Image *pImage) {
+	return STREAM_DOWNLOAD_BITMAP_SIZE(pImage->size, AWS_IOT_OTA_BLOCK_SIZE);
+}
+
+static bool parseUnsigned(const char *pText, uint32_t length, uint32_t *pValue) {
+	uint64_t value = 0;
+	uint32_t i;
+
+	if(0 == length) {
+		return false;
+	}
+	for(i = 0; i < length; i++) {
+		if(pText[i] < '0' || pText[i] > '9') {
+			return false;
+		}
+		value = value * 10 + (uint64_t) (pText[i] - '0');
+		if(value > UINT32_MAX) {
+			return false;
+		}
+	}
+	*pValue = (uint32_t) value;
+	return true;
+}
+
+/* Code signing produces DER, SEQUENCE {INTEGER r, INTEGER s}, the ATECC608 takes r and s as 32 bytes each */
+static bool readSignature(const uint8_t *pDer, size_t length, uint8_t *pRaw) {
+	size_t offset = 2;
+	size_t integerLength;
+	uint8_t i;
+
+	if(AWS_IOT_OTA_SIGNATURE_SIZE == length) {
+		memcpy(pRaw, pDer, length);
+		return true;
+	}
+	if(length < 8 || 0x30 != pDer[0] || pDer[1] != length - 2) {
+		return false;
+	}
+
+	for(i = 0; i < 2; i++) {
+		if(offset + 2 > length || 0x02 != pDer[offset]) {
+			return false;
+		}
+		integerLength = pDer[offset + 1];
+		offset += 2;
+		if(offset + integerLength > length) {
+			return false;
+		}
+		while(integerLength > 32 && 0 == pDer[offset]) {
+			offset++;
+			integerLength--;
+		}
+		if(0 == integerLength || integerLength > 32) {
+			return false;
+		}
+		memset(pRaw + 32 * i, 0, 32 - integerLength);
+		memcpy(pRaw + 32 * i + 32 - integerLength, pDer + offset, integerLength);
+		offset += integerLength;
+	}
+
+	return offset == length;
+}
+
+/* Called in the task yielding the client while the job document is read */
+static IoT_Error_t otaParam(JobsStep_t *pStep, const JsonStreamEvent_t *pEvent, const char *pParamPath) {
+	AWS_IoT_OTA_Agent *pAgent = (AWS_IoT_OTA_Agent *) pStep->pHandler->pContext;
+	AWS_IoT_OTA_Image *pImage = &pAgent->pending;
+	uint8_t der[OTA_MAX_DER_SIGNATURE_SIZE];
+	size_t derLength = sizeof(der);
+
+	if(NULL == pParamPath) {
+		return FAILURE;
+	}
+
+	if('\0' == pParamPath[0]) {
+		if(JSON_STREAM_OBJECT_START == pEvent->type) {
+			memset(pImage, 0, sizeof(AWS_IoT_OTA_Image));
+			pAgent->pendingFields = 0;
+			return SUCCESS;
+		}
+		if(JSON_STREAM_OBJECT_END == pEvent->type && OTA_FIELDS_ALL == pAgent->pendingFields) {
+			return SUCCESS;
+		}
+		ESP_LOGE(TAG, "The ota step needs stream, fileId, size and signature");
+		return FAILURE;
+	}
+
+	if(JSON_STREAM_STRING == pEvent->type && 0 == strcmp("stream", pParamPath)) {
+		if(0 == pEvent->valueLength || pEvent->valueLength >= sizeof(pImage->streamName)) {
+			return FAILURE;
+		}
+		memcpy(pImage->streamName, pEvent->pValue, pEvent->valueLength);
+		pImage->streamName[pEvent->valueLength] = '\0';
+		pAgent->pendingFields |= OTA_FIELD_STREAM;
+	} else if(JSON_STREAM_NUMBER == pEvent->type && 0 == strcmp("fileId", pParamPath)) {
+		if(!parseUnsigned(pEvent->pValue, pEvent->valueLength, &pImage->fileId)) {
+			return FAILURE;
+		}
+		pAgent->pendingFields |= OTA_FIELD_FILE_ID;
+	} else if(JSON_STREAM_NUMBER == pEvent->type && 0 == strcmp("size", pParamPath)) {
+		if(!parseUnsigned(pEvent->pValue, pEvent->valueLength, &pImage->size) || 0 == pImage->size
+		   || pImage->size > AWS_IOT_OTA_MAX_IMAGE_SIZE) {
+			ESP_LOGE(TAG, "Image size must be 1 to %d bytes", AWS_IOT_OTA_MAX_IMAGE_SIZE);
+			return FAILURE;
+		}
+		pAgent->pendingFields |= OTA_FIELD_SIZE;
+	} else if(JSON_STREAM_STRING == pEvent->type && 0 == strcmp("signature", pParamPath)) {
+		if(ATCA_SUCCESS != atcab_base64decode(pEvent->pValue, pEvent->valueLength, der, &derLength)
+		   || !readSignature(der, derLength, pImage->signature)) {
+			ESP_LOGE(TAG, "Invalid image signature");
+			return FAILURE;
+		}
+		pAgent->pendingFields |= OTA_FIELD_SIGNATURE;
+	} else if(JSON_STREAM_BOOL == pEvent->type && 0 == strcmp("delta", pParamPath)) {
+		pImage->isDelta = 't' == pEvent->pValue[0];
+	}
+
+	return SUCCESS;
+}
+
+static esp_err_t saveState(AWS_IoT_OTA_Agent *pAgent, bool withImage) {
+	nvs_handle_t handle;
+	esp_err_t err;
+
+	err = nvs_open(OTA_NVS_NAMESPACE, NVS_READWRITE, &handle);
+	if(ESP_OK != err) {
+		return err;
+	}
+	if(withImage) {
+		err = nvs_set_blob(handle, OTA_NVS_IMAGE_KEY, &pAgent->image, sizeof(AWS_IoT_OTA_Image));
+	}
+	if(ESP_OK == err) {
+		err = nvs_set_blob(handle, OTA_NVS_BITMAP_KEY, pAgent->bitmap, bitmapSize(&pAgent->image));
+	}
+	if(ESP_OK == err) {
+		err = nvs_commit(handle);
+	}
+	nvs_close(handle);
+
+	pAgent->savedBlocks = pAgent->download.receivedCount;
+	return err;
+}
+
+/* Compared field by field, the padding of the structure is not set */
+static bool isSameImage(const AWS_IoT_OTA_Image *pSaved, const AWS_IoT_OTA_Image *pImage) {
+	return 0 == strncmp(pSaved->streamName, pImage->streamName, sizeof(pSaved->streamName))
+		   && pSaved->fileId == pImage->fileId
+		   && pSaved->size == pImage->size
+		   && 0 == memcmp(pSaved->signature, pImage->signature, sizeof(pSaved->signature))
+		   && pSaved->isDelta == pImage->isDelta
+		   && pSaved->fileOffset == pImage->fileOffset
+		   && pSaved->partitionAddress == pImage->partitionAddress;
+}
+
+/* Restore the bitmap saved for the same image in the same partition */
+static bool restoreState(AWS_IoT_OTA_Agent *pAgent) {
+	AWS_IoT_OTA_Image saved;
+	nvs_handle_t handle;
+	size_t length = sizeof(saved);
+	bool isRestored = false;
+
+	if(ESP_OK != nvs_open(OTA_NVS_NAMESPACE, NVS_READONLY, &handle)) {
+		return false;
+	}
+	if(ESP_OK == nvs_get_blob(handle, OTA_NVS_IMAGE_KEY, &saved, &length) && sizeof(saved) == length
+	   && isSameImage(&saved, &pAgent->image)) {
+		length = bitmapSize(&pAgent->image);
+		isRestored = ESP_OK == nvs_get_blob(handle, OTA_NVS_BITMAP_KEY, pAgent->bitmap, &length)
+					 && bitmapSize(&pAgent->image) == length;
+	}
+	nvs_close(handle);
+
+	return isRestored;
+}
+
+static void forgetState(void) {
+	nvs_handle_t handle;
+
+	if(ESP_OK == nvs_open(OTA_NVS_NAMESPACE, NVS_READWRITE, &handle)) {
+		nvs_erase_all(handle);
+		nvs_commit(handle);
+		nvs_close(handle);
+	}
+}
+
+static IoT_Error_t writeBlock(void *pContext, uint32_t blockIndex, const uint8_t *pData, size_t length) {
+	AWS_IoT_OTA_Agent *pAgent = (AWS_IoT_OTA_Agent *) pContext;
+	esp_err_t err;
+
+	err = esp_partition_write(pAgent->pPartition, pAgent->image.fileOffset + blockIndex * AWS_IOT_OTA_BLOCK_SIZE,
+							  pData, length);
+	if(ESP_OK != err) {
+		ESP_LOGE(TAG, "Failed to write block %u: %s", (unsigned) blockIndex, esp_err_to_name(err));
+		return FAILURE;
+	}
+	return SUCCESS;
+}
+
+static uint32_t sectorRoundUp(uint32_t size) {
+	return (size + SPI_FLASH_SEC_SIZE - 1) / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE;
+}
+
+static bool hashPartition(const esp_partition_t *pPartition, uint32_t size, uint8_t *pDigest) {
+	mbedtls_sha256_context sha;
+	uint8_t chunk[OTA_READ_CHUNK_SIZE];
+	uint32_t offset;
+	size_t length;
+	int ret;
+
+	mbedtls_sha256_init(&sha);
+	ret = mbedtls_sha256_starts_ret(&sha, 0);
+	for(offset = 0; 0 == ret && offset < size; offset += length) {
+		length = size - offset;
+		if(length > sizeof(chunk)) {
+			length = sizeof(chunk);
+		}
+		ret = (ESP_OK == esp_partition_read(pPartition, offset, chunk, length))
+			  ? mbedtls_sha256_update_ret(&sha, chunk, length) : -1;
+	}
+	if(0 == ret) {
+		ret = mbedtls_sha256_finish_ret(&sha, pDigest);
+	}
+	mbedtls_sha256_free(&sha);
+	return 0 == ret;
+}
+
+static bool verifyImage(AWS_IoT_OTA_Agent *pAgent, uint32_t imageSize) {
+	uint8_t digest[32];
+	bool isVerified = false;
+	ATCA_STATUS status;
+
+	if(!hashPartition(pAgent->pPartition, imageSize, digest)) {
+		ESP_LOGE(TAG, "Failed to hash the image");
+		return false;
+	}
+
+	/* The nonce and verify commands of one check must not interleave with another task's commands */
+	status = atcab_session_begin();
+	if(ATCA_SUCCESS == status) {
+		if(NULL != pAgent->params.pSignerPublicKey) {
+			status = atcab_verify_extern(digest, pAgent->image.signature, pAgent->params.pSignerPublicKey, &isVerified);
+		} else {
+			status = atcab_verify_stored(digest, pAgent->image.signature, pAgent->params.signerKeySlot, &isVerified);
+		}
+		(void) atcab_session_end();
+	}
+	if(ATCA_SUCCESS != status) {
+		ESP_LOGE(TAG, "Signature check failed on the secure element: 0x%02x", status);
+		return false;
+	}
+	if(!isVerified) {
+		ESP_LOGE(TAG, "Image signature does not match");
+	}
+	return isVerified;
+}
+
+static IoT_Error_t readRunningImage(void *pContext, uint32_t offset, uint8_t *pBuffer, size_t length) {
+	AWS_IoT_OTA_Agent *pAgent = (AWS_IoT_OTA_Agent *) pContext;
+
+	return ESP_OK == esp_partition_read(pAgent->pRunningPartition, offset, pBuffer, length) ? SUCCESS : FAILURE;
+}
+
+static IoT_Error_t writeNewImage(void *pContext, uint32_t offset, const uint8_t *pData, size_t length) {
+	AWS_IoT_OTA_Agent *pAgent = (AWS_IoT_OTA_Agent *) pContext;
+
+	return ESP_OK == esp_partition_write(pAgent->pPartition, offset, pData, length) ? SUCCESS : FAILURE;
+}
+
+/* Rebuild the image from the running one and the downloaded patch, in front of the patch */
+static bool applyPatch(AWS_IoT_OTA_Agent *pAgent, uint32_t *pImageSize) {
+	DeltaPatchParams_t params;
+	DeltaPatchHeader_t header;
+	uint8_t chunk[OTA_READ_CHUNK_SIZE];
+	uint8_t digest[DELTA_PATCH_HASH_SIZE];
+	uint32_t offset;
+	size_t length;
+	IoT_Error_t rc;
+	esp_err_t err;
+
+	pAgent->pRunningPartition = esp_ota_get_running_partition();
+	err = esp_partition_read(pAgent->pPartition, pAgent->image.fileOffset, chunk, DELTA_PATCH_HEADER_SIZE);
+	if(ESP_OK != err || SUCCESS != aws_iot_delta_patch_read_header(chunk, DELTA_PATCH_HEADER_SIZE, &header)) {
+		ESP_LOGE(TAG, "The file is not a delta patch");
+		return false;
+	}
+	if(NULL == pAgent->pRunningPartition || header.windowBits > DELTA_PATCH_MAX_WINDOW_BITS
+	   || header.sourceSize > pAgent->pRunningPartition->size || header.targetSize > pAgent->image.fileOffset) {
+		ESP_LOGE(TAG, "Patch for a %u byte image with a %u byte window does not fit", (unsigned) header.targetSize,
+				 1u << header.windowBits);
+		return false;
+	}
+
+	/* A patch applied to another image would build garbage, only caught by the signature */
+	if(!hashPartition(pAgent->pRunningPartition, header.sourceSize, digest)
+	   || 0 != memcmp(digest, header.sourceHash, sizeof(digest))) {
+		ESP_LOGE(TAG, "The patch was not made for the running image");
+		return false;
+	}
+
+	err = esp_partition_erase_range(pAgent->pPartition, 0, sectorRoundUp(header.targetSize));
+	if(ESP_OK != err) {
+		ESP_LOGE(TAG, "Failed to erase the image range: %s", esp_err_to_name(err));
+		return false;
+	}
+
+	params.readSource = readRunningImage;
+	params.writeTarget = writeNewImage;
+	params.pContext = pAgent;
+	params.maxSourceSize = pAgent->pRunningPartition->size;
+	params.maxTargetSize = pAgent->image.fileOffset;
+	rc = aws_iot_delta_patch_init(&pAgent->patch, &params);
+	for(offset = 0; SUCCESS == rc && offset < pAgent->image.size && !isCanceled(pAgent); offset += length) {
+		length = pAgent->image.size - offset;
+		if(length > sizeof(chunk)) {
+			length = sizeof(chunk);
+		}
+		rc = (ESP_OK == esp_partition_read(pAgent->pPartition, pAgent->image.fileOffset + offset, chunk, length))
+			 ? aws_iot_delta_patch_feed(&pAgent->patch, chunk, length) : FAILURE;
+	}
+	if(SUCCESS == rc && !isCanceled(pAgent)) {
+		rc = aws_iot_delta_patch_finish(&pAgent->patch);
+	}
+	if(SUCCESS != rc || isCanceled(pAgent)) {
+		ESP_LOGE(TAG, "Failed to apply the patch: %d", rc);
+		return false;
+	}
+
+	ESP_LOGI(TAG, "Patch of %u bytes rebuilt an image of %u bytes", (unsigned) pAgent->image.size,
+			 (unsigned) header.targetSize);
+	*pImageSize = header.targetSize;
+	return true;
+}
+
+/* Runs in a jobs worker task */
+static JobsStepState_t otaRun(JobsStep_t *pStep) {
+	AWS_IoT_OTA_Agent *pAgent = (AWS_IoT_OTA_Agent *) pStep->pHandler->pContext;
+	const esp_partition_t *pPartition;
+	uint32_t imageSize;
+	uint32_t fileSpace;
+	esp_err_t err;
+
+	/* A patch takes whole sectors at the end of the partition */
+	pPartition = esp_ota_get_next_update_partition(NULL);
+	fileSpace = sectorRoundUp(pAgent->pending.size);
+	if(NULL == pPartition || fileSpace > pPartition->size / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE) {
+		ESP_LOGE(TAG, "No OTA partition for a file of %u bytes", (unsigned) pAgent->pending.size);
+		return JOBS_STEP_FAILED;
+	}
+
+	storePhase(pAgent, OTA_AGENT_PREPARING);
+	__atomic_store_n(&pAgent->isCanceled, false, __ATOMIC_RELEASE);
+	pAgent->image = pAgent->pending;
+	pAgent->image.partitionAddress = pPartition->address;
+	pAgent->image.fileOffset = pAgent->image.isDelta
+							   ? pPartition->size / SPI_FLASH_SEC_SIZE * SPI_FLASH_SEC_SIZE - fileSpace : 0;
+	pAgent->pPartition = pPartition;
+	pAgent->pStep = pStep;
+	pAgent->isDownloadComplete = false;
+	pAgent->progress = 0;
+
+	if(restoreState(pAgent)) {
+		ESP_LOGI(TAG, "Resuming the download of %s into %s", pAgent->image.streamName, pPartition->label);
+	} else {
+		ESP_LOGI(TAG, "Downloading %s into %s", pAgent->image.streamName, pPartition->label);
+		memset(pAgent->bitmap, 0, sizeof(pAgent->bitmap));
+		err = esp_partition_erase_range(pPartition, pAgent->image.fileOffset, sectorRoundUp(pAgent->image.size));
+		if(ESP_OK == err) {
+			err = saveState(pAgent, true);
+		}
+		if(ESP_OK != err) {
+			ESP_LOGE(TAG, "Failed to prepare the partition: %s", esp_err_to_name(err));
+			storePhase(pAgent, OTA_AGENT_IDLE);
+			return JOBS_STEP_FAILED;
+		}
+	}
+
+	xSemaphoreTake(pAgent->downloadEnded, 0);
+	storePhase(pAgent, OTA_AGENT_DOWNLOAD_PENDING);
+	xSemaphoreTake(pAgent->downloadEnded, portMAX_DELAY);
+
+	/* Kept in NVS, running the step again resumes the download */
+	if(!pAgent->isDownloadComplete || isCanceled(pAgent)) {
+		storePhase(pAgent, OTA_AGENT_IDLE);
+		return JOBS_STEP_FAILED;
+	}
+
+	imageSize = pAgent->image.size;
+	if((pAgent->image.isDelta && !applyPatch(pAgent, &imageSize)) || !verifyImage(pAgent, imageSize)
+	   || isCanceled(pAgent)) {
+		forgetState();
+		storePhase(pAgent, OTA_AGENT_IDLE);
+		return JOBS_STEP_FAILED;
+	}
+
+	/* Also checks the image header and the checksum of its segments */
+	err = esp_ota_set_boot_partition(pPartition);
+	forgetState();
+	if(ESP_OK != err) {
+		ESP_LOGE(TAG, "Image rejected by the bootloader checks: %s", esp_err_to_name(err));
+		storePhase(pAgent, OTA_AGENT_IDLE);
+		return JOBS_STEP_FAILED;
+	}
+
+	ESP_LOGI(TAG, "Image %s accepted, booting %s next", pAgent->image.streamName, pPartition->label);
+	storePhase(pAgent, pAgent->params.restartWhenDone ? OTA_AGENT_RESTART_PENDING : OTA_AGENT_IDLE);
+	return JOBS_STEP_SUCCEEDED;
+}
+
+/* Called in the task yielding the client when the step times out or its job ends */
+static void otaCancel(JobsStep_t *pStep) {
+	AWS_IoT_OTA_Agent *pAgent = (AWS_IoT_OTA_Agent *) pStep->pHandler->pContext;
+
+	__atomic_store_n(&pAgent->isCanceled, true, __ATOMIC_RELEASE);
+}
+
+static void endDownload(AWS_IoT_OTA_Agent *pAgent, bool isComplete) {
+	pAgent->isDownloadComplete = isComplete;
+	storePhase(pAgent, OTA_AGENT_VERIFYING);
+	xSemaphoreGive(pAgent->downloadEnded);
+}
+
+static void startDownload(AWS_IoT_OTA_Agent *pAgent) {
+	StreamDownloadParams_t params = streamDownloadParamsDefault;
+	IoT_Error_t rc;
+
+	params.pThingName = pAgent->pExecutor->thingName;
+	params.pStreamName = pAgent->image.streamName;
+	params.fileId = pAgent->image.fileId;
+	params.fileSize = pAgent->image.size;
+	params.blockSize = AWS_IOT_OTA_BLOCK_SIZE;
+	params.blocksPerRequest = AWS_IOT_OTA_BLOCKS_PER_REQUEST;
+	params.requestsInFlight = AWS_IOT_OTA_REQUESTS_IN_FLIGHT;
+	params.requestTimeoutMs = pAgent->params.requestTimeoutMs;
+	params.pBitmap = pAgent->bitmap;
+	params.write = writeBlock;
+	params.pWriteContext = pAgent;
+
+	rc = aws_iot_stream_download_init(&pAgent->download, pAgent->pExecutor->pClient, &params);
+	if(SUCCESS == rc) {
+		rc = aws_iot_stream_download_start(&pAgent->download);
+	}
+	if(SUCCESS != rc) {
+		ESP_LOGE(TAG, "Failed to start the download: %d", rc);
+		endDownload(pAgent, false);
+		return;
+	}
+
+	pAgent->savedBlocks = pAgent->download.receivedCount;
+	storePhase(pAgent, OTA_AGENT_DOWNLOADING);
+}
+
+static void continueDownload(AWS_IoT_OTA_Agent *pAgent) {
+	StreamDownload_t *pDownload = &pAgent->download;
+	StreamDownloadState_t state;
+	uint8_t progress;
+
+	state = isCanceled(pAgent) ? STREAM_DOWNLOAD_FAILED : aws_iot_stream_download_process(pDownload);
+
+	if(pDownload->receivedCount - pAgent->savedBlocks >= AWS_IOT_OTA_SAVE_INTERVAL_BLOCKS
+	   || (STREAM_DOWNLOAD_RUNNING != state && pDownload->receivedCount != pAgent->savedBlocks)) {
+		if(ESP_OK != saveState(pAgent, false)) {
+			ESP_LOGW(TAG, "Failed to save the download state");
+		}
+	}
+
+	progress = (uint8_t) ((uint64_t) pDownload->receivedCount * 100 / pDownload->blockCount);
+	if(progress != pAgent->progress) {
+		pAgent->progress = progress;
+		aws_iot_jobs_executor_step_progress(pAgent->pStep, progress);
+	}
+
+	if(STREAM_DOWNLOAD_RUNNING != state) {
+		ESP_LOGI(TAG, "Download ended after %u requests, %u duplicate blocks", (unsigned) pDownload->requestsSent,
+				 (unsigned) pDownload->duplicateBlocks);
+		aws_iot_stream_download_stop(pDownload);
+		endDownload(pAgent, STREAM_DOWNLOAD_COMPLETE == state);
+	}
+}
+
+IoT_Error_t aws_iot_ota_agent_init(AWS_IoT_OTA_Agent *pAgent, JobsExecutor_t *pExecutor,
+								   const AWS_IoT_OTA_Agent_Params *pParams) {
+	IoT_Error_t rc;
+
+	if(NULL == pAgent || NULL == pExecutor) {
+		return NULL_VALUE_ERROR;
+	}
+
+	memset(pAgent, 0, sizeof(AWS_IoT_OTA_Agent));
+	pAgent->params = (NULL != pParams) ? *pParams : otaAgentParamsDefault;
+	pAgent->pExecutor = pExecutor;
+	pAgent->downloadEnded = xSemaphoreCreateBinary();
+	if(NULL == pAgent->downloadEnded) {
+		ESP_LOGE(TAG, "Failed to create the OTA agent semaphore");
+		return FAILURE;
+	}
+
+	pAgent->handler.pName = "ota";
+	pAgent->handler.runInWorker = true;
+	pAgent->handler.param = otaParam;
+	pAgent->handler.run = otaRun;
+	pAgent->handler.cancel = otaCancel;
+	pAgent->handler.pContext = pAgent;
+	rc = aws_iot_jobs_executor_register_handler(pExecutor, &pAgent->handler);
+	if(SUCCESS != rc) {
+		vSemaphoreDelete(pAgent->downloadEnded);
+		pAgent->downloadEnded = NULL;
+	}
+	return rc;
+}
+
+void aws_iot_ota_agent_process(AWS_IoT_OTA_Agent *pAgent) {
+	if(NULL == pAgent) {
+		return;
+	}
+
+	switch(loadPhase(pAgent)) {
+		case OTA_AGENT_DOWNLOAD_PENDING:
+			startDownload(pAgent);
+			break;
+		case OTA_AGENT_DOWNLOADING:
+			continueDownload(pAgent);
+			break;
+		case OTA_AGENT_RESTART_PENDING:
+			/* The step returned before its job ended, so the outcome has been reported once the executor
+			 * moved on */
+			if(JOBS_EXECUTOR_RUNNING != pAgent->pExecutor->state
+			   && JOBS_EXECUTOR_FINISHING != pAgent->pExecutor->state
+			   && JOBS_EXECUTOR_CANCELING != pAgent->pExecutor->state) {
+				ESP_LOGI(TAG, "Restarting into the new image");
+				esp_restart();
+			}
+			break;
+		default:
+			break;
+	}
+}
+
+bool aws_iot_ota_agent_is_downloading(AWS_IoT_OTA_Agent *pAgent) {
+	return NULL != pAgent && OTA_AGENT_DOWNLOADING == loadPhase(pAgent);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* CONFIG_AWS_IOT_OTA_AGENT */
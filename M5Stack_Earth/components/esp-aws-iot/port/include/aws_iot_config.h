@@ -40,6 +40,7 @@
 #define AWS_IOT_MQTT_TX_BUF_LEN CONFIG_AWS_IOT_MQTT_TX_BUF_LEN ///< Any time a message is sent out through the MQTT layer. The message is copied into this buffer anytime a publish is done. This will also be used in the case of Thing Shadow
 #define AWS_IOT_MQTT_RX_BUF_LEN CONFIG_AWS_IOT_MQTT_RX_BUF_LEN ///< Any message that comes into the device should be less than this buffer size. If a received message is bigger than this buffer size the message will be dropped.
 #define AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS CONFIG_AWS_IOT_MQTT_NUM_SUBSCRIBE_HANDLERS ///< Maximum number of topic filters the MQTT client can handle at any given time. This should be increased appropriately when using Thing Shadow
+#define AWS_IOT_MQTT_NUM_UNACKED_PUBLISHES CONFIG_AWS_IOT_MQTT_NUM_UNACKED_PUBLISHES ///< Number of unacknowledged QoS1 publishes kept for redelivery when a persistent session is resumed
 
 // Thing Shadow specific configs
 #ifdef CONFIG_AWS_IOT_OVERRIDE_THING_SHADOW_RX_BUFFER
@@ -57,14 +58,38 @@
 #define MAX_SHADOW_TOPIC_LENGTH_WITHOUT_THINGNAME CONFIG_AWS_IOT_SHADOW_MAX_SHADOW_TOPIC_LENGTH_WITHOUT_THINGNAME ///< All shadow actions have to be published or subscribed to a topic which is of the formablogt $aws/things/{thingName}/shadow/update/accepted. This refers to the size of the topic without the Thing Name
 #define MAX_SIZE_OF_THING_NAME CONFIG_AWS_IOT_SHADOW_MAX_SIZE_OF_THING_NAME ///< The Thing Name should not be bigger than this value. Modify this if the Thing Name needs to be bigger
 #define MAX_SHADOW_TOPIC_LENGTH_BYTES (MAX_SHADOW_TOPIC_LENGTH_WITHOUT_THINGNAME + MAX_SIZE_OF_THING_NAME) ///< This size includes the length of topic with Thing Name
+#define MAX_SIZE_OF_SHADOW_NAME CONFIG_AWS_IOT_SHADOW_MAX_SIZE_OF_SHADOW_NAME ///< Size of the buffer holding a named shadow's name in a shadow manager, including the NULL terminating byte
+#define MAX_SHADOW_CONTEXT_DELTA_KEYS CONFIG_AWS_IOT_SHADOW_MANAGER_MAX_DELTA_KEYS ///< Delta keys that can be registered on one shadow synced with a shadow manager
+
+// Jobs executor
+#define JOBS_EXECUTOR_MAX_STEPS CONFIG_AWS_IOT_JOBS_MAX_STEPS ///< Steps a job document run by a jobs executor can have
+#define JOBS_EXECUTOR_STEP_DATA_SIZE CONFIG_AWS_IOT_JOBS_STEP_DATA_SIZE ///< Bytes of parameter storage of each job step
+#define AWS_IOT_JOBS_WORKER_TASKS CONFIG_AWS_IOT_JOBS_WORKER_TASKS ///< Maximum number of jobs worker tasks
+
+// OTA agent
+#ifdef CONFIG_AWS_IOT_OTA_AGENT
+#define AWS_IOT_OTA_BLOCK_SIZE CONFIG_AWS_IOT_OTA_BLOCK_SIZE ///< Bytes per block of the stream
+#define AWS_IOT_OTA_BLOCKS_PER_REQUEST CONFIG_AWS_IOT_OTA_BLOCKS_PER_REQUEST ///< Blocks asked for in one request
+#define AWS_IOT_OTA_REQUESTS_IN_FLIGHT CONFIG_AWS_IOT_OTA_REQUESTS_IN_FLIGHT ///< Block requests sent before waiting
+#define AWS_IOT_OTA_MAX_IMAGE_SIZE CONFIG_AWS_IOT_OTA_MAX_IMAGE_SIZE ///< Largest image the bitmap of received blocks covers
+#define AWS_IOT_OTA_SAVE_INTERVAL_BLOCKS CONFIG_AWS_IOT_OTA_SAVE_INTERVAL_BLOCKS ///< New blocks between saves of the bitmap
+#define AWS_IOT_OTA_SIGNER_KEY_SLOT CONFIG_AWS_IOT_OTA_SIGNER_KEY_SLOT ///< Slot of the code signing public key
+#define DELTA_PATCH_MAX_WINDOW_BITS CONFIG_AWS_IOT_OTA_DELTA_WINDOW_BITS ///< Largest compression window of delta patches
+#if AWS_IOT_MQTT_RX_BUF_LEN < (4 * ((AWS_IOT_OTA_BLOCK_SIZE + 2) / 3) + 200)
+#error "CONFIG_AWS_IOT_MQTT_RX_BUF_LEN cannot hold a base64 encoded OTA block, raise it or lower CONFIG_AWS_IOT_OTA_BLOCK_SIZE"
+#endif
+#endif
 
 // Auto Reconnect specific config
-#define AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL CONFIG_AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL ///< Minimum time before the First reconnect attempt is made as part of the exponential back-off algorithm
-#define AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL CONFIG_AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL ///< Maximum time interval after which exponential back-off will stop attempting to reconnect.
+#define AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL CONFIG_AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL ///< Base interval of the jittered reconnect back-off. The first reconnect attempt is made within this interval
+#define AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL CONFIG_AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL ///< Maximum time between reconnect attempts
 
 // TLS configs
 #define IOT_SSL_READ_TIMEOUT_MS 3 ///< Timeout associated with underlying socket of TLS connection (set by mbedtls_ssl_conf_read_timeout)
 #define IOT_SSL_READ_RETRY_TIMEOUT_MS 10 ///< Minimum elapsed time before returning from iot_tls_read when pending data has not yet been received
 #define IOT_SSL_WRITE_RETRY_TIMEOUT_MS 10 ///< Minimum elapsed time before returning from iot_tls_write when pending data has not yet been written
 
+// MQTT I/O task
+#define AWS_IOT_MQTT_IO_QUEUE_LEN CONFIG_AWS_IOT_MQTT_IO_QUEUE_LEN ///< Number of requests that can be queued for the MQTT I/O task. Must be a power of two
+
 #endif /* _AWS_IOT_CONFIG_H_ */
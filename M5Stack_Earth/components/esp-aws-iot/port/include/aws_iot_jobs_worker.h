@@ -0,0 +1,106 @@
+/*
+ * Copyright 2010-2015 Amazon.com, Inc. or its affiliates. All Rights Reserved.
+ * Additions Copyright 2016 Espressif Systems (Shanghai) PTE LTD
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License").
+ * You may not use this file except in compliance with the License.
+ * A copy of the License is located at
+ *
+ *  http://aws.amazon.com/apache2.0
+ *
+ * or in the "license" file accompanying this file. This file is distributed
+ * on an "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ * express or implied. See the License for the specific language governing
+ * permissions and limitations under the License.
+ */
+
+/**
+ * @file aws_iot_jobs_worker.h
+ * @brief Worker tasks running the long steps of a jobs executor
+ *
+ * Pass aws_iot_jobs_worker_dispatch and the worker as dispatch function and context in the
+ * JobsExecutorParams_t. Steps of handlers with runInWorker set are then queued for these tasks,
+ * and the steps of one parallel group run at the same time when there are enough tasks.
+ */
+
+#ifndef AWS_IOT_JOBS_WORKER_H_
+#define AWS_IOT_JOBS_WORKER_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+
+#include "aws_iot_config.h"
+#include "aws_iot_jobs_executor.h"
+
+#ifndef AWS_IOT_JOBS_WORKER_TASKS
+#define AWS_IOT_JOBS_WORKER_TASKS 2
+#endif
+
+/**
+ * @brief Worker start parameters
+ */
+typedef struct {
+	uint8_t taskCount;          ///< Tasks running steps, at most AWS_IOT_JOBS_WORKER_TASKS
+	uint32_t stackSize;         ///< Stack size of each task in bytes. Handler run functions execute on this stack
+	UBaseType_t priority;       ///< Priority of the tasks, usually below the task yielding the MQTT client
+	BaseType_t coreId;          ///< Core to pin the tasks to, or tskNO_AFFINITY
+} AWS_IoT_Jobs_Worker_Params;
+
+extern const AWS_IoT_Jobs_Worker_Params jobsWorkerParamsDefault;
+
+#define jobsWorkerParamsDefault_initializer {AWS_IOT_JOBS_WORKER_TASKS, 6144, 4, tskNO_AFFINITY}
+
+/**
+ * @brief Worker context
+ *
+ * Allocated by the application. Must not be moved or freed while the tasks are running.
+ */
+typedef struct {
+	AWS_IoT_Jobs_Worker_Params params;
+	QueueHandle_t queue;        ///< Steps waiting for a task, NULL marks a task to exit
+	TaskHandle_t tasks[AWS_IOT_JOBS_WORKER_TASKS];
+	TaskHandle_t stopRequester;
+} AWS_IoT_Jobs_Worker;
+
+/**
+ * @brief Create the queue and the worker tasks
+ *
+ * @param pWorker Worker context
+ * @param pParams Task parameters, NULL for defaults
+ *
+ * @return SUCCESS, NULL_VALUE_ERROR or FAILURE if the queue or a task could not be created
+ */
+IoT_Error_t aws_iot_jobs_worker_start(AWS_IoT_Jobs_Worker *pWorker, const AWS_IoT_Jobs_Worker_Params *pParams);
+
+/**
+ * @brief Stop the worker tasks
+ *
+ * Blocks until every task has returned from the step it is running. The executor should be idle
+ * or stopped being yielded, so no more steps are dispatched.
+ *
+ * @param pWorker Worker context
+ *
+ * @return SUCCESS or NULL_VALUE_ERROR
+ */
+IoT_Error_t aws_iot_jobs_worker_stop(AWS_IoT_Jobs_Worker *pWorker);
+
+/**
+ * @brief Queue a step, a JobsWorkerDispatch_t
+ *
+ * @param pStep Step to run
+ * @param pContext The AWS_IoT_Jobs_Worker
+ *
+ * @return SUCCESS if queued, NULL_VALUE_ERROR or LIMIT_EXCEEDED_ERROR if the queue is full
+ */
+IoT_Error_t aws_iot_jobs_worker_dispatch(JobsStep_t *pStep, void *pContext);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* AWS_IOT_JOBS_WORKER_H_ */
@@ -78,6 +78,11 @@ void init_timer(Timer *timer) {
     timer->last_polled_ticks = 0;
 }
 
+void delay(unsigned milliseconds) {
+    /* Round up so that a timer polled afterwards has expired */
+    vTaskDelay((milliseconds + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -331,6 +331,61 @@ ATCA_STATUS atcab_sleep(void)
     return status;
 }
 
+/** \brief Hold the CryptoAuth device for the calling task until the
+ *         matching atcab_session_end(), see calib_session_begin()
+ *  \return ATCA_SUCCESS on success, otherwise an error code.
+ */
+ATCA_STATUS atcab_session_begin(void)
+{
+    ATCA_STATUS status = ATCA_UNIMPLEMENTED;
+    ATCADeviceType dev_type = atcab_get_device_type();
+
+    if (atcab_is_ca_device(dev_type))
+    {
+#if ATCA_CA_SUPPORT
+        status = calib_session_begin(_gDevice);
+#endif
+    }
+    else if (atcab_is_ta_device(dev_type))
+    {
+#if ATCA_TA_SUPPORT
+        status = ATCA_SUCCESS;
+#endif
+    }
+    else
+    {
+        status = ATCA_NOT_INITIALIZED;
+    }
+    return status;
+}
+
+/** \brief End a session started with atcab_session_begin()
+ *  \return ATCA_SUCCESS on success, otherwise an error code.
+ */
+ATCA_STATUS atcab_session_end(void)
+{
+    ATCA_STATUS status = ATCA_UNIMPLEMENTED;
+    ATCADeviceType dev_type = atcab_get_device_type();
+
+    if (atcab_is_ca_device(dev_type))
+    {
+#if ATCA_CA_SUPPORT
+        status = calib_session_end(_gDevice);
+#endif
+    }
+    else if (atcab_is_ta_device(dev_type))
+    {
+#if ATCA_TA_SUPPORT
+        status = ATCA_SUCCESS;
+#endif
+    }
+    else
+    {
+        status = ATCA_NOT_INITIALIZED;
+    }
+    return status;
+}
+
 /** \brief Gets the size of the specified zone in bytes.
  *
  * \param[in]  zone  Zone to get size information from. Config(0), OTP(1), or
@@ -113,6 +113,8 @@ ATCA_STATUS atcab_pbkdf2_sha256(const uint32_t iter, const uint16_t slot, const
 #define atcab_wakeup()                          calib_wakeup(_gDevice)
 #define atcab_idle()                            calib_idle(_gDevice)
 #define atcab_sleep()                           calib_sleep(_gDevice)
+#define atcab_session_begin()                   calib_session_begin(_gDevice)
+#define atcab_session_end()                     calib_session_end(_gDevice)
 #define _atcab_exit(...)                         _calib_exit(_gDevice, __VA_ARGS__)
 #define atcab_get_zone_size(...)                calib_get_zone_size(_gDevice, __VA_ARGS__)
 
@@ -278,6 +280,8 @@ ATCA_STATUS atcab_pbkdf2_sha256(const uint32_t iter, const uint16_t slot, const
 #define atcab_wakeup(...)                       (0)
 #define atcab_idle(...)                         (0)
 #define atcab_sleep(...)                        (0)
+#define atcab_session_begin(...)                (0)
+#define atcab_session_end(...)                  (0)
 #define _atcab_exit(...)                        (1)
 #define atcab_get_zone_size(...)                talib_get_zone_size(_gDevice, __VA_ARGS__)
 //#define atcab_get_addr(...)                     (1)
@@ -448,6 +452,8 @@ ATCA_STATUS _atcab_exit(void);
 ATCA_STATUS atcab_wakeup(void);
 ATCA_STATUS atcab_idle(void);
 ATCA_STATUS atcab_sleep(void);
+ATCA_STATUS atcab_session_begin(void);
+ATCA_STATUS atcab_session_end(void);
 //ATCA_STATUS atcab_get_addr(uint8_t zone, uint16_t slot, uint8_t block, uint8_t offset, uint16_t* addr);
 ATCA_STATUS atcab_get_zone_size(uint8_t zone, uint16_t slot, size_t* size);
 
@@ -141,6 +141,19 @@ typedef enum
 } ATCADeviceState;
 
 
+#ifdef ATCA_COMMAND_PIPELINING
+#ifndef ATCA_LATENCY_TABLE_SIZE
+#define ATCA_LATENCY_TABLE_SIZE 16
+#endif
+
+/** \brief Measured execution time of an opcode */
+typedef struct
+{
+    uint8_t  opcode;                    /**< Opcode, 0 for an unused entry */
+    uint32_t latency_us;                /**< Moving average of the execution time */
+} atca_cmd_latency_t;
+#endif
+
 /** \brief atca_device is the C object backing ATCADevice.  See the atca_device.h file for
  * details on the ATCADevice methods
  */
@@ -160,6 +173,12 @@ struct atca_device
 
     uint16_t options;                   /**< Nested command details parameter */
 
+#ifdef ATCA_COMMAND_PIPELINING
+    uint8_t            awake_count;     /**< Nested sessions keeping the device awake */
+    uint32_t           wake_time_us;    /**< When the device was last woken */
+    atca_cmd_latency_t latency[ATCA_LATENCY_TABLE_SIZE]; /**< Per-opcode execution times */
+#endif
+
 };
 
 typedef struct atca_device * ATCADevice;
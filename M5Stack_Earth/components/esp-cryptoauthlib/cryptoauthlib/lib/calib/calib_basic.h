@@ -18,6 +18,8 @@ extern "C" {
 ATCA_STATUS calib_wakeup(ATCADevice device);
 ATCA_STATUS calib_idle(ATCADevice device);
 ATCA_STATUS calib_sleep(ATCADevice device);
+ATCA_STATUS calib_session_begin(ATCADevice device);
+ATCA_STATUS calib_session_end(ATCADevice device);
 ATCA_STATUS _calib_exit(ATCADevice device);
 ATCA_STATUS calib_get_addr(uint8_t zone, uint16_t slot, uint8_t block, uint8_t offset, uint16_t* addr);
 ATCA_STATUS calib_get_zone_size(ATCADevice device, uint8_t zone, uint16_t slot, size_t* size);
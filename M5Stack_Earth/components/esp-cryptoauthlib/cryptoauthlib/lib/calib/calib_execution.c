@@ -418,17 +418,94 @@ ATCA_STATUS calib_execute_receive(ATCADevice device, uint8_t device_address, uin
     return status;
 }
 
-/** \brief Wakes up device, sends the packet, waits for command completion,
- *         receives response, and puts the device into the idle state.
- *
- * \param[in,out] packet  As input, the packet to be sent. As output, the
- *                       data buffer in the packet structure will contain the
- *                       response.
- * \param[in]    device  CryptoAuthentication device to send the command to.
- *
- * \return ATCA_SUCCESS on success, otherwise an error code.
+#ifdef ATCA_COMMAND_PIPELINING
+/** \brief Find the latency entry of an opcode, optionally claiming a free one.
+ *  \return the entry, or NULL if the opcode is not tracked
  */
-ATCA_STATUS calib_execute_command(ATCAPacket* packet, ATCADevice device)
+static atca_cmd_latency_t* calib_latency_entry(ATCADevice device, uint8_t opcode, bool create)
+{
+    uint8_t i;
+
+    for (i = 0; i < ATCA_LATENCY_TABLE_SIZE; i++)
+    {
+        if (opcode == device->latency[i].opcode)
+        {
+            return &device->latency[i];
+        }
+        if (0u == device->latency[i].opcode)
+        {
+            if (create)
+            {
+                device->latency[i].opcode = opcode;
+                device->latency[i].latency_us = 0;
+                return &device->latency[i];
+            }
+            break;
+        }
+    }
+    return NULL;
+}
+
+/** \brief Fold a measured execution time into the moving average (1/4 weight)
+ *         of its opcode.
+ */
+static void calib_latency_update(ATCADevice device, uint8_t opcode, uint32_t sample_us)
+{
+    atca_cmd_latency_t* entry = calib_latency_entry(device, opcode, true);
+
+    if (NULL == entry)
+    {
+        return;
+    }
+    if (0u == entry->latency_us)
+    {
+        entry->latency_us = sample_us;
+    }
+    else if (sample_us > entry->latency_us)
+    {
+        entry->latency_us += (sample_us - entry->latency_us) / 4u;
+    }
+    else
+    {
+        entry->latency_us -= (entry->latency_us - sample_us) / 4u;
+    }
+}
+
+/** \brief Get the measured execution time of an opcode.
+ *  \param[in]  device      Device context pointer
+ *  \param[in]  opcode      Command opcode
+ *  \param[out] latency_us  Moving average of the execution time, 0 if the
+ *                          opcode has not completed yet.
+ *  \return ATCA_SUCCESS on success, otherwise an error code.
+ */
+ATCA_STATUS calib_get_command_latency(ATCADevice device, uint8_t opcode, uint32_t* latency_us)
+{
+    atca_cmd_latency_t* entry;
+
+    if ((NULL == device) || (NULL == latency_us))
+    {
+        return ATCA_TRACE(ATCA_BAD_PARAM, "NULL pointer encountered");
+    }
+
+    entry = calib_latency_entry(device, opcode, false);
+    *latency_us = entry ? entry->latency_us : 0u;
+    return ATCA_SUCCESS;
+}
+
+/** \brief Whether an awake device may hit its watchdog before the command
+ *         completes, in which case it is idled and woken again first.
+ */
+static bool calib_watchdog_due(ATCADevice device, uint8_t opcode)
+{
+    atca_cmd_latency_t* entry = calib_latency_entry(device, opcode, false);
+    uint32_t expected_us = entry ? entry->latency_us : 0u;
+    uint32_t awake_us = hal_get_time_us() - device->wake_time_us;
+
+    return (awake_us + expected_us) > (ATCA_WATCHDOG_BUDGET_MSEC * 1000UL);
+}
+#endif
+
+static ATCA_STATUS _calib_execute_command(ATCAPacket* packet, ATCADevice device)
 {
     ATCA_STATUS status;
     uint32_t execution_or_wait_time;
@@ -436,6 +513,11 @@ ATCA_STATUS calib_execute_command(ATCAPacket* packet, ATCADevice device)
     uint16_t rxsize;
     uint8_t device_address = atcab_get_device_address(device);
     int retries = 1;
+#ifdef ATCA_COMMAND_PIPELINING
+    uint32_t polling_time = ATCA_POLLING_FREQUENCY_TIME_MSEC;
+    uint32_t sent_time_us = 0;
+    atca_cmd_latency_t* latency = calib_latency_entry(device, packet->opcode, false);
+#endif
 
     do
     {
@@ -448,16 +530,43 @@ ATCA_STATUS calib_execute_command(ATCAPacket* packet, ATCADevice device)
         max_delay_count = 0;
 #else
         execution_or_wait_time = ATCA_POLLING_INIT_TIME_MSEC;
+#ifdef ATCA_COMMAND_PIPELINING
+        if (latency && latency->latency_us)
+        {
+            /* Sleep through most of the known execution time, then poll finely */
+            polling_time = ATCA_ADAPTIVE_POLLING_FREQUENCY_TIME_MSEC;
+            if (((latency->latency_us / 8u) * 7u) / 1000u > execution_or_wait_time)
+            {
+                execution_or_wait_time = ((latency->latency_us / 8u) * 7u) / 1000u;
+            }
+        }
+        max_delay_count = ATCA_POLLING_MAX_TIME_MSEC / polling_time;
+#else
         max_delay_count = ATCA_POLLING_MAX_TIME_MSEC / ATCA_POLLING_FREQUENCY_TIME_MSEC;
+#endif
 #endif
         retries = atca_iface_get_retries(&device->mIface);
         do
         {
+#ifdef ATCA_COMMAND_PIPELINING
+            bool kept_awake = false;
+
+            if ((ATCA_DEVICE_STATE_ACTIVE == device->device_state) && calib_watchdog_due(device, packet->opcode))
+            {
+                /* Idle rather than sleep so TempKey survives for the next command */
+                (void)calib_idle(device);
+                device->device_state = ATCA_DEVICE_STATE_IDLE;
+            }
+            kept_awake = (ATCA_DEVICE_STATE_ACTIVE == device->device_state);
+#endif
             if (ATCA_DEVICE_STATE_ACTIVE != device->device_state)
             {
                 if (ATCA_SUCCESS == (status = calib_wakeup(device)))
                 {
                     device->device_state = ATCA_DEVICE_STATE_ACTIVE;
+#ifdef ATCA_COMMAND_PIPELINING
+                    device->wake_time_us = hal_get_time_us();
+#endif
                 }
             }
 
@@ -470,7 +579,15 @@ ATCA_STATUS calib_execute_command(ATCAPacket* packet, ATCADevice device)
             {
                 packet->_reserved = CALIB_SWI_FLAG_CMD;
             }
-            if (ATCA_RX_NO_RESPONSE == (status = calib_execute_send(device, device_address, (uint8_t*)packet, packet->txsize + 1)))
+            status = calib_execute_send(device, device_address, (uint8_t*)packet, packet->txsize + 1);
+#ifdef ATCA_COMMAND_PIPELINING
+            /* A device left awake may still have fallen asleep; wake it and retry */
+            if (kept_awake && (ATCA_COMM_FAIL == status))
+            {
+                status = ATCA_RX_NO_RESPONSE;
+            }
+#endif
+            if (ATCA_RX_NO_RESPONSE == status)
             {
                 device->device_state = ATCA_DEVICE_STATE_UNKNOWN;
             }
@@ -487,6 +604,9 @@ ATCA_STATUS calib_execute_command(ATCAPacket* packet, ATCADevice device)
             break;
         }
 
+#ifdef ATCA_COMMAND_PIPELINING
+        sent_time_us = hal_get_time_us();
+#endif
         // Delay for execution time or initial wait before polling
         atca_delay_ms(execution_or_wait_time);
 
@@ -498,12 +618,19 @@ ATCA_STATUS calib_execute_command(ATCAPacket* packet, ATCADevice device)
 
             if (ATCA_SUCCESS == (status = calib_execute_receive(device, device_address, packet->data, &rxsize)))
             {
+#ifdef ATCA_COMMAND_PIPELINING
+                calib_latency_update(device, packet->opcode, hal_get_time_us() - sent_time_us);
+#endif
                 break;
             }
 
 #ifndef ATCA_NO_POLL
             // delay for polling frequency time
+#ifdef ATCA_COMMAND_PIPELINING
+            atca_delay_ms(polling_time);
+#else
             atca_delay_ms(ATCA_POLLING_FREQUENCY_TIME_MSEC);
+#endif
 #endif
         }
         while (max_delay_count-- > 0);
@@ -539,6 +666,14 @@ ATCA_STATUS calib_execute_command(ATCAPacket* packet, ATCADevice device)
     }
     while (0);
 
+#ifdef ATCA_COMMAND_PIPELINING
+    // Stay awake for the next command of the session, failures resync through idle
+    if ((device->awake_count > 0u) && (ATCA_SUCCESS == status))
+    {
+        return status;
+    }
+#endif
+
     // Skip Idle for ECC204 device
     if (ECC204 != device->mIface.mIfaceCFG->devtype)
     {
@@ -548,3 +683,31 @@ ATCA_STATUS calib_execute_command(ATCAPacket* packet, ATCADevice device)
 
     return status;
 }
+
+/** \brief Wakes up device, sends the packet, waits for command completion,
+ *         receives response, and puts the device into the idle state.
+ *
+ * Within a session (calib_session_begin()) the device is left awake for the
+ * next command instead of being idled. With ATCA_COMMAND_PIPELINING the
+ * initial wait is sized from the measured execution time of the opcode.
+ *
+ * \param[in,out] packet  As input, the packet to be sent. As output, the
+ *                       data buffer in the packet structure will contain the
+ *                       response.
+ * \param[in]    device  CryptoAuthentication device to send the command to.
+ *
+ * \return ATCA_SUCCESS on success, otherwise an error code.
+ */
+ATCA_STATUS calib_execute_command(ATCAPacket* packet, ATCADevice device)
+{
+    ATCA_STATUS status;
+
+    /* Keep other tasks from interleaving their commands with this one */
+    if ((status = hal_iface_lock(&device->mIface)) != ATCA_SUCCESS)
+    {
+        return status;
+    }
+    status = _calib_execute_command(packet, device);
+    hal_iface_unlock(&device->mIface);
+    return status;
+}
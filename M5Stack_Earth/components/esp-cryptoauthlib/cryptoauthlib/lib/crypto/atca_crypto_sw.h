@@ -42,6 +42,26 @@ extern "C" {
 #define ATCA_SHA2_256_DIGEST_SIZE   (32)
 #define ATCA_SHA2_256_BLOCK_SIZE    (64)
 
+#ifdef ATCA_CRYPTO_SW_BACKENDS
+#if defined(ATCA_OPENSSL) || defined(ATCA_WOLFSSL)
+#error "ATCA_CRYPTO_SW_BACKENDS supports the mbedTLS and portable builds only"
+#endif
+
+struct atcac_sw_backend_s;
+
+/** \brief Hash context when hashes are routed through the backend table
+ *         (atca_crypto_sw_backend.h). The state is large enough for every
+ *         backend in the table. */
+typedef struct
+{
+    const struct atcac_sw_backend_s* backend; //!< Backend the hash was started with
+    uint32_t                         state[48];
+} atcac_sw_hash_ctx;
+
+typedef atcac_sw_hash_ctx atcac_sha1_ctx;
+typedef atcac_sw_hash_ctx atcac_sha2_256_ctx;
+#endif
+
 #if defined(ATCA_MBEDTLS)
 #if !defined(MBEDTLS_CONFIG_FILE)
 #include "mbedtls/config.h"
@@ -59,8 +79,10 @@ extern "C" {
 typedef mbedtls_cipher_context_t atcac_aes_cmac_ctx;
 typedef mbedtls_md_context_t atcac_hmac_sha256_ctx;
 typedef mbedtls_cipher_context_t atcac_aes_gcm_ctx;
+#ifndef ATCA_CRYPTO_SW_BACKENDS
 typedef mbedtls_md_context_t atcac_sha1_ctx;
 typedef mbedtls_md_context_t atcac_sha2_256_ctx;
+#endif
 typedef mbedtls_pk_context atcac_pk_ctx;
 
 #elif defined(ATCA_OPENSSL)
@@ -123,6 +145,7 @@ typedef atca_wc_ctx atcac_pk_ctx;
 #define ATCA_ENABLE_RAND_IMPL       1
 #endif
 
+#ifndef ATCA_CRYPTO_SW_BACKENDS
 typedef struct
 {
     uint32_t pad[32]; //!< Filler value to make sure the actual implementation has enough room to store its context. uint32_t is used to remove some alignment warnings.
@@ -132,6 +155,7 @@ typedef struct
 {
     uint32_t pad[48]; //!< Filler value to make sure the actual implementation has enough room to store its context. uint32_t is used to remove some alignment warnings.
 } atcac_sha2_256_ctx;
+#endif
 
 typedef struct
 {
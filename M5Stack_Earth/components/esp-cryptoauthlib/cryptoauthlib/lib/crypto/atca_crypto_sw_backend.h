@@ -0,0 +1,65 @@
+/**
+ * \file
+ * \brief Table of implementations behind the software SHA-1 and SHA-256
+ *        routines (atcac_sw_sha1_*, atcac_sw_sha2_256_*).
+ *
+ * With ATCA_CRYPTO_SW_BACKENDS defined, every software hash in the library
+ * (host side digests, atcacert digests, HMAC over the portable routines)
+ * goes through the backend selected with atcac_sw_backend_set(). The
+ * portable C routines are always available. Builds with ATCA_MBEDTLS also
+ * get an mbedTLS backend which calls the SHA modules directly, so a port
+ * whose mbedTLS uses a hash accelerator (ESP32 MBEDTLS_HARDWARE_SHA) hashes
+ * in hardware.
+ */
+
+#ifndef ATCA_CRYPTO_SW_BACKEND_H
+#define ATCA_CRYPTO_SW_BACKEND_H
+
+#include "atca_crypto_sw.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef ATCA_CRYPTO_SW_BACKENDS
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \brief One implementation of the software hashes. The state passed to
+ *         each function is the state member of atcac_sw_hash_ctx. */
+typedef struct atcac_sw_backend_s
+{
+    const char* name;
+    int (*sha1_init)(void* state);
+    int (*sha1_update)(void* state, const uint8_t* data, size_t data_size);
+    int (*sha1_finish)(void* state, uint8_t digest[ATCA_SHA1_DIGEST_SIZE]);
+    int (*sha2_256_init)(void* state);
+    int (*sha2_256_update)(void* state, const uint8_t* data, size_t data_size);
+    int (*sha2_256_finish)(void* state, uint8_t digest[ATCA_SHA2_256_DIGEST_SIZE]);
+} atcac_sw_backend_t;
+
+extern const atcac_sw_backend_t atcac_sw_backend_portable;
+#ifdef ATCA_MBEDTLS
+extern const atcac_sw_backend_t atcac_sw_backend_mbedtls;
+#endif
+
+/** \brief Every backend built in, terminated by NULL */
+extern const atcac_sw_backend_t* const atcac_sw_backends[];
+
+/** \brief Select the backend for the hashes started from now on. Hashes
+ *         already started finish on the backend they started with.
+ *  \param[in] backend  Backend to use, NULL for the build default
+ *  \return ATCA_SUCCESS
+ */
+ATCA_STATUS atcac_sw_backend_set(const atcac_sw_backend_t* backend);
+
+/** \brief Backend the next hash will use */
+const atcac_sw_backend_t* atcac_sw_backend_get(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ATCA_CRYPTO_SW_BACKENDS */
+
+#endif /* ATCA_CRYPTO_SW_BACKEND_H */
@@ -29,7 +29,7 @@
 #include "atca_crypto_sw_sha1.h"
 #include "hashes/sha1_routines.h"
 
-#if ATCA_ENABLE_SHA1_IMPL
+#if ATCA_ENABLE_SHA1_IMPL && !defined(ATCA_CRYPTO_SW_BACKENDS)
 
 /** \brief Initialize context for performing SHA1 hash in software.
  * \param[in] ctx  Hash context
@@ -30,6 +30,7 @@
 #include "hashes/sha2_routines.h"
 
 #if ATCA_ENABLE_SHA256_IMPL
+#ifndef ATCA_CRYPTO_SW_BACKENDS
 /** \brief initializes the SHA256 software
  * \param[in] ctx  ptr to context data structure
  * \return ATCA_SUCCESS on success, otherwise an error code.
@@ -73,6 +74,7 @@ int atcac_sw_sha2_256_finish(atcac_sha2_256_ctx* ctx, uint8_t digest[ATCA_SHA2_2
 
     return ATCA_SUCCESS;
 }
+#endif /* ATCA_CRYPTO_SW_BACKENDS */
 
 /** \brief Initialize context for performing HMAC (sha256) in software.
  *
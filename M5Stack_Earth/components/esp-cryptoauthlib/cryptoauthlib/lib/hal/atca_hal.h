@@ -168,6 +168,19 @@ ATCA_STATUS hal_custom_control(ATCAIface iface, uint8_t option, void* param, siz
 #define ATCA_POLLING_MAX_TIME_MSEC        2500
 #endif
 
+#ifdef ATCA_COMMAND_PIPELINING
+/* Polling interval once the measured execution time of an opcode is known */
+#ifndef ATCA_ADAPTIVE_POLLING_FREQUENCY_TIME_MSEC
+#define ATCA_ADAPTIVE_POLLING_FREQUENCY_TIME_MSEC  1
+#endif
+
+/* Re-wake a device kept awake by a session once this much of its watchdog
+   period (1.3 s nominal) has elapsed since it was woken */
+#ifndef ATCA_WATCHDOG_BUDGET_MSEC
+#define ATCA_WATCHDOG_BUDGET_MSEC         700
+#endif
+#endif
+
 /*  */
 typedef enum
 {
@@ -195,6 +208,16 @@ void hal_rtos_delay_ms(uint32_t ms);
 void hal_delay_ms(uint32_t ms);
 void hal_delay_us(uint32_t us);
 
+#ifdef ATCA_COMMAND_PIPELINING
+/** \brief Free running microsecond counter, wraps around */
+uint32_t hal_get_time_us(void);
+#endif
+
+/** \brief Recursive lock giving one task at a time the device behind the
+ *         interface, for a single command or a whole session */
+ATCA_STATUS hal_iface_lock(ATCAIface iface);
+void hal_iface_unlock(ATCAIface iface);
+
 /** \brief Optional hal interfaces */
 ATCA_STATUS hal_create_mutex(void ** ppMutex, char* pName);
 ATCA_STATUS hal_destroy_mutex(void * pMutex);
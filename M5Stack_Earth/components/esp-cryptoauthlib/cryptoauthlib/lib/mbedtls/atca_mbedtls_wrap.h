@@ -78,6 +78,12 @@ int atca_mbedtls_ecdh_slot_cb(void);
  */
 int atca_mbedtls_ecdh_ioprot_cb(uint8_t secret[32]);
 
+/** \brief Route ECDH key exchange through the device (the default when the
+ * mbedTLS ECDH ALT functions are built) or keep it in software
+ * \param[in] enable  false to use software ECDH for keys generated from now on
+ */
+void atca_mbedtls_ecdh_enable(bool enable);
+
 #ifdef __cplusplus
 }
 #endif
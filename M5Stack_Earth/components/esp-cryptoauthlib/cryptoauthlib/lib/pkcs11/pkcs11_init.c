@@ -221,6 +221,12 @@ CK_RV pkcs11_init(CK_C_INITIALIZE_ARGS_PTR pInitArgs)
             PKCS11_DEBUG("Create Failed\r\n");
             return CKR_CANT_LOCK;
         }
+
+        if (lib_ctx->create_mutex(&lib_ctx->queue_mutex))
+        {
+            PKCS11_DEBUG("Create Failed\r\n");
+            return CKR_CANT_LOCK;
+        }
     }
 
     /* Lock the library mutex */
@@ -44,6 +44,7 @@ typedef struct _pkcs11_lib_ctx
     CK_LOCKMUTEX    lock_mutex;
     CK_UNLOCKMUTEX  unlock_mutex;
     CK_VOID_PTR     mutex;
+    CK_VOID_PTR     queue_mutex; /**< Guards the queue of device operations waiting for the library lock */
     CK_VOID_PTR     slots;
     CK_ULONG        slot_cnt;
 #if !PKCS11_USE_STATIC_CONFIG
@@ -852,6 +852,7 @@ CK_RV pkcs11_key_generate
 
     if (CKR_OK == rv)
     {
+        pkcs11_object_touch();
         pkcs11_object_get_handle(pKey, phKey);
     }
     else
@@ -979,6 +980,7 @@ CK_RV pkcs11_key_generate_pair
 
     if (CKR_OK == rv)
     {
+        pkcs11_object_touch();
         pkcs11_object_get_handle(pPrivate, phPrivateKey);
         pkcs11_object_get_handle(pPublic, phPublicKey);
     }
@@ -1215,6 +1217,7 @@ CK_RV pkcs11_key_derive
 
     if (CKR_OK == rv)
     {
+        pkcs11_object_touch();
         pkcs11_object_get_handle(pSecretKey, phKey);
     }
     else if (pSecretKey)
@@ -40,6 +40,208 @@
  * \defgroup pkcs11 Signature (pkcs11_signature_)
    @{ */
 
+#define PKCS11_SIGNATURE_OP_QUEUED      0
+#define PKCS11_SIGNATURE_OP_RUNNING     1
+#define PKCS11_SIGNATURE_OP_DONE        2
+
+/** A sign or verify operation waiting for the device. It lives on the stack
+   of the calling thread until the operation is done. */
+typedef struct _pkcs11_signature_op
+{
+    struct _pkcs11_signature_op* next;
+    CK_BBOOL                     verify;
+    CK_MECHANISM_TYPE            mech;
+    pkcs11_object_ptr            key;
+    CK_BYTE_PTR                  data;
+    CK_ULONG                     data_len;
+    CK_BYTE_PTR                  signature;
+    CK_ULONG                     signature_len;
+    ATCA_STATUS                  status;
+    bool                         verified;
+    volatile CK_ULONG            state;
+} pkcs11_signature_op, *pkcs11_signature_op_ptr;
+
+/** Operations submitted by threads blocked on the library lock */
+static pkcs11_signature_op_ptr pkcs11_signature_queue;
+
+static void pkcs11_signature_queue_lock(pkcs11_lib_ctx_ptr pLibCtx)
+{
+    /* Only ever held for a few instructions so a timeout just means retry */
+    while (CKR_OK != pLibCtx->lock_mutex(pLibCtx->queue_mutex))
+    {
+    }
+}
+
+static void pkcs11_signature_queue_unlock(pkcs11_lib_ctx_ptr pLibCtx)
+{
+    (void)pLibCtx->unlock_mutex(pLibCtx->queue_mutex);
+}
+
+/**
+ * \brief Run a single operation on the device
+ */
+static void pkcs11_signature_execute(pkcs11_signature_op_ptr pOp)
+{
+    CK_BBOOL is_private;
+
+    pOp->status = ATCA_GEN_FAIL;
+
+    if (!pOp->verify)
+    {
+        switch (pOp->mech)
+        {
+        case CKM_SHA256_HMAC:
+            pOp->status = atcab_sha_hmac(pOp->data, pOp->data_len, pOp->key->slot, pOp->signature, SHA_MODE_TARGET_OUT_ONLY);
+            pOp->signature_len = ATCA_SHA256_DIGEST_SIZE;
+            break;
+        case CKM_ECDSA:
+            pOp->status = atcab_sign(pOp->key->slot, pOp->data, pOp->signature);
+            pOp->signature_len = ATCA_SIG_SIZE;
+            break;
+        default:
+            break;
+        }
+        return;
+    }
+
+    switch (pOp->mech)
+    {
+    case CKM_SHA256_HMAC:
+    {
+        uint8_t buf[ATCA_SHA256_DIGEST_SIZE];
+        if (ATCA_SUCCESS == (pOp->status = atcab_sha_hmac(pOp->data, pOp->data_len, pOp->key->slot, buf, SHA_MODE_TARGET_OUT_ONLY)))
+        {
+            if (!memcmp(pOp->signature, buf, ATCA_SHA256_DIGEST_SIZE))
+            {
+                pOp->verified = TRUE;
+            }
+        }
+    }
+    break;
+    case CKM_ECDSA:
+        if (CKR_OK == pkcs11_object_is_private(pOp->key, &is_private))
+        {
+            if (is_private)
+            {
+                /* Device can't verify against a private key so ask the device for
+                    the public key first then perform an external verify */
+                uint8_t pub_key[ATCA_ECCP256_PUBKEY_SIZE];
+
+                if (ATCA_SUCCESS == (pOp->status = atcab_get_pubkey(pOp->key->slot, pub_key)))
+                {
+                    pOp->status = atcab_verify_extern(pOp->data, pOp->signature, pub_key, &pOp->verified);
+                }
+            }
+            else
+            {
+                /* Assume Public Key has been stored properly and verify against
+                    whatever is stored */
+                pOp->status = atcab_verify_stored(pOp->data, pOp->signature, pOp->key->slot, &pOp->verified);
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * \brief Run an operation on the device, batched with the operations other
+ * sessions queued meanwhile.
+ *
+ * Whichever thread gets the library lock runs every queued operation inside
+ * one device session, so the device is woken once per batch rather than once
+ * per operation. Threads whose operation was part of a batch find it done
+ * when they get the lock and return right away.
+ */
+static CK_RV pkcs11_signature_submit(pkcs11_lib_ctx_ptr pLibCtx, pkcs11_signature_op_ptr pOp)
+{
+    pkcs11_signature_op_ptr pBatch = NULL_PTR;
+    pkcs11_signature_op_ptr* ppTail;
+    CK_RV rv;
+
+    if (!pLibCtx->lock_mutex || !pLibCtx->queue_mutex)
+    {
+        /* The application promised not to call in from several threads */
+        pkcs11_signature_execute(pOp);
+        return CKR_OK;
+    }
+
+    pOp->next = NULL_PTR;
+    pOp->state = PKCS11_SIGNATURE_OP_QUEUED;
+
+    pkcs11_signature_queue_lock(pLibCtx);
+    for (ppTail = &pkcs11_signature_queue; *ppTail; ppTail = &(*ppTail)->next)
+    {
+    }
+    *ppTail = pOp;
+    pkcs11_signature_queue_unlock(pLibCtx);
+
+    while (CKR_OK != (rv = pkcs11_lock_context(pLibCtx)))
+    {
+        CK_ULONG state;
+
+        /* Give up unless a batch already took the operation - then its memory
+           is in use until the batch is done with it */
+        pkcs11_signature_queue_lock(pLibCtx);
+        state = pOp->state;
+        if (PKCS11_SIGNATURE_OP_QUEUED == state)
+        {
+            for (ppTail = &pkcs11_signature_queue; *ppTail != pOp; ppTail = &(*ppTail)->next)
+            {
+            }
+            *ppTail = pOp->next;
+        }
+        pkcs11_signature_queue_unlock(pLibCtx);
+
+        if (PKCS11_SIGNATURE_OP_QUEUED == state)
+        {
+            return rv;
+        }
+        if (PKCS11_SIGNATURE_OP_DONE == state)
+        {
+            return CKR_OK;
+        }
+    }
+
+    pkcs11_signature_queue_lock(pLibCtx);
+    if (PKCS11_SIGNATURE_OP_QUEUED == pOp->state)
+    {
+        pkcs11_signature_op_ptr pNext;
+
+        pBatch = pkcs11_signature_queue;
+        pkcs11_signature_queue = NULL_PTR;
+        for (pNext = pBatch; pNext; pNext = pNext->next)
+        {
+            pNext->state = PKCS11_SIGNATURE_OP_RUNNING;
+        }
+    }
+    pkcs11_signature_queue_unlock(pLibCtx);
+
+    if (pBatch)
+    {
+        (void)atcab_session_begin();
+        while (pBatch)
+        {
+            pkcs11_signature_op_ptr pNext = pBatch->next;
+
+            pkcs11_signature_execute(pBatch);
+
+            /* The owner may return as soon as it sees this */
+            pkcs11_signature_queue_lock(pLibCtx);
+            pBatch->state = PKCS11_SIGNATURE_OP_DONE;
+            pkcs11_signature_queue_unlock(pLibCtx);
+
+            pBatch = pNext;
+        }
+        (void)atcab_session_end();
+    }
+
+    (void)pkcs11_unlock_context(pLibCtx);
+
+    return CKR_OK;
+}
+
 /**
  * \brief Initialize a signing operation using the specified key and mechanism
  */
@@ -94,9 +296,6 @@ CK_RV pkcs11_signature_sign(CK_SESSION_HANDLE hSession, CK_BYTE_PTR pData, CK_UL
     pkcs11_session_ctx_ptr pSession;
     pkcs11_object_ptr pKey;
     CK_RV rv;
-    ATCA_STATUS status;
-
-    ((void)ulDataLen);
 
     rv = pkcs11_init_check(&pLibCtx, FALSE);
     if (rv)
@@ -121,32 +320,25 @@ CK_RV pkcs11_signature_sign(CK_SESSION_HANDLE hSession, CK_BYTE_PTR pData, CK_UL
     {
         if (pSignature)
         {
-            if (CKR_OK != (rv = pkcs11_lock_context(pLibCtx)))
-            {
-                return rv;
-            }
+            pkcs11_signature_op op = { 0 };
+
+            op.mech = pSession->active_mech;
+            op.key = pKey;
+            op.data = pData;
+            op.data_len = ulDataLen;
+            op.signature = pSignature;
 
-            switch (pSession->active_mech)
+            if (CKR_OK != (rv = pkcs11_signature_submit(pLibCtx, &op)))
             {
-            case CKM_SHA256_HMAC:
-                status = atcab_sha_hmac(pData, ulDataLen, pKey->slot, pSignature, SHA_MODE_TARGET_OUT_ONLY);
-                *pulSignatureLen = ATCA_SHA256_DIGEST_SIZE;
-                break;
-            case CKM_ECDSA:
-                status = atcab_sign(pKey->slot, pData, pSignature);
-                *pulSignatureLen = ATCA_SIG_SIZE;
-                break;
-            default:
-                status = ATCA_GEN_FAIL;
-                break;
+                return rv;
             }
             pSession->active_mech = CKM_VENDOR_DEFINED;
 
-            (void)pkcs11_unlock_context(pLibCtx);
-            if (CKR_OK == rv && ATCA_SUCCESS != status)
+            if (ATCA_SUCCESS != op.status)
             {
-                return pkcs11_util_convert_rv(status);
+                return pkcs11_util_convert_rv(op.status);
             }
+            *pulSignatureLen = op.signature_len;
         }
     }
     else
@@ -235,10 +427,8 @@ CK_RV pkcs11_signature_verify(CK_SESSION_HANDLE hSession, CK_BYTE_PTR pData, CK_
     pkcs11_lib_ctx_ptr pLibCtx = NULL;
     pkcs11_session_ctx_ptr pSession;
     pkcs11_object_ptr pKey;
-    CK_BBOOL is_private;
+    pkcs11_signature_op op = { 0 };
     CK_RV rv;
-    ATCA_STATUS status = ATCA_GEN_FAIL;
-    bool verified = FALSE;
 
     rv = pkcs11_init_check(&pLibCtx, FALSE);
     if (rv)
@@ -264,58 +454,23 @@ CK_RV pkcs11_signature_verify(CK_SESSION_HANDLE hSession, CK_BYTE_PTR pData, CK_
         return CKR_ARGUMENTS_BAD;
     }
 
-    if (CKR_OK != (rv = pkcs11_lock_context(pLibCtx)))
-    {
-        return rv;
-    }
+    op.verify = TRUE;
+    op.mech = pSession->active_mech;
+    op.key = pKey;
+    op.data = pData;
+    op.data_len = ulDataLen;
+    op.signature = pSignature;
+    op.signature_len = ulSignatureLen;
 
-    switch (pSession->active_mech)
-    {
-    case CKM_SHA256_HMAC:
+    if (CKR_OK != (rv = pkcs11_signature_submit(pLibCtx, &op)))
     {
-        uint8_t buf[ATCA_SHA256_DIGEST_SIZE];
-        if (ATCA_SUCCESS == (status = atcab_sha_hmac(pData, ulDataLen, pKey->slot, buf, SHA_MODE_TARGET_OUT_ONLY)))
-        {
-            if (!memcmp(pSignature, buf, ATCA_SHA256_DIGEST_SIZE))
-            {
-                verified = TRUE;
-            }
-        }
-    }
-    break;
-    case CKM_ECDSA:
-        if (CKR_OK == (rv = pkcs11_object_is_private(pKey, &is_private)))
-        {
-            if (is_private)
-            {
-                /* Device can't verify against a private key so ask the device for
-                    the public key first then perform an external verify */
-                uint8_t pub_key[ATCA_ECCP256_PUBKEY_SIZE];
-
-                if (ATCA_SUCCESS == (status = atcab_get_pubkey(pKey->slot, pub_key)))
-                {
-                    status = atcab_verify_extern(pData, pSignature, pub_key, &verified);
-                }
-            }
-            else
-            {
-                /* Assume Public Key has been stored properly and verify against
-                    whatever is stored */
-                status = atcab_verify_stored(pData, pSignature, pKey->slot, &verified);
-            }
-        }
-        break;
-    default:
-        status = ATCA_GEN_FAIL;
-        break;
+        return rv;
     }
     pSession->active_mech = CKM_VENDOR_DEFINED;
 
-    (void)pkcs11_unlock_context(pLibCtx);
-
-    if (ATCA_SUCCESS == status)
+    if (ATCA_SUCCESS == op.status)
     {
-        rv = verified ? CKR_OK : CKR_SIGNATURE_INVALID;
+        rv = op.verified ? CKR_OK : CKR_SIGNATURE_INVALID;
     }
     else
     {
@@ -20,13 +20,11 @@
 #include "esp_log.h"
 #include "cryptoauthlib.h"
 #include "i2c_device.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 
 #define I2C1_SDA_PIN                       CONFIG_ATCA_I2C_SDA_PIN
 #define I2C1_SCL_PIN                       CONFIG_ATCA_I2C_SCL_PIN
-#define ACK_CHECK_EN                       0x1              /*!< I2C master will check ack from slave*/
-#define ACK_CHECK_DIS                      0x0              /*!< I2C master will not check ack from slave */
-#define ACK_VAL                            0x0              /*!< I2C ack value */
-#define NACK_VAL                           0x1              /*!< I2C nack value */
 
 #ifndef LOG_LOCAL_LEVEL
 #define LOG_LOCAL_LEVEL                    ESP_LOG_INFO
@@ -72,6 +70,11 @@ ATCA_STATUS hal_i2c_change_baud(ATCAIface iface, uint32_t speed)
  */
 
 /** \brief initialize an I2C interface using given config
+ *
+ * The device is registered with the core2forAWS i2c_device layer, which
+ * arbitrates the bus with the other devices on it (touch controller, PMU, RTC)
+ * and switches the bus clock per device.
+ *
  * \param[in] hal - opaque ptr to HAL data
  * \param[in] cfg - interface configuration
  * \return ATCA_SUCCESS on success, otherwise an error code.
@@ -79,6 +82,12 @@ ATCA_STATUS hal_i2c_change_baud(ATCAIface iface, uint32_t speed)
 ATCA_STATUS hal_i2c_init(ATCAIface iface, ATCAIfaceCfg *cfg)
 {
     int bus = cfg->atcai2c.bus;
+
+    if (atecc608_device != NULL)
+    {
+        return (i2c_device_change_freq(atecc608_device, cfg->atcai2c.baud) == ESP_OK) ? ATCA_SUCCESS : ATCA_COMM_FAIL;
+    }
+
     atecc608_device = i2c_malloc_device(bus, I2C1_SDA_PIN, I2C1_SCL_PIN, cfg->atcai2c.baud, cfg->atcai2c.address >> 1);
 
     if (atecc608_device == NULL) {
@@ -98,8 +107,13 @@ ATCA_STATUS hal_i2c_post_init(ATCAIface iface)
 }
 
 /** \brief HAL implementation of I2C send
+ *
+ * The bus is only held for the transfer itself, never across the command
+ * execution time, so other devices on the bus are served while the
+ * ATECC608 computes.
+ *
  * \param[in] iface         instance
- * \param[in] word_address  device transaction type
+ * \param[in] address       8-bit device address, 0 for the wake-up general call
  * \param[in] txdata        pointer to space to bytes to send
  * \param[in] txlength      number of bytes to send
  * \return ATCA_SUCCESS on success, otherwise an error code.
@@ -109,7 +123,7 @@ ATCA_STATUS hal_i2c_send(ATCAIface iface, uint8_t address, uint8_t *txdata, int
     ATCAIfaceCfg *cfg = iface->mIfaceCFG;
     esp_err_t rc;
 
-    if (!cfg)
+    if (!cfg || txlength < 0 || txlength > UINT16_MAX)
     {
         return ATCA_BAD_PARAM;
     }
@@ -117,15 +131,7 @@ ATCA_STATUS hal_i2c_send(ATCAIface iface, uint8_t address, uint8_t *txdata, int
     //ESP_LOGD(TAG, "txdata: %p , txlength: %d", txdata, txlength);
     //ESP_LOG_BUFFER_HEXDUMP(TAG, txdata, txlength, 3);
 
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    (void)i2c_master_start(cmd);
-    (void)i2c_master_write_byte(cmd, address | I2C_MASTER_WRITE, ACK_CHECK_EN);
-    (void)i2c_master_write(cmd, txdata, txlength, ACK_CHECK_EN);
-    (void)i2c_master_stop(cmd);
-    i2c_apply_bus(atecc608_device);
-    rc = i2c_master_cmd_begin(cfg->atcai2c.bus, cmd, 10);
-    i2c_free_bus(atecc608_device);
-    (void)i2c_cmd_link_delete(cmd);
+    rc = i2c_write_bytes_to(atecc608_device, address >> 1, txdata, (uint16_t)txlength);
 
     if (ESP_OK != rc)
     {
@@ -149,7 +155,6 @@ ATCA_STATUS hal_i2c_receive(ATCAIface iface, uint8_t address, uint8_t *rxdata, u
 {
     ATCAIfaceCfg *cfg = iface->mIfaceCFG;
     esp_err_t rc;
-    i2c_cmd_handle_t cmd;
     ATCA_STATUS status = ATCA_COMM_FAIL;
  
     if ((NULL == cfg) || (NULL == rxlength) || (NULL == rxdata))
@@ -157,19 +162,12 @@ ATCA_STATUS hal_i2c_receive(ATCAIface iface, uint8_t address, uint8_t *rxdata, u
         return ATCA_TRACE(ATCA_INVALID_POINTER, "NULL pointer encountered");
     }
 
-    cmd = i2c_cmd_link_create();
-    (void)i2c_master_start(cmd);
-    (void)i2c_master_write_byte(cmd, address | I2C_MASTER_READ, ACK_CHECK_EN);
-    if (*rxlength > 1)
+    if (address != cfg->atcai2c.address)
     {
-        (void)i2c_master_read(cmd, rxdata, *rxlength - 1, ACK_VAL);
+        return ATCA_BAD_PARAM;
     }
-    (void)i2c_master_read_byte(cmd, rxdata + (size_t)*rxlength - 1, NACK_VAL);
-    (void)i2c_master_stop(cmd);
-    i2c_apply_bus(atecc608_device);
-    rc = i2c_master_cmd_begin(cfg->atcai2c.bus, cmd, 10);
-    i2c_free_bus(atecc608_device);
-    (void)i2c_cmd_link_delete(cmd);
+
+    rc = i2c_read_bytes(atecc608_device, I2C_NO_REG, rxdata, *rxlength);
 
     //ESP_LOG_BUFFER_HEXDUMP(TAG, rxdata, *rxlength, 3);
 
@@ -189,6 +187,7 @@ ATCA_STATUS hal_i2c_receive(ATCAIface iface, uint8_t address, uint8_t *rxdata, u
 ATCA_STATUS hal_i2c_release(void *hal_data)
 {
     i2c_free_device(atecc608_device);
+    atecc608_device = NULL;
     return ATCA_SUCCESS;
 }
 
@@ -217,3 +216,48 @@ ATCA_STATUS hal_i2c_control(ATCAIface iface, uint8_t option, void* param, size_t
     }
     return ATCA_BAD_PARAM;
 }
+
+static portMUX_TYPE atecc608_lock_init_mux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t atecc608_lock = NULL;
+
+/** \brief Take the device for the calling task. Recursive, so a session can
+ *         hold it across the commands it runs.
+ * \param[in] iface  instance
+ * \return ATCA_SUCCESS on success, otherwise an error code.
+ */
+ATCA_STATUS hal_iface_lock(ATCAIface iface)
+{
+    (void)iface;
+
+    if (atecc608_lock == NULL)
+    {
+        SemaphoreHandle_t lock = xSemaphoreCreateRecursiveMutex();
+
+        if (lock == NULL)
+        {
+            return ATCA_ALLOC_FAILURE;
+        }
+        portENTER_CRITICAL(&atecc608_lock_init_mux);
+        if (atecc608_lock == NULL)
+        {
+            atecc608_lock = lock;
+            lock = NULL;
+        }
+        portEXIT_CRITICAL(&atecc608_lock_init_mux);
+        if (lock != NULL)
+        {
+            vSemaphoreDelete(lock);
+        }
+    }
+
+    return (xSemaphoreTakeRecursive(atecc608_lock, portMAX_DELAY) == pdTRUE) ? ATCA_SUCCESS : ATCA_GEN_FAIL;
+}
+
+/** \brief Release the device taken with hal_iface_lock()
+ * \param[in] iface  instance
+ */
+void hal_iface_unlock(ATCAIface iface)
+{
+    (void)iface;
+    xSemaphoreGiveRecursive(atecc608_lock);
+}
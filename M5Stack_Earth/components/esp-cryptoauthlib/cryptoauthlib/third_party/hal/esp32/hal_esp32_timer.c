@@ -16,6 +16,7 @@
 #include "atca_hal.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_timer.h"
 
 extern void ets_delay_us(uint32_t);
 
@@ -24,7 +25,31 @@ void atca_delay_us(uint32_t delay)
     ets_delay_us(delay);
 }
 
+/*
+ * Command execution waits (up to ~60 ms for an ECDSA sign) sleep for all but
+ * the last tick so other tasks, and other devices on the I2C bus, are served
+ * meanwhile. The rest is busy-waited so the delay is never cut short.
+ */
 void atca_delay_ms(uint32_t msec)
 {
-    ets_delay_us(msec * 1000);
+    int64_t end_us = esp_timer_get_time() + (int64_t)msec * 1000;
+    TickType_t ticks = pdMS_TO_TICKS(msec);
+    int64_t remaining_us;
+
+    if (ticks > 1 && xTaskGetSchedulerState() == taskSCHEDULER_RUNNING)
+    {
+        vTaskDelay(ticks - 1);
+    }
+
+    while ((remaining_us = end_us - esp_timer_get_time()) > 0)
+    {
+        ets_delay_us((uint32_t)remaining_us);
+    }
+}
+
+#ifdef ATCA_COMMAND_PIPELINING
+uint32_t hal_get_time_us(void)
+{
+    return (uint32_t)esp_timer_get_time();
 }
+#endif
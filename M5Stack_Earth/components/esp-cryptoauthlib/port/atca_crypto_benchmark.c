@@ -0,0 +1,170 @@
+/**
+ * \file
+ * \brief Throughput of the software crypto backends, see
+ *        atca_crypto_benchmark.h
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cryptoauthlib.h"
+#include "crypto/atca_crypto_sw.h"
+#include "crypto/atca_crypto_sw_backend.h"
+#include "atca_crypto_benchmark.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "atca_bench";
+
+#define BENCH_DEFAULT_BUFFER_SIZE   4096u
+#define BENCH_DEFAULT_ITERATIONS    64u
+
+typedef struct
+{
+    atca_crypto_benchmark_result_t *results;
+    size_t capacity;
+    size_t count;
+} bench_log_t;
+
+static void bench_record(bench_log_t *log, const char *backend, const char *algorithm,
+                         uint64_t bytes, int64_t elapsed_us)
+{
+    uint32_t kib_per_s = 0;
+
+    if (elapsed_us > 0)
+    {
+        kib_per_s = (uint32_t)((bytes * 1000000u / 1024u) / (uint64_t)elapsed_us);
+    }
+    ESP_LOGI(TAG, "%-8s %-12s %3u.%02u MB/s", backend, algorithm,
+             kib_per_s / 1024u, (kib_per_s % 1024u) * 100u / 1024u);
+
+    if (log->results && log->count < log->capacity)
+    {
+        log->results[log->count].backend = backend;
+        log->results[log->count].algorithm = algorithm;
+        log->results[log->count].kib_per_s = kib_per_s;
+    }
+    log->count++;
+}
+
+#ifdef ATCA_CRYPTO_SW_BACKENDS
+static ATCA_STATUS bench_sha(const atcac_sw_backend_t *backend, bool sha256,
+                             const uint8_t *buffer, size_t size, uint32_t iterations,
+                             int64_t *elapsed_us)
+{
+    atcac_sw_hash_ctx ctx;
+    uint8_t digest[ATCA_SHA2_256_DIGEST_SIZE];
+    int64_t start = esp_timer_get_time();
+    int ret;
+
+    ret = sha256 ? backend->sha2_256_init(ctx.state) : backend->sha1_init(ctx.state);
+    for (uint32_t i = 0; ret == ATCA_SUCCESS && i < iterations; i++)
+    {
+        ret = sha256 ? backend->sha2_256_update(ctx.state, buffer, size)
+              : backend->sha1_update(ctx.state, buffer, size);
+    }
+    if (ret == ATCA_SUCCESS)
+    {
+        ret = sha256 ? backend->sha2_256_finish(ctx.state, digest)
+              : backend->sha1_finish(ctx.state, digest);
+    }
+    *elapsed_us = esp_timer_get_time() - start;
+    return (ATCA_STATUS)ret;
+}
+#endif
+
+static ATCA_STATUS bench_cmac(const uint8_t *buffer, size_t size, uint32_t iterations,
+                              int64_t *elapsed_us)
+{
+    static const uint8_t key[16] = { 0 };
+    atcac_aes_cmac_ctx ctx;
+    uint8_t cmac[16];
+    size_t cmac_size = sizeof(cmac);
+    int64_t start = esp_timer_get_time();
+    ATCA_STATUS status;
+
+    status = atcac_aes_cmac_init(&ctx, key, sizeof(key));
+    for (uint32_t i = 0; status == ATCA_SUCCESS && i < iterations; i++)
+    {
+        status = atcac_aes_cmac_update(&ctx, buffer, size);
+    }
+    if (status == ATCA_SUCCESS)
+    {
+        status = atcac_aes_cmac_finish(&ctx, cmac, &cmac_size);
+    }
+    *elapsed_us = esp_timer_get_time() - start;
+    return status;
+}
+
+ATCA_STATUS atca_crypto_benchmark_run(size_t buffer_size, uint32_t iterations,
+                                      atca_crypto_benchmark_result_t *results, size_t *count)
+{
+    bench_log_t log = { results, (results && count) ? *count : 0, 0 };
+    ATCA_STATUS status = ATCA_SUCCESS;
+    int64_t elapsed_us;
+    uint64_t total;
+    uint8_t *buffer;
+
+    if (results && !count)
+    {
+        return ATCA_BAD_PARAM;
+    }
+    if (buffer_size == 0)
+    {
+        buffer_size = BENCH_DEFAULT_BUFFER_SIZE;
+    }
+    if (iterations == 0)
+    {
+        iterations = BENCH_DEFAULT_ITERATIONS;
+    }
+    total = (uint64_t)buffer_size * iterations;
+
+    buffer = malloc(buffer_size);
+    if (!buffer)
+    {
+        return ATCA_ALLOC_FAILURE;
+    }
+    for (size_t i = 0; i < buffer_size; i++)
+    {
+        buffer[i] = (uint8_t)(i * 31u + 7u);
+    }
+
+#ifdef ATCA_CRYPTO_SW_BACKENDS
+    for (size_t b = 0; status == ATCA_SUCCESS && atcac_sw_backends[b]; b++)
+    {
+        const atcac_sw_backend_t *backend = atcac_sw_backends[b];
+
+        status = bench_sha(backend, false, buffer, buffer_size, iterations, &elapsed_us);
+        if (status == ATCA_SUCCESS)
+        {
+            bench_record(&log, backend->name, "SHA-1", total, elapsed_us);
+            status = bench_sha(backend, true, buffer, buffer_size, iterations, &elapsed_us);
+        }
+        if (status == ATCA_SUCCESS)
+        {
+            bench_record(&log, backend->name, "SHA-256", total, elapsed_us);
+        }
+    }
+#endif
+
+    if (status == ATCA_SUCCESS)
+    {
+        status = bench_cmac(buffer, buffer_size, iterations, &elapsed_us);
+        if (status == ATCA_SUCCESS)
+        {
+            bench_record(&log, "mbedtls", "AES-128-CMAC", total, elapsed_us);
+        }
+    }
+
+    if (status != ATCA_SUCCESS)
+    {
+        ESP_LOGE(TAG, "Benchmark failed (%02x)", status);
+    }
+    if (count)
+    {
+        *count = log.count;
+    }
+    free(buffer);
+    return status;
+}
@@ -0,0 +1,60 @@
+/**
+ * \file
+ * \brief Cache of the identity read from the secure element: serial number,
+ *        device certificate and signer certificate.
+ *
+ * Rebuilding the certificates from the compressed form held by the ATECC608
+ * takes a GenKey and a series of reads over I2C. The rebuilt DER
+ * certificates and the serial number are kept in RAM for the rest of the boot
+ * and in NVS for the following ones. The NVS copy carries an HMAC-SHA256 under
+ * a key derived with ECDH from a private key held by the secure element, so a
+ * copy that was altered, or written by another device, is rebuilt instead of
+ * trusted.
+ */
+
+#ifndef ATCA_IDENTITY_CACHE_H
+#define ATCA_IDENTITY_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "atca_status.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** \brief Get the serial number of the secure element.
+ *  \param[out] serial  ATCA_SERIAL_NUM_SIZE bytes
+ *  \return ATCA_SUCCESS on success, otherwise an error code.
+ */
+ATCA_STATUS atca_identity_get_serial(uint8_t *serial);
+
+/** \brief Get the DER encoded device certificate.
+ *  \param[out] cert       Points to the cached certificate, valid until
+ *                         atca_identity_cache_invalidate()
+ *  \param[out] cert_size  Size of the certificate in bytes
+ *  \return ATCA_SUCCESS on success, otherwise an error code.
+ */
+ATCA_STATUS atca_identity_get_device_cert(const uint8_t **cert, size_t *cert_size);
+
+/** \brief Get the DER encoded signer certificate that issued the device
+ *         certificate.
+ *  \param[out] cert       Points to the cached certificate, valid until
+ *                         atca_identity_cache_invalidate()
+ *  \param[out] cert_size  Size of the certificate in bytes
+ *  \return ATCA_SUCCESS on success, otherwise an error code.
+ */
+ATCA_STATUS atca_identity_get_signer_cert(const uint8_t **cert, size_t *cert_size);
+
+/** \brief Drop the cached identity from RAM and NVS, for instance after the
+ *         certificates on the secure element were reprovisioned. The next call
+ *         reads them from the secure element again.
+ */
+void atca_identity_cache_invalidate(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* ATCA_IDENTITY_CACHE_H */
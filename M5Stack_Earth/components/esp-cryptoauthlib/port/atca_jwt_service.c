@@ -0,0 +1,472 @@
+/**
+ * \file
+ * \brief ES256 JSON Web Tokens signed by the secure element, minted ahead of
+ *        time, see atca_jwt_service.h
+ */
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cryptoauthlib.h"
+#include "atca_basic.h"
+#include "atca_helpers.h"
+#include "atca_jwt_service.h"
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "mbedtls/sha256.h"
+
+static const char *TAG = "atca_jwt";
+
+/* Earliest plausible wall clock time, anything before means SNTP has not set
+   the clock yet */
+#define JWT_MIN_VALID_TIME      ((time_t)1600000000)
+
+/* Longest encoding of the iat and exp claims plus the unencoded remainder of
+   the constant claims */
+#define JWT_DYNAMIC_CLAIMS_LEN  64
+
+/* '.' and the base64url encoded 64 byte signature */
+#define JWT_SIGNATURE_LEN       (1 + 86)
+
+static const char s_jwt_header[] = "{\"alg\":\"ES256\",\"typ\":\"JWT\"}";
+
+/** \brief Everything that is the same for every token */
+typedef struct
+{
+    char                   prefix[ATCA_JWT_SERVICE_MAX_TOKEN_LEN]; /**< Encoded header, '.', encoded head of the constant claims */
+    size_t                 prefix_len;
+    uint8_t                tail[2];         /**< Constant claims left over from encoding in 3 byte groups */
+    size_t                 tail_len;
+    mbedtls_sha256_context prefix_sha;      /**< SHA-256 state after the prefix, a software context */
+    uint16_t               key_id;
+    uint32_t               lifetime_s;
+    uint32_t               refresh_margin_s;
+} jwt_template_t;
+
+typedef struct
+{
+    char   text[ATCA_JWT_SERVICE_MAX_TOKEN_LEN];
+    time_t expires;
+} jwt_token_t;
+
+static jwt_template_t *s_template = NULL;
+static jwt_token_t *s_token = NULL;         /* Current token, guarded by s_token_lock */
+static SemaphoreHandle_t s_token_lock = NULL;
+static SemaphoreHandle_t s_mint_lock = NULL;
+static SemaphoreHandle_t s_task_done = NULL;
+static TaskHandle_t s_task = NULL;
+static volatile bool s_running = false;
+
+/** \brief Strings are placed in the claims as is, so they must not need
+ *         escaping.
+ */
+static bool jwt_plain_string(const char *s)
+{
+    for (; s != NULL && *s != '\0'; s++)
+    {
+        if (*s == '"' || *s == '\\' || (unsigned char)*s < 0x20)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static int jwt_append_claim(char *buf, size_t size, int len, const char *name, const char *value)
+{
+    if (value == NULL || len < 0 || (size_t)len >= size)
+    {
+        return len;
+    }
+    return len + snprintf(buf + len, size - len, "\"%s\":\"%s\",", name, value);
+}
+
+/** \brief Encode the header and as much of the constant claims as falls on
+ *         whole 3 byte groups, and hash them.
+ */
+static ATCA_STATUS jwt_build_template(jwt_template_t *tpl, const atca_jwt_service_config_t *config)
+{
+    char claims[ATCA_JWT_SERVICE_MAX_TOKEN_LEN];
+    mbedtls_sha256_context sha;
+    size_t head_len;
+    size_t size;
+    int len;
+    int ret;
+    ATCA_STATUS status;
+
+    if (!jwt_plain_string(config->issuer) || !jwt_plain_string(config->subject) ||
+        !jwt_plain_string(config->audience))
+    {
+        return ATCA_BAD_PARAM;
+    }
+
+    len = snprintf(claims, sizeof(claims), "{");
+    len = jwt_append_claim(claims, sizeof(claims), len, "iss", config->issuer);
+    len = jwt_append_claim(claims, sizeof(claims), len, "sub", config->subject);
+    len = jwt_append_claim(claims, sizeof(claims), len, "aud", config->audience);
+    if (config->extra_claims != NULL && config->extra_claims[0] != '\0' && (size_t)len < sizeof(claims))
+    {
+        len += snprintf(claims + len, sizeof(claims) - len, "%s,", config->extra_claims);
+    }
+    if ((size_t)len >= sizeof(claims))
+    {
+        return ATCA_INVALID_SIZE;
+    }
+
+    size = sizeof(tpl->prefix);
+    status = atcab_base64encode_((const uint8_t *)s_jwt_header, strlen(s_jwt_header), tpl->prefix,
+                                 &size, atcab_b64rules_urlsafe);
+    if (status != ATCA_SUCCESS)
+    {
+        return status;
+    }
+    tpl->prefix_len = size;
+    tpl->prefix[tpl->prefix_len++] = '.';
+
+    head_len = (size_t)len - (size_t)len % 3;
+    size = sizeof(tpl->prefix) - tpl->prefix_len;
+    status = atcab_base64encode_((const uint8_t *)claims, head_len, &tpl->prefix[tpl->prefix_len],
+                                 &size, atcab_b64rules_urlsafe);
+    if (status != ATCA_SUCCESS)
+    {
+        return status;
+    }
+    tpl->prefix_len += size;
+    tpl->tail_len = (size_t)len - head_len;
+    memcpy(tpl->tail, claims + head_len, tpl->tail_len);
+
+    /* Leave room for the per token claims and the signature */
+    if (tpl->prefix_len + ((JWT_DYNAMIC_CLAIMS_LEN + 2) / 3) * 4 + JWT_SIGNATURE_LEN + 1 > sizeof(tpl->prefix))
+    {
+        return ATCA_INVALID_SIZE;
+    }
+
+    /* With the ESP32 hardware SHA, a context that hashed a block holds the
+     * only SHA engine until it is freed. The midstate is kept in a clone,
+     * which mbedTLS makes a software context, and the original is freed so
+     * that TLS and the other hashes keep the engine. */
+    mbedtls_sha256_init(&tpl->prefix_sha);
+    mbedtls_sha256_init(&sha);
+    ret = mbedtls_sha256_starts_ret(&sha, 0);
+    if (ret == 0)
+    {
+        ret = mbedtls_sha256_update_ret(&sha, (const uint8_t *)tpl->prefix, tpl->prefix_len);
+    }
+    if (ret == 0)
+    {
+        mbedtls_sha256_clone(&tpl->prefix_sha, &sha);
+    }
+    mbedtls_sha256_free(&sha);
+    if (ret != 0)
+    {
+        return ATCA_GEN_FAIL;
+    }
+
+    tpl->key_id = config->key_id;
+    tpl->lifetime_s = config->lifetime_s;
+    tpl->refresh_margin_s = config->refresh_margin_s;
+    return ATCA_SUCCESS;
+}
+
+/** \brief Build and sign a token issued at now. Only the iat and exp claims
+ *         are encoded and hashed here.
+ */
+static ATCA_STATUS jwt_mint(const jwt_template_t *tpl, time_t now, jwt_token_t *token)
+{
+    uint8_t claims[JWT_DYNAMIC_CLAIMS_LEN];
+    uint8_t digest[ATCA_SHA256_DIGEST_SIZE];
+    uint8_t signature[ATCA_ECCP256_SIG_SIZE];
+    mbedtls_sha256_context sha;
+    time_t expires = now + (time_t)tpl->lifetime_s;
+    size_t pos = tpl->prefix_len;
+    size_t claims_len;
+    size_t size;
+    int ret;
+    ATCA_STATUS status;
+
+    memcpy(claims, tpl->tail, tpl->tail_len);
+    ret = snprintf((char *)claims + tpl->tail_len, sizeof(claims) - tpl->tail_len,
+                   "\"iat\":%lld,\"exp\":%lld}", (long long)now, (long long)expires);
+    if (ret < 0 || (size_t)ret >= sizeof(claims) - tpl->tail_len)
+    {
+        return ATCA_INVALID_SIZE;
+    }
+    claims_len = tpl->tail_len + (size_t)ret;
+
+    memcpy(token->text, tpl->prefix, pos);
+    size = sizeof(token->text) - pos;
+    status = atcab_base64encode_(claims, claims_len, &token->text[pos], &size, atcab_b64rules_urlsafe);
+    if (status != ATCA_SUCCESS)
+    {
+        return status;
+    }
+
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_clone(&sha, &tpl->prefix_sha);
+    ret = mbedtls_sha256_update_ret(&sha, (const uint8_t *)&token->text[pos], size);
+    if (ret == 0)
+    {
+        ret = mbedtls_sha256_finish_ret(&sha, digest);
+    }
+    mbedtls_sha256_free(&sha);
+    if (ret != 0)
+    {
+        return ATCA_GEN_FAIL;
+    }
+    pos += size;
+
+    status = atcab_sign(tpl->key_id, digest, signature);
+    if (status != ATCA_SUCCESS)
+    {
+        return status;
+    }
+
+    token->text[pos++] = '.';
+    size = sizeof(token->text) - pos;
+    status = atcab_base64encode_(signature, sizeof(signature), &token->text[pos], &size, atcab_b64rules_urlsafe);
+    if (status != ATCA_SUCCESS)
+    {
+        return status;
+    }
+    token->expires = expires;
+    return ATCA_SUCCESS;
+}
+
+static time_t jwt_current_expiry(void)
+{
+    time_t expires;
+
+    xSemaphoreTake(s_token_lock, portMAX_DELAY);
+    expires = (s_token != NULL) ? s_token->expires : 0;
+    xSemaphoreGive(s_token_lock);
+    return expires;
+}
+
+/** \brief Mint a new token unless the current one is still valid for
+ *         margins refresh margins past now. The token lock is only held to
+ *         swap the tokens, so readers are not blocked by the signature.
+ */
+static ATCA_STATUS jwt_refresh(time_t now, int margins)
+{
+    jwt_token_t *token;
+    ATCA_STATUS status = ATCA_SUCCESS;
+
+    xSemaphoreTake(s_mint_lock, portMAX_DELAY);
+
+    /* The service may have been stopped while this task waited */
+    if (!s_running || s_template == NULL)
+    {
+        xSemaphoreGive(s_mint_lock);
+        return ATCA_NOT_INITIALIZED;
+    }
+
+    /* Another task may have minted one while this one waited */
+    if (jwt_current_expiry() > now + margins * (time_t)s_template->refresh_margin_s)
+    {
+        xSemaphoreGive(s_mint_lock);
+        return ATCA_SUCCESS;
+    }
+
+    token = malloc(sizeof(*token));
+    if (token == NULL)
+    {
+        status = ATCA_ALLOC_FAILURE;
+    }
+    else if ((status = jwt_mint(s_template, now, token)) == ATCA_SUCCESS)
+    {
+        xSemaphoreTake(s_token_lock, portMAX_DELAY);
+        free(s_token);
+        s_token = token;
+        token = NULL;
+        xSemaphoreGive(s_token_lock);
+        ESP_LOGD(TAG, "Minted token expiring at %lld", (long long)s_token->expires);
+    }
+    else
+    {
+        ESP_LOGW(TAG, "Failed to mint token (%02x)", status);
+    }
+    free(token);
+
+    xSemaphoreGive(s_mint_lock);
+    return status;
+}
+
+static void jwt_service_task(void *arg)
+{
+    (void)arg;
+
+    while (s_running)
+    {
+        time_t now = time(NULL);
+        uint32_t wait_s = 1;
+
+        if (now >= JWT_MIN_VALID_TIME)
+        {
+            /* Replace the token while it still has a refresh margin to go */
+            time_t renew_at = jwt_current_expiry() - 2 * (time_t)s_template->refresh_margin_s;
+
+            if (now >= renew_at)
+            {
+                wait_s = (jwt_refresh(now, 2) == ATCA_SUCCESS) ? 0 : 5;
+            }
+            else
+            {
+                /* Wake up at least every minute in case the clock is stepped */
+                wait_s = (renew_at - now > 60) ? 60 : (uint32_t)(renew_at - now);
+            }
+        }
+
+        if (wait_s > 0)
+        {
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(wait_s * 1000));
+        }
+    }
+
+    xSemaphoreGive(s_task_done);
+    vTaskDelete(NULL);
+}
+
+ATCA_STATUS atca_jwt_service_start(const atca_jwt_service_config_t *config)
+{
+    ATCA_STATUS status;
+
+    if (config == NULL || config->lifetime_s <= 2 * config->refresh_margin_s)
+    {
+        return ATCA_BAD_PARAM;
+    }
+    if (s_running)
+    {
+        return ATCA_FUNC_FAIL;
+    }
+
+    s_template = calloc(1, sizeof(*s_template));
+    if (s_template == NULL)
+    {
+        return ATCA_ALLOC_FAILURE;
+    }
+    status = jwt_build_template(s_template, config);
+    if (status != ATCA_SUCCESS)
+    {
+        free(s_template);
+        s_template = NULL;
+        return status;
+    }
+
+    if (s_token_lock == NULL)
+    {
+        s_token_lock = xSemaphoreCreateMutex();
+        s_mint_lock = xSemaphoreCreateMutex();
+        s_task_done = xSemaphoreCreateBinary();
+    }
+    if (s_token_lock == NULL || s_mint_lock == NULL || s_task_done == NULL)
+    {
+        status = ATCA_ALLOC_FAILURE;
+    }
+    else
+    {
+        s_running = true;
+        if (xTaskCreate(jwt_service_task, "atca_jwt", ATCA_JWT_SERVICE_TASK_STACK, NULL,
+                        ATCA_JWT_SERVICE_TASK_PRIORITY, &s_task) != pdPASS)
+        {
+            s_running = false;
+            status = ATCA_ALLOC_FAILURE;
+        }
+    }
+
+    if (status != ATCA_SUCCESS)
+    {
+        mbedtls_sha256_free(&s_template->prefix_sha);
+        free(s_template);
+        s_template = NULL;
+    }
+    return status;
+}
+
+ATCA_STATUS atca_jwt_service_get(char *token, size_t token_size, time_t *expires)
+{
+    time_t now = time(NULL);
+    time_t margin = 0;
+    ATCA_STATUS status = ATCA_SUCCESS;
+    bool copied = false;
+
+    if (token == NULL || token_size == 0)
+    {
+        return ATCA_BAD_PARAM;
+    }
+    if (!s_running || now < JWT_MIN_VALID_TIME)
+    {
+        return ATCA_NOT_INITIALIZED;
+    }
+
+    /* atca_jwt_service_stop() frees the template under the mint lock */
+    xSemaphoreTake(s_mint_lock, portMAX_DELAY);
+    if (s_running && s_template != NULL)
+    {
+        margin = (time_t)s_template->refresh_margin_s;
+    }
+    else
+    {
+        status = ATCA_NOT_INITIALIZED;
+    }
+    xSemaphoreGive(s_mint_lock);
+
+    while (!copied && status == ATCA_SUCCESS)
+    {
+        xSemaphoreTake(s_token_lock, portMAX_DELAY);
+        if (s_token != NULL && s_token->expires > now + margin)
+        {
+            if (strlen(s_token->text) < token_size)
+            {
+                strcpy(token, s_token->text);
+                if (expires != NULL)
+                {
+                    *expires = s_token->expires;
+                }
+            }
+            else
+            {
+                status = ATCA_SMALL_BUFFER;
+            }
+            copied = true;
+        }
+        xSemaphoreGive(s_token_lock);
+
+        /* Only signs here when the background task has not produced a
+           fresh token yet */
+        if (!copied && status == ATCA_SUCCESS)
+        {
+            status = jwt_refresh(now, 1);
+        }
+    }
+
+    return status;
+}
+
+void atca_jwt_service_stop(void)
+{
+    if (!s_running)
+    {
+        return;
+    }
+
+    s_running = false;
+    xTaskNotifyGive(s_task);
+    xSemaphoreTake(s_task_done, portMAX_DELAY);
+    s_task = NULL;
+
+    /* Wait for a caller that is minting in atca_jwt_service_get() */
+    xSemaphoreTake(s_mint_lock, portMAX_DELAY);
+    xSemaphoreTake(s_token_lock, portMAX_DELAY);
+    free(s_token);
+    s_token = NULL;
+    xSemaphoreGive(s_token_lock);
+    mbedtls_sha256_free(&s_template->prefix_sha);
+    free(s_template);
+    s_template = NULL;
+    xSemaphoreGive(s_mint_lock);
+}
@@ -0,0 +1,309 @@
+/**
+ * \file
+ * \brief Public key cost of a TLS client handshake, see atca_tls_benchmark.h
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+
+#if !defined(MBEDTLS_CONFIG_FILE)
+#include "mbedtls/config.h"
+#else
+#include MBEDTLS_CONFIG_FILE
+#endif
+
+#include "mbedtls/ecdh.h"
+#include "mbedtls/ecdsa.h"
+#include "mbedtls/pk.h"
+
+#include "cryptoauthlib.h"
+#include "atca_mbedtls_wrap.h"
+#include "atca_tls_benchmark.h"
+
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "atca_tls_bench";
+
+#define BENCH_DEFAULT_ITERATIONS    8u
+
+#if defined(MBEDTLS_ECDH_GEN_PUBLIC_ALT) && defined(MBEDTLS_ECDH_COMPUTE_SHARED_ALT)
+#define BENCH_HW_ECDH   1
+#endif
+
+/* Run time stats are only comparable with wall time when counted in us */
+#if (configGENERATE_RUN_TIME_STATS == 1) && (configUSE_TRACE_FACILITY == 1) && \
+    defined(CONFIG_FREERTOS_RUN_TIME_STATS_USING_ESP_TIMER)
+#define BENCH_CPU_TIME  1
+#endif
+
+typedef struct
+{
+    const char *name;
+    bool hw_sign;
+    bool hw_ecdh;
+} bench_mode_t;
+
+static const bench_mode_t bench_modes[] =
+{
+#ifndef MBEDTLS_ECDSA_SIGN_ALT
+    { "software",     false, false },
+#endif
+    { "hw-sign",      true,  false },
+#ifdef BENCH_HW_ECDH
+    { "hw-sign+ecdh", true,  true  },
+#endif
+};
+
+/** \brief Keys shared by all modes: the server's ECDHE share and its
+ *         signature over the handshake hash.
+ */
+typedef struct
+{
+    mbedtls_ecp_group grp;
+    mbedtls_ecp_point server_share;
+    mbedtls_pk_context server_key;
+    uint8_t hash[32];
+    uint8_t server_sig[MBEDTLS_ECDSA_MAX_LEN];
+    size_t server_sig_len;
+} bench_peer_t;
+
+static int bench_rng(void *ctx, unsigned char *buf, size_t len)
+{
+    (void)ctx;
+    esp_fill_random(buf, len);
+    return 0;
+}
+
+static uint32_t bench_cpu_time(void)
+{
+#ifdef BENCH_CPU_TIME
+    TaskStatus_t status;
+
+    vTaskGetInfo(NULL, &status, pdFALSE, eRunning);
+    return status.ulRunTimeCounter;
+#else
+    return 0;
+#endif
+}
+
+static int bench_sw_key(mbedtls_pk_context *key)
+{
+    int ret;
+
+    mbedtls_pk_init(key);
+    ret = mbedtls_pk_setup(key, mbedtls_pk_info_from_type(MBEDTLS_PK_ECKEY));
+    if (!ret)
+    {
+        ret = mbedtls_ecp_gen_key(MBEDTLS_ECP_DP_SECP256R1, mbedtls_pk_ec(*key), bench_rng, NULL);
+    }
+    return ret;
+}
+
+static int bench_peer_init(bench_peer_t *peer)
+{
+    mbedtls_mpi d;
+    int ret;
+
+    memset(peer, 0, sizeof(*peer));
+    mbedtls_ecp_group_init(&peer->grp);
+    mbedtls_ecp_point_init(&peer->server_share);
+    mbedtls_mpi_init(&d);
+    esp_fill_random(peer->hash, sizeof(peer->hash));
+
+    ret = mbedtls_ecp_group_load(&peer->grp, MBEDTLS_ECP_DP_SECP256R1);
+    if (!ret)
+    {
+        ret = mbedtls_ecp_gen_keypair(&peer->grp, &d, &peer->server_share, bench_rng, NULL);
+    }
+    if (!ret)
+    {
+        ret = bench_sw_key(&peer->server_key);
+    }
+#ifndef MBEDTLS_ECDSA_SIGN_ALT
+    if (!ret)
+    {
+        ret = mbedtls_pk_sign(&peer->server_key, MBEDTLS_MD_SHA256, peer->hash, sizeof(peer->hash),
+                              peer->server_sig, &peer->server_sig_len, bench_rng, NULL);
+    }
+#else
+    /* mbedTLS can only sign on the device in this build. The signature is
+       verified against the device key instead, which costs the same. */
+    if (!ret)
+    {
+        mbedtls_pk_free(&peer->server_key);
+        ret = atca_mbedtls_pk_init(&peer->server_key, 0);
+    }
+    if (!ret)
+    {
+        ret = mbedtls_pk_sign(&peer->server_key, MBEDTLS_MD_SHA256, peer->hash, sizeof(peer->hash),
+                              peer->server_sig, &peer->server_sig_len, bench_rng, NULL);
+    }
+#endif
+    mbedtls_mpi_free(&d);
+    return ret;
+}
+
+static void bench_peer_free(bench_peer_t *peer)
+{
+    mbedtls_pk_free(&peer->server_key);
+    mbedtls_ecp_point_free(&peer->server_share);
+    mbedtls_ecp_group_free(&peer->grp);
+}
+
+/** \brief One handshake: client ECDHE share and premaster secret,
+ *         CertificateVerify, server signature.
+ */
+static int bench_handshake(bench_peer_t *peer, mbedtls_pk_context *client_key,
+                           int64_t *ecdhe_us, int64_t *sign_us, int64_t *verify_us)
+{
+    uint8_t sig[MBEDTLS_ECDSA_MAX_LEN];
+    size_t sig_len;
+    mbedtls_mpi d, z;
+    mbedtls_ecp_point q;
+    int64_t start;
+    int ret;
+
+    mbedtls_mpi_init(&d);
+    mbedtls_mpi_init(&z);
+    mbedtls_ecp_point_init(&q);
+
+    start = esp_timer_get_time();
+    ret = mbedtls_ecdh_gen_public(&peer->grp, &d, &q, bench_rng, NULL);
+    if (!ret)
+    {
+        ret = mbedtls_ecdh_compute_shared(&peer->grp, &z, &peer->server_share, &d, bench_rng, NULL);
+    }
+    *ecdhe_us += esp_timer_get_time() - start;
+
+    if (!ret)
+    {
+        start = esp_timer_get_time();
+        ret = mbedtls_pk_sign(client_key, MBEDTLS_MD_SHA256, peer->hash, sizeof(peer->hash),
+                              sig, &sig_len, bench_rng, NULL);
+        *sign_us += esp_timer_get_time() - start;
+    }
+
+    if (!ret)
+    {
+        start = esp_timer_get_time();
+        ret = mbedtls_pk_verify(&peer->server_key, MBEDTLS_MD_SHA256, peer->hash, sizeof(peer->hash),
+                                peer->server_sig, peer->server_sig_len);
+        *verify_us += esp_timer_get_time() - start;
+    }
+
+    mbedtls_ecp_point_free(&q);
+    mbedtls_mpi_free(&z);
+    mbedtls_mpi_free(&d);
+    return ret;
+}
+
+static int bench_mode_run(const bench_mode_t *mode, bench_peer_t *peer, uint16_t sign_slot,
+                          uint32_t iterations, atca_tls_benchmark_result_t *result)
+{
+    mbedtls_pk_context client_key;
+    int64_t ecdhe_us = 0, sign_us = 0, verify_us = 0;
+    uint32_t cpu_start;
+    int ret;
+
+    if (mode->hw_sign)
+    {
+        ret = atca_mbedtls_pk_init(&client_key, sign_slot);
+    }
+    else
+    {
+        ret = bench_sw_key(&client_key);
+    }
+#ifdef BENCH_HW_ECDH
+    atca_mbedtls_ecdh_enable(mode->hw_ecdh);
+#endif
+
+    cpu_start = bench_cpu_time();
+    for (uint32_t i = 0; !ret && i < iterations; i++)
+    {
+        ret = bench_handshake(peer, &client_key, &ecdhe_us, &sign_us, &verify_us);
+    }
+
+#ifdef BENCH_HW_ECDH
+    atca_mbedtls_ecdh_enable(true);
+#endif
+    mbedtls_pk_free(&client_key);
+
+    if (!ret)
+    {
+        result->mode = mode->name;
+        result->ecdhe_us = (uint32_t)(ecdhe_us / iterations);
+        result->sign_us = (uint32_t)(sign_us / iterations);
+        result->verify_us = (uint32_t)(verify_us / iterations);
+        result->total_us = result->ecdhe_us + result->sign_us + result->verify_us;
+#ifdef BENCH_CPU_TIME
+        result->cpu_us = (bench_cpu_time() - cpu_start) / iterations;
+#else
+        (void)cpu_start;
+        result->cpu_us = ATCA_TLS_BENCHMARK_CPU_UNKNOWN;
+#endif
+    }
+    return ret;
+}
+
+ATCA_STATUS atca_tls_benchmark_run(uint32_t iterations, uint16_t sign_slot,
+                                   atca_tls_benchmark_result_t *results, size_t *count)
+{
+    size_t capacity = (results && count) ? *count : 0;
+    size_t done = 0;
+    bench_peer_t peer;
+    int ret;
+
+    if (results && !count)
+    {
+        return ATCA_BAD_PARAM;
+    }
+    if (iterations == 0)
+    {
+        iterations = BENCH_DEFAULT_ITERATIONS;
+    }
+
+    ret = bench_peer_init(&peer);
+
+    ESP_LOGI(TAG, "%-12s %9s %9s %9s %9s %9s", "mode", "ecdhe us", "sign us", "verify us", "total us", "cpu us");
+    for (size_t m = 0; !ret && m < sizeof(bench_modes) / sizeof(bench_modes[0]); m++)
+    {
+        atca_tls_benchmark_result_t result;
+
+        ret = bench_mode_run(&bench_modes[m], &peer, sign_slot, iterations, &result);
+        if (ret)
+        {
+            ESP_LOGE(TAG, "%s failed (-0x%04x)", bench_modes[m].name, (unsigned)-ret);
+            break;
+        }
+
+        if (result.cpu_us == ATCA_TLS_BENCHMARK_CPU_UNKNOWN)
+        {
+            ESP_LOGI(TAG, "%-12s %9u %9u %9u %9u %9s", result.mode, result.ecdhe_us, result.sign_us,
+                     result.verify_us, result.total_us, "n/a");
+        }
+        else
+        {
+            ESP_LOGI(TAG, "%-12s %9u %9u %9u %9u %9u", result.mode, result.ecdhe_us, result.sign_us,
+                     result.verify_us, result.total_us, result.cpu_us);
+        }
+
+        if (done < capacity)
+        {
+            results[done] = result;
+        }
+        done++;
+    }
+
+    bench_peer_free(&peer);
+    if (count)
+    {
+        *count = done;
+    }
+    return ret ? ATCA_FUNC_FAIL : ATCA_SUCCESS;
+}
@@ -45,6 +45,7 @@
 #include "aws_iot_log.h"
 #include "aws_iot_version.h"
 #include "aws_iot_mqtt_client_interface.h"
+#include "aws_iot_mqtt_io_task.h"
 
 #include "core2forAWS.h"
 
@@ -54,6 +55,12 @@
 /* The time between each MQTT message publish in milliseconds */
 #define PUBLISH_INTERVAL_MS 3000
 
+/* Connection and TLS metrics are published once every this many sensor readings */
+#define METRICS_PUBLISH_INTERVAL 20
+
+/* Size of the buffer the metrics JSON is formatted into */
+#define METRICS_PAYLOAD_LEN 1024
+
 /* The time prefix used by the logger. */
 static const char *TAG = "MAIN";
 
@@ -67,6 +74,9 @@ char HostAddress[255] = AWS_IOT_MQTT_HOST;
 /* Default MQTT port is pulled from the aws_iot_config.h */
 uint32_t port = AWS_IOT_MQTT_PORT;
 
+/* Owns the MQTT connection once connected. Yields and sends queued publishes. */
+static AWS_IoT_MQTT_IO_Task mqtt_io_task;
+
 void iot_subscribe_callback_handler(AWS_IoT_Client *pClient, char *topicName, uint16_t topicNameLen,
                                     IoT_Publish_Message_Params *params, void *pData) {
     ESP_LOGI(TAG, "Subscribe callback");
@@ -95,6 +105,18 @@ void disconnect_callback_handler(AWS_IoT_Client *pClient, void *data) {
     }
 }
 
+/**
+ * @brief Called by the MQTT I/O task once a queued publish was sent.
+ *
+ * Frees the JSON string that was handed over as the payload.
+ */
+static void publish_complete_handler(AWS_IoT_Client *pClient, IoT_Error_t rc, void *pData) {
+    if (rc != SUCCESS){
+        ESP_LOGE(TAG, "Publish QOS0 error %i", rc);
+    }
+    cJSON_free(pData);
+}
+
 /**
  * @brief Function that reads from sensor and publishes to MQTT topic.
  *
@@ -104,7 +126,8 @@ void disconnect_callback_handler(AWS_IoT_Client *pClient, void *data) {
  * The function reads from the connected M5Stack
  * Earth moisture sensor on Port B, and gets the calibrated millivolt 
  * value. It then uses the cJSON library to create a JSON object, which
- * then gets stringified to be sent as an MQTT message.
+ * then gets stringified to be sent as an MQTT message. The message is
+ * queued for the MQTT I/O task, which owns the connection.
  * 
  * The sensor value is published to a topic that ends with "sensor." So
  * the complete MQTT topic should look like `0123456A78B9012C34/sensor`
@@ -117,7 +140,7 @@ void disconnect_callback_handler(AWS_IoT_Client *pClient, void *data) {
  * the soil is moist or dry.
  *
 */
-static void publisher(AWS_IoT_Client *client, char *base_topic, uint16_t base_topic_len){
+static void publisher(AWS_IoT_MQTT_IO_Task *io_task, const char *publish_topic, uint16_t publish_topic_len){
     // AWS IoT publishing struct configured for QOS0
     IoT_Publish_Message_Params paramsQOS0;
     paramsQOS0.qos = QOS0;
@@ -138,28 +161,22 @@ static void publisher(AWS_IoT_Client *client, char *base_topic, uint16_t base_to
 
     // Stringify the JSON object to be sent over MQTT
     // Add the string to the QOS0 payload
-    const char *JSONPayload = cJSON_Print(payload);
+    char *JSONPayload = cJSON_Print(payload);
     paramsQOS0.payload = (void *) JSONPayload;
     paramsQOS0.payloadLen = strlen(JSONPayload);
 
-    // As a best practice, narrow the topic to be more easily digested
-    // Here we append "sensor" to the base topic name.
-    char *mqtt_pub_topic = "sensor";
-    uint8_t mqtt_pub_topic_len = strlen( mqtt_pub_topic );
-    uint8_t publish_topic_len = base_topic_len + mqtt_pub_topic_len;
-    char publish_topic[ publish_topic_len ];
-    snprintf( publish_topic, publish_topic_len, "%s%s", base_topic, mqtt_pub_topic );
-
-    // Publish the message to AWS IoT with the topic specified above
-    IoT_Error_t rc = aws_iot_mqtt_publish(client, publish_topic, publish_topic_len, &paramsQOS0);
+    // Print the payload string to the screen. This must happen before
+    // queueing, the I/O task frees the string once it has been sent.
+    ui_textarea_add("%s", JSONPayload, paramsQOS0.payloadLen);
+
+    // Queue the message for AWS IoT with the topic specified above
+    IoT_Error_t rc = aws_iot_mqtt_io_publish(io_task, publish_topic, publish_topic_len, &paramsQOS0,
+                                             publish_complete_handler, JSONPayload);
     if (rc != SUCCESS){
-        ESP_LOGE(TAG, "Publish QOS0 error %i", rc);
-        rc = SUCCESS;
+        ESP_LOGE(TAG, "Publish QOS0 queue error %i", rc);
+        cJSON_free(JSONPayload);
     }
 
-    // Print the payload string to the screen
-    ui_textarea_add("%s", (char *)JSONPayload, paramsQOS0.payloadLen);
-
     // Delete the JSON object and free dynamically allocated memory
     // This is critical to avoid a memory leak
     cJSON_Delete(payload);
@@ -177,6 +194,68 @@ static void publisher(AWS_IoT_Client *client, char *base_topic, uint16_t base_to
     }
 }
 
+/**
+ * @brief Called by the MQTT I/O task once the metrics publish was sent.
+ */
+static void metrics_publish_complete_handler(AWS_IoT_Client *pClient, IoT_Error_t rc, void *pData) {
+    if (rc != SUCCESS){
+        ESP_LOGE(TAG, "Metrics publish error %i", rc);
+    }
+    free(pData);
+}
+
+/**
+ * @brief Publishes the MQTT connection metrics and the TLS metrics of the
+ * network port as one JSON document.
+ *
+ * Lets reconnect and handshake latency, TLS overhead and socket retries be
+ * compared across the fleet. The TLS counters are cumulative since boot.
+ */
+static void publish_metrics(AWS_IoT_MQTT_IO_Task *io_task, AWS_IoT_Client *client, const char *metrics_topic){
+    IoT_Publish_Message_Params params;
+    IoT_Connection_Metrics connection;
+    TLSMetrics tls;
+    int len;
+
+    char *payload = malloc(METRICS_PAYLOAD_LEN);
+    if (payload == NULL){
+        ESP_LOGE(TAG, "No memory for the metrics payload");
+        return;
+    }
+
+    aws_iot_mqtt_get_connection_metrics(client, &connection);
+    iot_tls_get_metrics(&client->networkStack, &tls);
+
+    len = snprintf(payload, METRICS_PAYLOAD_LEN,
+                   "{\"mqtt\":{\"dnsLookupMs\":%u,\"tcpConnectMs\":%u,\"tlsHandshakeMs\":%u,\"connackMs\":%u,"
+                   "\"resubscribeMs\":%u,\"lastOutageMs\":%u,\"lastOutageAttempts\":%u,\"reconnectCount\":%u},\"tls\":",
+                   connection.dnsLookupMs, connection.tcpConnectMs, connection.tlsHandshakeMs, connection.connackMs,
+                   connection.resubscribeMs, connection.lastOutageMs, connection.lastOutageAttempts,
+                   connection.reconnectCount);
+    if (len > 0 && len < METRICS_PAYLOAD_LEN){
+        len += iot_tls_metrics_to_json(&tls, payload + len, METRICS_PAYLOAD_LEN - len);
+    }
+    if (len <= 0 || len + 1 >= METRICS_PAYLOAD_LEN){
+        ESP_LOGE(TAG, "Metrics don't fit in %d bytes", METRICS_PAYLOAD_LEN);
+        free(payload);
+        return;
+    }
+    payload[len++] = '}';
+    payload[len] = '\0';
+
+    params.qos = QOS0;
+    params.isRetained = 0;
+    params.payload = (void *) payload;
+    params.payloadLen = len;
+
+    IoT_Error_t rc = aws_iot_mqtt_io_publish(io_task, metrics_topic, strlen(metrics_topic), &params,
+                                             metrics_publish_complete_handler, payload);
+    if (rc != SUCCESS){
+        ESP_LOGE(TAG, "Metrics publish queue error %i", rc);
+        free(payload);
+    }
+}
+
 void aws_iot_task(void *param) {
     IoT_Error_t rc = FAILURE;
 
@@ -210,6 +289,14 @@ void aws_iot_task(void *param) {
     snprintf(subscribe_topic, SUBSCRIBE_TOPIC_LEN, "%s/#", client_id);
     snprintf(base_publish_topic, BASE_PUBLISH_TOPIC_LEN, "%s/", client_id);
 
+    // As a best practice, narrow the topic to be more easily digested
+    // Here we append "sensor" to the base topic name. The buffer must stay
+    // valid while publishes are queued, this task never returns.
+    char publish_topic[BASE_PUBLISH_TOPIC_LEN + sizeof("sensor")];
+    snprintf(publish_topic, sizeof(publish_topic), "%ssensor", base_publish_topic);
+    char metrics_topic[BASE_PUBLISH_TOPIC_LEN + sizeof("metrics")];
+    snprintf(metrics_topic, sizeof(metrics_topic), "%smetrics", base_publish_topic);
+
     mqttInitParams.mqttCommandTimeout_ms = 20000;
     mqttInitParams.tlsHandshakeTimeout_ms = 5000;
     mqttInitParams.isSSLHostnameVerify = true;
@@ -227,7 +314,10 @@ void aws_iot_task(void *param) {
                         false, true, portMAX_DELAY);    
 
     connectParams.keepAliveIntervalInSec = 10;
-    connectParams.isCleanSession = true;
+    // Persistent session: after a Wi-Fi drop the broker keeps the subscription and
+    // queued messages, so reconnects skip resubscribing and unacked QoS1 publishes
+    // are redelivered.
+    connectParams.isCleanSession = false;
     connectParams.MQTTVersion = MQTT_3_1_1;
 
     connectParams.pClientID = client_id;
@@ -235,18 +325,23 @@ void aws_iot_task(void *param) {
     connectParams.isWillMsgPresent = false;
     ui_textarea_add("Connecting to AWS IoT Core...\n", NULL, 0);
     ESP_LOGI(TAG, "Connecting to AWS IoT Core at %s:%d", mqttInitParams.pHostURL, mqttInitParams.port);
-    do {
-        rc = aws_iot_mqtt_connect(&client, &connectParams);
-        if(SUCCESS != rc) {
-            ESP_LOGE(TAG, "Error(%d) connecting to %s:%d", rc, mqttInitParams.pHostURL, mqttInitParams.port);
-            vTaskDelay(pdMS_TO_TICKS(1000));
-        }
-    } while(SUCCESS != rc);
+    // Retries with the same jittered backoff as auto-reconnect, so a fleet of
+    // devices powered up together does not hit the broker in lockstep.
+    rc = aws_iot_mqtt_connect_with_backoff(&client, &connectParams, 0);
+    if(SUCCESS != rc) {
+        ESP_LOGE(TAG, "Error(%d) connecting to %s:%d", rc, mqttInitParams.pHostURL, mqttInitParams.port);
+        abort();
+    }
     ui_textarea_add("Successfully connected!\n", NULL, 0);
     ESP_LOGI(TAG, "Successfully connected to AWS IoT Core!");
 
+    IoT_Connection_Metrics metrics;
+    aws_iot_mqtt_get_connection_metrics(&client, &metrics);
+    ESP_LOGI(TAG, "Connect took DNS %u ms, TCP %u ms, TLS %u ms, CONNACK %u ms",
+             metrics.dnsLookupMs, metrics.tcpConnectMs, metrics.tlsHandshakeMs, metrics.connackMs);
+
     /*
-     * Enable Auto Reconnect functionality. Minimum and Maximum time for exponential backoff for retries.
+     * Enable Auto Reconnect functionality. Base and maximum interval of the jittered backoff for retries.
      *  #AWS_IOT_MQTT_MIN_RECONNECT_WAIT_INTERVAL
      *  #AWS_IOT_MQTT_MAX_RECONNECT_WAIT_INTERVAL
      */
@@ -271,24 +366,26 @@ void aws_iot_task(void *param) {
     ESP_LOGI(TAG, "\n****************************************\n*  AWS client Id - %s  *\n****************************************\n\n",
              client_id);
     
-    ui_textarea_add("Publishing to topic: %s\n", base_publish_topic, BASE_PUBLISH_TOPIC_LEN) ;
-    while((NETWORK_ATTEMPTING_RECONNECT == rc || NETWORK_RECONNECTED == rc || SUCCESS == rc)) {
-
-        //Max time the yield function will wait for read messages
-        rc = aws_iot_mqtt_yield(&client, 100);
-        if(NETWORK_ATTEMPTING_RECONNECT == rc) {
-            // If the client is attempting to reconnect we will skip the rest of the loop.
-            continue;
-        }
+    // From here on the I/O task yields, reconnects and sends queued publishes.
+    // This task only produces sensor readings.
+    rc = aws_iot_mqtt_io_task_start(&mqtt_io_task, &client, NULL);
+    if(SUCCESS != rc) {
+        ESP_LOGE(TAG, "Unable to start MQTT I/O task - %d", rc);
+        abort();
+    }
 
+    ui_textarea_add("Publishing to topic: %s\n", base_publish_topic, BASE_PUBLISH_TOPIC_LEN) ;
+    uint32_t readings = 0;
+    while(1) {
         ESP_LOGD(TAG, "Stack remaining for task '%s' is %d bytes", pcTaskGetTaskName(NULL), uxTaskGetStackHighWaterMark(NULL));
         vTaskDelay(pdMS_TO_TICKS(PUBLISH_INTERVAL_MS));
         
-        publisher(&client, base_publish_topic, BASE_PUBLISH_TOPIC_LEN);
-    }
+        publisher(&mqtt_io_task, publish_topic, strlen(publish_topic));
 
-    ESP_LOGE(TAG, "An error occurred in the main loop.");
-    abort();
+        if (++readings % METRICS_PUBLISH_INTERVAL == 0){
+            publish_metrics(&mqtt_io_task, &client, metrics_topic);
+        }
+    }
 }
 
 void app_main()